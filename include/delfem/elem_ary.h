@@ -30,6 +30,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #define ELEM_ARY_H
 
 #include <vector>
+#include <map>
 #include <assert.h>
 #include <cstdlib> //(abs)
 #include <cstring> //(strspn, strlen, strncmp, strtok)
@@ -73,7 +74,7 @@ public:
 		friend class CElemAry;
 	public:
 		CElemSeg(unsigned int id_na, ELSEG_TYPE elseg_type)
-			: m_id_na(id_na), m_elseg_type(elseg_type){}
+			: m_id_na(id_na), m_elseg_type(elseg_type), pEA(0){}
 
 		unsigned int GetMaxNoes() const { return max_noes; }	//!< m[hԍ̈ԑ傫Ȃ̂𓾂inoesi[邽߂ɂ͈傫Ȕz񂪕KvȂ̂ŒӁj
 		unsigned int Length() const { return m_nnoes; }	//!< return the node size per elem seg  ( will be renamed to Length() );
@@ -94,6 +95,7 @@ public:
 		//! ߓ_ԍݒ
 		void SetNodes(unsigned int ielem, unsigned int idofes, int ino ){
 			pLnods[ielem*npoel+begin+idofes] = ino;
+			if( pEA != 0 ){ pEA->UpdateConnVersion(); }	// the connectivity is changed
 		}
 		//! eꏊ(Corner,Bubble)ɒ`Ăvfߓ_̐o
 		static unsigned GetLength(ELSEG_TYPE elseg_type, ELEM_TYPE elem_type)
@@ -160,17 +162,20 @@ public:
 		mutable unsigned int* pLnods;
 		mutable unsigned int npoel;
 		mutable unsigned int nelem;
+		mutable CElemAry* pEA;	// element array the segment was taken from by the non-const GetSeg (0 otherwise)
 	};
 public:
 	//! default constructor
 	CElemAry(){
 		m_nElem = 0; npoel = 0; m_pLnods = 0;
+		this->UpdateConnVersion();
 	}
   CElemAry(const CElemAry& ea);
   
   // Constructor with elem number (nelem) and elem type (elemtype)
 	CElemAry(unsigned int nelem, ELEM_TYPE elem_type) : m_nElem(nelem), m_ElemType(elem_type){
 		npoel = 0; m_pLnods = 0;
+		this->UpdateConnVersion();
 	}
 	//! destructor
 	virtual ~CElemAry(){
@@ -188,6 +193,7 @@ public:
 		es.pLnods = this->m_pLnods;
 		es.npoel = this->npoel;
 		es.nelem = this->m_nElem;
+		es.pEA = 0;
 		return es;
 	}
 	CElemSeg& GetSeg(unsigned int id_es){
@@ -197,6 +203,7 @@ public:
 		es.pLnods = this->m_pLnods;
 		es.npoel = this->npoel;
 		es.nelem = this->m_nElem;
+		es.pEA = this;	// CElemSeg::SetNodes changes the connectivity version
 		return es;
 	}
 
@@ -236,15 +243,30 @@ public:
 
 	// vf͂ޗvfDelsuel̃̈mۂ͂Ȃ̂ŁCŏmۂĂ
 	bool MakeElemSurElem( const unsigned int& id_es_corner, int* elsuel) const;
+
+	/*!
+	@brief color the elements so that no two elements of one color share a node of the segment id_es
+	@param[out] color elements of the i-th color are color.array[ color.index[i] ... color.index[i+1]-1 ]
+	Elements of one color can be merged into a matrix at the same time from different threads.
+	*/
+	bool MakeColoring(unsigned int id_es, Com::CIndexedArray& color) const;
+	//! coloring of the segment id_es (made on the first call and kept while the connectivity version is the same)
+	const Com::CIndexedArray& GetColoring(unsigned int id_es) const;
+	/*!
+	@brief version of the connectivity
+	It is changed whenever the connectivity is changed (AddSegment, InitializeFromFile, CElemSeg::SetNodes),
+	and it is unique among all the element arrays, so that a table made from an element array
+	can be checked with this even if the element array was replaced.
+	*/
+	unsigned int GetConnVersion() const { return m_iver_conn; }
 private:
+	void UpdateConnVersion();
 
 	bool MakePointSurElem( const unsigned int id_es, Com::CIndexedArray& elsup ) const;
 
 	bool MakePointSurPoint
   (const unsigned int id_es, const Com::CIndexedArray& elsup, bool isnt_self,
    Com::CIndexedArray& psup ) const;
-
-  bool MakeElemSurElem( const unsigned int& id_es_corner, const Com::CIndexedArray& elsup, int* elsuel) const;
 private:
 
 
@@ -254,6 +276,9 @@ protected:
 	unsigned int npoel;		//!< the total number of nodes including in one elemement
 	unsigned int * m_pLnods;			//!< connectivity
 	Com::CObjSet<CElemSeg> m_aSeg;	//!< the set of elem segment
+	unsigned int m_iver_conn;	//!< version of the connectivity (GetConnVersion)
+	//! coloring for each segment ID and the connectivity version it was made with (GetColoring)
+	mutable std::map< unsigned int, std::pair<unsigned int,Com::CIndexedArray> > m_mapColor;
 };
 
 }
@@ -36,6 +36,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #endif
 
 namespace LsSol{
+	class CKrylovRecycle;	// recycling of the Krylov subspace
 	class CPreconditioner;	// Os
 }
 namespace Fem{
@@ -58,7 +59,7 @@ class CEqnSystem
 {
 public:		
 	//! ftHgERXgN^
-	CEqnSystem() : m_gamma_newmark(0.6), m_beta_newmark(0.3025), m_dt(0.1), pLS(0), pPrec(0){}
+	CEqnSystem() : m_gamma_newmark(0.6), m_beta_newmark(0.3025), m_dt(0.1), pLS(0), pPrec(0), pRecycle(0), m_nrestart_gmres(0){}
 	//! fXgN^
 	virtual ~CEqnSystem(){ this->Clear(); }
 	virtual void Clear();
@@ -115,12 +116,37 @@ public:
 	virtual void ClearPreconditioner();
 	virtual void ClearLinearSystem();
 	//! @}
+
+	/*!
+	@brief recycle the Krylov subspace between the solves of the sequence
+	@remarks the solutions of the previous solves are used for the initial solution, and for the symmetric system
+	the approximate eigen vectors of the smallest eigen values are deflated in CG (LsSol::Solve_PCG_Recycle)
+	*/
+	void SetKrylovRecycle(bool is_recycle);
+	//! statistics of the recycling (0 if not recycled)
+	const LsSol::CKrylovRecycle* GetKrylovRecycle() const { return pRecycle; }
+	//! the preconditioner (0 if it is not made yet)
+	const LsSol::CPreconditioner* GetPreconditioner() const { return pPrec; }
+	/*!
+	@brief use the restarted GMRES instead of BiCGSTAB for the nonsymmetric system
+	@param[in] nrestart dimension of the Krylov subspace before restart (0 : BiCGSTAB)
+	*/
+	void SetGMRES(unsigned int nrestart){ m_nrestart_gmres = nrestart; }
+protected:
+	//! solve the linear system with PCG (with the recycling if set)
+	bool SolveLinearSystem_PCG(double& conv_ratio, unsigned int& iteration);
+	//! solve the linear system with PBiCGSTAB (with the recycling if set)
+	bool SolveLinearSystem_PBiCGSTAB(double& conv_ratio, unsigned int& iteration);
+	//! solve the nonsymmetric linear system with PGMRES if set by SetGMRES, otherwise with SolveLinearSystem_PBiCGSTAB (with the recycling if set)
+	bool SolveLinearSystem_Asym(double& conv_ratio, unsigned int& iteration);
 protected:
 	std::vector< std::pair<unsigned int, double> > m_aItrNormRes;
 	////////////////
 	double m_gamma_newmark, m_beta_newmark, m_dt;
 	Fem::Ls::CLinearSystem_Field* pLS;	// AꎟNX
 	LsSol::CPreconditioner* pPrec;	// ONX
+	LsSol::CKrylovRecycle* pRecycle;	// recycled subspace (0 if not recycled)
+	unsigned int m_nrestart_gmres;	// restart of GMRES (0 if BiCGSTAB is used)
 	bool m_is_cleared_value_ls;
 	bool m_is_cleared_value_prec;
 };
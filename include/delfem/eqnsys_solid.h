@@ -98,6 +98,13 @@ public:
 		this->m_is_cleared_value_prec = true;
 	}
 
+	//! use the smoothed aggregation AMG (rigid body modes from the node coordinates) instead of ILU(1) for CG
+	void SetPreconditionerAMG(bool is_amg){
+		if( m_IsAMG == is_amg ) return;
+		m_IsAMG = is_amg;
+		this->ClearLinearSystemPreconditioner();
+	}
+
 	void SetSaveStiffMat(){
 		if( m_IsSaveStiffMat || m_IsGeomNonlin || !m_IsStationary ) return;
 		m_IsSaveStiffMat = true;
@@ -133,6 +140,7 @@ private:
 	bool m_IsGeomNonlin;
 	bool m_IsSaveStiffMat;
 	bool m_IsStationary;
+	bool m_IsAMG;
 	double m_lambda, m_myu, m_rho;
 	double m_g_x, m_g_y, m_g_z;
 	
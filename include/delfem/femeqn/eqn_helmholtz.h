@@ -32,12 +32,15 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 
 #include <vector>
 
+#include "delfem/complex.h"
+
 namespace Fem
 {
 
 namespace Ls{
 	class CZLinearSystem;
 	class CZLinearSystem_GeneralEigen;
+	class CZLinearSystem_Sweep;
 	class CPreconditioner;
 }
 namespace Field{
@@ -101,6 +104,35 @@ bool AddLinSys_MassMatrixEigen_AxalSym(
 		unsigned int id_field_val,
 		unsigned int id_ea = 0 );	// 0id_field_valׂĂɂ
 
+/*!
+@brief Helmholtz equation for the frequency sweep (CZLinearSystem_Sweep with 4 terms)
+the stiffness is merged to the term 0 and the mass to the term 1 (see GetSweepCoeff_Helmholtz).
+The residuals -[A_t]{u} of the value of the field are merged to the residuals of the terms,
+and CZLinearSystem_Sweep::SetBatch combines them for each frequency.
+@retval false if the interpolation of an element array is not TRI11
+*/
+bool AddLinSys_Helmholtz_Sweep(
+		Fem::Ls::CZLinearSystem_Sweep& ls,
+		const Fem::Field::CFieldWorld& world,
+		unsigned int id_field_val,
+		unsigned int id_ea = 0 );
+
+/*!
+@brief radiation boundary condition for the frequency sweep (the terms 2 and 3 of CZLinearSystem_Sweep)
+@retval false if the interpolation of an element array is not LINE11
+*/
+bool AddLinSys_SommerfeltRadiationBC_Sweep(
+		Fem::Ls::CZLinearSystem_Sweep& ls,
+		const Fem::Field::CFieldWorld& world,
+		unsigned int id_field_val,
+		unsigned int id_ea = 0 );
+
+/*!
+@brief coefficients of the 4 terms of the Helmholtz equation for the frequency sweep
+@param[in] wave_length g
+*/
+void GetSweepCoeff_Helmholtz(double wave_length, Com::Complex coeff[4]);
+
 }
 }
 
@@ -40,6 +40,7 @@ namespace Ls
 {
 	class CLinearSystem_Field;
 	class CLinearSystem_Save;
+	class CLinearSystem_MatFree;
 	class CLinearSystem_SaveDiaM_NewmarkBeta;
 	class CLinearSystem_Eigen;
 	class CPreconditioner;
@@ -63,6 +64,14 @@ namespace Eqn{
 	 const Fem::Field::CFieldWorld& world,
 	 unsigned int id_field_disp );
 
+	// linear elastic solid static (matrix-free, TET11 and HEX11)
+	bool AddLinSys_LinearSolid3D_Static
+	(Fem::Ls::CLinearSystem_MatFree& ls,
+	 double lambda, double myu,
+	 double  rho, double g_x, double g_y, double g_z,
+	 const Fem::Field::CFieldWorld& world,
+	 unsigned int id_field_disp );
+
 	// linear elastic solid dynamic with newmark-beta time integration
 	bool AddLinSys_LinearSolid3D_NonStatic_NewmarkBeta
 	(double dt, double gamma, double beta,
@@ -39,6 +39,7 @@ namespace Ls
 {
 class CLinearSystem_Field;
 class CLinearSystem_Save;
+class CLinearSystem_MatFree;
 class CLinearSystem_Eigen;
 class CPreconditioner;
 }
@@ -89,6 +90,22 @@ bool AddLinSys_Poisson(
 		const Fem::Field::CFieldWorld& world,
 		unsigned int id_field_val,
 		unsigned int id_ea = 0 );	// 0id_field_valׂĂɂ
+
+/*!
+@brief register the Poisson operator to the matrix-free linear system and make its residual
+@param [in,out] ls matrix-free linear system
+@param [in] alpha diffusion coefficient @f$ \alpha @f$
+@param [in] source source term
+@param [in] world field world
+@param [in] id_field_val ID of the value field
+@remark only TRI11, TET11 and HEX11 are supported
+*/
+bool AddLinSys_Poisson(
+		Fem::Ls::CLinearSystem_MatFree& ls,
+		double alpha, double source,
+		const Fem::Field::CFieldWorld& world,
+		unsigned int id_field_val,
+		unsigned int id_ea = 0 );
 		
 ////////////////
 bool AddLinearSystem_Wave(
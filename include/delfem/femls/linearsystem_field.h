@@ -146,6 +146,12 @@ public:
     virtual bool SCAL(double alpha, int iv1){ return m_ls.SCAL(alpha,iv1); } //!< xNg̃XJ[{ ({v1} := alpha * {v1})
     virtual bool AXPY(double alpha, int iv1, int iv2){ return m_ls.AXPY(alpha,iv1,iv2); }//!< xNg̑Z({v2} := alpha*{v1} +@{v2})	
     virtual bool MATVEC(double alpha, int iv1, double beta, int iv2){ return m_ls.MATVEC(alpha,iv1,beta,iv2); } //!< sxNg ({v2} := alpha*[MATRIX]*{v1} + beta*{v2})
+    virtual bool AXPBY(double alpha, int iv1, double beta, int iv2){ return m_ls.AXPBY(alpha,iv1,beta,iv2); }
+    virtual double AXPY_DOT(double alpha, int iv1, int iv2){ return m_ls.AXPY_DOT(alpha,iv1,iv2); }
+    virtual double MATVEC_DOT(double alpha, int iv1, double beta, int iv2){ return m_ls.MATVEC_DOT(alpha,iv1,beta,iv2); }
+    virtual void DOTS(unsigned int ndot, const int* aiv1, const int* aiv2, double* adot){ m_ls.DOTS(ndot,aiv1,aiv2,adot); }
+    virtual bool MATVEC_MULTI(unsigned int nvec, double alpha, const int* aiv1, double beta, const int* aiv2){ return m_ls.MATVEC_MULTI(nvec,alpha,aiv1,beta,aiv2); }
+    virtual bool AXPY_MULTI(unsigned int nvec, const double* aalpha, const int* aiv1, int iv2){ return m_ls.AXPY_MULTI(nvec,aalpha,aiv1,iv2); }
 protected:
 	class CLinSysSeg_Field{
 	public:
@@ -0,0 +1,206 @@
+/*
+DelFEM (Finite Element Analysis)
+Copyright (C) 2009  Nobuyuki Umetani    n.umetani@gmail.com
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+/*! @file
+@brief matrix-free linear system class (Fem::Ls::CLinearSystem_MatFree) and its Chebyshev preconditioner
+@author Nobuyuki Umetani
+*/
+
+#if !defined(LINEAR_SYSTEM_MATFREE_H)
+#define LINEAR_SYSTEM_MATFREE_H
+
+#if defined(__VISUALC__)
+#pragma warning( disable : 4786 )
+#endif
+
+#include <assert.h>
+#include <vector>
+
+#include "delfem/field.h"
+#include "delfem/ls/linearsystem_interface_solver.h"
+#include "delfem/femls/linearsystem_field.h"
+#include "delfem/matvec/vector_blk.h"
+
+namespace Fem{
+namespace Field{
+	class CFieldWorld;
+}
+namespace Ls{
+
+/*!
+@brief linear system without the assembled matrix
+@ingroup FemLs
+
+MATVEC recomputes the element contributions from the geometric factors kept for each element
+(the derivatives of the shape functions and the weights at the integration points).
+The elements are packed in batches of NBATCH elements of one color, and the loops over the elements in a batch
+are the innermost loops so that the compiler can vectorize them. Batches of one color are computed in parallel.
+
+The operator is registered by Fem::Eqn::AddLinSys_Poisson and Fem::Eqn::AddLinSys_LinearSolid3D_Static
+called with this class, which also make the residual. Only the CORNER nodes are supported (TRI11, TET11 and HEX11).
+The fixed boundary condition is imposed as in the assembled matrix (unit diagonal, zero row and column).
+*/
+class CLinearSystem_MatFree : public CLinearSystem_Field
+{
+public:
+	//! physics of the element operator
+	enum ELEM_OP_TYPE{
+		DIFFUSION,	//!< c0 * grad(u) * grad(v)  (c0 : diffusion coefficient)
+		ELASTIC		//!< linear elasticity (c0 : lambda, c1 : myu)
+	};
+	enum { NBATCH = 4 };	//!< number of elements in a batch
+public:
+	CLinearSystem_MatFree(){}
+	virtual ~CLinearSystem_MatFree(){ this->Clear(); }
+
+	virtual void Clear();
+	//! make the segment for the CORNER nodes of the field (no matrix is made)
+	virtual bool AddPattern_Field(const unsigned int id_field, const Field::CFieldWorld& world);
+	//! set zero to the residual and remove the element operators
+	virtual void InitializeMarge();
+
+	/*!
+	@brief add the element operator of the element array (id_ea) of the field (id_field)
+	@retval index of the operator (-1 if failed)
+	*/
+	int AddElemOp(ELEM_OP_TYPE type, double c0, double c1,
+		unsigned int id_field, unsigned int id_ea, const Field::CFieldWorld& world);
+	//! add {f}-[K]{u} of the operator (iop) to the residual ({f} : integral of the load per unit volume, {u} : value of the field)
+	bool AddResidual_ElemOp(unsigned int iop, const double* load, const Field::CFieldWorld& world);
+	unsigned int NElemOp() const { return m_aOp.size(); }
+
+	//! {y} += alpha*[K]{x} for the operators of the segment (ilss) without the boundary condition
+	void MultElemOp(unsigned int ilss, double alpha, const MatVec::CVector_Blk& x, MatVec::CVector_Blk& y) const;
+	//! {y} := alpha*[K]{x} + beta*{y} for the segment (ilss) with the boundary condition
+	bool MatVec_Seg(unsigned int ilss, double alpha, const MatVec::CVector_Blk& x, double beta, MatVec::CVector_Blk& y);
+	//! diagonal of [K] of the segment (ilss) with the boundary condition
+	bool GetDiagonal_Seg(unsigned int ilss, MatVec::CVector_Blk& diag);
+
+	////////////////////////////////
+	// function for linear solver (the matrix vector product is matrix-free)
+
+	virtual bool MATVEC(double alpha, int iv1, double beta, int iv2);
+	virtual double MATVEC_DOT(double alpha, int iv1, double beta, int iv2){
+		this->MATVEC(alpha,iv1,beta,iv2);
+		return this->DOT(iv1,iv2);
+	}
+	virtual bool MATVEC_MULTI(unsigned int nvec, double alpha, const int* aiv1, double beta, const int* aiv2){
+		for(unsigned int ivec=0;ivec<nvec;ivec++){
+			if( !this->MATVEC(alpha,aiv1[ivec],beta,aiv2[ivec]) ) return false;
+		}
+		return true;
+	}
+private:
+	class CElemOp{
+	public:
+		ELEM_OP_TYPE type;
+		double c0, c1;
+		unsigned int ilss;
+		unsigned int nno;	// nodes of an element
+		unsigned int ndim;	// dimension of the space
+		unsigned int nint;	// integration points of an element
+		unsigned int nelem;
+		std::vector<unsigned int> aBatchColor;	// batches of the icolor-th color are [aBatchColor[icolor],aBatchColor[icolor+1])
+		std::vector<unsigned int> aNo;		// nodes    [(ibatch*nno+ino)*NBATCH+ie]
+		std::vector<double> aDNDX;			// dN/dx    [(((ibatch*nint+iint)*nno+ino)*ndim+idim)*NBATCH+ie]
+		std::vector<double> aDetWei;		// weight   [(ibatch*nint+iint)*NBATCH+ie] (zero for the padding elements)
+		std::vector<double> aN;				// value of the shape functions at the integration points [iint*nno+ino]
+	};
+	std::vector< CElemOp > m_aOp;
+	std::vector< MatVec::CVector_Blk* > m_aTmp0, m_aTmp1;	// working vectors of MatVec_Seg
+};
+
+/*!
+@brief Chebyshev polynomial preconditioner of the point Jacobi for the matrix-free linear system
+@ingroup FemLs
+
+Only the matrix vector product and the diagonal are used, so no matrix is assembled.
+The preconditioner is the Chebyshev iteration (degree times matrix vector products) for the eigen values of
+D^-1[K] in [lambda_max/ratio,lambda_max], started from zero. It is symmetric positive definite and can be used in PCG.
+The degree 1 is the point Jacobi preconditioner.
+The largest eigen value is estimated by a few Lanczos iterations in SetValue.
+Both are those of LsSol (LsSol::MaximumEigenValue_Lanczos, LsSol::SolvePrecond_Chebyshev) on the matrix-free operator.
+*/
+class CPreconditioner_MatFreeChebyshev
+{
+public:
+	CPreconditioner_MatFreeChebyshev() : m_ndeg(3), m_ratio(30.0), m_nlanczos(15), m_max_eigen(0.0){}
+	CPreconditioner_MatFreeChebyshev(CLinearSystem_MatFree& ls, unsigned int ndeg = 3)
+		: m_ndeg(ndeg), m_ratio(30.0), m_nlanczos(15), m_max_eigen(0.0){
+		this->SetValue(ls);
+	}
+	virtual ~CPreconditioner_MatFreeChebyshev(){ this->Clear(); }
+	void Clear();
+
+	//! degree of the polynomial (matrix vector products per preconditioning)
+	void SetDegree(unsigned int ndeg){ m_ndeg = ( ndeg == 0 ) ? 1 : ndeg; }
+	//! the interval of the eigen values is [lambda_max/ratio,lambda_max]
+	void SetEigenRatio(double ratio){ m_ratio = ratio; }
+	//! number of the Lanczos iterations for the largest eigen value
+	void SetLanczosIteration(unsigned int nlanczos){ m_nlanczos = nlanczos; }
+
+	//! diagonal and the largest eigen value of D^-1[K]
+	bool SetValue(CLinearSystem_MatFree& ls);
+	bool SolvePrecond(CLinearSystem_MatFree& ls, int iv);
+	//! largest eigen value of D^-1[K] used in the polynomial (estimated in SetValue)
+	double GetMaxEigen() const { return m_max_eigen; }
+private:
+	unsigned int m_ndeg;
+	double m_ratio;
+	unsigned int m_nlanczos;
+	double m_max_eigen;
+	std::vector< MatVec::CVector_Blk* > m_aInvDia;
+	std::vector< MatVec::CVector_Blk* > m_aX, m_aD, m_aW, m_aZ;	// working vectors
+};
+
+/*!
+@brief matrix-free linear system and Chebyshev preconditioner for the solvers
+@ingroup FemLs
+*/
+class CLinearSystemPreconditioner_MatFree : public LsSol::ILinearSystemPreconditioner_Sol
+{
+public:
+	CLinearSystemPreconditioner_MatFree( CLinearSystem_MatFree& ls, CPreconditioner_MatFreeChebyshev& prec )
+		: ls(ls), prec(prec){}
+
+	virtual unsigned int GetTmpVectorArySize() const{ return ls.GetTmpVectorArySize(); }
+	virtual bool ReSizeTmpVecSolver(unsigned int size_new){ return ls.ReSizeTmpVecSolver(size_new); }
+
+	virtual double DOT(int iv1, int iv2){ return ls.DOT(iv1,iv2); }
+	virtual bool COPY(int iv1, int iv2){ return ls.COPY(iv1,iv2); }
+	virtual bool SCAL(double alpha, int iv1){ return ls.SCAL(alpha,iv1); }
+	virtual bool AXPY(double alpha, int iv1, int iv2){ return ls.AXPY(alpha,iv1,iv2); }
+	virtual bool MATVEC(double alpha, int iv1, double beta, int iv2){ return ls.MATVEC(alpha,iv1,beta,iv2); }
+	virtual bool AXPBY(double alpha, int iv1, double beta, int iv2){ return ls.AXPBY(alpha,iv1,beta,iv2); }
+	virtual double AXPY_DOT(double alpha, int iv1, int iv2){ return ls.AXPY_DOT(alpha,iv1,iv2); }
+	virtual double MATVEC_DOT(double alpha, int iv1, double beta, int iv2){ return ls.MATVEC_DOT(alpha,iv1,beta,iv2); }
+	virtual void DOTS(unsigned int ndot, const int* aiv1, const int* aiv2, double* adot){ ls.DOTS(ndot,aiv1,aiv2,adot); }
+	virtual bool MATVEC_MULTI(unsigned int nvec, double alpha, const int* aiv1, double beta, const int* aiv2){ return ls.MATVEC_MULTI(nvec,alpha,aiv1,beta,aiv2); }
+	virtual bool AXPY_MULTI(unsigned int nvec, const double* aalpha, const int* aiv1, int iv2){ return ls.AXPY_MULTI(nvec,aalpha,aiv1,iv2); }
+
+	virtual bool SolvePrecond(int iv){ return prec.SolvePrecond(ls,iv); }
+private:
+	CLinearSystem_MatFree& ls;
+	CPreconditioner_MatFreeChebyshev& prec;
+};
+
+}	// end namespace Ls
+}	// end namespace Fem
+
+#endif
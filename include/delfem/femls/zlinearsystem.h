@@ -91,6 +91,12 @@ public:
 	virtual void InitializeMarge();
 	// }[W̏icmԂ)
 	virtual double FinalizeMarge(); 
+	/*!
+	@brief use the real copy of the off-diagonal values in the matrix vector product
+	FinalizeMarge makes the copy for the matrices whose off-diagonal values are all real 
+	(see MatVec::CZMatDia_BlkCrs::MakeRealCrsValue)
+	*/
+	void SetRealCrsValue(bool is_real){ m_is_real_crs = is_real; }
 
 	////////////////////////////////
 	// function for fixed boundary condition
@@ -195,6 +201,7 @@ protected:
     bool AddMat_NonDia(unsigned int ils_col, unsigned int ils_row, const Com::CIndexedArray& crs );
 	bool AddMat_Dia(unsigned int ils, const Field::CElemAry& ea, unsigned int id_es);
 protected:
+	bool m_is_real_crs;
 	std::vector< CLinSysSeg > m_aSeg;
     std::vector< std::vector< MatVec::CZMat_BlkCrs* > > m_Matrix_NonDia;
     std::vector< MatVec::CZMatDia_BlkCrs* > m_Matrix_Dia;
@@ -228,6 +235,80 @@ private:
     std::vector< MatVec::CDiaMat_Blk* > m_DiaMassMatrix;
 };
 
+////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////
+
+/*!
+@brief linear system for the frequency sweep  [A(w)] = sum_t c_t(w)[A_t]
+@ingroup FemLs
+
+The term matrices [A_t] (e.g. the stiffness and the mass) are assembled once with the pattern of the system.
+SetMatrix_Combination forms [A(w)] of one frequency (for the preconditioner), and the batch functions 
+treat the systems of several frequencies at once: the j-th column of a batch vector is the vector 
+of the j-th frequency, and MatVec_Batch reads each term matrix once for all the columns.
+The columns are interleaved as CMultiVector_Blk (see CZMatDia_BlkCrs::MatVec_Multi).
+Only the system with one segment is supported (as CZLinearSystem_GeneralEigen).
+Each term has its residual vector -[A_t]{u} (the excitation by the value of the field, e.g. the Dirichlet value),
+and SetBatch makes the residual of the j-th frequency as {f} + sum_t c_t(w_j)(-[A_t]{u}),
+where {f} is the residual of the system (the load which does not depend on the frequency).
+*/
+class CZLinearSystem_Sweep : public CZLinearSystem
+{
+public:
+	CZLinearSystem_Sweep(unsigned int nterm);
+	virtual ~CZLinearSystem_Sweep();
+	virtual void Clear();
+	virtual bool AddPattern_Field(const unsigned int id_field, const Field::CFieldWorld& world);
+	virtual void InitializeMarge();
+	virtual double FinalizeMarge(); 
+
+	unsigned int NTerm() const { return m_nterm; }
+    MatVec::CZMatDia_BlkCrs* GetTermMatrixPtr(unsigned int iterm, 
+		unsigned int id_field, const Field::ELSEG_TYPE& elseg_type, const Field::CFieldWorld& world);
+	//! residual of the term -[A_iterm]{u}
+    MatVec::CZVector_Blk* GetTermResidualPtr(unsigned int iterm, 
+		unsigned int id_field, const Field::ELSEG_TYPE& elseg_type, const Field::CFieldWorld& world);
+	//! [MATRIX] = sum coeff[iterm]*[A_iterm] with the boundary condition
+	bool SetMatrix_Combination(const Com::Complex* coeff);
+
+	////////////////////////////////
+	// function for the batch of frequencies
+	// v=-1:residual    v=-2:update
+
+	/*!
+	@brief set the frequencies of the batch
+	@param[in] coeff coefficients of the terms, coeff[ifreq*NTerm()+iterm]
+	*/
+	bool SetBatch(unsigned int nfreq, const Com::Complex* coeff);
+	unsigned int NBatch() const { return m_nfreq; }
+	unsigned int GetTmpVecBatchSize() const { return m_TmpVecBatch.size(); }
+	bool ReSizeTmpVecBatch(unsigned int size_new);
+    MatVec::CZVector_Blk& GetBatchVector(int iv);
+	//! copy the ifreq-th column of the batch vector iv_batch to the vector iv
+	bool CopyBatchColumn(int iv_batch, unsigned int ifreq, int iv);
+	// adot[j] = {v1_j} * {v2_j}
+	bool DOT_Batch(int iv1, int iv2, Com::Complex* adot);
+	// adot[j] = {v1_j} * {v2_j}^H
+	bool INPROCT_Batch(int iv1, int iv2, Com::Complex* adot);
+	// {v2} := {v1}
+	bool COPY_Batch(int iv_from, int iv_to);
+	// {v1_j} := alpha[j] * {v1_j}
+	bool SCAL_Batch(const Com::Complex* alpha, int iv1);
+	// {v2_j} := alpha[j]*{v1_j} + {v2_j}
+	bool AXPY_Batch(const Com::Complex* alpha, int iv1, int iv2);
+	// {v2_j} := alpha*[A(w_j)]*{v1_j} + beta*{v2_j}
+	bool MatVec_Batch(double alpha, int iv1, double beta, int iv2);
+private:
+	const unsigned int m_nterm;
+    std::vector< MatVec::CZMatDia_BlkCrs* > m_TermMatrix;	// [iterm] (one segment)
+    std::vector< MatVec::CZVector_Blk* > m_TermResidual;	// [iterm] (one segment)
+	unsigned int m_nfreq;
+	std::vector< Com::Complex > m_aCoeffTerm;	// [iterm*nfreq+ifreq]
+    MatVec::CZVector_Blk* m_ResidualBatch;
+    MatVec::CZVector_Blk* m_UpdateBatch;
+    std::vector< MatVec::CZVector_Blk* > m_TmpVecBatch;
+};
+
 
 }	// Ls
 }	// Fem
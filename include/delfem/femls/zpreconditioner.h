@@ -105,6 +105,15 @@ public:
 		m_Matrix_Dia[0]->BackwardSubstitution(ls.GetVector(iv,0));
 		return true;
 	}
+
+	/*!
+	@brief solve the preconditioning system for all the columns of the batch vector iv
+	the factorization of the current value (e.g. one frequency of the batch) is used for all the columns
+	*/
+	bool SolvePrecond_Batch(CZLinearSystem_Sweep& ls, int iv){
+		assert( m_Matrix_Dia.size() == 1 );
+		return m_Matrix_Dia[0]->Solve_Multi(ls.NBatch(),ls.GetBatchVector(iv));
+	}
 private:
 	unsigned int m_nlev;
 //	std::vector< std::vector< MatVec::CMatFrac_BlkCrs* > > m_Matrix_NonDia;
@@ -53,6 +53,15 @@ bool Solve_PCG(double& conv_ratio, unsigned int& iteration,
 bool Solve_PCOCG(double& conv_ratio, unsigned int& iteration,
 				CZLinearSystem& ls, CZPreconditioner& precond );
 
+/*!
+@brief solve the systems of all the frequencies in the batch with COCG method
+each column iterates with its own scalars, while the matrix product and the preconditioner are done for all the columns at once
+@param[in,out] conv_ratio tolerance (in), the largest convergence ratio of the columns (out)
+@param[in,out] iteration max iteration (in), the iteration when all the columns have converged (out)
+*/
+bool Solve_PCOCG_Batch(double& conv_ratio, unsigned int& iteration,
+				CZLinearSystem_Sweep& ls, CZPreconditioner_ILU& precond );
+
 ////////////////////////////////////////////////////////////////
 // Solve Matrix with Conjugate Gradient NR Methods
 
@@ -4,6 +4,11 @@
 
 #include <vector>
 
+namespace MatVec{
+class CMatDiaInv_BlkDia;
+class CVector_Blk;
+}
+
 namespace LsSol{
 class CLinearSystem;
 class CPreconditioner;
@@ -18,6 +23,98 @@ double MinimumEigenValueVector_InvPower(
 	unsigned int itr_lssol, // ICCG@̍ő唽
 	double conv_res_lssol,	// ICCG@̎̑Ύc
 	int& iflag_conv );		// 0:ɏI@1:ICCGȂ
+
+/*!
+@brief lowest eigen pairs of the matrix of ls with the block LOBPCG method
+@param[in] aIdVec ids of the tmp vectors where the eigen vectors are stored (its size is the number of the modes)
+@param[out] aLambda eigen values in the ascending order (one for each converged mode)
+@param[in] nblk block size (some more than the modes wanted at once, the converged modes are locked and the block is refilled)
+@param[in] max_itr maximum number of the iteration
+@param[in] conv_res convergence criteria of the relative residual |[A]{x}-lambda{x}|/|lambda|
+@retval number of the converged modes
+@remarks
+The preconditioner pls is made once and applied to every vector of the block.
+CPreconditioner_LDLT makes it the exact inverse (shift-invert with the shift of the matrix).
+The matrix of Fem::Ls::CLinearSystem_Eigen after DecompMultMassMatrix gives the generalized eigen problem.
+The tmp vectors after the max of aIdVec are used as the work (10*nblk vectors).
+The block is made smaller when the locked modes and the block would span more than the free dofs.
+*/
+unsigned int MinimumEigenValueVector_LOBPCG(
+	LsSol::CLinearSystem& ls,
+	LsSol::CPreconditioner& pls,
+	const std::vector<unsigned int>& aIdVec,
+	std::vector<double>& aLambda,
+	unsigned int nblk,
+	unsigned int max_itr,
+	double conv_res );
+
+/*!
+@brief operator [A] and inverse of its diagonal [D]^-1 on the vectors of all the segments
+@ingroup LsSol
+
+The Lanczos estimate and the Chebyshev polynomial (LsSol::SolvePrecond_Chebyshev) only need these two,
+so the assembled matrix and the matrix-free operator share them.
+{x} and {y} are always different vectors.
+*/
+class ILinearOperator_Seg
+{
+public:
+	virtual ~ILinearOperator_Seg(){}
+	//! {y} := alpha*[A]{x} + beta*{y}
+	virtual bool MatVec_Seg(double alpha, const std::vector<MatVec::CVector_Blk*>& x, 
+		double beta, std::vector<MatVec::CVector_Blk*>& y) = 0;
+	//! {y} := [D]^-1{x}
+	virtual void MultInvDia_Seg(const std::vector<MatVec::CVector_Blk*>& x, std::vector<MatVec::CVector_Blk*>& y) = 0;
+};
+
+/*!
+@brief matrix of the linear system and its block Jacobi [D]^-1 as ILinearOperator_Seg
+@param[in] aInvDia inverse of the diagonal blocks [D]^-1 for each segment ([D] is the identity if empty)
+*/
+class CLinearOperator_BlockJacobi : public ILinearOperator_Seg
+{
+public:
+	CLinearOperator_BlockJacobi(const LsSol::CLinearSystem& ls, const std::vector<MatVec::CMatDiaInv_BlkDia*>& aInvDia)
+		: ls(ls), aInvDia(aInvDia){}
+	virtual bool MatVec_Seg(double alpha, const std::vector<MatVec::CVector_Blk*>& x, 
+		double beta, std::vector<MatVec::CVector_Blk*>& y);
+	virtual void MultInvDia_Seg(const std::vector<MatVec::CVector_Blk*>& x, std::vector<MatVec::CVector_Blk*>& y);
+private:
+	const LsSol::CLinearSystem& ls;
+	const std::vector<MatVec::CMatDiaInv_BlkDia*>& aInvDia;
+};
+
+/*!
+@brief estimate of the largest eigen value of [D]^-1[A] by the Lanczos method
+@param[in] aVec vectors of the segments (only their sizes are used)
+@param[in] nitr number of the Lanczos iteration (10-20 is enough for the largest one)
+@remarks
+The operator is only applied to the working vectors made here.
+The estimate approaches the largest eigen value from below.
+*/
+double MaximumEigenValue_Lanczos(
+	ILinearOperator_Seg& op,
+	const std::vector<const MatVec::CVector_Blk*>& aVec,
+	unsigned int nitr );
+
+/*!
+@brief estimate of the largest eigen value of [D]^-1[A] by the Lanczos method ([A] : matrix of ls)
+@param[in] aInvDia inverse of the diagonal blocks [D]^-1 for each segment ([D] is the identity if empty)
+@param[in] nitr number of the Lanczos iteration (10-20 is enough for the largest one)
+@remarks ls is not changed
+*/
+double MaximumEigenValue_Lanczos(
+	const LsSol::CLinearSystem& ls,
+	const std::vector<MatVec::CMatDiaInv_BlkDia*>& aInvDia,
+	unsigned int nitr );
+
+/*!
+@brief eigen pairs of the small dense symmetric matrix by the cyclic Jacobi method
+@param[in,out] a matrix (n*n), it is diagonalized in place
+@param[out] v v[i*n+j] is the i-th component of the j-th eigen vector
+@param[out] lam eigen values (not sorted)
+*/
+void EigenSymmetric_Jacobi(unsigned int n, std::vector<double>& a, std::vector<double>& v, std::vector<double>& lam);
 }
 
 #endif
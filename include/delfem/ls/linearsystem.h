@@ -36,6 +36,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 namespace MatVec{
 class CVector_Blk;
 class CZVector_Blk;
+class CMultiVector_Blk;
 class CMat_BlkCrs;
 class CMatDia_BlkCrs;
 class CDiaMat_Blk;
@@ -52,7 +53,7 @@ class CLinearSystem : public LsSol::ILinearSystem_Sol
 {
 public:
     //! default constructer
-    CLinearSystem(){}
+    CLinearSystem() : m_nrhs(0){}
     //! destructor
     virtual ~CLinearSystem(){ this->Clear(); }
 
@@ -66,6 +67,12 @@ public:
 	virtual void InitializeMarge();
 	//! }[W̏iEݒ肵CcmԂ)
 	virtual double FinalizeMarge(); 
+	/*!
+	@brief store the pattern of the diagonal blocks in 16bit offsets for MATVEC (see MatVec::CMatDia_BlkCrs::SetCompactPattern)
+	@remark Call this after the values of the preconditioner are set, as the preconditioners read the 32bit index.
+	InitializeMarge comes back to the 32bit index. Returns false if a segment keeps the 32bit index.
+	*/
+	bool SetCompactPattern(bool is_compact);
 
 	////////////////////////////////
 	// function for linear solver
@@ -81,6 +88,12 @@ public:
 	virtual bool SCAL(double alpha, int iv1); //!< xNg̃XJ[{ ({v1} := alpha * {v1})
 	virtual bool AXPY(double alpha, int iv1, int iv2); //!< xNg̑Z({v2} := alpha*{v1} +@{v2})	
 	virtual bool MATVEC(double alpha, int iv1, double beta, int iv2); //!< sxNg ({v2} := alpha*[MATRIX]*{v1} + beta*{v2})
+	virtual bool AXPBY(double alpha, int iv1, double beta, int iv2); //!< {v2} := alpha*{v1} + beta*{v2}
+	virtual double AXPY_DOT(double alpha, int iv1, int iv2); //!< {v2} := alpha*{v1} + {v2}, return {v2}*{v2}
+	virtual double MATVEC_DOT(double alpha, int iv1, double beta, int iv2); //!< {v2} := alpha*[MATRIX]*{v1} + beta*{v2}, return {v1}*{v2}
+	virtual void DOTS(unsigned int ndot, const int* aiv1, const int* aiv2, double* adot); //!< adot[idot] := {v1[idot]}*{v2[idot]} in one sweep
+	virtual bool MATVEC_MULTI(unsigned int nvec, double alpha, const int* aiv1, double beta, const int* aiv2); //!< {v2[ivec]} := alpha*[MATRIX]*{v1[ivec]} + beta*{v2[ivec]} in one sweep over the matrix
+	virtual bool AXPY_MULTI(unsigned int nvec, const double* aalpha, const int* aiv1, int iv2); //!< {v2} := sum aalpha[ivec]*{v1[ivec]} + {v2} in one sweep over {v2}
 
 	////////////////////////////////
 	// function for preconditioner
@@ -88,6 +101,11 @@ public:
 	int AddLinSysSeg( unsigned int nnode, unsigned int len );
     int AddLinSysSeg( unsigned int nnode, const std::vector<unsigned int>& aLen );
 	unsigned int GetNLinSysSeg() const { return this->m_Matrix_Dia.size(); }
+	/*!
+	@brief {y} := alpha*[MATRIX]*{x} + beta*{y} for the vectors outside of the linear system
+	@remark x[ilss] and y[ilss] are the ilss-th segments, and x must not be y
+	*/
+	bool MatVec_Seg(double alpha, const std::vector< MatVec::CVector_Blk* >& x, double beta, std::vector< MatVec::CVector_Blk* >& y) const;
     const unsigned int GetBlkSizeLinSeg(unsigned int ilss) const{
         assert( ilss < this->GetNLinSysSeg() );
         return m_aSeg[ilss].nnode;
@@ -148,6 +166,36 @@ public:
 		assert( ilss < this->GetNLinSysSeg() );
         return *m_BCFlag[ilss];
     }
+
+	////////////////////////////////
+	// functions for several right hand sides solved at the same time (batch)
+	// the icol-th column of a batch vector is the vector of the icol-th right hand side
+	// iv=-1:residual iv=-2:update iv>=0:working batch vector
+	// the flex size segment is not supported
+
+	/*!
+	@brief allocate the batch vectors for nrhs right hand sides
+	@remark the residual is copied to all the columns of the batch residual and the batch update is set zero
+	*/
+	bool SetBatch(unsigned int nrhs);
+	unsigned int NBatch() const { return m_nrhs; }
+	unsigned int GetTmpVecBatchSize() const { return m_TmpVecBatch.size(); }
+	bool ReSizeTmpVecBatch(unsigned int size_new);
+    MatVec::CMultiVector_Blk& GetBatchVector(int iv, unsigned int ilss);
+	//! copy the irhs-th column of the batch vector iv_batch to the vector iv
+	bool CopyBatchColumn(int iv_batch, unsigned int irhs, int iv);
+	//! copy the vector iv to the irhs-th column of the batch vector iv_batch
+	bool SetBatchColumn(int iv, int iv_batch, unsigned int irhs);
+	// adot[j] = {v1_j} * {v2_j}
+	bool DOT_Batch(int iv1, int iv2, double* adot);
+	// {v2} := {v1}
+	bool COPY_Batch(int iv_from, int iv_to);
+	// {v1_j} := alpha[j] * {v1_j}
+	bool SCAL_Batch(const double* alpha, int iv1);
+	// {v2_j} := alpha[j]*{v1_j} + {v2_j}
+	bool AXPY_Batch(const double* alpha, int iv1, int iv2);
+	// {v2_j} := alpha*[MATRIX]*{v1_j} + beta*{v2_j} (each matrix is read once for all the columns)
+	bool MatVec_Batch(double alpha, int iv1, double beta, int iv2);
 public:
     bool AddMat_NonDia(unsigned int ils_col, unsigned int ils_row, const Com::CIndexedArray& crs );
 	bool AddMat_Dia(unsigned int ils, const Com::CIndexedArray& crs );
@@ -169,8 +217,16 @@ public:
     std::vector< MatVec::CMatDia_BlkCrs* > m_Matrix_Dia;
     std::vector< MatVec::CVector_Blk* > m_Residual, m_Update;
 private:
+    // segments of the vector iv (-1:residual -2:update)
+    std::vector< MatVec::CVector_Blk* >& GetVectorSegs(int iv);
     std::vector< std::vector< MatVec::CVector_Blk* > > m_TmpVectorArray;	// Working Buffer for Linear Solver
     std::vector< MatVec::CBCFlag* > m_BCFlag;	// Boundary Condition Flag
+    ////////////////
+    void ClearBatch();
+    std::vector< MatVec::CMultiVector_Blk* >& GetBatchVectorSegs(int iv);
+    unsigned int m_nrhs;	// number of the columns of the batch vectors (0:no batch)
+    std::vector< MatVec::CMultiVector_Blk* > m_ResidualBatch, m_UpdateBatch;
+    std::vector< std::vector< MatVec::CMultiVector_Blk* > > m_TmpVecBatch;
 };
 
 }
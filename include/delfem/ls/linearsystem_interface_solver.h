@@ -53,6 +53,44 @@ public:
 	virtual bool SCAL(double alpha, int iv1) = 0; //!< xNg̃XJ[{ ({v1} := alpha * {v1})
 	virtual bool AXPY(double alpha, int iv1, int iv2) = 0; //!< xNg̑Z({v2} := alpha*{v1} +@{v2})	
 	virtual bool MATVEC(double alpha, int iv1, double beta, int iv2) = 0; //!< sxNg ({v2} := alpha*[MATRIX]*{v1} + beta*{v2})
+
+	////////////////////////////////
+	// fused operations (less sweeps over the vectors)
+	// The default implementations call the operations above, so override them for speed
+
+	//! {v2} := alpha*{v1} + beta*{v2}
+	virtual bool AXPBY(double alpha, int iv1, double beta, int iv2){
+		this->SCAL(beta,iv2);
+		return this->AXPY(alpha,iv1,iv2);
+	}
+	//! {v2} := alpha*{v1} + {v2} and return {v2}*{v2}
+	virtual double AXPY_DOT(double alpha, int iv1, int iv2){
+		this->AXPY(alpha,iv1,iv2);
+		return this->DOT(iv2,iv2);
+	}
+	//! {v2} := alpha*[MATRIX]*{v1} + beta*{v2} and return {v1}*{v2}
+	virtual double MATVEC_DOT(double alpha, int iv1, double beta, int iv2){
+		this->MATVEC(alpha,iv1,beta,iv2);
+		return this->DOT(iv1,iv2);
+	}
+	//! adot[idot] := {v1[idot]}*{v2[idot]} for ndot pairs at once (only one global reduction)
+	virtual void DOTS(unsigned int ndot, const int* aiv1, const int* aiv2, double* adot){
+		for(unsigned int idot=0;idot<ndot;idot++){ adot[idot] = this->DOT(aiv1[idot],aiv2[idot]); }
+	}
+	//! {v2[ivec]} := alpha*[MATRIX]*{v1[ivec]} + beta*{v2[ivec]} for nvec vectors at once (only one sweep over the matrix)
+	virtual bool MATVEC_MULTI(unsigned int nvec, double alpha, const int* aiv1, double beta, const int* aiv2){
+		for(unsigned int ivec=0;ivec<nvec;ivec++){
+			if( !this->MATVEC(alpha,aiv1[ivec],beta,aiv2[ivec]) ) return false;
+		}
+		return true;
+	}
+	//! {v2} := sum aalpha[ivec]*{v1[ivec]} + {v2} for nvec vectors at once (only one sweep over {v2})
+	virtual bool AXPY_MULTI(unsigned int nvec, const double* aalpha, const int* aiv1, int iv2){
+		for(unsigned int ivec=0;ivec<nvec;ivec++){
+			if( !this->AXPY(aalpha[ivec],aiv1[ivec],iv2) ) return false;
+		}
+		return true;
+	}
 };
 
 
@@ -78,6 +116,44 @@ public:
 	virtual bool AXPY(double alpha, int iv1, int iv2) = 0; //!< xNg̑Z({v2} := alpha*{v1} +@{v2})	
 	virtual bool MATVEC(double alpha, int iv1, double beta, int iv2) = 0; //!< sxNg ({v2} := alpha*[MATRIX]*{v1} + beta*{v2})
 
+	////////////////////////////////
+	// fused operations (less sweeps over the vectors)
+	// The default implementations call the operations above, so override them for speed
+
+	//! {v2} := alpha*{v1} + beta*{v2}
+	virtual bool AXPBY(double alpha, int iv1, double beta, int iv2){
+		this->SCAL(beta,iv2);
+		return this->AXPY(alpha,iv1,iv2);
+	}
+	//! {v2} := alpha*{v1} + {v2} and return {v2}*{v2}
+	virtual double AXPY_DOT(double alpha, int iv1, int iv2){
+		this->AXPY(alpha,iv1,iv2);
+		return this->DOT(iv2,iv2);
+	}
+	//! {v2} := alpha*[MATRIX]*{v1} + beta*{v2} and return {v1}*{v2}
+	virtual double MATVEC_DOT(double alpha, int iv1, double beta, int iv2){
+		this->MATVEC(alpha,iv1,beta,iv2);
+		return this->DOT(iv1,iv2);
+	}
+	//! adot[idot] := {v1[idot]}*{v2[idot]} for ndot pairs at once (only one global reduction)
+	virtual void DOTS(unsigned int ndot, const int* aiv1, const int* aiv2, double* adot){
+		for(unsigned int idot=0;idot<ndot;idot++){ adot[idot] = this->DOT(aiv1[idot],aiv2[idot]); }
+	}
+	//! {v2[ivec]} := alpha*[MATRIX]*{v1[ivec]} + beta*{v2[ivec]} for nvec vectors at once (only one sweep over the matrix)
+	virtual bool MATVEC_MULTI(unsigned int nvec, double alpha, const int* aiv1, double beta, const int* aiv2){
+		for(unsigned int ivec=0;ivec<nvec;ivec++){
+			if( !this->MATVEC(alpha,aiv1[ivec],beta,aiv2[ivec]) ) return false;
+		}
+		return true;
+	}
+	//! {v2} := sum aalpha[ivec]*{v1[ivec]} + {v2} for nvec vectors at once (only one sweep over {v2})
+	virtual bool AXPY_MULTI(unsigned int nvec, const double* aalpha, const int* aiv1, int iv2){
+		for(unsigned int ivec=0;ivec<nvec;ivec++){
+			if( !this->AXPY(aalpha[ivec],aiv1[ivec],iv2) ) return false;
+		}
+		return true;
+	}
+
 	virtual bool SolvePrecond(int iv) = 0;
 };
 
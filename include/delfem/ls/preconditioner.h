@@ -34,8 +34,11 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include "delfem/matvec/matdiafrac_blkcrs.h"
 #include "delfem/matvec/matfrac_blkcrs.h"
 #include "delfem/matvec/vector_blk.h"
+#include "delfem/matvec/multivector_blk.h"
 #include "delfem/matvec/solver_mg.h"
 #include "delfem/matvec/ordering_blk.h"
+#include "delfem/matvec/matdiafrac_supernode.h"
+#include "delfem/matvec/matdiainv_blkdia.h"
 
 namespace LsSol{
 
@@ -61,9 +64,17 @@ class CPreconditioner_ILU : public CPreconditioner
 public:
 	CPreconditioner_ILU(){
 		m_is_ordering = false;
+		m_is_nd = false;
+		m_is_single = false;
+		m_is_compact = false;
+    this->ClearTime();
 	}
 	CPreconditioner_ILU(const CLinearSystem& ls, unsigned int nlev = 0){ 
     m_is_ordering = false;
+    m_is_nd = false;
+    m_is_single = false;
+    m_is_compact = false;
+    this->ClearTime();
     this->SetFillInLevel(nlev);
 		this->SetLinearSystem(ls); 
 	}
@@ -74,27 +85,71 @@ public:
 	void Clear();
 
 	//! fill_iñxݒ
-	void SetFillInLevel(int lev, int ilss0 = -1){ m_alev_input.push_back( std::make_pair(lev,ilss0) ); }
+	void SetFillInLevel(int lev, int ilss0 = -1){ m_alev_input.push_back( std::make_pair(lev,ilss0) ); m_aPatternVersion.clear(); }
 
   // ̃m[hɂ͕KFill_In
-  void SetFillBlk(const std::vector<unsigned int>& aBlk){ m_afill_blk = aBlk; }
+  void SetFillBlk(const std::vector<unsigned int>& aBlk){ m_afill_blk = aBlk; m_aPatternVersion.clear(); }
+
+  /*!
+  @brief keep the diagonal ILU factors in single precision (from the next SetValue)
+  @remark the vectors stay in double, the solution is as accurate as with the double factors but the convergence can be a little slower
+  */
+  void SetSinglePrecision(bool is_single){ m_is_single = is_single; }
+  /*!
+  @brief keep the pattern of the diagonal ILU factors as 16bit offsets (from the next SetValue)
+  @remark the rows whose offsets do not fit in 16bit make the factor keep the 32bit index (see PrintMemory)
+  */
+  void SetCompactPattern(bool is_compact){ m_is_compact = is_compact; }
+  //! print the bytes of the index and the value for each nonzero block of the diagonal factors
+  void PrintMemory() const;
 
 	// ILU(0)̃p^[
+  // the fill pattern is kept if the crs pattern of ls is the same as the last call
 	virtual void SetLinearSystem(const CLinearSystem& ls);
 
 	// lݒ肵ILUs֐
 	// ILUĂ邩ǂ͂Əڍׂȃf[^Ԃ
 	virtual bool SetValue(const CLinearSystem& ls);
 
+  //! @{
+  //! accumulated wall clock time [sec] and call counts of the symbolic and the numeric factorization
+  double GetTimeSymbolic() const { return m_time_symbolic; }
+  double GetTimeNumeric()  const { return m_time_numeric;  }
+  unsigned int NSymbolic() const { return m_nsymbolic; }
+  unsigned int NNumeric()  const { return m_nnumeric;  }
+  void ClearTime(){ m_time_symbolic = 0; m_time_numeric = 0; m_nsymbolic = 0; m_nnumeric = 0; }
+  void PrintTime() const;
+  //! @}
+
 	// Solve Preconditioning System
 	virtual bool SolvePrecond(CLinearSystem& ls, unsigned int iv);
+	//! Solve Preconditioning System for all the columns of the batch vector iv (the factor is read once)
+	bool SolvePrecond_Batch(CLinearSystem& ls, int iv);
   
 	//! Ordering̗Lݒ
 	void SetOrdering(const std::vector<int>& aind){ 
+    m_aPatternVersion.clear();
+    m_is_nd = false;
     if( aind.empty() ){ m_is_ordering = false; return; }
     m_is_ordering = true;
     m_order.SetOrdering(aind);
   }
+  /*!
+  @brief order the blocks by the nested dissection (MatVec::COrdering_Blk::MakeOrdering_ND) at the next SetLinearSystem
+  @remark only for the linear system of one segment. The halves of the dissection do not depend on each other, 
+  so the levels of the triangular solves are wider than with the natural order
+  */
+  void SetNestedDissection(bool is_nd){
+    m_aPatternVersion.clear();
+    m_is_nd = is_nd;
+    m_is_ordering = is_nd;
+  }
+private:
+  //! delete the factorized matrices but keep the settings
+  void ClearPattern();
+  // symbolic and numeric factorization without the cache check and the timing
+  void MakeFracPattern(const CLinearSystem& ls);
+  bool DoFactorize(const CLinearSystem& ls);
 private:
   std::vector< std::pair<int,int> > m_alev_input;
   std::vector< unsigned int > m_afill_blk;
@@ -103,8 +158,264 @@ private:
   
   // Ordering 
 	bool m_is_ordering;  
+  bool m_is_nd;      // the ordering is made by the nested dissection
+  bool m_is_single;  // factors in single precision
+  bool m_is_compact; // pattern of the factors in 16bit offsets
   MatVec::COrdering_Blk m_order;
   MatVec::CVector_Blk m_vec;  // I[_O̎ɎgTMPs
+  MatVec::CMultiVector_Blk m_mvec;  // TMP multi vector for the ordering in SolvePrecond_Batch
+
+  // pattern versions of the matrices of the linear system the fill pattern was made for (empty if no pattern)
+  std::vector<unsigned int> m_aPatternVersion;
+  double m_time_symbolic, m_time_numeric;
+  unsigned int m_nsymbolic, m_nnumeric;
+};
+
+/*! 
+@brief smoothed aggregation AMG preconditioner (MatVec::CSolverMG_SA)
+@ingroup LsSol
+
+Only for the linear system with one segment of fixed block length.
+The near null space is the rigid body modes if the coordinates of the blocks are given, 
+and the constant vector for each dof otherwise.
+*/
+class CPreconditioner_AMG : public CPreconditioner
+{
+public:
+	CPreconditioner_AMG(){
+    m_pMG = 0; m_iver_ptn = 0; m_ndim = 0; m_ncycle = 1; m_npre = 1; m_npos = 1;
+	}
+	CPreconditioner_AMG(const CLinearSystem& ls){
+    m_pMG = 0; m_iver_ptn = 0; m_ndim = 0; m_ncycle = 1; m_npre = 1; m_npos = 1;
+		this->SetLinearSystem(ls);
+	}
+	virtual ~CPreconditioner_AMG(){
+		this->Clear();
+	}
+	//! delete the hierarchy
+	void Clear(){
+    if( m_pMG != 0 ){ delete m_pMG; m_pMG = 0; }
+  }
+  //! set the coordinates of the blocks (aCoord[iblk*ndim+idim]) to make the rigid body modes
+  void SetCoord(unsigned int ndim, const std::vector<double>& aCoord){
+    m_ndim = ndim; m_aCoord = aCoord;
+    this->Clear();
+  }
+  //! 1:V-cycle 2:W-cycle
+  void SetCycleType(unsigned int ncycle){ 
+    m_ncycle = ncycle; 
+    if( m_pMG != 0 ){ m_pMG->SetCycleType(ncycle); }
+  }
+  void SetSmoothingNumberOfTimes(unsigned int npre, unsigned int npos){
+    m_npre = npre; m_npos = npos;
+    if( m_pMG != 0 ){ m_pMG->SetSmoothingNumberOfTimes(npre,npos); }
+  }
+  //! number of the levels of the hierarchy (0 before SetValue)
+  unsigned int NLevel() const { return ( m_pMG == 0 ) ? 0 : m_pMG->NLevel(); }
+
+	virtual void SetLinearSystem(const CLinearSystem& ls);
+	// make the hierarchy from the value of the matrix
+  // (if the pattern is not changed since the last call, the aggregates and the prolongation are kept. Call Clear to make them again)
+	virtual bool SetValue(const CLinearSystem& ls);
+	virtual bool SolvePrecond(CLinearSystem& ls, unsigned int iv);
+private:
+  MatVec::CSolverMG_SA* m_pMG;
+  unsigned int m_iver_ptn;  // pattern version of the matrix the hierarchy was made for
+  unsigned int m_ndim;
+  std::vector<double> m_aCoord;
+  unsigned int m_ncycle, m_npre, m_npos;
+};
+
+
+/*! 
+@brief sparse direct (supernodal LDL^T) preconditioner (MatVec::CMatDiaFrac_Supernode)
+@ingroup LsSol
+
+The matrix is assumed to be symmetric (only the lower triangle is used) and every segment must have fixed block length.
+The pattern is factorized symbolically once in SetLinearSystem (and kept while the crs pattern is unchanged), 
+and SetValue does the numerical factorization, so the factor can be used for many right hand sides.
+The blocks of each segment are ordered by MatVec::COrdering_Blk::MakeOrdering_AMD (or MakeOrdering_ND by SetNestedDissection).
+The independent subtrees of the factor are done in parallel (see MatVec::CMatDiaFrac_Supernode).
+*/
+class CPreconditioner_LDLT : public CPreconditioner
+{
+public:
+	CPreconditioner_LDLT(){ m_is_nd = false; }
+	CPreconditioner_LDLT(const CLinearSystem& ls){
+		m_is_nd = false;
+		this->SetLinearSystem(ls);
+	}
+	virtual ~CPreconditioner_LDLT(){
+		this->Clear();
+	}
+	//! delete the factor
+	void Clear(){
+    m_Frac.Clear();
+    m_aPatternVersion.clear();
+    m_aOffset.clear();
+  }
+  //! number of the entries of the factor
+  unsigned int NNonZeroFactor() const { return m_Frac.NNonZeroFactor(); }
+  //! number of the independent subtrees of the factor (factorized and substituted in parallel)
+  unsigned int NSubtree() const { return m_Frac.NSubtree(); }
+  //! use the nested dissection ordering instead of AMD (less fill for large 3D meshes). The factor is made again at next SetLinearSystem
+  void SetNestedDissection(bool is_nd){
+    if( m_is_nd == is_nd ) return;
+    m_is_nd = is_nd;
+    this->Clear();
+  }
+
+	// ordering and symbolic factorization
+	virtual void SetLinearSystem(const CLinearSystem& ls);
+	// numerical factorization
+	virtual bool SetValue(const CLinearSystem& ls);
+	virtual bool SolvePrecond(CLinearSystem& ls, unsigned int iv);
+private:
+  bool m_is_nd;
+  MatVec::CMatDiaFrac_Supernode m_Frac;
+  std::vector<unsigned int> m_aOffset;  // first dof of each segment
+  std::vector<unsigned int> m_aPatternVersion;
+  std::vector<double> m_aVal;
+  std::vector<double> m_aTmp;
+};
+
+
+/*! 
+@brief block Jacobi preconditioner (inverse of the diagonal blocks by MatVec::CMatDiaInv_BlkDia)
+@ingroup LsSol
+
+The coupling between the blocks and between the segments is not used, so every block is preconditioned in parallel.
+Every segment must have fixed block length.
+*/
+class CPreconditioner_BlockJacobi : public CPreconditioner
+{
+public:
+	CPreconditioner_BlockJacobi(){}
+	CPreconditioner_BlockJacobi(const CLinearSystem& ls){
+		this->SetLinearSystem(ls);
+	}
+	virtual ~CPreconditioner_BlockJacobi(){
+		this->Clear();
+	}
+	void Clear();
+
+	virtual void SetLinearSystem(const CLinearSystem& ls);
+	// invert the diagonal blocks
+	virtual bool SetValue(const CLinearSystem& ls);
+	virtual bool SolvePrecond(CLinearSystem& ls, unsigned int iv);
+
+	//! {y} := [D]^-1{x} for the vectors given by the segments (x must not be y)
+	void MultInvDia(const std::vector<MatVec::CVector_Blk*>& x, std::vector<MatVec::CVector_Blk*>& y) const;
+	//! inverse of the diagonal blocks of each segment
+	const std::vector<MatVec::CMatDiaInv_BlkDia*>& GetInvDia() const { return m_aInvDia; }
+private:
+	std::vector<MatVec::CMatDiaInv_BlkDia*> m_aInvDia;
+	std::vector<MatVec::CVector_Blk*> m_aTmp;
+};
+
+class ILinearOperator_Seg;
+
+/*!
+@brief ndeg steps of the Chebyshev iteration for [A]{x}={r} with [D] started from {x}=0, {r} is overwritten by {x}
+@param[in] eig_max largest eigen value of [D]^-1[A], the polynomial is for the eigen values in [eig_max/ratio,eig_max]
+@param[in] aX,aD,aW,aZ working vectors of the same size as aR
+*/
+void SolvePrecond_Chebyshev(ILinearOperator_Seg& op, unsigned int ndeg, double eig_max, double ratio,
+	std::vector<MatVec::CVector_Blk*>& aR,
+	std::vector<MatVec::CVector_Blk*>& aX, std::vector<MatVec::CVector_Blk*>& aD, 
+	std::vector<MatVec::CVector_Blk*>& aW, std::vector<MatVec::CVector_Blk*>& aZ);
+
+/*! 
+@brief Chebyshev polynomial of the block Jacobi preconditioner
+@ingroup LsSol
+
+SolvePrecond is ndeg steps of the Chebyshev iteration for [A]{x}={r} with the block Jacobi [D] started from {x}=0,
+for the eigen values of [D]^-1[A] in [lambda_max/ratio,lambda_max].
+It is a fixed polynomial of [D]^-1[A] times [D]^-1, so it is symmetric positive definite and can be used in PCG.
+Only the matrix vector product, [D]^-1 and the vector operations are used, so every step is parallel.
+lambda_max is estimated by LsSol::MaximumEigenValue_Lanczos in SetValue. The degree 1 is the block Jacobi.
+*/
+class CPreconditioner_Chebyshev : public CPreconditioner
+{
+public:
+	CPreconditioner_Chebyshev(){
+		m_ndeg = 3; m_ratio = 30.0; m_nlanczos = 15; m_max_eigen = 0.0;
+	}
+	CPreconditioner_Chebyshev(const CLinearSystem& ls, unsigned int ndeg = 3){
+		m_ndeg = ( ndeg == 0 ) ? 1 : ndeg; m_ratio = 30.0; m_nlanczos = 15; m_max_eigen = 0.0;
+		this->SetLinearSystem(ls);
+	}
+	virtual ~CPreconditioner_Chebyshev(){
+		this->Clear();
+	}
+	void Clear();
+
+	//! degree of the polynomial (matrix vector products per preconditioning)
+	void SetDegree(unsigned int ndeg){ m_ndeg = ( ndeg == 0 ) ? 1 : ndeg; }
+	//! the interval of the eigen values is [lambda_max/ratio,lambda_max]
+	void SetEigenRatio(double ratio){ m_ratio = ratio; }
+	//! number of the Lanczos iterations for lambda_max
+	void SetLanczosIteration(unsigned int nlanczos){ m_nlanczos = nlanczos; }
+	//! lambda_max of [D]^-1[A] used in the polynomial (estimated in SetValue)
+	double GetMaxEigen() const { return m_max_eigen; }
+
+	virtual void SetLinearSystem(const CLinearSystem& ls);
+	// block Jacobi and lambda_max
+	virtual bool SetValue(const CLinearSystem& ls);
+	virtual bool SolvePrecond(CLinearSystem& ls, unsigned int iv);
+private:
+	unsigned int m_ndeg;
+	double m_ratio;
+	unsigned int m_nlanczos;
+	double m_max_eigen;
+	CPreconditioner_BlockJacobi m_Jacobi;
+	std::vector<MatVec::CVector_Blk*> m_aX, m_aD, m_aW, m_aZ;	// working vectors
+};
+
+/*! 
+@brief Neumann series of the block Jacobi preconditioner
+@ingroup LsSol
+
+SolvePrecond is {x} = omega*sum_{k=0}^{ndeg-1} ([I]-omega*[D]^-1[A])^k [D]^-1{r}, 
+computed as ndeg steps of the damped block Jacobi iteration started from {x}=0.
+It is symmetric positive definite for 0 < omega < 2/lambda_max and can be used in PCG.
+Only the matrix vector product, [D]^-1 and the vector operations are used, so every step is parallel.
+If omega is not given, omega = 1.6/lambda_max with lambda_max estimated by LsSol::MaximumEigenValue_Lanczos in SetValue.
+*/
+class CPreconditioner_Neumann : public CPreconditioner
+{
+public:
+	CPreconditioner_Neumann(){
+		m_ndeg = 3; m_omega_input = 0.0; m_omega = 1.0; m_nlanczos = 15;
+	}
+	CPreconditioner_Neumann(const CLinearSystem& ls, unsigned int ndeg = 3){
+		m_ndeg = ( ndeg == 0 ) ? 1 : ndeg; m_omega_input = 0.0; m_omega = 1.0; m_nlanczos = 15;
+		this->SetLinearSystem(ls);
+	}
+	virtual ~CPreconditioner_Neumann(){
+		this->Clear();
+	}
+	void Clear();
+
+	//! number of the terms of the series (matrix vector products per preconditioning is ndeg-1)
+	void SetDegree(unsigned int ndeg){ m_ndeg = ( ndeg == 0 ) ? 1 : ndeg; }
+	//! damping factor of the series (omega <= 0 : 1.6/lambda_max estimated in SetValue)
+	void SetRelaxation(double omega){ m_omega_input = omega; if( omega > 0 ){ m_omega = omega; } }
+	//! number of the Lanczos iterations for lambda_max
+	void SetLanczosIteration(unsigned int nlanczos){ m_nlanczos = nlanczos; }
+	//! damping factor used in the series
+	double GetRelaxation() const { return m_omega; }
+
+	virtual void SetLinearSystem(const CLinearSystem& ls);
+	// block Jacobi and the damping factor
+	virtual bool SetValue(const CLinearSystem& ls);
+	virtual bool SolvePrecond(CLinearSystem& ls, unsigned int iv);
+private:
+	unsigned int m_ndeg;
+	double m_omega_input, m_omega;
+	unsigned int m_nlanczos;
+	CPreconditioner_BlockJacobi m_Jacobi;
+	std::vector<MatVec::CVector_Blk*> m_aX, m_aW, m_aZ;	// working vectors
 };
 
 
@@ -137,6 +448,13 @@ public:
     virtual bool AXPY(double alpha, int iv1, int iv2){ return ls.AXPY(alpha,iv1,iv2); }
     //! sxNg ({v2} := alpha*[MATRIX]*{v1} + beta*{v2})
     virtual bool MATVEC(double alpha, int iv1, double beta, int iv2){ return ls.MATVEC(alpha, iv1, beta, iv2); }
+    //! fused operations
+    virtual bool AXPBY(double alpha, int iv1, double beta, int iv2){ return ls.AXPBY(alpha,iv1,beta,iv2); }
+    virtual double AXPY_DOT(double alpha, int iv1, int iv2){ return ls.AXPY_DOT(alpha,iv1,iv2); }
+    virtual double MATVEC_DOT(double alpha, int iv1, double beta, int iv2){ return ls.MATVEC_DOT(alpha,iv1,beta,iv2); }
+    virtual void DOTS(unsigned int ndot, const int* aiv1, const int* aiv2, double* adot){ ls.DOTS(ndot,aiv1,aiv2,adot); }
+    virtual bool MATVEC_MULTI(unsigned int nvec, double alpha, const int* aiv1, double beta, const int* aiv2){ return ls.MATVEC_MULTI(nvec,alpha,aiv1,beta,aiv2); }
+    virtual bool AXPY_MULTI(unsigned int nvec, const double* aalpha, const int* aiv1, int iv2){ return ls.AXPY_MULTI(nvec,aalpha,aiv1,iv2); }
 
     virtual bool SolvePrecond(int iv){ return prec.SolvePrecond(ls,iv); }
 private:
@@ -24,9 +24,14 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #if !defined(SOLVER_LS_ITER_H)
 #define SOLVER_LS_ITER_H
 
+#include <vector>
+
 #include "delfem/ls/linearsystem_interface_solver.h"
 
 namespace LsSol{
+
+class CLinearSystem;
+class CPreconditioner_ILU;
 /*! 
 @addtogroup LsSol
 */
@@ -34,15 +39,163 @@ namespace LsSol{
 //! conjuaget gradient method
 bool Solve_CG(double& conv_ratio, unsigned int& num_iter, 
 		ILinearSystem_Sol& ls);
-//! preconditioned conjugate gradient method
+/*!
+@brief preconditioned conjugate gradient method
+@param[in] is_refine check the true residual {b}-[A]{x} at the convergence and restart from it if it is not converged
+(iterative refinement for the preconditioner in single precision, see CPreconditioner_ILU::SetSinglePrecision). 
+It needs one more work vector and one more MATVEC at the convergence.
+*/
 bool Solve_PCG(double& conv_ratio,unsigned int& iteration, 
-		ILinearSystemPreconditioner_Sol& lsp);
+		ILinearSystemPreconditioner_Sol& lsp, bool is_refine = false);
 //! BiCGSTAB method
 bool Solve_BiCGSTAB(double& conv_ratio, unsigned int& num_iter, 
         ILinearSystem_Sol& ls);
 //! preconditioned BiCGSTAB method
 bool Solve_PBiCGSTAB(double& conv_ratio, unsigned int& num_iter, 
 		ILinearSystemPreconditioner_Sol& ls);
+/*! 
+@brief pipelined preconditioned conjugate gradient method
+The dot products of an iteration are taken in one reduction (ILinearSystemPreconditioner_Sol::DOTS).
+The reduction is blocking, so it is not overlapped with the preconditioner and the matrix vector product yet.
+The rounding error grows a little faster than Solve_PCG, and it needs 8 work vectors.
+The residual updated by the recurrence stagnates earlier (about 1e-9 relative in the 2D elastic problem of test_bench/ls_check), 
+so the convergence ratio should be larger than that.
+*/
+bool Solve_PCG_Pipelined(double& conv_ratio, unsigned int& iteration, 
+		ILinearSystemPreconditioner_Sol& lsp);
+
+/*!
+@brief restarted GMRES(m) method with the right preconditioning
+The residual norm of the iteration is that of the original system, and the true residual is made at each restart.
+The Arnoldi vectors are orthogonalized by the classical Gram-Schmidt (DOTS and AXPY_MULTI for all the vectors at once),
+done twice only when the norm drops much. It needs nrestart+3 work vectors.
+@param[in,out] iteration max iteration (in), total iteration of all the cycles (out)
+@param[in] nrestart dimension of the Krylov subspace before restart
+*/
+bool Solve_PGMRES(double& conv_ratio, unsigned int& iteration, 
+		ILinearSystemPreconditioner_Sol& lsp, unsigned int nrestart = 30);
+/*!
+@brief restarted flexible GMRES method (preconditioner may change in every iteration)
+Same as Solve_PGMRES but the preconditioned vectors are kept, so that the preconditioner can be a variable one
+(an inner iteration or a multigrid cycle). It needs 2*nrestart+2 work vectors.
+*/
+bool Solve_PFGMRES(double& conv_ratio, unsigned int& iteration, 
+		ILinearSystemPreconditioner_Sol& lsp, unsigned int nrestart = 30);
+
+/*!
+@brief preconditioned conjugate gradient method for all the right hand sides of the batch (CLinearSystem::SetBatch)
+Each column iterates with its own scalars, while the matrix product and the ILU substitution are done for all the columns at once.
+@param[in,out] conv_ratio tolerance (in), the largest convergence ratio of the columns (out)
+@param[in,out] iteration max iteration (in), the iteration when all the columns have converged (out)
+*/
+bool Solve_PCG_Batch(double& conv_ratio, unsigned int& iteration, 
+		CLinearSystem& ls, CPreconditioner_ILU& precond);
+//! preconditioned BiCGSTAB method for all the right hand sides of the batch (same as Solve_PCG_Batch)
+bool Solve_PBiCGSTAB_Batch(double& conv_ratio, unsigned int& iteration, 
+		CLinearSystem& ls, CPreconditioner_ILU& precond);
+//@}
+
+/*!
+@brief vectors kept between the solves of the linear systems that change slowly (time steps, Newton iterations)
+@ingroup LsSol
+
+The last nsol solutions are kept for the warm start, and ndefl approximate eigen vectors of the smallest eigen values 
+for the deflation of Solve_PCG_Recycle. The eigen vectors are the Ritz vectors of the span of the deflation vectors 
+and the first nharvest search directions of the last solve.
+The vectors are kept in the tmp vectors of the linear system from the index GetIdVecBase() (8 or more, or after the work vectors of GMRES, so the other solvers do not use them),
+so call Clear when the linear system is made again.
+The iterations of every solve are recorded, and the saving is counted from the last solve without the kept vectors.
+*/
+class CKrylovRecycle
+{
+public:
+	CKrylovRecycle(unsigned int ndefl = 6, unsigned int nsol = 3, unsigned int nharvest = 12){
+		m_iv0 = -1;
+		this->SetSize(ndefl,nsol,nharvest);
+	}
+	//! forget the kept vectors (the statistics remain)
+	void Clear(){ m_iv0 = -1; m_nw = 0; m_aIdSol.clear(); }
+	//! set the numbers of the deflation vectors, the solutions and the search directions to make the deflation vectors
+	void SetSize(unsigned int ndefl, unsigned int nsol, unsigned int nharvest){
+		this->Clear();
+		m_ndefl = ndefl;
+		m_nsol = nsol;
+		m_nharv = ( nharvest < nsol+1 ) ? nsol+1 : nharvest;
+	}
+	//! index of the first tmp vector used for the kept vectors (-1 before the first solve)
+	int GetIdVecBase() const { return m_iv0; }
+
+	////////////////
+	// statistics
+
+	void ClearStatistics(){ m_aStat.clear(); }
+	unsigned int NSolve() const { return m_aStat.size(); }
+	//! iterations of the isolve-th solve
+	unsigned int GetIteration(unsigned int isolve) const { return m_aStat[isolve].niter; }
+	//! relative residual after the warm start of the isolve-th solve
+	double GetWarmStartResidual(unsigned int isolve) const { return m_aStat[isolve].res_warm; }
+	//! iterations saved in the isolve-th solve compared with the last solve from zero
+	int GetIterationSaving(unsigned int isolve) const;
+	//! print the iterations and the savings of every solve
+	void PrintStatistics() const;
+private:
+	friend bool Solve_PCG_Recycle(double&, unsigned int&, ILinearSystemPreconditioner_Sol&, CKrylovRecycle&);
+	friend bool Solve_PBiCGSTAB_Recycle(double&, unsigned int&, ILinearSystemPreconditioner_Sol&, CKrylovRecycle&);
+	friend bool Solve_PGMRES_Recycle(double&, unsigned int&, ILinearSystemPreconditioner_Sol&, CKrylovRecycle&, unsigned int);
+	// make the tmp vectors of the linear system for the kept vectors after the nvec_solver work vectors of the solver
+	void Allocate(ILinearSystemPreconditioner_Sol& ls, unsigned int nvec_solver = 8);
+	// warm start from the kept solutions and PBiCGSTAB (nrestart=0) or PGMRES for the correction
+	bool SolveAsym(double& conv_ratio, unsigned int& iteration, ILinearSystemPreconditioner_Sol& ls, unsigned int nrestart);
+	int IdW( unsigned int i) const { return m_iv0+i; }
+	int IdAW(unsigned int i) const { return m_iv0+m_ndefl+i; }
+	int IdS( unsigned int i) const { return m_iv0+2*m_ndefl+i; }
+	int IdP( unsigned int i) const { return m_iv0+2*m_ndefl+m_nsol+i; }
+	// keep the update (iv=-2) as the newest solution
+	void PushSolution(ILinearSystemPreconditioner_Sol& ls);
+	// make the deflation vectors from the current ones ([W]^T[A][W] is e) and the search directions kept in IdP (p^T[A]p is aPAP)
+	void UpdateDeflation(ILinearSystemPreconditioner_Sol& ls, const std::vector<double>& e, const std::vector<double>& aPAP);
+	void PushStatistics(unsigned int niter, double res_warm, bool is_cold);
+private:
+	class CStat{
+	public:
+		unsigned int niter;
+		double res_warm;
+		bool is_cold;
+	};
+	int m_iv0;
+	unsigned int m_ndefl, m_nsol, m_nharv;
+	unsigned int m_nw;	// number of the deflation vectors kept
+	std::vector<int> m_aIdSol;	// tmp vectors of the kept solutions (newest first)
+	std::vector<CStat> m_aStat;
+};
+
+/*! 
+@addtogroup LsSol
+*/
+//@{
+/*!
+@brief deflated preconditioned conjugate gradient method with the vectors kept from the previous solves
+The initial solution is the Galerkin projection to the span of the deflation vectors and the previous solutions,
+then the search directions are kept [A]-orthogonal to the deflation vectors.
+@param[in,out] conv_ratio tolerance (in), convergence ratio to the norm of the right hand side (out)
+@param[in,out] iteration max iteration (in), iteration (out)
+*/
+bool Solve_PCG_Recycle(double& conv_ratio, unsigned int& iteration, 
+		ILinearSystemPreconditioner_Sol& lsp, CKrylovRecycle& rec);
+/*!
+@brief preconditioned BiCGSTAB method started from the minimum residual in the span of the previous solutions
+Only the solutions are used from rec (no deflation), the parameters are same as Solve_PCG_Recycle.
+*/
+bool Solve_PBiCGSTAB_Recycle(double& conv_ratio, unsigned int& iteration, 
+		ILinearSystemPreconditioner_Sol& lsp, CKrylovRecycle& rec);
+/*!
+@brief restarted GMRES(m) method started from the minimum residual in the span of the previous solutions
+Like Solve_PBiCGSTAB_Recycle only the solutions are used from rec. The deflation of GMRES (GCRO-DR, which keeps 
+[A][U] orthonormal and orthogonalizes every Arnoldi vector to it) is not done, so the eigen vectors of rec are not used.
+@param[in] nrestart dimension of the Krylov subspace before restart (see Solve_PGMRES)
+*/
+bool Solve_PGMRES_Recycle(double& conv_ratio, unsigned int& iteration, 
+		ILinearSystemPreconditioner_Sol& lsp, CKrylovRecycle& rec, unsigned int nrestart = 30);
 //@}
 }
 
@@ -25,7 +25,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #if !defined(DIAMAT_BLK_H)
 #define DIAMAT_BLK_H
 
-#ifndef for 
+#if !defined(for) && !defined(_OPENMP)
 #define for if(0); else for
 #endif
 
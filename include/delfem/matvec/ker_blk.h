@@ -0,0 +1,150 @@
+/*
+DelFEM (Finite Element Analysis)
+Copyright (C) 2009  Nobuyuki Umetani    n.umetani@gmail.com
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+/*! @file
+@brief small dense block kernels whose size is fixed at compile time
+@author Nobuyuki Umetani
+
+The block length N is a template parameter so that the compiler can unroll the loops
+and keep the block in registers (and vectorize it where the target supports it).
+Blocks are stored row major, i.e. a[i*N+j].
+The kernels used by the substitution take the block [a] either in double or in float
+(the factor stored in single precision), the vectors and the sums are always double.
+*/
+
+#if !defined(KER_BLK_H)
+#define KER_BLK_H
+
+namespace MatVec{
+namespace Ker{
+
+//! {y} *= beta
+template<unsigned int N>
+inline void ScaleVec(double* y, const double beta){
+  for(unsigned int i=0;i<N;i++){ y[i] *= beta; }
+}
+
+//! {y} += alpha*[a]{x}
+template<unsigned int N>
+inline void AddMatVec(double* y, const double alpha, const double* a, const double* x){
+  for(unsigned int i=0;i<N;i++){
+    double d = 0.0;
+    for(unsigned int j=0;j<N;j++){ d += a[i*N+j]*x[j]; }
+    y[i] += alpha*d;
+  }
+}
+
+//! {y} -= [a]{x}
+template<unsigned int N, typename REAL>
+inline void SubMatVec(double* y, const REAL* a, const double* x){
+  for(unsigned int i=0;i<N;i++){
+    double d = 0.0;
+    for(unsigned int j=0;j<N;j++){ d += a[i*N+j]*x[j]; }
+    y[i] -= d;
+  }
+}
+
+//! {y} = [a]{x}
+template<unsigned int N, typename REAL>
+inline void SetMatVec(double* y, const REAL* a, const double* x){
+  for(unsigned int i=0;i<N;i++){
+    double d = 0.0;
+    for(unsigned int j=0;j<N;j++){ d += a[i*N+j]*x[j]; }
+    y[i] = d;
+  }
+}
+
+//! [c] -= [a][b]
+template<unsigned int N>
+inline void SubMatMat(double* c, const double* a, const double* b){
+  for(unsigned int i=0;i<N;i++){
+    for(unsigned int j=0;j<N;j++){
+      double d = 0.0;
+      for(unsigned int k=0;k<N;k++){ d += a[i*N+k]*b[k*N+j]; }
+      c[i*N+j] -= d;
+    }
+  }
+}
+
+//! [b] = [a][b]
+template<unsigned int N>
+inline void MulMatLeft(double* b, const double* a){
+  double t[N*N];
+  for(unsigned int i=0;i<N*N;i++){ t[i] = b[i]; }
+  for(unsigned int i=0;i<N;i++){
+    for(unsigned int j=0;j<N;j++){
+      double d = 0.0;
+      for(unsigned int k=0;k<N;k++){ d += a[i*N+k]*t[k*N+j]; }
+      b[i*N+j] = d;
+    }
+  }
+}
+
+//! [out] += [in] (N*N values)
+template<unsigned int N>
+inline void AddBlk(double* out, const double* in){
+  for(unsigned int i=0;i<N*N;i++){ out[i] += in[i]; }
+}
+
+////////////////////////////////
+// kernels on ncol columns at once (see CMultiVector_Blk), [x] and [y] are N*ncol row major
+
+//! [y] *= beta
+template<unsigned int N>
+inline void ScaleMultiVec(double* y, const double beta, const unsigned int ncol){
+  for(unsigned int i=0;i<N*ncol;i++){ y[i] *= beta; }
+}
+
+//! [y] += alpha*[a][x]
+template<unsigned int N, typename REAL>
+inline void AddMatMultiVec(double* y, const double alpha, const REAL* a, const double* x, const unsigned int ncol){
+  for(unsigned int i=0;i<N;i++){
+    double* yi = y+i*ncol;
+    for(unsigned int j=0;j<N;j++){
+      const double aij = alpha*a[i*N+j];
+      const double* xj = x+j*ncol;
+      for(unsigned int k=0;k<ncol;k++){ yi[k] += aij*xj[k]; }
+    }
+  }
+}
+
+//! [y] -= [a][x]
+template<unsigned int N, typename REAL>
+inline void SubMatMultiVec(double* y, const REAL* a, const double* x, const unsigned int ncol){
+  for(unsigned int i=0;i<N;i++){
+    double* yi = y+i*ncol;
+    for(unsigned int j=0;j<N;j++){
+      const double aij = a[i*N+j];
+      const double* xj = x+j*ncol;
+      for(unsigned int k=0;k<ncol;k++){ yi[k] -= aij*xj[k]; }
+    }
+  }
+}
+
+//! [y] = [a][x]
+template<unsigned int N, typename REAL>
+inline void SetMatMultiVec(double* y, const REAL* a, const double* x, const unsigned int ncol){
+  for(unsigned int i=0;i<N*ncol;i++){ y[i] = 0.0; }
+  AddMatMultiVec<N>(y,1.0,a,x,ncol);
+}
+
+}
+}
+
+#endif
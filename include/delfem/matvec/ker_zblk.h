@@ -0,0 +1,182 @@
+/*
+DelFEM (Finite Element Analysis)
+Copyright (C) 2009  Nobuyuki Umetani    n.umetani@gmail.com
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+/*! @file
+@brief complex kernels on interleaved real/imaginary storage
+@author Nobuyuki Umetani
+
+Com::Complex is two doubles (real,imag), so an array of Com::Complex is read here as
+a double array z[2*i]=real, z[2*i+1]=imag (see ZPtr).
+The loops keep the real and the imaginary parts in separate accumulators and take
+two entries at a time, so that the compiler can vectorize them without reordering the sums.
+*/
+
+#if !defined(KER_ZBLK_H)
+#define KER_ZBLK_H
+
+#include "delfem/complex.h"
+
+namespace MatVec{
+namespace Ker{
+
+//! interleaved view of a complex array
+inline double* ZPtr(Com::Complex* z){ return reinterpret_cast<double*>(z); }
+inline const double* ZPtr(const Com::Complex* z){ return reinterpret_cast<const double*>(z); }
+
+//! d = sum x[i]*y[i] (non-conjugate)
+inline void ZDot(unsigned int n, const double* x, const double* y, double d[2]){
+  double r0=0, r1=0, i0=0, i1=0;
+  unsigned int k=0;
+  for(;k+1<n;k+=2){
+    const double* x0 = x+k*2;
+    const double* y0 = y+k*2;
+    r0 += x0[0]*y0[0] - x0[1]*y0[1];
+    i0 += x0[0]*y0[1] + x0[1]*y0[0];
+    r1 += x0[2]*y0[2] - x0[3]*y0[3];
+    i1 += x0[2]*y0[3] + x0[3]*y0[2];
+  }
+  if( k<n ){
+    r0 += x[k*2]*y[k*2]   - x[k*2+1]*y[k*2+1];
+    i0 += x[k*2]*y[k*2+1] + x[k*2+1]*y[k*2];
+  }
+  d[0] = r0+r1;
+  d[1] = i0+i1;
+}
+
+//! d = sum conj(x[i])*y[i]
+inline void ZDotConj(unsigned int n, const double* x, const double* y, double d[2]){
+  double r0=0, r1=0, i0=0, i1=0;
+  unsigned int k=0;
+  for(;k+1<n;k+=2){
+    const double* x0 = x+k*2;
+    const double* y0 = y+k*2;
+    r0 += x0[0]*y0[0] + x0[1]*y0[1];
+    i0 += x0[0]*y0[1] - x0[1]*y0[0];
+    r1 += x0[2]*y0[2] + x0[3]*y0[3];
+    i1 += x0[2]*y0[3] - x0[3]*y0[2];
+  }
+  if( k<n ){
+    r0 += x[k*2]*y[k*2]   + x[k*2+1]*y[k*2+1];
+    i0 += x[k*2]*y[k*2+1] - x[k*2+1]*y[k*2];
+  }
+  d[0] = r0+r1;
+  d[1] = i0+i1;
+}
+
+//! sum |x[i]|^2
+inline double ZSqNorm(unsigned int n, const double* x){
+  double d0=0, d1=0;
+  for(unsigned int k=0;k<n;k++){
+    d0 += x[k*2]*x[k*2];
+    d1 += x[k*2+1]*x[k*2+1];
+  }
+  return d0+d1;
+}
+
+//! {y} += (ar+i*ai)*{x}
+inline void ZAxpy(unsigned int n, const double ar, const double ai, const double* x, double* y){
+  for(unsigned int k=0;k<n;k++){
+    const double xr = x[k*2], xi = x[k*2+1];
+    y[k*2]   += ar*xr - ai*xi;
+    y[k*2+1] += ar*xi + ai*xr;
+  }
+}
+
+//! {y} *= (ar+i*ai)
+inline void ZScale(unsigned int n, const double ar, const double ai, double* y){
+  for(unsigned int k=0;k<n;k++){
+    const double yr = y[k*2], yi = y[k*2+1];
+    y[k*2]   = ar*yr - ai*yi;
+    y[k*2+1] = ar*yi + ai*yr;
+  }
+}
+
+//! d = sum a[k]*x[ind[k]] (gather of a sparse row with the block length 1)
+inline void ZRowDot(unsigned int n, const double* a, const unsigned int* ind, const double* x, double d[2]){
+  double r0=0, r1=0, i0=0, i1=0;
+  unsigned int k=0;
+  for(;k+1<n;k+=2){
+    const double* x0 = x+ind[k  ]*2;
+    const double* x1 = x+ind[k+1]*2;
+    const double* a0 = a+k*2;
+    r0 += a0[0]*x0[0] - a0[1]*x0[1];
+    i0 += a0[0]*x0[1] + a0[1]*x0[0];
+    r1 += a0[2]*x1[0] - a0[3]*x1[1];
+    i1 += a0[2]*x1[1] + a0[3]*x1[0];
+  }
+  if( k<n ){
+    const double* x0 = x+ind[k]*2;
+    r0 += a[k*2]*x0[0] - a[k*2+1]*x0[1];
+    i0 += a[k*2]*x0[1] + a[k*2+1]*x0[0];
+  }
+  d[0] = r0+r1;
+  d[1] = i0+i1;
+}
+
+//! d = sum a[k]*x[ind[k]] with the real coefficient a (block length 1)
+inline void ZRowDotReal(unsigned int n, const double* a, const unsigned int* ind, const double* x, double d[2]){
+  double r0=0, r1=0, i0=0, i1=0;
+  unsigned int k=0;
+  for(;k+1<n;k+=2){
+    const double* x0 = x+ind[k  ]*2;
+    const double* x1 = x+ind[k+1]*2;
+    r0 += a[k  ]*x0[0];  i0 += a[k  ]*x0[1];
+    r1 += a[k+1]*x1[0];  i1 += a[k+1]*x1[1];
+  }
+  if( k<n ){
+    const double* x0 = x+ind[k]*2;
+    r0 += a[k]*x0[0];  i0 += a[k]*x0[1];
+  }
+  d[0] = r0+r1;
+  d[1] = i0+i1;
+}
+
+//! {y} += alpha*[a]{x}  ([a] is N*N complex, row major)
+template<unsigned int N>
+inline void ZAddMatVec(double* y, const double alpha, const double* a, const double* x){
+  for(unsigned int i=0;i<N;i++){
+    double dr = 0.0, di = 0.0;
+    for(unsigned int j=0;j<N;j++){
+      const double* aij = a+(i*N+j)*2;
+      dr += aij[0]*x[j*2]   - aij[1]*x[j*2+1];
+      di += aij[0]*x[j*2+1] + aij[1]*x[j*2];
+    }
+    y[i*2]   += alpha*dr;
+    y[i*2+1] += alpha*di;
+  }
+}
+
+//! {y} += alpha*[a]{x} with the real matrix [a] (N*N, row major)
+template<unsigned int N>
+inline void ZAddRealMatVec(double* y, const double alpha, const double* a, const double* x){
+  for(unsigned int i=0;i<N;i++){
+    double dr = 0.0, di = 0.0;
+    for(unsigned int j=0;j<N;j++){
+      dr += a[i*N+j]*x[j*2];
+      di += a[i*N+j]*x[j*2+1];
+    }
+    y[i*2]   += alpha*dr;
+    y[i*2+1] += alpha*di;
+  }
+}
+
+}
+}
+
+#endif
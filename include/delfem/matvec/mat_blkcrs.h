@@ -26,7 +26,9 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #define MAT_BLK_CRS_H
 
 #include <assert.h>
+#include <cstddef>
 #include <vector>
+#include <map>
 
 namespace Com{
     class CIndexedArray;
@@ -35,6 +37,7 @@ namespace Com{
 namespace MatVec{
 
 class CVector_Blk;
+class CMultiVector_Blk;
 class COrdering_Blk;
 class CBCFlag;
 
@@ -127,13 +130,53 @@ public:
    unsigned int blksize, const double* emat);
   //! Ɨpz̗̈
   void DeleteMargeTmpBuffer(){
+    m_nthread_marge = 0;
     if( m_marge_tmp_buffer == 0 ) return;
     delete[]  m_marge_tmp_buffer;
     m_marge_tmp_buffer = 0;
   }
+  /*!
+  @brief allocate one merge buffer for each thread (Com::GetNumThread)
+  Call this before Mearge is called from inside a parallel region. Threads may merge at 
+  the same time only if their elements do not share a block (see CElemAry::MakeColoring)
+  */
+  void MakeMargeTmpBuffer();
+  /*!
+  @brief version of the pattern, renewed whenever the pattern is changed
+  The versions are counted for all the matrices together, so a matrix made later never has the version of an other matrix
+  */
+  unsigned int GetPatternVersion() const { return m_iver_ptn; }
+
+  /*!
+  @brief make the table of the CRS positions where the element matrices are merged (see MeargeTable)
+  @param[in] id_table ID of the table given by the caller (e.g. ID of the element array)
+  @param[in] id_es ID of the element segment the blocks of the elements are taken from
+  @param[in] iver_conn version of the connectivity of the element array (CElemAry::GetConnVersion)
+  @param[in] lnods_col blocks of the ielem-th element are lnods_col[ielem*nblkel_col+i] (lnods_row is the same)
+  The tables are deleted when the pattern of this matrix is changed
+  */
+  bool MakeMeargeTable(unsigned int id_table, unsigned int id_es, unsigned int iver_conn, unsigned int nelem, 
+    unsigned int nblkel_col, const unsigned int* lnods_col,
+    unsigned int nblkel_row, const unsigned int* lnods_row);
+  //! check if the table id_table is made for the element segment id_es, the connectivity version iver_conn and the current pattern
+  bool IsMeargeTable(unsigned int id_table, unsigned int id_es, unsigned int iver_conn) const{
+    return this->FindMeargeTable(id_table,id_es,iver_conn) != 0;
+  }
+  /*!
+  @brief merge the element matrix of the ielem-th element at the positions stored in the table id_table
+  The pattern is not searched and no work buffer is used. 
+  Mearge is called if the table is not made for id_es, iver_conn and the current pattern (see IsMeargeTable)
+  */
+  virtual bool MeargeTable(unsigned int id_table, unsigned int id_es, unsigned int iver_conn, unsigned int ielem,
+    unsigned int nblkel_col, const unsigned int* blkel_col,
+    unsigned int nblkel_row, const unsigned int* blkel_row,
+    unsigned int blksize, const double* emat);
+
 
 	//! sxNg
 	virtual bool MatVec(double alpha, const CVector_Blk& x, double beta, CVector_Blk& b, const bool isnt_trans) const;
+	//! matrix product of all the columns of the multi vector (same as MatVec for each column, the matrix is read once)
+	bool MatVec_Multi(double alpha, const CMultiVector_Blk& x, double beta, CMultiVector_Blk& b, const bool isnt_trans) const;
 
 	//! bc_flagP̍s̗vfOɂ
 	bool SetBoundaryCondition_Row(const CBCFlag& bc_flag);
@@ -147,9 +190,14 @@ public:
 
 	//! CRS̃TCY擾
 	const unsigned int NCrs() const { return m_ncrs_Blk; }
+	//! bytes of the index arrays of the pattern (the caches made on demand are not included)
+	virtual std::size_t NBytePattern() const;
 	const unsigned int* GetPtrIndPSuP(const unsigned int ipoin, unsigned int& npsup) const
 	{
-		if( m_rowPtr_Blk == 0 ){ npsup = 0; return 0; }
+		if( m_rowPtr_Blk == 0 ){
+			assert( m_ncrs_Blk == 0 );	// the compact pattern of CMatDia_BlkCrs has no 32bit index
+			npsup = 0; return 0;
+		}
 		assert( ipoin < m_nblk_MatCol );
 		npsup = m_colInd_Blk[ipoin+1]-m_colInd_Blk[ipoin];
 		const unsigned int icrs = m_colInd_Blk[ipoin];
@@ -157,7 +205,8 @@ public:
 	}
 	const double* GetPtrValPSuP(const unsigned int ipoin, unsigned int& npsup) const
 	{
-		if( m_rowPtr_Blk == 0 ){ npsup = 0; return 0; }
+		if( m_ncrs_Blk == 0 ){ npsup = 0; return 0; }
+		assert( m_valCrs_Blk != 0 );
 		assert( ipoin < m_nblk_MatCol );
 		npsup = m_colInd_Blk[ipoin+1]-m_colInd_Blk[ipoin];
 		const unsigned int icrs = m_colInd_Blk[ipoin];
@@ -165,7 +214,8 @@ public:
 	}
 	double* GetPtrValPSuP(const unsigned int ipoin, unsigned int& npsup)
 	{
-		if( m_rowPtr_Blk == 0 ){ npsup = 0; return 0; }
+		if( m_ncrs_Blk == 0 ){ npsup = 0; return 0; }
+		assert( m_valCrs_Blk != 0 );
 		assert( ipoin < m_nblk_MatCol );
 		npsup = m_colInd_Blk[ipoin+1]-m_colInd_Blk[ipoin];
 		const unsigned int icrs = m_colInd_Blk[ipoin];
@@ -184,6 +234,7 @@ protected:
 	unsigned int* m_colInd_Blk;	//!< CRSColum Index
 	unsigned int* m_rowPtr_Blk;	//!< CRSRow Pointer
 
+  unsigned int m_nthread_marge;	//!< number of threads m_marge_tmp_buffer is allocated for
   int* m_marge_tmp_buffer;	//!< }[W̎ɕKvȍƃobt@
 
   // Flex̎ɒ`l
@@ -192,6 +243,34 @@ protected:
   unsigned int* m_ValPtr;
 
 	double* m_valCrs_Blk;	//!< s̒l
+
+  //! table of the CRS positions for the element matrices (MakeMeargeTable)
+  struct SMeargeTable{
+    unsigned int id_es;        //!< element segment the table is made from
+    unsigned int iver_conn;    //!< connectivity version of the element array
+    unsigned int iver_ptn;     //!< pattern version of this matrix
+    std::vector<int> aIndCrs;  //!< crs index (-1 if not in the pattern) for each block of the element matrices
+  };
+  std::map< unsigned int, SMeargeTable > m_mapMeargeTable;
+  //! the table id_table if it is made for id_es, iver_conn and the current pattern (0 otherwise)
+  const SMeargeTable* FindMeargeTable(unsigned int id_table, unsigned int id_es, unsigned int iver_conn) const;
+
+  // transposed pattern for the parallel transposed MatVec
+  // (made whenever the pattern is changed, so that the const MatVec does not write it.
+  // CMatDia_BlkCrs does not keep it, and its transposed MatVec is serial)
+  std::vector<unsigned int> m_aIndTrans;  //!< index of m_aCrsTrans for each row block
+  std::vector<unsigned int> m_aCrsTrans;  //!< crs index sorted by the row block
+  std::vector<unsigned int> m_aBlkTrans;  //!< column block of each m_aCrsTrans
+  unsigned int m_iver_ptn;  //!< version of the pattern (see GetPatternVersion)
+
+  //! the 32bit index of the pattern is stored (false for the compact pattern of CMatDia_BlkCrs)
+  bool IsPatternIndex() const { return m_rowPtr_Blk != 0 || m_ncrs_Blk == 0; }
+  //! call this when the pattern changed (the pattern version is renewed)
+  void ClearPatternCache();
+  //! merge buffer of the calling thread (filled with -1)
+  int* GetMargeTmpBuffer();
+  //! make the transposed pattern (called at the end of the functions that change the pattern)
+  virtual void MakePatternTrans();
 };
 
 }	// end namespace 'Ls'
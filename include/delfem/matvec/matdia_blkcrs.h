@@ -23,6 +23,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #if !defined(MATDIA_CRS_H)
 #define MATDIA_CRS_H
 
+#include <algorithm>
 #include "delfem/matvec/mat_blkcrs.h"	// ̃NXpĂ
 
 namespace Com{
@@ -35,6 +36,53 @@ class CVector_Blk;
 class CBCFlag;
 class COrdering_Blk;
 
+/*!
+@brief the compact pattern of CMatDia_BlkCrs (see CMatDia_BlkCrs::SetCompactPattern)
+ofs[icrs] is the column block - the row block of the entry. The rows with an offset over 16bit keep 
+the 32bit column blocks in wide_col, the first ofs of those rows is WIDE_ROW.
+*/
+struct SCompactPattern_Blk{
+	enum { WIDE_ROW = -32768 };
+	const short* ofs;
+	unsigned int nwide;	// number of the rows in 32bit
+	const unsigned int* wide_row;	// the rows in 32bit (sorted)
+	const unsigned int* wide_ind;	// start of the rows in wide_col (size nwide+1)
+	const unsigned int* wide_col;	// column blocks of the rows in 32bit
+};
+
+/*!
+@brief column blocks of the entries in the iblk-th row, col[icrs]
+The kernels are written once for the 32bit pattern (IND=unsigned int) and the compact pattern (IND=SCompactPattern_Blk)
+*/
+template<typename IND> class CRowColBlk
+{
+public:
+	CRowColBlk(const IND* rowptr, const unsigned int* colind, unsigned int iblk) : m_rowptr(rowptr){}
+	unsigned int operator[](unsigned int icrs) const { return m_rowptr[icrs]; }
+private:
+	const IND* m_rowptr;
+};
+template<> class CRowColBlk<SCompactPattern_Blk>
+{
+public:
+	CRowColBlk(const SCompactPattern_Blk* cp, const unsigned int* colind, unsigned int iblk) 
+		: m_iblk(iblk), m_ofs(cp->ofs), m_icrs0(colind[iblk]), m_wide(0)
+	{
+		if( m_icrs0 == colind[iblk+1] || m_ofs[m_icrs0] != SCompactPattern_Blk::WIDE_ROW ) return;
+		const unsigned int iwide = std::lower_bound(cp->wide_row,cp->wide_row+cp->nwide,iblk)-cp->wide_row;
+		assert( iwide < cp->nwide && cp->wide_row[iwide] == iblk );
+		m_wide = cp->wide_col+cp->wide_ind[iwide];
+	}
+	unsigned int operator[](unsigned int icrs) const {
+		return ( m_wide != 0 ) ? m_wide[icrs-m_icrs0] : m_iblk+m_ofs[icrs];
+	}
+private:
+	const unsigned int m_iblk;
+	const short* m_ofs;
+	const unsigned int m_icrs0;
+	const unsigned int* m_wide;
+};
+
 /*!
 @brief square crs matrix class
 @ingroup MatVec
@@ -50,7 +98,7 @@ public:
 	@param[in] len_colrow ubÑTCY
 	*/
 	CMatDia_BlkCrs(const unsigned int nblk_colrow, const unsigned int len_colrow);
-  CMatDia_BlkCrs(unsigned int nblk, const std::vector<unsigned int>& alen) : m_valDia_Blk(0), m_DiaValPtr(0)
+  CMatDia_BlkCrs(unsigned int nblk, const std::vector<unsigned int>& alen) : m_valDia_Blk(0), m_DiaValPtr(0), m_rowOfs_Blk(0)
   {
     this->Initialize(nblk,alen, nblk,alen);
   }
@@ -92,34 +140,91 @@ public:
 		unsigned int nblkel_col, const unsigned int* blkel_col,
 		unsigned int nblkel_row, const unsigned int* blkel_row,
 		unsigned int blksize, const double* emat);
+	//! merge with the table of CRS positions (see CMat_BlkCrs::MakeMeargeTable)
+	virtual bool MeargeTable(unsigned int id_table, unsigned int id_es, unsigned int iver_conn, unsigned int ielem,
+		unsigned int nblkel_col, const unsigned int* blkel_col,
+		unsigned int nblkel_row, const unsigned int* blkel_row,
+		unsigned int blksize, const double* emat);
 	/*!
 	@brief sxNg(eNX̉B)
 	{lhs} = beta*{lhs} + alpha*[A]{rhs}
 	*/
 	virtual bool MatVec(double alpha, const CVector_Blk& rhs, double beta, CVector_Blk& lhs) const;
+	/*!
+	@brief matrix vector product and the dot product of the result in one sweep
+	{lhs} = beta*{lhs} + alpha*[A]{rhs}, return {rhs}*{lhs}
+	*/
+	double MatVec_Dot(double alpha, const CVector_Blk& rhs, double beta, CVector_Blk& lhs) const;
+	/*!
+	@brief matrix product of all the columns of the multi vector
+	{lhs_icol} = beta*{lhs_icol} + alpha*[A]{rhs_icol}, each block of the matrix is read once for all the columns
+	*/
+	bool MatVec_Multi(double alpha, const CMultiVector_Blk& rhs, double beta, CMultiVector_Blk& lhs) const;
 
 	//! bc_flagP̎Rx̍sƗOɐݒCAΊp͂Pݒ
 	bool SetBoundaryCondition(const CBCFlag& bc_flag);
 
+	/*!
+	@brief store the column block of the pattern as a 16bit offset from the row block (half the memory of the index)
+	@remark MatVec, MatVec_Dot and MatVec_Multi read the offsets. The rows with an offset over 16bit keep the 32bit 
+	index, so a few long range couplings do not reject the compaction. Returns false (keeping the 32bit index) 
+	if more than half of the entries are in such rows (order the matrix to narrow the band) or the block length 
+	is not supported (1,2,3,4,6). The functions changing the pattern or the values (SetZero, AddPattern, SetValue, 
+	SetBoundaryCondition) come back to the 32bit index, Mearge needs the 32bit index.
+	*/
+	virtual bool SetCompactPattern(bool is_compact);
+	bool IsCompactPattern() const { return m_rowOfs_Blk != 0; }
+	//! bytes of the index arrays (see CMat_BlkCrs::NBytePattern)
+	virtual std::size_t NBytePattern() const;
+
     ////////////////////////////////////////////////////////////////
     // Op̃NX
 
 	const double* GetPtrValDia(const unsigned int ipoin) const {
         assert( m_DiaValPtr == 0 );
+        assert( m_valDia_Blk != 0 );
 		unsigned int blksize = this->LenBlkCol()*this->LenBlkRow();
 		return &m_valDia_Blk[ipoin*blksize];
 	}
 	double* GetPtrValDia(const unsigned int ipoin){
         assert( m_DiaValPtr == 0 );
+        assert( m_valDia_Blk != 0 );
 		unsigned int blksize = this->LenBlkCol()*this->LenBlkRow();
 		return &m_valDia_Blk[ipoin*blksize];
 	}
 
 protected:
+	//! the square matrix does not use the transposed pattern
+	virtual void MakePatternTrans(){
+		m_aIndTrans.clear();
+		m_aCrsTrans.clear();
+		m_aBlkTrans.clear();
+	}
+	//! the block length that the kernels fixed at compile time support (1,2,3,4,6)
+	static bool IsFixBlkLen(int len){
+		return len == 1 || len == 2 || len == 3 || len == 4 || len == 6;
+	}
+	SCompactPattern_Blk GetCompactPattern() const {
+		SCompactPattern_Blk cp;
+		cp.ofs = m_rowOfs_Blk;
+		cp.nwide = m_aWideRow.size();
+		cp.wide_row = ( m_aWideRow.empty() ) ? 0 : &m_aWideRow[0];
+		cp.wide_ind = &m_aWideInd[0];
+		cp.wide_col = ( m_aWideCol.empty() ) ? 0 : &m_aWideCol[0];
+		return cp;
+	}
+	void ClearCompactPattern();
+
 	double* m_valDia_Blk;	// ΊpubN
     
   // Flexɒ`l
   unsigned int* m_DiaValPtr;
+
+	// compact pattern (0 if the pattern is stored in m_rowPtr_Blk)
+	short* m_rowOfs_Blk;	// column block - row block of the entries
+	std::vector<unsigned int> m_aWideRow;	// the rows in 32bit
+	std::vector<unsigned int> m_aWideInd;
+	std::vector<unsigned int> m_aWideCol;
 };
 
 }	// end namespace 'Ls'
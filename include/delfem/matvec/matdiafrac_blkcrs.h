@@ -41,7 +41,7 @@ class CMatDiaFrac_BlkCrs : public CMatDia_BlkCrs, public CPrecond_Blk
 {
 	friend class CMatFrac_BlkCrs;
 public:
-  CMatDiaFrac_BlkCrs() : m_ConditionFlag(-1), m_DiaInd(0), m_pRowLev(0){}
+  CMatDiaFrac_BlkCrs() : m_ConditionFlag(-1), m_DiaInd(0), m_pRowLev(0), m_valCrs_Flt(0), m_valDia_Flt(0){}
 	CMatDiaFrac_BlkCrs(const unsigned int nblk_colrow, const unsigned int len_colrow);
     //! ILU(0)ɂp^[̏
 	CMatDiaFrac_BlkCrs(const CMatDia_BlkCrs& rhs);
@@ -69,6 +69,12 @@ public:
 	virtual bool SolvePrecond(const CMatDia_BlkCrs& mat, CVector_Blk& vec) const{
 		return this->Solve(vec);
 	}
+	//! solve for all the columns of the multi vector with one sweep of the factor
+	bool Solve(CMultiVector_Blk& vec) const{
+		this->ForwardSubstitution(vec);
+		this->BackwardSubstitution(vec);
+		return true;
+	}
 
 	////////////////////////////////////////////////////////////////
 	// ǗNX(CPreconditioner݂)Ă΂ł낤[eB
@@ -135,9 +141,42 @@ public:
 	bool ForwardSubstitution( CVector_Blk& vec ) const;
     //! ޑ
 	bool BackwardSubstitution( CVector_Blk& vec ) const;
+	//! forward substitution of all the columns of the multi vector
+	bool ForwardSubstitution( CMultiVector_Blk& vec ) const;
+	//! backward substitution of all the columns of the multi vector
+	bool BackwardSubstitution( CMultiVector_Blk& vec ) const;
 
     ////////////////////////////////
 
+    /*!
+    @brief number of levels of the forward (lower triangular) dependency of the rows
+    @remark rows in the same level are factorized and substituted by multiple threads at the same time
+    @remark 0 until the matrix is factorized (or the pattern is made compact)
+    */
+    unsigned int NLevel() const{
+        return ( m_aLevIndFwd.empty() ) ? 0 : m_aLevIndFwd.size()-1;
+    }
+
+    /*!
+    @brief store the factor in single precision to halve its memory and the memory traffic of the substitution
+    @remark The double values are released, so call this after the factorization.
+    The vectors stay in double. SetValue comes back to double precision.
+    Until then the functions reading the double values (MatVec, Mearge, GetValCrsPtr, GetValDiaPtr) assert.
+    false (to come back) allocates the double values again without the values (factorize again).
+    Returns false if the block length is not supported (1,2,3,4,6), then the factor stays in double.
+    */
+    bool SetSinglePrecision(bool is_single);
+    bool IsSinglePrecision() const { return m_valCrs_Flt != 0; }
+
+    /*!
+    @brief compact pattern of the factor (see CMatDia_BlkCrs::SetCompactPattern)
+    @remark Like SetSinglePrecision, call this after the factorization, the substitution reads the offsets and 
+    SetValue comes back to the 32bit index.
+    */
+    virtual bool SetCompactPattern(bool is_compact);
+    //! bytes of the index arrays (see CMat_BlkCrs::NBytePattern)
+    virtual std::size_t NBytePattern() const;
+
     const double* GetValCrsPtr(unsigned int icrs) const{
         assert( icrs < NCrs() );
         assert( m_valCrs_Blk );
@@ -310,6 +349,26 @@ protected:
 
 	unsigned int* m_DiaInd;
     std::vector<CRowLev>* m_pRowLev; //! have value if condition flag=2
+
+    // the factor in single precision (0 if it is stored in m_valCrs_Blk, m_valDia_Blk)
+    float* m_valCrs_Flt;
+    float* m_valDia_Flt;
+
+    // level scheduling of the triangular factors (computed once per pattern, before the factorization)
+    void MakeLevelSchedule();
+    void ClearLevelSchedule(){
+        m_aLevIndFwd.clear(); m_aLevBlkFwd.clear();
+        m_aLevIndBwd.clear(); m_aLevBlkBwd.clear();
+    }
+    //! true if it is worth processing the rows level by level with multiple threads
+    bool IsLevelSchedule() const;
+    /*!
+    rows m_aLevBlkFwd[ m_aLevIndFwd[ilev] ... m_aLevIndFwd[ilev+1]-1 ] depend only on the rows in the levels before ilev.
+    (Fwd is for the lower part (ILU decomposition and forward substitution), Bwd is for the upper part)
+    empty if not computed yet
+    */
+    std::vector<unsigned int> m_aLevIndFwd, m_aLevBlkFwd;
+    std::vector<unsigned int> m_aLevIndBwd, m_aLevBlkBwd;
 };
 
 }	// end namespace 'Ls'
@@ -0,0 +1,114 @@
+/*
+DelFEM (Finite Element Analysis)
+Copyright (C) 2009  Nobuyuki Umetani    n.umetani@gmail.com
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+/*! @file
+@brief interface of the supernodal LDL^T factorization class (MatVec::CMatDiaFrac_Supernode)
+@author Nobuyuki Umetani
+
+The matrix is given as a scalar crs (both triangles) of a symmetric matrix (the pattern must be symmetric too).
+The pattern is analyzed once (elimination tree and supernodes) by MakePattern, 
+and SetValue factorizes the values with the multifrontal method whose fronts are dense.
+*/
+
+#if !defined(MAT_DIA_FRAC_SUPERNODE_H)
+#define MAT_DIA_FRAC_SUPERNODE_H
+
+#include <vector>
+#include <utility>
+
+namespace MatVec{
+
+/*! 
+@brief supernodal LDL^T factorization of the symmetric sparse matrix
+@ingroup MatVec
+
+The subtrees of the supernode tree which are independent each other (e.g. the halves of the nested dissection)
+are factorized and substituted in parallel, and then the supernodes above them in order.
+*/
+class CMatDiaFrac_Supernode
+{
+public:
+	CMatDiaFrac_Supernode(){ m_ndof = 0; }
+	virtual ~CMatDiaFrac_Supernode(){}
+
+	void Clear();
+
+	/*!
+	@brief symbolic factorization
+	@param[in] ndof number of the unknowns
+	@param[in] aRowPtr, aColInd crs pattern of the matrix (both triangles, the diagonal may be omitted)
+	@param[in] aPerm fill reducing ordering aPerm[new]=old (natural order if empty)
+	*/
+	bool MakePattern(unsigned int ndof, 
+		const std::vector<unsigned int>& aRowPtr, const std::vector<unsigned int>& aColInd, 
+		const std::vector<unsigned int>& aPerm);
+
+	/*!
+	@brief numerical factorization
+	@param[in] aVal value of the matrix in the order of aColInd given to MakePattern
+	@retval false if a zero pivot appears
+	*/
+	bool SetValue(const std::vector<double>& aVal);
+
+	//! solve [A]{x}={b} ({b} is overwritten with {x})
+	void Solve(std::vector<double>& vec) const;
+
+	unsigned int NDof() const { return m_ndof; }
+	unsigned int NSuperNode() const { return m_aSnColPtr.size() > 0 ? m_aSnColPtr.size()-1 : 0; }
+	//! number of the entries of the factor L (the lower triangle including the diagonal)
+	unsigned int NNonZeroFactor() const;
+	//! number of the subtrees processed in parallel
+	unsigned int NSubtree() const { return m_aSubtree.size(); }
+private:
+	void MakeSubtree();
+	bool FactorSupernode(unsigned int isn, const std::vector<double>& aVal, double tol_pivot,
+		const std::vector<unsigned int>& aChildPtr, const std::vector<unsigned int>& aChild,
+		std::vector< std::vector<double> >& aUpd,
+		std::vector<int>& aMap, std::vector<double>& front, std::vector<double>& w, bool is_parallel);
+	void SolveForward_Supernode(unsigned int isn, double* y, unsigned int jend, double* y_above) const;
+	void SolveBackward_Supernode(unsigned int isn, double* y) const;
+private:
+	unsigned int m_ndof;
+	std::vector<unsigned int> m_aPerm;	// new -> old
+	std::vector<unsigned int> m_aInvPerm;	// old -> new
+
+	// lower triangle of the permuted matrix by column : row (new numbering) and index of the input value
+	std::vector<unsigned int> m_aLowPtr;
+	std::vector<unsigned int> m_aLowRow;
+	std::vector<unsigned int> m_aLowVal;
+
+	// supernode isn has the columns [ m_aSnColPtr[isn], m_aSnColPtr[isn+1] ) 
+	// and the rows m_aSnRow[ m_aSnRowPtr[isn] ... m_aSnRowPtr[isn+1] ) (the columns come first)
+	std::vector<unsigned int> m_aSnColPtr;
+	std::vector<unsigned int> m_aSnRowPtr;
+	std::vector<unsigned int> m_aSnRow;
+	std::vector<int> m_aSnParent;	// -1 for the root
+	// independent subtrees [first,second) of the supernodes, and the supernodes above them (ascending)
+	std::vector< std::pair<unsigned int,unsigned int> > m_aSubtree;
+	std::vector<unsigned int> m_aSnTop;
+
+	// dense panel (nrow x ncol, row major) of each supernode and the diagonal D
+	std::vector<unsigned int> m_aSnValPtr;
+	std::vector<double> m_aSnVal;
+	std::vector<double> m_aDia;
+};
+
+}
+
+#endif
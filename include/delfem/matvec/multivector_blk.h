@@ -0,0 +1,121 @@
+/*
+Copyright (C) 2009  Nobuyuki Umetani    n.umetani@gmail.com
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+/*! @file
+@brief interface of block multi vector class (MatVec::CMultiVector_Blk)
+@author Nobuyuki Umetani
+*/
+
+#if !defined(MULTIVECTOR_BLK_H)
+#define MULTIVECTOR_BLK_H
+
+#include <assert.h>
+
+namespace MatVec{
+
+class CVector_Blk;
+class CMat_BlkCrs;
+class CMatDia_BlkCrs;
+class CMatDiaFrac_BlkCrs;
+
+/*! 
+@brief several real value block vectors of the same size (one column for each right hand side)
+@ingroup MatVec
+
+The columns are interleaved, the value of the idof-th dof of the iblk-th block of the icol-th column is 
+at (iblk*Len()+idof)*NCol()+icol, so that a matrix block is applied to all the columns in one pass.
+The size of the block is fixed (no flex size).
+*/
+class CMultiVector_Blk
+{
+	friend class CMat_BlkCrs;
+	friend class CMatDia_BlkCrs;
+	friend class CMatDiaFrac_BlkCrs;
+public:
+	CMultiVector_Blk() : m_nBlk(0), m_Len(0), m_nCol(0), m_Value(0){}	//!< default constructor
+	CMultiVector_Blk(unsigned int nblk, unsigned int len, unsigned int ncol) : m_nBlk(0), m_Len(0), m_nCol(0), m_Value(0){
+		this->Initialize(nblk,len,ncol);
+	}
+	CMultiVector_Blk(const CMultiVector_Blk& vec) : m_nBlk(0), m_Len(0), m_nCol(0), m_Value(0){
+		this->Initialize(vec.m_nBlk,vec.m_Len,vec.m_nCol);
+		(*this) = vec;
+	}
+	virtual ~CMultiVector_Blk(){ if( m_Value != 0 ) delete[] m_Value; }	//!< destructor
+
+	//! allocate the values (not initialized)
+	bool Initialize(unsigned int nblk, unsigned int len, unsigned int ncol){
+		if( m_Value != 0 ){ delete[] m_Value; m_Value = 0; }
+		m_nBlk = nblk;
+		m_Len = len;
+		m_nCol = ncol;
+		const unsigned int nval = m_nBlk*m_Len*m_nCol;
+		if( nval > 0 ){ m_Value = new double [nval]; }
+		return true;
+	}
+
+	CMultiVector_Blk& operator=(const CMultiVector_Blk& rhs);	//!< Substitue Vector
+
+	inline unsigned int NBlk() const { return m_nBlk; }	//!< number of the blocks
+	inline unsigned int Len() const { return m_Len; }	//!< size of one block
+	inline unsigned int NCol() const { return m_nCol; }	//!< number of the columns (right hand sides)
+
+	inline double GetValue(unsigned int iblk, unsigned int idof, unsigned int icol) const {
+		assert( iblk < m_nBlk && idof < m_Len && icol < m_nCol );
+		return m_Value[(iblk*m_Len+idof)*m_nCol+icol];
+	}
+	inline void SetValue(unsigned int iblk, unsigned int idof, unsigned int icol, double val){
+		assert( iblk < m_nBlk && idof < m_Len && icol < m_nCol );
+		m_Value[(iblk*m_Len+idof)*m_nCol+icol] = val;
+	}
+	//! values of the iblk-th block (Len()*NCol() values, row major)
+	double* GetValuePtr(unsigned int iblk){
+		assert( iblk < m_nBlk );
+		return m_Value+iblk*m_Len*m_nCol;
+	}
+	const double* GetValuePtr(unsigned int iblk) const {
+		assert( iblk < m_nBlk );
+		return m_Value+iblk*m_Len*m_nCol;
+	}
+
+	//! copy the vector to the icol-th column
+	void SetColumn(unsigned int icol, const CVector_Blk& vec);
+	//! copy the icol-th column to the vector
+	void GetColumn(unsigned int icol, CVector_Blk& vec) const;
+
+	////////////////////////////////
+	// operations done column by column in one sweep (alpha,beta,adot have NCol() values)
+
+	void SetVectorZero();	//!< Set 0 to Value
+	//! adot[icol] = {this_icol} * {rhs_icol}
+	void Dot(const CMultiVector_Blk& rhs, double* adot) const;
+	//! {this_icol} := alpha[icol] * {this_icol}
+	void Scale(const double* alpha);
+	//! {this_icol} += alpha[icol] * {rhs_icol}
+	void AXPY(const double* alpha, const CMultiVector_Blk& rhs);
+	//! {this_icol} := alpha[icol] * {rhs_icol} + beta[icol] * {this_icol}
+	void AXPBY(const double* alpha, const CMultiVector_Blk& rhs, const double* beta);
+private:
+	unsigned int m_nBlk;	//!< number of block
+	unsigned int m_Len;	//!< degree of freedom par block
+	unsigned int m_nCol;	//!< number of the columns
+	double* m_Value;	//!< value array
+};
+
+}	// end namespace 'MatVec'
+
+#endif // MULTIVECTOR_BLK_H
@@ -33,6 +33,7 @@ namespace MatVec{
 
 class CMatDia_BlkCrs;
 class CVector_Blk;
+class CMultiVector_Blk;
 
 /*! 
 @brief node ordering class
@@ -52,11 +53,18 @@ public:
 	void MakeOrdering_RCM(const CMatDia_BlkCrs& mat);
 	void MakeOrdering_RCM2(const CMatDia_BlkCrs& mat);
 	void MakeOrdering_AMD(const CMatDia_BlkCrs& mat);
+	/*!
+	@brief nested dissection ordering (recursive bisection of the block graph by level set separators)
+	@param[in] nblk_leaf the sub graph with blocks fewer than this is not divided any more
+	*/
+	void MakeOrdering_ND(const CMatDia_BlkCrs& mat, unsigned int nblk_leaf = 64);
 	unsigned int NBlk() const { return m_nblk; }
 	int NewToOld(unsigned int iblk_new) const { return m_pOrder[iblk_new]; }
 	int OldToNew(unsigned int iblk_old) const { return m_pInvOrder[iblk_old]; }
 	void OrderingVector_NewToOld(CVector_Blk& vec_to, const CVector_Blk& vec_from);
 	void OrderingVector_OldToNew(CVector_Blk& vec_to, const CVector_Blk& vec_from);
+	void OrderingVector_NewToOld(CMultiVector_Blk& vec_to, const CMultiVector_Blk& vec_from);
+	void OrderingVector_OldToNew(CMultiVector_Blk& vec_to, const CMultiVector_Blk& vec_from);
 private:
 	unsigned int m_nblk;
 	int* m_pOrder;
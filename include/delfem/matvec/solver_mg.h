@@ -85,5 +85,94 @@ private:
 	unsigned int m_niter_pos;
 };
 
+/*!
+@brief smoothed aggregation algebraic multigrid for the matrix with fixed block length
+@ingroup MatVec
+
+The nodes (blocks) are aggregated by the strength of connection between the blocks, 
+and the tentative prolongation is made from the near null space vectors (e.g. rigid body modes) 
+by the QR factorization on each aggregate, then smoothed with one damped Jacobi step.
+The coarse matrix is the Galerkin product P^T A P with the block length of the number of the near null space vectors.
+The smoother is GS, GS_FB, JAC or O_JAC (GS_FB keeps the cycle symmetric for CG).
+The coarsest matrix is factorized exactly if it is small, and by ILU(0) if the coarsening stagnates at a large matrix.
+*/
+class CSolverMG_SA : public CPrecond_Blk{
+public:
+	/*!
+	@param[in] mat matrix
+	@param[in] nmode number of the near null space vectors
+	@param[in] aNull near null space vectors aNull[imode*nblk*len+iblk*len+idof]
+	@param[in] smoother_type smoother
+	*/
+	CSolverMG_SA(const CMatDia_BlkCrs& mat, unsigned int nmode, const std::vector<double>& aNull, 
+		MG_SMOOTHER smoother_type = GS_FB, unsigned int ilevel = 0);
+	~CSolverMG_SA();
+	/*!
+	@brief set the new value of the matrix whose pattern is the same as the matrix given to the constructor
+	The aggregates and the prolongation are kept, and the coarse matrices (Galerkin products), 
+	the smoothers and the factor of the coarsest level are made from the new value
+	*/
+	bool SetValue(const CMatDia_BlkCrs& mat);
+
+	//! one cycle (V-cycle or W-cycle) of multigrid : vec is replaced by the approximation of [mat]^-1{vec}
+	bool SolveCycle(const CMatDia_BlkCrs& mat, CVector_Blk& vec) const;
+	virtual bool SolvePrecond(const CMatDia_BlkCrs& mat, CVector_Blk& vec) const{
+		return this->SolveCycle(mat,vec);
+	}
+	bool SetSmoothingNumberOfTimes(const unsigned int& npre, const unsigned int& npos){
+		this->m_niter_pre = npre;
+		this->m_niter_pos = npos;
+		if( this->m_LayerMG_Coarse != 0 ){
+			this->m_LayerMG_Coarse->SetSmoothingNumberOfTimes(npre,npos);
+		}
+		return true;
+	}
+	//! number of the coarse grid correction at each level (1:V-cycle 2:W-cycle)
+	void SetCycleType(unsigned int ncycle){
+		this->m_ncycle = ( ncycle == 0 ) ? 1 : ncycle;
+		if( this->m_LayerMG_Coarse != 0 ){ this->m_LayerMG_Coarse->SetCycleType(ncycle); }
+	}
+	//! number of levels including this level
+	unsigned int NLevel() const{
+		if( m_LayerMG_Coarse == 0 ) return 1;
+		return m_LayerMG_Coarse->NLevel()+1;
+	}
+	unsigned int SumOfCrsMatSize(const CMatDia_BlkCrs& mat) const;
+
+	/*!
+	@brief make the near null space vectors from the node coordinates
+	@param[in] len block length of the matrix
+	@param[in] ndim dimension of the coordinate
+	@param[in] aCoord coordinates aCoord[iblk*ndim+idim]
+	@param[out] aNull near null space vectors (the rigid body modes if len==ndim, the constant vectors for each dof otherwise)
+	@retval number of the vectors
+	*/
+	static unsigned int MakeRigidBodyMode(unsigned int len, unsigned int ndim, 
+		const std::vector<double>& aCoord, std::vector<double>& aNull);
+private:
+	// factor of the coarsest level (ILU(0) if the matrix is large)
+	void MakeCoarsestSolver(const CMatDia_BlkCrs& mat);
+private:
+	CMat_BlkCrs* m_pPro;	// prolongation  (nblk_f*len) x (nblk_c*nmode)
+	CMat_BlkCrs* m_pRes;	// restriction (transpose of the prolongation)
+	CMatDia_BlkCrs* m_pMat;	// coarse matrix
+
+	CVector_Blk* m_pV_c;
+	CVector_Blk* m_pV_c1;	// use only W-cycle
+	CVector_Blk* m_pV_c2;	// use only W-cycle
+	CVector_Blk* m_pVf1;
+	CVector_Blk* m_pVf2;
+
+	CSolverMG_SA* m_LayerMG_Coarse;
+
+	CMatDiaFrac_BlkCrs* m_pFrac;
+	CMatDiaInv_BlkDia* m_pDiaInv;
+	MG_SMOOTHER m_smoother_type;
+	double m_Omega;
+	unsigned int m_niter_pre;
+	unsigned int m_niter_pos;
+	unsigned int m_ncycle;
+};
+
 }
 #endif // !defined(SOLVERMG_H)
@@ -44,6 +44,8 @@ class CVector_Blk
 	friend class CMatDiaFrac_BlkCrs;
 	friend class CMatDiaInv_BlkDia;
   friend double operator*(const CVector_Blk& lhs, const CVector_Blk& rhs);	//!< Dot Product
+  friend void DotMulti(unsigned int ndot, const CVector_Blk* const* apv1, const CVector_Blk* const* apv2, double* adot);
+  friend void AxpyMulti(unsigned int nvec, const double* aalpha, const CVector_Blk* const* apv, CVector_Blk& y);
 public:
 	/*!
 	@brief RXgN^
@@ -113,6 +115,10 @@ public:
 	{this} += alhpa*{rhs}
 	*/
 	CVector_Blk& AXPY(const double& alpha, const CVector_Blk& rhs);
+	//! {this} := alpha*{rhs} + beta*{this} (in one sweep)
+	CVector_Blk& AXPBY(const double& alpha, const CVector_Blk& rhs, const double& beta);
+	//! {this} += alpha*{rhs} and return the squared norm of the updated {this} (in one sweep)
+	double AXPY_SqNorm(const double& alpha, const CVector_Blk& rhs);
 
 	void SetVectorZero();	//!< Set 0 to Value
 	double GetSquaredVectorNorm() const;	//!< xNĝQm̂QvZ
@@ -213,6 +219,19 @@ private:
   unsigned int* m_DofPtr; //!< 0 if blk size is fixed, nonzero if size is flex
 };
 
+/*!
+@brief several dot products in one sweep over the vectors
+@param[in] ndot number of the pairs
+@param[in,out] adot adot[idot] += {apv1[idot]} * {apv2[idot]}
+*/
+void DotMulti(unsigned int ndot, const CVector_Blk* const* apv1, const CVector_Blk* const* apv2, double* adot);
+
+/*!
+@brief {y} += sum aalpha[ivec]*{apv[ivec]} in one sweep over {y}
+@param[in] nvec number of the vectors
+*/
+void AxpyMulti(unsigned int nvec, const double* aalpha, const CVector_Blk* const* apv, CVector_Blk& y);
+
 }	// end namespace 'Ls'
 
 #endif // VEC_H
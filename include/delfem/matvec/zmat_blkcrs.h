@@ -68,8 +68,8 @@ public:
 	
     virtual bool MatVec(double alpha, const MatVec::CZVector_Blk& x, double beta, MatVec::CZVector_Blk& b, const bool isnt_trans) const;
 
-	bool SetBoundaryCondition_Row(const MatVec::CBCFlag& bc_flag);
-	bool SetBoundaryCondition_Colum(const MatVec::CBCFlag& bc_flag);
+	virtual bool SetBoundaryCondition_Row(const MatVec::CBCFlag& bc_flag);
+	virtual bool SetBoundaryCondition_Colum(const MatVec::CBCFlag& bc_flag);
 	
 	////////////////////////////////////////////////
 	// Crs Original Function ( Non-virtual )
@@ -48,11 +48,19 @@ public:
 	virtual bool DeletePattern();
 
     virtual bool AddPattern(const Com::CIndexedArray& crs);
+	virtual bool AddPattern(const CZMat_BlkCrs& rhs, const bool isnt_trans);
 	bool AddPattern(const CZMatDia_BlkCrs& rhs, const bool isnt_trans);
 	bool AddPattern(const CZMat_BlkCrs& m1, const CZMatDia_BlkCrs& m2, const CZMat_BlkCrs& m3);
 
+	virtual bool SetValue(const CZMat_BlkCrs& rhs, const bool isnt_trans, bool isnt_conj);
 	bool SetValue(const CZMatDia_BlkCrs& rhs, const bool isnt_trans);
 	bool SetValue(const CZMat_BlkCrs& m1, const CZMatDia_BlkCrs& m2, const CZMat_BlkCrs& m3);
+	/*!
+	@brief [this] = sum coeff[imat]*[mat[imat]]
+	all the matrices must have the same pattern as this (e.g. made with the copy constructor without the value)
+	@retval false the pattern of some matrix is different
+	*/
+	bool SetValue_Combination(unsigned int nmat, const CZMatDia_BlkCrs* const* apMat, const Com::Complex* aCoeff);
 
 	virtual bool SetZero();
 	virtual bool Mearge(
@@ -62,17 +70,42 @@ public:
 	void AddUnitMatrix(const Com::Complex& epsilon);
 
 	bool SetBoundaryCondition(const CBCFlag& bc_flag);
+	virtual bool SetBoundaryCondition_Row(const CBCFlag& bc_flag);
+	virtual bool SetBoundaryCondition_Colum(const CBCFlag& bc_flag);
 
 	bool MatVec(double alpha, const CZVector_Blk& rhs, double beta, CZVector_Blk& lhs) const;
 	bool MatVec_Hermitian(double alpha, const CZVector_Blk& rhs, double beta, CZVector_Blk& lhs) const;
+	/*!
+	@brief matrix vector product of nrhs vectors at once  {y_j} = alpha[j]*[A]{x_j} + beta*{y_j}
+	x and y have the block length nrhs*(block length of this), and the vectors are interleaved as the columns of 
+	CMultiVector_Blk (the idof-th dof of the j-th vector is at idof*nrhs+j in a block), 
+	so that the values of the matrix are read once for all the vectors.
+	*/
+	bool MatVec_Multi(unsigned int nrhs, const Com::Complex* alpha, const CZVector_Blk& x, double beta, CZVector_Blk& y) const;
+
+	/*!
+	@brief keep a real copy of the off-diagonal values if all of them are real
+	MatVec then reads only the real copy (the diagonal stays complex), which is the case of
+	a real symmetric K-w^2M with complex diagonal terms from PML or absorbing boundaries.
+	The copy is removed when the values are changed through this class (not through GetPtrValPSuP).
+	@retval false some off-diagonal value is complex (no copy is made)
+	*/
+	bool MakeRealCrsValue();
+	//! whether MatVec uses the real copy of the off-diagonal values
+	bool IsRealCrsValue() const { return m_valCrs_Real != 0; }
 
 	////////////////////////////////
 
 	const Com::Complex* GetPtrValDia(const unsigned int ipoin) const	{ return &m_valDia_Blk[ipoin]; }
 	Com::Complex* GetPtrValDia(const unsigned int ipoin){ return &m_valDia_Blk[ipoin]; }
 
+protected:
+	void ClearRealCrsValue(){
+		if( m_valCrs_Real != 0 ){ delete[] m_valCrs_Real; m_valCrs_Real = 0; }
+	}
 protected:
 	Com::Complex* m_valDia_Blk;
+	double* m_valCrs_Real;	// real copy of m_valCrs_Blk (0 if not made)
 };
 
 }	// namespace Ls
@@ -74,6 +74,11 @@ public:
 
 	bool ForwardSubstitution(CZVector_Blk& vec) const;
 	bool BackwardSubstitution(CZVector_Blk& vec) const;
+	/*!
+	@brief solve for nrhs vectors at once (block length 1 only)
+	the vectors are stored as in CZMatDia_BlkCrs::MatVec_Multi, so the factor is read once for all of them
+	*/
+	bool Solve_Multi(unsigned int nrhs, CZVector_Blk& vec) const;
 
 	virtual bool SolvePrecond(const CZMatDia_BlkCrs& mat, CZVector_Blk& vec) const{
 		return this->Solve(vec);
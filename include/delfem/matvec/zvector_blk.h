@@ -82,6 +82,14 @@ public:
 		assert( iblk<m_BlkVecLen ); assert( idofblk<m_BlkLen );
 		m_Value[iblk*m_BlkLen+idofblk] += val; 	
 	}
+	Com::Complex* GetValuePtr(unsigned int iblk){
+		assert( iblk<m_BlkVecLen );
+		return m_Value+iblk*m_BlkLen;
+	}
+	const Com::Complex* GetValuePtr(unsigned int iblk) const{
+		assert( iblk<m_BlkVecLen );
+		return m_Value+iblk*m_BlkLen;
+	}
 private:
     const unsigned int m_BlkVecLen;
     const unsigned int m_BlkLen;
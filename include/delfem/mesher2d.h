@@ -115,6 +115,10 @@ public:
 		this->m_imode_meshing = 0;
 		this->m_elen = 1;
 		this->m_esize = 1000;
+		this->m_nins_stat = 0;
+		this->m_time_ins_stat = 0.0;
+		this->m_is_bulk_refine = false;
+		this->m_is_parallel_loop = false;
 		const std::vector<unsigned int>& aIdL = cad_2d.GetAryElemID(Cad::LOOP);
 		for(unsigned int i=0;i<aIdL.size();i++){ setIdLCad_CutMesh.insert(aIdL[i]); }
 		this->Meshing(cad_2d);
@@ -124,6 +128,10 @@ public:
 		this->m_imode_meshing = 2;
 		this->m_elen = elen;
 		this->m_esize = 1000;
+		this->m_nins_stat = 0;
+		this->m_time_ins_stat = 0.0;
+		this->m_is_bulk_refine = false;
+		this->m_is_parallel_loop = false;
 		const std::vector<unsigned int>& aIdL = cad_2d.GetAryElemID(Cad::LOOP);
 		for(unsigned int i=0;i<aIdL.size();i++){ setIdLCad_CutMesh.insert(aIdL[i]); }
 		this->Meshing(cad_2d);
@@ -133,6 +141,10 @@ public:
 		this->m_imode_meshing = 1;
 		this->m_elen = 0.1;
 		this->m_esize = 1000;
+		this->m_nins_stat = 0;
+		this->m_time_ins_stat = 0.0;
+		this->m_is_bulk_refine = false;
+		this->m_is_parallel_loop = false;
 	}
   CMesher2D(const CMesher2D&);
   virtual ~CMesher2D(){}
@@ -163,6 +175,25 @@ public:
 		this->m_imode_meshing = 1;
 		this->m_esize = esize;
 	}
+	/*!
+	@brief refinement of the loops by the passes of bulk insertion
+	
+	The triangles larger than the element size are collected for a pass and visited in the Morton order of their centroids,
+	so the points and the triangles are added in the spatial order and the refinement of a large mesh keeps the memory access local.
+	The mesh is different from the one of the default refinement, which visits the triangles in the order of the array.
+	*/
+	virtual void SetRefinementMode_Bulk(bool is_bulk){
+		this->m_is_bulk_refine = is_bulk;
+	}
+	/*!
+	@brief mesh the loops concurrently (OpenMP)
+	
+	The edges are meshed first, then each loop is meshed into its own buffer in parallel.
+	The buffers are merged in the order of the loops, so the IDs and the mesh are the same as the ones of the serial meshing.
+	*/
+	virtual void SetMeshingMode_ParallelLoop(bool is_parallel){
+		this->m_is_parallel_loop = is_parallel;
+	}
 	
 	virtual bool Meshing(const Cad::ICad2D_Msh& cad_2d){
 		std::vector<unsigned int> aIdL_Cut;
@@ -257,6 +288,11 @@ public:
 	const std::vector<SVertex>& GetVertexAry() const { return m_aVertex; }
 	const std::vector<Com::CVector2D>& GetVectorAry() const { return aVec2D; }
 
+	//! number of the points inserted by the Delaunay division and the refinement, and the time [sec] for it since the mesh was cleared
+	void GetInsertionStatistics(unsigned int& npoin, double& time) const { npoin = m_nins_stat; time = m_time_ins_stat; }
+	//! points inserted per second by the Delaunay division and the refinement (benchmark of the meshing)
+	double GetInsertionRate() const { return ( m_time_ins_stat > 0.0 ) ? m_nins_stat / m_time_ins_stat : 0.0; }
+
 	////////////////////////////////////////////////////////////////
 	// IO\bh
 	
@@ -277,6 +313,8 @@ protected:
 		m_aQuadAry.clear();
 
 		aVec2D.clear();
+		m_nins_stat = 0;
+		m_time_ins_stat = 0.0;
 	}
 	
 	//! ftHgRXgN^ŏꂽCClearꂽŃbV؂(elen : bV)
@@ -307,6 +345,35 @@ protected:
 	bool Tessalate_Edge(const Cad::ICad2D_Msh& cad_2d, const unsigned int id_e );
 	bool Tesselate_Loop(const Cad::ICad2D_Msh& cad_2d, const unsigned int id_l);
 
+	// mesh of a loop made apart from the members (the loops are meshed concurrently into the buffers)
+	class CLoopBuffer{
+	public:
+		CLoopBuffer() : is_ok(false), nvec_base(0), nins(0), time_ins(0.0){}
+		CBarAry& GetBarAry(unsigned int ibarary){
+			assert( ibarary < aIndBarAry.size() && aIndBarAry[ibarary] >= 0 );
+			return aBarAry[ aIndBarAry[ibarary] ];
+		}
+		const CBarAry& GetBarAry(unsigned int ibarary) const {
+			assert( ibarary < aIndBarAry.size() && aIndBarAry[ibarary] >= 0 );
+			return aBarAry[ aIndBarAry[ibarary] ];
+		}
+	public:
+		bool is_ok;
+		std::vector<CBarAry> aBarAry;		// copy of the bar arrays around the loop
+		std::vector<unsigned int> aIBarAry;	// index in m_aBarAry of the copy
+		std::vector<int> aIndBarAry;		// index of the copy from the index in m_aBarAry (-1 if not copied)
+		CTriAry2D TriAry;	// the ID is temporary until the buffer is merged
+		unsigned int nvec_base;	// the points added in the loop are numbered from nvec_base until the buffer is merged
+		std::vector<Com::CVector2D> aVec2D_add;
+		unsigned int nins;
+		double time_ins;
+	};
+	void InitLoopBuffer(const Cad::ICad2D_Msh& cad_2d, unsigned int id_l, unsigned int id_tri_ary, CLoopBuffer& buf) const;
+	bool Tesselate_Loop(const Cad::ICad2D_Msh& cad_2d, const unsigned int id_l, CLoopBuffer& buf) const;
+	void RefineMesh_Loop(const double len, CLoopBuffer& buf) const;
+	void MergeLoopBuffer(CLoopBuffer& buf);
+	bool MakeMesh_Loop_Parallel(const Cad::ICad2D_Msh& cad_2d, const std::vector<unsigned int>& aIdLoop, const double len);
+
 	////////////////////////////////
 	// g|W[擾
 
@@ -336,7 +403,7 @@ protected:
 	// ɃbV؂ĂȂfalseԂ
 	bool FindElemLocType_CadIDType(
 		unsigned int& iloc, unsigned int& itype, 
-		unsigned int id_cad_part, Cad::CAD_ELEM_TYPE itype_cad );
+		unsigned int id_cad_part, Cad::CAD_ELEM_TYPE itype_cad ) const;
 
 	// ̃[v̖ʐςƁCݐ؂Ă郁bVœKȕӂ̒肷
 	double GetAverageEdgeLength(const Cad::ICad2D_Msh& cad_2d, 
@@ -346,6 +413,10 @@ private:
 	unsigned int m_imode_meshing;	// 0: tesselation 1:mesh_size 2:mesh_length
 	double m_elen;
 	unsigned int m_esize;
+	unsigned int m_nins_stat;	// points inserted by the Delaunay division and the refinement
+	double m_time_ins_stat;		// time for the insertion [sec]
+	bool m_is_bulk_refine;		// refinement by the passes of bulk insertion (SetRefinementMode_Bulk)
+	bool m_is_parallel_loop;	// mesh the loops concurrently (SetMeshingMode_ParallelLoop)
 protected:
 	std::vector<int> m_ElemType;	// vertex(0) bar(1) tri(2) quad(3)	always valid (return -1 if no corresponding ID)
 	std::vector<int> m_ElemLoc;		// index of elem_ary : always valid (return -1 if no corresponding ID)
@@ -223,6 +223,45 @@ void PliantBossenHeckbertSmoothing( double elen, std::vector<Msh::CPoint2D>& aPo
 void ColorCodeBarAry( const std::vector<SBar>& aBar, const std::vector<Com::CVector2D>& aVec, 
 					 std::vector< std::vector<unsigned int> >& aIndBarAry );
 
+/*!
+@brief find the triangle including the point by the walk from the triangle itri_start
+The walk moves across the edge the point is beyond (the first edge to test rotates at each step, so that
+the walk does not cycle). The point may be on an edge of itri_in.
+@retval false the walk went out of the mesh or did not finish in aTri.size() steps
+*/
+bool FindTri_Walk(const Com::CVector2D& po, unsigned int itri_start, unsigned int& itri_in,
+	const std::vector<Msh::CPoint2D>& aPo, const std::vector<Msh::STri2D>& aTri);
+
+/*!
+@brief start triangles of the walk (FindTri_Walk) on a coarse grid
+Each cell of the grid on the bounding box keeps the triangle where a point in the cell was last located.
+The walk starts from it (or from the last located triangle if the cell has none),
+so that the length of the walk is short even if the points are not given in order.
+*/
+class CTriLocator2D
+{
+public:
+	CTriLocator2D(double x_min, double x_max, double y_min, double y_max, unsigned int ndiv);
+	//! triangle where the walk to the point p starts
+	unsigned int GetStartTri(const Com::CVector2D& p) const {
+		const int itri = m_aTriCell[ this->GetCell(p) ];
+		return ( itri >= 0 ) ? itri : m_itri_last;
+	}
+	//! the point p was located in the triangle itri
+	void SetTri(const Com::CVector2D& p, unsigned int itri){
+		m_aTriCell[ this->GetCell(p) ] = itri;
+		m_itri_last = itri;
+	}
+private:
+	unsigned int GetCell(const Com::CVector2D& p) const;
+private:
+	double m_x_min, m_y_min;
+	double m_inv_len_cell;
+	unsigned int m_ndiv;
+	unsigned int m_itri_last;
+	std::vector<int> m_aTriCell;
+};
+
 //! @}
 } // end name space mesh;
 
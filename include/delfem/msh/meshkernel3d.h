@@ -247,6 +247,13 @@ public:
 		this->ptn = rhs.ptn;
 		this->ok_flg = rhs.ok_flg;
 	}
+	CFlipCrtPrePosPtn& operator = (const CFlipCrtPrePosPtn& rhs){
+		this->pre = rhs.pre;
+		this->pos = rhs.pos;
+		this->ptn = rhs.ptn;
+		this->ok_flg = rhs.ok_flg;
+		return *this;
+	}
 	CFlipCrtPrePosPtn( double pre, double pos, int ptn ){
 		this->pre = pre;	this->pos = pos;	this->ptn = ptn;
 		if( pos > pre || ptn < 0 || pos > ILL_CRT*0.9 ) ok_flg = false;
@@ -561,6 +568,52 @@ bool ReconnectSliver(const unsigned int itet0,
 bool Reconnect(std::vector<Msh::STet>& tet,
 			   std::vector<Msh::CPoint3D>& node);
 
+//! statistics of the quality (Criterion_PLJ) of the tetrahedra
+class CTetQualityStat{
+public:
+	CTetQualityStat() : ntet(0), nbad(0), min_crt(0), max_crt(0), ave_crt(0){}
+public:
+	unsigned int ntet;	//!< number of the tetrahedra
+	unsigned int nbad;	//!< number of the tetrahedra whose criterion is not less than the threshold
+	double min_crt;		//!< best criterion (3 for the regular tetrahedron)
+	double max_crt;		//!< worst criterion
+	double ave_crt;		//!< average of the criterion
+};
+
+//! statistics of ReconnectParallel
+class CReconnectStat{
+public:
+	CReconnectStat() : npass(0), ncand(0), nswap(0), time(0){}
+public:
+	CTetQualityStat pre;	//!< quality before the reconnection
+	CTetQualityStat pos;	//!< quality after the reconnection
+	unsigned int npass;		//!< number of the passes
+	unsigned int ncand;		//!< number of the swaps found (summed over the passes)
+	unsigned int nswap;		//!< number of the swaps done (summed over the passes)
+	double time;			//!< wall clock time [sec]
+};
+
+//! quality statistics of the tetrahedra (computed in parallel)
+bool GetTetQualityStat(CTetQualityStat& stat, double threshold,
+					   const std::vector<Msh::STet>& tet,
+					   const std::vector<Msh::CPoint3D>& node);
+
+/*!
+@brief improve the tetrahedra whose criterion is not less than the threshold by the edge swap
+@param[out] stat statistics of the reconnection
+@param[in] max_pass maximum number of the passes
+
+In each pass the best edge swap around every bad tetrahedron is searched in parallel (the mesh is not changed).
+Then the swaps whose sets of the tetrahedra around the edge do not overlap are chosen from the worst one,
+and they are applied without searching again. The passes are repeated until no swap is found.
+The mesh does not depend on the number of the threads.
+*/
+bool ReconnectParallel(std::vector<Msh::STet>& tet,
+					   std::vector<Msh::CPoint3D>& node,
+					   CReconnectStat& stat,
+					   double threshold = 15.0,
+					   unsigned int max_pass = 10);
+
 
 
 
@@ -29,7 +29,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
     #pragma warning( disable : 4786 )
 #endif
 
-#ifndef for 
+#if !defined(for) && !defined(_OPENMP)
 #define for if(0); else for
 #endif
 
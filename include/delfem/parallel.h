@@ -0,0 +1,90 @@
+/*
+DelFEM (Finite Element Analysis)
+Copyright (C) 2009  Nobuyuki Umetani    n.umetani@gmail.com
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+/*! @file
+@brief thread count control for the multi-threaded kernels (Com::SetNumThread)
+@author Nobuyuki Umetani
+
+Multi-threading is done with OpenMP. When the library is compiled without OpenMP
+every function here behaves as if only one thread is available.
+*/
+
+#if !defined(DELFEM_PARALLEL_H)
+#define DELFEM_PARALLEL_H
+
+#include <time.h>
+#if defined(_OPENMP)
+#include <omp.h>
+#endif
+
+namespace Com{
+
+/*!
+@brief set the number of threads used by the parallel kernels
+@param[in] nthread number of threads (0 restores the number before the first call, e.g. OMP_NUM_THREADS)
+*/
+inline void SetNumThread(unsigned int nthread){
+#if defined(_OPENMP)
+  static const int nthread_default = omp_get_max_threads();  // taken at the first call
+  if( nthread == 0 ){ nthread = nthread_default; }
+  omp_set_num_threads(nthread);
+#else
+  (void)nthread;
+#endif
+}
+
+//! number of threads the parallel kernels will use
+inline unsigned int GetNumThread(){
+#if defined(_OPENMP)
+  return omp_get_max_threads();
+#else
+  return 1;
+#endif
+}
+
+//! wall clock time [sec] (clock() is summed over the threads, so it is not used for timing)
+inline double GetWallTime(){
+#if defined(_OPENMP)
+  return omp_get_wtime();
+#else
+  return (double)clock()/CLOCKS_PER_SEC;
+#endif
+}
+
+//! index of the calling thread inside a parallel region (0 outside)
+inline unsigned int GetThreadIndex(){
+#if defined(_OPENMP)
+  return omp_get_thread_num();
+#else
+  return 0;
+#endif
+}
+
+//! number of threads of the team executing the parallel region (1 outside, can be less than GetNumThread())
+inline unsigned int GetNumThreadInTeam(){
+#if defined(_OPENMP)
+  return omp_get_num_threads();
+#else
+  return 1;
+#endif
+}
+
+}
+
+#endif
@@ -356,6 +356,11 @@ public:
     virtual bool SCAL(double d,int iv){ return m_ls.SCAL(d,iv); }
     virtual bool AXPY(double d,int iv0,int iv1){ return m_ls.AXPY(d,iv0,iv1); }
     virtual bool MATVEC(double a,int iv0,double b,int iv1){ return m_ls.MATVEC(a,iv0,b,iv1); }
+    virtual bool AXPBY(double alpha, int iv1, double beta, int iv2){ return m_ls.AXPBY(alpha,iv1,beta,iv2); }
+    virtual double AXPY_DOT(double alpha, int iv1, int iv2){ return m_ls.AXPY_DOT(alpha,iv1,iv2); }
+    virtual double MATVEC_DOT(double alpha, int iv1, double beta, int iv2){ return m_ls.MATVEC_DOT(alpha,iv1,beta,iv2); }
+    virtual void DOTS(unsigned int ndot, const int* aiv1, const int* aiv2, double* adot){ m_ls.DOTS(ndot,aiv1,aiv2,adot); }
+    virtual bool MATVEC_MULTI(unsigned int nvec, double alpha, const int* aiv1, double beta, const int* aiv2){ return m_ls.MATVEC_MULTI(nvec,alpha,aiv1,beta,aiv2); }
 
     ////////////////////////////////////////////////////////////////
 
@@ -433,6 +438,11 @@ public:
     virtual bool SCAL(double alpha, int iv1){ return ls.SCAL(alpha,iv1); }
     virtual bool AXPY(double alpha, int iv1, int iv2){ return ls.AXPY(alpha,iv1,iv2); }
     virtual bool MATVEC(double alpha, int iv1, double beta, int iv2){ return ls.MATVEC(alpha,iv1,beta,iv2); }
+    virtual bool AXPBY(double alpha, int iv1, double beta, int iv2){ return ls.AXPBY(alpha,iv1,beta,iv2); }
+    virtual double AXPY_DOT(double alpha, int iv1, int iv2){ return ls.AXPY_DOT(alpha,iv1,iv2); }
+    virtual double MATVEC_DOT(double alpha, int iv1, double beta, int iv2){ return ls.MATVEC_DOT(alpha,iv1,beta,iv2); }
+    virtual void DOTS(unsigned int ndot, const int* aiv1, const int* aiv2, double* adot){ ls.DOTS(ndot,aiv1,aiv2,adot); }
+    virtual bool MATVEC_MULTI(unsigned int nvec, double alpha, const int* aiv1, double beta, const int* aiv2){ return ls.MATVEC_MULTI(nvec,alpha,aiv1,beta,aiv2); }
 
     virtual bool SolvePrecond(int iv){
         prec.SolvePrecond(ls,iv);
@@ -0,0 +1,57 @@
+/*
+DelFEM (Finite Element Analysis)
+Copyright (C) 2009  Nobuyuki Umetani    n.umetani@gmail.com
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+/*! @file
+@brief grouping of the tuples of the vertex indices (faces and edges of the elements) (Com::MakeVertexTupleGroup)
+@author Nobuyuki Umetani
+*/
+
+#if !defined(VERTEX_TUPLE_GROUP_H)
+#define VERTEX_TUPLE_GROUP_H
+
+#if defined(__VISUALC__)
+#pragma warning( disable : 4786 )
+#endif
+
+#include <vector>
+
+#include "delfem/indexed_array.h"
+
+namespace Com{
+
+/*!
+@brief group the tuples which consist of the same set of the vertices
+@param[out] group tuples of the igroup-th group are group.array[group.index[igroup]] ... group.array[group.index[igroup+1]-1]
+@param[in,out] aTuple vertices of the tuples (aTuple[ituple*nvtx+ivtx]), the vertices of each tuple are sorted on return
+@param[in] nvtx number of the vertices of a tuple (1 to 4)
+@param[in] npoin the vertex indices are less than npoin
+
+The tuples are bucketed by the smallest vertex with the counting sort (each thread counts a range of the tuples),
+and each bucket is sorted by the other vertices. The buckets are processed in parallel.
+The buckets are small for a mesh, so the cost is almost linear in the number of the tuples.
+The groups are in the lexicographic order of the sorted vertices, and the tuples in a group are in ascending order,
+so the result does not depend on the number of the threads.
+*/
+void MakeVertexTupleGroup(CIndexedArray& group,
+						  std::vector<unsigned int>& aTuple, unsigned int nvtx,
+						  unsigned int npoin);
+
+}
+
+#endif
@@ -18,6 +18,7 @@ SOURCES += com/drawer.cpp \
     com/vector3d.cpp \
     com/uglyfont.cpp \
     com/quaternion.cpp \
+    com/vertex_tuple_group.cpp \
     com/drawer_gl_utility.cpp \ # Cad
     cad/cad_obj2d.cpp \
     cad/cad_elem2d.cpp \
@@ -47,10 +48,12 @@ SOURCES += com/drawer.cpp \
     matvec/matfrac_blkcrs.cpp \
     matvec/mat_blkcrs.cpp \
     matvec/vector_blk.cpp \
+    matvec/multivector_blk.cpp \
     matvec/solver_mat_iter.cpp \
     matvec/ordering_blk.cpp \
     matvec/matprolong_blkcrs.cpp \
     matvec/matdiainv_blkdia.cpp \
+    matvec/matdiafrac_supernode.cpp \
     matvec/solver_mg.cpp \
     matvec/zvector_blk.cpp \
     matvec/zsolver_mat_iter.cpp \
@@ -64,7 +67,8 @@ SOURCES += com/drawer.cpp \
     femls/zsolver_ls_iter.cpp \
     femls/zlinearsystem.cpp \
     femls/linearsystem_fieldsave.cpp \
-    femls/linearsystem_field.cpp \ # FemEqn
+    femls/linearsystem_field.cpp \
+    femls/linearsystem_matfree.cpp \ # FemEqn
     femeqn/ker_emat_tri.cpp \
     femeqn/eqn_poisson.cpp \
     femeqn/eqn_diffusion.cpp \
@@ -94,7 +98,8 @@ HEADERS += camera.h \
     quaternion.h \
     serialize.h \
     uglyfont.h \
-    indexed_array.h \ # Cad
+    indexed_array.h \
+    vertex_tuple_group.h \ # Cad
     cad_obj2d.h \
     cad2d_interface.h \
     cad_com.h \
@@ -123,6 +128,7 @@ HEADERS += camera.h \
     drawer_field_image_based_flow_vis.h \
     drawer_field_streamline.h \ # MatVec
     matvec/ker_mat.h \
+    matvec/multivector_blk.h \
     matvec/solver_mat_iter.h \
     matvec/matfrac_blkcrs.h \
     matvec/mat_blkcrs.h \
@@ -130,6 +136,7 @@ HEADERS += camera.h \
     matvec/ordering_blk.h \
     matvec/matprecond_blk.h \
     matvec/matdiainv_blkdia.h \
+    matvec/matdiafrac_supernode.h \
     matvec/matdiafrac_blkcrs.h \
     matvec/diamat_blk.h \
     matvec/solver_mat_iter.h \
@@ -150,7 +157,8 @@ HEADERS += camera.h \
     femls/zpreconditioner.h \
     femls/zlinearsystem.h \
     femls/linearsystem_fieldsave.h \
-    femls/linearsystem_field.h \ # FemEqn
+    femls/linearsystem_field.h \
+    femls/linearsystem_matfree.h \ # FemEqn
     linearsystem_interface_eqnsys.h \
     femeqn/ker_emat_hex.h \
     femeqn/ker_emat_tet.h \
@@ -0,0 +1,216 @@
+/*
+DelFEM (Finite Element Analysis)
+Copyright (C) 2009  Nobuyuki Umetani    n.umetani@gmail.com
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#if defined(__VISUALC__)
+#pragma warning( disable : 4786 )
+#endif
+
+#include <vector>
+#include <algorithm>
+#include <assert.h>
+
+#include "delfem/vertex_tuple_group.h"
+#include "delfem/parallel.h"
+
+// order of the tuples in a bucket : the other vertices, then the position in the bucket
+class CVertexTupleOrder{
+public:
+	CVertexTupleOrder(const unsigned int* pKey, unsigned int nkey) : pKey(pKey), nkey(nkey){}
+	bool operator()(unsigned int i, unsigned int j) const {
+		const unsigned int* ki = pKey+i*nkey;
+		const unsigned int* kj = pKey+j*nkey;
+		for(unsigned int ikey=0;ikey<nkey;ikey++){
+			if( ki[ikey] != kj[ikey] ) return ki[ikey] < kj[ikey];
+		}
+		return i < j;
+	}
+	bool IsSame(unsigned int i, unsigned int j) const {
+		const unsigned int* ki = pKey+i*nkey;
+		const unsigned int* kj = pKey+j*nkey;
+		for(unsigned int ikey=0;ikey<nkey;ikey++){
+			if( ki[ikey] != kj[ikey] ) return false;
+		}
+		return true;
+	}
+private:
+	const unsigned int* pKey;
+	unsigned int nkey;
+};
+
+void Com::MakeVertexTupleGroup(CIndexedArray& group,
+							   std::vector<unsigned int>& aTuple, unsigned int nvtx,
+							   unsigned int npoin)
+{
+	assert( nvtx >= 1 && nvtx <= 4 );
+	assert( aTuple.size() % nvtx == 0 );
+	const unsigned int ntuple = aTuple.size()/nvtx;
+	unsigned int* pTuple = ( ntuple == 0 ) ? 0 : &aTuple[0];
+
+	// sort the vertices of each tuple (insertion sort)
+#if defined(_OPENMP)
+#pragma omp parallel for
+#endif
+	for(int iituple=0;iituple<(int)ntuple;iituple++){
+		unsigned int* t = pTuple+iituple*nvtx;
+		for(unsigned int i=1;i<nvtx;i++){
+			const unsigned int v = t[i];
+			unsigned int j = i;
+			for(;j>0&&t[j-1]>v;j--){ t[j] = t[j-1]; }
+			t[j] = v;
+		}
+	}
+
+	// bucket the tuples by the smallest vertex (stable counting sort)
+	// the other vertices are copied in the order of the buckets, so that a bucket is read contiguously
+	const unsigned int nkey = nvtx-1;
+	std::vector<unsigned int> aBucketInd(npoin+1,0);
+	std::vector<unsigned int> aOrder(ntuple);
+	std::vector<unsigned int> aKey(ntuple*nkey);
+	{
+		// each thread counts and places a contiguous range of the tuples, and the ranges are placed in order,
+		// so the order does not depend on the number of the threads
+		const unsigned int nthread = ( ntuple < 65536 ) ? 1 : Com::GetNumThread();
+		std::vector<unsigned int> aPos(nthread*npoin,0);	// aPos[ithread*npoin+ipoin]
+#if defined(_OPENMP)
+#pragma omp parallel num_threads(nthread)
+#endif
+		{
+			const unsigned int ithread = Com::GetThreadIndex();
+			const unsigned int nthread_team = Com::GetNumThreadInTeam();
+			const unsigned int ituple0 = (unsigned int)( (std::size_t)ntuple*ithread    /nthread_team );
+			const unsigned int ituple1 = (unsigned int)( (std::size_t)ntuple*(ithread+1)/nthread_team );
+			unsigned int* pPos = ( npoin == 0 ) ? 0 : &aPos[ithread*npoin];
+			for(unsigned int ituple=ituple0;ituple<ituple1;ituple++){
+				assert( pTuple[ituple*nvtx] < npoin );
+				pPos[ pTuple[ituple*nvtx] ]++;
+			}
+#if defined(_OPENMP)
+#pragma omp barrier
+#pragma omp for
+#endif
+			for(int iipoin=0;iipoin<(int)npoin;iipoin++){
+				unsigned int nb = 0;
+				for(unsigned int jthread=0;jthread<nthread_team;jthread++){ nb += aPos[jthread*npoin+iipoin]; }
+				aBucketInd[iipoin+1] = nb;
+			}
+#if defined(_OPENMP)
+#pragma omp single
+#endif
+			{
+				for(unsigned int ipoin=0;ipoin<npoin;ipoin++){ aBucketInd[ipoin+1] += aBucketInd[ipoin]; }
+			}
+#if defined(_OPENMP)
+#pragma omp for
+#endif
+			for(int iipoin=0;iipoin<(int)npoin;iipoin++){
+				unsigned int ipos = aBucketInd[iipoin];
+				for(unsigned int jthread=0;jthread<nthread_team;jthread++){
+					const unsigned int nb = aPos[jthread*npoin+iipoin];
+					aPos[jthread*npoin+iipoin] = ipos;
+					ipos += nb;
+				}
+			}
+			for(unsigned int ituple=ituple0;ituple<ituple1;ituple++){
+				const unsigned int* t = pTuple+ituple*nvtx;
+				const unsigned int ipos = pPos[ t[0] ]++;
+				aOrder[ipos] = ituple;
+				for(unsigned int ikey=0;ikey<nkey;ikey++){ aKey[ipos*nkey+ikey] = t[ikey+1]; }
+			}
+		}
+	}
+
+	// sort each bucket by the other vertices (the buckets are independent)
+	// the distinct first keys of a bucket are marked and only they are sorted,
+	// then the tuples which share the first key (a few for a mesh) are sorted by the rest of the keys
+	std::vector<unsigned char> aIsHead(ntuple,0);
+#if defined(_OPENMP)
+#pragma omp parallel
+#endif
+	{
+		std::vector<unsigned int> aTmp, aPerm, aKeyDist;
+		std::vector<unsigned int> aKeyStamp( (nkey==0)?0:npoin, 0 );
+		std::vector<unsigned int> aKeyPos(   (nkey==0)?0:npoin );
+#if defined(_OPENMP)
+#pragma omp for schedule(dynamic,1024)
+#endif
+		for(int iipoin=0;iipoin<(int)npoin;iipoin++){
+			const unsigned int ipoin = iipoin;
+			const unsigned int ibs = aBucketInd[ipoin];
+			const unsigned int ibe = aBucketInd[ipoin+1];
+			if( ibe-ibs < 2 || nkey == 0 ){	// all the tuples of the bucket are the same
+				if( ibe > ibs ){ aIsHead[ibs] = 1; }
+				continue;
+			}
+			const unsigned int nb = ibe-ibs;
+			const unsigned int* pKey = &aKey[ibs*nkey];
+			aKeyDist.clear();
+			for(unsigned int i=0;i<nb;i++){
+				const unsigned int ikey = pKey[i*nkey];
+				if( aKeyStamp[ikey] != ipoin+1 ){ aKeyStamp[ikey] = ipoin+1; aKeyPos[ikey] = 0; aKeyDist.push_back(ikey); }
+				aKeyPos[ikey]++;
+			}
+			const unsigned int ndist = aKeyDist.size();
+			for(unsigned int i=1;i<ndist;i++){	// insertion sort
+				const unsigned int v = aKeyDist[i];
+				unsigned int j = i;
+				for(;j>0&&aKeyDist[j-1]>v;j--){ aKeyDist[j] = aKeyDist[j-1]; }
+				aKeyDist[j] = v;
+			}
+			{
+				unsigned int ipos = 0;
+				for(unsigned int idist=0;idist<ndist;idist++){
+					const unsigned int ikey = aKeyDist[idist];
+					const unsigned int n = aKeyPos[ikey];
+					aKeyPos[ikey] = ipos;
+					ipos += n;
+				}
+			}
+			aPerm.resize(nb);
+			for(unsigned int i=0;i<nb;i++){ aPerm[ aKeyPos[pKey[i*nkey]]++ ] = i; }
+			const CVertexTupleOrder order(pKey,nkey);
+			unsigned int is = 0;
+			for(unsigned int idist=0;idist<ndist;idist++){
+				const unsigned int ie = aKeyPos[ aKeyDist[idist] ];
+				aIsHead[ibs+is] = 1;
+				if( nkey > 1 && ie-is > 1 ){
+					for(unsigned int i=is+1;i<ie;i++){	// insertion sort
+						const unsigned int v = aPerm[i];
+						unsigned int j = i;
+						for(;j>is&&order(v,aPerm[j-1]);j--){ aPerm[j] = aPerm[j-1]; }
+						aPerm[j] = v;
+					}
+					for(unsigned int i=is+1;i<ie;i++){
+						if( !order.IsSame(aPerm[i-1],aPerm[i]) ){ aIsHead[ibs+i] = 1; }
+					}
+				}
+				is = ie;
+			}
+			aTmp.assign(aOrder.begin()+ibs,aOrder.begin()+ibe);
+			for(unsigned int i=0;i<nb;i++){ aOrder[ibs+i] = aTmp[ aPerm[i] ]; }
+		}
+	}
+
+	group.index.clear();
+	group.index.reserve(ntuple+1);
+	for(unsigned int ipos=0;ipos<ntuple;ipos++){
+		if( aIsHead[ipos] ){ group.index.push_back(ipos); }
+	}
+	group.index.push_back(ntuple);
+	group.array.swap(aOrder);
+}
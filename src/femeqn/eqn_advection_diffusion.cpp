@@ -76,15 +76,6 @@ static bool AddLinSys_AdvectionDiffusion_Static_P1P1(
 
 	const CElemAry::CElemSeg& es_c_val = field_velo.GetElemSeg(id_ea,CORNER,true,world);
 
-	unsigned int no_c[nno];	// vfߓ_̑S̐ߓ_ԍ
-
-	double value_c[nno];		// vfߓ_̒l
-	double coord_c[nno][ndim];	// vfߓ_̍W
-	double velo_c[nno][ndim];
-	
-	double emat[nno][nno];	// vfs
-	double eres_c[nno];	// vfߓ_́AÓAcxNg
-				
 	CMatDia_BlkCrs& mat_cc = ls.GetMatrix(  id_field_val,CORNER,world);
 	CVector_Blk&    res_c  = ls.GetResidual(id_field_val,CORNER,world);
 
@@ -95,8 +86,21 @@ static bool AddLinSys_AdvectionDiffusion_Static_P1P1(
 	const CNodeAry& na_c_co = world.GetNA(id_na_c_co);
 	const CNodeAry::CNodeSeg& ns_c_co = na_c_co.GetSeg(id_ns_c_co);
 
-	for(unsigned int ielem=0;ielem<ea.Size();ielem++)
-	{
+	// elements of one color do not share a node, so they can be merged at the same time
+	const Com::CIndexedArray& color = ea.GetColoring( field_velo.GetIdElemSeg(id_ea,CORNER,true,world) );
+	mat_cc.MakeMargeTmpBuffer();	// one merge buffer for each thread
+	for(unsigned int icolor=0;icolor<color.Size();icolor++){
+#if defined(_OPENMP)
+#pragma omp parallel for
+#endif
+	for(int iie=(int)color.index[icolor];iie<(int)color.index[icolor+1];iie++){
+		const unsigned int ielem = color.array[iie];
+		unsigned int no_c[nno];	// vfߓ_̑S̐ߓ_ԍ
+		double value_c[nno];		// vfߓ_̒l
+		double coord_c[nno][ndim];	// vfߓ_̍W
+		double velo_c[nno][ndim];
+		double emat[nno][nno];	// vfs
+		double eres_c[nno];	// vfߓ_́AÓAcxNg
 		// vfz񂩂vfZOg̐ߓ_ԍo
 		es_c_val.GetNodes(ielem,no_c);
 		// ߓ_̒lė
@@ -206,6 +210,7 @@ static bool AddLinSys_AdvectionDiffusion_Static_P1P1(
 			res_c.AddValue( no_c[ino],0,eres_c[ino]);
 		}
 	}
+	}
 	return true;
 }
 
@@ -302,15 +307,6 @@ static bool AddLinSys_AdvectionDiffusion_Static_P1P1(
 
 	const CElemAry::CElemSeg& es_c_val = val_field.GetElemSeg(id_ea,CORNER,true,world);
 
-	unsigned int no_c[nno];	// vfߓ_̑S̐ߓ_ԍ
-
-	double value_c[nno];		// vfߓ_̒l
-	double coord_c[nno][ndim];	// vfߓ_̍W
-	double velo_c[nno][ndim];
-				
-	double emat[nno][nno];	// vfs
-	double eqf_out_c[nno];	// vfߓ_́AÓAcxNg
-				
 	CMatDia_BlkCrs& mat_cc = ls.GetMatrix(  id_field_val,CORNER,world);
 	CVector_Blk&    res_c  = ls.GetResidual(id_field_val,CORNER,world);
 	
@@ -323,7 +319,22 @@ static bool AddLinSys_AdvectionDiffusion_Static_P1P1(
 	const CNodeAry& na_c_co = world.GetNA(id_na_c_co);
 	const CNodeAry::CNodeSeg& ns_c_co = na_c_co.GetSeg(id_ns_c_co);
 
-	for(unsigned int ielem=0;ielem<ea.Size();ielem++){
+	// elements of one color do not share a node, so they can be merged at the same time
+	const Com::CIndexedArray& color = ea.GetColoring( val_field.GetIdElemSeg(id_ea,CORNER,true,world) );
+	mat_cc.MakeMargeTmpBuffer();	// one merge buffer for each thread
+	mat_cc_bound.MakeMargeTmpBuffer();
+	for(unsigned int icolor=0;icolor<color.Size();icolor++){
+#if defined(_OPENMP)
+#pragma omp parallel for
+#endif
+	for(int iie=(int)color.index[icolor];iie<(int)color.index[icolor+1];iie++){
+		const unsigned int ielem = color.array[iie];
+		unsigned int no_c[nno];	// vfߓ_̑S̐ߓ_ԍ
+		double value_c[nno];		// vfߓ_̒l
+		double coord_c[nno][ndim];	// vfߓ_̍W
+		double velo_c[nno][ndim];
+		double emat[nno][nno];	// vfs
+		double eqf_out_c[nno];	// vfߓ_́AÓAcxNg
 		// vfz񂩂vfZOg̐ߓ_ԍo
 		es_c_val.GetNodes(ielem,no_c);
 		// ߓ_̒lė
@@ -426,6 +437,7 @@ static bool AddLinSys_AdvectionDiffusion_Static_P1P1(
 			res_c.AddValue( no_c[ino],0,eqf_out_c[ino]);
 		}
 	}
+	}
 	return true;
 }
 
@@ -507,15 +519,6 @@ static bool AddLinSys_AdvectionDiffusion_NonStatic_Newmark_P1P1(
 
 	const CElemAry::CElemSeg& es_c_val = val_field.GetElemSeg(id_ea,CORNER,true,world);
 
-	double val_c[nno];		// vfߓ_̒l
-	double vval_c[nno];		// vfߓ_̒l
-	double coord_c[nno][ndim];	// vfߓ_̍W
-	double velo_c[nno][ndim];
-	double eCmat[nno][nno];
-	double eMmat[nno][nno];
-	double emat[nno][nno];	// vfs
-	double eres_c[nno];	// vfߓ_́AÓAcxNg
-				
 	CMatDia_BlkCrs& mat_cc = ls.GetMatrix(  id_field_val,CORNER,world);
 	CVector_Blk&    res_c  = ls.GetResidual(id_field_val,CORNER,world);
 
@@ -524,8 +527,23 @@ static bool AddLinSys_AdvectionDiffusion_NonStatic_Newmark_P1P1(
 	const CNodeAry::CNodeSeg& ns_c_velo = field_velo.GetNodeSeg(CORNER,true,world,VELOCITY);
 	const CNodeAry::CNodeSeg& ns_c_co = field_velo.GetNodeSeg(CORNER,false,world,VALUE);
 
-	for(unsigned int ielem=0;ielem<ea.Size();ielem++)
-	{
+	// elements of one color do not share a node, so they can be merged at the same time
+	const Com::CIndexedArray& color = ea.GetColoring( val_field.GetIdElemSeg(id_ea,CORNER,true,world) );
+	mat_cc.MakeMargeTmpBuffer();	// one merge buffer for each thread
+	for(unsigned int icolor=0;icolor<color.Size();icolor++){
+#if defined(_OPENMP)
+#pragma omp parallel for
+#endif
+	for(int iie=(int)color.index[icolor];iie<(int)color.index[icolor+1];iie++){
+		const unsigned int ielem = color.array[iie];
+		double val_c[nno];		// vfߓ_̒l
+		double vval_c[nno];		// vfߓ_̒l
+		double coord_c[nno][ndim];	// vfߓ_̍W
+		double velo_c[nno][ndim];
+		double eCmat[nno][nno];
+		double eMmat[nno][nno];
+		double emat[nno][nno];	// vfs
+		double eres_c[nno];	// vfߓ_́AÓAcxNg
 		// vfz񂩂vfZOg̐ߓ_ԍo
 		unsigned int no_c[nno];	// vfߓ_̑S̐ߓ_ԍ
 		es_c_val.GetNodes(ielem,no_c);
@@ -655,6 +673,7 @@ static bool AddLinSys_AdvectionDiffusion_NonStatic_Newmark_P1P1(
 			res_c.AddValue( no_c[inoes],0,eres_c[inoes]);
 		}
 	}
+	}
 	return true;
 }
 
@@ -739,9 +758,6 @@ static bool AddLinSys_AdvectionDiffusion_NonStatic_Newmark_P1P1(
 
 	const CElemAry::CElemSeg& es_c_val = val_field.GetElemSeg(id_ea,CORNER,true,world);
 
-	double emat[nno][nno];	// vfs
-	double eqf_out_c[nno];	// vfߓ_́AÓAcxNg
-				
 	CMatDia_BlkCrs& mat_cc  = ls.GetMatrix(id_field_val,CORNER,world);
 	CVector_Blk&    force_c = ls.GetForce( id_field_val,CORNER,world);
 
@@ -752,8 +768,18 @@ static bool AddLinSys_AdvectionDiffusion_NonStatic_Newmark_P1P1(
 	const CNodeAry::CNodeSeg& ns_c_velo = field_velo.GetNodeSeg(CORNER,true,world,VELOCITY);//na_c_velo.GetSeg(id_ns_c_velo);
 	const CNodeAry::CNodeSeg& ns_c_co = field_velo.GetNodeSeg(CORNER,false,world,VALUE);	//na_c_co.GetSeg(id_ns_c_co);
 
-	for(unsigned int ielem=0;ielem<ea.Size();ielem++)
-	{
+	// elements of one color do not share a node, so they can be merged at the same time
+	const Com::CIndexedArray& color = ea.GetColoring( val_field.GetIdElemSeg(id_ea,CORNER,true,world) );
+	mat_cc.MakeMargeTmpBuffer();	// one merge buffer for each thread
+	mat_cc_bound.MakeMargeTmpBuffer();
+	for(unsigned int icolor=0;icolor<color.Size();icolor++){
+#if defined(_OPENMP)
+#pragma omp parallel for
+#endif
+	for(int iie=(int)color.index[icolor];iie<(int)color.index[icolor+1];iie++){
+		const unsigned int ielem = color.array[iie];
+		double emat[nno][nno];	// vfs
+		double eqf_out_c[nno];	// vfߓ_́AÓAcxNg
 		// vfz񂩂vfZOg̐ߓ_ԍo
 		unsigned int no_c[nno];	// vfߓ_̑S̐ߓ_ԍ
 		es_c_val.GetNodes(ielem,no_c);
@@ -879,6 +905,7 @@ static bool AddLinSys_AdvectionDiffusion_NonStatic_Newmark_P1P1(
 			force_c.AddValue( no_c[ino],0,eqf_out_c[ino]);
 		}
 	}
+	}
 	return true;
 }
 
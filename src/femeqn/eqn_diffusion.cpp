@@ -110,24 +110,6 @@ static bool AddLinearSystem_Diffusion_P1b(
 	const unsigned int nno_b = 1;
 	const unsigned int ndim = 2;
 
-	unsigned int no_c[nno_c];
-	unsigned int no_b;
-
-	double val_c[nno_c], val_b;
-	double vval_c[nno_c], vval_b;
-	double coord_c[nno_c][ndim];
-				
-	double dldx[nno_c][ndim];
-	double const_term[nno_c];
-
-	double eCmat_cc[nno_c][nno_c], eCmat_cb[nno_c], eCmat_bc[nno_c], eCmat_bb;
-	double eMmat_cc[nno_c][nno_c], eMmat_cb[nno_c], eMmat_bc[nno_c], eMmat_bb;
-	double eqf_out_c[nno_c], eqf_out_b;
-	double eqf_in_c[nno_c], eqf_in_b;
-
-	double emat_cc[nno_c][nno_c], emat_cb[nno_c], emat_bc[nno_c], emat_bb;
-	double eres_c[nno_c], eres_b;	// vfߓ_́AÓAcxNg
-
 	CMatDia_BlkCrs& mat_cc = ls.GetMatrix(id_field_val,CORNER, world);
 	CMatDia_BlkCrs& mat_bb = ls.GetMatrix(id_field_val,BUBBLE, world);
 	CMat_BlkCrs&    mat_cb = ls.GetMatrix(id_field_val,CORNER, id_field_val, BUBBLE, world);
@@ -142,7 +124,31 @@ static bool AddLinearSystem_Diffusion_P1b(
 	const CNodeAry::CNodeSeg& ns_b_vval = field_val.GetNodeSeg(BUBBLE,true,world,VELOCITY);//na_b_val.GetSeg(id_ns_b_vval);
 	const CNodeAry::CNodeSeg& ns_c_co = field_val.GetNodeSeg(CORNER,false,world,VALUE);//na_c_val.GetSeg(id_ns_c_co);
 
-	for(unsigned int ielem=0;ielem<ea.Size();ielem++){
+	// elements of one color do not share a node, so they can be merged at the same time
+	const Com::CIndexedArray& color = ea.GetColoring( field_val.GetIdElemSeg(id_ea,CORNER,true,world) );
+	mat_cc.MakeMargeTmpBuffer();	// one merge buffer for each thread
+	mat_cb.MakeMargeTmpBuffer();
+	mat_bc.MakeMargeTmpBuffer();
+	mat_bb.MakeMargeTmpBuffer();
+	for(unsigned int icolor=0;icolor<color.Size();icolor++){
+#if defined(_OPENMP)
+#pragma omp parallel for
+#endif
+	for(int iie=(int)color.index[icolor];iie<(int)color.index[icolor+1];iie++){
+		const unsigned int ielem = color.array[iie];
+		unsigned int no_c[nno_c];
+		unsigned int no_b;
+		double val_c[nno_c], val_b;
+		double vval_c[nno_c], vval_b;
+		double coord_c[nno_c][ndim];
+		double dldx[nno_c][ndim];
+		double const_term[nno_c];
+		double eCmat_cc[nno_c][nno_c], eCmat_cb[nno_c], eCmat_bc[nno_c], eCmat_bb;
+		double eMmat_cc[nno_c][nno_c], eMmat_cb[nno_c], eMmat_bc[nno_c], eMmat_bb;
+		double eqf_out_c[nno_c], eqf_out_b;
+		double eqf_in_c[nno_c], eqf_in_b;
+		double emat_cc[nno_c][nno_c], emat_cb[nno_c], emat_bc[nno_c], emat_bb;
+		double eres_c[nno_c], eres_b;	// vfߓ_́AÓAcxNg
 		// vfz񂩂ߓ_ZOg̐ߓ_ԍo
 		es_c.GetNodes(ielem,no_c);
 		es_b.GetNodes(ielem,&no_b);
@@ -233,6 +239,7 @@ static bool AddLinearSystem_Diffusion_P1b(
 		}
 		res_b.AddValue( no_b,0,eres_b );
 	}
+	}
 	return true;
 }
 
@@ -259,17 +266,6 @@ static bool AddLinearSystem_Diffusion2D_P1(
 	const unsigned int nno = 3;
 	const unsigned int ndim = 2;
 
-	unsigned int no_c[nno];	// vfߓ_̑S̐ߓ_ԍ
-
-	double val_c[nno];		// vfߓ_̒l
-	double vval_c[nno];		// vfߓ_̒l
-	double coord_c[nno][ndim];	// vfߓ_̍W
-				
-	double emat[nno][nno];
-	double eCmat[nno][nno];	// vfs
-	double eMmat[nno][nno];	// vfs
-	double eres_c[nno];	// cxNg
-				
 	CMatDia_BlkCrs& mat_cc = ls.GetMatrix(  id_field_val,CORNER,world);
 	CVector_Blk&    res_c  = ls.GetResidual(id_field_val,CORNER,world);
 
@@ -277,8 +273,23 @@ static bool AddLinearSystem_Diffusion2D_P1(
 	const CNodeAry::CNodeSeg& ns_c_vval = field_val.GetNodeSeg(CORNER,true,world,VELOCITY);//na_c_vval.GetSeg(id_ns_c_vval);
 	const CNodeAry::CNodeSeg& ns_c_co = field_val.GetNodeSeg(CORNER,false,world,VALUE);//na_c_co.GetSeg(id_ns_c_co);
 
-	for(unsigned int ielem=0;ielem<ea.Size();ielem++)
-	{
+	// elements of one color do not share a node, so they can be merged at the same time
+	const Com::CIndexedArray& color = ea.GetColoring( field_val.GetIdElemSeg(id_ea,CORNER,true,world) );
+	mat_cc.MakeMargeTmpBuffer();	// one merge buffer for each thread
+	for(unsigned int icolor=0;icolor<color.Size();icolor++){
+#if defined(_OPENMP)
+#pragma omp parallel for
+#endif
+	for(int iie=(int)color.index[icolor];iie<(int)color.index[icolor+1];iie++){
+		const unsigned int ielem = color.array[iie];
+		unsigned int no_c[nno];	// vfߓ_̑S̐ߓ_ԍ
+		double val_c[nno];		// vfߓ_̒l
+		double vval_c[nno];		// vfߓ_̒l
+		double coord_c[nno][ndim];	// vfߓ_̍W
+		double emat[nno][nno];
+		double eCmat[nno][nno];	// vfs
+		double eMmat[nno][nno];	// vfs
+		double eres_c[nno];	// cxNg
 		// vfz񂩂vfZOg̐ߓ_ԍo
 		es_c_co.GetNodes(ielem,no_c);
 		for(unsigned int inoes=0;inoes<nno;inoes++){
@@ -341,6 +352,7 @@ static bool AddLinearSystem_Diffusion2D_P1(
 			res_c.AddValue( no_c[inoes],0,eres_c[inoes]);
 		}
 	}
+	}
 	return true;
 }
 
@@ -427,8 +439,15 @@ static bool AddLinearSystem_Diffusion2D_AxSym_P1(
 	const CNodeAry::CNodeSeg& ns_c_vval = field_val.GetNodeSeg(CORNER,true,world,VELOCITY);
 	const CNodeAry::CNodeSeg& ns_c_co = field_val.GetNodeSeg(CORNER,false,world,VALUE);
 
-	for(unsigned int ielem=0;ielem<ea.Size();ielem++)
-	{
+	// elements of one color do not share a node, so they can be merged at the same time
+	const Com::CIndexedArray& color = ea.GetColoring( field_val.GetIdElemSeg(id_ea,CORNER,true,world) );
+	mat_cc.MakeMargeTmpBuffer();	// one merge buffer for each thread
+	for(unsigned int icolor=0;icolor<color.Size();icolor++){
+#if defined(_OPENMP)
+#pragma omp parallel for
+#endif
+	for(int iie=(int)color.index[icolor];iie<(int)color.index[icolor+1];iie++){
+		const unsigned int ielem = color.array[iie];
 		// vfz񂩂vfZOg̐ߓ_ԍo
 		unsigned int no[nno];	// vfߓ_̑S̐ߓ_ԍ
 		es_c_co.GetNodes(ielem,no);
@@ -511,6 +530,7 @@ static bool AddLinearSystem_Diffusion2D_AxSym_P1(
 			res_c.AddValue( no[ino],0,eres_c[ino]);
 		}
 	}
+	}
 	return true;
 }
 
@@ -587,23 +607,28 @@ static bool AddLinearSystem_Diffusion2D_P1(
 	const unsigned int nno = 3;
 	const unsigned int ndim = 2;
 
-	unsigned int no_c[nno];	// vfߓ_̑S̐ߓ_ԍ
-
-	double coord_c[nno][ndim];	// vfߓ_̍W
-				
-	double emat[nno][nno];
-	double eCmat[nno][nno];	// vfs
-	double eMmat[nno];	// vfs
-	double eqf_out_c[nno];	// vfߓ_́AÓAcxNg
-				
 	CMatDia_BlkCrs& mat_cc   = ls.GetMatrix(id_field_val,CORNER,world);
 	CVector_Blk&    force_c  = ls.GetForce( id_field_val,CORNER,world);
 	
 	CMat_BlkCrs& mat_cc_bound = ls.GetMatrix_Boundary(id_field_val,CORNER,  id_field_val,CORNER,  world);
 	const CNodeAry::CNodeSeg& ns_c_co   = field_val.GetNodeSeg(CORNER,false,world,VALUE);
 
-	for(unsigned int ielem=0;ielem<ea.Size();ielem++)
-	{
+	// elements of one color do not share a node, so they can be merged at the same time
+	const Com::CIndexedArray& color = ea.GetColoring( field_val.GetIdElemSeg(id_ea,CORNER,true,world) );
+	mat_cc.MakeMargeTmpBuffer();	// one merge buffer for each thread
+	mat_cc_bound.MakeMargeTmpBuffer();
+	for(unsigned int icolor=0;icolor<color.Size();icolor++){
+#if defined(_OPENMP)
+#pragma omp parallel for
+#endif
+	for(int iie=(int)color.index[icolor];iie<(int)color.index[icolor+1];iie++){
+		const unsigned int ielem = color.array[iie];
+		unsigned int no_c[nno];	// vfߓ_̑S̐ߓ_ԍ
+		double coord_c[nno][ndim];	// vfߓ_̍W
+		double emat[nno][nno];
+		double eCmat[nno][nno];	// vfs
+		double eMmat[nno];	// vfs
+		double eqf_out_c[nno];	// vfߓ_́AÓAcxNg
 		// vfz񂩂vfZOg̐ߓ_ԍo
 		es_c_co.GetNodes(ielem,no_c);
 		for(unsigned int ino=0;ino<nno;ino++){
@@ -656,6 +681,7 @@ static bool AddLinearSystem_Diffusion2D_P1(
 			force_c.AddValue( no_c[ino],0,eqf_out_c[ino]);
 		}
 	}
+	}
 	return true;
 }
 
@@ -682,17 +708,6 @@ static bool AddLinearSystem_Diffusion3D_P1(
 	const unsigned int nno = 4;
 	const unsigned int ndim = 3;
 
-	unsigned int no_c[nno];	// vfߓ_̑S̐ߓ_ԍ
-
-	double val_c[nno];		// vfߓ_̒l
-	double vval_c[nno];		// vfߓ_̒l
-	double coord_c[nno][ndim];	// vfߓ_̍W
-				
-	double emat[nno][nno];
-	double eCmat[nno][nno];	// vfs
-	double eMmat[nno][nno];	// vfs
-	double eqf_out_c[nno];	// vfߓ_́AÓAcxNg
-				
 	CMatDia_BlkCrs& mat_cc  = ls.GetMatrix(id_field_val,CORNER,world);
 	CVector_Blk&    force_c = ls.GetForce( id_field_val,CORNER,world);
 	
@@ -703,8 +718,24 @@ static bool AddLinearSystem_Diffusion3D_P1(
 	const CNodeAry::CNodeSeg& ns_c_vval = field_val.GetNodeSeg(CORNER,true,world,VELOCITY);
 	const CNodeAry::CNodeSeg& ns_c_co = field_val.GetNodeSeg(CORNER,false,world,VALUE);	
 
-	for(unsigned int ielem=0;ielem<ea.Size();ielem++)
-	{
+	// elements of one color do not share a node, so they can be merged at the same time
+	const Com::CIndexedArray& color = ea.GetColoring( field_val.GetIdElemSeg(id_ea,CORNER,true,world) );
+	mat_cc.MakeMargeTmpBuffer();	// one merge buffer for each thread
+	mat_cc_bound.MakeMargeTmpBuffer();
+	for(unsigned int icolor=0;icolor<color.Size();icolor++){
+#if defined(_OPENMP)
+#pragma omp parallel for
+#endif
+	for(int iie=(int)color.index[icolor];iie<(int)color.index[icolor+1];iie++){
+		const unsigned int ielem = color.array[iie];
+		unsigned int no_c[nno];	// vfߓ_̑S̐ߓ_ԍ
+		double val_c[nno];		// vfߓ_̒l
+		double vval_c[nno];		// vfߓ_̒l
+		double coord_c[nno][ndim];	// vfߓ_̍W
+		double emat[nno][nno];
+		double eCmat[nno][nno];	// vfs
+		double eMmat[nno][nno];	// vfs
+		double eqf_out_c[nno];	// vfߓ_́AÓAcxNg
 		// vfz񂩂vfZOg̐ߓ_ԍo
 		es_c.GetNodes(ielem,no_c);
 		// ߓ_̒lė
@@ -763,6 +794,7 @@ static bool AddLinearSystem_Diffusion3D_P1(
 			force_c.AddValue( no_c[ino],0,eqf_out_c[ino]);
 		}
 	}
+	}
 	return true;
 }
 
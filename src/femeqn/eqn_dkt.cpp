@@ -267,17 +267,6 @@ static bool AddLinearSystem_DKT2D_P1(
 	const unsigned int nno = 3;
 	const unsigned int ndim = 2;
 
-	unsigned int no[nno];
-
-	double w[nno];
-	double rot[nno][ndim];
-	double coord[nno][ndim];
-				
-	double emat_ww[nno][nno];
-	double emat_rr[nno][nno][ndim][ndim];
-	double emat_wr[nno][nno][ndim];
-	double emat_rw[nno][nno][ndim];
-				
 	CMatDia_BlkCrs& mat_ww = ls.GetMatrix(id_field_deflect,CORNER,world);
 	CMatDia_BlkCrs& mat_rr = ls.GetMatrix(id_field_rot,    CORNER,world);
 	CMat_BlkCrs& mat_wr = ls.GetMatrix(id_field_deflect,CORNER, id_field_rot,    CORNER, world);
@@ -289,7 +278,26 @@ static bool AddLinearSystem_DKT2D_P1(
 	const CNodeAry::CNodeSeg& ns_c_r = field_rot.GetNodeSeg(CORNER,true,world);
 	const CNodeAry::CNodeSeg& ns_c_co  = field_deflect.GetNodeSeg(CORNER,false,world);
 
-	for(unsigned int ielem=0;ielem<ea.Size();ielem++){
+	// elements of one color do not share a node, so they can be merged at the same time
+	const Com::CIndexedArray& color = ea.GetColoring( field_deflect.GetIdElemSeg(id_ea,CORNER,true,world) );
+	mat_ww.MakeMargeTmpBuffer();	// one merge buffer for each thread
+	mat_rr.MakeMargeTmpBuffer();
+	mat_rw.MakeMargeTmpBuffer();
+	mat_wr.MakeMargeTmpBuffer();
+	for(unsigned int icolor=0;icolor<color.Size();icolor++){
+#if defined(_OPENMP)
+#pragma omp parallel for
+#endif
+	for(int iie=(int)color.index[icolor];iie<(int)color.index[icolor+1];iie++){
+		const unsigned int ielem = color.array[iie];
+		unsigned int no[nno];
+		double w[nno];
+		double rot[nno][ndim];
+		double coord[nno][ndim];
+		double emat_ww[nno][nno];
+		double emat_rr[nno][nno][ndim][ndim];
+		double emat_wr[nno][nno][ndim];
+		double emat_rw[nno][nno][ndim];
 		es_c_co.GetNodes(ielem,no);
 		for(unsigned int inoes=0;inoes<nno;inoes++){
 			ns_c_co.GetValue(no[inoes],coord[inoes]);
@@ -340,6 +348,7 @@ static bool AddLinearSystem_DKT2D_P1(
 			res_r.AddValue(no[ino],1,eres_r[ino][1]);
 		}
 	}
+	}
 	return true;
 }
 
@@ -446,8 +455,18 @@ static bool AddLinearSystem_DKT3D_Linear_P1(
 	const CNodeAry::CNodeSeg& ns_c_r = field_rot.GetNodeSeg(CORNER,true,world);
 	const CNodeAry::CNodeSeg& ns_c_co  = field_disp.GetNodeSeg(CORNER,false,world);
 
-	for(unsigned int ielem=0;ielem<ea.Size();ielem++)
-	{
+	// elements of one color do not share a node, so they can be merged at the same time
+	const Com::CIndexedArray& color = ea.GetColoring( field_disp.GetIdElemSeg(id_ea,CORNER,true,world) );
+	mat_dd.MakeMargeTmpBuffer();	// one merge buffer for each thread
+	mat_dt.MakeMargeTmpBuffer();
+	mat_td.MakeMargeTmpBuffer();
+	mat_tt.MakeMargeTmpBuffer();
+	for(unsigned int icolor=0;icolor<color.Size();icolor++){
+#if defined(_OPENMP)
+#pragma omp parallel for
+#endif
+	for(int iie=(int)color.index[icolor];iie<(int)color.index[icolor+1];iie++){
+		const unsigned int ielem = color.array[iie];
 		unsigned int no[nno];
 		es_c_co.GetNodes(ielem,no);
 		double coord[nno][ndim];
@@ -565,6 +584,7 @@ static bool AddLinearSystem_DKT3D_Linear_P1(
 			res_t.AddValue(no[ino],2,eres_t[ino][2]);
 		}
 	}
+	}
 	return true;
 }
 
@@ -605,8 +625,15 @@ static bool AddLinearSystem_DKT3D_Linear_P1_Combined(
 	const CNodeAry::CNodeSeg& ns_c_r = field_rot.GetNodeSeg(CORNER,true,world);
 	const CNodeAry::CNodeSeg& ns_c_co  = field_disp.GetNodeSeg(CORNER,false,world);
 
-	for(unsigned int ielem=0;ielem<ea.Size();ielem++)
-	{
+	// elements of one color do not share a node, so they can be merged at the same time
+	const Com::CIndexedArray& color = ea.GetColoring( field_disp.GetIdElemSeg(id_ea,CORNER,true,world) );
+	mat_dd.MakeMargeTmpBuffer();	// one merge buffer for each thread
+	for(unsigned int icolor=0;icolor<color.Size();icolor++){
+#if defined(_OPENMP)
+#pragma omp parallel for
+#endif
+	for(int iie=(int)color.index[icolor];iie<(int)color.index[icolor+1];iie++){
+		const unsigned int ielem = color.array[iie];
 		unsigned int no[nno];
 		es_c_co.GetNodes(ielem,no);
 		double coord[nno][ndim];
@@ -732,6 +759,7 @@ static bool AddLinearSystem_DKT3D_Linear_P1_Combined(
 			res_d.AddValue(no[ino],5,eres_t[ino][2]);
 		}
 	}
+	}
 	return true;
 }
 
@@ -839,8 +867,22 @@ static bool AddLinearSystem_DKT3D_Linear_P1_Save(
 	const CNodeAry::CNodeSeg& ns_c_r = field_rot.GetNodeSeg(CORNER,true,world);
 	const CNodeAry::CNodeSeg& ns_c_co  = field_disp.GetNodeSeg(CORNER,false,world);
 
-	for(unsigned int ielem=0;ielem<ea.Size();ielem++)
-	{
+	// elements of one color do not share a node, so they can be merged at the same time
+	const Com::CIndexedArray& color = ea.GetColoring( field_disp.GetIdElemSeg(id_ea,CORNER,true,world) );
+	mat_dd.MakeMargeTmpBuffer();	// one merge buffer for each thread
+	mat_dt.MakeMargeTmpBuffer();
+	mat_td.MakeMargeTmpBuffer();
+	mat_tt.MakeMargeTmpBuffer();
+	mat_dd_bound.MakeMargeTmpBuffer();
+	mat_dt_bound.MakeMargeTmpBuffer();
+	mat_td_bound.MakeMargeTmpBuffer();
+	mat_tt_bound.MakeMargeTmpBuffer();
+	for(unsigned int icolor=0;icolor<color.Size();icolor++){
+#if defined(_OPENMP)
+#pragma omp parallel for
+#endif
+	for(int iie=(int)color.index[icolor];iie<(int)color.index[icolor+1];iie++){
+		const unsigned int ielem = color.array[iie];
 		unsigned int no[nno];
 		es_c_co.GetNodes(ielem,no);
 		double coord[nno][ndim];
@@ -942,6 +984,7 @@ static bool AddLinearSystem_DKT3D_Linear_P1_Save(
 			force_d.AddValue(no[ino],2,eforce_d[ino][2]);
 		}
 	}
+	}
 	return true;
 }
 
@@ -985,8 +1028,16 @@ static bool AddLinearSystem_DKT3D_Linear_P1_Save_Combined(
 	const CNodeAry::CNodeSeg& ns_c_r = field_rot.GetNodeSeg(CORNER,true,world);
 	const CNodeAry::CNodeSeg& ns_c_co  = field_disp.GetNodeSeg(CORNER,false,world);
 
-	for(unsigned int ielem=0;ielem<ea.Size();ielem++)
-	{
+	// elements of one color do not share a node, so they can be merged at the same time
+	const Com::CIndexedArray& color = ea.GetColoring( field_disp.GetIdElemSeg(id_ea,CORNER,true,world) );
+	mat_dd.MakeMargeTmpBuffer();	// one merge buffer for each thread
+	mat_dd_bound.MakeMargeTmpBuffer();
+	for(unsigned int icolor=0;icolor<color.Size();icolor++){
+#if defined(_OPENMP)
+#pragma omp parallel for
+#endif
+	for(int iie=(int)color.index[icolor];iie<(int)color.index[icolor+1];iie++){
+		const unsigned int ielem = color.array[iie];
 		unsigned int no[nno];
 		es_c_co.GetNodes(ielem,no);
 		double coord[nno][ndim];
@@ -1094,6 +1145,7 @@ static bool AddLinearSystem_DKT3D_Linear_P1_Save_Combined(
 			force_d.AddValue(no[ino],2,eforce_d[ino][2]);
 		}
 	}
+	}
 	return true;
 }
 
@@ -1205,8 +1257,18 @@ static bool AddLinearSystem_DKT3D_LinearNonStatic_P1(
 	const CNodeAry::CNodeSeg& ns_c_ra = field_rot.GetNodeSeg( CORNER,true,world,ACCELERATION);
 	const CNodeAry::CNodeSeg& ns_c_co = field_disp.GetNodeSeg(CORNER,false,world);
 
-	for(unsigned int ielem=0;ielem<ea.Size();ielem++)
-	{
+	// elements of one color do not share a node, so they can be merged at the same time
+	const Com::CIndexedArray& color = ea.GetColoring( field_disp.GetIdElemSeg(id_ea,CORNER,true,world) );
+	mat_dd.MakeMargeTmpBuffer();	// one merge buffer for each thread
+	mat_dt.MakeMargeTmpBuffer();
+	mat_td.MakeMargeTmpBuffer();
+	mat_tt.MakeMargeTmpBuffer();
+	for(unsigned int icolor=0;icolor<color.Size();icolor++){
+#if defined(_OPENMP)
+#pragma omp parallel for
+#endif
+	for(int iie=(int)color.index[icolor];iie<(int)color.index[icolor+1];iie++){
+		const unsigned int ielem = color.array[iie];
 		unsigned int no[nno];
 		es_c_co.GetNodes(ielem,no);
 		double coord[nno][ndim];
@@ -1386,6 +1448,7 @@ static bool AddLinearSystem_DKT3D_LinearNonStatic_P1(
 			res_t.AddValue(no[ino],2,eres_t[ino][2]);
 		}
 	}
+	}
 	return true;
 }
 
@@ -1434,8 +1497,15 @@ static bool AddLinearSystem_DKT3D_LinearNonStatic_P1_Combined(
 	const CNodeAry::CNodeSeg& ns_c_ra = field_rot.GetNodeSeg( CORNER,true,world,ACCELERATION);
 	const CNodeAry::CNodeSeg& ns_c_co = field_disp.GetNodeSeg(CORNER,false,world);
 
-	for(unsigned int ielem=0;ielem<ea.Size();ielem++)
-	{
+	// elements of one color do not share a node, so they can be merged at the same time
+	const Com::CIndexedArray& color = ea.GetColoring( field_disp.GetIdElemSeg(id_ea,CORNER,true,world) );
+	mat_dd.MakeMargeTmpBuffer();	// one merge buffer for each thread
+	for(unsigned int icolor=0;icolor<color.Size();icolor++){
+#if defined(_OPENMP)
+#pragma omp parallel for
+#endif
+	for(int iie=(int)color.index[icolor];iie<(int)color.index[icolor+1];iie++){
+		const unsigned int ielem = color.array[iie];
 		unsigned int no[nno];
 		es_c_co.GetNodes(ielem,no);
 		double coord[nno][ndim];
@@ -1623,6 +1693,7 @@ static bool AddLinearSystem_DKT3D_LinearNonStatic_P1_Combined(
 			res_d.AddValue(no[ino],5,eres_t[ino][2]);
 		}
 	}
+	}
 	return true;
 }
 
@@ -1916,8 +1987,16 @@ static bool AddLinearSystem_DKT3D_LinearNonStatic_P1_Save_Combined(
 	const CNodeAry::CNodeSeg& ns_c_ra = field_rot.GetNodeSeg( CORNER,true,world,ACCELERATION);
 	const CNodeAry::CNodeSeg& ns_c_co = field_disp.GetNodeSeg(CORNER,false,world);
 
-	for(unsigned int ielem=0;ielem<ea.Size();ielem++)
-	{
+	// elements of one color do not share a node, so they can be merged at the same time
+	const Com::CIndexedArray& color = ea.GetColoring( field_disp.GetIdElemSeg(id_ea,CORNER,true,world) );
+	mat_dd_bound.MakeMargeTmpBuffer();	// one merge buffer for each thread
+	mat_dd.MakeMargeTmpBuffer();
+	for(unsigned int icolor=0;icolor<color.Size();icolor++){
+#if defined(_OPENMP)
+#pragma omp parallel for
+#endif
+	for(int iie=(int)color.index[icolor];iie<(int)color.index[icolor+1];iie++){
+		const unsigned int ielem = color.array[iie];
 		unsigned int no[nno];
 		es_c_co.GetNodes(ielem,no);
 		double coord[nno][ndim];
@@ -2074,6 +2153,7 @@ static bool AddLinearSystem_DKT3D_LinearNonStatic_P1_Save_Combined(
 			force_d.AddValue(no[ino],2,eforce_d[ino][2]);
 		}
 	}
+	}
 	return true;
 }
 
@@ -2914,8 +2994,18 @@ static bool AddLinearSystem_DKT3D_NonLinear_Static_P1(
 	const CNodeAry::CNodeSeg& ns_c_r = field_rot.GetNodeSeg(CORNER,true,world);
 	const CNodeAry::CNodeSeg& ns_c_co  = field_disp.GetNodeSeg(CORNER,false,world);
 
-	for(unsigned int ielem=0;ielem<ea.Size();ielem++)
-	{
+	// elements of one color do not share a node, so they can be merged at the same time
+	const Com::CIndexedArray& color = ea.GetColoring( field_disp.GetIdElemSeg(id_ea,CORNER,true,world) );
+	mat_dd.MakeMargeTmpBuffer();	// one merge buffer for each thread
+	mat_dt.MakeMargeTmpBuffer();
+	mat_td.MakeMargeTmpBuffer();
+	mat_tt.MakeMargeTmpBuffer();
+	for(unsigned int icolor=0;icolor<color.Size();icolor++){
+#if defined(_OPENMP)
+#pragma omp parallel for
+#endif
+	for(int iie=(int)color.index[icolor];iie<(int)color.index[icolor+1];iie++){
+		const unsigned int ielem = color.array[iie];
 		unsigned int no[nno];
 		es_c_co.GetNodes(ielem,no);	
 		double cord3d0[nno][ndim];
@@ -2954,6 +3044,7 @@ static bool AddLinearSystem_DKT3D_NonLinear_Static_P1(
 			res_t.AddValue(no[ino],2,eres_t[ino][2]);
 		}
 	}
+	}
 	return true;
 }
 
@@ -2993,8 +3084,15 @@ static bool AddLinearSystem_DKT3D_NonLinear_Static_P1_Combined(
 	const CNodeAry::CNodeSeg& ns_c_r = field_rot.GetNodeSeg(CORNER,true,world);
 	const CNodeAry::CNodeSeg& ns_c_co  = field_disp.GetNodeSeg(CORNER,false,world);
 
-	for(unsigned int ielem=0;ielem<ea.Size();ielem++)
-	{
+	// elements of one color do not share a node, so they can be merged at the same time
+	const Com::CIndexedArray& color = ea.GetColoring( field_disp.GetIdElemSeg(id_ea,CORNER,true,world) );
+	mat_dd.MakeMargeTmpBuffer();	// one merge buffer for each thread
+	for(unsigned int icolor=0;icolor<color.Size();icolor++){
+#if defined(_OPENMP)
+#pragma omp parallel for
+#endif
+	for(int iie=(int)color.index[icolor];iie<(int)color.index[icolor+1];iie++){
+		const unsigned int ielem = color.array[iie];
 		unsigned int no[nno];
 		es_c_co.GetNodes(ielem,no);	
 		double cord3d0[nno][ndim];
@@ -3041,6 +3139,7 @@ static bool AddLinearSystem_DKT3D_NonLinear_Static_P1_Combined(
 			res_d.AddValue(no[ino],5,eres_t[ino][2]);
 		}
 	}
+	}
 
 	return true;
 }
@@ -3155,8 +3254,18 @@ static bool AddLinearSystem_DKT3D_NonLinear_NonStatic_P1(
 	const CNodeAry::CNodeSeg& ns_c_ra = field_rot.GetNodeSeg( CORNER,true,world,ACCELERATION);
 	const CNodeAry::CNodeSeg& ns_c_co  = field_disp.GetNodeSeg(CORNER,false,world);
 
-	for(unsigned int ielem=0;ielem<ea.Size();ielem++)
-	{
+	// elements of one color do not share a node, so they can be merged at the same time
+	const Com::CIndexedArray& color = ea.GetColoring( field_disp.GetIdElemSeg(id_ea,CORNER,true,world) );
+	mat_dd.MakeMargeTmpBuffer();	// one merge buffer for each thread
+	mat_dt.MakeMargeTmpBuffer();
+	mat_td.MakeMargeTmpBuffer();
+	mat_tt.MakeMargeTmpBuffer();
+	for(unsigned int icolor=0;icolor<color.Size();icolor++){
+#if defined(_OPENMP)
+#pragma omp parallel for
+#endif
+	for(int iie=(int)color.index[icolor];iie<(int)color.index[icolor+1];iie++){
+		const unsigned int ielem = color.array[iie];
 		unsigned int no[nno];
 		es_c_co.GetNodes(ielem,no);	
 		double cord3d0[nno][ndim];
@@ -3263,6 +3372,7 @@ static bool AddLinearSystem_DKT3D_NonLinear_NonStatic_P1(
 			res_t.AddValue(no[ino],2,eres_t[ino][2]);
 		}
 	}
+	}
 	return true;
 }
 
@@ -3309,8 +3419,15 @@ static bool AddLinearSystem_DKT3D_NonLinear_NonStatic_P1_Combined(
 	const CNodeAry::CNodeSeg& ns_c_ra = field_rot.GetNodeSeg( CORNER,true,world,ACCELERATION);
 	const CNodeAry::CNodeSeg& ns_c_co  = field_disp.GetNodeSeg(CORNER,false,world);
 
-	for(unsigned int ielem=0;ielem<ea.Size();ielem++)
-	{
+	// elements of one color do not share a node, so they can be merged at the same time
+	const Com::CIndexedArray& color = ea.GetColoring( field_disp.GetIdElemSeg(id_ea,CORNER,true,world) );
+	mat_dd.MakeMargeTmpBuffer();	// one merge buffer for each thread
+	for(unsigned int icolor=0;icolor<color.Size();icolor++){
+#if defined(_OPENMP)
+#pragma omp parallel for
+#endif
+	for(int iie=(int)color.index[icolor];iie<(int)color.index[icolor+1];iie++){
+		const unsigned int ielem = color.array[iie];
 		unsigned int no[nno];
 		es_c_co.GetNodes(ielem,no);	
 		double cord3d0[nno][ndim];
@@ -3419,6 +3536,7 @@ static bool AddLinearSystem_DKT3D_NonLinear_NonStatic_P1_Combined(
 			res_d.AddValue(no[ino],5,eres_t[ino][2]);
 		}
 	}
+	}
 	return true;
 }
 
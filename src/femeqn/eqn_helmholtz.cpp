@@ -676,3 +676,236 @@ bool Fem::Eqn::AddLinSys_SommerfeltRadiationBC_AxalSym(
 
 	return true;
 }
+
+
+
+
+////////////////////////////////////////////////////////////////
+// frequency sweep
+////////////////////////////////////////////////////////////////
+
+void Fem::Eqn::GetSweepCoeff_Helmholtz(double wave_length, Com::Complex coeff[4])
+{
+	const double k = 2*3.1416/wave_length;
+	coeff[0] = 1.0;
+	coeff[1] = -k*k;
+	coeff[2] = k;
+	coeff[3] = 1.0/k;
+}
+
+static bool AddLinearSystem_Helmholtz2D_P1_Sweep(
+		CZLinearSystem_Sweep& ls, 
+		const unsigned int id_field_val, const CFieldWorld& world, int* tmp_buffer, 
+		const unsigned int id_ea )
+{
+	assert( world.IsIdEA(id_ea) );
+	const CElemAry& ea = world.GetEA(id_ea);
+	assert( ea.ElemType() == TRI );
+
+	if( !world.IsIdField(id_field_val) ) return false;
+	const CField& field_val = world.GetField(id_field_val);
+
+	const CElemAry::CElemSeg& es_c_va = field_val.GetElemSeg(id_ea,CORNER,true, world);
+	const CElemAry::CElemSeg& es_c_co = field_val.GetElemSeg(id_ea,CORNER,false,world);
+
+	const unsigned int nno = 3;
+	const unsigned int ndim = 2;
+
+	CZMatDia_BlkCrs* mat_k = ls.GetTermMatrixPtr(0,id_field_val,CORNER,world); assert( mat_k!=0 );	// stiffness
+	CZMatDia_BlkCrs* mat_m = ls.GetTermMatrixPtr(1,id_field_val,CORNER,world); assert( mat_m!=0 );	// mass
+	CZVector_Blk* res_k = ls.GetTermResidualPtr(0,id_field_val,CORNER,world); assert( res_k!=0 );
+	CZVector_Blk* res_m = ls.GetTermResidualPtr(1,id_field_val,CORNER,world); assert( res_m!=0 );
+
+	const CNodeAry::CNodeSeg& ns_c_val = field_val.GetNodeSeg(CORNER,true,world);
+	const CNodeAry::CNodeSeg& ns_c_co  = field_val.GetNodeSeg(CORNER,false,world);
+
+	for(unsigned int ielem=0;ielem<ea.Size();ielem++){
+		unsigned int no_c[nno];
+		es_c_co.GetNodes(ielem,no_c);
+		double coord_c[nno][ndim];
+		for(unsigned int inoes=0;inoes<nno;inoes++){
+			ns_c_co.GetValue(no_c[inoes],coord_c[inoes]);
+		}
+		es_c_va.GetNodes(ielem,no_c);
+		Com::Complex value_c[nno];
+		for(unsigned int inoes=0;inoes<nno;inoes++){
+			ns_c_val.GetValue(no_c[inoes],&value_c[inoes]);
+		}
+
+		const double area = TriArea(coord_c[0],coord_c[1],coord_c[2]);
+		double dldx[nno][ndim];
+		double const_term[nno];
+		TriDlDx(dldx,const_term,coord_c[0],coord_c[1],coord_c[2]);
+		Com::Complex emat_k[nno][nno], emat_m[nno][nno];
+		for(unsigned int ino=0;ino<nno;ino++){
+		for(unsigned int jno=0;jno<nno;jno++){
+			emat_k[ino][jno] = area*(dldx[ino][0]*dldx[jno][0]+dldx[ino][1]*dldx[jno][1]);
+			emat_m[ino][jno] = ( ino == jno ) ? area/6.0 : area/12.0;
+		}
+		}
+		mat_k->Mearge(nno,no_c,nno,no_c,1,&emat_k[0][0],tmp_buffer);
+		mat_m->Mearge(nno,no_c,nno,no_c,1,&emat_m[0][0],tmp_buffer);
+		for(unsigned int ino=0;ino<nno;ino++){
+			Com::Complex eres_k = 0.0, eres_m = 0.0;
+			for(unsigned int jno=0;jno<nno;jno++){
+				eres_k -= emat_k[ino][jno]*value_c[jno];
+				eres_m -= emat_m[ino][jno]*value_c[jno];
+			}
+			res_k->AddValue(no_c[ino],0,eres_k);
+			res_m->AddValue(no_c[ino],0,eres_m);
+		}
+	}
+	return true;
+}
+
+bool Fem::Eqn::AddLinSys_Helmholtz_Sweep(
+		CZLinearSystem_Sweep& ls,
+		const CFieldWorld& world,
+		const unsigned int id_field_val,
+		unsigned int id_ea )
+{
+	if( !world.IsIdField(id_field_val) ) return false;
+	const CField& val_field = world.GetField(id_field_val);
+
+	if( val_field.GetFieldType() != ZSCALAR ) return false;
+	if( ls.NTerm() < 2 ) return false;
+
+	if( id_ea != 0 ){
+		const unsigned int ntmp = ls.GetTmpBufferSize();
+		int* tmp_buffer = new int [ntmp];
+		for(unsigned int itmp=0;itmp<ntmp;itmp++){ tmp_buffer[itmp] = -1; }
+		bool res = false;
+		if( val_field.GetInterpolationType(id_ea,world) == TRI11 ){
+			res = AddLinearSystem_Helmholtz2D_P1_Sweep(ls,
+				id_field_val,world,tmp_buffer,id_ea);
+		}
+		else{
+			std::cout << "Error!-->Not Implimented" << std::endl;
+		}
+		delete[] tmp_buffer;
+		return res;
+	}
+	else{
+		const std::vector<unsigned int> aIdEA = val_field.GetAryIdEA();
+		for(unsigned int iiea=0;iiea<aIdEA.size();iiea++){
+			const unsigned int id_ea = aIdEA[iiea];
+			bool res = Fem::Eqn::AddLinSys_Helmholtz_Sweep(
+					ls,
+					world,
+					id_field_val,
+					id_ea );
+			if( !res ) return false;
+		}
+		return true;
+	}
+
+	return true;
+}
+
+static bool AddLinearSystem_SommerfeltRadiationBC2D_B1_Sweep(
+		CZLinearSystem_Sweep& ls, 
+		const unsigned int id_field_val, const CFieldWorld& world, int* tmp_buffer, 
+		const unsigned int id_ea )
+{
+	assert( world.IsIdEA(id_ea) );
+	const CElemAry& ea = world.GetEA(id_ea);
+	assert( ea.ElemType() == LINE );
+
+	if( !world.IsIdField(id_field_val) ) return false;
+	const CField& field_val = world.GetField(id_field_val);
+
+	const CElemAry::CElemSeg& es_c_va = field_val.GetElemSeg(id_ea,CORNER,true, world);
+	const CElemAry::CElemSeg& es_c_co = field_val.GetElemSeg(id_ea,CORNER,false,world);
+
+	const unsigned int nno = 2;
+	const unsigned int ndim = 2;
+
+	CZMatDia_BlkCrs* mat_b1 = ls.GetTermMatrixPtr(2,id_field_val,CORNER,world); assert( mat_b1!=0 );	// coefficient k
+	CZMatDia_BlkCrs* mat_b2 = ls.GetTermMatrixPtr(3,id_field_val,CORNER,world); assert( mat_b2!=0 );	// coefficient 1/k
+	CZVector_Blk* res_b1 = ls.GetTermResidualPtr(2,id_field_val,CORNER,world); assert( res_b1!=0 );
+	CZVector_Blk* res_b2 = ls.GetTermResidualPtr(3,id_field_val,CORNER,world); assert( res_b2!=0 );
+
+	const CNodeAry::CNodeSeg& ns_c_val = field_val.GetNodeSeg(CORNER,true,world);
+	const CNodeAry::CNodeSeg& ns_c_co  = field_val.GetNodeSeg(CORNER,false,world);
+
+	for(unsigned int ielem=0;ielem<ea.Size();ielem++){
+		unsigned int no_c[nno];
+		es_c_co.GetNodes(ielem,no_c);
+		double coord_c[nno][ndim];
+		for(unsigned int inoes=0;inoes<nno;inoes++){
+			ns_c_co.GetValue(no_c[inoes],coord_c[inoes]);
+		}
+		es_c_va.GetNodes(ielem,no_c);
+		Com::Complex value_c[nno];
+		for(unsigned int inoes=0;inoes<nno;inoes++){
+			ns_c_val.GetValue(no_c[inoes],&value_c[inoes]);
+		}
+		const double elen = sqrt( (coord_c[0][0]-coord_c[1][0])*(coord_c[0][0]-coord_c[1][0]) + (coord_c[0][1]-coord_c[1][1])*(coord_c[0][1]-coord_c[1][1]) );
+
+		Com::Complex emat_b1[nno][nno], emat_b2[nno][nno];
+		{
+			const Com::Complex tmp_val1 = (elen/6.0)*Com::Complex(0,1);
+			const Com::Complex tmp_val2 = -1/(2.0*elen)*Com::Complex(0,1);
+			emat_b1[0][0] = tmp_val1*2;  emat_b1[0][1] = tmp_val1;
+			emat_b1[1][0] = tmp_val1;    emat_b1[1][1] = tmp_val1*2;
+			emat_b2[0][0] = tmp_val2;    emat_b2[0][1] = -tmp_val2;
+			emat_b2[1][0] = -tmp_val2;   emat_b2[1][1] = tmp_val2;
+		}
+		mat_b1->Mearge(nno,no_c,nno,no_c,1,&emat_b1[0][0],tmp_buffer);
+		mat_b2->Mearge(nno,no_c,nno,no_c,1,&emat_b2[0][0],tmp_buffer);
+		for(unsigned int ino=0;ino<nno;ino++){
+			Com::Complex eres_b1 = 0.0, eres_b2 = 0.0;
+			for(unsigned int jno=0;jno<nno;jno++){
+				eres_b1 -= emat_b1[ino][jno]*value_c[jno];
+				eres_b2 -= emat_b2[ino][jno]*value_c[jno];
+			}
+			res_b1->AddValue(no_c[ino],0,eres_b1);
+			res_b2->AddValue(no_c[ino],0,eres_b2);
+		}
+	}
+	return true;
+}
+
+bool Fem::Eqn::AddLinSys_SommerfeltRadiationBC_Sweep(
+		Fem::Ls::CZLinearSystem_Sweep& ls,
+		const Fem::Field::CFieldWorld& world,
+		unsigned int id_field_val,
+		unsigned int id_ea )
+{
+	if( !world.IsIdField(id_field_val) ) return false;
+	const CField& val_field = world.GetField(id_field_val);
+
+	if( val_field.GetFieldType() != ZSCALAR ) return false;
+	if( ls.NTerm() < 4 ) return false;
+
+	if( id_ea != 0 ){
+		const unsigned int ntmp = ls.GetTmpBufferSize();
+		int* tmp_buffer = new int [ntmp];
+		for(unsigned int itmp=0;itmp<ntmp;itmp++){ tmp_buffer[itmp] = -1; }
+		bool res = false;
+		if( val_field.GetInterpolationType(id_ea,world) == LINE11 ){
+			res = AddLinearSystem_SommerfeltRadiationBC2D_B1_Sweep(ls,
+				id_field_val,world,tmp_buffer,id_ea);
+		}
+		else{
+			std::cout << "Error!-->Not Implimented" << std::endl;
+		}
+		delete[] tmp_buffer;
+		return res;
+	}
+	else{
+		const std::vector<unsigned int> aIdEA = val_field.GetAryIdEA();
+		for(unsigned int iiea=0;iiea<aIdEA.size();iiea++){
+			const unsigned int id_ea = aIdEA[iiea];
+			bool res = Fem::Eqn::AddLinSys_SommerfeltRadiationBC_Sweep(
+					ls,
+					world,
+					id_field_val,
+					id_ea );
+			if( !res ) return false;
+		}
+		return true;
+	}
+
+	return true;
+}
@@ -26,7 +26,9 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #if defined(__VISUALC__)
     #pragma warning ( disable : 4786 )
 #endif
+#if !defined(_OPENMP)
 #define for if(0);else for
+#endif
 
 #include "delfem/matvec/matdia_blkcrs.h"
 #include "delfem/matvec/vector_blk.h"
@@ -363,7 +365,6 @@ bool AddLinSys_Hyper2D_P1bP1(
 	unsigned int num_integral = 2;
 	const unsigned int nInt = NIntTriGauss[num_integral];
 	const double (*Gauss)[3] = TriGauss[num_integral];
-	double detwei;
 
 	const CElemAry::CElemSeg& es_c_co = field_disp.GetElemSeg(  id_ea,CORNER,false,world);
 	const CElemAry::CElemSeg& es_cu   = field_disp.GetElemSeg(  id_ea,CORNER,true, world);
@@ -374,35 +375,6 @@ bool AddLinSys_Hyper2D_P1bP1(
 	const unsigned int nno_b = 1;
 	const unsigned int ndim = 2;
 
-	unsigned int noes_c[nno_c];	// vfߓ_̑S̐ߓ_ԍ
-	unsigned int noes_b;	// vfߓ_̑S̐ߓ_ԍ
-
-	double disp_c[nno_c][ndim];	// vfߓ_̒l
-	double disp_b[ndim];	// vfߓ_̒l
-	double press_c[nno_c];
-	double coords[nno_c][ndim];	// vfߓ_̍W
-				
-	double dldx[nno_c][ndim];	// `֐xy
-	double const_term[nno_c];	// `֐̒萔
-	double dncdx[nno_c][ndim];
-	double dnbdx[ndim];
-	double am[nno_c];
-
-	double emat_cucu[nno_c][nno_c][ndim][ndim];
-	double emat_cubu[nno_c][ndim][ndim];
-	double emat_cup[nno_c][nno_c][ndim];
-
-	double emat_bubu[ndim][ndim];
-	double emat_bucu[nno_c][ndim][ndim];
-	double emat_bup[nno_c][ndim];
-
-	double emat_pcu[nno_c][nno_c][ndim];
-	double emat_pbu[nno_c][ndim];
-	double emat_pp[nno_c][nno_c];
-
-	double eres_cu[nno_c][ndim], eres_bu[ndim], eres_p[nno_c];
-	double eqf_in_cu[nno_c][ndim], eqf_in_bu[ndim], eqf_in_p[nno_c];
-
 	CMatDia_BlkCrs& mat_cucu = ls.GetMatrix(id_field_disp,  CORNER,world);
 	CMatDia_BlkCrs& mat_bubu = ls.GetMatrix(id_field_disp,  BUBBLE,world);
 	CMatDia_BlkCrs& mat_pp   = ls.GetMatrix(id_field_lambda,CORNER,world);
@@ -423,7 +395,46 @@ bool AddLinSys_Hyper2D_P1bP1(
 	const CNodeAry::CNodeSeg& ns_bu  = field_disp.GetNodeSeg(  BUBBLE,true, world,VALUE);//na_velo.GetSeg(id_ns_velo);
 	const CNodeAry::CNodeSeg& ns_p   = field_lambda.GetNodeSeg(CORNER,true, world,VALUE);//na_press.GetSeg(id_ns_press);
 
-    for(unsigned int ielem=0;ielem<ea.Size();ielem++){
+	// elements of one color do not share a node, so they can be merged at the same time
+	const Com::CIndexedArray& color = ea.GetColoring( field_disp.GetIdElemSeg(id_ea,CORNER,true,world) );
+	mat_cucu.MakeMargeTmpBuffer();	// one merge buffer for each thread
+	mat_cubu.MakeMargeTmpBuffer();
+	mat_bucu.MakeMargeTmpBuffer();
+	mat_bubu.MakeMargeTmpBuffer();
+	mat_cup.MakeMargeTmpBuffer();
+	mat_pcu.MakeMargeTmpBuffer();
+	mat_bup.MakeMargeTmpBuffer();
+	mat_pbu.MakeMargeTmpBuffer();
+	mat_pp.MakeMargeTmpBuffer();
+	for(unsigned int icolor=0;icolor<color.Size();icolor++){
+#if defined(_OPENMP)
+#pragma omp parallel for
+#endif
+	for(int iie=(int)color.index[icolor];iie<(int)color.index[icolor+1];iie++){
+		const unsigned int ielem = color.array[iie];
+		double detwei;
+		unsigned int noes_c[nno_c];	// vfߓ_̑S̐ߓ_ԍ
+		unsigned int noes_b;	// vfߓ_̑S̐ߓ_ԍ
+		double disp_c[nno_c][ndim];	// vfߓ_̒l
+		double disp_b[ndim];	// vfߓ_̒l
+		double press_c[nno_c];
+		double coords[nno_c][ndim];	// vfߓ_̍W
+		double dldx[nno_c][ndim];	// `֐xy
+		double const_term[nno_c];	// `֐̒萔
+		double dncdx[nno_c][ndim];
+		double dnbdx[ndim];
+		double am[nno_c];
+		double emat_cucu[nno_c][nno_c][ndim][ndim];
+		double emat_cubu[nno_c][ndim][ndim];
+		double emat_cup[nno_c][nno_c][ndim];
+		double emat_bubu[ndim][ndim];
+		double emat_bucu[nno_c][ndim][ndim];
+		double emat_bup[nno_c][ndim];
+		double emat_pcu[nno_c][nno_c][ndim];
+		double emat_pbu[nno_c][ndim];
+		double emat_pp[nno_c][nno_c];
+		double eres_cu[nno_c][ndim], eres_bu[ndim], eres_p[nno_c];
+		double eqf_in_cu[nno_c][ndim], eqf_in_bu[ndim], eqf_in_p[nno_c];
 		// CORNERߓ_̍W̎擾
 		es_c_co.GetNodes(ielem,noes_c);
 		for(unsigned int inoes=0;inoes<nno_c;inoes++){
@@ -718,6 +729,7 @@ bool AddLinSys_Hyper2D_P1bP1(
 		}
 
 	}
+	}
 
 	return true;
 }
@@ -918,23 +930,12 @@ bool AddLinSys_Hyper3D_HEX100100_000010(
 	unsigned int num_integral = 1;
 	const unsigned int nInt = NIntLineGauss[num_integral];
 	const double (*Gauss)[2] = LineGauss[num_integral];
-	double detjac, detwei;
 
 	const unsigned int nno_c = 8;	assert( nno_c == es_cu.Length() );
 	const unsigned int nno_b = 1;	assert( nno_b == es_bp.Length() );
 	const unsigned int ndim = 3;
 	const unsigned int nstdim = 6;	// Ώ̃e\̎
 
-	unsigned int noes_cu[nno_c];	// vf̐ߓ_̐ߓ_ԍ
-	unsigned int noes_bp;
-
-	double emat_cucu[nno_c][nno_c][ndim][ndim];	// vfs
-	double emat_cubp[nno_c][ndim];	// vfs
-	double emat_bpcu[nno_c][ndim];	// vfs
-    double emat_bpbp;
-	double eres_cu[nno_c][ndim];		// vfcxNg
-	double eres_bp;
-
 	CMatDia_BlkCrs& mat_cucu = ls.GetMatrix(id_field_disp,  CORNER, world);
 	CMatDia_BlkCrs& mat_bpbp = ls.GetMatrix(id_field_lambda,BUBBLE, world);
 	CMat_BlkCrs& mat_cubp = ls.GetMatrix(id_field_disp,CORNER,   id_field_lambda,BUBBLE, world);
@@ -952,7 +953,26 @@ bool AddLinSys_Hyper3D_HEX100100_000010(
 	const CNodeAry::CNodeSeg& ns_c_co = field_disp.GetNodeSeg(  CORNER,false,world,VALUE);
 	const CNodeAry::CNodeSeg& ns_bpv  = field_lambda.GetNodeSeg(BUBBLE,true, world,VALUE);
 
-	for(unsigned int ielem=0;ielem<ea.Size();ielem++){
+	// elements of one color do not share a node, so they can be merged at the same time
+	const Com::CIndexedArray& color = ea.GetColoring( field_disp.GetIdElemSeg(id_ea,CORNER,true,world) );
+	mat_cucu.MakeMargeTmpBuffer();	// one merge buffer for each thread
+	mat_cubp.MakeMargeTmpBuffer();
+	mat_bpcu.MakeMargeTmpBuffer();
+	mat_bpbp.MakeMargeTmpBuffer();
+	for(unsigned int icolor=0;icolor<color.Size();icolor++){
+#if defined(_OPENMP)
+#pragma omp parallel for
+#endif
+	for(int iie=(int)color.index[icolor];iie<(int)color.index[icolor+1];iie++){
+		const unsigned int ielem = color.array[iie];
+		unsigned int noes_cu[nno_c];	// node index of the element
+		unsigned int noes_bp;
+		double emat_cucu[nno_c][nno_c][ndim][ndim];	// element stiffness matrix
+		double emat_cubp[nno_c][ndim];
+		double emat_bpcu[nno_c][ndim];
+		double emat_bpbp;
+		double eres_cu[nno_c][ndim];		// element residual vector
+		double eres_bp;
 	    double ecoords[nno_c][ndim];		// vfߓ_W
 	    double edisp[  nno_c][ndim];		// vfߓ_ψ
 		es_cu.GetNodes(ielem,noes_cu);
@@ -984,8 +1004,9 @@ bool AddLinSys_Hyper3D_HEX100100_000010(
             ////////////////
 	        double dndx[nno_c][ndim];		// `֐̋Ԕ
         	double an[nno_c];
+			double detjac;
 			ShapeFunc_Hex8(r1,r2,r3,ecoords,detjac,dndx,an);
-			detwei = detjac*Gauss[ir1][1]*Gauss[ir2][1]*Gauss[ir3][1];
+			const double detwei = detjac*Gauss[ir1][1]*Gauss[ir2][1]*Gauss[ir3][1];
 			vol += detwei;
 			// vfsCvf̓xNg
 			double dudx[ndim][ndim];
@@ -1105,6 +1126,7 @@ bool AddLinSys_Hyper3D_HEX100100_000010(
 		}
 		res_bp.AddValue(noes_bp,0,eres_bp);
 	}
+	}
 
 	return true;
 }
@@ -1134,28 +1156,12 @@ bool AddLinSys_Hyper3D_NonStatic_NewmarkBeta_HEX100100_000010(
 	unsigned int num_integral = 1;
 	const unsigned int nInt = NIntLineGauss[num_integral];
 	const double (*Gauss)[2] = LineGauss[num_integral];
-	double detjac, detwei;
 
 	const unsigned int nno_c = 8;	assert( nno_c == es_cu.Length() );
 	const unsigned int nno_b = 1;	assert( nno_b == es_bp.Length() );
 	const unsigned int ndim = 3;
 	const unsigned int nstdim = 6;	// Ώ̃e\̎
 
-	double eKmat_cucu[nno_c][nno_c][ndim][ndim];
-	double eKmat_cubp[nno_c][ndim];
-	double eKmat_bpcu[nno_c][ndim];
-    double eKmat_bpbp;
-	double eMmat_cucu[nno_c][nno_c][ndim][ndim];
-    ////////////////
-	double emat_cucu[nno_c][nno_c][ndim][ndim];	// vfs
-	double emat_cubp[nno_c][ndim];	// vfs
-	double emat_bpcu[nno_c][ndim];	// vfs
-    double emat_bpbp;
-
-	double eres_cu[nno_c][ndim];		// vfcxNg
-	double eres_bp;
-
-				
 	CMatDia_BlkCrs& mat_cucu = ls.GetMatrix(id_field_disp,  CORNER, world);
 	CMatDia_BlkCrs& mat_bpbp = ls.GetMatrix(id_field_lambda,BUBBLE, world);
 	CMat_BlkCrs& mat_cubp = ls.GetMatrix(id_field_disp,CORNER, id_field_lambda,BUBBLE, world);
@@ -1177,8 +1183,30 @@ bool AddLinSys_Hyper3D_NonStatic_NewmarkBeta_HEX100100_000010(
 	const CNodeAry::CNodeSeg& ns_bpv  = field_lambda.GetNodeSeg(BUBBLE,true, world,VELOCITY);
 	const CNodeAry::CNodeSeg& ns_bpa  = field_lambda.GetNodeSeg(BUBBLE,true, world,ACCELERATION);
 
-	for(unsigned int ielem=0;ielem<ea.Size();ielem++)
-    {    
+	// elements of one color do not share a node, so they can be merged at the same time
+	const Com::CIndexedArray& color = ea.GetColoring( field_disp.GetIdElemSeg(id_ea,CORNER,true,world) );
+	mat_cucu.MakeMargeTmpBuffer();	// one merge buffer for each thread
+	mat_cubp.MakeMargeTmpBuffer();
+	mat_bpcu.MakeMargeTmpBuffer();
+	mat_bpbp.MakeMargeTmpBuffer();
+	for(unsigned int icolor=0;icolor<color.Size();icolor++){
+#if defined(_OPENMP)
+#pragma omp parallel for
+#endif
+	for(int iie=(int)color.index[icolor];iie<(int)color.index[icolor+1];iie++){
+		const unsigned int ielem = color.array[iie];
+		double detjac, detwei;
+		double eKmat_cucu[nno_c][nno_c][ndim][ndim];
+		double eKmat_cubp[nno_c][ndim];
+		double eKmat_bpcu[nno_c][ndim];
+		double eKmat_bpbp;
+		double eMmat_cucu[nno_c][nno_c][ndim][ndim];
+		double emat_cucu[nno_c][nno_c][ndim][ndim];	// vfs
+		double emat_cubp[nno_c][ndim];	// vfs
+		double emat_bpcu[nno_c][ndim];	// vfs
+		double emat_bpbp;
+		double eres_cu[nno_c][ndim];		// vfcxNg
+		double eres_bp;
     	unsigned int noes_cu[nno_c];	// vf̐ߓ_̐ߓ_ԍ
 		es_cu.GetNodes(ielem,noes_cu);
 	    double ecoords[nno_c][ndim];	// vfߓ_W
@@ -1441,6 +1469,7 @@ bool AddLinSys_Hyper3D_NonStatic_NewmarkBeta_HEX100100_000010(
 		}
 		res_bp.AddValue(noes_bp,0,eres_bp);
 	}
+	}
 
 	return true;
 }
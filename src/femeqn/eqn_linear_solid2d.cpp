@@ -524,19 +524,24 @@ static bool AddLinSys_LinearSolid2D_Static_P1(
 	const unsigned int nno = 3;		assert( nno == es_co.Length() );
 	const unsigned int ndim = 2;
 
-	unsigned int noes[nno];	// vf̐ߓ_̐ߓ_ԍ
-
-	double emat[nno][nno][ndim][ndim];	// vfs
-	double eres[nno][ndim];		// vfcxNg
-
 	CMatDia_BlkCrs& mat_cc = ls.GetMatrix(  id_field_disp,CORNER,world);
 	CVector_Blk&    res_c  = ls.GetResidual(id_field_disp,CORNER,world);
 
 	const CNodeAry::CNodeSeg& ns_c_disp = field_disp.GetNodeSeg(CORNER,true, world,VALUE);
 	const CNodeAry::CNodeSeg& ns_c_co   = field_disp.GetNodeSeg(CORNER,false,world,VALUE);
 
-	for(unsigned int ielem=0;ielem<ea.Size();ielem++)
-	{		
+	// elements of one color do not share a node, so they can be merged at the same time
+	const Com::CIndexedArray& color = ea.GetColoring( field_disp.GetIdElemSeg(id_ea,CORNER,true,world) );
+	mat_cc.MakeMargeTmpBuffer();	// one merge buffer for each thread
+	for(unsigned int icolor=0;icolor<color.Size();icolor++){
+#if defined(_OPENMP)
+#pragma omp parallel for
+#endif
+	for(int iie=(int)color.index[icolor];iie<(int)color.index[icolor+1];iie++){
+		const unsigned int ielem = color.array[iie];
+		unsigned int noes[nno];	// vf̐ߓ_̐ߓ_ԍ
+		double emat[nno][nno][ndim][ndim];	// vfs
+		double eres[nno][ndim];		// vfcxNg
 		// vf̐ߓ_ԍĂ
 		es_co.GetNodes(ielem,noes);			
 		// ߓ_̍WAlĂ
@@ -593,6 +598,7 @@ static bool AddLinSys_LinearSolid2D_Static_P1(
 			res_c.AddValue(noes[ino],1,eres[ino][1]);
 		}
 	}
+	}
 
 	return true;
 }
@@ -629,9 +635,6 @@ static bool AddLinSys_LinearSolidThermalStress2D_Static_P1(
 	const unsigned int nno = 3;		assert( nno == es_c_disp.Length() );
 	const unsigned int ndim = 2;
 
-	double emat[nno][nno][ndim][ndim];	// vfs
-	double eres[nno][ndim];		// vfcxNg
-	
 	CMatDia_BlkCrs& mat_cc = ls.GetMatrix(  id_field_disp,CORNER,world);
 	CVector_Blk&    res_c  = ls.GetResidual(id_field_disp,CORNER,world);
 
@@ -639,8 +642,17 @@ static bool AddLinSys_LinearSolidThermalStress2D_Static_P1(
 	const CNodeAry::CNodeSeg& ns_c_co  = field_disp.GetNodeSeg(CORNER,false,world,VALUE);
 	const CNodeAry::CNodeSeg& ns_c_tmp = field_temp.GetNodeSeg(CORNER,true, world,VALUE);
 
-	for(unsigned int ielem=0;ielem<ea.Size();ielem++)
-	{
+	// elements of one color do not share a node, so they can be merged at the same time
+	const Com::CIndexedArray& color = ea.GetColoring( field_disp.GetIdElemSeg(id_ea,CORNER,true,world) );
+	mat_cc.MakeMargeTmpBuffer();	// one merge buffer for each thread
+	for(unsigned int icolor=0;icolor<color.Size();icolor++){
+#if defined(_OPENMP)
+#pragma omp parallel for
+#endif
+	for(int iie=(int)color.index[icolor];iie<(int)color.index[icolor+1];iie++){
+		const unsigned int ielem = color.array[iie];
+		double emat[nno][nno][ndim][ndim];	// vfs
+		double eres[nno][ndim];		// vfcxNg
 		unsigned int noes[nno];
 		// vf̐ߓ_ԍĂ
 		es_c_temp.GetNodes(ielem,noes);
@@ -708,6 +720,7 @@ static bool AddLinSys_LinearSolidThermalStress2D_Static_P1(
 			res_c.AddValue(noes[ino],1,eres[ino][1]);
 		}
 	}
+	}
 
 	return true;
 }
@@ -736,24 +749,6 @@ static bool AddLinSys_LinearSolid2D_Static_P1b(
 	const unsigned int nno_b = 1;	assert( nno_b == es_b.Length() );
 	const unsigned int ndim = 2;
 
-	unsigned int noes_c[nno_c];	// vf̐ߓ_̐ߓ_ԍ
-	unsigned int noes_b;
-
-	double emat_cc[nno_c][nno_c][ndim][ndim];	// vfs
-	double emat_cb[nno_c][ndim][ndim];	// vfs
-	double emat_bc[nno_c][ndim][ndim];	// vfs
-	double emat_bb[ndim][ndim];	// vfs
-	
-	double eres_c[nno_c][ndim];		// vfcxNg
-	double eres_b[ndim];		// vfcxNg
-
-	double coords[nno_c][ndim];		// vfߓ_W
-	double disp_c[nno_c][ndim];		// vfߓ_ψ
-	double disp_b[ndim];		// vfߓ_ψ
-
-	double dldx[nno_c][ndim];		// `֐̋Ԕ
-	double zero_order_term[nno_c];	// `֐̒萔
-				
 	CMatDia_BlkCrs& mat_cc = ls.GetMatrix(id_field_disp,CORNER,world);
 	CMatDia_BlkCrs& mat_bb = ls.GetMatrix(id_field_disp,BUBBLE,world);
 	CMat_BlkCrs&    mat_cb = ls.GetMatrix(id_field_disp,CORNER,id_field_disp,BUBBLE,world);
@@ -765,7 +760,31 @@ static bool AddLinSys_LinearSolid2D_Static_P1b(
 	const CNodeAry::CNodeSeg& ns_b_va = field_val.GetNodeSeg(BUBBLE,true,world,VALUE);//.GetSeg(id_ns_c_val);
 	const CNodeAry::CNodeSeg& ns_c_co  = field_val.GetNodeSeg(CORNER,false,world,VALUE);//na_c_co.GetSeg(id_ns_c_co);
 
-	for(unsigned int ielem=0;ielem<ea.Size();ielem++){
+	// elements of one color do not share a node, so they can be merged at the same time
+	const Com::CIndexedArray& color = ea.GetColoring( field_val.GetIdElemSeg(id_ea,CORNER,true,world) );
+	mat_cc.MakeMargeTmpBuffer();	// one merge buffer for each thread
+	mat_cb.MakeMargeTmpBuffer();
+	mat_bc.MakeMargeTmpBuffer();
+	mat_bb.MakeMargeTmpBuffer();
+	for(unsigned int icolor=0;icolor<color.Size();icolor++){
+#if defined(_OPENMP)
+#pragma omp parallel for
+#endif
+	for(int iie=(int)color.index[icolor];iie<(int)color.index[icolor+1];iie++){
+		const unsigned int ielem = color.array[iie];
+		unsigned int noes_c[nno_c];	// vf̐ߓ_̐ߓ_ԍ
+		unsigned int noes_b;
+		double emat_cc[nno_c][nno_c][ndim][ndim];	// vfs
+		double emat_cb[nno_c][ndim][ndim];	// vfs
+		double emat_bc[nno_c][ndim][ndim];	// vfs
+		double emat_bb[ndim][ndim];	// vfs
+		double eres_c[nno_c][ndim];		// vfcxNg
+		double eres_b[ndim];		// vfcxNg
+		double coords[nno_c][ndim];		// vfߓ_W
+		double disp_c[nno_c][ndim];		// vfߓ_ψ
+		double disp_b[ndim];		// vfߓ_ψ
+		double dldx[nno_c][ndim];		// `֐̋Ԕ
+		double zero_order_term[nno_c];	// `֐̒萔
 		es_c.GetNodes(ielem,noes_c);  // vf̐ߓ_ԍĂ
 		for(unsigned int ino=0;ino<nno_c;ino++){ // ߓ_̍WAlĂ
 			ns_c_co.GetValue(noes_c[ino],coords[ino]);
@@ -854,6 +873,7 @@ static bool AddLinSys_LinearSolid2D_Static_P1b(
 		res_b.AddValue(noes_b,0,eres_b[0]);
 		res_b.AddValue(noes_b,1,eres_b[1]);
 	}
+	}
 
 	return true;
 }
@@ -880,14 +900,6 @@ static bool AddLinSys_LinearSolid2D_Static_P1_SaveStiffMat(
 	const unsigned int nno = 3;
 	const unsigned int ndim = 2;
 
-	unsigned int noes[nno];	// vf̐ߓ_̐ߓ_ԍ
-
-	double emat[nno][nno][ndim][ndim];	// vfs
-	double eforce[nno][ndim];		// vfO̓xNg
-
-	double coords[nno][ndim];		// vfߓ_W
-	double disp[  nno][ndim];		// vfߓ_ψ
-
 	CMatDia_BlkCrs& mat_cc  = ls.GetMatrix(id_field_val,CORNER,world);
 	CVector_Blk&    force_c = ls.GetForce( id_field_val,CORNER,world);
 
@@ -896,8 +908,21 @@ static bool AddLinSys_LinearSolid2D_Static_P1_SaveStiffMat(
 	const CNodeAry::CNodeSeg& ns_c_val = field_val.GetNodeSeg(CORNER,true,world,VALUE);
 	const CNodeAry::CNodeSeg& ns_c_co  = field_val.GetNodeSeg(CORNER,false,world,VALUE);
 
-	for(unsigned int ielem=0;ielem<ea.Size();ielem++)
-	{
+	// elements of one color do not share a node, so they can be merged at the same time
+	const Com::CIndexedArray& color = ea.GetColoring( field_val.GetIdElemSeg(id_ea,CORNER,true,world) );
+	mat_cc.MakeMargeTmpBuffer();	// one merge buffer for each thread
+	mat_cc_bound.MakeMargeTmpBuffer();
+	for(unsigned int icolor=0;icolor<color.Size();icolor++){
+#if defined(_OPENMP)
+#pragma omp parallel for
+#endif
+	for(int iie=(int)color.index[icolor];iie<(int)color.index[icolor+1];iie++){
+		const unsigned int ielem = color.array[iie];
+		unsigned int noes[nno];	// vf̐ߓ_̐ߓ_ԍ
+		double emat[nno][nno][ndim][ndim];	// vfs
+		double eforce[nno][ndim];		// vfO̓xNg
+		double coords[nno][ndim];		// vfߓ_W
+		double disp[  nno][ndim];		// vfߓ_ψ
 		// vf̐ߓ_ԍĂ
 		es_co.GetNodes(ielem,noes);
 		// ߓ_̍WAlĂ
@@ -955,6 +980,7 @@ static bool AddLinSys_LinearSolid2D_Static_P1_SaveStiffMat(
 			force_c.AddValue(noes[ino],1,eforce[ino][1]);
 		}
 	}
+	}
 
 	return true;
 }
@@ -979,20 +1005,24 @@ static bool AddLinSys_LinearSolid2D_Eigen_P1(
 	const unsigned int nnoes = 3;	assert( nnoes == es_co.Length() );
 	const unsigned int ndim = 2;
 
-	unsigned int noes[nnoes];	// vf̐ߓ_̐ߓ_ԍ
-
-	double eKmat[nnoes][nnoes][ndim][ndim];
-	double eMmat[nnoes][ndim][ndim];
-
-	double coords[nnoes][ndim];		// vfߓ_W
-
 	CMatDia_BlkCrs& Kmat = ls.GetMatrix(       id_field_disp,CORNER,world);
 	CDiaMat_Blk&    Mmat = ls.GetDiaMassMatrix(id_field_disp,CORNER,world);
 
 	const CNodeAry::CNodeSeg& ns_c_co  = field_val.GetNodeSeg(CORNER,false,world);
 
-	for(unsigned int ielem=0;ielem<ea.Size();ielem++)
-	{
+	// elements of one color do not share a node, so they can be merged at the same time
+	const Com::CIndexedArray& color = ea.GetColoring( field_val.GetIdElemSeg(id_ea,CORNER,false,world) );
+	Kmat.MakeMargeTmpBuffer();	// one merge buffer for each thread
+	for(unsigned int icolor=0;icolor<color.Size();icolor++){
+#if defined(_OPENMP)
+#pragma omp parallel for
+#endif
+	for(int iie=(int)color.index[icolor];iie<(int)color.index[icolor+1];iie++){
+		const unsigned int ielem = color.array[iie];
+		unsigned int noes[nnoes];	// vf̐ߓ_̐ߓ_ԍ
+		double eKmat[nnoes][nnoes][ndim][ndim];
+		double eMmat[nnoes][ndim][ndim];
+		double coords[nnoes][ndim];		// vfߓ_W
 		// vf̐ߓ_ԍĂ
 		es_co.GetNodes(ielem,noes);
 		// ߓ_̍WĂ
@@ -1046,6 +1076,7 @@ static bool AddLinSys_LinearSolid2D_Eigen_P1(
 			Mmat.Mearge(noes[ino],ndim*ndim,&eMmat[ino][0][0]);
 		}
 	}
+	}
 	return true;
 }
 
@@ -1070,13 +1101,6 @@ static bool AddLinSys_LinearSolid2D_NonStatic_Save_NewmarkBeta_P1(
 	const unsigned int nno = 3;	assert( nno == es_co.Length() );
 	const unsigned int ndim = 2;
 
-	unsigned int noes[nno];	// vf̐ߓ_̐ߓ_ԍ
-
-	double eKmat[nno][nno][ndim][ndim];
-	double eMmat[nno][ndim][ndim];
-	double emat[nno][nno][ndim][ndim];	// vfs
-	double eqf_out[nno][ndim];	// vfO̓xNg
-
 	CMatDia_BlkCrs& mat_cc          = ls.GetMatrix(         id_field_val,CORNER,world);
 	CVector_Blk&    force_c         = ls.GetForce(          id_field_val,CORNER,world);
 	CDiaMat_Blk&    Mmat            = ls.GetDiaMassMatrix(  id_field_val,CORNER,world);
@@ -1084,8 +1108,33 @@ static bool AddLinSys_LinearSolid2D_NonStatic_Save_NewmarkBeta_P1(
 
 	const CNodeAry::CNodeSeg& ns_c_co  = field_val.GetNodeSeg(CORNER,false,world);
 
-	for(unsigned int ielem=0;ielem<ea.Size();ielem++)
-	{
+	const unsigned int id_es_co = field_val.GetIdElemSeg(id_ea,CORNER,false,world);
+	const unsigned int iver_conn = ea.GetConnVersion();
+	if( !mat_cc.IsMeargeTable(id_ea,id_es_co,iver_conn) || !mat_cc_boundary.IsMeargeTable(id_ea,id_es_co,iver_conn) ){
+		// the CRS positions are looked up again only if the element segment, its connectivity or the pattern of the matrices is changed
+		std::vector<unsigned int> aNoes(ea.Size()*nno);
+		for(unsigned int ielem=0;ielem<ea.Size();ielem++){ es_co.GetNodes(ielem,&aNoes[ielem*nno]); }
+		if( !aNoes.empty() ){
+			mat_cc.MakeMeargeTable(         id_ea,id_es_co,iver_conn,ea.Size(), nno,&aNoes[0], nno,&aNoes[0]);
+			mat_cc_boundary.MakeMeargeTable(id_ea,id_es_co,iver_conn,ea.Size(), nno,&aNoes[0], nno,&aNoes[0]);
+		}
+	}
+
+	// elements of one color do not share a node, so they can be merged at the same time
+	const Com::CIndexedArray& color = ea.GetColoring(id_es_co);
+	mat_cc.MakeMargeTmpBuffer();	// used if MeargeTable falls back to Mearge
+	mat_cc_boundary.MakeMargeTmpBuffer();
+	for(unsigned int icolor=0;icolor<color.Size();icolor++){
+#if defined(_OPENMP)
+#pragma omp parallel for
+#endif
+	for(int iie=(int)color.index[icolor];iie<(int)color.index[icolor+1];iie++){
+		const unsigned int ielem = color.array[iie];
+		unsigned int noes[nno];	// vf̐ߓ_̐ߓ_ԍ
+		double eKmat[nno][nno][ndim][ndim];
+		double eMmat[nno][ndim][ndim];
+		double emat[nno][nno][ndim][ndim];	// vfs
+		double eqf_out[nno][ndim];	// vfO̓xNg
 		// vf̐ߓ_ԍĂ
 		es_co.GetNodes(ielem,noes);
 		double coords[nno][ndim];		// vfߓ_W
@@ -1163,8 +1212,8 @@ static bool AddLinSys_LinearSolid2D_NonStatic_Save_NewmarkBeta_P1(
 			}
 		}
 		// S̍sɗvfs}[W
-		mat_cc.Mearge(nno,noes, nno,noes, ndim*ndim, &emat[0][0][0][0]);
-		mat_cc_boundary.Mearge(nno,noes, nno,noes, ndim*ndim, &eKmat[0][0][0][0]);
+		mat_cc.MeargeTable(         id_ea,id_es_co,iver_conn,ielem, nno,noes, nno,noes, ndim*ndim, &emat[0][0][0][0]);
+		mat_cc_boundary.MeargeTable(id_ea,id_es_co,iver_conn,ielem, nno,noes, nno,noes, ndim*ndim, &eKmat[0][0][0][0]);
 		for(unsigned int ino=0;ino<nno;ino++){
 			Mmat.Mearge(noes[ino],ndim*ndim,&eMmat[ino][0][0]);
 		}
@@ -1175,6 +1224,7 @@ static bool AddLinSys_LinearSolid2D_NonStatic_Save_NewmarkBeta_P1(
 		}
 		}
 	}
+	}
 	return true;
 }
 
@@ -1202,13 +1252,6 @@ static bool AddLinSys_LinearSolid2D_NonStatic_NewmarkBeta_P1(
 	const unsigned int nno = 3;	assert( nno == es_co.Length() );
 	const unsigned int ndim = 2;
 
-
-	double eKmat[nno][nno][ndim][ndim];	// stiffness matrix
-	double eMmat[nno][nno][ndim][ndim];	// mass matrix
-	double emat[nno][nno][ndim][ndim];	// coefficient matrix
-	double eqf_out[nno][ndim];	// element external force vector
-	double eres[nno][ndim];		// element internal force vector
-
 	CMatDia_BlkCrs& mat_cc = ls.GetMatrix(  id_field_val,CORNER,world);
 	CVector_Blk&    res_c  = ls.GetResidual(id_field_val,CORNER,world);
 
@@ -1217,8 +1260,20 @@ static bool AddLinSys_LinearSolid2D_NonStatic_NewmarkBeta_P1(
 	const CNodeAry::CNodeSeg& ns_c_acc = field_val.GetNodeSeg(CORNER,true,world,ACCELERATION);
 	const CNodeAry::CNodeSeg& ns_c_co  = field_val.GetNodeSeg(CORNER,false,world);
 
-	for(unsigned int ielem=0;ielem<ea.Size();ielem++)
-	{		
+	// elements of one color do not share a node, so they can be merged at the same time
+	const Com::CIndexedArray& color = ea.GetColoring( field_val.GetIdElemSeg(id_ea,CORNER,true,world) );
+	mat_cc.MakeMargeTmpBuffer();	// one merge buffer for each thread
+	for(unsigned int icolor=0;icolor<color.Size();icolor++){
+#if defined(_OPENMP)
+#pragma omp parallel for
+#endif
+	for(int iie=(int)color.index[icolor];iie<(int)color.index[icolor+1];iie++){
+		const unsigned int ielem = color.array[iie];
+		double eKmat[nno][nno][ndim][ndim];	// stiffness matrix
+		double eMmat[nno][nno][ndim][ndim];	// mass matrix
+		double emat[nno][nno][ndim][ndim];	// coefficient matrix
+		double eqf_out[nno][ndim];	// element external force vector
+		double eres[nno][ndim];		// element internal force vector
 		// fetch global node number for coordinate node
 		unsigned int noes[nno];	es_co.GetNodes(ielem,noes);		
 		// fetch coordinate
@@ -1333,6 +1388,7 @@ static bool AddLinSys_LinearSolid2D_NonStatic_NewmarkBeta_P1(
 			res_c.AddValue(noes[ino],1,eres[ino][1]);
 		}
 	}
+	}
 	return true;
 }
 
@@ -1361,12 +1417,6 @@ static bool AddLinSys_LinearSolid2D_NonStatic_BackwardEular_P1
 	const unsigned int nno = 3;	assert( nno == es_co.Length() );
 	const unsigned int ndim = 2;
 	
-	double eKmat[nno][nno][ndim][ndim];	// stiffness matrix
-	double eMmat[nno][nno][ndim][ndim];	// mass matrix
-	double emat[nno][nno][ndim][ndim];	// coefficient matrix
-	double eqf_out[nno][ndim];	// element external force vector
-	double eres[nno][ndim];		// element internal force vector
-	
 	CMatDia_BlkCrs& mat_cc = ls.GetMatrix(  id_field_val,CORNER,world);
 	CVector_Blk&    res_c  = ls.GetResidual(id_field_val,CORNER,world);
 	
@@ -1374,8 +1424,20 @@ static bool AddLinSys_LinearSolid2D_NonStatic_BackwardEular_P1
 	const CNodeAry::CNodeSeg& ns_c_velo = field_val.GetNodeSeg(CORNER,true, world,VELOCITY);
 	const CNodeAry::CNodeSeg& ns_c_co   = field_val.GetNodeSeg(CORNER,false,world);
 	
-	for(unsigned int ielem=0;ielem<ea.Size();ielem++)
-	{		
+	// elements of one color do not share a node, so they can be merged at the same time
+	const Com::CIndexedArray& color = ea.GetColoring( field_val.GetIdElemSeg(id_ea,CORNER,true,world) );
+	mat_cc.MakeMargeTmpBuffer();	// one merge buffer for each thread
+	for(unsigned int icolor=0;icolor<color.Size();icolor++){
+#if defined(_OPENMP)
+#pragma omp parallel for
+#endif
+	for(int iie=(int)color.index[icolor];iie<(int)color.index[icolor+1];iie++){
+		const unsigned int ielem = color.array[iie];
+		double eKmat[nno][nno][ndim][ndim];	// stiffness matrix
+		double eMmat[nno][nno][ndim][ndim];	// mass matrix
+		double emat[nno][nno][ndim][ndim];	// coefficient matrix
+		double eqf_out[nno][ndim];	// element external force vector
+		double eres[nno][ndim];		// element internal force vector
 		// fetch global node number for coordinate node
 		unsigned int noes[nno];	es_co.GetNodes(ielem,noes);		
 		// fetch coordinate
@@ -1493,6 +1555,7 @@ static bool AddLinSys_LinearSolid2D_NonStatic_BackwardEular_P1
 			res_c.AddValue(noes[ino],1,eres[ino][1]);
 		}
 	}
+	}
 	return true;	
 }
 
@@ -1525,14 +1588,6 @@ static bool AddLinSys_LinearSolidThermalStress2D_NonStatic_NewmarkBeta_P1(
 
 	assert( nno == es_co.Length() );
 
-	unsigned int noes[nno];	// vf̐ߓ_̐ߓ_ԍ
-
-	double eKmat[nno][nno][ndim][ndim];
-	double eMmat[nno][nno][ndim][ndim];
-	double emat[nno][nno][ndim][ndim];	// vfs
-	double eqf_out[nno][ndim];	// vfO̓xNg
-	double eres[nno][ndim];		// vfcxNg
-
 	CMatDia_BlkCrs& mat_cc = ls.GetMatrix(  id_field_val,CORNER,world);
 	CVector_Blk&    res_c  = ls.GetResidual(id_field_val,CORNER,world);
 
@@ -1542,8 +1597,21 @@ static bool AddLinSys_LinearSolidThermalStress2D_NonStatic_NewmarkBeta_P1(
 	const CNodeAry::CNodeSeg& ns_c_acc  = field_disp.GetNodeSeg(CORNER,true,world,ACCELERATION);
 	const CNodeAry::CNodeSeg& ns_c_temp = field_temp.GetNodeSeg(CORNER,true,world,VALUE);
 
-	for(unsigned int ielem=0;ielem<ea.Size();ielem++)
-	{
+	// elements of one color do not share a node, so they can be merged at the same time
+	const Com::CIndexedArray& color = ea.GetColoring( field_disp.GetIdElemSeg(id_ea,CORNER,true,world) );
+	mat_cc.MakeMargeTmpBuffer();	// one merge buffer for each thread
+	for(unsigned int icolor=0;icolor<color.Size();icolor++){
+#if defined(_OPENMP)
+#pragma omp parallel for
+#endif
+	for(int iie=(int)color.index[icolor];iie<(int)color.index[icolor+1];iie++){
+		const unsigned int ielem = color.array[iie];
+		unsigned int noes[nno];	// vf̐ߓ_̐ߓ_ԍ
+		double eKmat[nno][nno][ndim][ndim];
+		double eMmat[nno][nno][ndim][ndim];
+		double emat[nno][nno][ndim][ndim];	// vfs
+		double eqf_out[nno][ndim];	// vfO̓xNg
+		double eres[nno][ndim];		// vfcxNg
 		// vf̐ߓ_ԍĂ
 		es_temp.GetNodes(ielem,noes);
 		double temp[nno];		// vfߓ_W
@@ -1671,6 +1739,7 @@ static bool AddLinSys_LinearSolidThermalStress2D_NonStatic_NewmarkBeta_P1(
 			res_c.AddValue(noes[ino],1,eres[ino][1]);
 		}
 	}
+	}
 	return true;
 }
 
@@ -32,6 +32,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include "delfem/matvec/vector_blk.h"
 #include "delfem/femls/linearsystem_field.h"
 #include "delfem/femls/linearsystem_fieldsave.h"
+#include "delfem/femls/linearsystem_matfree.h"
 
 #include "delfem/femeqn/ker_emat_tri.h"
 #include "delfem/femeqn/ker_emat_quad.h"
@@ -193,6 +194,32 @@ bool Fem::Eqn::AddLinSys_LinearSolid3D_Static(
 	return true;
 }
 
+// the element stiffness matrix is not made, the operator is recomputed in each matrix vector product
+bool Fem::Eqn::AddLinSys_LinearSolid3D_Static(
+		CLinearSystem_MatFree& ls,
+		double lambda, double myu,
+		double  rho, double g_x, double g_y, double g_z,
+		const CFieldWorld& world,
+		const unsigned int id_field_val)
+{
+	if( !world.IsIdField(id_field_val) ) return false;
+	const CField& field_val = world.GetField(id_field_val);
+	if( field_val.GetFieldType() != VECTOR3 ) return false;
+
+	const double load[3] = { rho*g_x, rho*g_y, rho*g_z };
+	const std::vector<unsigned int>& aIdEA = field_val.GetAryIdEA();
+	for(unsigned int iiea=0;iiea<aIdEA.size();iiea++){
+		const unsigned int id_ea = aIdEA[iiea];
+		const INTERPOLATION_TYPE itype = field_val.GetInterpolationType(id_ea,world);
+		if( itype != TET11 && itype != HEX11 ){ assert(0); return false; }
+		const int iop = ls.AddElemOp(CLinearSystem_MatFree::ELASTIC,lambda,myu,id_field_val,id_ea,world);
+		if( iop < 0 ) return false;
+		if( !ls.AddResidual_ElemOp(iop,load,world) ) return false;
+	}
+
+	return true;
+}
+
 bool Fem::Eqn::AddLinSys_LinearSolid3D_NonStatic_NewmarkBeta(
 		double dt, double gamma, double beta,
 		ILinearSystem_Eqn& ls,
@@ -259,16 +286,23 @@ static bool AddLinSys_LinearSolid3D_Static_P1(
 	const unsigned int nno = 4;
 	const unsigned int ndim = 3;
 
-	double emat[nno][nno][ndim][ndim];	// vfs
-	double eres[nno][ndim];		// vfcxNg
-
 	CMatDia_BlkCrs& mat_cc = ls.GetMatrix(  id_field_val,CORNER,world);
 	CVector_Blk&    res_c  = ls.GetResidual(id_field_val,CORNER,world);
 
 	const CNodeAry::CNodeSeg& ns_c_val = field_val.GetNodeSeg(CORNER,true,world,VALUE);//.GetSeg(id_ns_c_val);
 	const CNodeAry::CNodeSeg& ns_c_co  = field_val.GetNodeSeg(CORNER,false,world,VALUE);//na_c_co.GetSeg(id_ns_c_co);
 
-	for(unsigned int ielem=0;ielem<ea.Size();ielem++){
+	// elements of one color do not share a node, so they can be merged at the same time
+	const Com::CIndexedArray& color = ea.GetColoring( field_val.GetIdElemSeg(id_ea,CORNER,true,world) );
+	mat_cc.MakeMargeTmpBuffer();	// one merge buffer for each thread
+	for(unsigned int icolor=0;icolor<color.Size();icolor++){
+#if defined(_OPENMP)
+#pragma omp parallel for
+#endif
+	for(int iie=(int)color.index[icolor];iie<(int)color.index[icolor+1];iie++){
+		const unsigned int ielem = color.array[iie];
+		double emat[nno][nno][ndim][ndim];	// element stiffness matrix
+		double eres[nno][ndim];		// element residual vector
 		// vf̐ߓ_ԍĂ
 	    unsigned int noes[nno];	// vf̐ߓ_̐ߓ_ԍ
 		es_c.GetNodes(ielem,noes);
@@ -329,6 +363,7 @@ static bool AddLinSys_LinearSolid3D_Static_P1(
 			res_c.AddValue(noes[ino],2,eres[ino][2]);
 		}
 	}
+	}
 
 	return true;
 }
@@ -353,19 +388,24 @@ static bool AddLinSys_LinearSolid3D_Eigen_P1(
 	const unsigned int nnoes = 4;	assert( nnoes == es_c.Length() );
 	const unsigned int ndim = 3;
 
-	unsigned int noes[nnoes];	// vf̐ߓ_̐ߓ_ԍ
-
-	double eKmat[nnoes][nnoes][ndim][ndim];
-	double eMmat[nnoes][ndim][ndim];
-	double coords[nnoes][ndim];		// vfߓ_W
-
 	CMatDia_BlkCrs& Kmat = ls.GetMatrix(       id_field_val,CORNER,world);
 	CDiaMat_Blk&    Mmat = ls.GetDiaMassMatrix(id_field_val,CORNER,world);
 
 	const CNodeAry::CNodeSeg& ns_c_co  = field_val.GetNodeSeg( CORNER,false,world);
 
-	for(unsigned int ielem=0;ielem<ea.Size();ielem++)
-	{
+	// elements of one color do not share a node, so they can be merged at the same time
+	const Com::CIndexedArray& color = ea.GetColoring( field_val.GetIdElemSeg(id_ea,CORNER,true,world) );
+	Kmat.MakeMargeTmpBuffer();	// one merge buffer for each thread
+	for(unsigned int icolor=0;icolor<color.Size();icolor++){
+#if defined(_OPENMP)
+#pragma omp parallel for
+#endif
+	for(int iie=(int)color.index[icolor];iie<(int)color.index[icolor+1];iie++){
+		const unsigned int ielem = color.array[iie];
+		unsigned int noes[nnoes];	// vf̐ߓ_̐ߓ_ԍ
+		double eKmat[nnoes][nnoes][ndim][ndim];
+		double eMmat[nnoes][ndim][ndim];
+		double coords[nnoes][ndim];		// vfߓ_W
 		// vf̐ߓ_ԍĂ
 		es_c.GetNodes(ielem,noes);
 		// ߓ_̍WAlĂ
@@ -419,6 +459,7 @@ static bool AddLinSys_LinearSolid3D_Eigen_P1(
 			Mmat.Mearge(noes[ino],ndim*ndim,&eMmat[ino][0][0]);
 		}
 	}
+	}
 	return true;
 }
 
@@ -443,17 +484,6 @@ static bool AddLinSys_LinearSolid3D_Static_P1(
 	const unsigned int nnoes = 4;
 	const unsigned int ndim = 3;
 
-	unsigned int noes[nnoes];	// vf̐ߓ_̐ߓ_ԍ
-
-	double emat[nnoes][nnoes][ndim][ndim];	// vfs
-	double eforce[nnoes][ndim];		// vfO̓xNg
-
-	double coords[nnoes][ndim];		// vfߓ_W
-	double disp[  nnoes][ndim];		// vfߓ_ψ
-
-	double dldx[nnoes][ndim];		// `֐̋Ԕ
-	double zero_order_term[nnoes];	// `֐̒萔
-				
 	CMatDia_BlkCrs& mat_cc       = ls.GetMatrix(id_field_val,CORNER,world);
 	CVector_Blk&    force_c      = ls.GetForce( id_field_val,CORNER,world);
 	CMat_BlkCrs&    mat_cc_bound = ls.GetMatrix_Boundary(id_field_val,CORNER,id_field_val,CORNER,world);
@@ -461,7 +491,23 @@ static bool AddLinSys_LinearSolid3D_Static_P1(
 	const CNodeAry::CNodeSeg& ns_c_val = field_val.GetNodeSeg(CORNER,true,world,VALUE);//.GetSeg(id_ns_c_val);
 	const CNodeAry::CNodeSeg& ns_c_co  = field_val.GetNodeSeg(CORNER,false,world,VALUE);//na_c_co.GetSeg(id_ns_c_co);
 
-	for(unsigned int ielem=0;ielem<ea.Size();ielem++){
+	// elements of one color do not share a node, so they can be merged at the same time
+	const Com::CIndexedArray& color = ea.GetColoring( field_val.GetIdElemSeg(id_ea,CORNER,true,world) );
+	mat_cc.MakeMargeTmpBuffer();	// one merge buffer for each thread
+	mat_cc_bound.MakeMargeTmpBuffer();
+	for(unsigned int icolor=0;icolor<color.Size();icolor++){
+#if defined(_OPENMP)
+#pragma omp parallel for
+#endif
+	for(int iie=(int)color.index[icolor];iie<(int)color.index[icolor+1];iie++){
+		const unsigned int ielem = color.array[iie];
+		unsigned int noes[nnoes];	// vf̐ߓ_̐ߓ_ԍ
+		double emat[nnoes][nnoes][ndim][ndim];	// vfs
+		double eforce[nnoes][ndim];		// vfO̓xNg
+		double coords[nnoes][ndim];		// vfߓ_W
+		double disp[  nnoes][ndim];		// vfߓ_ψ
+		double dldx[nnoes][ndim];		// `֐̋Ԕ
+		double zero_order_term[nnoes];	// `֐̒萔
 		// vf̐ߓ_ԍĂ
 		es_c.GetNodes(ielem,noes);
 		// ߓ_̍WAlĂ
@@ -516,6 +562,7 @@ static bool AddLinSys_LinearSolid3D_Static_P1(
 			force_c.AddValue(noes[ino],2,eforce[ino][2]);
 		}
 	}
+	}
 
 	return true;
 }
@@ -545,19 +592,6 @@ static bool AddLinSys_LinearSolid3D_NonStatic_NewmarkBeta_P1(
 	const unsigned int nnoes = 4;	assert( nnoes == es_c.Length() );
 	const unsigned int ndim = 3;
 
-	unsigned int noes[nnoes];	// vf̐ߓ_̐ߓ_ԍ
-
-	double eKmat[nnoes][nnoes][ndim][ndim];
-	double eMmat[nnoes][nnoes][ndim][ndim];
-	double emat[nnoes][nnoes][ndim][ndim];	// vfs
-	double eqf_out[nnoes][ndim];	// vfO̓xNg
-	double eres[nnoes][ndim];		// vfcxNg
-
-	double coords[nnoes][ndim];		// vfߓ_W
-	double disp[  nnoes][ndim];		// vfߓ_ψ
-	double acc[   nnoes][ndim];
-	double velo[  nnoes][ndim];
-
 	CMatDia_BlkCrs& mat_cc = ls.GetMatrix(  id_field_val,CORNER,world);
 	CVector_Blk&    res_c  = ls.GetResidual(id_field_val,CORNER,world);
 
@@ -566,7 +600,25 @@ static bool AddLinSys_LinearSolid3D_NonStatic_NewmarkBeta_P1(
 	const CNodeAry::CNodeSeg& ns_c_acc = field_val.GetNodeSeg( CORNER,true, world,ACCELERATION);
 	const CNodeAry::CNodeSeg& ns_c_co  = field_val.GetNodeSeg( CORNER,false,world);
 
-	for(unsigned int ielem=0;ielem<ea.Size();ielem++){
+	// elements of one color do not share a node, so they can be merged at the same time
+	const Com::CIndexedArray& color = ea.GetColoring( field_val.GetIdElemSeg(id_ea,CORNER,true,world) );
+	mat_cc.MakeMargeTmpBuffer();	// one merge buffer for each thread
+	for(unsigned int icolor=0;icolor<color.Size();icolor++){
+#if defined(_OPENMP)
+#pragma omp parallel for
+#endif
+	for(int iie=(int)color.index[icolor];iie<(int)color.index[icolor+1];iie++){
+		const unsigned int ielem = color.array[iie];
+		unsigned int noes[nnoes];	// vf̐ߓ_̐ߓ_ԍ
+		double eKmat[nnoes][nnoes][ndim][ndim];
+		double eMmat[nnoes][nnoes][ndim][ndim];
+		double emat[nnoes][nnoes][ndim][ndim];	// vfs
+		double eqf_out[nnoes][ndim];	// vfO̓xNg
+		double eres[nnoes][ndim];		// vfcxNg
+		double coords[nnoes][ndim];		// vfߓ_W
+		double disp[  nnoes][ndim];		// vfߓ_ψ
+		double acc[   nnoes][ndim];
+		double velo[  nnoes][ndim];
 		// vf̐ߓ_ԍĂ
 		es_c.GetNodes(ielem,noes);
 		// ߓ_̍WAlĂ
@@ -686,6 +738,7 @@ static bool AddLinSys_LinearSolid3D_NonStatic_NewmarkBeta_P1(
 			res_c.AddValue(noes[ino],2,eres[ino][2]);
 		}
 	}
+	}
 	return true;
 }
 
@@ -712,20 +765,10 @@ static bool AddLinSys_LinearSolid3D_NonStatic_NewmarkBeta_Q1(
 	unsigned int num_integral = 1;
 	const unsigned int nInt = NIntLineGauss[num_integral];
 	const double (*Gauss)[2] = LineGauss[num_integral];
-	double detjac, detwei;
 
 	const unsigned int nnoes = 8;	assert( nnoes == es_c.Length() );
 	const unsigned int ndim = 3;
 
-	double eKmat[nnoes][nnoes][ndim][ndim];
-	double eMmat[nnoes][nnoes][ndim][ndim];
-	double emat[nnoes][nnoes][ndim][ndim];	// vfs
-	double eqf_out[nnoes][ndim];	// vfO̓xNg
-	double eres[nnoes][ndim];		// vfcxNg
-
-	double dndx[nnoes][ndim];		// `֐̋Ԕ
-	double an[nnoes];				// `֐̒l
-				
 	CMatDia_BlkCrs& mat_cc = ls.GetMatrix(  id_field_val,CORNER,world);
 	CVector_Blk&    res_c  = ls.GetResidual(id_field_val,CORNER,world);
 
@@ -734,7 +777,23 @@ static bool AddLinSys_LinearSolid3D_NonStatic_NewmarkBeta_Q1(
 	const CNodeAry::CNodeSeg& ns_c_acc = field_val.GetNodeSeg( CORNER,true, world,ACCELERATION);
 	const CNodeAry::CNodeSeg& ns_c_co  = field_val.GetNodeSeg( CORNER,false,world);
 
-	for(unsigned int ielem=0;ielem<ea.Size();ielem++){
+	// elements of one color do not share a node, so they can be merged at the same time
+	const Com::CIndexedArray& color = ea.GetColoring( field_val.GetIdElemSeg(id_ea,CORNER,true,world) );
+	mat_cc.MakeMargeTmpBuffer();	// one merge buffer for each thread
+	for(unsigned int icolor=0;icolor<color.Size();icolor++){
+#if defined(_OPENMP)
+#pragma omp parallel for
+#endif
+	for(int iie=(int)color.index[icolor];iie<(int)color.index[icolor+1];iie++){
+		const unsigned int ielem = color.array[iie];
+		double detjac, detwei;
+		double eKmat[nnoes][nnoes][ndim][ndim];
+		double eMmat[nnoes][nnoes][ndim][ndim];
+		double emat[nnoes][nnoes][ndim][ndim];	// vfs
+		double eqf_out[nnoes][ndim];	// vfO̓xNg
+		double eres[nnoes][ndim];		// vfcxNg
+		double dndx[nnoes][ndim];		// `֐̋Ԕ
+		double an[nnoes];				// `֐̒l
 	    unsigned int noes[nnoes];	// vf̐ߓ_̐ߓ_ԍ
 		// vf̐ߓ_ԍĂ
 		es_c.GetNodes(ielem,noes);
@@ -858,6 +917,7 @@ static bool AddLinSys_LinearSolid3D_NonStatic_NewmarkBeta_Q1(
 			res_c.AddValue(noes[ino],2,eres[ino][2]);
 		}
 	}
+	}
 	return true;
 }
 
@@ -882,30 +942,34 @@ static bool AddLinSys_LinearSolid3D_Static_Q1(
 	unsigned int num_integral = 1;
 	const unsigned int nInt = NIntLineGauss[num_integral];
 	const double (*Gauss)[2] = LineGauss[num_integral];
-	double detjac, detwei;
 
 	const unsigned int nnoes = 8;
 	const unsigned int ndim = 3;
 
-	unsigned int noes[nnoes];	// vf̐ߓ_̐ߓ_ԍ
-
-	double emat[nnoes][nnoes][ndim][ndim];	// vfs
-	double eforce[nnoes][ndim];		// vfO̓xNg
-	double eres[nnoes][ndim];		// vfcxNg
-
-	double coords[nnoes][ndim];		// vfߓ_W
-	double disp[  nnoes][ndim];		// vfߓ_ψ
-
-	double dndx[nnoes][ndim];		// `֐̋Ԕ
-	double an[nnoes];				// `֐̒l
-				
 	CMatDia_BlkCrs& mat_cc = ls.GetMatrix(  id_field_val,CORNER,world);
 	CVector_Blk&    res_c  = ls.GetResidual(id_field_val,CORNER,world);
 
 	const CNodeAry::CNodeSeg& ns_c_val = field_val.GetNodeSeg(CORNER,true,world,VALUE);//.GetSeg(id_ns_c_val);
 	const CNodeAry::CNodeSeg& ns_c_co  = field_val.GetNodeSeg(CORNER,false,world,VALUE);//na_c_co.GetSeg(id_ns_c_co);
 
-	for(unsigned int ielem=0;ielem<ea.Size();ielem++){
+	// elements of one color do not share a node, so they can be merged at the same time
+	const Com::CIndexedArray& color = ea.GetColoring( field_val.GetIdElemSeg(id_ea,CORNER,false,world) );
+	mat_cc.MakeMargeTmpBuffer();	// one merge buffer for each thread
+	for(unsigned int icolor=0;icolor<color.Size();icolor++){
+#if defined(_OPENMP)
+#pragma omp parallel for
+#endif
+	for(int iie=(int)color.index[icolor];iie<(int)color.index[icolor+1];iie++){
+		const unsigned int ielem = color.array[iie];
+		double detjac, detwei;
+		unsigned int noes[nnoes];	// vf̐ߓ_̐ߓ_ԍ
+		double emat[nnoes][nnoes][ndim][ndim];	// vfs
+		double eforce[nnoes][ndim];		// vfO̓xNg
+		double eres[nnoes][ndim];		// vfcxNg
+		double coords[nnoes][ndim];		// vfߓ_W
+		double disp[  nnoes][ndim];		// vfߓ_ψ
+		double dndx[nnoes][ndim];		// `֐̋Ԕ
+		double an[nnoes];				// `֐̒l
 		// vf̐ߓ_ԍĂ
 		es_c.GetNodes(ielem,noes);
 		// ߓ_̍WAlĂ
@@ -978,6 +1042,7 @@ static bool AddLinSys_LinearSolid3D_Static_Q1(
 			res_c.AddValue(noes[ino],2,eres[ino][2]);
 		}
 	}
+	}
 
 	return true;
 }
@@ -285,11 +285,6 @@ static bool AddLinSys_NavierStokes2D_NonStatic_Newmark_P1P1(
 	const unsigned int nno = 3;
 	const unsigned int ndim = 2;
 
-	double eCmat_uu[nno][nno][ndim][ndim], eCmat_pp[nno][nno], eCmat_pu[nno][nno][ndim], eCmat_up[nno][nno][ndim];
-	double eMmat_uu[nno][nno][ndim][ndim], eMmat_pu[nno][nno][ndim];
-	double  emat_uu[nno][nno][ndim][ndim],  emat_pp[nno][nno],  emat_pu[nno][nno][ndim],  emat_up[nno][nno][ndim];
-	double eres_u[nno][ndim], eres_p[nno];
-
 	assert( ls.FindIndexArray_Seg(id_field_velo, CORNER,world) 
         !=  ls.FindIndexArray_Seg(id_field_press,CORNER,world) );
 
@@ -306,8 +301,22 @@ static bool AddLinSys_NavierStokes2D_NonStatic_Newmark_P1P1(
 	const CNodeAry::CNodeSeg& ns_press  = field_press.GetNodeSeg(CORNER,true,world,VELOCITY);//na_press.GetSeg(id_ns_press);
 	const CNodeAry::CNodeSeg& ns_apress = field_press.GetNodeSeg(CORNER,true,world,ACCELERATION);//na_press.GetSeg(id_ns_apress);
 
-	for(unsigned int ielem=0;ielem<ea.Size();ielem++)
-	{
+	// elements of one color do not share a node, so they can be merged at the same time
+	const Com::CIndexedArray& color = ea.GetColoring( field_velo.GetIdElemSeg(id_ea,CORNER,true,world) );
+	mat_uu.MakeMargeTmpBuffer();	// one merge buffer for each thread
+	mat_up.MakeMargeTmpBuffer();
+	mat_pu.MakeMargeTmpBuffer();
+	mat_pp.MakeMargeTmpBuffer();
+	for(unsigned int icolor=0;icolor<color.Size();icolor++){
+#if defined(_OPENMP)
+#pragma omp parallel for
+#endif
+	for(int iie=(int)color.index[icolor];iie<(int)color.index[icolor+1];iie++){
+		const unsigned int ielem = color.array[iie];
+		double eCmat_uu[nno][nno][ndim][ndim], eCmat_pp[nno][nno], eCmat_pu[nno][nno][ndim], eCmat_up[nno][nno][ndim];
+		double eMmat_uu[nno][nno][ndim][ndim], eMmat_pu[nno][nno][ndim];
+		double  emat_uu[nno][nno][ndim][ndim],  emat_pp[nno][nno],  emat_pu[nno][nno][ndim],  emat_up[nno][nno][ndim];
+		double eres_u[nno][ndim], eres_p[nno];
 		unsigned int no_v[nno];	// vfߓ_̑S̐ߓ_ԍ				
 		es_velo_c_co.GetNodes(ielem,no_v);	// vf̐ߓ_ԍĂ
 		double coords[nno][ndim];	// vfߓ_̍W
@@ -398,6 +407,7 @@ static bool AddLinSys_NavierStokes2D_NonStatic_Newmark_P1P1(
 			res_p.AddValue( no_p[ino],0,eres_p[ino]);
 		}
 	}
+	}
 	return true;
 }
 
@@ -426,11 +436,6 @@ static bool AddLinSys_NavierStokes2D_NonStatic_Newmark_P1P1_Combined(
 	const unsigned int nno = 3;
 	const unsigned int ndim = 2;
 
-	double eCmat_uu[nno][nno][ndim][ndim], eCmat_pp[nno][nno], eCmat_pu[nno][nno][ndim], eCmat_up[nno][nno][ndim];
-	double eMmat_uu[nno][nno][ndim][ndim], eMmat_pu[nno][nno][ndim];
-	double  emat_uu[nno][nno][ndim][ndim],  emat_pp[nno][nno],  emat_pu[nno][nno][ndim],  emat_up[nno][nno][ndim];
-	double eres_u[nno][ndim], eres_p[nno];
-
 	assert( ls.FindIndexArray_Seg(id_field_velo, CORNER,world) 
 		 == ls.FindIndexArray_Seg(id_field_press,CORNER,world) );
 
@@ -443,8 +448,19 @@ static bool AddLinSys_NavierStokes2D_NonStatic_Newmark_P1P1_Combined(
 	const CNodeAry::CNodeSeg& ns_press  = field_press.GetNodeSeg(CORNER,true,world,VELOCITY);//na_press.GetSeg(id_ns_press);
 	const CNodeAry::CNodeSeg& ns_apress = field_press.GetNodeSeg(CORNER,true,world,ACCELERATION);//na_press.GetSeg(id_ns_apress);
 
-	for(unsigned int ielem=0;ielem<ea.Size();ielem++)
-	{
+	// elements of one color do not share a node, so they can be merged at the same time
+	const Com::CIndexedArray& color = ea.GetColoring( field_velo.GetIdElemSeg(id_ea,CORNER,true,world) );
+	mat_uu.MakeMargeTmpBuffer();	// one merge buffer for each thread
+	for(unsigned int icolor=0;icolor<color.Size();icolor++){
+#if defined(_OPENMP)
+#pragma omp parallel for
+#endif
+	for(int iie=(int)color.index[icolor];iie<(int)color.index[icolor+1];iie++){
+		const unsigned int ielem = color.array[iie];
+		double eCmat_uu[nno][nno][ndim][ndim], eCmat_pp[nno][nno], eCmat_pu[nno][nno][ndim], eCmat_up[nno][nno][ndim];
+		double eMmat_uu[nno][nno][ndim][ndim], eMmat_pu[nno][nno][ndim];
+		double  emat_uu[nno][nno][ndim][ndim],  emat_pp[nno][nno],  emat_pu[nno][nno][ndim],  emat_up[nno][nno][ndim];
+		double eres_u[nno][ndim], eres_p[nno];
 		unsigned int noes[nno];	// vfߓ_̑S̐ߓ_ԍ
 		
 		// vf̐ߓ_ԍĂ
@@ -537,6 +553,7 @@ static bool AddLinSys_NavierStokes2D_NonStatic_Newmark_P1P1_Combined(
 			res_u.AddValue( noes[ino],2,eres_p[ino]);
 		}
     }
+	}
 	return true;
 }
 
@@ -636,21 +653,6 @@ static bool AddLinearSystem_NavierStokesALE2D_NonStatic_Newmark_P1P1(
 	const unsigned int nno = 3;
 	const unsigned int ndim = 2;
 
-	unsigned int noes[nno];	// vfߓ_̑S̐ߓ_ԍ
-
-	double velo[nno][ndim];	// vfߓ_̒l
-	double velo_msh[nno][ndim];	// vfߓ_̒l
-	double velo_r[nno][ndim];	// relative velocity
-	double acc[nno][ndim];	// vfߓ_̒l
-	double press[nno];
-	double apress[nno];
-	double coords[nno][ndim];	// vfߓ_̍W
-				
-	double eCmat_uu[nno][nno][ndim][ndim], eCmat_pp[nno][nno], eCmat_pu[nno][nno][ndim], eCmat_up[nno][nno][ndim];
-	double eMmat_uu[nno][nno][ndim][ndim], eMmat_pu[nno][nno][ndim];
-	double  emat_uu[nno][nno][ndim][ndim],  emat_pp[nno][nno],  emat_pu[nno][nno][ndim],  emat_up[nno][nno][ndim];
-	double eres_u[nno][ndim], eres_p[nno];
-
 	CMatDia_BlkCrs& mat_uu = ls.GetMatrix(id_field_velo, CORNER, world);
 	CMatDia_BlkCrs& mat_pp = ls.GetMatrix(id_field_press,CORNER, world);
 	CMat_BlkCrs& mat_up = ls.GetMatrix(id_field_velo, CORNER, id_field_press,CORNER, world);
@@ -665,8 +667,30 @@ static bool AddLinearSystem_NavierStokesALE2D_NonStatic_Newmark_P1P1(
 	const CNodeAry::CNodeSeg& ns_apress = field_press.GetNodeSeg(CORNER,true,world,ACCELERATION);
 	const CNodeAry::CNodeSeg& ns_msh_velo = field_msh_velo.GetNodeSeg(CORNER,true, world,VELOCITY);
 
-	for(unsigned int ielem=0;ielem<ea.Size();ielem++)
-	{
+	// elements of one color do not share a node, so they can be merged at the same time
+	const Com::CIndexedArray& color = ea.GetColoring( field_velo.GetIdElemSeg(id_ea,CORNER,true,world) );
+	mat_uu.MakeMargeTmpBuffer();	// one merge buffer for each thread
+	mat_up.MakeMargeTmpBuffer();
+	mat_pu.MakeMargeTmpBuffer();
+	mat_pp.MakeMargeTmpBuffer();
+	for(unsigned int icolor=0;icolor<color.Size();icolor++){
+#if defined(_OPENMP)
+#pragma omp parallel for
+#endif
+	for(int iie=(int)color.index[icolor];iie<(int)color.index[icolor+1];iie++){
+		const unsigned int ielem = color.array[iie];
+		unsigned int noes[nno];	// vfߓ_̑S̐ߓ_ԍ
+		double velo[nno][ndim];	// vfߓ_̒l
+		double velo_msh[nno][ndim];	// vfߓ_̒l
+		double velo_r[nno][ndim];	// relative velocity
+		double acc[nno][ndim];	// vfߓ_̒l
+		double press[nno];
+		double apress[nno];
+		double coords[nno][ndim];	// vfߓ_̍W
+		double eCmat_uu[nno][nno][ndim][ndim], eCmat_pp[nno][nno], eCmat_pu[nno][nno][ndim], eCmat_up[nno][nno][ndim];
+		double eMmat_uu[nno][nno][ndim][ndim], eMmat_pu[nno][nno][ndim];
+		double  emat_uu[nno][nno][ndim][ndim],  emat_pp[nno][nno],  emat_pu[nno][nno][ndim],  emat_up[nno][nno][ndim];
+		double eres_u[nno][ndim], eres_p[nno];
 		// vf̐ߓ_ԍĂ
 		es_c_va.GetNodes(ielem,noes);
 		// ߓ_̍WAlĂ
@@ -945,6 +969,7 @@ static bool AddLinearSystem_NavierStokesALE2D_NonStatic_Newmark_P1P1(
 			res_p.AddValue( noes[ino],0,eres_p[ino]);
 		}
 	}
+	}
 	return true;
 }
 
@@ -1246,11 +1271,6 @@ static bool AddLinearSystem_NavierStokesThermalBuoy2D_NonStatic_Newmark_P1P1(
 	const unsigned int nno = 3;
 	const unsigned int ndim = 2;
 
-	double eCmat_uu[nno][nno][ndim][ndim], eCmat_pp[nno][nno], eCmat_pu[nno][nno][ndim], eCmat_up[nno][nno][ndim];
-	double eMmat_uu[nno][nno][ndim][ndim], eMmat_pu[nno][nno][ndim];
-	double  emat_uu[nno][nno][ndim][ndim],  emat_pp[nno][nno],  emat_pu[nno][nno][ndim],  emat_up[nno][nno][ndim];
-	double eres_u[nno][ndim], eres_p[nno];
-
 	assert( ls.FindIndexArray_Seg(id_field_velo, CORNER,world) 
 		 != ls.FindIndexArray_Seg(id_field_press,CORNER,world) );
 
@@ -1268,7 +1288,22 @@ static bool AddLinearSystem_NavierStokesThermalBuoy2D_NonStatic_Newmark_P1P1(
 	const CNodeAry::CNodeSeg& ns_apress = field_press.GetNodeSeg(CORNER,true,world,ACCELERATION);//na_press.GetSeg(id_ns_apress);
 	const CNodeAry::CNodeSeg& ns_temp = field_temp.GetNodeSeg(CORNER,true, world,VALUE);//na_velo.GetSeg(id_ns_velo);
 
-	for(unsigned int ielem=0;ielem<ea.Size();ielem++){
+	// elements of one color do not share a node, so they can be merged at the same time
+	const Com::CIndexedArray& color = ea.GetColoring( field_velo.GetIdElemSeg(id_ea,CORNER,true,world) );
+	mat_uu.MakeMargeTmpBuffer();	// one merge buffer for each thread
+	mat_up.MakeMargeTmpBuffer();
+	mat_pu.MakeMargeTmpBuffer();
+	mat_pp.MakeMargeTmpBuffer();
+	for(unsigned int icolor=0;icolor<color.Size();icolor++){
+#if defined(_OPENMP)
+#pragma omp parallel for
+#endif
+	for(int iie=(int)color.index[icolor];iie<(int)color.index[icolor+1];iie++){
+		const unsigned int ielem = color.array[iie];
+		double eCmat_uu[nno][nno][ndim][ndim], eCmat_pp[nno][nno], eCmat_pu[nno][nno][ndim], eCmat_up[nno][nno][ndim];
+		double eMmat_uu[nno][nno][ndim][ndim], eMmat_pu[nno][nno][ndim];
+		double  emat_uu[nno][nno][ndim][ndim],  emat_pp[nno][nno],  emat_pu[nno][nno][ndim],  emat_up[nno][nno][ndim];
+		double eres_u[nno][ndim], eres_p[nno];
 		// vf̐ߓ_ԍĂ
 		unsigned int noes[nno];	// vfߓ_̑S̐ߓ_ԍ
 		es_c_va.GetNodes(ielem,noes);
@@ -1351,6 +1386,7 @@ static bool AddLinearSystem_NavierStokesThermalBuoy2D_NonStatic_Newmark_P1P1(
 			res_p.AddValue( noes[ino],0,eres_p[ino]);
 		}
 	}
+	}
 	return true;
 }
 
@@ -1382,11 +1418,6 @@ static bool AddLinearSystem_NavierStokesThermalBuoy2D_NonStatic_Newmark_P1P1_Com
 	const unsigned int nno = 3;
 	const unsigned int ndim = 2;
 
-	double eCmat_uu[nno][nno][ndim][ndim], eCmat_pp[nno][nno], eCmat_pu[nno][nno][ndim], eCmat_up[nno][nno][ndim];
-	double eMmat_uu[nno][nno][ndim][ndim], eMmat_pu[nno][nno][ndim];
-	double  emat_uu[nno][nno][ndim][ndim],  emat_pp[nno][nno],  emat_pu[nno][nno][ndim],  emat_up[nno][nno][ndim];
-	double eres_u[nno][ndim], eres_p[nno];
-
 	assert( ls.FindIndexArray_Seg(id_field_velo, CORNER,world) 
 		 == ls.FindIndexArray_Seg(id_field_press,CORNER,world) );
 
@@ -1400,7 +1431,19 @@ static bool AddLinearSystem_NavierStokesThermalBuoy2D_NonStatic_Newmark_P1P1_Com
 	const CNodeAry::CNodeSeg& ns_apress = field_press.GetNodeSeg(CORNER,true,world,ACCELERATION);//na_press.GetSeg(id_ns_apress);
 	const CNodeAry::CNodeSeg& ns_temp = field_temp.GetNodeSeg(CORNER,true, world,VALUE);//na_velo.GetSeg(id_ns_velo);
 
-	for(unsigned int ielem=0;ielem<ea.Size();ielem++){
+	// elements of one color do not share a node, so they can be merged at the same time
+	const Com::CIndexedArray& color = ea.GetColoring( field_velo.GetIdElemSeg(id_ea,CORNER,true,world) );
+	mat_uu.MakeMargeTmpBuffer();	// one merge buffer for each thread
+	for(unsigned int icolor=0;icolor<color.Size();icolor++){
+#if defined(_OPENMP)
+#pragma omp parallel for
+#endif
+	for(int iie=(int)color.index[icolor];iie<(int)color.index[icolor+1];iie++){
+		const unsigned int ielem = color.array[iie];
+		double eCmat_uu[nno][nno][ndim][ndim], eCmat_pp[nno][nno], eCmat_pu[nno][nno][ndim], eCmat_up[nno][nno][ndim];
+		double eMmat_uu[nno][nno][ndim][ndim], eMmat_pu[nno][nno][ndim];
+		double  emat_uu[nno][nno][ndim][ndim],  emat_pp[nno][nno],  emat_pu[nno][nno][ndim],  emat_up[nno][nno][ndim];
+		double eres_u[nno][ndim], eres_p[nno];
 		// vf̐ߓ_ԍĂ
 		unsigned int noes[nno];	// vfߓ_̑S̐ߓ_ԍ
 		es_c_va.GetNodes(ielem,noes);
@@ -1491,6 +1534,7 @@ static bool AddLinearSystem_NavierStokesThermalBuoy2D_NonStatic_Newmark_P1P1_Com
 			res_u.AddValue( noes[ino],2,eres_p[ino]);
         }
 	}
+	}
 	return true;
 }
 
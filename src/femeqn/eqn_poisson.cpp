@@ -34,6 +34,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 
 #include "delfem/femls/linearsystem_field.h"
 #include "delfem/femls/linearsystem_fieldsave.h"
+#include "delfem/femls/linearsystem_matfree.h"
 
 #include "delfem/femeqn/ker_emat_tri.h"
 #include "delfem/femeqn/ker_emat_tet.h"
@@ -67,21 +68,26 @@ static bool AddLinearSystem_Poisson2D_P1
 	const unsigned int nno = 3;
 	const unsigned int ndim = 2;
 
-	unsigned int no_c[nno];	// vfߓ_̑S̐ߓ_ԍ
-
-	double value_c[nno];		// vfߓ_̒l
-	double coord_c[nno][ndim];	// vfߓ_̍W
-				
-	double emat[nno][nno];	// vfs
-	double eres_c[nno];	// vfߓ_́AÓAcxNg
-				
 	CMatDia_BlkCrs& mat_cc = ls.GetMatrix(  id_field_val,CORNER,world);
 	CVector_Blk&    res_c  = ls.GetResidual(id_field_val,CORNER,world);
 
 	const CNodeAry::CNodeSeg& ns_c_val = field_val.GetNodeSeg(CORNER,true,world);
 	const CNodeAry::CNodeSeg& ns_c_co  = field_val.GetNodeSeg(CORNER,false,world);
 
-	for(unsigned int ielem=0;ielem<ea.Size();ielem++){
+	// elements of one color do not share a node, so they can be merged at the same time
+	const Com::CIndexedArray& color = ea.GetColoring( field_val.GetIdElemSeg(id_ea,CORNER,true,world) );
+	mat_cc.MakeMargeTmpBuffer();	// one merge buffer for each thread
+	for(unsigned int icolor=0;icolor<color.Size();icolor++){
+#if defined(_OPENMP)
+#pragma omp parallel for
+#endif
+	for(int iie=(int)color.index[icolor];iie<(int)color.index[icolor+1];iie++){
+		const unsigned int ielem = color.array[iie];
+		unsigned int no_c[nno];	// vfߓ_̑S̐ߓ_ԍ
+		double value_c[nno];		// vfߓ_̒l
+		double coord_c[nno][ndim];	// vfߓ_̍W
+		double emat[nno][nno];	// vfs
+		double eres_c[nno];	// vfߓ_́AÓAcxNg
 		// vfz񂩂vfZOg̐ߓ_ԍo
 		es_c_co.GetNodes(ielem,no_c);
 		for(unsigned int inoes=0;inoes<nno;inoes++){
@@ -121,6 +127,7 @@ static bool AddLinearSystem_Poisson2D_P1
 			res_c.AddValue( no_c[inoes],0,eres_c[inoes]);
 		}
 	}
+	}
 	return true;
 }
 
@@ -146,19 +153,6 @@ static bool AddLinearSystem_Poisson2D_P1b(
 	const unsigned int nno_b = 1;
 	const unsigned int ndim = 2;
 
-	unsigned int no_c[nno_c];	// vfߓ_̑S̐ߓ_ԍ
-	unsigned int no_b;	// vfߓ_̑S̐ߓ_ԍ
-
-	double value_c[nno_c], value_b;	// vfߓ_̒l
-	double coord_c[nno_c][ndim];	// vfߓ_̍W
-				
-	double dldx[nno_c][ndim];	// `֐xy
-	double const_term[nno_c];	// `֐̒萔
-
-	double emat_cc[nno_c][nno_c], emat_bb, emat_cb[nno_c], emat_bc[nno_c];	// vfs
-	double eqf_in_c[nno_c], eqf_out_c[nno_c], eres_c[nno_c];	// vfߓ_́AÓAcxNg
-	double eqf_in_b, eqf_out_b, eres_b;	// vfߓ_́AÓAcxNg
-
 	CMatDia_BlkCrs& mat_cc = ls.GetMatrix(id_field_val,CORNER,world);
 	CMatDia_BlkCrs& mat_bb = ls.GetMatrix(id_field_val,BUBBLE,world);
 	CMat_BlkCrs& mat_cb = ls.GetMatrix(id_field_val,CORNER, id_field_val,BUBBLE, world);
@@ -170,8 +164,27 @@ static bool AddLinearSystem_Poisson2D_P1b(
 	const CNodeAry::CNodeSeg& ns_b_val = field_val.GetNodeSeg(BUBBLE,true, world);
 	const CNodeAry::CNodeSeg& ns_c_co  = field_val.GetNodeSeg(CORNER,false,world);
 
-	for(unsigned int ielem=0;ielem<ea.Size();ielem++)
-	{
+	// elements of one color do not share a node, so they can be merged at the same time
+	const Com::CIndexedArray& color = ea.GetColoring( field_val.GetIdElemSeg(id_ea,CORNER,true,world) );
+	mat_cc.MakeMargeTmpBuffer();	// one merge buffer for each thread
+	mat_cb.MakeMargeTmpBuffer();
+	mat_bc.MakeMargeTmpBuffer();
+	mat_bb.MakeMargeTmpBuffer();
+	for(unsigned int icolor=0;icolor<color.Size();icolor++){
+#if defined(_OPENMP)
+#pragma omp parallel for
+#endif
+	for(int iie=(int)color.index[icolor];iie<(int)color.index[icolor+1];iie++){
+		const unsigned int ielem = color.array[iie];
+		unsigned int no_c[nno_c];	// vfߓ_̑S̐ߓ_ԍ
+		unsigned int no_b;	// vfߓ_̑S̐ߓ_ԍ
+		double value_c[nno_c], value_b;	// vfߓ_̒l
+		double coord_c[nno_c][ndim];	// vfߓ_̍W
+		double dldx[nno_c][ndim];	// `֐xy
+		double const_term[nno_c];	// `֐̒萔
+		double emat_cc[nno_c][nno_c], emat_bb, emat_cb[nno_c], emat_bc[nno_c];	// vfs
+		double eqf_in_c[nno_c], eqf_out_c[nno_c], eres_c[nno_c];	// vfߓ_́AÓAcxNg
+		double eqf_in_b, eqf_out_b, eres_b;	// vfߓ_́AÓAcxNg
 		// vfz񂩂vfZOg̐ߓ_ԍo
 		es_c.GetNodes(ielem,no_c);
 		es_b.GetNodes(ielem,&no_b);
@@ -243,6 +256,7 @@ static bool AddLinearSystem_Poisson2D_P1b(
 		}
 		res_b.AddValue( no_b,0,eres_b );
 	}
+	}
 	return true;
 }
 
@@ -266,22 +280,26 @@ static bool AddLinearSystem_Poisson3D_P1(
 	const unsigned int nno = 4;
 	const unsigned int ndim = 3;
 
-	unsigned int no_c[nno];	// vfߓ_̑S̐ߓ_ԍ
-
-	double value_c[nno];		// vfߓ_̒l
-	double coord_c[nno][ndim];	// vfߓ_̍W
-			
-	double emat[nno][nno];	// vfs
-	double eres_c[nno];	// vfߓ_́AÓAcxNg
-				
 	CMatDia_BlkCrs& mat_cc = ls.GetMatrix(  id_field_val,CORNER,world);
 	CVector_Blk&    res_c  = ls.GetResidual(id_field_val,CORNER,world);
 
 	const CNodeAry::CNodeSeg& ns_c_val = field_val.GetNodeSeg(CORNER,true,world);
 	const CNodeAry::CNodeSeg& ns_c_co  = field_val.GetNodeSeg(CORNER,false,world);
 
-	for(unsigned int ielem=0;ielem<ea.Size();ielem++)
-	{
+	// elements of one color do not share a node, so they can be merged at the same time
+	const Com::CIndexedArray& color = ea.GetColoring( field_val.GetIdElemSeg(id_ea,CORNER,false,world) );
+	mat_cc.MakeMargeTmpBuffer();	// one merge buffer for each thread
+	for(unsigned int icolor=0;icolor<color.Size();icolor++){
+#if defined(_OPENMP)
+#pragma omp parallel for
+#endif
+	for(int iie=(int)color.index[icolor];iie<(int)color.index[icolor+1];iie++){
+		const unsigned int ielem = color.array[iie];
+		unsigned int no_c[nno];	// vfߓ_̑S̐ߓ_ԍ
+		double value_c[nno];		// vfߓ_̒l
+		double coord_c[nno][ndim];	// vfߓ_̍W
+		double emat[nno][nno];	// vfs
+		double eres_c[nno];	// vfߓ_́AÓAcxNg
 		// vfz񂩂vfZOg̐ߓ_ԍo
 		es_c.GetNodes(ielem,no_c);
 		// ߓ_̒lė
@@ -319,6 +337,7 @@ static bool AddLinearSystem_Poisson3D_P1(
 			res_c.AddValue( no_c[inoes],0,eres_c[inoes]);
 		}
 	}
+	}
 	return true;
 }
 
@@ -347,25 +366,29 @@ static bool AddLinearSystem_Poisson3D_Q1(
 	const unsigned int nno = 8;
 	const unsigned int ndim = 3;
 
-	unsigned int no_c_co[nno];	// vfߓ_̑S̐ߓ_ԍ
-	unsigned int no_c_va[nno];	// vfߓ_̑S̐ߓ_ԍ
-
-	double value_c[nno];		// vfߓ_̒l
-	double coord_c[nno][ndim];	// vfߓ_̍W
-				
-	double dndx[nno][ndim];	// `֐xy
-	double an_c[nno];
-
-	double emat[nno][nno];	// vfs
-	double eres_c[nno];	// vfߓ_́AÓAcxNg
-				
 	CMatDia_BlkCrs& mat_cc = ls.GetMatrix(  id_field_val,CORNER,world);
 	CVector_Blk&    res_c  = ls.GetResidual(id_field_val,CORNER,world);
 
 	const CNodeAry::CNodeSeg& ns_c_val = field_val.GetNodeSeg(CORNER,true, world);
 	const CNodeAry::CNodeSeg& ns_c_co  = field_val.GetNodeSeg(CORNER,false,world);
 
-	for(unsigned int ielem=0;ielem<ea.Size();ielem++){
+	// elements of one color do not share a node, so they can be merged at the same time
+	const Com::CIndexedArray& color = ea.GetColoring( field_val.GetIdElemSeg(id_ea,CORNER,true,world) );
+	mat_cc.MakeMargeTmpBuffer();	// one merge buffer for each thread
+	for(unsigned int icolor=0;icolor<color.Size();icolor++){
+#if defined(_OPENMP)
+#pragma omp parallel for
+#endif
+	for(int iie=(int)color.index[icolor];iie<(int)color.index[icolor+1];iie++){
+		const unsigned int ielem = color.array[iie];
+		unsigned int no_c_co[nno];	// vfߓ_̑S̐ߓ_ԍ
+		unsigned int no_c_va[nno];	// vfߓ_̑S̐ߓ_ԍ
+		double value_c[nno];		// vfߓ_̒l
+		double coord_c[nno][ndim];	// vfߓ_̍W
+		double dndx[nno][ndim];	// `֐xy
+		double an_c[nno];
+		double emat[nno][nno];	// vfs
+		double eres_c[nno];	// vfߓ_́AÓAcxNg
 		// vfz񂩂vfZOg̐ߓ_ԍo
 		es_c_co.GetNodes(ielem,no_c_co);
 		for(unsigned int ino=0;ino<nno;ino++){ 
@@ -421,6 +444,7 @@ static bool AddLinearSystem_Poisson3D_Q1(
 			res_c.AddValue( no_c_va[ino],0,eres_c[ino]);
 		}
 	}
+	}
 	return true;
 }
 
@@ -512,14 +536,6 @@ bool AddLinearSystem_Poisson2D_P1(
 	const unsigned int nno = 3;
 	const unsigned int ndim = 2;
 
-	unsigned int no_c[nno];	// vfߓ_̑S̐ߓ_ԍ
-
-	double value_c[nno];		// vfߓ_̒l
-	double coord_c[nno][ndim];	// vfߓ_̍W
-				
-	double emat[nno][nno];	// vfs
-	double eqf_out_c[nno];	// vfߓ_́AÓAcxNg
-				
 	CMatDia_BlkCrs&      mat_cc  = ls.GetMatrix(id_field_val,CORNER,world);
 	CVector_Blk&         force_c = ls.GetForce(id_field_val,CORNER,world);
 	CMat_BlkCrs& mat_cc_boundary = ls.GetMatrix_Boundary(id_field_val,CORNER,id_field_val,CORNER,world);
@@ -527,8 +543,21 @@ bool AddLinearSystem_Poisson2D_P1(
 	const CNodeAry::CNodeSeg& ns_c_val = field_val.GetNodeSeg(CORNER,true, world);//na_c_val.GetSeg(id_ns_c_val);
 	const CNodeAry::CNodeSeg& ns_c_co  = field_val.GetNodeSeg(CORNER,false,world);//na_c_co.GetSeg(id_ns_c_co);
 
-	for(unsigned int ielem=0;ielem<ea.Size();ielem++)
-	{
+	// elements of one color do not share a node, so they can be merged at the same time
+	const Com::CIndexedArray& color = ea.GetColoring( field_val.GetIdElemSeg(id_ea,CORNER,true,world) );
+	mat_cc.MakeMargeTmpBuffer();	// one merge buffer for each thread
+	mat_cc_boundary.MakeMargeTmpBuffer();
+	for(unsigned int icolor=0;icolor<color.Size();icolor++){
+#if defined(_OPENMP)
+#pragma omp parallel for
+#endif
+	for(int iie=(int)color.index[icolor];iie<(int)color.index[icolor+1];iie++){
+		const unsigned int ielem = color.array[iie];
+		unsigned int no_c[nno];	// vfߓ_̑S̐ߓ_ԍ
+		double value_c[nno];		// vfߓ_̒l
+		double coord_c[nno][ndim];	// vfߓ_̍W
+		double emat[nno][nno];	// vfs
+		double eqf_out_c[nno];	// vfߓ_́AÓAcxNg
 		// vfz񂩂vfZOg̐ߓ_ԍo
 		es_c_co.GetNodes(ielem,no_c);
 		// ߓ_̒lė
@@ -565,6 +594,7 @@ bool AddLinearSystem_Poisson2D_P1(
 			force_c.AddValue( no_c[ino],0,eqf_out_c[ino]);
 		}
 	}
+	}
 	return true;
 }
 
@@ -590,19 +620,6 @@ static bool AddLinearSystem_Poisson2D_P1b(
 	const unsigned int nno_b = 1;
 	const unsigned int ndim = 2;
 
-	unsigned int no_c[nno_c];	// vfߓ_̑S̐ߓ_ԍ
-	unsigned int no_b;	// vfߓ_̑S̐ߓ_ԍ
-
-	double value_c[nno_c], value_b;	// vfߓ_̒l
-	double coord_c[nno_c][ndim];	// vfߓ_̍W
-				
-	double dldx[nno_c][ndim];	// `֐xy
-	double const_term[nno_c];	// `֐̒萔
-
-	double emat_cc[nno_c][nno_c], emat_bb, emat_cb[nno_c], emat_bc[nno_c];	// vfs
-	double eqf_out_c[nno_c];	// vfߓ_́AÓAcxNg
-	double eqf_out_b;	// vfߓ_́AÓAcxNg
-
 	CMatDia_BlkCrs& mat_cc = ls.GetMatrix(id_field_val,CORNER,world);
 	CMatDia_BlkCrs& mat_bb = ls.GetMatrix(id_field_val,BUBBLE,world);
 	CMat_BlkCrs& mat_cb = ls.GetMatrix(id_field_val,CORNER, id_field_val,BUBBLE, world);
@@ -618,8 +635,31 @@ static bool AddLinearSystem_Poisson2D_P1b(
 	const CNodeAry::CNodeSeg& ns_b_val = field_val.GetNodeSeg(BUBBLE,true, world);
 	const CNodeAry::CNodeSeg& ns_c_co  = field_val.GetNodeSeg(CORNER,false,world);
 
-	for(unsigned int ielem=0;ielem<ea.Size();ielem++)
-	{
+	// elements of one color do not share a node, so they can be merged at the same time
+	const Com::CIndexedArray& color = ea.GetColoring( field_val.GetIdElemSeg(id_ea,CORNER,true,world) );
+	mat_cc.MakeMargeTmpBuffer();	// one merge buffer for each thread
+	mat_cb.MakeMargeTmpBuffer();
+	mat_bc.MakeMargeTmpBuffer();
+	mat_bb.MakeMargeTmpBuffer();
+	mat_cc_bound.MakeMargeTmpBuffer();
+	mat_cb_bound.MakeMargeTmpBuffer();
+	mat_bc_bound.MakeMargeTmpBuffer();
+	mat_bb_bound.MakeMargeTmpBuffer();
+	for(unsigned int icolor=0;icolor<color.Size();icolor++){
+#if defined(_OPENMP)
+#pragma omp parallel for
+#endif
+	for(int iie=(int)color.index[icolor];iie<(int)color.index[icolor+1];iie++){
+		const unsigned int ielem = color.array[iie];
+		unsigned int no_c[nno_c];	// vfߓ_̑S̐ߓ_ԍ
+		unsigned int no_b;	// vfߓ_̑S̐ߓ_ԍ
+		double value_c[nno_c], value_b;	// vfߓ_̒l
+		double coord_c[nno_c][ndim];	// vfߓ_̍W
+		double dldx[nno_c][ndim];	// `֐xy
+		double const_term[nno_c];	// `֐̒萔
+		double emat_cc[nno_c][nno_c], emat_bb, emat_cb[nno_c], emat_bc[nno_c];	// vfs
+		double eqf_out_c[nno_c];	// vfߓ_́AÓAcxNg
+		double eqf_out_b;	// vfߓ_́AÓAcxNg
 		// vfz񂩂vfZOg̐ߓ_ԍo
 		es_c.GetNodes(ielem,no_c);
 		es_b.GetNodes(ielem,&no_b);
@@ -678,6 +718,7 @@ static bool AddLinearSystem_Poisson2D_P1b(
 		}
 		force_b.AddValue( no_b,0,eqf_out_b );
 	}
+	}
 	return true;
 }
 
@@ -724,6 +765,47 @@ bool Fem::Eqn::AddLinSys_Poisson(
 	return true;
 }
 
+// the element matrix is not made, the operator is recomputed in each matrix vector product
+bool Fem::Eqn::AddLinSys_Poisson(
+		Fem::Ls::CLinearSystem_MatFree& ls,
+		double alpha, double source,
+		const Fem::Field::CFieldWorld& world,
+		const unsigned int id_field_val, 
+		unsigned int id_ea )
+{
+	if( !world.IsIdField(id_field_val) ) return false;
+	const CField& val_field = world.GetField(id_field_val);
+
+	if( val_field.GetFieldType() != SCALAR ) return false;
+
+	if( id_ea != 0 ){
+		const INTERPOLATION_TYPE itype = val_field.GetInterpolationType(id_ea,world);
+		if( itype != TRI11 && itype != TET11 && itype != HEX11 ){
+			std::cout << "Error!-->Not Implimented" << std::endl;
+			return false;
+		}
+		const int iop = ls.AddElemOp(CLinearSystem_MatFree::DIFFUSION,alpha,0.0,id_field_val,id_ea,world);
+		if( iop < 0 ) return false;
+		return ls.AddResidual_ElemOp(iop,&source,world);
+	}
+	else{
+		const std::vector<unsigned int>& aIdEA = val_field.GetAryIdEA();
+		for(unsigned int iiea=0;iiea<aIdEA.size();iiea++){
+			const unsigned int id_ea = aIdEA[iiea];
+			bool res = Fem::Eqn::AddLinSys_Poisson(
+					ls,
+					alpha, source,
+					world,
+					id_field_val, 
+					id_ea );
+			if( !res ) return false;
+		}
+		return true;
+	}
+
+	return true;
+}
+
 
 
 
@@ -751,19 +833,24 @@ static bool AddLinearSystem_Wave2D_P1(
 	const unsigned int nno = 3;
 	const unsigned int ndim = 2;
 
-	unsigned int no_c[nno];	// vfߓ_̑S̐ߓ_ԍ
-	double coord_c[nno][ndim];	// vfߓ_̍W
-				
-	double eKmat[nno][nno];	// vfs
-	double eMmat[nno];	// vfߓ_́AÓAcxNg
-				
 	CMatDia_BlkCrs& Kmat_cc = ls.GetMatrix(       id_field_val,CORNER,world);
 	CDiaMat_Blk&    Mmat_cc = ls.GetDiaMassMatrix(id_field_val,CORNER,world);
 
 	const CNodeAry::CNodeSeg& ns_c_co  = field_val.GetNodeSeg(CORNER,false,world);
 
-	for(unsigned int ielem=0;ielem<ea.Size();ielem++)
-	{
+	// elements of one color do not share a node, so they can be merged at the same time
+	const Com::CIndexedArray& color = ea.GetColoring( field_val.GetIdElemSeg(id_ea,CORNER,false,world) );
+	Kmat_cc.MakeMargeTmpBuffer();	// one merge buffer for each thread
+	for(unsigned int icolor=0;icolor<color.Size();icolor++){
+#if defined(_OPENMP)
+#pragma omp parallel for
+#endif
+	for(int iie=(int)color.index[icolor];iie<(int)color.index[icolor+1];iie++){
+		const unsigned int ielem = color.array[iie];
+		unsigned int no_c[nno];	// vfߓ_̑S̐ߓ_ԍ
+		double coord_c[nno][ndim];	// vfߓ_̍W
+		double eKmat[nno][nno];	// vfs
+		double eMmat[nno];	// vfߓ_́AÓAcxNg
 		// vfz񂩂vfZOg̐ߓ_ԍo
 		es_c_co.GetNodes(ielem,no_c);
 		for(unsigned int inoes=0;inoes<nno;inoes++){
@@ -792,6 +879,7 @@ static bool AddLinearSystem_Wave2D_P1(
 			Mmat_cc.Mearge(no_c[ino],1,&eMmat[ino]);
 		}
 	}
+	}
 	return true;
 }
 
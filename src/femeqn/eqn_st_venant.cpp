@@ -175,19 +175,6 @@ bool AddLinSys_StVenant2D_Static_P1(
 	const unsigned int nnoes = 3;
 	const unsigned int ndim = 2;
 
-	unsigned int noes[nnoes];	// vf̐ߓ_̐ߓ_ԍ
-
-	double emat[nnoes][nnoes][ndim][ndim];	// vfs
-	double eforce_ex[nnoes][ndim];		// vfO̓xNg
-	double eforce_in[nnoes][ndim];		// vf̓xNg
-	double eres[nnoes][ndim];		// vfcxNg
-
-	double ecoords[nnoes][ndim];		// vfߓ_W
-	double edisp[  nnoes][ndim];		// vfߓ_ψ
-
-	double dldx[nnoes][ndim];		// `֐̋Ԕ
-	double zero_order_term[nnoes];	// `֐̒萔
-				
 	CMatDia_BlkCrs& mat_cc = ls.GetMatrix(  id_field_disp,CORNER,world);	// vfs(R[i-R[i[)
 	CVector_Blk&     res_c = ls.GetResidual(id_field_disp,CORNER,world);	// vfcxNg(R[i[)
 
@@ -200,7 +187,24 @@ bool AddLinSys_StVenant2D_Static_P1(
 */
 	double g[2] = { g_x, g_y };
 
-	for(unsigned int ielem=0;ielem<ea.Size();ielem++){
+	// elements of one color do not share a node, so they can be merged at the same time
+	const Com::CIndexedArray& color = ea.GetColoring( field_disp.GetIdElemSeg(id_ea,CORNER,true,world) );
+	mat_cc.MakeMargeTmpBuffer();	// one merge buffer for each thread
+	for(unsigned int icolor=0;icolor<color.Size();icolor++){
+#if defined(_OPENMP)
+#pragma omp parallel for
+#endif
+	for(int iie=(int)color.index[icolor];iie<(int)color.index[icolor+1];iie++){
+		const unsigned int ielem = color.array[iie];
+		unsigned int noes[nnoes];	// vf̐ߓ_̐ߓ_ԍ
+		double emat[nnoes][nnoes][ndim][ndim];	// vfs
+		double eforce_ex[nnoes][ndim];		// vfO̓xNg
+		double eforce_in[nnoes][ndim];		// vf̓xNg
+		double eres[nnoes][ndim];		// vfcxNg
+		double ecoords[nnoes][ndim];		// vfߓ_W
+		double edisp[  nnoes][ndim];		// vfߓ_ψ
+		double dldx[nnoes][ndim];		// `֐̋Ԕ
+		double zero_order_term[nnoes];	// `֐̒萔
 		// vf̐ߓ_ԍĂ
 		es_co.GetNodes(ielem,noes);
 		// ߓ_̍WAlĂ
@@ -264,6 +268,7 @@ bool AddLinSys_StVenant2D_Static_P1(
 		}
 		}
 	}
+	}
 
 	return true;
 }
@@ -334,13 +339,6 @@ bool AddLinSys_StVenant2D_NonStatic_NewmarkBeta_P1
 	const unsigned int nnoes = 3;
 	const unsigned int ndim = 2;
 
-	unsigned int noes[nnoes];	// elment node nuber 2 grobal node number
-	
-	double eKmat[nnoes][nnoes][ndim][ndim];	// element stiffness matrix
-	double eMmat[nnoes][nnoes][ndim][ndim];	// element mass matrix		
-	double eforce_in[nnoes][ndim];		// element residual vector		
-	double eforce_ex[nnoes][ndim];		// element external force vector
-				
 	CMatDia_BlkCrs& mat_cc = ls.GetMatrix(id_field_disp,CORNER,world);	// matrix
 	CVector_Blk&     res_c = ls.GetResidual(id_field_disp,CORNER,world);// residual vector
 	
@@ -353,8 +351,20 @@ bool AddLinSys_StVenant2D_NonStatic_NewmarkBeta_P1
 
 	double g[2] = { g_x, g_y };
 
-	for(unsigned int ielem=0;ielem<ea.Size();ielem++)
-	{
+	// elements of one color do not share a node, so they can be merged at the same time
+	const Com::CIndexedArray& color = ea.GetColoring( field_disp.GetIdElemSeg(id_ea,CORNER,true,world) );
+	mat_cc.MakeMargeTmpBuffer();	// one merge buffer for each thread
+	for(unsigned int icolor=0;icolor<color.Size();icolor++){
+#if defined(_OPENMP)
+#pragma omp parallel for
+#endif
+	for(int iie=(int)color.index[icolor];iie<(int)color.index[icolor+1];iie++){
+		const unsigned int ielem = color.array[iie];
+		unsigned int noes[nnoes];	// elment node nuber 2 grobal node number
+		double eKmat[nnoes][nnoes][ndim][ndim];	// element stiffness matrix
+		double eMmat[nnoes][nnoes][ndim][ndim];	// element mass matrix		
+		double eforce_in[nnoes][ndim];		// element residual vector		
+		double eforce_ex[nnoes][ndim];		// element external force vector
 		es_co.GetNodes(ielem,noes);	// get global node number of coordinate
 		double ecoords[nnoes][ndim];	// element node coordinate
 		for(unsigned int ino=0;ino<nnoes;ino++){
@@ -456,6 +466,7 @@ bool AddLinSys_StVenant2D_NonStatic_NewmarkBeta_P1
 		}
 		}
 	}
+	}
 	return true;
 }
 
@@ -530,13 +541,6 @@ bool AddLinSys_StVenant2D_NonStatic_BackwardEular_P1
 	const unsigned int nno = 3;
 	const unsigned int ndim = 2;
 	
-	unsigned int no[nno];	// elment node nuber 2 grobal node number
-	
-	double eKmat[nno][nno][ndim][ndim];	// element stiffness matrix
-	double eMmat[nno][nno][ndim][ndim];	// element mass matrix		
-	double eforce_in[nno][ndim];		// element residual vector		
-	double eforce_ex[nno][ndim];		// element external force vector
-	
 	CMatDia_BlkCrs& mat_cc = ls.GetMatrix(id_field_disp,CORNER,world);	// matrix
 	CVector_Blk&     res_c = ls.GetResidual(id_field_disp,CORNER,world);// residual vector
 	
@@ -548,8 +552,20 @@ bool AddLinSys_StVenant2D_NonStatic_BackwardEular_P1
 	
 	double g[2] = { g_x, g_y };
 	
-	for(unsigned int ielem=0;ielem<ea.Size();ielem++)
-	{
+	// elements of one color do not share a node, so they can be merged at the same time
+	const Com::CIndexedArray& color = ea.GetColoring( field_disp.GetIdElemSeg(id_ea,CORNER,true,world) );
+	mat_cc.MakeMargeTmpBuffer();	// one merge buffer for each thread
+	for(unsigned int icolor=0;icolor<color.Size();icolor++){
+#if defined(_OPENMP)
+#pragma omp parallel for
+#endif
+	for(int iie=(int)color.index[icolor];iie<(int)color.index[icolor+1];iie++){
+		const unsigned int ielem = color.array[iie];
+		unsigned int no[nno];	// elment node nuber 2 grobal node number
+		double eKmat[nno][nno][ndim][ndim];	// element stiffness matrix
+		double eMmat[nno][nno][ndim][ndim];	// element mass matrix		
+		double eforce_in[nno][ndim];		// element residual vector		
+		double eforce_ex[nno][ndim];		// element external force vector
 		es_co.GetNodes(ielem,no);	// get global node number of coordinate
 		double ecoords[nno][ndim];	// element node coordinate
 		for(unsigned int ino=0;ino<nno;ino++){
@@ -660,6 +676,7 @@ bool AddLinSys_StVenant2D_NonStatic_BackwardEular_P1
 			}
 		}
 	}
+	}
 	return true;
 }
 
@@ -855,19 +872,6 @@ bool AddLinSys_StVenant3D_Static_P1
 	const unsigned int nnoes = 4;	assert( nnoes == es_c.Length() );
 	const unsigned int ndim = 3;
 
-	unsigned int noes[nnoes];	// vf̐ߓ_̐ߓ_ԍ
-
-	double emat[nnoes][nnoes][ndim][ndim];	// vfs
-	double eforce_ex[nnoes][ndim];		// vfO̓xNg
-	double eforce_in[nnoes][ndim];		// vf̓xNg
-	double eres[nnoes][ndim];		// vfcxNg
-
-	double ecoords[nnoes][ndim];		// vfߓ_W
-	double edisp[  nnoes][ndim];		// vfߓ_ψ
-
-	double dldx[nnoes][ndim];		// `֐̋Ԕ
-	double zero_order_term[nnoes];	// `֐̒萔
-				
 	CMatDia_BlkCrs& mat_cc = ls.GetMatrix(  id_field_disp,CORNER,world);// vfs(R[i-R[i[)
 	CVector_Blk&    res_c  = ls.GetResidual(id_field_disp,CORNER,world);// vfcxNg(R[i[)
 
@@ -876,7 +880,24 @@ bool AddLinSys_StVenant3D_Static_P1
 
 	double g[ndim] = { g_x, g_y, g_z };
 
-	for(unsigned int ielem=0;ielem<ea.Size();ielem++){
+	// elements of one color do not share a node, so they can be merged at the same time
+	const Com::CIndexedArray& color = ea.GetColoring( field_disp.GetIdElemSeg(id_ea,CORNER,true,world) );
+	mat_cc.MakeMargeTmpBuffer();	// one merge buffer for each thread
+	for(unsigned int icolor=0;icolor<color.Size();icolor++){
+#if defined(_OPENMP)
+#pragma omp parallel for
+#endif
+	for(int iie=(int)color.index[icolor];iie<(int)color.index[icolor+1];iie++){
+		const unsigned int ielem = color.array[iie];
+		unsigned int noes[nnoes];	// vf̐ߓ_̐ߓ_ԍ
+		double emat[nnoes][nnoes][ndim][ndim];	// vfs
+		double eforce_ex[nnoes][ndim];		// vfO̓xNg
+		double eforce_in[nnoes][ndim];		// vf̓xNg
+		double eres[nnoes][ndim];		// vfcxNg
+		double ecoords[nnoes][ndim];		// vfߓ_W
+		double edisp[  nnoes][ndim];		// vfߓ_ψ
+		double dldx[nnoes][ndim];		// `֐̋Ԕ
+		double zero_order_term[nnoes];	// `֐̒萔
 		// vf̐ߓ_ԍĂ
 		es_c.GetNodes(ielem,noes);
 		// ߓ_̍WAlĂ
@@ -935,6 +956,7 @@ bool AddLinSys_StVenant3D_Static_P1
 			}
 		}
 	}
+	}
 	return true;
 }
 
@@ -959,24 +981,10 @@ bool AddLinSys_StVenant3D_Static_Q1
 	unsigned int num_integral = 1;
 	const unsigned int nInt = NIntLineGauss[num_integral];
 	const double (*Gauss)[2] = LineGauss[num_integral];
-	double detjac, detwei;
 
 	const unsigned int nnoes = 8;	assert( nnoes == es_c.Length() );
 	const unsigned int ndim = 3;
 
-	unsigned int noes[nnoes];	// vf̐ߓ_̐ߓ_ԍ
-
-	double emat[nnoes][nnoes][ndim][ndim];	// vfs
-	double eforce_ex[nnoes][ndim];		// vfO̓xNg
-	double eforce_in[nnoes][ndim];		// vf̓xNg
-	double eres[nnoes][ndim];		// vfcxNg
-
-	double ecoords[nnoes][ndim];		// vfߓ_W
-	double edisp[  nnoes][ndim];		// vfߓ_ψ
-
-	double dndx[nnoes][ndim];		// `֐̋Ԕ
-	double an[nnoes];
-				
 	CMatDia_BlkCrs& mat_cc = ls.GetMatrix(  id_field_disp,CORNER,world);// vfs(R[i-R[i[)
 	CVector_Blk&     res_c = ls.GetResidual(id_field_disp,CORNER,world);// vfcxNg(R[i[)
 
@@ -985,8 +993,25 @@ bool AddLinSys_StVenant3D_Static_Q1
 
 //	double g[ndim] = { g_x, g_y, g_z };
 
-	for(unsigned int ielem=0;ielem<ea.Size();ielem++)
-	{
+	// elements of one color do not share a node, so they can be merged at the same time
+	const Com::CIndexedArray& color = ea.GetColoring( field_disp.GetIdElemSeg(id_ea,CORNER,true,world) );
+	mat_cc.MakeMargeTmpBuffer();	// one merge buffer for each thread
+	for(unsigned int icolor=0;icolor<color.Size();icolor++){
+#if defined(_OPENMP)
+#pragma omp parallel for
+#endif
+	for(int iie=(int)color.index[icolor];iie<(int)color.index[icolor+1];iie++){
+		const unsigned int ielem = color.array[iie];
+		double detjac, detwei;
+		unsigned int noes[nnoes];	// vf̐ߓ_̐ߓ_ԍ
+		double emat[nnoes][nnoes][ndim][ndim];	// vfs
+		double eforce_ex[nnoes][ndim];		// vfO̓xNg
+		double eforce_in[nnoes][ndim];		// vf̓xNg
+		double eres[nnoes][ndim];		// vfcxNg
+		double ecoords[nnoes][ndim];		// vfߓ_W
+		double edisp[  nnoes][ndim];		// vfߓ_ψ
+		double dndx[nnoes][ndim];		// `֐̋Ԕ
+		double an[nnoes];
 		// vf̐ߓ_ԍĂ
 		es_c.GetNodes(ielem,noes);
 		// ߓ_̍WAlĂ
@@ -1052,6 +1077,7 @@ bool AddLinSys_StVenant3D_Static_Q1
 			}
 		}
 	}
+	}
 
 	return true;
 }
@@ -1128,13 +1154,6 @@ bool AddLinSys_StVenant3D_NonStatic_NewmarkBeta_P1
 	const unsigned int nnoes = 4;
 	const unsigned int ndim = 3;
 
-	double emat[nnoes][nnoes][ndim][ndim];	// coefficient element matrix
-	double eMmat[nnoes][nnoes][ndim][ndim];	// mass element matrix
-	double eKmat[nnoes][nnoes][ndim][ndim];	// stiffness element matrix
-
-	double eforce_in[nnoes][ndim];		// vf̓xNg
-	double eres[nnoes][ndim];		// vfcxNg
-
 	CMatDia_BlkCrs& mat_cc = ls.GetMatrix(  id_field_disp,CORNER,world);// vfs(R[i-R[i[)
 	CVector_Blk&     res_c = ls.GetResidual(id_field_disp,CORNER,world);// vfcxNg(R[i[)
 
@@ -1147,8 +1166,20 @@ bool AddLinSys_StVenant3D_NonStatic_NewmarkBeta_P1
 
 	const double g[ndim] = { g_x, g_y, g_z };
 
-	for(unsigned int ielem=0;ielem<ea.Size();ielem++)
-    {
+	// elements of one color do not share a node, so they can be merged at the same time
+	const Com::CIndexedArray& color = ea.GetColoring( field_disp.GetIdElemSeg(id_ea,CORNER,true,world) );
+	mat_cc.MakeMargeTmpBuffer();	// one merge buffer for each thread
+	for(unsigned int icolor=0;icolor<color.Size();icolor++){
+#if defined(_OPENMP)
+#pragma omp parallel for
+#endif
+	for(int iie=(int)color.index[icolor];iie<(int)color.index[icolor+1];iie++){
+		const unsigned int ielem = color.array[iie];
+		double emat[nnoes][nnoes][ndim][ndim];	// coefficient element matrix
+		double eMmat[nnoes][nnoes][ndim][ndim];	// mass element matrix
+		double eKmat[nnoes][nnoes][ndim][ndim];	// stiffness element matrix
+		double eforce_in[nnoes][ndim];		// vf̓xNg
+		double eres[nnoes][ndim];		// vfcxNg
 	    unsigned int noes[nnoes];
 		es_c.GetNodes(ielem,noes);
 	    double ecoords[nnoes][ndim];		// coordinate 
@@ -1236,6 +1267,7 @@ bool AddLinSys_StVenant3D_NonStatic_NewmarkBeta_P1
 		}
 		}
 	}
+	}
 	return true;
 }
 
@@ -135,13 +135,6 @@ static bool AddLinSys_Stokes2D_Static_P1P1(
 	const unsigned int nno = 3;
 	const unsigned int ndim = 2;
 
-	double emat_uu[nno][nno][ndim][ndim];
-	double emat_pp[nno][nno];
-	double emat_pu[nno][nno][ndim];
-	double emat_up[nno][nno][ndim];
-	double eres_u[nno][ndim];
-	double eres_p[nno];
-
 	assert( ls.FindIndexArray_Seg(id_field_velo, CORNER,world) 
 		 != ls.FindIndexArray_Seg(id_field_press,CORNER,world) );
 
@@ -156,8 +149,24 @@ static bool AddLinSys_Stokes2D_Static_P1P1(
 	const CNodeAry::CNodeSeg& ns_velo  = field_velo.GetNodeSeg( CORNER,true, world,VELOCITY);//na_velo.GetSeg(id_ns_velo);
 	const CNodeAry::CNodeSeg& ns_pres = field_pres.GetNodeSeg(CORNER,true, world,VELOCITY);//na_press.GetSeg(id_ns_press);
 
-	for(unsigned int ielem=0;ielem<ea.Size();ielem++)
-	{
+	// elements of one color do not share a node, so they can be merged at the same time
+	const Com::CIndexedArray& color = ea.GetColoring( field_velo.GetIdElemSeg(id_ea,CORNER,true,world) );
+	mat_uu.MakeMargeTmpBuffer();	// one merge buffer for each thread
+	mat_up.MakeMargeTmpBuffer();
+	mat_pu.MakeMargeTmpBuffer();
+	mat_pp.MakeMargeTmpBuffer();
+	for(unsigned int icolor=0;icolor<color.Size();icolor++){
+#if defined(_OPENMP)
+#pragma omp parallel for
+#endif
+	for(int iie=(int)color.index[icolor];iie<(int)color.index[icolor+1];iie++){
+		const unsigned int ielem = color.array[iie];
+		double emat_uu[nno][nno][ndim][ndim];
+		double emat_pp[nno][nno];
+		double emat_pu[nno][nno][ndim];
+		double emat_up[nno][nno][ndim];
+		double eres_u[nno][ndim];
+		double eres_p[nno];
 		unsigned int no_v[nno];	// vfߓ_̑S̐ߓ_ԍ		
 		// vf̐ߓ_ԍĂ
 		es_velo_c_co.GetNodes(ielem,no_v);
@@ -225,6 +234,7 @@ static bool AddLinSys_Stokes2D_Static_P1P1(
 			res_p.AddValue(no_p[ino],0,eres_p[ino]);
 		}
 	}
+	}
 	return true;
 }
 
@@ -252,13 +262,6 @@ static bool AddLinSys_Stokes2D_Static_P1P1_Combined(
 	const unsigned int nno = 3;
 	const unsigned int ndim = 2;
 
-	double emat_uu[nno][nno][ndim][ndim];
-	double emat_pp[nno][nno];
-	double emat_pu[nno][nno][ndim];
-	double emat_up[nno][nno][ndim];
-	double eres_u[nno][ndim];
-	double eres_p[nno];
-
 	assert( ls.FindIndexArray_Seg(id_field_velo, CORNER,world) 
 		==  ls.FindIndexArray_Seg(id_field_press,CORNER,world) );
 	assert( ls.FindIndexArray_Seg(id_field_velo, CORNER,world) != -1);
@@ -270,8 +273,21 @@ static bool AddLinSys_Stokes2D_Static_P1P1_Combined(
 	const CNodeAry::CNodeSeg& ns_velo  = field_velo.GetNodeSeg( CORNER,true, world,VELOCITY);//na_velo.GetSeg(id_ns_velo);
 	const CNodeAry::CNodeSeg& ns_press = field_press.GetNodeSeg(CORNER,true, world,VELOCITY);//na_press.GetSeg(id_ns_press);
 
-	for(unsigned int ielem=0;ielem<ea.Size();ielem++)
-	{
+	// elements of one color do not share a node, so they can be merged at the same time
+	const Com::CIndexedArray& color = ea.GetColoring( field_velo.GetIdElemSeg(id_ea,CORNER,true,world) );
+	mat_uu.MakeMargeTmpBuffer();	// one merge buffer for each thread
+	for(unsigned int icolor=0;icolor<color.Size();icolor++){
+#if defined(_OPENMP)
+#pragma omp parallel for
+#endif
+	for(int iie=(int)color.index[icolor];iie<(int)color.index[icolor+1];iie++){
+		const unsigned int ielem = color.array[iie];
+		double emat_uu[nno][nno][ndim][ndim];
+		double emat_pp[nno][nno];
+		double emat_pu[nno][nno][ndim];
+		double emat_up[nno][nno][ndim];
+		double eres_u[nno][ndim];
+		double eres_p[nno];
 		unsigned int noes[nno];	// vfߓ_̑S̐ߓ_ԍ		
 		// vf̐ߓ_ԍĂ
 		es_c_co.GetNodes(ielem,noes);
@@ -341,6 +357,7 @@ static bool AddLinSys_Stokes2D_Static_P1P1_Combined(
 			res_u.AddValue( noes[ino],2,eres_p[ino]);
 		}
 	}
+	}
 
 	return true;
 }
@@ -393,8 +410,23 @@ static bool AddLinSys_Stokes2D_Static_P1bP1(
 	const CNodeAry::CNodeSeg& ns_c_velo  = field_velo.GetNodeSeg( CORNER,true, world,VELOCITY);
 	const CNodeAry::CNodeSeg& ns_b_velo  = field_velo.GetNodeSeg( BUBBLE,true, world,VELOCITY);
 
-	for(unsigned int ielem=0;ielem<ea.Size();ielem++)
-	{
+	// elements of one color do not share a node, so they can be merged at the same time
+	const Com::CIndexedArray& color = ea.GetColoring( field_velo.GetIdElemSeg(id_ea,CORNER,true,world) );
+	mat_cucu.MakeMargeTmpBuffer();	// one merge buffer for each thread
+	mat_cubu.MakeMargeTmpBuffer();
+	mat_bucu.MakeMargeTmpBuffer();
+	mat_bubu.MakeMargeTmpBuffer();
+	mat_cup.MakeMargeTmpBuffer();
+	mat_pcu.MakeMargeTmpBuffer();
+	mat_bup.MakeMargeTmpBuffer();
+	mat_pbu.MakeMargeTmpBuffer();
+	mat_pp.MakeMargeTmpBuffer();
+	for(unsigned int icolor=0;icolor<color.Size();icolor++){
+#if defined(_OPENMP)
+#pragma omp parallel for
+#endif
+	for(int iie=(int)color.index[icolor];iie<(int)color.index[icolor+1];iie++){
+		const unsigned int ielem = color.array[iie];
 		// vf̐ߓ_ԍĂ
 	    unsigned int noes_c[nno_c];	// vfߓ_̑S̐ߓ_ԍ
 		es_c_va.GetNodes(ielem,noes_c);
@@ -572,6 +604,7 @@ static bool AddLinSys_Stokes2D_Static_P1bP1(
 			res_p.AddValue( noes_c[ino],0,eres_p[ino]);
 		}
 	}
+	}
 	return true;
 }
 
@@ -734,12 +767,6 @@ static bool AddLinearSystem_Stokes2D_NonStatic_Newmark_P1P1(
 	const unsigned int nno = 3;
 	const unsigned int ndim = 2;
 
-	double eCmat_uu[nno][nno][ndim][ndim], eCmat_pp[nno][nno], eCmat_pu[nno][nno][ndim], eCmat_up[nno][nno][ndim];
-	double eMmat_uu[nno][nno][ndim][ndim];
-	double emat_uu[nno][nno][ndim][ndim],  emat_pp[nno][nno],  emat_pu[nno][nno][ndim],  emat_up[nno][nno][ndim];
-	double eqf_out_u[nno][ndim], eres_u[nno][ndim];
-	double eres_p[nno];
-
 	assert( ls.FindIndexArray_Seg(id_field_velo, CORNER,world) 
 		 != ls.FindIndexArray_Seg(id_field_press,CORNER,world) );
 
@@ -756,8 +783,23 @@ static bool AddLinearSystem_Stokes2D_NonStatic_Newmark_P1P1(
 	const CNodeAry::CNodeSeg& ns_press  = field_press.GetNodeSeg(CORNER,true,world,VELOCITY);
 	const CNodeAry::CNodeSeg& ns_apress = field_press.GetNodeSeg(CORNER,true,world,ACCELERATION);
 
-	for(unsigned int ielem=0;ielem<ea.Size();ielem++)
-	{
+	// elements of one color do not share a node, so they can be merged at the same time
+	const Com::CIndexedArray& color = ea.GetColoring( field_velo.GetIdElemSeg(id_ea,CORNER,true,world) );
+	mat_uu.MakeMargeTmpBuffer();	// one merge buffer for each thread
+	mat_up.MakeMargeTmpBuffer();
+	mat_pu.MakeMargeTmpBuffer();
+	mat_pp.MakeMargeTmpBuffer();
+	for(unsigned int icolor=0;icolor<color.Size();icolor++){
+#if defined(_OPENMP)
+#pragma omp parallel for
+#endif
+	for(int iie=(int)color.index[icolor];iie<(int)color.index[icolor+1];iie++){
+		const unsigned int ielem = color.array[iie];
+		double eCmat_uu[nno][nno][ndim][ndim], eCmat_pp[nno][nno], eCmat_pu[nno][nno][ndim], eCmat_up[nno][nno][ndim];
+		double eMmat_uu[nno][nno][ndim][ndim];
+		double emat_uu[nno][nno][ndim][ndim],  emat_pp[nno][nno],  emat_pu[nno][nno][ndim],  emat_up[nno][nno][ndim];
+		double eqf_out_u[nno][ndim], eres_u[nno][ndim];
+		double eres_p[nno];
 		unsigned int no_v[nno];	// vfߓ_̑S̐ߓ_ԍ
 		// vf̐ߓ_ԍĂ
 		es_velo_c_co.GetNodes(ielem,no_v);	
@@ -867,6 +909,7 @@ static bool AddLinearSystem_Stokes2D_NonStatic_Newmark_P1P1(
 			}
 		}
 	}
+	}
 	return true;
 }
 
@@ -897,12 +940,6 @@ static bool AddLinearSystem_Stokes2D_NonStatic_Newmark_P1P1_Combined(
 	const unsigned int nno = 3;
 	const unsigned int ndim = 2;
 
-	double eCmat_uu[nno][nno][ndim][ndim], eCmat_pp[nno][nno], eCmat_pu[nno][nno][ndim], eCmat_up[nno][nno][ndim];
-	double eMmat_uu[nno][nno][ndim][ndim];
-	double emat_uu[nno][nno][ndim][ndim],  emat_pp[nno][nno],  emat_pu[nno][nno][ndim],  emat_up[nno][nno][ndim];
-	double eqf_out_u[nno][ndim], eres_u[nno][ndim];
-	double eres_p[nno];
-	
 	assert( field_velo.GetIdElemSeg(id_ea,CORNER,true,world) 
 		 == field_press.GetIdElemSeg(id_ea,CORNER,true,world) );
 
@@ -918,8 +955,20 @@ static bool AddLinearSystem_Stokes2D_NonStatic_Newmark_P1P1_Combined(
 	const CNodeAry::CNodeSeg& ns_press  = field_press.GetNodeSeg(CORNER,true,world,VELOCITY);//na_press.GetSeg(id_ns_press);
 	const CNodeAry::CNodeSeg& ns_apress = field_press.GetNodeSeg(CORNER,true,world,ACCELERATION);//na_press.GetSeg(id_ns_apress);
 
-	for(unsigned int ielem=0;ielem<ea.Size();ielem++)
-	{
+	// elements of one color do not share a node, so they can be merged at the same time
+	const Com::CIndexedArray& color = ea.GetColoring( field_velo.GetIdElemSeg(id_ea,CORNER,true,world) );
+	mat_uu.MakeMargeTmpBuffer();	// one merge buffer for each thread
+	for(unsigned int icolor=0;icolor<color.Size();icolor++){
+#if defined(_OPENMP)
+#pragma omp parallel for
+#endif
+	for(int iie=(int)color.index[icolor];iie<(int)color.index[icolor+1];iie++){
+		const unsigned int ielem = color.array[iie];
+		double eCmat_uu[nno][nno][ndim][ndim], eCmat_pp[nno][nno], eCmat_pu[nno][nno][ndim], eCmat_up[nno][nno][ndim];
+		double eMmat_uu[nno][nno][ndim][ndim];
+		double emat_uu[nno][nno][ndim][ndim],  emat_pp[nno][nno],  emat_pu[nno][nno][ndim],  emat_up[nno][nno][ndim];
+		double eqf_out_u[nno][ndim], eres_u[nno][ndim];
+		double eres_p[nno];
 		unsigned int noes[nno];	// vfߓ_̑S̐ߓ_ԍ			
 		es_c_co.GetNodes(ielem,noes);	// vf̐ߓ_ԍĂ
 		double coords[nno][ndim];	// vfߓ_̍W
@@ -1027,6 +1076,7 @@ static bool AddLinearSystem_Stokes2D_NonStatic_Newmark_P1P1_Combined(
 			res_u.AddValue( noes[ino],2,eres_p[ino]);
 		}
 	}
+	}
 	return true;
 }
 
@@ -1122,22 +1172,6 @@ static bool AddLinearSystem_Stokes3D_Static_P1P1(
 	const unsigned int nno = 4;
 	const unsigned int ndim = 3;
 
-	unsigned int noes[nno];	// vfߓ_̑S̐ߓ_ԍ
-
-	double velo[nno][ndim];	// vfߓ_̒l
-	double press[nno];
-	double coords[nno][ndim];	// vfߓ_̍W
-				
-	double dldx[nno][ndim];	// `֐xy
-	double const_term[nno];	// `֐̒萔
-
-	double emat_uu[nno][nno][ndim][ndim];
-	double emat_pp[nno][nno];
-	double emat_pu[nno][nno][ndim];
-	double emat_up[nno][nno][ndim];
-	double eqf_out_u[nno][ndim], eres_u[nno][ndim];
-	double eres_p[nno];
-
 	CMatDia_BlkCrs& mat_uu = ls.GetMatrix(id_field_velo, CORNER,  world);
 	CMatDia_BlkCrs& mat_pp = ls.GetMatrix(id_field_press,CORNER,  world);
 	CMat_BlkCrs& mat_up = ls.GetMatrix(id_field_velo,CORNER,    id_field_press,CORNER,  world);
@@ -1153,8 +1187,30 @@ static bool AddLinearSystem_Stokes3D_Static_P1P1(
 	assert( ns_velo.Length() == ndim );
 	assert( ns_press.Length() == 1 );
 
-	for(unsigned int ielem=0;ielem<ea.Size();ielem++)
-	{
+	// elements of one color do not share a node, so they can be merged at the same time
+	const Com::CIndexedArray& color = ea.GetColoring( field_velo.GetIdElemSeg(id_ea,CORNER,true,world) );
+	mat_uu.MakeMargeTmpBuffer();	// one merge buffer for each thread
+	mat_up.MakeMargeTmpBuffer();
+	mat_pu.MakeMargeTmpBuffer();
+	mat_pp.MakeMargeTmpBuffer();
+	for(unsigned int icolor=0;icolor<color.Size();icolor++){
+#if defined(_OPENMP)
+#pragma omp parallel for
+#endif
+	for(int iie=(int)color.index[icolor];iie<(int)color.index[icolor+1];iie++){
+		const unsigned int ielem = color.array[iie];
+		unsigned int noes[nno];	// vfߓ_̑S̐ߓ_ԍ
+		double velo[nno][ndim];	// vfߓ_̒l
+		double press[nno];
+		double coords[nno][ndim];	// vfߓ_̍W
+		double dldx[nno][ndim];	// `֐xy
+		double const_term[nno];	// `֐̒萔
+		double emat_uu[nno][nno][ndim][ndim];
+		double emat_pp[nno][nno];
+		double emat_pu[nno][nno][ndim];
+		double emat_up[nno][nno][ndim];
+		double eqf_out_u[nno][ndim], eres_u[nno][ndim];
+		double eres_p[nno];
 		// vf̐ߓ_ԍĂ
 		es_c_va.GetNodes(ielem,noes);
 		// ߓ_̍WAlĂ
@@ -1278,6 +1334,7 @@ static bool AddLinearSystem_Stokes3D_Static_P1P1(
 			res_p.AddValue( noes[ino],0,eres_p[ino]);
 		}
 	}
+	}
 	return true;
 }
 
@@ -1314,28 +1371,10 @@ static bool AddLinearSystem_Stokes3D_Static_Hex81(
 	unsigned int num_integral = 1;
 	const unsigned int nInt = NIntLineGauss[num_integral];
 	const double (*Gauss)[2] = LineGauss[num_integral];
-	double detjac, detwei;
 
 	const unsigned int nno = 8;
 	const unsigned int ndim = 3;
 
-	unsigned int noes[nno];	// vfߓ_̑S̐ߓ_ԍ
-	unsigned int noes_b;
-
-	double velo[nno][ndim];	// vfߓ_̒l
-	double press;
-	double coords[nno][ndim];	// vfߓ_̍W
-				
-	double dndx[nno][ndim];	// `֐xy
-	double an[nno];	// `֐̒萔
-
-	double emat_uu[nno][nno][ndim][ndim];
-	double emat_pp;
-	double emat_pu[nno][ndim];
-	double emat_up[nno][ndim];
-	double eqf_out_u[nno][ndim], eres_u[nno][ndim];
-	double eres_p;
-
 	CMatDia_BlkCrs& mat_uu = ls.GetMatrix(id_field_velo, CORNER,  world);
 	CMatDia_BlkCrs& mat_pp = ls.GetMatrix(id_field_press,BUBBLE,  world);
 	CMat_BlkCrs& mat_up = ls.GetMatrix(id_field_velo, CORNER,  id_field_press,BUBBLE,  world);
@@ -1351,8 +1390,32 @@ static bool AddLinearSystem_Stokes3D_Static_Hex81(
 	assert( ns_velo.Length()  == ndim );
 	assert( ns_press.Length() == 1 );
 
-	for(unsigned int ielem=0;ielem<ea.Size();ielem++)
-	{
+	// elements of one color do not share a node, so they can be merged at the same time
+	const Com::CIndexedArray& color = ea.GetColoring( field_velo.GetIdElemSeg(id_ea,CORNER,true,world) );
+	mat_uu.MakeMargeTmpBuffer();	// one merge buffer for each thread
+	mat_up.MakeMargeTmpBuffer();
+	mat_pu.MakeMargeTmpBuffer();
+	mat_pp.MakeMargeTmpBuffer();
+	for(unsigned int icolor=0;icolor<color.Size();icolor++){
+#if defined(_OPENMP)
+#pragma omp parallel for
+#endif
+	for(int iie=(int)color.index[icolor];iie<(int)color.index[icolor+1];iie++){
+		const unsigned int ielem = color.array[iie];
+		double detjac, detwei;
+		unsigned int noes[nno];	// vfߓ_̑S̐ߓ_ԍ
+		unsigned int noes_b;
+		double velo[nno][ndim];	// vfߓ_̒l
+		double press;
+		double coords[nno][ndim];	// vfߓ_̍W
+		double dndx[nno][ndim];	// `֐xy
+		double an[nno];	// `֐̒萔
+		double emat_uu[nno][nno][ndim][ndim];
+		double emat_pp;
+		double emat_pu[nno][ndim];
+		double emat_up[nno][ndim];
+		double eqf_out_u[nno][ndim], eres_u[nno][ndim];
+		double eres_p;
 		// vf̐ߓ_ԍĂ
 		es_c_v.GetNodes(ielem,noes);
 		es_b_p.GetNodes(ielem,&noes_b);
@@ -1463,6 +1526,7 @@ static bool AddLinearSystem_Stokes3D_Static_Hex81(
 		}
 		res_p.AddValue( noes_b,0,eres_p);
 	}
+	}
 	return true;
 }
 
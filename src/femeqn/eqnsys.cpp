@@ -29,6 +29,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 
 #include "delfem/femls/linearsystem_field.h"
 #include "delfem/ls/preconditioner.h"
+#include "delfem/ls/solver_ls_iter.h"
 
 using namespace Fem::Eqn;
 using namespace Fem::Field;
@@ -42,6 +43,7 @@ void CEqnSystem::Clear(){
 	this->m_aItrNormRes.clear();
 	if( pLS != 0 ){ delete pLS; pLS=0; }
 	if( pPrec != 0 ){ delete pPrec; pPrec=0; }
+	if( pRecycle != 0 ){ delete pRecycle; pRecycle=0; }
 	m_is_cleared_value_ls = true;
 	m_is_cleared_value_prec = true;
 }
@@ -49,9 +51,46 @@ void CEqnSystem::Clear(){
 void CEqnSystem::ClearLinearSystem()
 {
 	if( pLS   != 0 ){ delete pLS;   pLS=0;   }
+	if( pRecycle != 0 ){ pRecycle->Clear(); }	// the vectors of the recycling are in the linear system
 }
 
 void CEqnSystem::ClearPreconditioner()
 {
 	if( pPrec != 0 ){ delete pPrec; pPrec=0; }
 }
+
+
+void CEqnSystem::SetKrylovRecycle(bool is_recycle)
+{
+	if( is_recycle ){
+		if( pRecycle == 0 ){ pRecycle = new LsSol::CKrylovRecycle; }
+	}
+	else{
+		if( pRecycle != 0 ){ delete pRecycle; pRecycle=0; }
+	}
+}
+
+bool CEqnSystem::SolveLinearSystem_PCG(double& conv_ratio, unsigned int& iteration)
+{
+	assert( pLS != 0 && pPrec != 0 );
+	LsSol::CLinearSystemPreconditioner lsp((*pLS).m_ls,*pPrec);
+	if( pRecycle != 0 ){ return LsSol::Solve_PCG_Recycle(conv_ratio,iteration,lsp,*pRecycle); }
+	return LsSol::Solve_PCG(conv_ratio,iteration,lsp);
+}
+
+bool CEqnSystem::SolveLinearSystem_PBiCGSTAB(double& conv_ratio, unsigned int& iteration)
+{
+	assert( pLS != 0 && pPrec != 0 );
+	LsSol::CLinearSystemPreconditioner lsp((*pLS).m_ls,*pPrec);
+	if( pRecycle != 0 ){ return LsSol::Solve_PBiCGSTAB_Recycle(conv_ratio,iteration,lsp,*pRecycle); }
+	return LsSol::Solve_PBiCGSTAB(conv_ratio,iteration,lsp);
+}
+
+bool CEqnSystem::SolveLinearSystem_Asym(double& conv_ratio, unsigned int& iteration)
+{
+	if( m_nrestart_gmres == 0 ){ return this->SolveLinearSystem_PBiCGSTAB(conv_ratio,iteration); }
+	assert( pLS != 0 && pPrec != 0 );
+	LsSol::CLinearSystemPreconditioner lsp((*pLS).m_ls,*pPrec);
+	if( pRecycle != 0 ){ return LsSol::Solve_PGMRES_Recycle(conv_ratio,iteration,lsp,*pRecycle,m_nrestart_gmres); }
+	return LsSol::Solve_PGMRES(conv_ratio,iteration,lsp,m_nrestart_gmres);
+}
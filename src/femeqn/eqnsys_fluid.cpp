@@ -466,12 +466,10 @@ bool CEqnSystem_Fluid2D::Solve(Fem::Field::CFieldWorld& world)
 		this->EqnationProperty(is_asym);
 		if( is_asym ){
 			assert( !this->m_IsStationary );
-      LsSol::CLinearSystemPreconditioner lsp((*pLS).m_ls,*pPrec);
-			LsSol::Solve_PBiCGSTAB(conv_ratio,max_iter,lsp);
+			this->SolveLinearSystem_Asym(conv_ratio,max_iter);
 		}
 		else{
-      LsSol::CLinearSystemPreconditioner lsp((*pLS).m_ls,*pPrec);
-			LsSol::Solve_PCG(conv_ratio,max_iter,lsp);	// Solve with Preconditioned Conjugate Gradient
+			this->SolveLinearSystem_PCG(conv_ratio,max_iter);	// Solve with Preconditioned Conjugate Gradient
 		}
 		this->m_aItrNormRes.clear();
 		m_aItrNormRes.push_back( std::make_pair(max_iter,conv_ratio) );
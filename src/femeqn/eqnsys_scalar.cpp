@@ -321,8 +321,7 @@ bool CEqnSystem_Scalar2D::Solve(Fem::Field::CFieldWorld& world)
 		bool is_c, is_m, is_asym;
 		this->MatrixProperty(is_c,is_m,is_asym);
 		if( is_asym ){
-            LsSol::CLinearSystemPreconditioner lsp((*pLS).m_ls,*pPrec);
-			LsSol::Solve_PBiCGSTAB(conv_ratio,max_iter,lsp);	
+			this->SolveLinearSystem_Asym(conv_ratio,max_iter);
 		//	Fem::Sol::Solve_CG(conv_ratio,max_iter,ls);
 		}
 		else{
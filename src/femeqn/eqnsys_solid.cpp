@@ -56,7 +56,7 @@ using namespace MatVec;
 // ÇRÇcÇÃï˚íˆéÆ
 
 CEqn_Solid3D_Linear::CEqn_Solid3D_Linear(unsigned int id_field, Fem::Field::CFieldWorld& world) 
-: m_IsGeomNonlin(false), m_IsSaveStiffMat(false), m_IsStationary(false)
+: m_IsGeomNonlin(false), m_IsSaveStiffMat(false), m_IsStationary(false), m_IsAMG(false)
 {
 	m_lambda = 0.0;
 	m_myu = 0.0;
@@ -70,7 +70,7 @@ CEqn_Solid3D_Linear::CEqn_Solid3D_Linear(unsigned int id_field, Fem::Field::CFie
 }
 
 CEqn_Solid3D_Linear::CEqn_Solid3D_Linear()
-: m_IsGeomNonlin(false), m_IsSaveStiffMat(false), m_IsStationary(false)
+: m_IsGeomNonlin(false), m_IsSaveStiffMat(false), m_IsStationary(false), m_IsAMG(false)
 {
 	m_lambda = 0.0;
 	m_myu = 0.0;
@@ -167,7 +167,21 @@ bool CEqn_Solid3D_Linear::InitializeLinearSystem(const Fem::Field::CFieldWorld&
 		
 	// ëOèàóùÉNÉâÉXÇÃçÏê¨
 	assert( pPrec == 0 );
-    pPrec = new LsSol::CPreconditioner_ILU( (*pLS).m_ls, 1 );
+	if( m_IsAMG && (*pLS).m_ls.GetNLinSysSeg() == 1 ){
+		LsSol::CPreconditioner_AMG* pAMG = new LsSol::CPreconditioner_AMG( (*pLS).m_ls );
+		const CField& field = world.GetField(m_IdFieldDisp);
+		const CNodeAry::CNodeSeg& ns_c_co = field.GetNodeSeg(CORNER,false,world);
+		const unsigned int nblk = (*pLS).m_ls.GetMatrix(0).NBlkMatCol();
+		if( ns_c_co.Length() == 3 && ns_c_co.Size() == nblk ){	// coordinates of the blocks for the rigid body modes
+			std::vector<double> aCoord(nblk*3);
+			for(unsigned int iblk=0;iblk<nblk;iblk++){ ns_c_co.GetValue(iblk,&aCoord[iblk*3]); }
+			pAMG->SetCoord(3,aCoord);
+		}
+		pPrec = pAMG;
+	}
+	else{
+		pPrec = new LsSol::CPreconditioner_ILU( (*pLS).m_ls, 1 );
+	}
 
 	return true;
 }
@@ -192,8 +206,7 @@ bool CEqn_Solid3D_Linear::Solve(Fem::Field::CFieldWorld& world)
 				double conv_ratio = 1.0e-6;
 				unsigned int max_iter = 1000;
 				// Solve with Preconditioned Conjugate Gradient
-                LsSol::CLinearSystemPreconditioner lsp((*pLS).m_ls,*pPrec);
-				LsSol::Solve_PCG(conv_ratio,max_iter,lsp);
+				this->SolveLinearSystem_PCG(conv_ratio,max_iter);
 				// Solve with Conjugate Gradient
 			//	Fem::Sol::Solve_CG(conv_ratio,max_iter,ls);
 //				std::cout << max_iter << " " << conv_ratio << std::endl;
@@ -221,8 +234,7 @@ bool CEqn_Solid3D_Linear::Solve(Fem::Field::CFieldWorld& world)
 			double conv_ratio = 1.0e-6;
 			unsigned int max_iter = 1000;
 			// Solve with Preconditioned Conjugate Gradient
-            LsSol::CLinearSystemPreconditioner lsp( (*pLS).m_ls, *pPrec );
-			LsSol::Solve_PCG(conv_ratio,max_iter,lsp);	
+			this->SolveLinearSystem_PCG(conv_ratio,max_iter);	
 			// Solve with Conjugate Gradient
 		//	Fem::Sol::Solve_CG(conv_ratio,max_iter,ls);
 //			std::cout << max_iter << " " << conv_ratio << std::endl;
@@ -435,7 +447,7 @@ bool CEqn_Solid2D::AddLinSys_Save( Fem::Ls::CLinearSystem_Save& ls, const Fem::F
 ////////////////////////////////////////////////////////////////
 
 CEqnSystem_Solid2D::CEqnSystem_Solid2D(unsigned int id_field, Fem::Field::CFieldWorld& world) 
-: m_IsSaveStiffMat(false)
+: m_IsSaveStiffMat(false), m_IsStationary(true)
 {
 	m_rho_back = 1;
 	m_young_back = 1;
@@ -446,7 +458,7 @@ CEqnSystem_Solid2D::CEqnSystem_Solid2D(unsigned int id_field, Fem::Field::CField
 }
 
 CEqnSystem_Solid2D::CEqnSystem_Solid2D()
-: m_IsSaveStiffMat(false)
+: m_IsSaveStiffMat(false), m_IsStationary(true)
 {
 	m_rho_back = 1;
 	m_young_back = 1;
@@ -651,7 +663,9 @@ bool CEqnSystem_Solid2D::SetEquation( const CEqn_Solid2D& eqn )
 	for(unsigned int ieqn=0;ieqn<m_aEqn.size();ieqn++){
 		if( m_aEqn[ieqn].GetIdEA() == eqn.GetIdEA() ){
 			m_aEqn[ieqn] = eqn;
-			this->ClearLinearSystemPreconditioner();
+			// the pattern does not change, so the linear system and the fill pattern of the preconditioner are kept
+			this->m_is_cleared_value_ls   = true;
+			this->m_is_cleared_value_prec = true;
 			return true;
 		}
 	}
@@ -691,8 +705,7 @@ bool CEqnSystem_Solid2D::Solve(Fem::Field::CFieldWorld& world)
 			{	// çsóÒÇâÇ≠
 				double conv_ratio = 1.0e-6;
 				unsigned int max_iter = 1000;
-        LsSol::CLinearSystemPreconditioner lsp( (*pLS).m_ls, *pPrec );
-				LsSol::Solve_PCG(conv_ratio,max_iter,lsp);
+				this->SolveLinearSystem_PCG(conv_ratio,max_iter);
 				this->m_aItrNormRes.push_back( std::make_pair(max_iter,conv_ratio) );
 //				std::cout << max_iter << " " << conv_ratio << std::endl;
 			}
@@ -734,8 +747,7 @@ bool CEqnSystem_Solid2D::Solve(Fem::Field::CFieldWorld& world)
 		{	// çsóÒÇâÇ≠
 			double conv_ratio = 1.0e-6;
 			unsigned int max_iter = 1000;
-            LsSol::CLinearSystemPreconditioner lsp( (*pLS).m_ls, *pPrec );
-			LsSol::Solve_PCG(conv_ratio,max_iter,lsp);
+			this->SolveLinearSystem_PCG(conv_ratio,max_iter);
 //			Fem::Sol::Solve_CG(conv_ratio,max_iter,*pLS);
 //			std::cout << max_iter << " " << conv_ratio << std::endl;
 //			m_num_iter = max_iter;
@@ -981,17 +993,22 @@ void CEqnSystem_Solid2D::SetThermalStress( unsigned int id_field_temperature )
 
 void CEqnSystem_Solid2D::SetStationary( bool is_stat )
 {
+	// the class of the linear system depends on it only if the stiffness matrix is saved
+	if( m_IsSaveStiffMat && m_IsStationary != is_stat ){ this->ClearLinearSystem(); }
 	m_IsStationary = is_stat;
-	this->ClearLinearSystemPreconditioner();
+	this->m_is_cleared_value_ls   = true;
+	this->m_is_cleared_value_prec = true;
 }
 
 void CEqnSystem_Solid2D::SetSaveStiffMat( bool is_save )
 {
 	bool is_nonlin;
 	this->EqnationProperty(is_nonlin);
-	if( is_nonlin ){ this->m_IsSaveStiffMat = false; }
-	else{ this->m_IsSaveStiffMat = is_save; }
-	this->ClearLinearSystemPreconditioner();
+	if( is_nonlin ){ is_save = false; }
+	if( this->m_IsSaveStiffMat != is_save ){ this->ClearLinearSystem(); }	// the class of the linear system is changed
+	this->m_IsSaveStiffMat = is_save;
+	this->m_is_cleared_value_ls   = true;
+	this->m_is_cleared_value_prec = true;
 }
 
 
@@ -36,6 +36,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include <iostream>
 
 #include "delfem/elem_ary.h"
+#include "delfem/vertex_tuple_group.h"
 
 using namespace Fem::Field;
 
@@ -194,6 +195,7 @@ CElemAry::CElemAry(const CElemAry& ea){
     for(unsigned int i=0;i<n;i++){ m_pLnods[i] = ea.m_pLnods[i]; }
   }
   m_aSeg = ea.m_aSeg;
+  this->UpdateConnVersion();
 }
 
 
@@ -601,77 +603,115 @@ bool CElemAry::MakeEdge(
 
 bool CElemAry::MakeElemSurElem(const unsigned int& id_es_corner,int* elsuel) const
 {
-    Com::CIndexedArray elsup;
-	this->MakePointSurElem(id_es_corner,elsup);
-	this->MakeElemSurElem(id_es_corner,elsup,elsuel);
-	return true;
-}
-
-bool CElemAry::MakeElemSurElem( const unsigned int& id_es, 
-		const Com::CIndexedArray& elsup, int* elsuel ) const
-{
-	assert( m_aSeg.IsObjID(id_es) );
-	if( !m_aSeg.IsObjID(id_es) ){ return false; }
-	const CElemSeg& es = m_aSeg.GetObj(id_es);
+	assert( m_aSeg.IsObjID(id_es_corner) );
+	if( !m_aSeg.IsObjID(id_es_corner) ){ return false; }
+	const CElemSeg& es = m_aSeg.GetObj(id_es_corner);
 	const unsigned int inoel_s = es.begin;
 	const unsigned int inoel_e = inoel_s + es.m_nnoes;
-	const unsigned int max_noes = es.max_noes;
-	assert( max_noes < elsup.Size() );
+	const unsigned int npoin = es.max_noes+1;
 	assert( inoel_e <= npoel );
 
-	SElemInfo elem_info = ElemInfoAry[ this->ElemType() ];
+	const SElemInfo& elem_info = ElemInfoAry[ this->ElemType() ];
 	const unsigned int nfael = elem_info.nfael;
 	const unsigned int mxlpofa = elem_info.mxlpofa;
 	const unsigned int* nlpofa = elem_info.nlpofa;
 	const unsigned int* lpofa = elem_info.lpofa;
+	if( nfael == 0 ) return true;
+	for(unsigned int ifael=0;ifael<nfael;ifael++){
+		// faces of different number of nodes (e.g. prism) cannot be grouped as tuples of the same length
+		assert( nlpofa[ifael] == mxlpofa );
+		if( nlpofa[ifael] != mxlpofa ){ return false; }
+	}
 
-	const unsigned int npoin = elsup.Size();
-
-	unsigned int* tmp_poin = new unsigned int [npoin];
-	for(unsigned int ipoin=0;ipoin<npoin;ipoin++){ tmp_poin[ipoin] = 0; }
-	unsigned int inpofa[4];
-
+	// the faces which have the same nodes are grouped, and each face is paired with the first face of another element in its group
+	std::vector<unsigned int> aTuple(m_nElem*nfael*mxlpofa);
 	for(unsigned int ielem=0;ielem<m_nElem;ielem++){
 	for(unsigned int ifael=0;ifael<nfael;ifael++){
-		const unsigned int nilpofa = nlpofa[ifael];
-		for(unsigned int ipofa=0;ipofa<nilpofa;ipofa++){
-			inpofa[ipofa] = m_pLnods[ielem*npoel + lpofa[ifael*mxlpofa+ipofa] + inoel_s];
-			tmp_poin[ inpofa[ipofa] ] = 1;
+		for(unsigned int ipofa=0;ipofa<mxlpofa;ipofa++){
+			aTuple[(ielem*nfael+ifael)*mxlpofa+ipofa] = m_pLnods[ielem*npoel + lpofa[ifael*mxlpofa+ipofa] + inoel_s];
 		}
-		const unsigned int ipoin0= inpofa[0];
-		bool iflg = false;
-		for(unsigned int ielsup=elsup.index[ipoin0];ielsup<elsup.index[ipoin0+1];ielsup++){
-			const unsigned int jelem0 = elsup.array[ielsup];
-			if( jelem0 == ielem ) continue;
-			for(unsigned int jfael=0;jfael<nfael;jfael++){
-				iflg = true;
-				const unsigned int njlpofa = nlpofa[jfael];
-				for(unsigned int jpofa=0;jpofa<njlpofa;jpofa++){
-					const unsigned int jpoin0 = m_pLnods[jelem0*npoel + lpofa[jfael*mxlpofa+jpofa] + inoel_s];
-					assert( jpoin0 < npoin );
-					if( tmp_poin[ jpoin0 ] == 0 ){
-						iflg = false;
-						break;
-					}
-				}
-				if( iflg ){
-					elsuel[ielem*nfael+ifael] = jelem0;
-					break;
-				}
+	}
+	}
+	Com::CIndexedArray group;
+	Com::MakeVertexTupleGroup(group,aTuple,mxlpofa,npoin);
+
+	const unsigned int ngroup = group.Size();
+	for(unsigned int igroup=0;igroup<ngroup;igroup++){
+		const unsigned int igs = group.index[igroup];
+		const unsigned int ige = group.index[igroup+1];
+		for(unsigned int ig=igs;ig<ige;ig++){
+			const unsigned int iface = group.array[ig];
+			const unsigned int ielem = iface/nfael;
+			int jelem0 = -1;
+			for(unsigned int jg=igs;jg<ige;jg++){
+				const unsigned int jelem = group.array[jg]/nfael;
+				if( jelem != ielem ){ jelem0 = jelem; break; }
 			}
-			if( iflg ) break;
+			elsuel[iface] = jelem0;
 		}
-		if( !iflg ){ elsuel[ielem*nfael+ifael] = -1; }
-		for(unsigned int ipofa=0;ipofa<nilpofa;ipofa++){
-			tmp_poin[ inpofa[ipofa] ] = 0;
-		}
-	}	
 	}
+	return true;
+}
+
+bool CElemAry::MakeColoring(unsigned int id_es, Com::CIndexedArray& color) const
+{
+	Com::CIndexedArray elsup;
+	if( !this->MakePointSurElem(id_es,elsup) ) return false;
+	const CElemSeg& es = m_aSeg.GetObj(id_es);
+	const unsigned int inoel_s = es.begin;
+	const unsigned int inoel_e = inoel_s + es.m_nnoes;
 
-	delete[] tmp_poin;
+	// greedy coloring in the order of the element index (the result does not depend on the number of threads)
+	std::vector<int> aColorElem(m_nElem,-1);
+	std::vector<int> aFlgColor;	// aFlgColor[icolor]==ielem : icolor is used by a neighbor of ielem
+	for(unsigned int ielem=0;ielem<m_nElem;ielem++){
+		for(unsigned int inoel=inoel_s;inoel<inoel_e;inoel++){
+			const unsigned int ipoin0 = m_pLnods[ielem*npoel+inoel];
+			for(unsigned int ielsup=elsup.index[ipoin0];ielsup<elsup.index[ipoin0+1];ielsup++){
+				const unsigned int jelem0 = elsup.array[ielsup];
+				if( aColorElem[jelem0] == -1 ) continue;
+				aFlgColor[ aColorElem[jelem0] ] = ielem;
+			}
+		}
+		unsigned int icolor = 0;
+		for(;icolor<aFlgColor.size();icolor++){
+			if( aFlgColor[icolor] != (int)ielem ) break;
+		}
+		if( icolor == aFlgColor.size() ){ aFlgColor.push_back(-1); }
+		aColorElem[ielem] = icolor;
+	}
+	const unsigned int ncolor = aFlgColor.size();
+	color.InitializeSize(ncolor);
+	for(unsigned int ielem=0;ielem<m_nElem;ielem++){ color.index[ aColorElem[ielem]+1 ]++; }
+	for(unsigned int icolor=0;icolor<ncolor;icolor++){ color.index[icolor+1] += color.index[icolor]; }
+	color.array.resize(m_nElem);
+	for(unsigned int ielem=0;ielem<m_nElem;ielem++){
+		const unsigned int icolor = aColorElem[ielem];
+		color.array[ color.index[icolor] ] = ielem;
+		color.index[icolor]++;
+	}
+	for(unsigned int icolor=ncolor;icolor>0;icolor--){ color.index[icolor] = color.index[icolor-1]; }
+	color.index[0] = 0;
 	return true;
 }
 
+const Com::CIndexedArray& CElemAry::GetColoring(unsigned int id_es) const
+{
+	std::map< unsigned int, std::pair<unsigned int,Com::CIndexedArray> >::iterator itr = m_mapColor.find(id_es);
+	if( itr != m_mapColor.end() && itr->second.first == m_iver_conn ) return itr->second.second;
+	std::pair<unsigned int,Com::CIndexedArray>& color = m_mapColor[id_es];
+	color.first = m_iver_conn;
+	this->MakeColoring(id_es,color.second);
+	return color.second;
+}
+
+void CElemAry::UpdateConnVersion()
+{
+	static unsigned int iver_conn_counter = 0;	// shared by all the element arrays
+	iver_conn_counter++;
+	m_iver_conn = iver_conn_counter;
+}
+
 bool CElemAry::MakePointSurElem( const unsigned int id_es, Com::CIndexedArray& elsup ) const
 {
 	assert( m_aSeg.IsObjID(id_es) );
@@ -928,6 +968,7 @@ std::vector<int> CElemAry::AddSegment
 	}
 	delete[] m_pLnods;
 	m_pLnods = lnods_new;
+	this->UpdateConnVersion();
 
 	std::vector<int> add_es_id_ary;
 
@@ -1024,6 +1065,8 @@ int CElemAry::WriteToFile(const std::string& file_name, long& offset, unsigned i
 
 int CElemAry::InitializeFromFile(const std::string& file_name, long& offset)
 {
+	m_mapColor.clear();
+	this->UpdateConnVersion();
 
 	FILE *fp;
 	const unsigned int buff_size = 512;
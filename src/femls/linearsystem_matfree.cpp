@@ -0,0 +1,571 @@
+/*
+DelFEM (Finite Element Analysis)
+Copyright (C) 2009  Nobuyuki Umetani    n.umetani@gmail.com
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+////////////////////////////////////////////////////////////////
+// linearsystem_matfree.cpp : implementation of the matrix-free linear system (linearsystem_matfree.h)
+////////////////////////////////////////////////////////////////
+
+#if defined(__VISUALC__)
+#pragma warning( disable : 4786 )
+#endif
+
+#include <math.h>
+
+#include "delfem/field_world.h"
+#include "delfem/femls/linearsystem_matfree.h"
+
+#include "delfem/matvec/vector_blk.h"
+#include "delfem/matvec/bcflag_blk.h"
+#include "delfem/ls/eigen_lanczos.h"
+#include "delfem/ls/preconditioner.h"
+
+#include "delfem/femeqn/ker_emat_tri.h"
+#include "delfem/femeqn/ker_emat_tet.h"
+#include "delfem/femeqn/ker_emat_hex.h"
+
+using namespace MatVec;
+using namespace Fem::Ls;
+using namespace Fem::Field;
+
+////////////////////////////////////////////////////////////////
+// kernels for a batch of elements
+// the elements of a batch are in the innermost loop (stride 1) so that the loops are vectorized
+
+typedef void (*MULT_BATCH)(unsigned int ibatch,
+  const unsigned int* aNo, const double* aDNDX, const double* aDetWei, double c0, double c1,
+  double alpha, const double* x, double* y);
+
+// {y} += alpha*[K]{x}  [K] = c0 * integral grad(N)*grad(N)
+template<unsigned int NNO, unsigned int NDIM, unsigned int NINT>
+static void MultBatch_Diffusion(unsigned int ibatch,
+  const unsigned int* aNo, const double* aDNDX, const double* aDetWei, double c0, double /*c1*/,
+  double alpha, const double* x, double* y)
+{
+  const unsigned int NB = CLinearSystem_MatFree::NBATCH;
+  const unsigned int* no = aNo+ibatch*NNO*NB;
+  double ue[NNO][NB];
+  double fe[NNO][NB];
+  for(unsigned int ino=0;ino<NNO;ino++){
+    for(unsigned int ie=0;ie<NB;ie++){
+      ue[ino][ie] = x[ no[ino*NB+ie] ];
+      fe[ino][ie] = 0.0;
+    }
+  }
+  for(unsigned int iint=0;iint<NINT;iint++){
+    const double* dn  = aDNDX  +(ibatch*NINT+iint)*NNO*NDIM*NB;
+    const double* wei = aDetWei+(ibatch*NINT+iint)*NB;
+    double g[NDIM][NB];	// c0*weight*grad(u)
+    for(unsigned int idim=0;idim<NDIM;idim++){
+      for(unsigned int ie=0;ie<NB;ie++){ g[idim][ie] = 0.0; }
+    }
+    for(unsigned int ino=0;ino<NNO;ino++){
+    for(unsigned int idim=0;idim<NDIM;idim++){
+      for(unsigned int ie=0;ie<NB;ie++){ g[idim][ie] += dn[(ino*NDIM+idim)*NB+ie]*ue[ino][ie]; }
+    }
+    }
+    for(unsigned int idim=0;idim<NDIM;idim++){
+      for(unsigned int ie=0;ie<NB;ie++){ g[idim][ie] *= c0*wei[ie]; }
+    }
+    for(unsigned int ino=0;ino<NNO;ino++){
+    for(unsigned int idim=0;idim<NDIM;idim++){
+      for(unsigned int ie=0;ie<NB;ie++){ fe[ino][ie] += dn[(ino*NDIM+idim)*NB+ie]*g[idim][ie]; }
+    }
+    }
+  }
+  // the padding elements of a batch share the nodes with the first element, so the scatter is sequential in a batch
+  for(unsigned int ie=0;ie<NB;ie++){
+    for(unsigned int ino=0;ino<NNO;ino++){ y[ no[ino*NB+ie] ] += alpha*fe[ino][ie]; }
+  }
+}
+
+// {y} += alpha*[K]{x}  [K] : linear elasticity (c0:lambda, c1:myu), NDIM dofs for a node
+template<unsigned int NNO, unsigned int NDIM, unsigned int NINT>
+static void MultBatch_Elastic(unsigned int ibatch,
+  const unsigned int* aNo, const double* aDNDX, const double* aDetWei, double lambda, double myu,
+  double alpha, const double* x, double* y)
+{
+  const unsigned int NB = CLinearSystem_MatFree::NBATCH;
+  const unsigned int* no = aNo+ibatch*NNO*NB;
+  double ue[NNO][NDIM][NB];
+  double fe[NNO][NDIM][NB];
+  for(unsigned int ino=0;ino<NNO;ino++){
+    for(unsigned int idim=0;idim<NDIM;idim++){
+      for(unsigned int ie=0;ie<NB;ie++){
+        ue[ino][idim][ie] = x[ no[ino*NB+ie]*NDIM+idim ];
+        fe[ino][idim][ie] = 0.0;
+      }
+    }
+  }
+  for(unsigned int iint=0;iint<NINT;iint++){
+    const double* dn  = aDNDX  +(ibatch*NINT+iint)*NNO*NDIM*NB;
+    const double* wei = aDetWei+(ibatch*NINT+iint)*NB;
+    double g[NDIM][NDIM][NB];	// g[i][j] = du_i/dx_j
+    for(unsigned int idim=0;idim<NDIM;idim++){
+    for(unsigned int jdim=0;jdim<NDIM;jdim++){
+      for(unsigned int ie=0;ie<NB;ie++){ g[idim][jdim][ie] = 0.0; }
+    }
+    }
+    for(unsigned int ino=0;ino<NNO;ino++){
+    for(unsigned int idim=0;idim<NDIM;idim++){
+    for(unsigned int jdim=0;jdim<NDIM;jdim++){
+      for(unsigned int ie=0;ie<NB;ie++){ g[idim][jdim][ie] += ue[ino][idim][ie]*dn[(ino*NDIM+jdim)*NB+ie]; }
+    }
+    }
+    }
+    double s[NDIM][NDIM][NB];	// weight*stress
+    for(unsigned int ie=0;ie<NB;ie++){
+      double tr = 0.0;
+      for(unsigned int idim=0;idim<NDIM;idim++){ tr += g[idim][idim][ie]; }
+      for(unsigned int idim=0;idim<NDIM;idim++){
+      for(unsigned int jdim=0;jdim<NDIM;jdim++){
+        s[idim][jdim][ie] = wei[ie]*myu*(g[idim][jdim][ie]+g[jdim][idim][ie]);
+      }
+      s[idim][idim][ie] += wei[ie]*lambda*tr;
+      }
+    }
+    for(unsigned int ino=0;ino<NNO;ino++){
+    for(unsigned int idim=0;idim<NDIM;idim++){
+    for(unsigned int jdim=0;jdim<NDIM;jdim++){
+      for(unsigned int ie=0;ie<NB;ie++){ fe[ino][idim][ie] += dn[(ino*NDIM+jdim)*NB+ie]*s[idim][jdim][ie]; }
+    }
+    }
+    }
+  }
+  for(unsigned int ie=0;ie<NB;ie++){
+    for(unsigned int ino=0;ino<NNO;ino++){
+      const unsigned int ipos = no[ino*NB+ie]*NDIM;
+      for(unsigned int idim=0;idim<NDIM;idim++){ y[ipos+idim] += alpha*fe[ino][idim][ie]; }
+    }
+  }
+}
+
+static MULT_BATCH GetMultBatch(CLinearSystem_MatFree::ELEM_OP_TYPE type,
+  unsigned int nno, unsigned int ndim, unsigned int nint)
+{
+  if( type == CLinearSystem_MatFree::DIFFUSION ){
+    if( nno == 3 && ndim == 2 && nint == 1 ) return MultBatch_Diffusion<3,2,1>;
+    if( nno == 4 && ndim == 3 && nint == 1 ) return MultBatch_Diffusion<4,3,1>;
+    if( nno == 8 && ndim == 3 && nint == 8 ) return MultBatch_Diffusion<8,3,8>;
+  }
+  else if( type == CLinearSystem_MatFree::ELASTIC ){
+    if( nno == 3 && ndim == 2 && nint == 1 ) return MultBatch_Elastic<3,2,1>;
+    if( nno == 4 && ndim == 3 && nint == 1 ) return MultBatch_Elastic<4,3,1>;
+    if( nno == 8 && ndim == 3 && nint == 8 ) return MultBatch_Elastic<8,3,8>;
+  }
+  return 0;
+}
+
+////////////////////////////////////////////////////////////////
+
+void CLinearSystem_MatFree::Clear()
+{
+  CLinearSystem_Field::Clear();
+  m_aOp.clear();
+  for(unsigned int ilss=0;ilss<m_aTmp0.size();ilss++){ delete m_aTmp0[ilss]; }
+  for(unsigned int ilss=0;ilss<m_aTmp1.size();ilss++){ delete m_aTmp1[ilss]; }
+  m_aTmp0.clear();
+  m_aTmp1.clear();
+}
+
+bool CLinearSystem_MatFree::AddPattern_Field(const unsigned int id_field, const CFieldWorld& world)
+{
+  if( !world.IsIdField(id_field) ) return false;
+  const CField& field = world.GetField(id_field);
+  if( field.GetNodeSegInNodeAry(EDGE  ).id_na_va != 0 ) return false;
+  if( field.GetNodeSegInNodeAry(BUBBLE).id_na_va != 0 ) return false;
+  const int ils_c = this->AddLinSysSeg_Field(id_field,CORNER,world);
+  return ( ils_c >= 0 );
+}
+
+void CLinearSystem_MatFree::InitializeMarge()
+{
+  CLinearSystem_Field::InitializeMarge();
+  m_aOp.clear();
+}
+
+int CLinearSystem_MatFree::AddElemOp(ELEM_OP_TYPE type, double c0, double c1,
+  unsigned int id_field, unsigned int id_ea, const CFieldWorld& world)
+{
+  if( !world.IsIdField(id_field) ) return -1;
+  if( !world.IsIdEA(id_ea) ) return -1;
+  const CField& field = world.GetField(id_field);
+  const int ilss = this->FindIndexArray_Seg(id_field,CORNER,world);
+  if( ilss < 0 ) return -1;
+
+  unsigned int nno, ndim, nint;
+  const INTERPOLATION_TYPE itype = field.GetInterpolationType(id_ea,world);
+  if(      itype == TRI11 ){ nno = 3; ndim = 2; nint = 1; }
+  else if( itype == TET11 ){ nno = 4; ndim = 3; nint = 1; }
+  else if( itype == HEX11 ){ nno = 8; ndim = 3; nint = 8; }
+  else{ return -1; }
+  const unsigned int len = m_aSegField[ilss].len;
+  if( type == DIFFUSION && len != 1    ) return -1;
+  if( type == ELASTIC   && len != ndim ) return -1;
+  assert( GetMultBatch(type,nno,ndim,nint) != 0 );
+
+  const CElemAry& ea = world.GetEA(id_ea);
+  const CElemAry::CElemSeg& es_c_va = field.GetElemSeg(id_ea,CORNER,true, world);
+  const CElemAry::CElemSeg& es_c_co = field.GetElemSeg(id_ea,CORNER,false,world);
+  const CNodeAry::CNodeSeg& ns_c_co = field.GetNodeSeg(CORNER,false,world);
+  const Com::CIndexedArray& color = ea.GetColoring( field.GetIdElemSeg(id_ea,CORNER,true,world) );
+
+  const unsigned int NB = NBATCH;
+  m_aOp.resize( m_aOp.size()+1 );
+  CElemOp& op = m_aOp[ m_aOp.size()-1 ];
+  op.type = type;
+  op.c0 = c0;  op.c1 = c1;
+  op.ilss = ilss;
+  op.nno = nno;  op.ndim = ndim;  op.nint = nint;
+  op.nelem = ea.Size();
+  const unsigned int ncolor = color.Size();
+  op.aBatchColor.resize(ncolor+1);
+  op.aBatchColor[0] = 0;
+  for(unsigned int icolor=0;icolor<ncolor;icolor++){
+    const unsigned int nelem_c = color.index[icolor+1]-color.index[icolor];
+    op.aBatchColor[icolor+1] = op.aBatchColor[icolor] + (nelem_c+NB-1)/NB;
+  }
+  const unsigned int nbatch = op.aBatchColor[ncolor];
+  op.aNo.resize(    nbatch*nno*NB );
+  op.aDNDX.resize(  nbatch*nint*nno*ndim*NB, 0.0 );
+  op.aDetWei.resize(nbatch*nint*NB, 0.0 );
+  op.aN.resize(nint*nno);
+
+  unsigned int no_va[8], no_co[8];
+  double coord[8][3];
+  double dndx[8][8][3];	// [iint][ino][idim]
+  double detwei[8];
+  double an[8][8];	// [iint][ino]
+  for(unsigned int icolor=0;icolor<ncolor;icolor++){
+    const unsigned int ibatch0 = op.aBatchColor[icolor];
+    for(unsigned int iie=color.index[icolor];iie<color.index[icolor+1];iie++){
+      const unsigned int ielem = color.array[iie];
+      const unsigned int ibatch = ibatch0 + (iie-color.index[icolor])/NB;
+      const unsigned int ie = (iie-color.index[icolor])%NB;
+      es_c_va.GetNodes(ielem,no_va);
+      es_c_co.GetNodes(ielem,no_co);
+      for(unsigned int ino=0;ino<nno;ino++){ ns_c_co.GetValue(no_co[ino],coord[ino]); }
+      if( itype == TRI11 ){
+        double dldx[3][2], const_term[3];
+        TriDlDx(dldx,const_term,coord[0],coord[1],coord[2]);
+        detwei[0] = TriArea(coord[0],coord[1],coord[2]);
+        for(unsigned int ino=0;ino<3;ino++){
+          dndx[0][ino][0] = dldx[ino][0];
+          dndx[0][ino][1] = dldx[ino][1];
+          an[0][ino] = 1.0/3.0;
+        }
+      }
+      else if( itype == TET11 ){
+        double dldx[4][3], const_term[4];
+        TetDlDx(dldx,const_term,coord[0],coord[1],coord[2],coord[3]);
+        detwei[0] = TetVolume(coord[0],coord[1],coord[2],coord[3]);
+        for(unsigned int ino=0;ino<4;ino++){
+          for(unsigned int idim=0;idim<3;idim++){ dndx[0][ino][idim] = dldx[ino][idim]; }
+          an[0][ino] = 0.25;
+        }
+      }
+      else{
+        assert( itype == HEX11 );
+        const double (*Gauss)[2] = LineGauss[1];
+        assert( NIntLineGauss[1] == 2 );
+        unsigned int iint = 0;
+        for(unsigned int ir1=0;ir1<2;ir1++){
+        for(unsigned int ir2=0;ir2<2;ir2++){
+        for(unsigned int ir3=0;ir3<2;ir3++){
+          double detjac;
+          ShapeFunc_Hex8(Gauss[ir1][0],Gauss[ir2][0],Gauss[ir3][0],coord,detjac,dndx[iint],an[iint]);
+          detwei[iint] = detjac*Gauss[ir1][1]*Gauss[ir2][1]*Gauss[ir3][1];
+          iint++;
+        }
+        }
+        }
+      }
+      for(unsigned int ino=0;ino<nno;ino++){ op.aNo[(ibatch*nno+ino)*NB+ie] = no_va[ino]; }
+      for(unsigned int iint=0;iint<nint;iint++){
+        op.aDetWei[(ibatch*nint+iint)*NB+ie] = detwei[iint];
+        for(unsigned int ino=0;ino<nno;ino++){
+        for(unsigned int idim=0;idim<ndim;idim++){
+          op.aDNDX[(((ibatch*nint+iint)*nno+ino)*ndim+idim)*NB+ie] = dndx[iint][ino][idim];
+        }
+        }
+      }
+      // the shape functions at the integration points do not depend on the element
+      for(unsigned int iint=0;iint<nint;iint++){
+        for(unsigned int ino=0;ino<nno;ino++){ op.aN[iint*nno+ino] = an[iint][ino]; }
+      }
+    }
+    // padding elements (zero weight) have the nodes of the first element of the batch
+    const unsigned int nelem_c = color.index[icolor+1]-color.index[icolor];
+    if( nelem_c % NB != 0 ){
+      const unsigned int ibatch = op.aBatchColor[icolor+1]-1;
+      for(unsigned int ie=nelem_c%NB;ie<NB;ie++){
+        for(unsigned int ino=0;ino<nno;ino++){ op.aNo[(ibatch*nno+ino)*NB+ie] = op.aNo[(ibatch*nno+ino)*NB]; }
+      }
+    }
+  }
+  return m_aOp.size()-1;
+}
+
+bool CLinearSystem_MatFree::AddResidual_ElemOp(unsigned int iop, const double* load, const CFieldWorld& world)
+{
+  if( iop >= m_aOp.size() ) return false;
+  const CElemOp& op = m_aOp[iop];
+  const CLinSysSeg_Field& seg = m_aSegField[op.ilss];
+  if( !world.IsIdField(seg.id_field) ) return false;
+  const CField& field = world.GetField(seg.id_field);
+  CVector_Blk& res = m_ls.GetVector(-1,op.ilss);
+  const unsigned int len = seg.len;
+  assert( res.Len() == (int)len );
+  {	// {f}
+    const unsigned int NB = NBATCH;
+    const unsigned int nbatch = op.aBatchColor[ op.aBatchColor.size()-1 ];
+    for(unsigned int ibatch=0;ibatch<nbatch;ibatch++){
+      for(unsigned int ie=0;ie<NB;ie++){
+        for(unsigned int iint=0;iint<op.nint;iint++){
+          const double wei = op.aDetWei[(ibatch*op.nint+iint)*NB+ie];
+          for(unsigned int ino=0;ino<op.nno;ino++){
+            const unsigned int ino0 = op.aNo[(ibatch*op.nno+ino)*NB+ie];
+            for(unsigned int ilen=0;ilen<len;ilen++){
+              res.AddValue(ino0,ilen,wei*op.aN[iint*op.nno+ino]*load[ilen]);
+            }
+          }
+        }
+      }
+    }
+  }
+  {	// -[K]{u}
+    const CNodeAry::CNodeSeg& ns_c_val = field.GetNodeSeg(CORNER,true,world);
+    assert( ns_c_val.Size() == res.NBlk() );
+    assert( ns_c_val.Length() == len );
+    CVector_Blk u(res.NBlk(),len);
+    for(unsigned int inode=0;inode<ns_c_val.Size();inode++){
+      ns_c_val.GetValue(inode,u.GetValuePtr(inode));
+    }
+    MULT_BATCH mult = GetMultBatch(op.type,op.nno,op.ndim,op.nint);
+    assert( mult != 0 );
+    const double* px = u.GetValuePtr(0);
+    double* py = res.GetValuePtr(0);
+    const unsigned int nbatch = op.aBatchColor[ op.aBatchColor.size()-1 ];
+    for(unsigned int ibatch=0;ibatch<nbatch;ibatch++){
+      (*mult)(ibatch,&op.aNo[0],&op.aDNDX[0],&op.aDetWei[0],op.c0,op.c1,-1.0,px,py);
+    }
+  }
+  return true;
+}
+
+void CLinearSystem_MatFree::MultElemOp(unsigned int ilss, double alpha, const CVector_Blk& x, CVector_Blk& y) const
+{
+  if( x.NBlk() == 0 ) return;
+  assert( x.NBlk() == y.NBlk() && x.Len() == y.Len() );
+  const double* px = x.GetValuePtr(0);
+  double* py = y.GetValuePtr(0);
+  for(unsigned int iop=0;iop<m_aOp.size();iop++){
+    const CElemOp& op = m_aOp[iop];
+    if( op.ilss != ilss ) continue;
+    MULT_BATCH mult = GetMultBatch(op.type,op.nno,op.ndim,op.nint);
+    assert( mult != 0 );
+    const unsigned int* pno = &op.aNo[0];
+    const double* pdndx = &op.aDNDX[0];
+    const double* pwei  = &op.aDetWei[0];
+    for(unsigned int icolor=0;icolor<op.aBatchColor.size()-1;icolor++){
+      // batches of one color do not share a node
+#if defined(_OPENMP)
+#pragma omp parallel for
+#endif
+      for(int ibatch=(int)op.aBatchColor[icolor];ibatch<(int)op.aBatchColor[icolor+1];ibatch++){
+        (*mult)(ibatch,pno,pdndx,pwei,op.c0,op.c1,alpha,px,py);
+      }
+    }
+  }
+}
+
+bool CLinearSystem_MatFree::MatVec_Seg(unsigned int ilss, double alpha, const CVector_Blk& x, double beta, CVector_Blk& y)
+{
+  if( ilss >= m_ls.GetNLinSysSeg() ) return false;
+  if( m_aTmp0.size() != m_ls.GetNLinSysSeg() ){
+    for(unsigned int jlss=0;jlss<m_aTmp0.size();jlss++){ delete m_aTmp0[jlss]; delete m_aTmp1[jlss]; }
+    m_aTmp0.clear();  m_aTmp0.resize(m_ls.GetNLinSysSeg(),0);
+    m_aTmp1.clear();  m_aTmp1.resize(m_ls.GetNLinSysSeg(),0);
+  }
+  if( m_aTmp0[ilss] == 0 ){
+    m_aTmp0[ilss] = new CVector_Blk(x.NBlk(),x.Len());
+    m_aTmp1[ilss] = new CVector_Blk(x.NBlk(),x.Len());
+  }
+  CVector_Blk& x0 = *m_aTmp0[ilss];
+  CVector_Blk& y0 = *m_aTmp1[ilss];
+  const CBCFlag& bc_flag = m_ls.GetBCFlag(ilss);
+  // {y0} := [P][K][P]{x} + ([I]-[P]){x}  ([P] : zero at the fixed dofs)
+  x0 = x;
+  m_ls.GetBCFlag(ilss).SetZeroToBCDof(x0);
+  y0.SetVectorZero();
+  this->MultElemOp(ilss,1.0,x0,y0);
+  const unsigned int nblk = x.NBlk();
+  const unsigned int len = x.Len();
+  for(unsigned int iblk=0;iblk<nblk;iblk++){
+    for(unsigned int ilen=0;ilen<len;ilen++){
+      if( bc_flag.GetBCFlag(iblk,ilen) == 0 ) continue;
+      y0.SetValue(iblk,ilen,x.GetValue(iblk,ilen));
+    }
+  }
+  if( beta == 0.0 ){
+    y = y0;
+    y *= alpha;
+  }
+  else{ y.AXPBY(alpha,y0,beta); }
+  return true;
+}
+
+bool CLinearSystem_MatFree::GetDiagonal_Seg(unsigned int ilss, CVector_Blk& diag)
+{
+  if( ilss >= m_ls.GetNLinSysSeg() ) return false;
+  const CBCFlag& bc_flag = m_ls.GetBCFlag(ilss);
+  const unsigned int nblk = bc_flag.NBlk();
+  const unsigned int len = bc_flag.LenBlk();
+  diag.Initialize(nblk,len);
+  diag.SetVectorZero();
+  const unsigned int NB = NBATCH;
+  for(unsigned int iop=0;iop<m_aOp.size();iop++){
+    const CElemOp& op = m_aOp[iop];
+    if( op.ilss != ilss ) continue;
+    const unsigned int nbatch = op.aBatchColor[ op.aBatchColor.size()-1 ];
+    for(unsigned int ibatch=0;ibatch<nbatch;ibatch++){
+    for(unsigned int ie=0;ie<NB;ie++){
+      for(unsigned int iint=0;iint<op.nint;iint++){
+        const double wei = op.aDetWei[(ibatch*op.nint+iint)*NB+ie];
+        const double* dn = &op.aDNDX[ (ibatch*op.nint+iint)*op.nno*op.ndim*NB ];
+        for(unsigned int ino=0;ino<op.nno;ino++){
+          const unsigned int ino0 = op.aNo[(ibatch*op.nno+ino)*NB+ie];
+          double sqdn = 0.0;
+          for(unsigned int idim=0;idim<op.ndim;idim++){
+            const double d = dn[(ino*op.ndim+idim)*NB+ie];
+            sqdn += d*d;
+          }
+          if( op.type == DIFFUSION ){ diag.AddValue(ino0,0,wei*op.c0*sqdn); }
+          else{
+            for(unsigned int idim=0;idim<op.ndim;idim++){
+              const double d = dn[(ino*op.ndim+idim)*NB+ie];
+              diag.AddValue(ino0,idim,wei*( (op.c0+op.c1)*d*d + op.c1*sqdn ));
+            }
+          }
+        }
+      }
+    }
+    }
+  }
+  for(unsigned int iblk=0;iblk<nblk;iblk++){
+    for(unsigned int ilen=0;ilen<len;ilen++){
+      if( bc_flag.GetBCFlag(iblk,ilen) == 0 ) continue;
+      diag.SetValue(iblk,ilen,1.0);
+    }
+  }
+  return true;
+}
+
+bool CLinearSystem_MatFree::MATVEC(double alpha, int iv1, double beta, int iv2)
+{
+  const unsigned int nlss = m_ls.GetNLinSysSeg();
+  for(unsigned int ilss=0;ilss<nlss;ilss++){
+    if( !this->MatVec_Seg(ilss,alpha,m_ls.GetVector(iv1,ilss),beta,m_ls.GetVector(iv2,ilss)) ) return false;
+  }
+  return true;
+}
+
+////////////////////////////////////////////////////////////////
+
+void CPreconditioner_MatFreeChebyshev::Clear()
+{
+  for(unsigned int ilss=0;ilss<m_aInvDia.size();ilss++){
+    delete m_aInvDia[ilss];
+    delete m_aX[ilss];
+    delete m_aD[ilss];
+    delete m_aW[ilss];
+    delete m_aZ[ilss];
+  }
+  m_aInvDia.clear();
+  m_aX.clear();
+  m_aD.clear();
+  m_aW.clear();
+  m_aZ.clear();
+  m_max_eigen = 0.0;
+}
+
+// matrix-free operator and its point Jacobi for the Lanczos and the Chebyshev iterations of LsSol
+class COperator_MatFreeJacobi : public LsSol::ILinearOperator_Seg
+{
+public:
+  COperator_MatFreeJacobi(CLinearSystem_MatFree& ls, const std::vector<CVector_Blk*>& aInvDia)
+    : ls(ls), aInvDia(aInvDia){}
+  virtual bool MatVec_Seg(double alpha, const std::vector<CVector_Blk*>& x, double beta, std::vector<CVector_Blk*>& y){
+    for(unsigned int ilss=0;ilss<x.size();ilss++){
+      if( !ls.MatVec_Seg(ilss,alpha,*x[ilss],beta,*y[ilss]) ) return false;
+    }
+    return true;
+  }
+  virtual void MultInvDia_Seg(const std::vector<CVector_Blk*>& x, std::vector<CVector_Blk*>& y){
+    for(unsigned int ilss=0;ilss<x.size();ilss++){
+      const unsigned int ndof = x[ilss]->NBlk()*x[ilss]->Len();
+      if( ndof == 0 ) continue;
+      const double* pd = aInvDia[ilss]->GetValuePtr(0);
+      const double* px = x[ilss]->GetValuePtr(0);
+      double* py = y[ilss]->GetValuePtr(0);
+      for(unsigned int idof=0;idof<ndof;idof++){ py[idof] = pd[idof]*px[idof]; }
+    }
+  }
+private:
+  CLinearSystem_MatFree& ls;
+  const std::vector<CVector_Blk*>& aInvDia;
+};
+
+bool CPreconditioner_MatFreeChebyshev::SetValue(CLinearSystem_MatFree& ls)
+{
+  this->Clear();
+  const unsigned int nlss = ls.m_ls.GetNLinSysSeg();
+  for(unsigned int ilss=0;ilss<nlss;ilss++){
+    CVector_Blk* pDia = new CVector_Blk;
+    ls.GetDiagonal_Seg(ilss,*pDia);
+    const unsigned int nblk = pDia->NBlk();
+    const unsigned int len = pDia->Len();
+    for(unsigned int iblk=0;iblk<nblk;iblk++){
+      for(unsigned int ilen=0;ilen<len;ilen++){
+        const double d = pDia->GetValue(iblk,ilen);
+        pDia->SetValue(iblk,ilen, ( fabs(d) > 1.0e-30 ) ? 1.0/d : 1.0 );
+      }
+    }
+    m_aInvDia.push_back(pDia);
+    m_aX.push_back( new CVector_Blk(nblk,len) );
+    m_aD.push_back( new CVector_Blk(nblk,len) );
+    m_aW.push_back( new CVector_Blk(nblk,len) );
+    m_aZ.push_back( new CVector_Blk(nblk,len) );
+  }
+  // the Lanczos estimate is from below, so it is enlarged a little to cover the spectrum
+  COperator_MatFreeJacobi op(ls,m_aInvDia);
+  const std::vector<const CVector_Blk*> aVec(m_aX.begin(),m_aX.end());
+  m_max_eigen = 1.1*LsSol::MaximumEigenValue_Lanczos(op,aVec,m_nlanczos);
+  return ( m_max_eigen > 0.0 );
+}
+
+bool CPreconditioner_MatFreeChebyshev::SolvePrecond(CLinearSystem_MatFree& ls, int iv)
+{
+  const unsigned int nlss = m_aInvDia.size();
+  if( nlss != ls.m_ls.GetNLinSysSeg() || m_max_eigen <= 0.0 ) return false;
+  std::vector<CVector_Blk*> aR(nlss);
+  for(unsigned int ilss=0;ilss<nlss;ilss++){ aR[ilss] = &ls.m_ls.GetVector(iv,ilss); }
+  COperator_MatFreeJacobi op(ls,m_aInvDia);
+  LsSol::SolvePrecond_Chebyshev(op,m_ndeg,m_max_eigen,m_ratio,aR,m_aX,m_aD,m_aW,m_aZ);
+  return true;
+}
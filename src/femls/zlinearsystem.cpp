@@ -31,6 +31,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include "delfem/matvec/zmat_blkcrs.h"
 #include "delfem/matvec/zvector_blk.h"
 #include "delfem/matvec/diamat_blk.h"
+#include "delfem/matvec/ker_zblk.h"
 
 #include "delfem/femls/zlinearsystem.h"
 
@@ -42,7 +43,7 @@ using namespace MatVec;
 using namespace Fem::Ls;
 using namespace Fem::Field;
 
-CZLinearSystem::CZLinearSystem(){}
+CZLinearSystem::CZLinearSystem(){ m_is_real_crs = false; }
 
 CZLinearSystem::~CZLinearSystem(){
 	this->Clear();
@@ -316,6 +317,11 @@ double CZLinearSystem::FinalizeMarge()
 			}
 		}
 	}
+	if( m_is_real_crs ){
+		for(unsigned int iseg=0;iseg<nseg;iseg++){
+			if( m_Matrix_Dia[iseg] != 0 ){ m_Matrix_Dia[iseg]->MakeRealCrsValue(); }
+		}
+	}
 
 	// cւ̋ẼZbg
 	for(unsigned int iseg=0;iseg<nseg;iseg++){
@@ -1170,3 +1176,311 @@ bool CZLinearSystem_GeneralEigen::DecompMultMassMatrix()
 	return true;
 }
 
+
+////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////
+
+CZLinearSystem_Sweep::CZLinearSystem_Sweep(unsigned int nterm) : CZLinearSystem(), m_nterm(nterm)
+{
+	m_nfreq = 0;
+	m_ResidualBatch = 0;
+	m_UpdateBatch = 0;
+}
+
+CZLinearSystem_Sweep::~CZLinearSystem_Sweep(){
+	this->Clear();
+}
+
+void CZLinearSystem_Sweep::Clear(){
+	CZLinearSystem::Clear();
+	for(unsigned int iterm=0;iterm<m_TermMatrix.size();iterm++){
+		delete m_TermMatrix[iterm];
+	}
+	m_TermMatrix.clear();
+	for(unsigned int iterm=0;iterm<m_TermResidual.size();iterm++){
+		delete m_TermResidual[iterm];
+	}
+	m_TermResidual.clear();
+	////////////////
+	m_nfreq = 0;
+	m_aCoeffTerm.clear();
+	if( m_ResidualBatch != 0 ){ delete m_ResidualBatch; m_ResidualBatch = 0; }
+	if( m_UpdateBatch   != 0 ){ delete m_UpdateBatch;   m_UpdateBatch   = 0; }
+	for(unsigned int ivec=0;ivec<m_TmpVecBatch.size();ivec++){
+		delete m_TmpVecBatch[ivec];
+	}
+	m_TmpVecBatch.clear();
+}
+
+bool CZLinearSystem_Sweep::AddPattern_Field(const unsigned int id_field, const Fem::Field::CFieldWorld& world){
+	if( !CZLinearSystem::AddPattern_Field(id_field,world) ) return false;
+	if( this->GetNLynSysSeg() != 1 ){
+		std::cout << "Error!-->Not Implimented" << std::endl;
+		assert(0);
+		return false;
+	}
+	assert( m_Matrix_Dia[0] != 0 );
+	// the term matrices copy the pattern of the matrix
+	for(unsigned int iterm=0;iterm<m_TermMatrix.size();iterm++){
+		delete m_TermMatrix[iterm];
+	}
+	m_TermMatrix.resize(m_nterm);
+	for(unsigned int iterm=0;iterm<m_nterm;iterm++){
+		m_TermMatrix[iterm] = new CZMatDia_BlkCrs(*m_Matrix_Dia[0],false,true,true);
+	}
+	for(unsigned int iterm=0;iterm<m_TermResidual.size();iterm++){
+		delete m_TermResidual[iterm];
+	}
+	m_TermResidual.resize(m_nterm);
+	for(unsigned int iterm=0;iterm<m_nterm;iterm++){
+		m_TermResidual[iterm] = new CZVector_Blk(m_aSeg[0].nnode,m_aSeg[0].len);
+		m_TermResidual[iterm]->SetVectorZero();
+	}
+	return true;
+}
+
+void CZLinearSystem_Sweep::InitializeMarge(){
+	CZLinearSystem::InitializeMarge();
+	for(unsigned int iterm=0;iterm<m_TermMatrix.size();iterm++){
+		m_TermMatrix[iterm]->SetZero();
+	}
+	for(unsigned int iterm=0;iterm<m_TermResidual.size();iterm++){
+		m_TermResidual[iterm]->SetVectorZero();
+	}
+}
+
+double CZLinearSystem_Sweep::FinalizeMarge(){
+	const double norm_res = CZLinearSystem::FinalizeMarge();
+	for(unsigned int iterm=0;iterm<m_TermMatrix.size();iterm++){
+		m_TermMatrix[iterm]->SetBoundaryCondition(*m_BCFlag[0]);
+		if( m_is_real_crs ){ m_TermMatrix[iterm]->MakeRealCrsValue(); }
+	}
+	for(unsigned int iterm=0;iterm<m_TermResidual.size();iterm++){
+		m_BCFlag[0]->SetZeroToBCDof(*m_TermResidual[iterm]);
+	}
+	return norm_res;
+}
+
+CZMatDia_BlkCrs* CZLinearSystem_Sweep::GetTermMatrixPtr(unsigned int iterm, 
+	unsigned int id_field, const Fem::Field::ELSEG_TYPE& elseg_type, const Fem::Field::CFieldWorld& world)
+{
+	if( iterm >= m_TermMatrix.size() ) return 0;
+	int ilss = this->FindIndexArray_Seg(id_field,elseg_type,world);
+	if( ilss != 0 ) return 0;
+	return m_TermMatrix[iterm];
+}
+
+CZVector_Blk* CZLinearSystem_Sweep::GetTermResidualPtr(unsigned int iterm, 
+	unsigned int id_field, const Fem::Field::ELSEG_TYPE& elseg_type, const Fem::Field::CFieldWorld& world)
+{
+	if( iterm >= m_TermResidual.size() ) return 0;
+	int ilss = this->FindIndexArray_Seg(id_field,elseg_type,world);
+	if( ilss != 0 ) return 0;
+	return m_TermResidual[iterm];
+}
+
+bool CZLinearSystem_Sweep::SetMatrix_Combination(const Com::Complex* coeff)
+{
+	if( this->GetNLynSysSeg() != 1 || m_TermMatrix.size() != m_nterm ) return false;
+	if( !m_Matrix_Dia[0]->SetValue_Combination(m_nterm,&m_TermMatrix[0],coeff) ) return false;
+	m_Matrix_Dia[0]->SetBoundaryCondition(*m_BCFlag[0]);
+	if( m_is_real_crs ){ m_Matrix_Dia[0]->MakeRealCrsValue(); }
+	return true;
+}
+
+bool CZLinearSystem_Sweep::SetBatch(unsigned int nfreq, const Com::Complex* coeff)
+{
+	if( this->GetNLynSysSeg() != 1 || m_TermResidual.size() != m_nterm ) return false;
+	const unsigned int nnode = m_aSeg[0].nnode;
+	const unsigned int len = m_aSeg[0].len;
+	if( nfreq != m_nfreq ){	// make the vectors of the batch
+		if( m_ResidualBatch != 0 ){ delete m_ResidualBatch; m_ResidualBatch = 0; }
+		if( m_UpdateBatch   != 0 ){ delete m_UpdateBatch;   m_UpdateBatch   = 0; }
+		for(unsigned int ivec=0;ivec<m_TmpVecBatch.size();ivec++){
+			delete m_TmpVecBatch[ivec];
+			m_TmpVecBatch[ivec] = 0;
+		}
+		m_nfreq = nfreq;
+		if( nfreq == 0 ){
+			m_TmpVecBatch.clear();
+			m_aCoeffTerm.clear();
+			return true;
+		}
+		m_ResidualBatch = new CZVector_Blk(nnode,len*nfreq);
+		m_UpdateBatch   = new CZVector_Blk(nnode,len*nfreq);
+		for(unsigned int ivec=0;ivec<m_TmpVecBatch.size();ivec++){
+			m_TmpVecBatch[ivec] = new CZVector_Blk(nnode,len*nfreq);
+			m_TmpVecBatch[ivec]->SetVectorZero();
+		}
+	}
+	if( nfreq == 0 ) return true;
+	m_aCoeffTerm.resize(m_nterm*nfreq);
+	for(unsigned int ifreq=0;ifreq<nfreq;ifreq++){
+		for(unsigned int iterm=0;iterm<m_nterm;iterm++){
+			m_aCoeffTerm[iterm*nfreq+ifreq] = coeff[ifreq*m_nterm+iterm];
+		}
+	}
+	// {f} + sum_t c_t(w)(-[A_t]{u}) for each frequency (the fixed dofs are zero in all the vectors)
+	for(unsigned int iblk=0;iblk<nnode;iblk++){
+		const Com::Complex* res = m_Residual[0]->GetValuePtr(iblk);
+		Com::Complex* res_b = m_ResidualBatch->GetValuePtr(iblk);
+		for(unsigned int idof=0;idof<len;idof++){
+			for(unsigned int ifreq=0;ifreq<nfreq;ifreq++){ res_b[idof*nfreq+ifreq] = res[idof]; }
+		}
+		for(unsigned int iterm=0;iterm<m_nterm;iterm++){
+			const Com::Complex* res_t = m_TermResidual[iterm]->GetValuePtr(iblk);
+			for(unsigned int idof=0;idof<len;idof++){
+				for(unsigned int ifreq=0;ifreq<nfreq;ifreq++){
+					res_b[idof*nfreq+ifreq] += m_aCoeffTerm[iterm*nfreq+ifreq]*res_t[idof];
+				}
+			}
+		}
+	}
+	m_UpdateBatch->SetVectorZero();
+	return true;
+}
+
+bool CZLinearSystem_Sweep::ReSizeTmpVecBatch(unsigned int ntmp_new)
+{
+	const unsigned int ntmp_old = m_TmpVecBatch.size();
+	if( ntmp_old == ntmp_new ){ return true; }
+	if( ntmp_old < ntmp_new ){
+		m_TmpVecBatch.resize(ntmp_new,0);
+		if( m_nfreq == 0 ) return true;
+		const unsigned int nnode = m_aSeg[0].nnode;
+		const unsigned int len = m_aSeg[0].len;
+		for(unsigned int ivec=ntmp_old;ivec<ntmp_new;ivec++){
+			m_TmpVecBatch[ivec] = new CZVector_Blk(nnode,len*m_nfreq);
+			m_TmpVecBatch[ivec]->SetVectorZero();
+		}
+	}
+	else{
+		for(unsigned int ivec=ntmp_new;ivec<ntmp_old;ivec++){
+			delete m_TmpVecBatch[ivec];
+		}
+		m_TmpVecBatch.resize(ntmp_new);
+	}
+	return true;
+}
+
+CZVector_Blk& CZLinearSystem_Sweep::GetBatchVector(int iv){
+	assert( m_nfreq > 0 );
+	if( iv == -1 ){ return *m_ResidualBatch; }
+	if( iv == -2 ){ return *m_UpdateBatch; }
+	assert( iv >= 0 && iv < (int)m_TmpVecBatch.size() );
+	return *m_TmpVecBatch[iv];
+}
+
+bool CZLinearSystem_Sweep::CopyBatchColumn(int iv_batch, unsigned int ifreq, int iv)
+{
+	if( ifreq >= m_nfreq ) return false;
+	const CZVector_Blk& vb = this->GetBatchVector(iv_batch);
+	CZVector_Blk& v = this->GetVector(iv,0);
+	const unsigned int nblk = v.BlkVecLen();
+	const unsigned int len = v.BlkLen();
+	for(unsigned int iblk=0;iblk<nblk;iblk++){
+		const Com::Complex* vbi = vb.GetValuePtr(iblk);
+		Com::Complex* vi = v.GetValuePtr(iblk);
+		for(unsigned int idof=0;idof<len;idof++){ vi[idof] = vbi[idof*m_nfreq+ifreq]; }
+	}
+	return true;
+}
+
+// column-wise dot product of the batch vectors (conjugate the first if IS_CONJ)
+template<bool IS_CONJ>
+static void DotBatch(const CZVector_Blk& v1, const CZVector_Blk& v2, 
+					 const unsigned int nfreq, Com::Complex* adot)
+{
+	const unsigned int ndof = v1.BlkVecLen()*v1.BlkLen()/nfreq;
+	std::vector<double> d(nfreq*2,0.0);
+	if( ndof > 0 ){
+		const double* x = Ker::ZPtr(v1.GetValuePtr(0));
+		const double* y = Ker::ZPtr(v2.GetValuePtr(0));
+		for(unsigned int idof=0;idof<ndof;idof++){
+			const double* xi = x+idof*nfreq*2;
+			const double* yi = y+idof*nfreq*2;
+			for(unsigned int ifreq=0;ifreq<nfreq;ifreq++){
+				const unsigned int i = ifreq*2;
+				if( IS_CONJ ){
+					d[i  ] += xi[i]*yi[i]   + xi[i+1]*yi[i+1];
+					d[i+1] += xi[i]*yi[i+1] - xi[i+1]*yi[i];
+				}
+				else{
+					d[i  ] += xi[i]*yi[i]   - xi[i+1]*yi[i+1];
+					d[i+1] += xi[i]*yi[i+1] + xi[i+1]*yi[i];
+				}
+			}
+		}
+	}
+	for(unsigned int ifreq=0;ifreq<nfreq;ifreq++){ adot[ifreq] = Com::Complex(d[ifreq*2],d[ifreq*2+1]); }
+}
+
+bool CZLinearSystem_Sweep::DOT_Batch(int iv1, int iv2, Com::Complex* adot){
+	if( m_nfreq == 0 ) return true;
+	DotBatch<false>(this->GetBatchVector(iv1),this->GetBatchVector(iv2),m_nfreq,adot);
+	return true;
+}
+
+bool CZLinearSystem_Sweep::INPROCT_Batch(int iv1, int iv2, Com::Complex* adot){
+	if( m_nfreq == 0 ) return true;
+	DotBatch<true>(this->GetBatchVector(iv1),this->GetBatchVector(iv2),m_nfreq,adot);
+	return true;
+}
+
+bool CZLinearSystem_Sweep::COPY_Batch(int iv1, int iv2){
+	if( m_nfreq == 0 || iv1 == iv2 ) return true;
+	this->GetBatchVector(iv2) = this->GetBatchVector(iv1);
+	return true;
+}
+
+bool CZLinearSystem_Sweep::SCAL_Batch(const Com::Complex* alpha, int iv1){
+	if( m_nfreq == 0 ) return true;
+	CZVector_Blk& v1 = this->GetBatchVector(iv1);
+	const unsigned int ndof = v1.BlkVecLen()*m_aSeg[0].len;
+	for(unsigned int idof=0;idof<ndof;idof++){
+		Com::Complex* x = v1.GetValuePtr(0)+idof*m_nfreq;
+		for(unsigned int ifreq=0;ifreq<m_nfreq;ifreq++){ x[ifreq] = alpha[ifreq]*x[ifreq]; }
+	}
+	return true;
+}
+
+bool CZLinearSystem_Sweep::AXPY_Batch(const Com::Complex* alpha, int iv1, int iv2){
+	if( m_nfreq == 0 ) return true;
+	const CZVector_Blk& v1 = this->GetBatchVector(iv1);
+	CZVector_Blk& v2 = this->GetBatchVector(iv2);
+	const unsigned int ndof = v1.BlkVecLen()*m_aSeg[0].len;
+	for(unsigned int idof=0;idof<ndof;idof++){
+		const Com::Complex* x = v1.GetValuePtr(0)+idof*m_nfreq;
+		Com::Complex* y = v2.GetValuePtr(0)+idof*m_nfreq;
+		for(unsigned int ifreq=0;ifreq<m_nfreq;ifreq++){ y[ifreq] += alpha[ifreq]*x[ifreq]; }
+	}
+	return true;
+}
+
+bool CZLinearSystem_Sweep::MatVec_Batch(double alpha, int iv1, double beta, int iv2)
+{
+	if( m_nfreq == 0 ) return true;
+	assert( iv1 != iv2 );
+	assert( m_TermMatrix.size() == m_nterm );
+	const CZVector_Blk& x = this->GetBatchVector(iv1);
+	CZVector_Blk& y = this->GetBatchVector(iv2);
+	std::vector<Com::Complex> acoeff(m_nfreq);
+	for(unsigned int iterm=0;iterm<m_nterm;iterm++){
+		for(unsigned int ifreq=0;ifreq<m_nfreq;ifreq++){
+			acoeff[ifreq] = alpha*m_aCoeffTerm[iterm*m_nfreq+ifreq];
+		}
+		m_TermMatrix[iterm]->MatVec_Multi(m_nfreq,&acoeff[0],x,(iterm==0)?beta:1.0,y);
+	}
+	// the fixed dofs stay zero (the sum of the term matrices has not 1 at their diagonal)
+	const unsigned int nblk = y.BlkVecLen();
+	const unsigned int len = m_aSeg[0].len;
+	for(unsigned int iblk=0;iblk<nblk;iblk++){
+		for(unsigned int idof=0;idof<len;idof++){
+			if( m_BCFlag[0]->GetBCFlag(iblk,idof) == 0 ) continue;
+			for(unsigned int ifreq=0;ifreq<m_nfreq;ifreq++){
+				y.SetValue(iblk,idof*m_nfreq+ifreq,0.0);
+			}
+		}
+	}
+	return true;
+}
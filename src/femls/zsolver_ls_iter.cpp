@@ -266,6 +266,107 @@ bool Fem::Ls::Solve_PCOCG(double& conv_ratio, unsigned int& iteration,
 	return true;
 }
 
+bool Fem::Ls::Solve_PCOCG_Batch(double& conv_ratio, unsigned int& iteration,
+				CZLinearSystem_Sweep& ls, CZPreconditioner_ILU& precond )
+{
+	const double conv_ratio_tol = conv_ratio;
+	const unsigned int mx_iter = iteration;
+	const unsigned int nfreq = ls.NBatch();
+
+	if( ls.GetTmpVecBatchSize() < 3 ){ ls.ReSizeTmpVecBatch(3); }
+
+	const int ix = -2;
+	const int ir = -1;
+	const int ip = 0;
+	const int iAp = 1;
+	const int iw = 2;
+
+	std::vector<Com::Complex> aZero(nfreq,0.0), aOne(nfreq,1.0);
+	ls.SCAL_Batch(&aZero[0],ix);
+
+	std::vector<Com::Complex> aDot(nfreq);
+	std::vector<double> aSqInvNormResIni(nfreq);
+	std::vector<bool> aIsConv(nfreq,false);
+	unsigned int nconv = 0;
+	conv_ratio = 0.0;
+	{
+		ls.INPROCT_Batch(ir,ir,&aDot[0]);
+		for(unsigned int ifreq=0;ifreq<nfreq;ifreq++){
+			const double sq_norm_res0 = aDot[ifreq].Real();
+			if( sq_norm_res0 < 1.0e-30 ){ aIsConv[ifreq] = true; nconv++; aSqInvNormResIni[ifreq] = 0.0; }
+			else{ aSqInvNormResIni[ifreq] = 1.0 / sq_norm_res0; }
+		}
+		if( nconv == nfreq ){
+			iteration = 0;
+			return true;
+		}
+	}
+
+	ls.COPY_Batch(ir,iw);
+	precond.SolvePrecond_Batch(ls,iw);
+	ls.COPY_Batch(iw,ip);
+
+	std::vector<Com::Complex> aRW(nfreq);
+	ls.DOT_Batch(ir,iw,&aRW[0]);
+
+	std::vector<Com::Complex> aAlpha(nfreq), aBeta(nfreq);
+	iteration = mx_iter;
+	for(unsigned int iitr=1;iitr<mx_iter;iitr++)
+	{
+		ls.MatVec_Batch(1,ip,0,iAp);
+		ls.DOT_Batch(ip,iAp,&aDot[0]);
+		for(unsigned int ifreq=0;ifreq<nfreq;ifreq++){	// the converged columns do not move
+			aAlpha[ifreq] = ( aIsConv[ifreq] ) ? Com::Complex(0.0) : aRW[ifreq] / aDot[ifreq];
+		}
+
+		// {u} = {u} + alpha * {p}
+		ls.AXPY_Batch(&aAlpha[0],ip,ix);
+
+		// {r} = {r} - alpha * [A]{p}
+		for(unsigned int ifreq=0;ifreq<nfreq;ifreq++){ aAlpha[ifreq] = -aAlpha[ifreq]; }
+		ls.AXPY_Batch(&aAlpha[0],iAp,ir);
+
+		{	// Converge Judgement
+			ls.INPROCT_Batch(ir,ir,&aDot[0]);
+			for(unsigned int ifreq=0;ifreq<nfreq;ifreq++){
+				if( aIsConv[ifreq] ) continue;
+				const double ratio = sqrt(aDot[ifreq].Real()*aSqInvNormResIni[ifreq]);
+				if( ratio < conv_ratio_tol ){
+					aIsConv[ifreq] = true;
+					nconv++;
+					conv_ratio = ( ratio > conv_ratio ) ? ratio : conv_ratio;
+				}
+			}
+			if( nconv == nfreq ){
+				iteration = iitr;
+				return true;
+			}
+		}
+
+		ls.COPY_Batch(ir,iw);
+		precond.SolvePrecond_Batch(ls,iw);
+
+		// Calc Beta
+		ls.DOT_Batch(ir,iw,&aDot[0]);
+		for(unsigned int ifreq=0;ifreq<nfreq;ifreq++){
+			aBeta[ifreq] = ( aIsConv[ifreq] ) ? Com::Complex(0.0) : aDot[ifreq] / aRW[ifreq];
+			aRW[ifreq] = aDot[ifreq];
+		}
+
+		// {p} = {r} + beta*{p}
+		ls.SCAL_Batch(&aBeta[0],ip);
+		ls.AXPY_Batch(&aOne[0],iw,ip);
+	}
+	{	// the largest ratio of the columns not converged
+		ls.INPROCT_Batch(ir,ir,&aDot[0]);
+		for(unsigned int ifreq=0;ifreq<nfreq;ifreq++){
+			const double ratio = sqrt(aDot[ifreq].Real()*aSqInvNormResIni[ifreq]);
+			conv_ratio = ( ratio > conv_ratio ) ? ratio : conv_ratio;
+		}
+	}
+	return false;
+}
+
 
 ////////////////////////////////////////////////////////////////
 // Solve Matrix with COCG Methods
@@ -23,8 +23,14 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #define for if(0); else for
 
 #include <iostream>
+#include <cassert>
 #include <math.h>
+#include <vector>
+#include <algorithm>
 
+#include "delfem/matvec/vector_blk.h"
+#include "delfem/matvec/bcflag_blk.h"
+#include "delfem/matvec/matdiainv_blkdia.h"
 #include "delfem/ls/eigen_lanczos.h"
 #include "delfem/ls/preconditioner.h"
 #include "delfem/ls/linearsystem.h"
@@ -382,3 +388,459 @@ double LsSol::MinimumEigenValueVector_InvPower(
 	return  1.0 / min_eigen;
 }
 
+
+////////////////////////////////////////////////////////////////
+// block LOBPCG
+
+// eigen pairs of the small dense symmetric matrix a (n*n) with the cyclic Jacobi method
+// v[i*n+j] is the i-th component of the j-th eigen vector, lam is not sorted
+void LsSol::EigenSymmetric_Jacobi(unsigned int n, std::vector<double>& a, std::vector<double>& v, std::vector<double>& lam)
+{
+	v.assign(n*n,0.0);
+	for(unsigned int i=0;i<n;i++){ v[i*n+i] = 1.0; }
+	for(unsigned int isweep=0;isweep<100;isweep++){
+		double sq_dia = 0.0, sq_off = 0.0;
+		for(unsigned int i=0;i<n;i++){
+			sq_dia += a[i*n+i]*a[i*n+i];
+			for(unsigned int j=i+1;j<n;j++){ sq_off += a[i*n+j]*a[i*n+j]; }
+		}
+		if( sq_off <= 1.0e-30*sq_dia || sq_off < 1.0e-300 ) break;
+		for(unsigned int p=0;p<n;p++){
+		for(unsigned int q=p+1;q<n;q++){
+			const double apq = a[p*n+q];
+			if( fabs(apq) < 1.0e-300 ) continue;
+			const double theta = (a[q*n+q]-a[p*n+p])/(2.0*apq);
+			const double t = ( (theta>=0) ? 1.0 : -1.0 ) / ( fabs(theta)+sqrt(theta*theta+1.0) );
+			const double c = 1.0/sqrt(t*t+1.0);
+			const double s = t*c;
+			for(unsigned int k=0;k<n;k++){
+				const double akp = a[k*n+p], akq = a[k*n+q];
+				a[k*n+p] = c*akp-s*akq;
+				a[k*n+q] = s*akp+c*akq;
+			}
+			for(unsigned int k=0;k<n;k++){
+				const double apk = a[p*n+k], aqk = a[q*n+k];
+				a[p*n+k] = c*apk-s*aqk;
+				a[q*n+k] = s*apk+c*aqk;
+			}
+			for(unsigned int k=0;k<n;k++){
+				const double vkp = v[k*n+p], vkq = v[k*n+q];
+				v[k*n+p] = c*vkp-s*vkq;
+				v[k*n+q] = s*vkp+c*vkq;
+			}
+		}
+		}
+	}
+	lam.resize(n);
+	for(unsigned int i=0;i<n;i++){ lam[i] = a[i*n+i]; }
+}
+
+// set zero to the fixed dofs of the vector iv
+static void SetZeroToBCDof_Vec(LsSol::CLinearSystem& ls, int iv)
+{
+	for(unsigned int ilss=0;ilss<ls.GetNLinSysSeg();ilss++){
+		ls.GetBCFlag(ilss).SetZeroToBCDof( ls.GetVector(iv,ilss) );
+	}
+}
+
+// number of the dofs which are not fixed
+static unsigned int NFreeDof(LsSol::CLinearSystem& ls)
+{
+	unsigned int nfree = 0;
+	for(unsigned int ilss=0;ilss<ls.GetNLinSysSeg();ilss++){
+		const MatVec::CBCFlag& bc_flag = ls.GetBCFlag(ilss);
+		for(unsigned int iblk=0;iblk<bc_flag.NBlk();iblk++){
+		for(unsigned int idof=0;idof<bc_flag.LenBlk(iblk);idof++){
+			if( bc_flag.GetBCFlag(iblk,idof) == 0 ){ nfree++; }
+		}
+		}
+	}
+	return nfree;
+}
+
+// fill the vector iv with pseudo random values (deterministic with the seed)
+static void SetRandomVector(LsSol::CLinearSystem& ls, int iv, unsigned int& seed)
+{
+	for(unsigned int ilss=0;ilss<ls.GetNLinSysSeg();ilss++){
+		MatVec::CVector_Blk& vec = ls.GetVector(iv,ilss);
+		for(unsigned int iblk=0;iblk<vec.NBlk();iblk++){
+		for(unsigned int idof=0;idof<vec.Len(iblk);idof++){
+			seed = seed*1103515245u+12345u;
+			vec.SetValue(iblk,idof, ((seed>>16)&0x7fff)/32768.0-0.5 );
+		}
+		}
+	}
+	SetZeroToBCDof_Vec(ls,iv);
+}
+
+// make {iv} orthogonal to the orthonormal vectors aIdBase, and normalize it (classical Gram-Schmidt)
+// The projection is repeated only if the norm dropped below 1/sqrt(2) of the one before the projection.
+// If iav>=0, the same combination of aIdABase (the images of aIdBase) is applied to {iav}.
+// return false if {iv} is numerically in the span of aIdBase
+static bool OrthoNormalize(LsSol::CLinearSystem& ls, int iv, int iav, 
+	const std::vector<int>& aIdBase, const std::vector<int>& aIdABase)
+{
+	const unsigned int nbase = aIdBase.size();
+	std::vector<int> aiv1(nbase+1), aiv2(nbase+1,iv);
+	for(unsigned int ibase=0;ibase<nbase;ibase++){ aiv1[ibase] = aIdBase[ibase]; }
+	aiv1[nbase] = iv;
+	std::vector<double> adot(nbase+1);
+	ls.DOTS(nbase+1,&aiv1[0],&aiv2[0],&adot[0]);
+	const double sq_norm_ini = adot[nbase];
+	if( sq_norm_ini <= 0.0 ) return false;
+	double sq_norm = sq_norm_ini;
+	for(unsigned int ipass=0;ipass<2;ipass++){
+		if( ipass != 0 ){ ls.DOTS(nbase,&aiv1[0],&aiv2[0],&adot[0]); }
+		for(unsigned int ibase=0;ibase<nbase;ibase++){
+			ls.AXPY(-adot[ibase],aIdBase[ibase],iv);
+			if( iav >= 0 ){ ls.AXPY(-adot[ibase],aIdABase[ibase],iav); }
+		}
+		const double sq_norm_new = ls.DOT(iv,iv);
+		const bool is_enough = ( sq_norm_new > 0.5*sq_norm );
+		sq_norm = sq_norm_new;
+		if( is_enough ) break;
+	}
+	// the images are not made again, so their rounding error is amplified by the normalization
+	if( sq_norm < ( (iav>=0) ? 1.0e-8 : 1.0e-20 )*sq_norm_ini ) return false;
+	const double inv_norm = 1.0/sqrt(sq_norm);
+	ls.SCAL(inv_norm,iv);
+	if( iav >= 0 ){ ls.SCAL(inv_norm,iav); }
+	return true;
+}
+
+// Rayleigh-Ritz on the orthonormal basis aS (the images aAS), the first nx of aS are the current block
+// the lowest nblk Ritz vectors are set to aNX (images aNAX) and their eigen values to aLambdaBlk
+// the part of the Ritz vectors outside of the current block is set to aNP (images aNAP) if aS has such part
+static void RayleighRitz(LsSol::CLinearSystem& ls, 
+	const std::vector<int>& aS, const std::vector<int>& aAS, unsigned int nx,
+	const std::vector<int>& aNX, const std::vector<int>& aNAX,
+	const std::vector<int>& aNP, const std::vector<int>& aNAP,
+	std::vector<double>& aLambdaBlk)
+{
+	const unsigned int m = aS.size();
+	const unsigned int nblk = aNX.size();
+	assert( aAS.size() == m );
+	assert( nblk <= m && nx <= m );
+	std::vector<double> g(m*m);
+	{	// all the entries of the upper triangle in one reduction
+		std::vector<int> aiv1, aiv2;
+		for(unsigned int i=0;i<m;i++){
+		for(unsigned int j=i;j<m;j++){
+			aiv1.push_back(aS[i]);
+			aiv2.push_back(aAS[j]);
+		}
+		}
+		std::vector<double> adot(aiv1.size());
+		ls.DOTS(aiv1.size(),&aiv1[0],&aiv2[0],&adot[0]);
+		unsigned int idot = 0;
+		for(unsigned int i=0;i<m;i++){
+		for(unsigned int j=i;j<m;j++){
+			g[i*m+j] = adot[idot];
+			g[j*m+i] = adot[idot];
+			idot++;
+		}
+		}
+	}
+	std::vector<double> y, lam;
+	LsSol::EigenSymmetric_Jacobi(m,g,y,lam);
+	std::vector< std::pair<double,unsigned int> > aOrder(m);
+	for(unsigned int i=0;i<m;i++){ aOrder[i] = std::make_pair(lam[i],i); }
+	std::sort(aOrder.begin(),aOrder.end());
+	aLambdaBlk.resize(nblk);
+	for(unsigned int iblk=0;iblk<nblk;iblk++){
+		const unsigned int icol = aOrder[iblk].second;
+		aLambdaBlk[iblk] = aOrder[iblk].first;
+		if( nx < m ){
+			ls.SCAL(0.0,aNP[iblk]);
+			ls.SCAL(0.0,aNAP[iblk]);
+			for(unsigned int k=nx;k<m;k++){
+				ls.AXPY(y[k*m+icol],aS[k], aNP[iblk]);
+				ls.AXPY(y[k*m+icol],aAS[k],aNAP[iblk]);
+			}
+			ls.COPY(aNP[iblk], aNX[iblk]);
+			ls.COPY(aNAP[iblk],aNAX[iblk]);
+		}
+		else{
+			ls.SCAL(0.0,aNX[iblk]);
+			ls.SCAL(0.0,aNAX[iblk]);
+		}
+		for(unsigned int k=0;k<nx;k++){
+			ls.AXPY(y[k*m+icol],aS[k], aNX[iblk]);
+			ls.AXPY(y[k*m+icol],aAS[k],aNAX[iblk]);
+		}
+	}
+}
+
+unsigned int LsSol::MinimumEigenValueVector_LOBPCG(
+		LsSol::CLinearSystem& ls,
+		LsSol::CPreconditioner& pls,
+		const std::vector<unsigned int>& aIdVec,
+		std::vector<double>& aLambda,
+		unsigned int nblk,
+		unsigned int max_itr,
+		double conv_res )
+{
+	aLambda.clear();
+	const unsigned int nfree = NFreeDof(ls);
+	const unsigned int nev = ( aIdVec.size() < nfree ) ? aIdVec.size() : nfree;
+	if( nblk > nfree ){ nblk = nfree; }	// the block has to be linearly independent
+	if( nev == 0 || nblk == 0 ) return 0;
+
+	// work vectors after the ones of the eigen vectors
+	unsigned int iv0 = 0;
+	for(unsigned int iev=0;iev<nev;iev++){ iv0 = ( aIdVec[iev]+1 > iv0 ) ? aIdVec[iev]+1 : iv0; }
+	if( ls.GetTmpVectorArySize() < iv0+10*nblk ){ ls.ReSizeTmpVecSolver(iv0+10*nblk); }
+	std::vector<int> aX(nblk), aAX(nblk), aW(nblk), aAW(nblk), aP(nblk), aAP(nblk);
+	std::vector<int> aNX(nblk), aNAX(nblk), aNP(nblk), aNAP(nblk);
+	for(unsigned int iblk=0;iblk<nblk;iblk++){
+		aX[iblk]   = iv0+iblk;         aAX[iblk]  = iv0+iblk+nblk;
+		aW[iblk]   = iv0+iblk+nblk*2;  aAW[iblk]  = iv0+iblk+nblk*3;
+		aP[iblk]   = iv0+iblk+nblk*4;  aAP[iblk]  = iv0+iblk+nblk*5;
+		aNX[iblk]  = iv0+iblk+nblk*6;  aNAX[iblk] = iv0+iblk+nblk*7;
+		aNP[iblk]  = iv0+iblk+nblk*8;  aNAP[iblk] = iv0+iblk+nblk*9;
+	}
+
+	std::vector<int> aLock;	// converged (locked) eigen vectors
+	std::vector<double> aLambdaBlk(nblk,0.0);
+	unsigned int seed = 12345;
+	unsigned int nrefill = nblk;	// the first nrefill vectors of the block are to be made from random
+	bool is_p = false;
+	for(unsigned int itr=0;itr<max_itr;itr++){
+		if( aLock.size()+nblk > nfree ){
+			// the locked modes and the block would span more than the free dofs, so the head of the block
+			// (the slots to be refilled) is dropped. The rest of the block spans all the unlocked space.
+			const unsigned int ndrop = aLock.size()+nblk-nfree;
+			assert( ndrop <= nrefill );
+			std::vector<int>* apAry[10] = { &aX,&aAX,&aW,&aAW,&aP,&aAP,&aNX,&aNAX,&aNP,&aNAP };
+			for(unsigned int iary=0;iary<10;iary++){ apAry[iary]->erase(apAry[iary]->begin(),apAry[iary]->begin()+ndrop); }
+			aLambdaBlk.erase(aLambdaBlk.begin(),aLambdaBlk.begin()+ndrop);
+			nblk -= ndrop;
+			nrefill -= ndrop;
+			is_p = false;
+		}
+		if( nrefill > 0 ){
+			// fill the head of the block with the random vectors orthogonal to the rest, and take the Ritz vectors of the block
+			std::vector<int> aBase = aLock;
+			for(unsigned int iblk=nrefill;iblk<nblk;iblk++){ aBase.push_back(aX[iblk]); }
+			for(unsigned int iblk=0;iblk<nrefill;iblk++){
+				unsigned int itry = 0;
+				for(;itry<10;itry++){
+					SetRandomVector(ls,aX[iblk],seed);
+					if( OrthoNormalize(ls,aX[iblk],-1,aBase,aBase) ) break;
+				}
+				if( itry == 10 ) return aLock.size();	// no independent vector (should not happen with the dofs counted)
+				aBase.push_back(aX[iblk]);
+			}
+			ls.MATVEC_MULTI(nrefill,1.0,&aX[0],0.0,&aAX[0]);
+			RayleighRitz(ls,aX,aAX,nblk,aNX,aNAX,aNP,aNAP,aLambdaBlk);
+			std::swap(aX,aNX);
+			std::swap(aAX,aNAX);
+			nrefill = 0;
+			is_p = false;
+		}
+		////////////////
+		// residual {w} = [A]{x} - lambda{x}
+		for(unsigned int iblk=0;iblk<nblk;iblk++){
+			ls.COPY(aAX[iblk],aW[iblk]);
+			ls.AXPY(-aLambdaBlk[iblk],aX[iblk],aW[iblk]);
+		}
+		std::vector<double> aSqRes(nblk);
+		ls.DOTS(nblk,&aW[0],&aW[0],&aSqRes[0]);
+		// lock the converged modes from the lowest one
+		unsigned int nlock = 0;
+		for(unsigned int iblk=0;iblk<nblk;iblk++){
+			if( aLock.size() == nev ) break;
+			if( sqrt(aSqRes[iblk]) > conv_res*fabs(aLambdaBlk[iblk]) ) break;
+			const int iv_ev = aIdVec[aLock.size()];
+			ls.COPY(aX[iblk],iv_ev);
+			aLock.push_back(iv_ev);
+			aLambda.push_back(aLambdaBlk[iblk]);
+			nlock++;
+		}
+		if( aLock.size() == nev ) break;
+		if( nlock > 0 ){	// the locked ones are at the head of the block, refill them
+			nrefill = nlock;
+			continue;
+		}
+		////////////////
+		// preconditioned residual orthonormal to the locked modes, the block and each other
+		std::vector<int> aWa, aAWa;
+		{
+			std::vector<int> aBase = aLock;
+			aBase.insert(aBase.end(),aX.begin(),aX.end());
+			for(unsigned int iblk=0;iblk<nblk;iblk++){
+				pls.SolvePrecond(ls,aW[iblk]);
+				SetZeroToBCDof_Vec(ls,aW[iblk]);
+				if( !OrthoNormalize(ls,aW[iblk],-1,aBase,aBase) ) continue;
+				aBase.push_back(aW[iblk]);
+				aWa.push_back(aW[iblk]);
+				aAWa.push_back(aAW[iblk]);
+			}
+		}
+		if( aWa.empty() ) break;	// no direction to search
+		ls.MATVEC_MULTI(aWa.size(),1.0,&aWa[0],0.0,&aAWa[0]);
+		// basis [X W P] (the images of P are updated with the ones of X and W, no extra product)
+		std::vector<int> aS = aX, aAS = aAX;
+		aS.insert( aS.end(), aWa.begin(), aWa.end());
+		aAS.insert(aAS.end(),aAWa.begin(),aAWa.end());
+		if( is_p ){
+			for(unsigned int iblk=0;iblk<nblk;iblk++){
+				const std::vector<int> aBase = aS, aABase = aAS;
+				if( !OrthoNormalize(ls,aP[iblk],aAP[iblk],aBase,aABase) ) continue;
+				aS.push_back(aP[iblk]);
+				aAS.push_back(aAP[iblk]);
+			}
+		}
+		RayleighRitz(ls,aS,aAS,nblk,aNX,aNAX,aNP,aNAP,aLambdaBlk);
+		std::swap(aX,aNX);
+		std::swap(aAX,aNAX);
+		std::swap(aP,aNP);
+		std::swap(aAP,aNAP);
+		is_p = true;
+	}
+	return aLock.size();
+}
+
+
+////////////////////////////////////////////////////////////////
+
+// largest eigen value of the symmetric tridiagonal matrix (diagonal aAlpha[i], off diagonal aBeta[i] between i and i+1)
+// bisection with the number of the negative pivots of T-lambda*I (Sturm sequence)
+static double MaxEigenTridiagonal(const std::vector<double>& aAlpha, const std::vector<double>& aBeta)
+{
+	const unsigned int n = aAlpha.size();
+	if( n == 0 ) return 0.0;
+	assert( aBeta.size()+1 >= n );
+	double lo = aAlpha[0], hi = aAlpha[0];
+	for(unsigned int i=0;i<n;i++){	// Gershgorin
+		double r = 0.0;
+		if( i > 0   ) r += fabs(aBeta[i-1]);
+		if( i+1 < n ) r += fabs(aBeta[i]);
+		lo = ( aAlpha[i]-r < lo ) ? aAlpha[i]-r : lo;
+		hi = ( aAlpha[i]+r > hi ) ? aAlpha[i]+r : hi;
+	}
+	for(unsigned int itr=0;itr<100;itr++){
+		const double mid = (lo+hi)*0.5;
+		unsigned int nneg = 0;
+		double q = 1.0;
+		for(unsigned int i=0;i<n;i++){
+			q = aAlpha[i]-mid - ( (i>0) ? aBeta[i-1]*aBeta[i-1]/q : 0.0 );
+			if( q == 0.0 ) q = 1.0e-300;
+			if( q < 0.0 ) nneg++;
+		}
+		if( nneg == n ){ hi = mid; }	// all the eigen values are below mid
+		else{ lo = mid; }
+		if( hi-lo <= 1.0e-10*fabs(hi) ) break;
+	}
+	return hi;
+}
+
+// new vector with the same block size as vec (set zero)
+static MatVec::CVector_Blk* MakeVectorSameSize(const MatVec::CVector_Blk& vec)
+{
+	MatVec::CVector_Blk* pvec = 0;
+	if( vec.Len() >= 0 ){ pvec = new MatVec::CVector_Blk(vec.NBlk(),vec.Len()); }
+	else{
+		std::vector<unsigned int> aLen(vec.NBlk());
+		for(unsigned int iblk=0;iblk<vec.NBlk();iblk++){ aLen[iblk] = vec.Len(iblk); }
+		pvec = new MatVec::CVector_Blk(vec.NBlk(),aLen);
+	}
+	pvec->SetVectorZero();
+	return pvec;
+}
+
+static double DotSeg(const std::vector<MatVec::CVector_Blk*>& x, const std::vector<MatVec::CVector_Blk*>& y)
+{
+	double dot = 0.0;
+	for(unsigned int ilss=0;ilss<x.size();ilss++){ dot += (*x[ilss])*(*y[ilss]); }
+	return dot;
+}
+
+bool LsSol::CLinearOperator_BlockJacobi::MatVec_Seg(double alpha, const std::vector<MatVec::CVector_Blk*>& x, 
+	double beta, std::vector<MatVec::CVector_Blk*>& y)
+{
+	return ls.MatVec_Seg(alpha,x,beta,y);
+}
+
+// {y} := {x} if aInvDia is empty
+void LsSol::CLinearOperator_BlockJacobi::MultInvDia_Seg(const std::vector<MatVec::CVector_Blk*>& x, 
+	std::vector<MatVec::CVector_Blk*>& y)
+{
+	for(unsigned int ilss=0;ilss<x.size();ilss++){
+		if( aInvDia.empty() ){ (*y[ilss]) = (*x[ilss]); }
+		else{ aInvDia[ilss]->MatVec(1.0,*x[ilss],0.0,*y[ilss]); }
+	}
+}
+
+// Lanczos method for [D]^-1[A] that is symmetric in the inner product by [D]
+// r_j = [D]q_j is kept with q_j, so only one product with [D]^-1 is needed for an iteration
+double LsSol::MaximumEigenValue_Lanczos(
+	ILinearOperator_Seg& op,
+	const std::vector<const MatVec::CVector_Blk*>& aVec,
+	unsigned int nitr )
+{
+	const unsigned int nlss = aVec.size();
+	if( nlss == 0 || nitr == 0 ) return 0.0;
+	std::vector<MatVec::CVector_Blk*> aQ(nlss), aR(nlss), aRp(nlss), aW(nlss);
+	for(unsigned int ilss=0;ilss<nlss;ilss++){
+		const MatVec::CVector_Blk& res = *aVec[ilss];
+		aQ[ilss]  = MakeVectorSameSize(res);
+		aR[ilss]  = MakeVectorSameSize(res);
+		aRp[ilss] = MakeVectorSameSize(res);
+		aW[ilss]  = MakeVectorSameSize(res);
+	}
+	{	// pseudo random initial vector (deterministic)
+		unsigned int seed = 1;
+		for(unsigned int ilss=0;ilss<nlss;ilss++){
+			MatVec::CVector_Blk& vec = *aR[ilss];
+			for(unsigned int iblk=0;iblk<vec.NBlk();iblk++){
+			for(unsigned int idof=0;idof<vec.Len(iblk);idof++){
+				seed = seed*1103515245u+12345u;
+				vec.SetValue(iblk,idof, ((seed>>16)&0x7fff)/32768.0+0.5 );
+			}
+			}
+		}
+	}
+	std::vector<double> aAlpha, aBeta;
+	op.MultInvDia_Seg(aR,aQ);
+	double beta = sqrt( DotSeg(aR,aQ) );
+	if( beta > 1.0e-30 ){
+		for(unsigned int ilss=0;ilss<nlss;ilss++){ (*aR[ilss]) *= 1.0/beta; (*aQ[ilss]) *= 1.0/beta; }
+		beta = 0.0;
+		for(unsigned int itr=0;itr<nitr;itr++){
+			op.MatVec_Seg(1.0,aQ,0.0,aW);	// {w} = [A]{q_j}
+			const double alpha = DotSeg(aQ,aW);
+			aAlpha.push_back(alpha);
+			if( itr == nitr-1 ) break;
+			for(unsigned int ilss=0;ilss<nlss;ilss++){
+				aW[ilss]->AXPY(-alpha,*aR[ilss]);
+				aW[ilss]->AXPY(-beta, *aRp[ilss]);
+				(*aRp[ilss]) = (*aR[ilss]);
+				(*aR[ilss])  = (*aW[ilss]);
+			}
+			op.MultInvDia_Seg(aR,aQ);
+			const double sq_beta = DotSeg(aR,aQ);
+			if( sq_beta <= 1.0e-24*alpha*alpha ) break;	// invariant subspace
+			beta = sqrt(sq_beta);
+			for(unsigned int ilss=0;ilss<nlss;ilss++){ (*aR[ilss]) *= 1.0/beta; (*aQ[ilss]) *= 1.0/beta; }
+			aBeta.push_back(beta);
+		}
+	}
+	for(unsigned int ilss=0;ilss<nlss;ilss++){
+		delete aQ[ilss]; delete aR[ilss]; delete aRp[ilss]; delete aW[ilss];
+	}
+	return MaxEigenTridiagonal(aAlpha,aBeta);
+}
+
+double LsSol::MaximumEigenValue_Lanczos(
+	const LsSol::CLinearSystem& ls,
+	const std::vector<MatVec::CMatDiaInv_BlkDia*>& aInvDia,
+	unsigned int nitr )
+{
+	const unsigned int nlss = ls.GetNLinSysSeg();
+	assert( aInvDia.empty() || aInvDia.size() == nlss );
+	std::vector<const MatVec::CVector_Blk*> aVec(nlss);
+	for(unsigned int ilss=0;ilss<nlss;ilss++){ aVec[ilss] = &ls.GetVector(-1,ilss); }
+	CLinearOperator_BlockJacobi op(ls,aInvDia);
+	return LsSol::MaximumEigenValue_Lanczos(op,aVec,nitr);
+}
@@ -24,6 +24,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 
 #include "delfem/matvec/matdia_blkcrs.h"
 #include "delfem/matvec/vector_blk.h"
+#include "delfem/matvec/multivector_blk.h"
 #include "delfem/matvec/diamat_blk.h"
 #include "delfem/matvec/bcflag_blk.h"
 
@@ -66,6 +67,8 @@ void LsSol::CLinearSystem::Clear()
 		m_TmpVectorArray[i].clear();
 	}
 	m_TmpVectorArray.clear();
+	////////////////
+	this->ClearBatch();
     ////////////////
     m_aSeg.clear();
 }
@@ -127,6 +130,16 @@ double LsSol::CLinearSystem::FinalizeMarge()
 	return sqrt(sq_norm_res);
 }
 
+bool LsSol::CLinearSystem::SetCompactPattern(bool is_compact)
+{
+	bool res = true;
+	for(unsigned int iseg=0;iseg<m_Matrix_Dia.size();iseg++){
+		if( m_Matrix_Dia[iseg] == 0 ) continue;
+		if( !m_Matrix_Dia[iseg]->SetCompactPattern(is_compact) ){ res = false; }
+	}
+	return res;
+}
+
 
 void LsSol::CLinearSystem::ClearFixedBoundaryCondition(){
 	for(unsigned int ibcflag=0;ibcflag<m_BCFlag.size();ibcflag++){
@@ -269,23 +282,29 @@ bool LsSol::CLinearSystem::MATVEC(double alpha, int iv1, double beta, int iv2)
 		return true;
 	}
 
-	assert( p_vec1->size() == nseg );
-	assert( p_vec2->size() == nseg );
-
 	if( iv1 == iv2 ){
 		std::cout << "Error!-->" << std::endl;
 		assert(0);
 	}
+	return this->MatVec_Seg(alpha,*p_vec1,beta,*p_vec2);
+}
 
+bool LsSol::CLinearSystem::MatVec_Seg(double alpha, const std::vector< MatVec::CVector_Blk* >& x, 
+									  double beta, std::vector< MatVec::CVector_Blk* >& y) const
+{
+	const unsigned int nseg = this->m_aSeg.size();
+	assert( x.size() == nseg );
+	assert( y.size() == nseg );
 	for(unsigned int iseg=0;iseg<nseg;iseg++){
-		if( this->m_Matrix_Dia[iseg] != 0 ){
-			m_Matrix_Dia[iseg]->MatVec( alpha, (*(*p_vec1)[iseg]), beta, (*(*p_vec2)[iseg]) );
+		if( alpha != 0.0 && this->m_Matrix_Dia[iseg] != 0 ){
+			m_Matrix_Dia[iseg]->MatVec( alpha, (*x[iseg]), beta, (*y[iseg]) );
 		}
-		else{ (*(*p_vec2)[iseg]) *= beta; }
+		else{ (*y[iseg]) *= beta; }
+		if( alpha == 0.0 ) continue;
 		for(unsigned int jseg=0;jseg<nseg;jseg++){
 			if( m_Matrix_NonDia[iseg][jseg] == 0 ) continue;
 			assert( iseg != jseg );
-			m_Matrix_NonDia[iseg][jseg]->MatVec( alpha, (*(*p_vec1)[jseg]), 1.0, (*(*p_vec2)[iseg]), true );
+			m_Matrix_NonDia[iseg][jseg]->MatVec( alpha, (*x[jseg]), 1.0, (*y[iseg]), true );
 		}
 	}
 	return true;
@@ -414,6 +433,169 @@ bool LsSol::CLinearSystem::SCAL(double alpha,int iv1)
 	return true;
 }
 
+std::vector< MatVec::CVector_Blk* >& LsSol::CLinearSystem::GetVectorSegs(int iv)
+{
+	if( iv >= 0 && iv < (int)this->GetTmpVectorArySize() ) return m_TmpVectorArray[iv];
+	else if( iv == -1 ) return this->m_Residual;
+	assert( iv == -2 );
+	return this->m_Update;
+}
+
+////////////////////////////////
+// {v2} := alpha*{v1} + beta*{v2}
+bool LsSol::CLinearSystem::AXPBY(double alpha, int iv1, double beta, int iv2)
+{
+	const unsigned int nseg = this->m_aSeg.size();
+	if( nseg == 0 )	return true;
+	assert( iv1 != iv2 );
+	std::vector< MatVec::CVector_Blk* >& vec1 = this->GetVectorSegs(iv1);
+	std::vector< MatVec::CVector_Blk* >& vec2 = this->GetVectorSegs(iv2);
+	assert( vec1.size() == nseg );
+	assert( vec2.size() == nseg );
+	for(unsigned int iseg=0;iseg<nseg;iseg++){
+		vec2[iseg]->AXPBY( alpha, *vec1[iseg], beta );
+	}
+	return true;
+}
+
+////////////////////////////////
+// {v2} := alpha*{v1} + {v2}
+// return {v2} * {v2}
+double LsSol::CLinearSystem::AXPY_DOT(double alpha, int iv1, int iv2)
+{
+	const unsigned int nseg = this->m_aSeg.size();
+	if( nseg == 0 )	return 0.0;
+	assert( iv1 != iv2 );
+	std::vector< MatVec::CVector_Blk* >& vec1 = this->GetVectorSegs(iv1);
+	std::vector< MatVec::CVector_Blk* >& vec2 = this->GetVectorSegs(iv2);
+	assert( vec1.size() == nseg );
+	assert( vec2.size() == nseg );
+	double sqnorm = 0.0;
+	for(unsigned int iseg=0;iseg<nseg;iseg++){
+		sqnorm += vec2[iseg]->AXPY_SqNorm( alpha, *vec1[iseg] );
+	}
+	return sqnorm;
+}
+
+////////////////////////////////
+// {v2} := alpha*[MATRIX]*{v1} + beta*{v2}
+// return {v1} * {v2}
+// the dot product is taken inside the row loop if the segment has no off-diagonal matrix
+double LsSol::CLinearSystem::MATVEC_DOT(double alpha, int iv1, double beta, int iv2)
+{
+	const unsigned int nseg = this->m_aSeg.size();
+	if( nseg == 0 )	return 0.0;
+	if( alpha == 0.0 ){
+		this->SCAL(beta,iv2);
+		return this->DOT(iv1,iv2);
+	}
+	assert( iv1 != iv2 );
+	std::vector< MatVec::CVector_Blk* >& vec1 = this->GetVectorSegs(iv1);
+	std::vector< MatVec::CVector_Blk* >& vec2 = this->GetVectorSegs(iv2);
+	assert( vec1.size() == nseg );
+	assert( vec2.size() == nseg );
+	double dot = 0.0;
+	for(unsigned int iseg=0;iseg<nseg;iseg++){
+		bool is_nondia = false;
+		for(unsigned int jseg=0;jseg<nseg;jseg++){
+			if( m_Matrix_NonDia[iseg][jseg] != 0 ){ is_nondia = true; break; }
+		}
+		if( !is_nondia && m_Matrix_Dia[iseg] != 0 ){
+			dot += m_Matrix_Dia[iseg]->MatVec_Dot( alpha, *vec1[iseg], beta, *vec2[iseg] );
+			continue;
+		}
+		if( m_Matrix_Dia[iseg] != 0 ){
+			m_Matrix_Dia[iseg]->MatVec( alpha, *vec1[iseg], beta, *vec2[iseg] );
+		}
+		else{ (*vec2[iseg]) *= beta; }
+		for(unsigned int jseg=0;jseg<nseg;jseg++){
+			if( m_Matrix_NonDia[iseg][jseg] == 0 ) continue;
+			assert( iseg != jseg );
+			m_Matrix_NonDia[iseg][jseg]->MatVec( alpha, *vec1[jseg], 1.0, *vec2[iseg], true );
+		}
+		dot += (*vec1[iseg]) * (*vec2[iseg]);
+	}
+	return dot;
+}
+
+////////////////////////////////
+// adot[idot] := {v1[idot]} * {v2[idot]}
+// all the pairs are summed in one sweep over each segment
+void LsSol::CLinearSystem::DOTS(unsigned int ndot, const int* aiv1, const int* aiv2, double* adot)
+{
+	for(unsigned int idot=0;idot<ndot;idot++){ adot[idot] = 0.0; }
+	const unsigned int nseg = this->m_aSeg.size();
+	if( nseg == 0 || ndot == 0 ) return;
+	std::vector< const MatVec::CVector_Blk* > apv1(ndot), apv2(ndot);
+	for(unsigned int iseg=0;iseg<nseg;iseg++){
+		for(unsigned int idot=0;idot<ndot;idot++){
+			apv1[idot] = this->GetVectorSegs(aiv1[idot])[iseg];
+			apv2[idot] = this->GetVectorSegs(aiv2[idot])[iseg];
+		}
+		MatVec::DotMulti(ndot,&apv1[0],&apv2[0],adot);
+	}
+}
+
+////////////////////////////////
+// {v2} := sum aalpha[ivec]*{v1[ivec]} + {v2}
+// all the vectors are added in one sweep over each segment
+bool LsSol::CLinearSystem::AXPY_MULTI(unsigned int nvec, const double* aalpha, const int* aiv1, int iv2)
+{
+	const unsigned int nseg = this->m_aSeg.size();
+	if( nseg == 0 || nvec == 0 ) return true;
+	std::vector< const MatVec::CVector_Blk* > apv1(nvec);
+	for(unsigned int iseg=0;iseg<nseg;iseg++){
+		for(unsigned int ivec=0;ivec<nvec;ivec++){
+			assert( aiv1[ivec] != iv2 );
+			apv1[ivec] = this->GetVectorSegs(aiv1[ivec])[iseg];
+		}
+		MatVec::AxpyMulti(nvec,aalpha,&apv1[0],*this->GetVectorSegs(iv2)[iseg]);
+	}
+	return true;
+}
+
+////////////////////////////////
+// {v2[ivec]} := alpha*[MATRIX]*{v1[ivec]} + beta*{v2[ivec]}
+// the vectors are packed into the multi vectors (as MatVec_Batch), so each matrix is read once for all of them
+bool LsSol::CLinearSystem::MATVEC_MULTI(unsigned int nvec, double alpha, const int* aiv1, double beta, const int* aiv2)
+{
+	const unsigned int nseg = this->m_aSeg.size();
+	if( nseg == 0 || nvec == 0 ) return true;
+	for(unsigned int iseg=0;iseg<nseg;iseg++){
+		if( m_aSeg[iseg].len != -1 ) continue;
+		// the multi vector has no flex block, so one by one
+		for(unsigned int ivec=0;ivec<nvec;ivec++){
+			if( !this->MATVEC(alpha,aiv1[ivec],beta,aiv2[ivec]) ) return false;
+		}
+		return true;
+	}
+	std::vector< MatVec::CMultiVector_Blk > aX(nseg), aY(nseg);
+	for(unsigned int iseg=0;iseg<nseg;iseg++){
+		aX[iseg].Initialize(m_aSeg[iseg].nnode,m_aSeg[iseg].len,nvec);
+		aY[iseg].Initialize(m_aSeg[iseg].nnode,m_aSeg[iseg].len,nvec);
+		for(unsigned int ivec=0;ivec<nvec;ivec++){
+			aX[iseg].SetColumn(ivec,*this->GetVectorSegs(aiv1[ivec])[iseg]);
+			aY[iseg].SetColumn(ivec,*this->GetVectorSegs(aiv2[ivec])[iseg]);
+		}
+	}
+	const std::vector<double> abeta(nvec,beta);
+	for(unsigned int iseg=0;iseg<nseg;iseg++){
+		if( m_Matrix_Dia[iseg] != 0 ){
+			m_Matrix_Dia[iseg]->MatVec_Multi( alpha, aX[iseg], beta, aY[iseg] );
+		}
+		else{ aY[iseg].Scale(&abeta[0]); }
+		for(unsigned int jseg=0;jseg<nseg;jseg++){
+			if( m_Matrix_NonDia[iseg][jseg] == 0 ) continue;
+			assert( iseg != jseg );
+			m_Matrix_NonDia[iseg][jseg]->MatVec_Multi( alpha, aX[jseg], 1.0, aY[iseg], true );
+		}
+		for(unsigned int ivec=0;ivec<nvec;ivec++){
+			aY[iseg].GetColumn(ivec,*this->GetVectorSegs(aiv2[ivec])[iseg]);
+		}
+	}
+	return true;
+}
+
 
 
 bool LsSol::CLinearSystem::AddMat_Dia(unsigned int ils, const Com::CIndexedArray& crs)
@@ -498,3 +680,190 @@ bool LsSol::CLinearSystem::AddMat_NonDia(
 	m_Matrix_NonDia[ils_col][ils_row]->AddPattern(crs);
 	return true;
 }
+
+
+////////////////////////////////////////////////////////////////
+// batch (several right hand sides)
+
+void LsSol::CLinearSystem::ClearBatch()
+{
+	for(unsigned int i=0;i<m_ResidualBatch.size();i++){ delete m_ResidualBatch[i]; }
+	m_ResidualBatch.clear();
+	for(unsigned int i=0;i<m_UpdateBatch.size();i++){ delete m_UpdateBatch[i]; }
+	m_UpdateBatch.clear();
+	for(unsigned int i=0;i<m_TmpVecBatch.size();i++){
+		for(unsigned int j=0;j<m_TmpVecBatch[i].size();j++){
+			delete m_TmpVecBatch[i][j];
+		}
+		m_TmpVecBatch[i].clear();
+	}
+	m_TmpVecBatch.clear();
+	m_nrhs = 0;
+}
+
+bool LsSol::CLinearSystem::SetBatch(unsigned int nrhs)
+{
+	this->ClearBatch();
+	const unsigned int nseg = m_aSeg.size();
+	for(unsigned int iseg=0;iseg<nseg;iseg++){
+		if( m_aSeg[iseg].len == -1 ){
+			std::cout << "Error!-->Not Implemented" << std::endl;
+			assert(0);
+			return false;
+		}
+	}
+	m_nrhs = nrhs;
+	m_ResidualBatch.resize(nseg);
+	m_UpdateBatch.resize(nseg);
+	for(unsigned int iseg=0;iseg<nseg;iseg++){
+		const unsigned int nnode = m_aSeg[iseg].nnode;
+		const unsigned int len = m_aSeg[iseg].len;
+		m_ResidualBatch[iseg] = new MatVec::CMultiVector_Blk(nnode,len,nrhs);
+		m_UpdateBatch[iseg]   = new MatVec::CMultiVector_Blk(nnode,len,nrhs);
+		for(unsigned int irhs=0;irhs<nrhs;irhs++){
+			m_ResidualBatch[iseg]->SetColumn(irhs,*m_Residual[iseg]);
+		}
+		m_UpdateBatch[iseg]->SetVectorZero();
+	}
+	return true;
+}
+
+bool LsSol::CLinearSystem::ReSizeTmpVecBatch(unsigned int size_new)
+{
+	const unsigned int nseg = m_aSeg.size();
+	const unsigned int size_old = m_TmpVecBatch.size();
+	if( size_new == size_old ) return true;
+	if( size_new < size_old ){
+		for(unsigned int ivec=size_new;ivec<size_old;ivec++){
+			for(unsigned int iseg=0;iseg<m_TmpVecBatch[ivec].size();iseg++){
+				delete m_TmpVecBatch[ivec][iseg];
+			}
+		}
+		m_TmpVecBatch.resize(size_new);
+		return true;
+	}
+	m_TmpVecBatch.resize(size_new);
+	for(unsigned int ivec=size_old;ivec<size_new;ivec++){
+		m_TmpVecBatch[ivec].resize(nseg);
+		for(unsigned int iseg=0;iseg<nseg;iseg++){
+			assert( m_aSeg[iseg].len >= 0 );
+			m_TmpVecBatch[ivec][iseg] = new MatVec::CMultiVector_Blk(m_aSeg[iseg].nnode,m_aSeg[iseg].len,m_nrhs);
+			m_TmpVecBatch[ivec][iseg]->SetVectorZero();
+		}
+	}
+	return true;
+}
+
+std::vector< MatVec::CMultiVector_Blk* >& LsSol::CLinearSystem::GetBatchVectorSegs(int iv)
+{
+	if( iv >= 0 && iv < (int)this->GetTmpVecBatchSize() ) return m_TmpVecBatch[iv];
+	else if( iv == -1 ) return this->m_ResidualBatch;
+	assert( iv == -2 );
+	return this->m_UpdateBatch;
+}
+
+MatVec::CMultiVector_Blk& LsSol::CLinearSystem::GetBatchVector(int iv, unsigned int ilss)
+{
+	std::vector< MatVec::CMultiVector_Blk* >& vec = this->GetBatchVectorSegs(iv);
+	assert( ilss < vec.size() );
+	return *vec[ilss];
+}
+
+bool LsSol::CLinearSystem::CopyBatchColumn(int iv_batch, unsigned int irhs, int iv)
+{
+	assert( irhs < m_nrhs );
+	std::vector< MatVec::CMultiVector_Blk* >& vec_from = this->GetBatchVectorSegs(iv_batch);
+	std::vector< MatVec::CVector_Blk* >& vec_to = this->GetVectorSegs(iv);
+	const unsigned int nseg = m_aSeg.size();
+	assert( vec_from.size() == nseg && vec_to.size() == nseg );
+	for(unsigned int iseg=0;iseg<nseg;iseg++){
+		vec_from[iseg]->GetColumn(irhs,*vec_to[iseg]);
+	}
+	return true;
+}
+
+bool LsSol::CLinearSystem::SetBatchColumn(int iv, int iv_batch, unsigned int irhs)
+{
+	assert( irhs < m_nrhs );
+	std::vector< MatVec::CVector_Blk* >& vec_from = this->GetVectorSegs(iv);
+	std::vector< MatVec::CMultiVector_Blk* >& vec_to = this->GetBatchVectorSegs(iv_batch);
+	const unsigned int nseg = m_aSeg.size();
+	assert( vec_from.size() == nseg && vec_to.size() == nseg );
+	for(unsigned int iseg=0;iseg<nseg;iseg++){
+		vec_to[iseg]->SetColumn(irhs,*vec_from[iseg]);
+	}
+	return true;
+}
+
+bool LsSol::CLinearSystem::DOT_Batch(int iv1, int iv2, double* adot)
+{
+	std::vector< MatVec::CMultiVector_Blk* >& vec1 = this->GetBatchVectorSegs(iv1);
+	std::vector< MatVec::CMultiVector_Blk* >& vec2 = this->GetBatchVectorSegs(iv2);
+	const unsigned int nseg = m_aSeg.size();
+	assert( vec1.size() == nseg && vec2.size() == nseg );
+	for(unsigned int irhs=0;irhs<m_nrhs;irhs++){ adot[irhs] = 0.0; }
+	std::vector<double> adot_seg(m_nrhs);
+	for(unsigned int iseg=0;iseg<nseg;iseg++){
+		vec1[iseg]->Dot(*vec2[iseg],&adot_seg[0]);
+		for(unsigned int irhs=0;irhs<m_nrhs;irhs++){ adot[irhs] += adot_seg[irhs]; }
+	}
+	return true;
+}
+
+bool LsSol::CLinearSystem::COPY_Batch(int iv_from, int iv_to)
+{
+	if( iv_from == iv_to ) return true;
+	std::vector< MatVec::CMultiVector_Blk* >& vec1 = this->GetBatchVectorSegs(iv_from);
+	std::vector< MatVec::CMultiVector_Blk* >& vec2 = this->GetBatchVectorSegs(iv_to);
+	const unsigned int nseg = m_aSeg.size();
+	assert( vec1.size() == nseg && vec2.size() == nseg );
+	for(unsigned int iseg=0;iseg<nseg;iseg++){
+		(*vec2[iseg]) = (*vec1[iseg]);
+	}
+	return true;
+}
+
+bool LsSol::CLinearSystem::SCAL_Batch(const double* alpha, int iv1)
+{
+	std::vector< MatVec::CMultiVector_Blk* >& vec1 = this->GetBatchVectorSegs(iv1);
+	const unsigned int nseg = m_aSeg.size();
+	assert( vec1.size() == nseg );
+	for(unsigned int iseg=0;iseg<nseg;iseg++){
+		vec1[iseg]->Scale(alpha);
+	}
+	return true;
+}
+
+bool LsSol::CLinearSystem::AXPY_Batch(const double* alpha, int iv1, int iv2)
+{
+	std::vector< MatVec::CMultiVector_Blk* >& vec1 = this->GetBatchVectorSegs(iv1);
+	std::vector< MatVec::CMultiVector_Blk* >& vec2 = this->GetBatchVectorSegs(iv2);
+	const unsigned int nseg = m_aSeg.size();
+	assert( vec1.size() == nseg && vec2.size() == nseg );
+	for(unsigned int iseg=0;iseg<nseg;iseg++){
+		vec2[iseg]->AXPY(alpha,*vec1[iseg]);
+	}
+	return true;
+}
+
+bool LsSol::CLinearSystem::MatVec_Batch(double alpha, int iv1, double beta, int iv2)
+{
+	assert( iv1 != iv2 );
+	std::vector< MatVec::CMultiVector_Blk* >& vec1 = this->GetBatchVectorSegs(iv1);
+	std::vector< MatVec::CMultiVector_Blk* >& vec2 = this->GetBatchVectorSegs(iv2);
+	const unsigned int nseg = m_aSeg.size();
+	assert( vec1.size() == nseg && vec2.size() == nseg );
+	const std::vector<double> abeta(m_nrhs,beta);
+	for(unsigned int iseg=0;iseg<nseg;iseg++){
+		if( m_Matrix_Dia[iseg] != 0 ){
+			m_Matrix_Dia[iseg]->MatVec_Multi( alpha, *vec1[iseg], beta, *vec2[iseg] );
+		}
+		else if( m_nrhs > 0 ){ vec2[iseg]->Scale(&abeta[0]); }
+		for(unsigned int jseg=0;jseg<nseg;jseg++){
+			if( m_Matrix_NonDia[iseg][jseg] == 0 ) continue;
+			assert( iseg != jseg );
+			m_Matrix_NonDia[iseg][jseg]->MatVec_Multi( alpha, *vec1[jseg], 1.0, *vec2[iseg], true );
+		}
+	}
+	return true;
+}
@@ -24,17 +24,48 @@
 #include <assert.h>
 #include <time.h>
 #include <stdio.h>
+#include <iostream>
 
 #include "delfem/matvec/matdia_blkcrs.h"
 #include "delfem/matvec/matdiafrac_blkcrs.h"
 #include "delfem/matvec/matfrac_blkcrs.h"
 #include "delfem/matvec/vector_blk.h"
+#include "delfem/matvec/multivector_blk.h"
 #include "delfem/matvec/solver_mg.h"
 #include "delfem/matvec/ordering_blk.h"
+#include "delfem/matvec/matdiainv_blkdia.h"
 
 #include "delfem/ls/preconditioner.h"
+#include "delfem/ls/eigen_lanczos.h"
+#include "delfem/parallel.h"
+
+// pattern versions of all the matrices of the linear system (0 if there is no matrix)
+// (the version is renewed whenever the pattern of a matrix is changed, see CMat_BlkCrs::GetPatternVersion)
+static void GetPatternVersion(const LsSol::CLinearSystem& ls, std::vector<unsigned int>& aVer)
+{
+  aVer.clear();
+  const unsigned int nlss = ls.GetNLinSysSeg();
+  aVer.push_back(nlss);
+  for(unsigned int ilss=0;ilss<nlss;ilss++){
+    for(unsigned int jlss=0;jlss<nlss;jlss++){
+      if( ilss != jlss && !ls.IsMatrix(ilss,jlss) ){ aVer.push_back(0); continue; }
+      const MatVec::CMat_BlkCrs& mat = ( ilss == jlss ) ? ls.GetMatrix(ilss) : ls.GetMatrix(ilss,jlss);
+      aVer.push_back(mat.GetPatternVersion());
+    }
+  }
+}
 
 void LsSol::CPreconditioner_ILU::Clear()
+{
+  this->ClearPattern();
+  m_alev_input.clear();  
+  m_is_ordering = false;
+  m_is_nd = false;
+  m_is_single = false;
+  m_is_compact = false;
+}
+
+void LsSol::CPreconditioner_ILU::ClearPattern()
 {
 	for(unsigned int i=0;i<m_Matrix_NonDia.size();i++){
 		for(unsigned int j=0;j<m_Matrix_NonDia[i].size();j++){
@@ -48,13 +79,44 @@ void LsSol::CPreconditioner_ILU::Clear()
 		if( m_Matrix_Dia[i] != 0 ) delete m_Matrix_Dia[i];
 	}
 	m_Matrix_Dia.clear();
-  ////////////////
-  m_alev_input.clear();  
-  m_is_ordering = false;
+  m_aPatternVersion.clear();
+}
+
+void LsSol::CPreconditioner_ILU::PrintTime() const
+{
+  printf("ILU symbolic:%d %.4f  numeric:%d %.4f\n",m_nsymbolic,m_time_symbolic,m_nnumeric,m_time_numeric);
+}
+
+void LsSol::CPreconditioner_ILU::PrintMemory() const
+{
+  for(unsigned int ilss=0;ilss<m_Matrix_Dia.size();ilss++){
+    const MatVec::CMatDiaFrac_BlkCrs& mat = *m_Matrix_Dia[ilss];
+    const unsigned int nnz = mat.NCrs()+mat.NBlkMatCol();	// off-diagonal and diagonal blocks
+    if( nnz == 0 || mat.LenBlkCol() < 0 ){ continue; }
+    const unsigned int blksize = mat.LenBlkCol()*mat.LenBlkRow();
+    const double byte_ind = (double)mat.NBytePattern()/nnz;
+    const unsigned int byte_val = blksize*( mat.IsSinglePrecision() ? sizeof(float) : sizeof(double) );
+    printf("ILU seg:%d nnz_blk:%d index:%.2f byte/blk(%s) value:%d byte/blk(%s) total:%.2f byte/nonzero\n",
+           ilss,nnz,byte_ind,( mat.IsCompactPattern() ? "16bit" : "32bit" ),
+           byte_val,( mat.IsSinglePrecision() ? "float" : "double" ),(byte_ind+byte_val)/blksize);
+  }
 }
 
 // symbolic factorization
 void LsSol::CPreconditioner_ILU::SetLinearSystem(const CLinearSystem& ls)
+{
+  std::vector<unsigned int> aVer;
+  GetPatternVersion(ls,aVer);
+  if( !m_Matrix_Dia.empty() && aVer == m_aPatternVersion ) return;  // the fill pattern can be reused
+  this->ClearPattern();
+  const double time0 = Com::GetWallTime();
+  this->MakeFracPattern(ls);
+  m_time_symbolic += Com::GetWallTime()-time0;
+  m_nsymbolic++;
+  m_aPatternVersion = aVer;
+}
+
+void LsSol::CPreconditioner_ILU::MakeFracPattern(const CLinearSystem& ls)
 {
   //    std::cout << "0 prec : set linsys " << std::endl;
 	if( m_is_ordering ){
@@ -76,9 +138,15 @@ void LsSol::CPreconditioner_ILU::SetLinearSystem(const CLinearSystem& ls)
      end = clock();
      printf("Ordering:%.4f  Pattern:%.4f\n",(double)(mid-start)/CLOCKS_PER_SEC,(double)(end-mid)/CLOCKS_PER_SEC);     
      */
+		assert( ls.GetNLinSysSeg() == 1 );
+		if( m_is_nd ){ m_order.MakeOrdering_ND( ls.GetMatrix(0) ); }
+		int lev = 0;	// the level for all the segments or the first one
+		for(unsigned int ilev=0;ilev<m_alev_input.size();ilev++){
+			if( m_alev_input[ilev].second == -1 || m_alev_input[ilev].second == 0 ){ lev = m_alev_input[ilev].first; }
+		}
 		m_Matrix_NonDia.resize(1);
 		m_Matrix_NonDia[0].push_back(0);
-    m_Matrix_Dia.push_back( new MatVec::CMatDiaFrac_BlkCrs(0,ls.GetMatrix(0),m_order) );    
+    m_Matrix_Dia.push_back( new MatVec::CMatDiaFrac_BlkCrs(lev,ls.GetMatrix(0),m_order) );    
 		const unsigned int nblk = ls.GetMatrix(0).NBlkMatCol();
     const unsigned int nlen = ls.GetMatrix(0).LenBlkCol();
 		m_vec.Initialize(nblk,nlen);
@@ -215,6 +283,28 @@ void LsSol::CPreconditioner_ILU::SetLinearSystem(const CLinearSystem& ls)
 // lݒ肵ILUs֐
 // ILUĂ邩ǂ͂Əڍׂȃf[^Ԃ
 bool LsSol::CPreconditioner_ILU::SetValue(const LsSol::CLinearSystem& ls)
+{
+  {
+    std::vector<unsigned int> aVer;
+    GetPatternVersion(ls,aVer);
+    if( m_Matrix_Dia.empty() || aVer != m_aPatternVersion ){ this->SetLinearSystem(ls); } // the pattern of ls was changed
+  }
+  const double time0 = Com::GetWallTime();
+  for(unsigned int ilss=0;ilss<m_Matrix_Dia.size();ilss++){
+    m_Matrix_Dia[ilss]->SetSinglePrecision(false);
+    m_Matrix_Dia[ilss]->SetCompactPattern(false);
+  }
+  const bool res = this->DoFactorize(ls);
+  for(unsigned int ilss=0;ilss<m_Matrix_Dia.size() && res;ilss++){
+    if( m_is_single  ){ m_Matrix_Dia[ilss]->SetSinglePrecision(true); }
+    if( m_is_compact ){ m_Matrix_Dia[ilss]->SetCompactPattern(true); }
+  }
+  m_time_numeric += Com::GetWallTime()-time0;
+  m_nnumeric++;
+  return res;
+}
+
+bool LsSol::CPreconditioner_ILU::DoFactorize(const LsSol::CLinearSystem& ls)
 {
   
   //    std::cout << "0 prec : set linsys " << std::endl;
@@ -334,3 +424,418 @@ bool LsSol::CPreconditioner_ILU::SolvePrecond(LsSol::CLinearSystem& ls, unsigned
 	return true;
 }
 
+// same as SolvePrecond for all the columns of the batch vector
+bool LsSol::CPreconditioner_ILU::SolvePrecond_Batch(LsSol::CLinearSystem& ls, int iv)
+{
+	const unsigned int nlss = ls.GetNLinSysSeg();
+  
+	if( m_is_ordering ){
+		assert( nlss == 1 );
+		const MatVec::CMultiVector_Blk& vec = ls.GetBatchVector(iv,0);
+		if( m_mvec.NBlk() != vec.NBlk() || m_mvec.Len() != vec.Len() || m_mvec.NCol() != vec.NCol() ){
+			m_mvec.Initialize(vec.NBlk(),vec.Len(),vec.NCol());
+		}
+		m_order.OrderingVector_OldToNew(m_mvec,ls.GetBatchVector(iv,0));
+		m_Matrix_Dia[0]->Solve(m_mvec);
+		m_order.OrderingVector_NewToOld(ls.GetBatchVector(iv,0),m_mvec);
+		return true;
+	}
+  
+  // Forward Substitution
+	for(unsigned int ilss=0;ilss<nlss;ilss++){
+		for(unsigned int jlss=0;jlss<ilss;jlss++){
+      if( !m_Matrix_NonDia[ilss][jlss] ){ continue; }
+			m_Matrix_NonDia[ilss][jlss]->MatVec_Multi(
+                                          -1.0,ls.GetBatchVector(iv,jlss),1.0,ls.GetBatchVector(iv,ilss),true);
+		}
+		m_Matrix_Dia[ilss]->ForwardSubstitution(ls.GetBatchVector(iv,ilss));
+	}
+  // Backward Substitution
+	for(int ilss=(int)nlss-1;ilss>=0;ilss--){
+		for(unsigned int jlss=ilss+1;jlss<nlss;jlss++){
+      if( !m_Matrix_NonDia[ilss][jlss] ){ continue; }
+			m_Matrix_NonDia[ilss][jlss]->MatVec_Multi(
+                                          -1.0,ls.GetBatchVector(iv,jlss),1.0,ls.GetBatchVector(iv,ilss),true);
+		}
+		m_Matrix_Dia[ilss]->BackwardSubstitution(ls.GetBatchVector(iv,ilss));
+  }
+	return true;
+}
+
+
+////////////////////////////////////////////////////////////////
+
+void LsSol::CPreconditioner_AMG::SetLinearSystem(const CLinearSystem& ls)
+{
+  // the hierarchy depends on the value of the matrix, so it is made in SetValue
+  this->Clear();
+	if( ls.GetNLinSysSeg() != 1 || ls.GetMatrix(0).LenBlkCol() <= 0 ){
+		std::cout << "Error!-->Not Implemented" << std::endl;
+		assert(0);
+	}
+}
+
+bool LsSol::CPreconditioner_AMG::SetValue(const CLinearSystem& ls)
+{
+	if( ls.GetNLinSysSeg() != 1 || ls.GetMatrix(0).LenBlkCol() <= 0 ){
+		std::cout << "Error!-->Not Implemented" << std::endl;
+		assert(0);
+		return false;
+	}
+  const MatVec::CMatDia_BlkCrs& mat = ls.GetMatrix(0);
+  if( m_pMG != 0 && m_iver_ptn == mat.GetPatternVersion() ){
+    return m_pMG->SetValue(mat);  // only the value changed : the aggregates and the prolongation are kept
+  }
+  this->Clear();
+  const unsigned int nblk = mat.NBlkMatCol();
+  const unsigned int len = mat.LenBlkCol();
+  std::vector<double> aNull;
+  unsigned int nmode = 0;
+  if( m_ndim != 0 && m_aCoord.size() == nblk*m_ndim ){
+    nmode = MatVec::CSolverMG_SA::MakeRigidBodyMode(len,m_ndim,m_aCoord,aNull);
+  }
+  else{
+    std::vector<double> aCoord(nblk,0.0);
+    nmode = MatVec::CSolverMG_SA::MakeRigidBodyMode(len,1,aCoord,aNull);
+  }
+  m_pMG = new MatVec::CSolverMG_SA(mat,nmode,aNull);
+  m_iver_ptn = mat.GetPatternVersion();
+  m_pMG->SetCycleType(m_ncycle);
+  m_pMG->SetSmoothingNumberOfTimes(m_npre,m_npos);
+  return true;
+}
+
+bool LsSol::CPreconditioner_AMG::SolvePrecond(CLinearSystem& ls, unsigned int iv)
+{
+  if( m_pMG == 0 ) return false;
+  return m_pMG->SolvePrecond(ls.GetMatrix(0),ls.GetVector(iv,0));
+}
+
+
+////////////////////////////////////////////////////////////////
+
+// scalar crs (both triangles) of the whole linear system whose dofs are numbered segment by segment
+static bool MakeScalarCrs(const LsSol::CLinearSystem& ls, std::vector<unsigned int>& aOffset,
+                          std::vector<unsigned int>& aRowPtr, std::vector<unsigned int>& aColInd, std::vector<double>& aVal)
+{
+  const unsigned int nlss = ls.GetNLinSysSeg();
+  aOffset.resize(nlss+1);
+  aOffset[0] = 0;
+  for(unsigned int ilss=0;ilss<nlss;ilss++){
+    const MatVec::CMatDia_BlkCrs& mat = ls.GetMatrix(ilss);
+    if( mat.LenBlkCol() <= 0 ){
+      std::cout << "Error!-->Not Implemented" << std::endl;
+      assert(0);
+      return false;
+    }
+    aOffset[ilss+1] = aOffset[ilss] + mat.NBlkMatCol()*mat.LenBlkCol();
+  }
+  aRowPtr.resize(aOffset[nlss]+1);
+  aRowPtr[0] = 0;
+  aColInd.clear();
+  aVal.clear();
+  for(unsigned int ilss=0;ilss<nlss;ilss++){
+    const MatVec::CMatDia_BlkCrs& mat = ls.GetMatrix(ilss);
+    const unsigned int len = mat.LenBlkCol();
+    for(unsigned int iblk=0;iblk<mat.NBlkMatCol();iblk++){
+      for(unsigned int idof=0;idof<len;idof++){
+        {
+          const double* pdia = mat.GetPtrValDia(iblk);
+          for(unsigned int jdof=0;jdof<len;jdof++){
+            aColInd.push_back( aOffset[ilss]+iblk*len+jdof );
+            aVal.push_back( pdia[idof*len+jdof] );
+          }
+        }
+        for(unsigned int jlss=0;jlss<nlss;jlss++){
+          if( jlss != ilss && !ls.IsMatrix(ilss,jlss) ) continue;
+          const MatVec::CMat_BlkCrs& mat_ij = ( jlss == ilss ) ? mat : ls.GetMatrix(ilss,jlss);
+          const unsigned int lenj = mat_ij.LenBlkRow();
+          unsigned int npsup = 0;
+          const unsigned int* psup = mat_ij.GetPtrIndPSuP(iblk,npsup);
+          const double* pval = mat_ij.GetPtrValPSuP(iblk,npsup);
+          for(unsigned int ipsup=0;ipsup<npsup;ipsup++){
+            for(unsigned int jdof=0;jdof<lenj;jdof++){
+              aColInd.push_back( aOffset[jlss]+psup[ipsup]*lenj+jdof );
+              aVal.push_back( pval[(ipsup*len+idof)*lenj+jdof] );
+            }
+          }
+        }
+        aRowPtr[ aOffset[ilss]+iblk*len+idof+1 ] = aColInd.size();
+      }
+    }
+  }
+  return true;
+}
+
+void LsSol::CPreconditioner_LDLT::SetLinearSystem(const CLinearSystem& ls)
+{
+  std::vector<unsigned int> aVer;
+  GetPatternVersion(ls,aVer);
+  if( m_Frac.NDof() != 0 && aVer == m_aPatternVersion ) return;  // the symbolic factorization can be reused
+  this->Clear();
+  std::vector<unsigned int> aRowPtr, aColInd;
+  if( !MakeScalarCrs(ls,m_aOffset,aRowPtr,aColInd,m_aVal) ) return;
+  const unsigned int nlss = ls.GetNLinSysSeg();
+  // fill reducing ordering of the blocks in each segment (the dofs of a block stay together)
+  std::vector<unsigned int> aPerm;
+  aPerm.reserve(m_aOffset[nlss]);
+  for(unsigned int ilss=0;ilss<nlss;ilss++){
+    const MatVec::CMatDia_BlkCrs& mat = ls.GetMatrix(ilss);
+    const unsigned int len = mat.LenBlkCol();
+    MatVec::COrdering_Blk order;
+    if( m_is_nd ){ order.MakeOrdering_ND(mat); }
+    else{          order.MakeOrdering_AMD(mat); }
+    for(unsigned int iblk=0;iblk<mat.NBlkMatCol();iblk++){
+      const unsigned int iblk0 = order.NewToOld(iblk);
+      for(unsigned int idof=0;idof<len;idof++){ aPerm.push_back( m_aOffset[ilss]+iblk0*len+idof ); }
+    }
+  }
+  if( !m_Frac.MakePattern(m_aOffset[nlss],aRowPtr,aColInd,aPerm) ){ this->Clear(); return; }
+  m_aPatternVersion = aVer;
+}
+
+bool LsSol::CPreconditioner_LDLT::SetValue(const CLinearSystem& ls)
+{
+  this->SetLinearSystem(ls);
+  if( m_aOffset.empty() ) return false;
+  std::vector<unsigned int> aOffset, aRowPtr, aColInd;
+  if( !MakeScalarCrs(ls,aOffset,aRowPtr,aColInd,m_aVal) ) return false;
+  return m_Frac.SetValue(m_aVal);
+}
+
+bool LsSol::CPreconditioner_LDLT::SolvePrecond(CLinearSystem& ls, unsigned int iv)
+{
+  const unsigned int nlss = ls.GetNLinSysSeg();
+  if( m_aOffset.size() != nlss+1 ) return false;
+  m_aTmp.resize(m_aOffset[nlss]);
+  for(unsigned int ilss=0;ilss<nlss;ilss++){
+    const MatVec::CVector_Blk& vec = ls.GetVector(iv,ilss);
+    const unsigned int len = vec.Len();
+    for(unsigned int iblk=0;iblk<vec.NBlk();iblk++){
+      for(unsigned int idof=0;idof<len;idof++){
+        m_aTmp[ m_aOffset[ilss]+iblk*len+idof ] = vec.GetValue(iblk,idof);
+      }
+    }
+  }
+  m_Frac.Solve(m_aTmp);
+  for(unsigned int ilss=0;ilss<nlss;ilss++){
+    MatVec::CVector_Blk& vec = ls.GetVector(iv,ilss);
+    const unsigned int len = vec.Len();
+    for(unsigned int iblk=0;iblk<vec.NBlk();iblk++){
+      for(unsigned int idof=0;idof<len;idof++){
+        vec.SetValue(iblk,idof, m_aTmp[ m_aOffset[ilss]+iblk*len+idof ] );
+      }
+    }
+  }
+  return true;
+}
+
+
+
+////////////////////////////////////////////////////////////////
+// block Jacobi and the polynomial preconditioners
+
+// working vectors of the size of the segments of ls
+static void MakeVectorSeg(const LsSol::CLinearSystem& ls, std::vector<MatVec::CVector_Blk*>& aVec)
+{
+	const unsigned int nlss = ls.GetNLinSysSeg();
+	aVec.resize(nlss,0);
+	for(unsigned int ilss=0;ilss<nlss;ilss++){
+		const MatVec::CMatDia_BlkCrs& mat = ls.GetMatrix(ilss);
+		aVec[ilss] = new MatVec::CVector_Blk(mat.NBlkMatCol(),mat.LenBlkCol());
+		aVec[ilss]->SetVectorZero();
+	}
+}
+
+static void DeleteVectorSeg(std::vector<MatVec::CVector_Blk*>& aVec)
+{
+	for(unsigned int ivec=0;ivec<aVec.size();ivec++){ delete aVec[ivec]; }
+	aVec.clear();
+}
+
+// the segments of the vector iv of ls
+static void GetVectorSeg(LsSol::CLinearSystem& ls, int iv, std::vector<MatVec::CVector_Blk*>& aVec)
+{
+	const unsigned int nlss = ls.GetNLinSysSeg();
+	aVec.resize(nlss);
+	for(unsigned int ilss=0;ilss<nlss;ilss++){ aVec[ilss] = &ls.GetVector(iv,ilss); }
+}
+
+void LsSol::CPreconditioner_BlockJacobi::Clear()
+{
+	for(unsigned int ilss=0;ilss<m_aInvDia.size();ilss++){ delete m_aInvDia[ilss]; }
+	m_aInvDia.clear();
+	DeleteVectorSeg(m_aTmp);
+}
+
+void LsSol::CPreconditioner_BlockJacobi::SetLinearSystem(const CLinearSystem& ls)
+{
+	this->Clear();
+	const unsigned int nlss = ls.GetNLinSysSeg();
+	for(unsigned int ilss=0;ilss<nlss;ilss++){
+		const MatVec::CMatDia_BlkCrs& mat = ls.GetMatrix(ilss);
+		if( mat.LenBlkCol() <= 0 ){
+			std::cout << "Error!-->Not Implemented" << std::endl;
+			assert(0);
+			this->Clear();
+			return;
+		}
+		m_aInvDia.push_back( new MatVec::CMatDiaInv_BlkDia(mat.NBlkMatCol(),mat.LenBlkCol()) );
+	}
+	MakeVectorSeg(ls,m_aTmp);
+}
+
+bool LsSol::CPreconditioner_BlockJacobi::SetValue(const CLinearSystem& ls)
+{
+	const unsigned int nlss = ls.GetNLinSysSeg();
+	if( m_aInvDia.size() != nlss ) return false;
+	for(unsigned int ilss=0;ilss<nlss;ilss++){
+		const MatVec::CMatDia_BlkCrs& mat = ls.GetMatrix(ilss);
+		if( m_aInvDia[ilss]->NBlkMatCol() != mat.NBlkMatCol() ) return false;
+		if( m_aInvDia[ilss]->SetValue(mat) != 0 ) return false;
+	}
+	return true;
+}
+
+void LsSol::CPreconditioner_BlockJacobi::MultInvDia(const std::vector<MatVec::CVector_Blk*>& x, std::vector<MatVec::CVector_Blk*>& y) const
+{
+	assert( x.size() == m_aInvDia.size() );
+	assert( y.size() == m_aInvDia.size() );
+	for(unsigned int ilss=0;ilss<m_aInvDia.size();ilss++){
+		m_aInvDia[ilss]->MatVec(1.0,*x[ilss],0.0,*y[ilss]);
+	}
+}
+
+bool LsSol::CPreconditioner_BlockJacobi::SolvePrecond(CLinearSystem& ls, unsigned int iv)
+{
+	const unsigned int nlss = ls.GetNLinSysSeg();
+	if( m_aInvDia.size() != nlss ) return false;
+	std::vector<MatVec::CVector_Blk*> aR;
+	GetVectorSeg(ls,iv,aR);
+	for(unsigned int ilss=0;ilss<nlss;ilss++){ (*m_aTmp[ilss]) = (*aR[ilss]); }
+	this->MultInvDia(m_aTmp,aR);
+	return true;
+}
+
+////////////////
+
+void LsSol::CPreconditioner_Chebyshev::Clear()
+{
+	m_Jacobi.Clear();
+	DeleteVectorSeg(m_aX);
+	DeleteVectorSeg(m_aD);
+	DeleteVectorSeg(m_aW);
+	DeleteVectorSeg(m_aZ);
+	m_max_eigen = 0.0;
+}
+
+void LsSol::CPreconditioner_Chebyshev::SetLinearSystem(const CLinearSystem& ls)
+{
+	this->Clear();
+	m_Jacobi.SetLinearSystem(ls);
+	MakeVectorSeg(ls,m_aX);
+	MakeVectorSeg(ls,m_aD);
+	MakeVectorSeg(ls,m_aW);
+	MakeVectorSeg(ls,m_aZ);
+}
+
+bool LsSol::CPreconditioner_Chebyshev::SetValue(const CLinearSystem& ls)
+{
+	if( !m_Jacobi.SetValue(ls) ) return false;
+	// the Lanczos estimate is from below, so it is enlarged a little to cover the spectrum
+	m_max_eigen = 1.1*LsSol::MaximumEigenValue_Lanczos(ls,m_Jacobi.GetInvDia(),m_nlanczos);
+	return ( m_max_eigen > 0.0 );
+}
+
+// Chebyshev iteration (Y. Saad, Iterative Methods for Sparse Linear Systems, Algorithm 12.1) started from {x}=0
+void LsSol::SolvePrecond_Chebyshev(ILinearOperator_Seg& op, unsigned int ndeg, double eig_max, double ratio,
+	std::vector<MatVec::CVector_Blk*>& aR,
+	std::vector<MatVec::CVector_Blk*>& aX, std::vector<MatVec::CVector_Blk*>& aD, 
+	std::vector<MatVec::CVector_Blk*>& aW, std::vector<MatVec::CVector_Blk*>& aZ)
+{
+	const unsigned int nlss = aR.size();
+	const double eig_min = eig_max/ratio;
+	const double theta = (eig_max+eig_min)*0.5;
+	const double delta = (eig_max-eig_min)*0.5;
+	const double sigma = theta/delta;
+	double rho = 1.0/sigma;
+	op.MultInvDia_Seg(aR,aD);
+	for(unsigned int ilss=0;ilss<nlss;ilss++){
+		(*aD[ilss]) *= 1.0/theta;
+		(*aX[ilss]) = (*aD[ilss]);
+	}
+	for(unsigned int ideg=1;ideg<ndeg;ideg++){
+		// {w} = {r}-[A]{x}
+		for(unsigned int ilss=0;ilss<nlss;ilss++){ (*aW[ilss]) = (*aR[ilss]); }
+		op.MatVec_Seg(-1.0,aX,1.0,aW);
+		op.MultInvDia_Seg(aW,aZ);
+		const double rho1 = 1.0/(2.0*sigma-rho);
+		for(unsigned int ilss=0;ilss<nlss;ilss++){
+			aD[ilss]->AXPBY(2.0*rho1/delta,*aZ[ilss],rho1*rho);
+			aX[ilss]->AXPY(1.0,*aD[ilss]);
+		}
+		rho = rho1;
+	}
+	for(unsigned int ilss=0;ilss<nlss;ilss++){ (*aR[ilss]) = (*aX[ilss]); }
+}
+
+bool LsSol::CPreconditioner_Chebyshev::SolvePrecond(CLinearSystem& ls, unsigned int iv)
+{
+	const unsigned int nlss = ls.GetNLinSysSeg();
+	if( m_aX.size() != nlss || m_max_eigen <= 0.0 ) return false;
+	std::vector<MatVec::CVector_Blk*> aR;
+	GetVectorSeg(ls,iv,aR);
+	CLinearOperator_BlockJacobi op(ls,m_Jacobi.GetInvDia());
+	LsSol::SolvePrecond_Chebyshev(op,m_ndeg,m_max_eigen,m_ratio,aR,m_aX,m_aD,m_aW,m_aZ);
+	return true;
+}
+
+////////////////
+
+void LsSol::CPreconditioner_Neumann::Clear()
+{
+	m_Jacobi.Clear();
+	DeleteVectorSeg(m_aX);
+	DeleteVectorSeg(m_aW);
+	DeleteVectorSeg(m_aZ);
+}
+
+void LsSol::CPreconditioner_Neumann::SetLinearSystem(const CLinearSystem& ls)
+{
+	this->Clear();
+	m_Jacobi.SetLinearSystem(ls);
+	MakeVectorSeg(ls,m_aX);
+	MakeVectorSeg(ls,m_aW);
+	MakeVectorSeg(ls,m_aZ);
+}
+
+bool LsSol::CPreconditioner_Neumann::SetValue(const CLinearSystem& ls)
+{
+	if( !m_Jacobi.SetValue(ls) ) return false;
+	if( m_omega_input > 0.0 ){ m_omega = m_omega_input; return true; }
+	if( m_ndeg == 1 ){ m_omega = 1.0; return true; }	// block Jacobi (the scale does not matter)
+	const double eig_max = 1.1*LsSol::MaximumEigenValue_Lanczos(ls,m_Jacobi.GetInvDia(),m_nlanczos);
+	if( eig_max <= 0.0 ) return false;
+	m_omega = 1.6/eig_max;	// well inside (0,2/lambda_max) and damps the large eigen values faster than 1/lambda_max
+	return true;
+}
+
+// {x} := omega*[D]^-1{r}, then {x} += omega*[D]^-1({r}-[A]{x}) (ndeg-1) times
+bool LsSol::CPreconditioner_Neumann::SolvePrecond(CLinearSystem& ls, unsigned int iv)
+{
+	const unsigned int nlss = ls.GetNLinSysSeg();
+	if( m_aX.size() != nlss ) return false;
+	std::vector<MatVec::CVector_Blk*> aR;
+	GetVectorSeg(ls,iv,aR);
+
+	m_Jacobi.MultInvDia(aR,m_aX);
+	for(unsigned int ilss=0;ilss<nlss;ilss++){ (*m_aX[ilss]) *= m_omega; }
+	for(unsigned int ideg=1;ideg<m_ndeg;ideg++){
+		for(unsigned int ilss=0;ilss<nlss;ilss++){ (*m_aW[ilss]) = (*aR[ilss]); }
+		ls.MatVec_Seg(-1.0,m_aX,1.0,m_aW);
+		m_Jacobi.MultInvDia(m_aW,m_aZ);
+		for(unsigned int ilss=0;ilss<nlss;ilss++){ m_aX[ilss]->AXPY(m_omega,*m_aZ[ilss]); }
+	}
+	for(unsigned int ilss=0;ilss<nlss;ilss++){ (*aR[ilss]) = (*m_aX[ilss]); }
+	return true;
+}
@@ -19,9 +19,14 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 
 #include <iostream>
 #include <math.h>
+#include <vector>
+#include <algorithm>
 
 #include "delfem/ls/solver_ls_iter.h"
 #include "delfem/ls/linearsystem_interface_solver.h"
+#include "delfem/ls/linearsystem.h"
+#include "delfem/ls/preconditioner.h"
+#include "delfem/ls/eigen_lanczos.h"
 
 using namespace LsSol;
 
@@ -61,8 +66,7 @@ bool LsSol::Solve_CG(double& conv_ratio, unsigned int& num_iter, LsSol::ILinearS
 
 		double alpha;
 		{	// alpha = (r,r) / (p,Ap)
-			ls.MATVEC(1.0,ip,0.0,iAp);
-			const double pAp = ls.DOT(ip,iAp);
+			const double pAp = ls.MATVEC_DOT(1.0,ip,0.0,iAp);
 			alpha = sq_norm_res / pAp;
 		}
 
@@ -70,12 +74,9 @@ bool LsSol::Solve_CG(double& conv_ratio, unsigned int& num_iter, LsSol::ILinearS
 		// x = x + alpha*p
 		ls.AXPY(alpha,ip,ix);
 
-		// update residual
+		// update residual and calc its norm
 		// r = r - alpha*Ap
-		ls.AXPY(-alpha,iAp,ir);
-
-		// calc residual 
-		const double sq_norm_res_new = ls.DOT(ir,ir);
+		const double sq_norm_res_new = ls.AXPY_DOT(-alpha,iAp,ir);
 //		std::cout << num_iter << " " << sqrt( sq_norm_res_new*sq_inv_norm_res_ini ) << std::endl;
 		if( sq_norm_res_new*sq_inv_norm_res_ini < tolerance*tolerance ){
 			conv_ratio = sqrt( sq_norm_res_new*sq_inv_norm_res_ini );
@@ -90,26 +91,27 @@ bool LsSol::Solve_CG(double& conv_ratio, unsigned int& num_iter, LsSol::ILinearS
 
 		// update direction
 		// {p} = {r}+beta*{p}
-		ls.SCAL(beta,ip);
-		ls.AXPY(1.0,ir,ip);
+		ls.AXPBY(1.0,ir,beta,ip);
 	}
 	return true;
 }
 
 
 bool LsSol::Solve_PCG(double& conv_ratio, unsigned int& iteration,
-                LsSol::ILinearSystemPreconditioner_Sol& ls)
+                LsSol::ILinearSystemPreconditioner_Sol& ls, bool is_refine)
 {
 
 	const double conv_ratio_tol = conv_ratio;
 	const unsigned int mx_iter = iteration;
 
-	if( ls.GetTmpVectorArySize() < 2 ){ ls.ReSizeTmpVecSolver(2); }
+	const unsigned int ntmp = ( is_refine ) ? 3 : 2;
+	if( ls.GetTmpVectorArySize() < ntmp ){ ls.ReSizeTmpVecSolver(ntmp); }
 
 	const int ix  = -2;
 	const int ir  = -1;
 	const int ip  =  0;
 	const int iz  =  1;
+	const int ib  =  2;	// right hand side kept for the refinement
 
 	// x = 0.0
 	ls.SCAL(0.0,ix);
@@ -124,6 +126,7 @@ bool LsSol::Solve_PCG(double& conv_ratio, unsigned int& iteration,
 		}
 		sq_inv_norm_res0 = 1.0 / sq_norm_res0;
 	}
+	if( is_refine ){ ls.COPY(ir,ib); }
 
 	ls.COPY(ir,iz);
 	ls.SolvePrecond(iz);
@@ -135,21 +138,37 @@ bool LsSol::Solve_PCG(double& conv_ratio, unsigned int& iteration,
 
 		double alpha;
 		{	// calc alpha
-			ls.MATVEC(1.0,ip,0.0,iz);
-			const double val_pAp = ls.DOT(ip,iz);
+			const double val_pAp = ls.MATVEC_DOT(1.0,ip,0.0,iz);
 			alpha = inpro_rz / val_pAp;
 		}
 
-		ls.AXPY(-alpha,iz,ir);
+		const double sq_norm_res = ls.AXPY_DOT(-alpha,iz,ir);
 		ls.AXPY(alpha,ip,ix);	// Converge Judgement̑Oɓ
 
 		{	// Converge Judgement
-			double sq_norm_res = ls.DOT(ir,ir);
 //			std::cout << iitr << " " << sqrt(sq_norm_res * sq_inv_norm_res0) << std::endl;
 			if( sq_norm_res * sq_inv_norm_res0 < conv_ratio_tol*conv_ratio_tol ){
-				conv_ratio = sqrt( sq_norm_res * sq_inv_norm_res0 );
-				iteration = iitr;
-				return true;
+				if( !is_refine ){
+					conv_ratio = sqrt( sq_norm_res * sq_inv_norm_res0 );
+					iteration = iitr;
+					return true;
+				}
+				// iterative refinement : the updated residual drifts from the true one 
+				// (e.g. with the preconditioner in single precision), so check {b}-[A]{x}
+				ls.COPY(ib,ir);
+				ls.MATVEC(-1.0,ix,1.0,ir);
+				const double sq_norm_res_true = ls.DOT(ir,ir);
+				if( sq_norm_res_true * sq_inv_norm_res0 < conv_ratio_tol*conv_ratio_tol ){
+					conv_ratio = sqrt( sq_norm_res_true * sq_inv_norm_res0 );
+					iteration = iitr;
+					return true;
+				}
+				// restart from the true residual
+				ls.COPY(ir,iz);
+				ls.SolvePrecond(iz);
+				ls.COPY(iz,ip);
+				inpro_rz = ls.DOT(ir,iz);
+				continue;
 			}
 		}
 
@@ -162,8 +181,7 @@ bool LsSol::Solve_PCG(double& conv_ratio, unsigned int& iteration,
 			inpro_rz = inpro_rz_new;
 		}
 
-		ls.SCAL(beta,ip);
-		ls.AXPY(1.0,iz,ip);
+		ls.AXPBY(1.0,iz,beta,ip);
 	}
 	// Converge Judgement
   double sq_norm_res = ls.DOT(ir,ir);
@@ -239,10 +257,12 @@ bool LsSol::Solve_BiCGSTAB(double& conv_ratio, unsigned int& num_iter,
 		// calc omega
 		// omega = ({As},{s}) / ({As},{As})
 		double omega;
-		{
-			const double denominator = ls.DOT(iAs,iAs);
-			const double numerator = ls.DOT(iAs,is);
-			omega = numerator / denominator;
+		{	// both dot products in one sweep
+			const int aiv1[2] = { iAs, iAs };
+			const int aiv2[2] = { iAs, is  };
+			double adot[2];
+			ls.DOTS(2,aiv1,aiv2,adot);
+			omega = adot[1] / adot[0];
 		}
 
 		// update solution
@@ -255,8 +275,15 @@ bool LsSol::Solve_BiCGSTAB(double& conv_ratio, unsigned int& num_iter,
 		ls.COPY(is,ir);
 		ls.AXPY(-omega,iAs,ir);
 
+		// ({r},{r}) and ({r},{r2}) in one sweep
+		double r_r2_new;
 		{
-			const double sq_norm_res = ls.DOT(ir,ir);
+			const int aiv1[2] = { ir, ir  };
+			const int aiv2[2] = { ir, ir2 };
+			double adot[2];
+			ls.DOTS(2,aiv1,aiv2,adot);
+			r_r2_new = adot[1];
+			const double sq_norm_res = adot[0];
 			const double sq_conv_ratio = sq_norm_res * sq_inv_norm_res_ini;
 			std::cout << iitr << " " << sq_norm_res << " " << sqrt(sq_conv_ratio) << " " << sqrt(sq_norm_res) << std::endl;
 			if( sq_conv_ratio < tolerance*tolerance ){
@@ -270,15 +297,13 @@ bool LsSol::Solve_BiCGSTAB(double& conv_ratio, unsigned int& num_iter,
 		// beta = ({r},{r2})^new/({r},{r2})^old * alpha / omega
 		double beta;
 		{
-			const double tmp1 = ls.DOT(ir,ir2);
-			beta = (tmp1*alpha) / (r_r2*omega);
-			r_r2 = tmp1;
+			beta = (r_r2_new*alpha) / (r_r2*omega);
+			r_r2 = r_r2_new;
 		}
 
 		// update p_vector
 		// {p} = {r} + beta*({p}-omega*[A]*{p})
-		ls.SCAL(beta,ip);
-		ls.AXPY(1.0,ir,ip);
+		ls.AXPBY(1.0,ir,beta,ip);
 		ls.AXPY(-beta*omega,iAp,ip);
 	}
 
@@ -324,6 +349,9 @@ bool LsSol::Solve_PBiCGSTAB(double& conv_ratio, unsigned int& num_iter,
 	// {p} = {r}
 	ls.COPY(ir,ip);
 
+	// calc (r,r0*)
+	double r_r2 = ls.DOT(ir,ir2);
+
 	num_iter = max_iter;
 	for(unsigned int iitr=1;iitr<max_iter;iitr++)
 	{
@@ -331,9 +359,6 @@ bool LsSol::Solve_PBiCGSTAB(double& conv_ratio, unsigned int& num_iter,
 		ls.COPY(ip,iMp);
 		ls.SolvePrecond(iMp);
 
-		// calc (r,r0*)
-		const double r_r2 = ls.DOT(ir,ir2);
-
 //        std::cout << "r_r2 : " << r_r2 << std::endl;   
 
 		// calc {AMp_vec} = [A]*{Mp_vec}
@@ -364,9 +389,13 @@ bool LsSol::Solve_PBiCGSTAB(double& conv_ratio, unsigned int& num_iter,
 		ls.MATVEC(1.0,iMs,0.0,iAMs);
 
 		double omega;
-		{	// calc omega
-			const double denominator = ls.DOT(iAMs,iAMs);
-			const double numerator = ls.DOT(is,iAMs);
+		{	// calc omega (both dot products in one sweep)
+			const int aiv1[2] = { iAMs, is   };
+			const int aiv2[2] = { iAMs, iAMs };
+			double adot[2];
+			ls.DOTS(2,aiv1,aiv2,adot);
+			const double denominator = adot[0];
+			const double numerator = adot[1];
 //            std::cout << "Omega0 : " << denominator << " " << numerator << std::endl;
 			omega = numerator / denominator;
 		}
@@ -381,8 +410,15 @@ bool LsSol::Solve_PBiCGSTAB(double& conv_ratio, unsigned int& num_iter,
 		ls.COPY(is,ir);
 		ls.AXPY(-omega,iAMs,ir);
 
+		// ({r},{r}) and ({r},{r2}) in one sweep
+		double r_r2_new;
 		{
-			const double sq_norm_res = ls.DOT(ir,ir);
+			const int aiv1[2] = { ir, ir  };
+			const int aiv2[2] = { ir, ir2 };
+			double adot[2];
+			ls.DOTS(2,aiv1,aiv2,adot);
+			r_r2_new = adot[1];
+			const double sq_norm_res = adot[0];
 			const double sq_conv_ratio = sq_norm_res * sq_inv_norm_res_ini;
 //			std::cout << iitr << " " << sqrt(sq_conv_ratio) << " " << sqrt(sq_norm_res) << std::endl;
 			if( sq_conv_ratio < conv_ratio_tol * conv_ratio_tol ){
@@ -394,16 +430,880 @@ bool LsSol::Solve_PBiCGSTAB(double& conv_ratio, unsigned int& num_iter,
 
 		double beta;
 		{	// calc beta
-			const double tmp1 = ls.DOT(ir,ir2);
-			beta = tmp1 * alpha / (r_r2*omega);
+			beta = r_r2_new * alpha / (r_r2*omega);
+			r_r2 = r_r2_new;
 		}
 
 		// update p_vector
-		ls.SCAL(beta,ip);
-		ls.AXPY(1.0,ir,ip);
+		ls.AXPBY(1.0,ir,beta,ip);
 		ls.AXPY(-beta*omega,iAMp,ip);
 	}
 
 	return true;
 }
 
+////////////////////////////////////////////////////////////////
+// Solve Matrix with restarted GMRES Methods (right preconditioning)
+// (Y. Saad, "Iterative methods for sparse linear systems", Algorithm 9.5 and 9.6)
+////////////////////////////////////////////////////////////////
+
+// orthogonalize {w} to {v[0]}...{v[n-1]} by classical Gram-Schmidt (twice if the norm drops less than 1/sqrt(2))
+// h[i] : the coefficients, return the norm of the orthogonalized {w}
+static double OrthogonalizeCGS(LsSol::ILinearSystemPreconditioner_Sol& ls, 
+	unsigned int n, const int* aiv, int iw, double* h)
+{
+	std::vector<int> aiv1(aiv,aiv+n), aiv2(n+1,iw);
+	aiv1.push_back(iw);	// the norm of {w} is taken in the same reduction
+	std::vector<double> adot(n+1), aalpha(n);
+	for(unsigned int i=0;i<n;i++){ h[i] = 0.0; }
+	double sq_norm = 0.0;
+	for(unsigned int ipass=0;ipass<2;ipass++){
+		ls.DOTS(n+1,&aiv1[0],&aiv2[0],&adot[0]);
+		double sq_norm_proj = 0.0;
+		for(unsigned int i=0;i<n;i++){
+			h[i] += adot[i];
+			aalpha[i] = -adot[i];
+			sq_norm_proj += adot[i]*adot[i];
+		}
+		ls.AXPY_MULTI(n,&aalpha[0],aiv,iw);
+		sq_norm = adot[n] - sq_norm_proj;
+		if( sq_norm > 0.5*adot[n] ) break;	// no cancellation
+	}
+	return ( sq_norm > 0.0 ) ? sqrt(sq_norm) : 0.0;
+}
+
+static bool Solve_GMRES_Restart(double& conv_ratio, unsigned int& iteration, 
+	LsSol::ILinearSystemPreconditioner_Sol& ls, unsigned int nrestart, bool is_flexible)
+{
+	const double conv_ratio_tol = conv_ratio;
+	const unsigned int mx_iter = iteration;
+	const unsigned int m = ( nrestart == 0 ) ? 1 : nrestart;
+
+	const int ix = -2;
+	const int ir = -1;
+	const int ib = m+1;	// right hand side
+	const int iw = m+2;	// work vector (GMRES) or the first preconditioned vector (FGMRES)
+	std::vector<int> aiV(m+1), aiZ(m);	// Arnoldi vectors and the preconditioned ones
+	for(unsigned int i=0;i<m+1;i++){ aiV[i] = i; }
+	for(unsigned int i=0;i<m;i++){ aiZ[i] = ( is_flexible ) ? iw+i : iw; }
+	{
+		const unsigned int nvec = ( is_flexible ) ? 2*m+2 : m+3;
+		if( ls.GetTmpVectorArySize() < nvec ){ ls.ReSizeTmpVecSolver(nvec); }
+	}
+
+	ls.SCAL(0.0,ix);
+
+	double sq_inv_norm_res_ini;
+	{
+		const double sq_norm_res_ini = ls.DOT(ir,ir);
+		if( sq_norm_res_ini < 1.0e-60 ){
+			conv_ratio = sqrt( sq_norm_res_ini );
+			iteration = 0;
+			return true;
+		}
+		sq_inv_norm_res_ini = 1.0 / sq_norm_res_ini;
+	}
+	ls.COPY(ir,ib);
+
+	std::vector<double> h((m+1)*m);	// Hessenberg matrix h[i*m+j] (upper triangular after the rotation)
+	std::vector<double> g(m+1), c(m), s(m), y(m);
+	unsigned int iitr = 0;
+	for(;;){	// restart cycle
+		const double norm_res = sqrt( ls.DOT(ir,ir) );
+		if( norm_res*norm_res * sq_inv_norm_res_ini < conv_ratio_tol*conv_ratio_tol ){
+			conv_ratio = norm_res * sqrt(sq_inv_norm_res_ini);
+			iteration = iitr;
+			return true;
+		}
+		if( iitr >= mx_iter ){
+			conv_ratio = norm_res * sqrt(sq_inv_norm_res_ini);
+			iteration = iitr;
+			return false;
+		}
+		ls.COPY(ir,aiV[0]);
+		ls.SCAL(1.0/norm_res,aiV[0]);
+		for(unsigned int i=0;i<m+1;i++){ g[i] = 0.0; }
+		g[0] = norm_res;
+		unsigned int k = 0;	// dimension of the subspace
+		for(;k<m && iitr<mx_iter;){
+			const unsigned int j = k;
+			// {v[j+1]} = [A][M^-1]{v[j]}
+			ls.COPY(aiV[j],aiZ[j]);
+			ls.SolvePrecond(aiZ[j]);
+			ls.MATVEC(1.0,aiZ[j],0.0,aiV[j+1]);
+			std::vector<double> hj(j+2);
+			hj[j+1] = OrthogonalizeCGS(ls,j+1,&aiV[0],aiV[j+1],&hj[0]);
+			if( hj[j+1] > 1.0e-300 ){ ls.SCAL(1.0/hj[j+1],aiV[j+1]); }
+			// apply the previous rotations
+			for(unsigned int i=0;i<j;i++){
+				const double h0 =  c[i]*hj[i] + s[i]*hj[i+1];
+				const double h1 = -s[i]*hj[i] + c[i]*hj[i+1];
+				hj[i] = h0;
+				hj[i+1] = h1;
+			}
+			{	// new rotation to eliminate hj[j+1]
+				const double denom = sqrt( hj[j]*hj[j] + hj[j+1]*hj[j+1] );
+				if( denom < 1.0e-300 ){ c[j] = 1.0; s[j] = 0.0; }
+				else{ c[j] = hj[j]/denom; s[j] = hj[j+1]/denom; }
+				hj[j] = c[j]*hj[j] + s[j]*hj[j+1];
+				hj[j+1] = 0.0;
+				g[j+1] = -s[j]*g[j];
+				g[j]   =  c[j]*g[j];
+			}
+			for(unsigned int i=0;i<j+1;i++){ h[i*m+j] = hj[i]; }
+			k++;
+			iitr++;
+			const double sq_conv_ratio = g[k]*g[k] * sq_inv_norm_res_ini;
+//			std::cout << iitr << " " << sqrt(sq_conv_ratio) << std::endl;
+			if( sq_conv_ratio < conv_ratio_tol*conv_ratio_tol ) break;
+			if( hj[j] == 0.0 ) break;	// singular
+		}
+		// y = [H]^-1 {g}
+		for(int i=(int)k-1;i>=0;i--){
+			double d = g[i];
+			for(unsigned int l=i+1;l<k;l++){ d -= h[i*m+l]*y[l]; }
+			y[i] = ( h[i*m+i] != 0.0 ) ? d/h[i*m+i] : 0.0;
+		}
+		// {x} += [M^-1][V]{y} (GMRES), {x} += [Z]{y} (FGMRES)
+		if( is_flexible ){
+			ls.AXPY_MULTI(k,&y[0],&aiZ[0],ix);
+		}
+		else{
+			ls.SCAL(0.0,iw);
+			ls.AXPY_MULTI(k,&y[0],&aiV[0],iw);
+			ls.SolvePrecond(iw);
+			ls.AXPY(1.0,iw,ix);
+		}
+		// true residual
+		ls.COPY(ib,ir);
+		ls.MATVEC(-1.0,ix,1.0,ir);
+	}
+	return false;
+}
+
+bool LsSol::Solve_PGMRES(double& conv_ratio, unsigned int& iteration, 
+		LsSol::ILinearSystemPreconditioner_Sol& ls, unsigned int nrestart)
+{
+	return Solve_GMRES_Restart(conv_ratio,iteration,ls,nrestart,false);
+}
+
+bool LsSol::Solve_PFGMRES(double& conv_ratio, unsigned int& iteration, 
+		LsSol::ILinearSystemPreconditioner_Sol& ls, unsigned int nrestart)
+{
+	return Solve_GMRES_Restart(conv_ratio,iteration,ls,nrestart,true);
+}
+
+////////////////////////////////////////////////////////////////
+// Solve Matrix with pipelined PCG Methods
+// (P. Ghysels and W. Vanroose, "Hiding global synchronization latency in the preconditioned conjugate gradient algorithm")
+////////////////////////////////////////////////////////////////
+bool LsSol::Solve_PCG_Pipelined(double& conv_ratio, unsigned int& iteration,
+                LsSol::ILinearSystemPreconditioner_Sol& ls)
+{
+	const double conv_ratio_tol = conv_ratio;
+	const unsigned int mx_iter = iteration;
+
+	if( ls.GetTmpVectorArySize() < 8 ){ ls.ReSizeTmpVecSolver(8); }
+
+	const int ix = -2;
+	const int ir = -1;
+	const int iu = 0;	// [M^-1]{r}
+	const int iw = 1;	// [A]{u}
+	const int im = 2;	// [M^-1]{w}
+	const int in = 3;	// [A]{m}
+	const int ip = 4;
+	const int is = 5;	// [A]{p}
+	const int iq = 6;	// [M^-1]{s}
+	const int iz = 7;	// [A]{q}
+
+	// x = 0.0
+	ls.SCAL(0.0,ix);
+
+	ls.COPY(ir,iu);
+	ls.SolvePrecond(iu);
+	ls.MATVEC(1.0,iu,0.0,iw);
+
+	double sq_inv_norm_res0 = 0;
+	double gamma_old = 0, alpha = 0;
+	for(unsigned int iitr=0;iitr<mx_iter;iitr++){
+		double gamma, delta, sq_norm_res;
+		{	// the only global reduction of the iteration
+			const int aiv1[3] = { ir, iw, ir };
+			const int aiv2[3] = { iu, iu, ir };
+			double adot[3];
+			ls.DOTS(3,aiv1,aiv2,adot);
+			gamma = adot[0];
+			delta = adot[1];
+			sq_norm_res = adot[2];
+		}
+		if( iitr == 0 ){
+			if( sq_norm_res < 1.0e-30 ){
+				conv_ratio = 0.0;
+				iteration = 0;
+				return true;
+			}
+			sq_inv_norm_res0 = 1.0 / sq_norm_res;
+		}
+		else if( sq_norm_res * sq_inv_norm_res0 < conv_ratio_tol*conv_ratio_tol ){	// Converge Judgement
+			conv_ratio = sqrt( sq_norm_res * sq_inv_norm_res0 );
+			iteration = iitr;
+			return true;
+		}
+
+		// {m} = [M^-1]{w},  {n} = [A]{m}  (they do not need the dot products above, but DOTS has already finished)
+		ls.COPY(iw,im);
+		ls.SolvePrecond(im);
+		ls.MATVEC(1.0,im,0.0,in);
+
+		if( iitr == 0 ){
+			alpha = gamma / delta;
+			ls.COPY(in,iz);
+			ls.COPY(im,iq);
+			ls.COPY(iw,is);
+			ls.COPY(iu,ip);
+		}
+		else{
+			const double beta = gamma / gamma_old;
+			alpha = gamma / ( delta - beta*gamma/alpha );
+			ls.AXPBY(1.0,in,beta,iz);
+			ls.AXPBY(1.0,im,beta,iq);
+			ls.AXPBY(1.0,iw,beta,is);
+			ls.AXPBY(1.0,iu,beta,ip);
+		}
+		gamma_old = gamma;
+
+		ls.AXPY( alpha,ip,ix);
+		ls.AXPY(-alpha,is,ir);
+		ls.AXPY(-alpha,iq,iu);
+		ls.AXPY(-alpha,iz,iw);
+	}
+	// Converge Judgement
+	const double sq_norm_res = ls.DOT(ir,ir);
+	conv_ratio = sqrt( sq_norm_res * sq_inv_norm_res0 );
+	return false;
+}
+
+
+////////////////////////////////////////////////////////////////
+// Solve several right hand sides at once
+////////////////////////////////////////////////////////////////
+
+bool LsSol::Solve_PCG_Batch(double& conv_ratio, unsigned int& iteration,
+                LsSol::CLinearSystem& ls, LsSol::CPreconditioner_ILU& precond)
+{
+	const double conv_ratio_tol = conv_ratio;
+	const unsigned int mx_iter = iteration;
+	const unsigned int nrhs = ls.NBatch();
+
+	if( ls.GetTmpVecBatchSize() < 3 ){ ls.ReSizeTmpVecBatch(3); }
+
+	const int ix  = -2;
+	const int ir  = -1;
+	const int ip  =  0;
+	const int iAp =  1;
+	const int iz  =  2;
+
+	std::vector<double> aZero(nrhs,0.0), aOne(nrhs,1.0);
+	ls.SCAL_Batch(&aZero[0],ix);
+
+	std::vector<double> aDot(nrhs);
+	std::vector<double> aSqInvNormResIni(nrhs);
+	std::vector<bool> aIsConv(nrhs,false);
+	unsigned int nconv = 0;
+	conv_ratio = 0.0;
+	{
+		ls.DOT_Batch(ir,ir,&aDot[0]);
+		for(unsigned int irhs=0;irhs<nrhs;irhs++){
+			if( aDot[irhs] < 1.0e-30 ){ aIsConv[irhs] = true; nconv++; aSqInvNormResIni[irhs] = 0.0; }
+			else{ aSqInvNormResIni[irhs] = 1.0 / aDot[irhs]; }
+		}
+		if( nconv == nrhs ){
+			iteration = 0;
+			return true;
+		}
+	}
+
+	ls.COPY_Batch(ir,iz);
+	precond.SolvePrecond_Batch(ls,iz);
+	ls.COPY_Batch(iz,ip);
+
+	std::vector<double> aRZ(nrhs);
+	ls.DOT_Batch(ir,iz,&aRZ[0]);
+
+	std::vector<double> aAlpha(nrhs), aBeta(nrhs);
+	iteration = mx_iter;
+	for(unsigned int iitr=0;iitr<mx_iter;iitr++){
+		ls.MatVec_Batch(1.0,ip,0.0,iAp);
+		ls.DOT_Batch(ip,iAp,&aDot[0]);
+		for(unsigned int irhs=0;irhs<nrhs;irhs++){	// the converged columns do not move
+			aAlpha[irhs] = ( aIsConv[irhs] ) ? 0.0 : aRZ[irhs] / aDot[irhs];
+		}
+
+		// {x} = {x} + alpha * {p}
+		ls.AXPY_Batch(&aAlpha[0],ip,ix);
+
+		// {r} = {r} - alpha * [A]{p}
+		for(unsigned int irhs=0;irhs<nrhs;irhs++){ aAlpha[irhs] = -aAlpha[irhs]; }
+		ls.AXPY_Batch(&aAlpha[0],iAp,ir);
+
+		{	// Converge Judgement
+			ls.DOT_Batch(ir,ir,&aDot[0]);
+			for(unsigned int irhs=0;irhs<nrhs;irhs++){
+				if( aIsConv[irhs] ) continue;
+				const double ratio = sqrt(aDot[irhs]*aSqInvNormResIni[irhs]);
+				if( ratio < conv_ratio_tol ){
+					aIsConv[irhs] = true;
+					nconv++;
+					conv_ratio = ( ratio > conv_ratio ) ? ratio : conv_ratio;
+				}
+			}
+			if( nconv == nrhs ){
+				iteration = iitr;
+				return true;
+			}
+		}
+
+		ls.COPY_Batch(ir,iz);
+		precond.SolvePrecond_Batch(ls,iz);
+
+		// calc beta
+		ls.DOT_Batch(ir,iz,&aDot[0]);
+		for(unsigned int irhs=0;irhs<nrhs;irhs++){
+			aBeta[irhs] = ( aIsConv[irhs] ) ? 0.0 : aDot[irhs] / aRZ[irhs];
+			aRZ[irhs] = aDot[irhs];
+		}
+
+		// {p} = {z} + beta*{p}
+		ls.SCAL_Batch(&aBeta[0],ip);
+		ls.AXPY_Batch(&aOne[0],iz,ip);
+	}
+	{	// the largest ratio of the columns not converged
+		ls.DOT_Batch(ir,ir,&aDot[0]);
+		for(unsigned int irhs=0;irhs<nrhs;irhs++){
+			const double ratio = sqrt(aDot[irhs]*aSqInvNormResIni[irhs]);
+			conv_ratio = ( ratio > conv_ratio ) ? ratio : conv_ratio;
+		}
+	}
+	return false;
+}
+
+bool LsSol::Solve_PBiCGSTAB_Batch(double& conv_ratio, unsigned int& num_iter,
+                LsSol::CLinearSystem& ls, LsSol::CPreconditioner_ILU& precond)
+{
+	const double conv_ratio_tol = conv_ratio;
+	const unsigned int max_iter = num_iter;
+	const unsigned int nrhs = ls.NBatch();
+
+	if( ls.GetTmpVecBatchSize() < 7 ){ ls.ReSizeTmpVecBatch(7); }
+
+	const int ix = -2;
+	const int ir = -1;
+	const int is  = 0;	const int iMs = 1;	const int iAMs = 2;
+	const int ip  = 3;	const int iMp = 4;	const int iAMp = 5;
+	const int ir2 = 6;
+
+	std::vector<double> aZero(nrhs,0.0), aOne(nrhs,1.0);
+	std::vector<double> aDot(nrhs), aDot2(nrhs);
+	std::vector<double> aSqInvNormResIni(nrhs);
+	std::vector<bool> aIsConv(nrhs,false);
+	unsigned int nconv = 0;
+	conv_ratio = 0.0;
+	{
+		ls.DOT_Batch(ir,ir,&aDot[0]);
+		for(unsigned int irhs=0;irhs<nrhs;irhs++){
+			if( aDot[irhs] < 1.0e-60 ){ aIsConv[irhs] = true; nconv++; aSqInvNormResIni[irhs] = 0.0; }
+			else{ aSqInvNormResIni[irhs] = 1.0 / aDot[irhs]; }
+		}
+	}
+
+	// {u} = 0
+	ls.SCAL_Batch(&aZero[0],ix);
+	if( nconv == nrhs ){
+		num_iter = 0;
+		return true;
+	}
+
+	// {r2} = {r}
+	ls.COPY_Batch(ir,ir2);
+
+	// {p} = {r}
+	ls.COPY_Batch(ir,ip);
+
+	// calc (r,r0*)
+	std::vector<double> aRR2(nrhs);
+	ls.DOT_Batch(ir,ir2,&aRR2[0]);
+
+	std::vector<double> aAlpha(nrhs), aOmega(nrhs), aBeta(nrhs), aCoeff(nrhs);
+	num_iter = max_iter;
+	for(unsigned int iitr=1;iitr<max_iter;iitr++)
+	{
+		// {Mp_vec} = [M^-1]*{p}
+		ls.COPY_Batch(ip,iMp);
+		precond.SolvePrecond_Batch(ls,iMp);
+
+		// calc {AMp_vec} = [A]*{Mp_vec}
+		ls.MatVec_Batch(1.0,iMp,0.0,iAMp);
+
+		// calc alpha (the converged columns do not move)
+		ls.DOT_Batch(iAMp,ir2,&aDot[0]);
+		for(unsigned int irhs=0;irhs<nrhs;irhs++){
+			aAlpha[irhs] = ( aIsConv[irhs] ) ? 0.0 : aRR2[irhs] / aDot[irhs];
+			aCoeff[irhs] = -aAlpha[irhs];
+		}
+
+		// calc s_vector
+		ls.COPY_Batch(ir,is);
+		ls.AXPY_Batch(&aCoeff[0],iAMp,is);
+
+		// {Ms_vec} = [M^-1]*{s}
+		ls.COPY_Batch(is,iMs);
+		precond.SolvePrecond_Batch(ls,iMs);
+
+		// calc {AMs_vec} = [A]*{Ms_vec}
+		ls.MatVec_Batch(1.0,iMs,0.0,iAMs);
+
+		// calc omega
+		ls.DOT_Batch(iAMs,iAMs,&aDot[0]);
+		ls.DOT_Batch(is,iAMs,&aDot2[0]);
+		for(unsigned int irhs=0;irhs<nrhs;irhs++){
+			aOmega[irhs] = ( aIsConv[irhs] ) ? 0.0 : aDot2[irhs] / aDot[irhs];
+		}
+
+		// update solution
+		ls.AXPY_Batch(&aAlpha[0],iMp,ix);
+		ls.AXPY_Batch(&aOmega[0],iMs,ix);
+
+		// update residual
+		ls.COPY_Batch(is,ir);
+		for(unsigned int irhs=0;irhs<nrhs;irhs++){ aCoeff[irhs] = -aOmega[irhs]; }
+		ls.AXPY_Batch(&aCoeff[0],iAMs,ir);
+
+		{	// Converge Judgement
+			ls.DOT_Batch(ir,ir,&aDot[0]);
+			for(unsigned int irhs=0;irhs<nrhs;irhs++){
+				if( aIsConv[irhs] ) continue;
+				const double ratio = sqrt(aDot[irhs]*aSqInvNormResIni[irhs]);
+				if( ratio < conv_ratio_tol ){
+					aIsConv[irhs] = true;
+					nconv++;
+					conv_ratio = ( ratio > conv_ratio ) ? ratio : conv_ratio;
+				}
+			}
+			if( nconv == nrhs ){
+				num_iter = iitr;
+				return true;
+			}
+		}
+
+		// calc beta
+		ls.DOT_Batch(ir,ir2,&aDot[0]);
+		for(unsigned int irhs=0;irhs<nrhs;irhs++){
+			aBeta[irhs] = ( aIsConv[irhs] ) ? 0.0 : aDot[irhs] * aAlpha[irhs] / (aRR2[irhs]*aOmega[irhs]);
+			aRR2[irhs] = aDot[irhs];
+		}
+
+		// update p_vector ( {p} = {r} + beta*{p} - beta*omega*{AMp} )
+		ls.SCAL_Batch(&aBeta[0],ip);
+		ls.AXPY_Batch(&aOne[0],ir,ip);
+		for(unsigned int irhs=0;irhs<nrhs;irhs++){ aCoeff[irhs] = -aBeta[irhs]*aOmega[irhs]; }
+		ls.AXPY_Batch(&aCoeff[0],iAMp,ip);
+	}
+	{	// the largest ratio of the columns not converged
+		ls.DOT_Batch(ir,ir,&aDot[0]);
+		for(unsigned int irhs=0;irhs<nrhs;irhs++){
+			const double ratio = sqrt(aDot[irhs]*aSqInvNormResIni[irhs]);
+			conv_ratio = ( ratio > conv_ratio ) ? ratio : conv_ratio;
+		}
+	}
+	return false;
+}
+
+
+
+////////////////////////////////////////////////////////////////
+// Krylov recycling
+////////////////////////////////////////////////////////////////
+
+// g[i*n+j] = {aiv1[i]}*{aiv2[j]} for the symmetric g (only the upper triangle is computed, in one reduction)
+static void DotsUpper(LsSol::ILinearSystemPreconditioner_Sol& ls, 
+	const std::vector<int>& aiv1, const std::vector<int>& aiv2, std::vector<double>& g)
+{
+	const unsigned int n = aiv1.size();
+	assert( aiv2.size() == n );
+	g.assign(n*n,0.0);
+	if( n == 0 ) return;
+	std::vector<int> a1, a2;
+	for(unsigned int i=0;i<n;i++){
+	for(unsigned int j=i;j<n;j++){
+		a1.push_back(aiv1[i]);
+		a2.push_back(aiv2[j]);
+	}
+	}
+	std::vector<double> adot(a1.size());
+	ls.DOTS(a1.size(),&a1[0],&a2[0],&adot[0]);
+	unsigned int idot = 0;
+	for(unsigned int i=0;i<n;i++){
+	for(unsigned int j=i;j<n;j++){
+		g[i*n+j] = adot[idot];
+		g[j*n+i] = adot[idot];
+		idot++;
+	}
+	}
+}
+
+// pseudo inverse of the small symmetric matrix a (n*n), the eigen values below 1.0e-12 of the largest are ignored
+static void PseudoInverseSym(unsigned int n, const std::vector<double>& a, std::vector<double>& ainv)
+{
+	ainv.assign(n*n,0.0);
+	if( n == 0 ) return;
+	std::vector<double> t(a), v, lam;
+	LsSol::EigenSymmetric_Jacobi(n,t,v,lam);
+	double lam_max = 0.0;
+	for(unsigned int j=0;j<n;j++){ lam_max = ( fabs(lam[j]) > lam_max ) ? fabs(lam[j]) : lam_max; }
+	for(unsigned int j=0;j<n;j++){
+		if( fabs(lam[j]) <= 1.0e-12*lam_max ) continue;
+		const double dinv = 1.0/lam[j];
+		for(unsigned int i=0;i<n;i++){
+		for(unsigned int k=0;k<n;k++){ ainv[i*n+k] += v[i*n+j]*dinv*v[k*n+j]; }
+		}
+	}
+}
+
+// {p} := {z} + beta*{p} - [W]([W]^T[A][W])^-1([A][W])^T{z}  (einv : ([W]^T[A][W])^-1)
+static void UpdateDirection_Deflated(LsSol::ILinearSystemPreconditioner_Sol& ls, int iz, double beta, int ip, 
+	const std::vector<int>& aW, const std::vector<int>& aAW, const std::vector<double>& einv)
+{
+	ls.AXPBY(1.0,iz,beta,ip);
+	const unsigned int nw = aW.size();
+	if( nw == 0 ) return;
+	std::vector<double> t(nw);
+	{
+		std::vector<int> aiz(nw,iz);
+		ls.DOTS(nw,&aAW[0],&aiz[0],&t[0]);
+	}
+	for(unsigned int i=0;i<nw;i++){
+		double mu = 0.0;
+		for(unsigned int j=0;j<nw;j++){ mu += einv[i*nw+j]*t[j]; }
+		ls.AXPY(-mu,aW[i],ip);
+	}
+}
+
+void LsSol::CKrylovRecycle::Allocate(ILinearSystemPreconditioner_Sol& ls, unsigned int nvec_solver)
+{
+	if( m_iv0 >= 0 && m_iv0 < (int)nvec_solver ){ this->Clear(); }	// the solver needs the kept vectors as its work vectors
+	if( m_iv0 < 0 ){
+		const unsigned int nvec0 = ( nvec_solver > 8 ) ? nvec_solver : 8;
+		m_iv0 = ( ls.GetTmpVectorArySize() > nvec0 ) ? ls.GetTmpVectorArySize() : nvec0;
+		m_nw = 0;
+		m_aIdSol.clear();
+	}
+	const unsigned int nvec = m_iv0 + 2*m_ndefl + m_nsol + m_nharv;
+	if( ls.GetTmpVectorArySize() < nvec ){ ls.ReSizeTmpVecSolver(nvec); }
+}
+
+void LsSol::CKrylovRecycle::PushSolution(ILinearSystemPreconditioner_Sol& ls)
+{
+	if( m_nsol == 0 ) return;
+	int iv = -1;
+	if( m_aIdSol.size() < m_nsol ){	// free slot
+		for(unsigned int isol=0;isol<m_nsol;isol++){
+			if( std::find(m_aIdSol.begin(),m_aIdSol.end(),this->IdS(isol)) != m_aIdSol.end() ) continue;
+			iv = this->IdS(isol);
+			break;
+		}
+	}
+	else{	// overwrite the oldest
+		iv = m_aIdSol.back();
+		m_aIdSol.pop_back();
+	}
+	assert( iv >= 0 );
+	ls.COPY(-2,iv);
+	m_aIdSol.insert(m_aIdSol.begin(),iv);
+}
+
+// Rayleigh-Ritz for the pencil ([Z]^T[A][Z],[Z]^T[Z]) with [Z]=[W P]
+// [W]^T[A][P] = 0 and [P]^T[A][P] is diagonal as the directions of the deflated CG are conjugate
+void LsSol::CKrylovRecycle::UpdateDeflation(ILinearSystemPreconditioner_Sol& ls, 
+	const std::vector<double>& e, const std::vector<double>& aPAP)
+{
+	if( m_ndefl == 0 ) return;
+	std::vector<int> aZ;
+	for(unsigned int iw=0;iw<m_nw;iw++){ aZ.push_back(this->IdW(iw)); }
+	for(unsigned int ip=0;ip<aPAP.size();ip++){ aZ.push_back(this->IdP(ip)); }
+	const unsigned int n = aZ.size();
+	if( n == 0 ) return;
+	std::vector<double> g(n*n,0.0);
+	for(unsigned int i=0;i<m_nw;i++){
+	for(unsigned int j=0;j<m_nw;j++){ g[i*n+j] = e[i*m_nw+j]; }
+	}
+	for(unsigned int ip=0;ip<aPAP.size();ip++){ g[(m_nw+ip)*n+(m_nw+ip)] = aPAP[ip]; }
+	std::vector<double> f;
+	DotsUpper(ls,aZ,aZ,f);
+	// basis of the numerically independent part of the span (t^T f t = I)
+	std::vector<double> t;
+	unsigned int nr = 0;
+	{
+		std::vector<double> v, lam;
+		LsSol::EigenSymmetric_Jacobi(n,f,v,lam);
+		double lam_max = 0.0;
+		for(unsigned int j=0;j<n;j++){ lam_max = ( lam[j] > lam_max ) ? lam[j] : lam_max; }
+		std::vector<unsigned int> aCol;
+		for(unsigned int j=0;j<n;j++){ if( lam[j] > 1.0e-10*lam_max ){ aCol.push_back(j); } }
+		nr = aCol.size();
+		t.resize(n*nr);
+		for(unsigned int i=0;i<n;i++){
+		for(unsigned int k=0;k<nr;k++){ t[i*nr+k] = v[i*n+aCol[k]]/sqrt(lam[aCol[k]]); }
+		}
+	}
+	if( nr == 0 ){ m_nw = 0; return; }
+	std::vector<double> c(nr*nr,0.0);	// t^T g t
+	for(unsigned int k=0;k<nr;k++){
+	for(unsigned int l=0;l<nr;l++){
+		double d = 0.0;
+		for(unsigned int i=0;i<n;i++){
+		for(unsigned int j=0;j<n;j++){ d += t[i*nr+k]*g[i*n+j]*t[j*nr+l]; }
+		}
+		c[k*nr+l] = d;
+	}
+	}
+	std::vector<double> y, theta;
+	LsSol::EigenSymmetric_Jacobi(nr,c,y,theta);
+	std::vector< std::pair<double,unsigned int> > aOrder(nr);
+	for(unsigned int k=0;k<nr;k++){ aOrder[k] = std::make_pair(theta[k],k); }
+	std::sort(aOrder.begin(),aOrder.end());
+	const unsigned int nw_new = ( m_ndefl < nr ) ? m_ndefl : nr;
+	// the new vectors are made in the place of [A][W] that is made again in the next solve
+	for(unsigned int iw=0;iw<nw_new;iw++){
+		const unsigned int icol = aOrder[iw].second;
+		ls.SCAL(0.0,this->IdAW(iw));
+		for(unsigned int i=0;i<n;i++){
+			double q = 0.0;
+			for(unsigned int k=0;k<nr;k++){ q += t[i*nr+k]*y[k*nr+icol]; }
+			ls.AXPY(q,aZ[i],this->IdAW(iw));
+		}
+	}
+	for(unsigned int iw=0;iw<nw_new;iw++){ ls.COPY(this->IdAW(iw),this->IdW(iw)); }
+	m_nw = nw_new;
+}
+
+void LsSol::CKrylovRecycle::PushStatistics(unsigned int niter, double res_warm, bool is_cold)
+{
+	CStat stat;
+	stat.niter = niter;
+	stat.res_warm = res_warm;
+	stat.is_cold = is_cold;
+	m_aStat.push_back(stat);
+}
+
+int LsSol::CKrylovRecycle::GetIterationSaving(unsigned int isolve) const
+{
+	assert( isolve < m_aStat.size() );
+	for(int jsolve=isolve;jsolve>=0;jsolve--){
+		if( !m_aStat[jsolve].is_cold ) continue;
+		return (int)m_aStat[jsolve].niter - (int)m_aStat[isolve].niter;
+	}
+	return 0;
+}
+
+void LsSol::CKrylovRecycle::PrintStatistics() const
+{
+	std::cout << "solve iteration saving warm_start_residual" << std::endl;
+	int nsave = 0;
+	for(unsigned int isolve=0;isolve<m_aStat.size();isolve++){
+		const int isave = this->GetIterationSaving(isolve);
+		nsave += isave;
+		std::cout << isolve << " " << m_aStat[isolve].niter << " " << isave << " " << m_aStat[isolve].res_warm;
+		if( m_aStat[isolve].is_cold ){ std::cout << " (from zero)"; }
+		std::cout << std::endl;
+	}
+	std::cout << "total saving : " << nsave << std::endl;
+}
+
+bool LsSol::Solve_PCG_Recycle(double& conv_ratio, unsigned int& iteration, 
+		LsSol::ILinearSystemPreconditioner_Sol& ls, LsSol::CKrylovRecycle& rec)
+{
+	const double conv_ratio_tol = conv_ratio;
+	const unsigned int mx_iter = iteration;
+
+	rec.Allocate(ls);
+
+	const int ix  = -2;
+	const int ir  = -1;
+	const int ip  =  0;
+	const int iz  =  1;
+	const int iAp =  2;
+	const int ib  =  3;	// right hand side
+
+	ls.SCAL(0.0,ix);
+
+	double sq_inv_norm_res0;
+	{
+		const double sq_norm_res0 = ls.DOT(ir,ir);
+		if( sq_norm_res0 < 1.0e-30 ){
+			conv_ratio = 0.0;
+			iteration = 0;
+			return true;
+		}
+		sq_inv_norm_res0 = 1.0 / sq_norm_res0;
+	}
+	ls.COPY(ir,ib);
+
+	const unsigned int nw = rec.m_nw;
+	const bool is_cold = ( nw == 0 && rec.m_aIdSol.empty() );
+	std::vector<int> aW, aAW;
+	for(unsigned int iw=0;iw<nw;iw++){
+		aW.push_back( rec.IdW(iw) );
+		aAW.push_back( rec.IdAW(iw) );
+	}
+	std::vector<double> e, einv;	// [W]^T[A][W] and its inverse
+	{	// initial solution : Galerkin projection to the span of [W] and the kept solutions ([A][S] is made in the place of [P])
+		std::vector<int> aZ(aW), aAZ(aAW);
+		for(unsigned int isol=0;isol<rec.m_aIdSol.size();isol++){
+			aZ.push_back( rec.m_aIdSol[isol] );
+			aAZ.push_back( rec.IdP(isol) );
+		}
+		const unsigned int nz = aZ.size();
+		if( nz > 0 ){
+			ls.MATVEC_MULTI(nz,1.0,&aZ[0],0.0,&aAZ[0]);
+			std::vector<double> g, ginv, rhs(nz);
+			DotsUpper(ls,aZ,aAZ,g);
+			{
+				std::vector<int> aib(nz,ib);
+				ls.DOTS(nz,&aZ[0],&aib[0],&rhs[0]);
+			}
+			PseudoInverseSym(nz,g,ginv);
+			for(unsigned int i=0;i<nz;i++){
+				double c = 0.0;
+				for(unsigned int j=0;j<nz;j++){ c += ginv[i*nz+j]*rhs[j]; }
+				ls.AXPY( c,aZ[i], ix);
+				ls.AXPY(-c,aAZ[i],ir);
+			}
+			e.resize(nw*nw);
+			for(unsigned int i=0;i<nw;i++){
+			for(unsigned int j=0;j<nw;j++){ e[i*nw+j] = g[i*nz+j]; }
+			}
+			PseudoInverseSym(nw,e,einv);
+		}
+	}
+	const double res_warm = sqrt( ls.DOT(ir,ir) * sq_inv_norm_res0 );
+
+	ls.COPY(ir,iz);
+	ls.SolvePrecond(iz);
+	UpdateDirection_Deflated(ls,iz,0.0,ip,aW,aAW,einv);
+
+	std::vector<double> aPAP;	// p^T[A]p of the directions kept for the deflation
+	bool is_conv = false;
+	double inpro_rz = ls.DOT(ir,iz);
+	unsigned int iitr = 0;
+	for(;iitr<mx_iter;iitr++){
+		const double val_pAp = ls.MATVEC_DOT(1.0,ip,0.0,iAp);
+		if( aPAP.size() < rec.m_nharv ){
+			ls.COPY(ip,rec.IdP(aPAP.size()));
+			aPAP.push_back(val_pAp);
+		}
+		const double alpha = inpro_rz / val_pAp;
+		const double sq_norm_res = ls.AXPY_DOT(-alpha,iAp,ir);
+		ls.AXPY(alpha,ip,ix);
+		if( sq_norm_res * sq_inv_norm_res0 < conv_ratio_tol*conv_ratio_tol ){
+			// check the true residual (as Solve_PCG with is_refine)
+			ls.COPY(ib,ir);
+			ls.MATVEC(-1.0,ix,1.0,ir);
+			const double sq_norm_res_true = ls.DOT(ir,ir);
+			if( sq_norm_res_true * sq_inv_norm_res0 < conv_ratio_tol*conv_ratio_tol ){
+				conv_ratio = sqrt( sq_norm_res_true * sq_inv_norm_res0 );
+				is_conv = true;
+				break;
+			}
+			ls.COPY(ir,iz);
+			ls.SolvePrecond(iz);
+			UpdateDirection_Deflated(ls,iz,0.0,ip,aW,aAW,einv);
+			inpro_rz = ls.DOT(ir,iz);
+			continue;
+		}
+		ls.COPY(ir,iz);
+		ls.SolvePrecond(iz);
+		const double inpro_rz_new = ls.DOT(ir,iz);
+		const double beta = inpro_rz_new/inpro_rz;
+		inpro_rz = inpro_rz_new;
+		UpdateDirection_Deflated(ls,iz,beta,ip,aW,aAW,einv);
+	}
+	if( !is_conv ){ conv_ratio = sqrt( ls.DOT(ir,ir) * sq_inv_norm_res0 ); }
+	iteration = iitr;
+
+	rec.UpdateDeflation(ls,e,aPAP);
+	rec.PushSolution(ls);
+	rec.PushStatistics(iteration,res_warm,is_cold);
+	return is_conv;
+}
+
+bool LsSol::Solve_PBiCGSTAB_Recycle(double& conv_ratio, unsigned int& iteration, 
+		LsSol::ILinearSystemPreconditioner_Sol& ls, LsSol::CKrylovRecycle& rec)
+{
+	return rec.SolveAsym(conv_ratio,iteration,ls,0);
+}
+
+bool LsSol::Solve_PGMRES_Recycle(double& conv_ratio, unsigned int& iteration, 
+		LsSol::ILinearSystemPreconditioner_Sol& ls, LsSol::CKrylovRecycle& rec, unsigned int nrestart)
+{
+	return rec.SolveAsym(conv_ratio,iteration,ls,( nrestart == 0 ) ? 1 : nrestart);
+}
+
+bool LsSol::CKrylovRecycle::SolveAsym(double& conv_ratio, unsigned int& iteration, 
+		LsSol::ILinearSystemPreconditioner_Sol& ls, unsigned int nrestart)
+{
+	const double conv_ratio_tol = conv_ratio;
+	const unsigned int mx_iter = iteration;
+
+	this->Allocate(ls,( nrestart == 0 ) ? 8 : nrestart+3);	// PGMRES uses nrestart+3 work vectors
+
+	const int ix = -2;
+	const int ir = -1;
+
+	const double sq_norm_res0 = ls.DOT(ir,ir);
+	if( sq_norm_res0 < 1.0e-60 ){
+		ls.SCAL(0.0,ix);
+		conv_ratio = 0.0;
+		iteration = 0;
+		return true;
+	}
+	const unsigned int nsol = m_aIdSol.size();
+	const bool is_cold = ( nsol == 0 );
+	const int ix0 = this->IdP(nsol);	// initial solution
+	ls.SCAL(0.0,ix0);
+	if( nsol > 0 ){	// minimum residual in the span of the kept solutions ([A][S] is made in the place of [P])
+		std::vector<int> aAS;
+		for(unsigned int isol=0;isol<nsol;isol++){ aAS.push_back( this->IdP(isol) ); }
+		ls.MATVEC_MULTI(nsol,1.0,&m_aIdSol[0],0.0,&aAS[0]);
+		std::vector<double> g, ginv, rhs(nsol);
+		DotsUpper(ls,aAS,aAS,g);
+		{
+			std::vector<int> air(nsol,ir);
+			ls.DOTS(nsol,&aAS[0],&air[0],&rhs[0]);
+		}
+		PseudoInverseSym(nsol,g,ginv);
+		for(unsigned int i=0;i<nsol;i++){
+			double c = 0.0;
+			for(unsigned int j=0;j<nsol;j++){ c += ginv[i*nsol+j]*rhs[j]; }
+			ls.AXPY( c,m_aIdSol[i],ix0);
+			ls.AXPY(-c,aAS[i],ir);
+		}
+	}
+	const double res_warm = sqrt( ls.DOT(ir,ir) / sq_norm_res0 );
+	bool is_conv = true;
+	if( res_warm < conv_ratio_tol ){
+		ls.SCAL(0.0,ix);
+		conv_ratio = res_warm;
+		iteration = 0;
+	}
+	else{	// the correction from the initial solution (the tolerance is relative to the first residual)
+		double conv = conv_ratio_tol/res_warm;
+		unsigned int iter = mx_iter;
+		is_conv = ( nrestart == 0 ) ? LsSol::Solve_PBiCGSTAB(conv,iter,ls) : LsSol::Solve_PGMRES(conv,iter,ls,nrestart);
+		conv_ratio = conv*res_warm;
+		iteration = iter;
+	}
+	ls.AXPY(1.0,ix0,ix);
+	this->PushSolution(ls);
+	this->PushStatistics(iteration,res_warm,is_cold);
+	return is_conv;
+}
@@ -24,7 +24,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #pragma warning( disable : 4786 )
 #endif
 
-#ifndef for
+#if !defined(for) && !defined(_OPENMP)
 #define for if(0); else for
 #endif
 
@@ -32,9 +32,11 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include <iostream>
 #include <algorithm>
 
+#include "delfem/parallel.h"
 #include "delfem/indexed_array.h"
 #include "delfem/matvec/mat_blkcrs.h"
 #include "delfem/matvec/vector_blk.h"
+#include "delfem/matvec/multivector_blk.h"
 #include "delfem/matvec/ordering_blk.h"
 #include "delfem/matvec/bcflag_blk.h"
 
@@ -57,7 +59,9 @@ CMat_BlkCrs::CMat_BlkCrs()
     m_DofPtrRow = 0;
     m_ValPtr = 0;
 
+    m_nthread_marge = 0;
     m_marge_tmp_buffer = 0;
+    this->ClearPatternCache();
 }
 
 CMat_BlkCrs::CMat_BlkCrs(unsigned int nblk_col, const std::vector<unsigned int>& alen_col, 
@@ -88,7 +92,9 @@ CMat_BlkCrs::CMat_BlkCrs(unsigned int nblk_col, const std::vector<unsigned int>&
 
     ////////////////
     m_ValPtr = 0;
+    m_nthread_marge = 0;
     m_marge_tmp_buffer = 0;
+    this->ClearPatternCache();
 }
 
 
@@ -107,7 +113,9 @@ CMat_BlkCrs::CMat_BlkCrs(const unsigned int nblk_col, const unsigned int len_col
     m_DofPtrRow = 0;
     m_ValPtr = 0;
     
+    m_nthread_marge = 0;
     m_marge_tmp_buffer = 0;
+    this->ClearPatternCache();
 }
 
 CMat_BlkCrs::CMat_BlkCrs(const CMat_BlkCrs& rhs, bool is_value, bool isnt_trans)
@@ -127,7 +135,9 @@ CMat_BlkCrs::CMat_BlkCrs(const CMat_BlkCrs& rhs, bool is_value, bool isnt_trans)
     m_DofPtrRow = 0;
     m_ValPtr = 0;
     
+    m_nthread_marge = 0;
     m_marge_tmp_buffer = 0;
+    this->ClearPatternCache();
 
 	AddPattern(rhs,isnt_trans);
 	if( is_value ){ this->SetValue(rhs,isnt_trans); }
@@ -135,6 +145,8 @@ CMat_BlkCrs::CMat_BlkCrs(const CMat_BlkCrs& rhs, bool is_value, bool isnt_trans)
 
 bool CMat_BlkCrs::Initialize(const unsigned int nblk_col, const unsigned int len_col, 
 						     const unsigned int nblk_row, const unsigned int len_row ){
+	this->ClearPatternCache();
+	this->DeleteMargeTmpBuffer();
 
 	if( m_colInd_Blk != 0 ){ delete[] m_colInd_Blk; }
 	if( m_rowPtr_Blk != 0 ){ delete[] m_rowPtr_Blk; }
@@ -158,12 +170,15 @@ bool CMat_BlkCrs::Initialize(const unsigned int nblk_col, const unsigned int len
     m_DofPtrCol = 0;
     m_DofPtrRow = 0;
     m_ValPtr    = 0;
+    this->MakePatternTrans();
     return true;
 }
 
 bool CMat_BlkCrs::Initialize(unsigned int nblk_col, const std::vector<unsigned int>& alen_col, 
                              unsigned int nblk_row, const std::vector<unsigned int>& alen_row )
 {
+	this->ClearPatternCache();
+	this->DeleteMargeTmpBuffer();
     if( nblk_col != alen_col.size() ){ assert(0); return false; }
     if( nblk_row != alen_row.size() ){ assert(0); return false; }
 
@@ -201,6 +216,7 @@ bool CMat_BlkCrs::Initialize(unsigned int nblk_col, const std::vector<unsigned i
 	m_ncrs_Blk = 0;
 	m_rowPtr_Blk = 0;
 	m_valCrs_Blk = 0; 
+    this->MakePatternTrans();
     return true;
 }
 
@@ -213,14 +229,28 @@ CMat_BlkCrs::~CMat_BlkCrs()
     if( m_DofPtrCol != 0 ){ delete[] m_DofPtrCol; m_DofPtrCol = 0; }
     if( m_DofPtrRow != 0 ){ delete[] m_DofPtrRow; m_DofPtrRow = 0; }
     if( m_ValPtr    != 0 ){ delete[] m_ValPtr;    m_ValPtr    = 0; }
+    this->DeleteMargeTmpBuffer();
 }
 
 // p^[Sď@RowPtr,Val̓
+std::size_t CMat_BlkCrs::NBytePattern() const
+{
+	std::size_t nbyte = 0;
+	if( m_colInd_Blk != 0 ){ nbyte += (m_nblk_MatCol+1)*sizeof(unsigned int); }
+	if( m_rowPtr_Blk != 0 ){ nbyte += m_ncrs_Blk*sizeof(unsigned int); }
+	if( m_DofPtrCol  != 0 ){ nbyte += (m_nblk_MatCol+1)*sizeof(unsigned int); }
+	if( m_DofPtrRow  != 0 ){ nbyte += (m_nblk_MatRow+1)*sizeof(unsigned int); }
+	if( m_ValPtr     != 0 ){ nbyte += (m_ncrs_Blk+1)*sizeof(unsigned int); }
+	return nbyte;
+}
+
 bool CMat_BlkCrs::DeletePattern(){
+	this->ClearPatternCache();
 	m_ncrs_Blk = 0;
 	for(unsigned int iblk=0;iblk<m_nblk_MatCol+1;iblk++){ m_colInd_Blk[iblk] = 0; }
 	if( m_rowPtr_Blk != 0 ){ delete[] m_rowPtr_Blk; m_rowPtr_Blk = 0; }
 	if( m_valCrs_Blk != 0 ){ delete[] m_valCrs_Blk; m_valCrs_Blk = 0; }
+	this->MakePatternTrans();
 	return true;
 }
 
@@ -261,6 +291,7 @@ bool CMat_BlkCrs::SetZero()
 
 void CMat_BlkCrs::FillPattern()
 {
+	this->ClearPatternCache();
 	const unsigned int nblkcol = NBlkMatCol();
 	const unsigned int nblkrow = NBlkMatRow();
 	m_colInd_Blk[0] = 0;
@@ -275,10 +306,12 @@ void CMat_BlkCrs::FillPattern()
 			m_rowPtr_Blk[iblk*nblkrow+jblk] = jblk; 
 		}
 	}
+	this->MakePatternTrans();
 }
 
 bool MatVec::CMat_BlkCrs::AddPattern(const Com::CIndexedArray& crs)
 {
+	this->ClearPatternCache();
 	// ̓`FbN
 	if( !crs.CheckValid() ) return false;
 	if( crs.Size() > NBlkMatCol() ) return false;
@@ -290,7 +323,7 @@ bool MatVec::CMat_BlkCrs::AddPattern(const Com::CIndexedArray& crs)
 		if( max_val>NBlkMatRow() ) return false;
 	}
 
-	if( crs.array.size() == 0 ) return true;
+	if( crs.array.size() == 0 ){ this->MakePatternTrans(); return true; }
 
 	if( m_ncrs_Blk == 0 ){
 		this->DeletePattern();
@@ -319,6 +352,7 @@ bool MatVec::CMat_BlkCrs::AddPattern(const Com::CIndexedArray& crs)
 //			}
 //			std::cout << std::endl;
 //		}
+		this->MakePatternTrans();
 		return true;
 	}
 
@@ -353,7 +387,7 @@ bool MatVec::CMat_BlkCrs::AddPattern(const Com::CIndexedArray& crs)
 		}
 		delete[] tmp_buffer;
 	}
-	if( is_included ) return true;
+	if( is_included ){ this->MakePatternTrans(); return true; }
 
 	// p^[ǉ
 	std::vector<unsigned int> tmp_row_ptr;
@@ -410,12 +444,15 @@ bool MatVec::CMat_BlkCrs::AddPattern(const Com::CIndexedArray& crs)
 			}
 		}
 	}
+	this->MakePatternTrans();
 	return true;
 }
 
 bool CMat_BlkCrs::AddPattern(const CMat_BlkCrs& rhs, const bool isnt_trans)
 {
-	if( rhs.m_ncrs_Blk == 0 ) return true;
+	this->ClearPatternCache();
+	assert( rhs.IsPatternIndex() );
+	if( rhs.m_ncrs_Blk == 0 ){ this->MakePatternTrans(); return true; }
 	if( isnt_trans ){	// Add Not Transpose Pattern of rhs
 		if( this->m_ncrs_Blk == 0 ){
 			if( this->m_rowPtr_Blk != 0 ){ delete[] this->m_rowPtr_Blk; }
@@ -487,18 +524,21 @@ bool CMat_BlkCrs::AddPattern(const CMat_BlkCrs& rhs, const bool isnt_trans)
 			/* include 邩ׂĂAincludeȂȂp^[t */
 		}
 	}
+	this->MakePatternTrans();
 	return true;
 }
 
 bool CMat_BlkCrs::AddPattern(const CMat_BlkCrs& rhs, 
 		const COrdering_Blk& order_col, const COrdering_Blk& order_row)
 {
+	this->ClearPatternCache();
+	assert( rhs.IsPatternIndex() );
 	assert( rhs.NBlkMatCol() == order_col.NBlk() );
 	assert( rhs.NBlkMatRow() == order_row.NBlk() );
 	assert( this->NBlkMatCol() == order_col.NBlk() );
 	assert( this->NBlkMatRow() == order_row.NBlk() );
 
-	if( rhs.m_ncrs_Blk == 0 ) return true;	// ???????????????
+	if( rhs.m_ncrs_Blk == 0 ){ this->MakePatternTrans(); return true; }	// ???????????????
 
 	if( this->m_ncrs_Blk == 0 ){	// ?????????????
 		if( m_rowPtr_Blk != 0 ){ delete[] m_rowPtr_Blk; m_rowPtr_Blk = 0; }
@@ -549,6 +589,7 @@ bool CMat_BlkCrs::AddPattern(const CMat_BlkCrs& rhs,
 		abort();
 		/* include ??????????include??????????????? */
 	}
+	this->MakePatternTrans();
 	return true;
 }
 
@@ -556,6 +597,7 @@ bool CMat_BlkCrs::AddPattern(const CMat_BlkCrs& rhs,
 
 bool CMat_BlkCrs::SetValue(const CMat_BlkCrs& rhs, const bool isnt_trans)
 {
+	assert( rhs.IsPatternIndex() );
 	assert( m_nblk_MatCol == rhs.m_nblk_MatCol );
 	assert( m_nblk_MatRow == rhs.m_nblk_MatRow );
 	assert( m_len_BlkCol == rhs.m_len_BlkCol );
@@ -697,6 +739,7 @@ bool CMat_BlkCrs::SetValue(const CMat_BlkCrs& rhs, const bool isnt_trans)
 bool CMat_BlkCrs::SetValue(const CMat_BlkCrs& rhs, 
 		const COrdering_Blk& order_col, const COrdering_Blk& order_row)
 {
+	assert( rhs.IsPatternIndex() );
 	assert( rhs.NBlkMatCol() == order_col.NBlk() );
 	assert( rhs.NBlkMatRow() == order_row.NBlk() );
 	assert( this->NBlkMatCol() == order_col.NBlk() );
@@ -751,6 +794,114 @@ bool CMat_BlkCrs::SetValue(const CMat_BlkCrs& rhs,
 }
 
 
+void CMat_BlkCrs::ClearPatternCache()
+{
+	static unsigned int iver_ptn_counter = 0;	// shared by all the matrices
+	iver_ptn_counter++;
+	m_iver_ptn = iver_ptn_counter;
+	m_aIndTrans.clear();
+	m_aCrsTrans.clear();
+	m_aBlkTrans.clear();
+	m_mapMeargeTable.clear();
+}
+
+void CMat_BlkCrs::MakeMargeTmpBuffer()
+{
+	const unsigned int nthread = Com::GetNumThread();
+	if( m_marge_tmp_buffer != 0 && m_nthread_marge >= nthread ) return;
+	this->DeleteMargeTmpBuffer();
+	const unsigned int nblkrow = NBlkMatRow();
+	m_marge_tmp_buffer = new int [nblkrow*nthread];
+	for(unsigned int i=0;i<nblkrow*nthread;i++){ m_marge_tmp_buffer[i] = -1; }
+	m_nthread_marge = nthread;
+}
+
+int* CMat_BlkCrs::GetMargeTmpBuffer()
+{
+	const unsigned int ithread = Com::GetThreadIndex();
+	if( m_marge_tmp_buffer == 0 ){
+		assert( ithread == 0 );	// call MakeMargeTmpBuffer before the parallel region
+		this->MakeMargeTmpBuffer();
+	}
+	assert( ithread < m_nthread_marge );
+	return m_marge_tmp_buffer + ithread*NBlkMatRow();
+}
+
+const CMat_BlkCrs::SMeargeTable* CMat_BlkCrs::FindMeargeTable(unsigned int id_table, unsigned int id_es, unsigned int iver_conn) const
+{
+	std::map< unsigned int, SMeargeTable >::const_iterator itr = m_mapMeargeTable.find(id_table);
+	if( itr == m_mapMeargeTable.end() ) return 0;
+	const SMeargeTable& table = itr->second;
+	if( table.id_es != id_es || table.iver_conn != iver_conn || table.iver_ptn != m_iver_ptn ) return 0;
+	return &table;
+}
+
+bool CMat_BlkCrs::MakeMeargeTable(unsigned int id_table, unsigned int id_es, unsigned int iver_conn, unsigned int nelem, 
+	unsigned int nblkel_col, const unsigned int* lnods_col,
+	unsigned int nblkel_row, const unsigned int* lnods_row)
+{
+	assert( this->IsPatternIndex() );
+	if( LenBlkCol() == -1 || LenBlkRow() == -1 ){
+		std::cout << "Error!-->Not Implemented" << std::endl;
+		return false;
+	}
+	int* marge_buffer = this->GetMargeTmpBuffer();
+	SMeargeTable& table = m_mapMeargeTable[id_table];
+	table.id_es = id_es;
+	table.iver_conn = iver_conn;
+	table.iver_ptn = m_iver_ptn;
+	std::vector<int>& aIndCrs = table.aIndCrs;
+	aIndCrs.resize(nelem*nblkel_col*nblkel_row);
+	for(unsigned int ielem=0;ielem<nelem;ielem++){
+		const unsigned int* blkel_col = lnods_col+ielem*nblkel_col;
+		const unsigned int* blkel_row = lnods_row+ielem*nblkel_row;
+		int* pind = &aIndCrs[ielem*nblkel_col*nblkel_row];
+		for(unsigned int iblkel=0;iblkel<nblkel_col;iblkel++){
+			const unsigned int iblk1 = blkel_col[iblkel];
+			assert( iblk1 < NBlkMatCol() );
+			for(unsigned int jpsup=m_colInd_Blk[iblk1];jpsup<m_colInd_Blk[iblk1+1];jpsup++){
+				marge_buffer[ m_rowPtr_Blk[jpsup] ] = jpsup;
+			}
+			for(unsigned int jblkel=0;jblkel<nblkel_row;jblkel++){
+				const unsigned int jblk1 = blkel_row[jblkel];
+				assert( jblk1 < NBlkMatRow() );
+				pind[iblkel*nblkel_row+jblkel] = marge_buffer[jblk1];
+			}
+			for(unsigned int jpsup=m_colInd_Blk[iblk1];jpsup<m_colInd_Blk[iblk1+1];jpsup++){
+				marge_buffer[ m_rowPtr_Blk[jpsup] ] = -1;
+			}
+		}
+	}
+	return true;
+}
+
+bool CMat_BlkCrs::MeargeTable(unsigned int id_table, unsigned int id_es, unsigned int iver_conn, unsigned int ielem,
+	unsigned int nblkel_col, const unsigned int* blkel_col,
+	unsigned int nblkel_row, const unsigned int* blkel_row,
+	unsigned int blksize, const double* emat)
+{
+	const SMeargeTable* pTable = this->FindMeargeTable(id_table,id_es,iver_conn);
+	if( pTable == 0 ){	// no table or a stale table
+		return this->Mearge(nblkel_col,blkel_col, nblkel_row,blkel_row, blksize,emat);
+	}
+	const std::vector<int>& aIndCrs = pTable->aIndCrs;
+	const unsigned int BlkSize = LenBlkCol()*LenBlkRow();
+	assert( blksize == BlkSize );
+	assert( (ielem+1)*nblkel_col*nblkel_row <= aIndCrs.size() );
+	const int* pind = &aIndCrs[ielem*nblkel_col*nblkel_row];
+	for(unsigned int iblkel=0;iblkel<nblkel_col;iblkel++){
+	for(unsigned int jblkel=0;jblkel<nblkel_row;jblkel++){
+		const int icrs = pind[iblkel*nblkel_row+jblkel];
+		if( icrs == -1 ) continue;
+		assert( m_rowPtr_Blk[icrs] == blkel_row[jblkel] );
+		const double* pval_in = &emat[(iblkel*nblkel_row+jblkel)*BlkSize];
+		double* pval_out = &m_valCrs_Blk[icrs*BlkSize];
+		for(unsigned int idof=0;idof<BlkSize;idof++){ pval_out[idof] += pval_in[idof]; }
+	}
+	}
+	return true;
+}
+
 bool CMat_BlkCrs::Mearge(
 	const unsigned int nblkel_col, const unsigned int* blkel_col,
 	const unsigned int nblkel_row, const unsigned int* blkel_row,
@@ -780,13 +931,7 @@ bool CMat_BlkCrs::Mearge(
         return true;
     }
 
-    if( m_marge_tmp_buffer == 0 ){
-        const unsigned int nblkrow = NBlkMatRow();
-        m_marge_tmp_buffer = new int [nblkrow];
-        for(unsigned int iblk=0;iblk<nblkrow;iblk++){
-            m_marge_tmp_buffer[iblk] = -1;
-        }
-    }
+	int* marge_buffer = this->GetMargeTmpBuffer();
 
 	const unsigned int BlkSize = LenBlkCol()*LenBlkRow();
 	assert( blksize == BlkSize );
@@ -801,14 +946,14 @@ bool CMat_BlkCrs::Mearge(
 		for(unsigned int jpsup=colind[iblk1];jpsup<colind[iblk1+1];jpsup++){
 			assert( jpsup < m_ncrs_Blk );
 			const unsigned int jblk1 = rowptr[jpsup];
-			m_marge_tmp_buffer[jblk1] = jpsup;
+			marge_buffer[jblk1] = jpsup;
 		}
 		for(unsigned int jblkel=0;jblkel<nblkel_row;jblkel++){
 			const unsigned int jblk1 = blkel_row[jblkel];
 			assert( jblk1 < NBlkMatRow() );
-			if( m_marge_tmp_buffer[jblk1] == -1 ) continue;
-            assert( m_marge_tmp_buffer[jblk1] >= 0 && m_marge_tmp_buffer[jblk1] < (int)m_ncrs_Blk );
-			const unsigned int jpsup1 = m_marge_tmp_buffer[jblk1];
+			if( marge_buffer[jblk1] == -1 ) continue;
+            assert( marge_buffer[jblk1] >= 0 && marge_buffer[jblk1] < (int)m_ncrs_Blk );
+			const unsigned int jpsup1 = marge_buffer[jblk1];
 			assert( jpsup1 < m_ncrs_Blk );
 			assert( rowptr[jpsup1] == jblk1 );
 			const double* pval_in = &emat[(iblkel*nblkel_row+jblkel)*BlkSize];
@@ -818,7 +963,7 @@ bool CMat_BlkCrs::Mearge(
 		for(unsigned int jpsup=colind[iblk1];jpsup<colind[iblk1+1];jpsup++){
 			assert( jpsup < m_ncrs_Blk );
 			const unsigned int jblk1 = rowptr[jpsup];
-			m_marge_tmp_buffer[jblk1] = -1;
+			marge_buffer[jblk1] = -1;
 		}
 	}
 	return true;
@@ -952,8 +1097,116 @@ bool CMat_BlkCrs::SetBoundaryCondition_Row(const CBCFlag& bc_flag)
 }
 
 
+void CMat_BlkCrs::MakePatternTrans()
+{
+	const unsigned int nblk_col = this->NBlkMatCol();
+	const unsigned int nblk_row = this->NBlkMatRow();
+	m_aIndTrans.clear();
+	m_aIndTrans.resize(nblk_row+1,0);
+	for(unsigned int icrs=0;icrs<m_ncrs_Blk;icrs++){
+		const unsigned int jblk0 = m_rowPtr_Blk[icrs]; assert( jblk0 < nblk_row );
+		m_aIndTrans[jblk0+1]++;
+	}
+	for(unsigned int jblk=0;jblk<nblk_row;jblk++){
+		m_aIndTrans[jblk+1] += m_aIndTrans[jblk];
+	}
+	m_aCrsTrans.resize(m_ncrs_Blk);
+	m_aBlkTrans.resize(m_ncrs_Blk);
+	// iblk is visited in ascending order, so each row block keeps the same summation order as the serial scatter
+	for(unsigned int iblk=0;iblk<nblk_col;iblk++){
+		for(unsigned int icrs=m_colInd_Blk[iblk];icrs<m_colInd_Blk[iblk+1];icrs++){
+			const unsigned int jblk0 = m_rowPtr_Blk[icrs];
+			const unsigned int ind0 = m_aIndTrans[jblk0];
+			m_aCrsTrans[ind0] = icrs;
+			m_aBlkTrans[ind0] = iblk;
+			m_aIndTrans[jblk0]++;
+		}
+	}
+	for(unsigned int jblk=nblk_row;jblk>0;jblk--){
+		m_aIndTrans[jblk] = m_aIndTrans[jblk-1];
+	}
+	m_aIndTrans[0] = 0;
+}
+
 bool CMat_BlkCrs::MatVec(double alpha, const CVector_Blk& x, double beta, CVector_Blk& b, const bool isnt_trans) const
 {
+	assert( this->IsPatternIndex() );
+	if( !isnt_trans ){
+		// {b} = alpha*[A]^T{x} + beta*{b}
+		// each thread gathers a row block of [A]^T through the transposed pattern, so no scatter (and no lock) is needed
+		assert( x.NBlk() == m_nblk_MatCol );
+		assert( b.NBlk() == m_nblk_MatRow );
+		if( m_aIndTrans.size() != m_nblk_MatRow+1 ){	// no transposed pattern : serial scatter
+			const bool is_flex = ( LenBlkCol() == -1 || LenBlkRow() == -1 );
+			for(unsigned int jblk=0;jblk<m_nblk_MatRow;jblk++){
+				double* jbval = b.GetValuePtr(jblk);
+				for(unsigned int jdof=0;jdof<this->LenBlkRow(jblk);jdof++){ jbval[jdof] *= beta; }
+			}
+			for(unsigned int iblk=0;iblk<m_nblk_MatCol;iblk++){
+				const unsigned int len_col = this->LenBlkCol(iblk);
+				const double* ixval = x.GetValuePtr(iblk);
+				for(unsigned int icrs=m_colInd_Blk[iblk];icrs<m_colInd_Blk[iblk+1];icrs++){
+					const unsigned int jblk0 = m_rowPtr_Blk[icrs]; assert( jblk0 < m_nblk_MatRow );
+					const unsigned int len_row = this->LenBlkRow(jblk0);
+					const double* pval = m_valCrs_Blk + ( is_flex ? m_ValPtr[icrs] : icrs*len_col*len_row );
+					double* jbval = b.GetValuePtr(jblk0);
+					for(unsigned int idof=0;idof<len_col;idof++){
+						const double aixval = alpha*ixval[idof];
+						for(unsigned int jdof=0;jdof<len_row;jdof++){ jbval[jdof] += pval[idof*len_row+jdof]*aixval; }
+					}
+				}
+			}
+			return true;
+		}
+		assert( m_aCrsTrans.size() == m_ncrs_Blk );
+		const unsigned int* indtrans = &m_aIndTrans[0];
+		const unsigned int* crstrans = ( m_ncrs_Blk == 0 ) ? 0 : &m_aCrsTrans[0];
+		const unsigned int* blktrans = ( m_ncrs_Blk == 0 ) ? 0 : &m_aBlkTrans[0];
+		const unsigned int nblk_row = this->NBlkMatRow();
+		if( LenBlkCol() == 1 && LenBlkRow() == 1 ){
+			const double* xval = x.m_Value;
+			double* bval = b.m_Value;
+#if defined(_OPENMP)
+#pragma omp parallel for
+#endif
+			for(int jjblk=0;jjblk<(int)nblk_row;jjblk++){ const unsigned int jblk = jjblk;
+				double* jbval = bval+jblk;
+				*jbval *= beta;
+				for(unsigned int ind=indtrans[jblk];ind<indtrans[jblk+1];ind++){
+					const unsigned int icrs0 = crstrans[ind]; assert( icrs0 < m_ncrs_Blk );
+					const unsigned int iblk0 = blktrans[ind]; assert( iblk0 < m_nblk_MatCol );
+					*jbval += alpha * m_valCrs_Blk[icrs0]*xval[iblk0];
+				}
+			}
+			return true;
+		}
+		const bool is_flex = ( LenBlkCol() == -1 || LenBlkRow() == -1 );
+		assert( !is_flex || ( LenBlkCol() == -1 && LenBlkRow() == -1 ) );
+		assert( is_flex || ( x.Len() == m_len_BlkCol && b.Len() == m_len_BlkRow ) );
+#if defined(_OPENMP)
+#pragma omp parallel for
+#endif
+		for(int jjblk=0;jjblk<(int)nblk_row;jjblk++){ const unsigned int jblk = jjblk;
+			const unsigned int len_row = this->LenBlkRow(jblk); assert( b.Len(jblk) == len_row );
+			double* jbval = b.GetValuePtr(jblk);
+			for(unsigned int jdof=0;jdof<len_row;jdof++){ jbval[jdof] *= beta; }
+			for(unsigned int ind=indtrans[jblk];ind<indtrans[jblk+1];ind++){
+				const unsigned int icrs0 = crstrans[ind]; assert( icrs0 < m_ncrs_Blk );
+				const unsigned int iblk0 = blktrans[ind]; assert( iblk0 < m_nblk_MatCol );
+				const unsigned int len_col = this->LenBlkCol(iblk0); assert( x.Len(iblk0) == len_col );
+				const double* ixval = x.GetValuePtr(iblk0);
+				const double* pval = m_valCrs_Blk + ( is_flex ? m_ValPtr[icrs0] : icrs0*len_col*len_row );
+				for(unsigned int idof=0;idof<len_col;idof++){
+					const double aixval = alpha*ixval[idof];
+					for(unsigned int jdof=0;jdof<len_row;jdof++){
+						jbval[jdof] += pval[idof*len_row+jdof]*aixval;
+					}
+				}
+			}
+		}
+		return true;
+	}
+
 	assert( x.NBlk() == m_nblk_MatRow );
 	assert( b.NBlk() == m_nblk_MatCol );
 
@@ -961,7 +1214,10 @@ bool CMat_BlkCrs::MatVec(double alpha, const CVector_Blk& x, double beta, CVecto
         assert( LenBlkCol() == -1 && LenBlkRow() == -1 );
 		const unsigned int nblk_row = this->NBlkMatRow();
 		const unsigned int nblk_col = this->NBlkMatCol();
-		for(unsigned int iblk=0;iblk<nblk_col;iblk++){
+#if defined(_OPENMP)
+#pragma omp parallel for
+#endif
+		for(int iiblk=0;iiblk<(int)nblk_col;iiblk++){ const unsigned int iblk = iiblk;
             const unsigned int len_col = this->LenBlkCol(iblk); assert( b.Len(iblk) == len_col );
 			double* iyval = b.GetValuePtr(iblk);
 			for(unsigned int idof=0;idof<len_col;idof++){ iyval[idof] *= beta; }
@@ -986,28 +1242,13 @@ bool CMat_BlkCrs::MatVec(double alpha, const CVector_Blk& x, double beta, CVecto
 
 	assert( x.Len() == m_len_BlkRow );
 	assert( b.Len() == m_len_BlkCol );
-	if( !isnt_trans ){
-		if( LenBlkCol()*LenBlkRow()==1 ) {
-			for(unsigned int jblk=0;jblk<m_nblk_MatRow;jblk++){ b.m_Value[jblk] *= beta; }
-			for(unsigned int iblk=0;iblk<m_nblk_MatCol;iblk++){
-				for(unsigned int icrs=m_colInd_Blk[iblk];icrs<m_colInd_Blk[iblk+1];icrs++){
-					assert( icrs < m_ncrs_Blk );
-					const unsigned int jblk0 = m_rowPtr_Blk[icrs];
-					assert( jblk0 < m_nblk_MatRow );
-					b.m_Value[jblk0] += alpha * m_valCrs_Blk[icrs]*x.m_Value[iblk];
-				}
-			}
-		}
-		else{
-			std::cout << "Error!-->NotImplimented" << std::endl;
-			assert(0);
-		}
-		return true;
-	}
 
 	if( LenBlkCol()*LenBlkRow()==1 ) {
 		if( beta != 0.0 ){
-			for(unsigned int iblk=0;iblk<m_nblk_MatCol;iblk++){
+#if defined(_OPENMP)
+#pragma omp parallel for
+#endif
+			for(int iiblk=0;iiblk<(int)m_nblk_MatCol;iiblk++){ const unsigned int iblk = iiblk;
 				double* lval = &(b.m_Value[iblk]);
 				*lval *= beta;
 				for(unsigned int icrs=m_colInd_Blk[iblk];icrs<m_colInd_Blk[iblk+1];icrs++){
@@ -1019,7 +1260,10 @@ bool CMat_BlkCrs::MatVec(double alpha, const CVector_Blk& x, double beta, CVecto
 			}
 		}
 		else{
-			for(unsigned int iblk=0;iblk<m_nblk_MatCol;iblk++){
+#if defined(_OPENMP)
+#pragma omp parallel for
+#endif
+			for(int iiblk=0;iiblk<(int)m_nblk_MatCol;iiblk++){ const unsigned int iblk = iiblk;
 				double* lval = &(b.m_Value[iblk]);
 				*lval = 0.0;
 				for(unsigned int icrs=m_colInd_Blk[iblk];icrs<m_colInd_Blk[iblk+1];icrs++){
@@ -1039,7 +1283,10 @@ bool CMat_BlkCrs::MatVec(double alpha, const CVector_Blk& x, double beta, CVecto
 			const unsigned int* colind = m_colInd_Blk;
 			const unsigned int* rowptr = m_rowPtr_Blk;
 			const double* matval = m_valCrs_Blk;
-			for(unsigned int iblk=0;iblk<nblkcol;iblk++){
+#if defined(_OPENMP)
+#pragma omp parallel for
+#endif
+			for(int iiblk=0;iiblk<(int)nblkcol;iiblk++){ const unsigned int iblk = iiblk;
 				double* iyval = b.m_Value+iblk;
 				*iyval *= beta;
 				for(unsigned int icrs=colind[iblk];icrs<colind[iblk+1];icrs++){
@@ -1057,7 +1304,10 @@ bool CMat_BlkCrs::MatVec(double alpha, const CVector_Blk& x, double beta, CVecto
 			const unsigned int* colind = m_colInd_Blk;
 			const unsigned int* rowptr = m_rowPtr_Blk;
 			const double* matval = m_valCrs_Blk;
-			for(unsigned int iblk=0;iblk<nblkcol;iblk++){
+#if defined(_OPENMP)
+#pragma omp parallel for
+#endif
+			for(int iiblk=0;iiblk<(int)nblkcol;iiblk++){ const unsigned int iblk = iiblk;
 				double* iyval = b.m_Value+iblk;
 				*iyval *= beta;
 				for(unsigned int icrs=colind[iblk];icrs<colind[iblk+1];icrs++){
@@ -1073,7 +1323,10 @@ bool CMat_BlkCrs::MatVec(double alpha, const CVector_Blk& x, double beta, CVecto
 		}
 		else{
 			const unsigned int nlen_row = this->LenBlkRow();
-			for(unsigned int iblk=0;iblk<m_nblk_MatCol;iblk++){
+#if defined(_OPENMP)
+#pragma omp parallel for
+#endif
+			for(int iiblk=0;iiblk<(int)m_nblk_MatCol;iiblk++){ const unsigned int iblk = iiblk;
 				double* iyval = b.m_Value+iblk;
 				*iyval *= beta;
 				for(unsigned int icrs=m_colInd_Blk[iblk];icrs<m_colInd_Blk[iblk+1];icrs++){
@@ -1095,7 +1348,10 @@ bool CMat_BlkCrs::MatVec(double alpha, const CVector_Blk& x, double beta, CVecto
 			const unsigned int* colind = m_colInd_Blk;
 			const unsigned int* rowptr = m_rowPtr_Blk;
 			const double* matval = m_valCrs_Blk;
-			for(unsigned int iblk=0;iblk<nblkcol;iblk++){
+#if defined(_OPENMP)
+#pragma omp parallel for
+#endif
+			for(int iiblk=0;iiblk<(int)nblkcol;iiblk++){ const unsigned int iblk = iiblk;
 				double* iyval = b.m_Value+iblk*2;
 				iyval[0] *= beta; 
 				iyval[1] *= beta;
@@ -1115,7 +1371,10 @@ bool CMat_BlkCrs::MatVec(double alpha, const CVector_Blk& x, double beta, CVecto
 			const unsigned int* colind = m_colInd_Blk;
 			const unsigned int* rowptr = m_rowPtr_Blk;
 			const double* matval = m_valCrs_Blk;
-			for(unsigned int iblk=0;iblk<nblkcol;iblk++){
+#if defined(_OPENMP)
+#pragma omp parallel for
+#endif
+			for(int iiblk=0;iiblk<(int)nblkcol;iiblk++){ const unsigned int iblk = iiblk;
 				double* iyval = b.m_Value+iblk*3;
 				iyval[0] *= beta; 
 				iyval[1] *= beta;
@@ -1133,7 +1392,10 @@ bool CMat_BlkCrs::MatVec(double alpha, const CVector_Blk& x, double beta, CVecto
 		}
 		else{
 			const unsigned int nlen_col = this->LenBlkCol();
-			for(unsigned int iblk=0;iblk<m_nblk_MatCol;iblk++){
+#if defined(_OPENMP)
+#pragma omp parallel for
+#endif
+			for(int iiblk=0;iiblk<(int)m_nblk_MatCol;iiblk++){ const unsigned int iblk = iiblk;
 				double* iyval = b.m_Value+iblk*nlen_col;
 				for(unsigned int idof=0;idof<nlen_col;idof++){ iyval[idof] *= beta; }
 				for(unsigned int icrs=m_colInd_Blk[iblk];icrs<m_colInd_Blk[iblk+1];icrs++){
@@ -1154,7 +1416,10 @@ bool CMat_BlkCrs::MatVec(double alpha, const CVector_Blk& x, double beta, CVecto
 		const unsigned int nlen_col = this->LenBlkCol();
 		const unsigned int nlen_row = this->LenBlkRow();
 		const unsigned int blk_size = nlen_row*nlen_col;
-		for(unsigned int iblk=0;iblk<nblk_col;iblk++){
+#if defined(_OPENMP)
+#pragma omp parallel for
+#endif
+		for(int iiblk=0;iiblk<(int)nblk_col;iiblk++){ const unsigned int iblk = iiblk;
 			double* iyval = b.m_Value+iblk*nlen_col;
 			for(unsigned int idof=0;idof<nlen_col;idof++){ iyval[idof] *= beta; }
 			for(unsigned int icrs=m_colInd_Blk[iblk];icrs<m_colInd_Blk[iblk+1];icrs++){
@@ -1173,10 +1438,98 @@ bool CMat_BlkCrs::MatVec(double alpha, const CVector_Blk& x, double beta, CVecto
 	return true;
 }
 
+// matrix product of all the columns of the multi vector
+// the innermost loop runs over the columns, which are contiguous
+bool CMat_BlkCrs::MatVec_Multi(double alpha, const CMultiVector_Blk& x, double beta, CMultiVector_Blk& b, const bool isnt_trans) const
+{
+	assert( this->IsPatternIndex() );
+	if( LenBlkCol() == -1 || LenBlkRow() == -1 ){
+		std::cout << "Error!-->Not Implemented" << std::endl;
+		assert(0);
+		return false;
+	}
+	assert( x.NCol() == b.NCol() );
+	const unsigned int ncol = x.NCol();
+	const unsigned int len_col = LenBlkCol();
+	const unsigned int len_row = LenBlkRow();
+	const unsigned int blk_size = len_col*len_row;
+	const double* xval = x.m_Value;
+	double* bval = b.m_Value;
+	if( !isnt_trans ){
+		// {b} = alpha*[A]^T{x} + beta*{b}, gathered through the transposed pattern
+		assert( x.NBlk() == m_nblk_MatCol && x.Len() == len_col );
+		assert( b.NBlk() == m_nblk_MatRow && b.Len() == len_row );
+		if( m_aIndTrans.size() != m_nblk_MatRow+1 ){	// no transposed pattern : serial scatter
+			for(unsigned int i=0;i<m_nblk_MatRow*len_row*ncol;i++){ bval[i] *= beta; }
+			for(unsigned int iblk=0;iblk<m_nblk_MatCol;iblk++){
+				const double* ixval = xval+iblk*len_col*ncol;
+				for(unsigned int icrs=m_colInd_Blk[iblk];icrs<m_colInd_Blk[iblk+1];icrs++){
+					const unsigned int jblk0 = m_rowPtr_Blk[icrs]; assert( jblk0 < m_nblk_MatRow );
+					double* jbval = bval+jblk0*len_row*ncol;
+					const double* pval = m_valCrs_Blk+icrs*blk_size;
+					for(unsigned int idof=0;idof<len_col;idof++){
+					for(unsigned int jdof=0;jdof<len_row;jdof++){
+						const double a = alpha*pval[idof*len_row+jdof];
+						for(unsigned int icol=0;icol<ncol;icol++){ jbval[jdof*ncol+icol] += a*ixval[idof*ncol+icol]; }
+					}
+					}
+				}
+			}
+			return true;
+		}
+		const unsigned int nblk_row = this->NBlkMatRow();
+#if defined(_OPENMP)
+#pragma omp parallel for
+#endif
+		for(int jjblk=0;jjblk<(int)nblk_row;jjblk++){ const unsigned int jblk = jjblk;
+			double* jbval = bval+jblk*len_row*ncol;
+			for(unsigned int i=0;i<len_row*ncol;i++){ jbval[i] *= beta; }
+			for(unsigned int ind=m_aIndTrans[jblk];ind<m_aIndTrans[jblk+1];ind++){
+				const unsigned int icrs0 = m_aCrsTrans[ind]; assert( icrs0 < m_ncrs_Blk );
+				const unsigned int iblk0 = m_aBlkTrans[ind]; assert( iblk0 < m_nblk_MatCol );
+				const double* ixval = xval+iblk0*len_col*ncol;
+				const double* pval = m_valCrs_Blk+icrs0*blk_size;
+				for(unsigned int idof=0;idof<len_col;idof++){
+				for(unsigned int jdof=0;jdof<len_row;jdof++){
+					const double a = alpha*pval[idof*len_row+jdof];
+					for(unsigned int icol=0;icol<ncol;icol++){ jbval[jdof*ncol+icol] += a*ixval[idof*ncol+icol]; }
+				}
+				}
+			}
+		}
+		return true;
+	}
+	assert( x.NBlk() == m_nblk_MatRow && x.Len() == len_row );
+	assert( b.NBlk() == m_nblk_MatCol && b.Len() == len_col );
+	const unsigned int nblk_col = this->NBlkMatCol();
+#if defined(_OPENMP)
+#pragma omp parallel for
+#endif
+	for(int iiblk=0;iiblk<(int)nblk_col;iiblk++){ const unsigned int iblk = iiblk;
+		double* ibval = bval+iblk*len_col*ncol;
+		for(unsigned int i=0;i<len_col*ncol;i++){ ibval[i] *= beta; }
+		for(unsigned int icrs=m_colInd_Blk[iblk];icrs<m_colInd_Blk[iblk+1];icrs++){
+			assert( icrs < m_ncrs_Blk );
+			const unsigned int jblk0 = m_rowPtr_Blk[icrs];
+			assert( jblk0 < m_nblk_MatRow );
+			const double* jxval = xval+jblk0*len_row*ncol;
+			const double* pval = m_valCrs_Blk+icrs*blk_size;
+			for(unsigned int idof=0;idof<len_col;idof++){
+			for(unsigned int jdof=0;jdof<len_row;jdof++){
+				const double a = alpha*pval[idof*len_row+jdof];
+				for(unsigned int icol=0;icol<ncol;icol++){ ibval[idof*ncol+icol] += a*jxval[jdof*ncol+icol]; }
+			}
+			}
+		}
+	}
+	return true;
+}
+
 
 bool CMat_BlkCrs::SetPatternBoundary(const CMat_BlkCrs& rhs, 
 		const CBCFlag& bc_flag_col, const CBCFlag& bc_flag_row)
 {
+	this->ClearPatternCache();
 	assert( this->NBlkMatCol() == rhs.NBlkMatCol() );
 	assert( this->NBlkMatRow() == rhs.NBlkMatRow() );
 	assert( this->LenBlkCol() == rhs.LenBlkCol() );
@@ -1261,11 +1614,13 @@ bool CMat_BlkCrs::SetPatternBoundary(const CMat_BlkCrs& rhs,
 		ncrs += inz;
 	}
 	assert( m_ncrs_Blk == ncrs );
+	this->MakePatternTrans();
 	return true;
 }
 
 bool CMat_BlkCrs::SetPatternDia(const CMat_BlkCrs& rhs)
 {
+	this->ClearPatternCache();
 	assert( rhs.NBlkMatCol() == rhs.NBlkMatRow() );
 	assert( this->NBlkMatCol() == rhs.NBlkMatCol() );
 	assert( this->NBlkMatRow() == rhs.NBlkMatRow() );
@@ -1315,6 +1670,7 @@ bool CMat_BlkCrs::SetPatternDia(const CMat_BlkCrs& rhs)
 	}
 	assert( m_ncrs_Blk == ncrs );
 
+	this->MakePatternTrans();
 	return true;
 }
 
@@ -23,7 +23,9 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #if defined(__VISUALC__)
 #pragma warning( disable : 4786 ) 
 #endif
+#if !defined(_OPENMP)
 #define for if(0); else for
+#endif
 
 #include <iostream>
 #include <cassert>
@@ -36,8 +38,10 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include "delfem/matvec/matdia_blkcrs.h"
 #include "delfem/matvec/matfrac_blkcrs.h"
 #include "delfem/matvec/vector_blk.h"
+#include "delfem/matvec/multivector_blk.h"
 #include "delfem/matvec/ordering_blk.h"
 #include "delfem/matvec/bcflag_blk.h"
+#include "delfem/matvec/ker_blk.h"
 
 using namespace MatVec;
 
@@ -45,7 +49,7 @@ using namespace MatVec;
 // \z/
 //////////////////////////////////////////////////////////////////////
 
-CMatDia_BlkCrs::CMatDia_BlkCrs() : m_valDia_Blk(0), m_DiaValPtr(0)
+CMatDia_BlkCrs::CMatDia_BlkCrs() : m_valDia_Blk(0), m_DiaValPtr(0), m_rowOfs_Blk(0)
 {
 }
 
@@ -55,12 +59,14 @@ CMatDia_BlkCrs::CMatDia_BlkCrs(const unsigned int nblk_colrow, const unsigned in
 //	std::cout << "Construct : CMatDia_BlkCrs(nblk_colrow, len_colrow) " << nblk_colrow << " " << len_colrow << std::endl;
 	m_valDia_Blk = new  double [NBlkMatCol() * LenBlkCol()*LenBlkRow()];
     m_DiaValPtr = 0;
+	m_rowOfs_Blk = 0;
 }
 
 CMatDia_BlkCrs::~CMatDia_BlkCrs()
 {
 	if( m_valDia_Blk != 0 ){ delete[] m_valDia_Blk; m_valDia_Blk = 0; }
 	if( m_DiaValPtr  != 0 ){ delete[] m_DiaValPtr;  m_DiaValPtr  = 0; }
+	if( m_rowOfs_Blk != 0 ){ delete[] m_rowOfs_Blk; m_rowOfs_Blk = 0; }
 }
 
 
@@ -76,6 +82,7 @@ bool CMatDia_BlkCrs::Initialize(unsigned int nblk_col, const std::vector<unsigne
     for(unsigned int iblk=0;iblk<nblk;iblk++){
         if( alen_col[iblk] != alen_row[iblk] ){ assert(0); return false; }
     }
+    this->ClearCompactPattern();
     
     // eNXInitialize
     if( !CMat_BlkCrs::Initialize(nblk_col, alen_col, nblk_row,alen_row) ){
@@ -113,7 +120,7 @@ bool CMatDia_BlkCrs::Initialize(unsigned int nblk_col, unsigned int len_col,
 //    const unsigned int nblk = nblk_col;
     if( len_col != len_row ){ assert(0); return false; }
 //    const unsigned int len = len_col;
-
+    this->ClearCompactPattern();
     
     // eNXInitialize
     if( !CMat_BlkCrs::Initialize(nblk_col, len_col, nblk_row,len_row) ){
@@ -132,6 +139,7 @@ bool CMatDia_BlkCrs::Initialize(unsigned int nblk_col, unsigned int len_col,
 
 
 bool CMatDia_BlkCrs::DeletePattern(){
+	this->ClearCompactPattern();
 	CMat_BlkCrs::DeletePattern();
 	return true;
 }
@@ -139,6 +147,7 @@ bool CMatDia_BlkCrs::DeletePattern(){
 bool CMatDia_BlkCrs::SetZero()
 {
     assert( this->NBlkMatCol() == this->NBlkMatRow() );
+	this->SetCompactPattern(false);
 	CMat_BlkCrs::SetZero();
     unsigned int ni = 0;
     if( LenBlkCol() >= 0 && LenBlkRow() >= 0 ){
@@ -162,11 +171,52 @@ bool CMatDia_BlkCrs::SetZero()
 	return true;
 }
 
+// merge element matrix with the block length fixed at compile time (N=0 : length given by len)
+// marge_buffer has to be filled with -1 on input and is restored on output
+template<unsigned int N>
+static void Mearge_Fix(const unsigned int len, 
+                       const unsigned int nblkel, const unsigned int* blkel_col, const unsigned int* blkel_row, 
+                       const double* emat,
+                       const unsigned int* colind, const unsigned int* rowptr, int* marge_buffer, 
+                       double* matval_nd, double* matval_dia)
+{
+	assert( N == 0 || N == len );
+	const unsigned int BlkSize = ( N == 0 ) ? len*len : N*N;
+	for(unsigned int iblkel=0;iblkel<nblkel;iblkel++){
+		const unsigned int iblk1 = blkel_col[iblkel];
+		for(unsigned int jpsup=colind[iblk1];jpsup<colind[iblk1+1];jpsup++){
+			const unsigned int jblk1 = rowptr[jpsup];
+			marge_buffer[jblk1] = jpsup;
+		}
+		for(unsigned int jblkel=0;jblkel<nblkel;jblkel++){
+			double* pval_out;
+			if( iblkel == jblkel ){	// Marge Diagonal
+				pval_out = &matval_dia[iblk1*BlkSize];
+			}
+			else{	// Marge Non-Diagonal
+				const unsigned int jblk1 = blkel_row[jblkel];
+				if( marge_buffer[jblk1] == -1 ) continue;
+				const unsigned int jpsup1 = marge_buffer[jblk1];
+				assert( rowptr[jpsup1] == jblk1 );
+				pval_out = &matval_nd[jpsup1*BlkSize];
+			}
+			const double* pval_in = &emat[(iblkel*nblkel+jblkel)*BlkSize];
+			if( N != 0 ){ Ker::AddBlk<N>(pval_out,pval_in); }
+			else{ for(unsigned int idof=0;idof<BlkSize;idof++){ pval_out[idof] += pval_in[idof]; } }
+		}
+		for(unsigned int jpsup=colind[iblk1];jpsup<colind[iblk1+1];jpsup++){
+			const unsigned int jblk1 = rowptr[jpsup];
+			marge_buffer[jblk1] = -1;
+		}
+	}
+}
+
 bool CMatDia_BlkCrs::Mearge(unsigned int nblkel_col, const unsigned int* blkel_col,
 						    unsigned int nblkel_row, const unsigned int* blkel_row,
 						    unsigned int blksize, const double* emat)
 {
     assert( m_colInd_Blk != 0 );
+	assert( !this->IsCompactPattern() );
 	assert( m_valCrs_Blk != 0 );
 	assert( m_valDia_Blk != 0 );
 
@@ -204,56 +254,76 @@ bool CMatDia_BlkCrs::Mearge(unsigned int nblkel_col, const unsigned int* blkel_c
         return true;
     }
 
-    if( m_marge_tmp_buffer == 0 ){
-        const unsigned int nblkrow = NBlkMatRow();
-        m_marge_tmp_buffer = new int [nblkrow];
-        for(unsigned int iblk=0;iblk<nblkrow;iblk++){
-            m_marge_tmp_buffer[iblk] = -1;
-        }
-    }
+	int* marge_buffer = this->GetMargeTmpBuffer();
 
-	const unsigned int BlkSize = LenBlkCol()*LenBlkRow();
-//	const unsigned int BlkLen = LenBlkCol();
+	const unsigned int BlkLen = LenBlkCol();
+	const unsigned int BlkSize = BlkLen*BlkLen;
 
 	assert( nblkel_col == nblkel_row );
 	assert( blksize == BlkSize );
 
-	const unsigned int* colind = m_colInd_Blk;
-	const unsigned int* rowptr = m_rowPtr_Blk;
-	double* matval_nd = m_valCrs_Blk;
-	double* matval_dia = m_valDia_Blk;
+	switch( BlkLen ){
+	case 1: Mearge_Fix<1>(1,nblkel_col,blkel_col,blkel_row,emat, m_colInd_Blk,m_rowPtr_Blk,marge_buffer,m_valCrs_Blk,m_valDia_Blk); break;
+	case 2: Mearge_Fix<2>(2,nblkel_col,blkel_col,blkel_row,emat, m_colInd_Blk,m_rowPtr_Blk,marge_buffer,m_valCrs_Blk,m_valDia_Blk); break;
+	case 3: Mearge_Fix<3>(3,nblkel_col,blkel_col,blkel_row,emat, m_colInd_Blk,m_rowPtr_Blk,marge_buffer,m_valCrs_Blk,m_valDia_Blk); break;
+	case 4: Mearge_Fix<4>(4,nblkel_col,blkel_col,blkel_row,emat, m_colInd_Blk,m_rowPtr_Blk,marge_buffer,m_valCrs_Blk,m_valDia_Blk); break;
+	case 6: Mearge_Fix<6>(6,nblkel_col,blkel_col,blkel_row,emat, m_colInd_Blk,m_rowPtr_Blk,marge_buffer,m_valCrs_Blk,m_valDia_Blk); break;
+	default: 
+		Mearge_Fix<0>(BlkLen,nblkel_col,blkel_col,blkel_row,emat, m_colInd_Blk,m_rowPtr_Blk,marge_buffer,m_valCrs_Blk,m_valDia_Blk); break;
+	}
+	return true;
+}
 
-	for(unsigned int iblkel=0;iblkel<nblkel_col;iblkel++){
-		const int iblk1 = blkel_col[iblkel];
-		for(unsigned int jpsup=colind[iblk1];jpsup<colind[iblk1+1];jpsup++){
-			assert( jpsup < m_ncrs_Blk );
-			const unsigned int jblk1 = rowptr[jpsup];
-			m_marge_tmp_buffer[jblk1] = jpsup;
-		}
-		for(unsigned int jblkel=0;jblkel<nblkel_row;jblkel++){
-			if( iblkel == jblkel ){	// Marge Diagonal
-				const double* pval_in = &emat[(iblkel*nblkel_row+iblkel)*BlkSize];
-				double* pval_out = &matval_dia[iblk1*BlkSize];
-				for(unsigned int idof=0;idof<BlkSize;idof++){ pval_out[idof] += pval_in[idof]; }
-			}
-			else{	// Marge Non-Diagonal
-				const unsigned int jblk1 = blkel_row[jblkel];
-				assert( jblk1 < this->NBlkMatRow() );
-				if( m_marge_tmp_buffer[jblk1] == -1 ) continue;
-                assert( m_marge_tmp_buffer[jblk1] >= 0 && m_marge_tmp_buffer[jblk1] < (int)m_ncrs_Blk );
-				const unsigned int jpsup1 = m_marge_tmp_buffer[jblk1];
-				assert( m_rowPtr_Blk[jpsup1] == jblk1 );
-				const double* pval_in = &emat[(iblkel*nblkel_row+jblkel)*BlkSize];
-				double* pval_out = &matval_nd[jpsup1*BlkSize];
-				for(unsigned int idof=0;idof<BlkSize;idof++){ pval_out[idof] += pval_in[idof]; }
+// merge element matrix at the crs positions of the table (N=0 : length given by len)
+template<unsigned int N>
+static void MeargeTable_Fix(const unsigned int len, 
+                            const unsigned int nblkel, const unsigned int* blkel, const int* pind,
+                            const double* emat, double* matval_nd, double* matval_dia)
+{
+	assert( N == 0 || N == len );
+	const unsigned int BlkSize = ( N == 0 ) ? len*len : N*N;
+	for(unsigned int iblkel=0;iblkel<nblkel;iblkel++){
+		for(unsigned int jblkel=0;jblkel<nblkel;jblkel++){
+			double* pval_out;
+			if( iblkel == jblkel ){ pval_out = &matval_dia[blkel[iblkel]*BlkSize]; }
+			else{
+				const int icrs = pind[iblkel*nblkel+jblkel];
+				if( icrs == -1 ) continue;
+				pval_out = &matval_nd[icrs*BlkSize];
 			}
-		}
-		for(unsigned int jpsup=colind[iblk1];jpsup<colind[iblk1+1];jpsup++){
-			assert( jpsup < m_ncrs_Blk );
-			const unsigned int jblk1 = rowptr[jpsup];
-			m_marge_tmp_buffer[jblk1] = -1;
+			const double* pval_in = &emat[(iblkel*nblkel+jblkel)*BlkSize];
+			if( N != 0 ){ Ker::AddBlk<N>(pval_out,pval_in); }
+			else{ for(unsigned int idof=0;idof<BlkSize;idof++){ pval_out[idof] += pval_in[idof]; } }
 		}
 	}
+}
+
+bool CMatDia_BlkCrs::MeargeTable(unsigned int id_table, unsigned int id_es, unsigned int iver_conn, unsigned int ielem,
+                                 unsigned int nblkel_col, const unsigned int* blkel_col,
+                                 unsigned int nblkel_row, const unsigned int* blkel_row,
+                                 unsigned int blksize, const double* emat)
+{
+	assert( !this->IsCompactPattern() );
+	assert( m_valCrs_Blk != 0 && m_valDia_Blk != 0 );
+	const SMeargeTable* pTable = this->FindMeargeTable(id_table,id_es,iver_conn);
+	if( pTable == 0 ){	// no table or a stale table
+		return this->Mearge(nblkel_col,blkel_col, nblkel_row,blkel_row, blksize,emat);
+	}
+	const std::vector<int>& aIndCrs = pTable->aIndCrs;
+	const unsigned int BlkLen = LenBlkCol();
+	assert( nblkel_col == nblkel_row );
+	assert( blksize == BlkLen*BlkLen );
+	assert( (ielem+1)*nblkel_col*nblkel_row <= aIndCrs.size() );
+	const int* pind = &aIndCrs[ielem*nblkel_col*nblkel_row];
+	switch( BlkLen ){
+	case 1: MeargeTable_Fix<1>(1,nblkel_col,blkel_col,pind,emat, m_valCrs_Blk,m_valDia_Blk); break;
+	case 2: MeargeTable_Fix<2>(2,nblkel_col,blkel_col,pind,emat, m_valCrs_Blk,m_valDia_Blk); break;
+	case 3: MeargeTable_Fix<3>(3,nblkel_col,blkel_col,pind,emat, m_valCrs_Blk,m_valDia_Blk); break;
+	case 4: MeargeTable_Fix<4>(4,nblkel_col,blkel_col,pind,emat, m_valCrs_Blk,m_valDia_Blk); break;
+	case 6: MeargeTable_Fix<6>(6,nblkel_col,blkel_col,pind,emat, m_valCrs_Blk,m_valDia_Blk); break;
+	default:
+		MeargeTable_Fix<0>(BlkLen,nblkel_col,blkel_col,pind,emat, m_valCrs_Blk,m_valDia_Blk); break;
+	}
 	return true;
 }
 
@@ -264,6 +334,7 @@ bool CMatDia_BlkCrs::SetBoundaryCondition(const MatVec::CBCFlag& bc_flag)
 	assert( NBlkMatCol() == NBlkMatRow() );
 	assert( bc_flag.NBlk() == NBlkMatRow() );
 	assert( bc_flag.LenBlk() == LenBlkRow() );
+	this->SetCompactPattern(false);
 
     if( LenBlkCol() == -1 || LenBlkRow() == -1 ){
 	    // bc_flagOłȂs̍sOɂB
@@ -345,6 +416,8 @@ bool CMatDia_BlkCrs::SetBoundaryCondition(const MatVec::CBCFlag& bc_flag)
 // [p^[
 bool CMatDia_BlkCrs::AddPattern(const Com::CIndexedArray& crs)
 {
+	this->ClearPatternCache();
+	this->SetCompactPattern(false);
 	// ̓`FbN
 	assert( crs.CheckValid() );
 	if( !crs.CheckValid() ) return false;
@@ -506,6 +579,8 @@ bool CMatDia_BlkCrs::AddPattern(const Com::CIndexedArray& crs)
 
 // [p^[
 bool CMatDia_BlkCrs::AddPattern(const CMatDia_BlkCrs& rhs, const bool isnt_trans){
+	this->ClearPatternCache();
+	this->SetCompactPattern(false);
 	if( isnt_trans ){
 		assert( NBlkMatCol() == rhs.NBlkMatRow() );
 		assert( NBlkMatRow() == rhs.NBlkMatCol() );
@@ -529,6 +604,8 @@ bool CMatDia_BlkCrs::AddPattern(const CMatDia_BlkCrs& rhs, const bool isnt_trans
 
 bool CMatDia_BlkCrs::AddPattern(const CMatDia_BlkCrs& rhs, const COrdering_Blk& order)
 {
+	this->ClearPatternCache();
+	this->SetCompactPattern(false);
 	assert( rhs.NBlkMatCol() == rhs.NBlkMatRow() );
 	assert( rhs.NBlkMatCol() == order.NBlk() );
 	if( this->NBlkMatCol() == 0 ){
@@ -558,10 +635,13 @@ bool CMatDia_BlkCrs::AddPattern(const CMatDia_BlkCrs& rhs, const COrdering_Blk&
 // M1*M2*M3̃p^[i}`Obhp)
 bool CMatDia_BlkCrs::AddPattern(const CMat_BlkCrs& m1, const CMatDia_BlkCrs& m2, const CMat_BlkCrs& m3)
 {
+	this->ClearPatternCache();
+	this->SetCompactPattern(false);
 	assert( NBlkMatCol()    == m1.NBlkMatCol() );
 	assert( m1.NBlkMatRow() == m2.NBlkMatCol() );
 	assert( m2.NBlkMatRow() == m3.NBlkMatCol() );
 	assert( m3.NBlkMatRow() == NBlkMatRow() );
+	assert( m2.IsPatternIndex() );
 
 	if( m_ncrs_Blk == 0 ){
 
@@ -672,6 +752,7 @@ bool CMatDia_BlkCrs::AddPattern(const CMat_BlkCrs& m1, const CMatDia_BlkCrs& m2,
 
 bool CMatDia_BlkCrs::SetValue(const CMatDia_BlkCrs& rhs, const bool isnt_trans)
 {
+	this->SetCompactPattern(false);
 	assert( NBlkMatRow() == rhs.NBlkMatRow() );
 	assert( NBlkMatCol() == rhs.NBlkMatCol() );
 	assert( NBlkMatCol() == NBlkMatRow() );
@@ -724,6 +805,7 @@ bool CMatDia_BlkCrs::SetValue(const CMatDia_BlkCrs& rhs, const bool isnt_trans)
 
 bool CMatDia_BlkCrs::SetValue(const CMatDia_BlkCrs& rhs, const COrdering_Blk& order)
 {
+	this->SetCompactPattern(false);
 	assert( rhs.NBlkMatCol() == order.NBlk() );
 	assert( rhs.NBlkMatRow() == order.NBlk() );
 	assert( rhs.NBlkMatCol() == rhs.NBlkMatRow() );
@@ -762,6 +844,8 @@ bool CMatDia_BlkCrs::SetValue(const CMatDia_BlkCrs& rhs, const COrdering_Blk& or
 
 bool CMatDia_BlkCrs::SetValue(const CMat_BlkCrs& m1, const CMatDia_BlkCrs& m2, const CMat_BlkCrs& m3)
 {
+	this->SetCompactPattern(false);
+	assert( m2.IsPatternIndex() );
 	assert( NBlkMatRow() == NBlkMatRow() );
 	assert( NBlkMatCol() == m1.NBlkMatCol() );
 	assert( m1.NBlkMatRow() == m2.NBlkMatCol() );
@@ -916,6 +1000,55 @@ bool CMatDia_BlkCrs::SetValue(const CMat_BlkCrs& m1, const CMatDia_BlkCrs& m2, c
 	return true;
 }
 
+// row loop of MatVec with the block length fixed at compile time
+// return {x}*{y} of the updated {y} if IS_DOT (0 otherwise)
+// rowptr is the 32bit pattern or the compact pattern (see CRowColBlk)
+template<unsigned int N, bool IS_DOT, typename IND>
+static double MatVec_Fix(const unsigned int nblk, const unsigned int* colind, const IND* rowptr, 
+                       const double* matval_nd, const double* matval_dia,
+                       const double alpha, const double* xval, const double beta, double* yval)
+{
+	double dot = 0.0;
+#if defined(_OPENMP)
+#pragma omp parallel for reduction(+:dot)
+#endif
+	for(int iiblk=0;iiblk<(int)nblk;iiblk++){ const unsigned int iblk = iiblk;
+		double* iyval = yval+iblk*N;
+		Ker::ScaleVec<N>(iyval,beta);
+		const CRowColBlk<IND> col(rowptr,colind,iblk);
+		const unsigned int icrs0 = colind[iblk];
+		const unsigned int icrs1 = colind[iblk+1];
+		for(unsigned int icrs=icrs0;icrs<icrs1;icrs++){
+			const unsigned int jblk0 = col[icrs];
+			assert( jblk0 < nblk );
+			Ker::AddMatVec<N>(iyval,alpha,matval_nd+icrs*N*N,xval+jblk0*N);
+		}
+		Ker::AddMatVec<N>(iyval,alpha,matval_dia+iblk*N*N,xval+iblk*N);
+		if( IS_DOT ){
+			const double* ixval = xval+iblk*N;
+			for(unsigned int idof=0;idof<N;idof++){ dot += ixval[idof]*iyval[idof]; }
+		}
+	}
+	return dot;
+}
+
+// dispatch to the block length, returns false if it is not one of 1,2,3,4,6
+template<bool IS_DOT, typename IND>
+static bool MatVec_Len(const int len, const unsigned int nblk, const unsigned int* colind, const IND* rowptr, 
+                       const double* matval_nd, const double* matval_dia,
+                       const double alpha, const double* xval, const double beta, double* yval, double& dot)
+{
+	switch( len ){
+	case 1: dot = MatVec_Fix<1,IS_DOT>(nblk,colind,rowptr,matval_nd,matval_dia,alpha,xval,beta,yval); return true;
+	case 2: dot = MatVec_Fix<2,IS_DOT>(nblk,colind,rowptr,matval_nd,matval_dia,alpha,xval,beta,yval); return true;
+	case 3: dot = MatVec_Fix<3,IS_DOT>(nblk,colind,rowptr,matval_nd,matval_dia,alpha,xval,beta,yval); return true;
+	case 4: dot = MatVec_Fix<4,IS_DOT>(nblk,colind,rowptr,matval_nd,matval_dia,alpha,xval,beta,yval); return true;
+	case 6: dot = MatVec_Fix<6,IS_DOT>(nblk,colind,rowptr,matval_nd,matval_dia,alpha,xval,beta,yval); return true;
+	default: break;
+	}
+	return false;
+}
+
 // Calc Matrix Vector Product
 // {y} = alpha * [A]{x} + beta * {y}
 bool CMatDia_BlkCrs::MatVec(double alpha, const CVector_Blk& x, double beta, CVector_Blk& y) const
@@ -927,12 +1060,25 @@ bool CMatDia_BlkCrs::MatVec(double alpha, const CVector_Blk& x, double beta, CVe
 
 	assert( y.NBlk() == NBlkMatCol() );
 	assert( y.Len()  == LenBlkCol() );
+	// the values are released in CMatDiaFrac_BlkCrs::SetSinglePrecision
+	if( m_valDia_Blk == 0 ){ assert(0); return false; }
+
+	double dot;
+	if( this->IsCompactPattern() ){	// compact pattern (only for the fixed block length)
+		const SCompactPattern_Blk cp = this->GetCompactPattern();
+		const bool res = MatVec_Len<false>(LenBlkCol(),NBlkMatCol(),m_colInd_Blk,&cp,m_valCrs_Blk,m_valDia_Blk,alpha,x.m_Value,beta,y.m_Value,dot);
+		assert( res );
+		return res;
+	}
 
     if( LenBlkCol() == -1 || LenBlkRow() == -1 ){
         assert( LenBlkCol() == -1 && LenBlkRow() == -1 );
 		const unsigned int nblk = this->NBlkMatCol();
 		////////////////
-		for(unsigned int iblk=0;iblk<nblk;iblk++){
+#if defined(_OPENMP)
+#pragma omp parallel for
+#endif
+		for(int iiblk=0;iiblk<(int)nblk;iiblk++){ const unsigned int iblk = iiblk;
 			double* iyval = y.m_Value+y.m_DofPtr[iblk];
             const unsigned int nleni = y.Len(iblk);
             assert( this->LenBlkCol(iblk) == nleni );
@@ -969,33 +1115,8 @@ bool CMatDia_BlkCrs::MatVec(double alpha, const CVector_Blk& x, double beta, CVe
 	const unsigned int BlkLen = LenBlkCol();
 	const unsigned int BlkSize = BlkLen*BlkLen;
 
-	if( BlkLen == 1 ){
-		// RpĈ߂ɃXR[vɃoϐoĂ
-		const double* matval_nd  = m_valCrs_Blk;
-		const double* matval_dia = m_valDia_Blk;
-		const unsigned int* colind = m_colInd_Blk;
-		const unsigned int* rowptr = m_rowPtr_Blk;
-		const double* xval = x.m_Value;
-		double* yval = y.m_Value;
-		const unsigned int nblk = this->NBlkMatCol();
-		////////////////
-		for(unsigned int iblk=0;iblk<nblk;iblk++){
-			double* iyval = yval+iblk;
-			(*iyval) *= beta;
-			const unsigned int colind0 = colind[iblk];
-			const unsigned int colind1 = colind[iblk+1];
-			for(unsigned int icrs=colind0;icrs<colind1;icrs++){
-				assert( icrs < m_ncrs_Blk );
-				const unsigned int jblk0 = rowptr[icrs];
-				assert( jblk0 < nblk );
-				const double* jxval = xval+jblk0;
-				(*iyval) += alpha * matval_nd[icrs] * (*jxval);
-			}
-			const double* ixval = xval + iblk;
-			(*iyval) += alpha * matval_dia[iblk] * (*ixval);
-		}
-	}
-	else if( BlkLen == 2 ){
+	if( MatVec_Len<false>(BlkLen,NBlkMatCol(),m_colInd_Blk,m_rowPtr_Blk,m_valCrs_Blk,m_valDia_Blk,alpha,x.m_Value,beta,y.m_Value,dot) ) return true;
+	{
 		// RpĈ߂ɃXR[vɃoϐoĂ
 		const double* matval_nd  = m_valCrs_Blk;
 		const double* matval_dia = m_valDia_Blk;
@@ -1005,68 +1126,10 @@ bool CMatDia_BlkCrs::MatVec(double alpha, const CVector_Blk& x, double beta, CVe
 		double* yval = y.m_Value;
 		const unsigned int nblk = this->NBlkMatCol();
 		////////////////
-		for(unsigned int iblk=0;iblk<nblk;iblk++){
-			double* iyval = yval+iblk*2;
-			iyval[0] *= beta; 
-			iyval[1] *= beta;
-			const unsigned int icrs0 = colind[iblk];
-			const unsigned int icrs1 = colind[iblk+1];
-			for(unsigned int icrs=icrs0;icrs<icrs1;icrs++){
-				assert( icrs < m_ncrs_Blk );
-				const unsigned int jblk0 = rowptr[icrs];
-				assert( jblk0 < nblk );
-				const double* jxval = xval+jblk0*2;
-				iyval[0] += alpha * ( matval_nd[icrs*4  ]*jxval[0] + matval_nd[icrs*4+1]*jxval[1] );
-				iyval[1] += alpha * ( matval_nd[icrs*4+2]*jxval[0] + matval_nd[icrs*4+3]*jxval[1] );
-			}
-			const double* ixval = xval + iblk*2;
-			iyval[0] += alpha * ( matval_dia[iblk*4  ]*ixval[0] + matval_dia[iblk*4+1]*ixval[1] );
-			iyval[1] += alpha * ( matval_dia[iblk*4+2]*ixval[0] + matval_dia[iblk*4+3]*ixval[1] );
-		}
-	}
-	else if( BlkLen == 3 ){
-		// RpĈ߂ɃXR[vɃoϐoĂ
-		const double* matval_nd  = m_valCrs_Blk;
-		const double* matval_dia = m_valDia_Blk;
-		const unsigned int* colind = m_colInd_Blk;
-		const unsigned int* rowptr = m_rowPtr_Blk;
-		const double* xval = x.m_Value;
-		double* yval = y.m_Value;
-		const unsigned int nblk = this->NBlkMatCol();
-		////////////////
-		for(unsigned int iblk=0;iblk<nblk;iblk++){
-			double* iyval = yval+iblk*3;
-			iyval[0] *= beta; 
-			iyval[1] *= beta;
-			iyval[2] *= beta;
-			const unsigned int icrs0 = colind[iblk];
-			const unsigned int icrs1 = colind[iblk+1];
-			for(unsigned int icrs=icrs0;icrs<icrs1;icrs++){
-				assert( icrs < m_ncrs_Blk );
-				const unsigned int jblk0 = rowptr[icrs];
-				assert( jblk0 < nblk );
-				const double* jxval = xval+jblk0*3;
-				iyval[0] += alpha * ( matval_nd[icrs*9  ]*jxval[0] + matval_nd[icrs*9+1]*jxval[1] + matval_nd[icrs*9+2]*jxval[2] );
-				iyval[1] += alpha * ( matval_nd[icrs*9+3]*jxval[0] + matval_nd[icrs*9+4]*jxval[1] + matval_nd[icrs*9+5]*jxval[2] );
-				iyval[2] += alpha * ( matval_nd[icrs*9+6]*jxval[0] + matval_nd[icrs*9+7]*jxval[1] + matval_nd[icrs*9+8]*jxval[2] );
-			}
-			const double* ixval = xval + iblk*3;
-			iyval[0] += alpha * ( matval_dia[iblk*9  ]*ixval[0] + matval_dia[iblk*9+1]*ixval[1] + matval_dia[iblk*9+2]*ixval[2] );
-			iyval[1] += alpha * ( matval_dia[iblk*9+3]*ixval[0] + matval_dia[iblk*9+4]*ixval[1] + matval_dia[iblk*9+5]*ixval[2] );
-			iyval[2] += alpha * ( matval_dia[iblk*9+6]*ixval[0] + matval_dia[iblk*9+7]*ixval[1] + matval_dia[iblk*9+8]*ixval[2] );
-		}
-	}
-	else{
-		// RpĈ߂ɃXR[vɃoϐoĂ
-		const double* matval_nd  = m_valCrs_Blk;
-		const double* matval_dia = m_valDia_Blk;
-		const unsigned int* colind = m_colInd_Blk;
-		const unsigned int* rowptr = m_rowPtr_Blk;
-		const double* xval = x.m_Value;
-		double* yval = y.m_Value;
-		const unsigned int nblk = this->NBlkMatCol();
-		////////////////
-		for(unsigned int iblk=0;iblk<nblk;iblk++){
+#if defined(_OPENMP)
+#pragma omp parallel for
+#endif
+		for(int iiblk=0;iiblk<(int)nblk;iiblk++){ const unsigned int iblk = iiblk;
 			double* iyval = yval+iblk*BlkLen;
 			for(unsigned int idof=0;idof<BlkLen;idof++){ iyval[idof] *= beta; }
 			const unsigned int colind0 = colind[iblk];
@@ -1092,3 +1155,179 @@ bool CMatDia_BlkCrs::MatVec(double alpha, const CVector_Blk& x, double beta, CVe
 	}
 	return true;
 }
+
+// Calc Matrix Vector Product and the dot product of the result
+// {y} = alpha * [A]{x} + beta * {y},  return {x}*{y}
+double CMatDia_BlkCrs::MatVec_Dot(double alpha, const CVector_Blk& x, double beta, CVector_Blk& y) const
+{
+	assert( NBlkMatCol() == NBlkMatRow() );
+	assert( x.NBlk() == NBlkMatRow() );
+	assert( y.NBlk() == NBlkMatCol() );
+	assert( m_valDia_Blk != 0 );
+	if( LenBlkCol() != -1 && LenBlkRow() != -1 ){
+		assert( x.Len() == LenBlkRow() );
+		assert( y.Len() == LenBlkCol() );
+		double dot;
+		if( this->IsCompactPattern() ){
+			const SCompactPattern_Blk cp = this->GetCompactPattern();
+			if( MatVec_Len<true>(LenBlkCol(),NBlkMatCol(),m_colInd_Blk,&cp,m_valCrs_Blk,m_valDia_Blk,alpha,x.m_Value,beta,y.m_Value,dot) ) return dot;
+		}
+		else if( MatVec_Len<true>(LenBlkCol(),NBlkMatCol(),m_colInd_Blk,m_rowPtr_Blk,m_valCrs_Blk,m_valDia_Blk,alpha,x.m_Value,beta,y.m_Value,dot) ) return dot;
+	}
+	this->MatVec(alpha,x,beta,y);
+	return x*y;
+}
+
+// row loop of the product with the multi vector with the block length fixed at compile time
+template<unsigned int N, typename IND>
+static void MatMultiVec_Fix(const unsigned int nblk, const unsigned int* colind, const IND* rowptr, 
+                       const double* matval_nd, const double* matval_dia,
+                       const double alpha, const double* xval, const double beta, double* yval, const unsigned int ncol)
+{
+#if defined(_OPENMP)
+#pragma omp parallel for
+#endif
+	for(int iiblk=0;iiblk<(int)nblk;iiblk++){ const unsigned int iblk = iiblk;
+		double* iyval = yval+iblk*N*ncol;
+		Ker::ScaleMultiVec<N>(iyval,beta,ncol);
+		const CRowColBlk<IND> col(rowptr,colind,iblk);
+		const unsigned int icrs0 = colind[iblk];
+		const unsigned int icrs1 = colind[iblk+1];
+		for(unsigned int icrs=icrs0;icrs<icrs1;icrs++){
+			const unsigned int jblk0 = col[icrs];
+			assert( jblk0 < nblk );
+			Ker::AddMatMultiVec<N>(iyval,alpha,matval_nd+icrs*N*N,xval+jblk0*N*ncol,ncol);
+		}
+		Ker::AddMatMultiVec<N>(iyval,alpha,matval_dia+iblk*N*N,xval+iblk*N*ncol,ncol);
+	}
+}
+
+// dispatch to the block length, returns false if it is not one of 1,2,3,4,6
+template<typename IND>
+static bool MatMultiVec_Len(const int len, const unsigned int nblk, const unsigned int* colind, const IND* rowptr, 
+                            const double* matval_nd, const double* matval_dia,
+                            const double alpha, const double* xval, const double beta, double* yval, const unsigned int ncol)
+{
+	switch( len ){
+	case 1: MatMultiVec_Fix<1>(nblk,colind,rowptr,matval_nd,matval_dia,alpha,xval,beta,yval,ncol); return true;
+	case 2: MatMultiVec_Fix<2>(nblk,colind,rowptr,matval_nd,matval_dia,alpha,xval,beta,yval,ncol); return true;
+	case 3: MatMultiVec_Fix<3>(nblk,colind,rowptr,matval_nd,matval_dia,alpha,xval,beta,yval,ncol); return true;
+	case 4: MatMultiVec_Fix<4>(nblk,colind,rowptr,matval_nd,matval_dia,alpha,xval,beta,yval,ncol); return true;
+	case 6: MatMultiVec_Fix<6>(nblk,colind,rowptr,matval_nd,matval_dia,alpha,xval,beta,yval,ncol); return true;
+	default: break;
+	}
+	return false;
+}
+
+// Calc Matrix Vector Product for all the columns of the multi vector
+// {y_icol} = alpha * [A]{x_icol} + beta * {y_icol}
+bool CMatDia_BlkCrs::MatVec_Multi(double alpha, const CMultiVector_Blk& x, double beta, CMultiVector_Blk& y) const
+{
+	assert( NBlkMatCol() == NBlkMatRow() );
+	if( LenBlkCol() == -1 || LenBlkRow() == -1 ){
+		std::cout << "Error!-->Not Implemented" << std::endl;
+		assert(0);
+		return false;
+	}
+	const unsigned int BlkLen = LenBlkCol();
+	const unsigned int nblk = this->NBlkMatCol();
+	assert( x.NBlk() == nblk && x.Len() == BlkLen );
+	assert( y.NBlk() == nblk && y.Len() == BlkLen );
+	assert( x.NCol() == y.NCol() );
+	if( m_valDia_Blk == 0 ){ assert(0); return false; }	// see MatVec
+	const unsigned int ncol = x.NCol();
+	if( this->IsCompactPattern() ){	// compact pattern (only for the fixed block length)
+		const SCompactPattern_Blk cp = this->GetCompactPattern();
+		const bool res = MatMultiVec_Len(BlkLen,nblk,m_colInd_Blk,&cp,m_valCrs_Blk,m_valDia_Blk,alpha,x.m_Value,beta,y.m_Value,ncol);
+		assert( res );
+		return res;
+	}
+	if( MatMultiVec_Len(BlkLen,nblk,m_colInd_Blk,m_rowPtr_Blk,m_valCrs_Blk,m_valDia_Blk,alpha,x.m_Value,beta,y.m_Value,ncol) ) return true;
+	{	// column by column
+		CVector_Blk xc(nblk,BlkLen), yc(nblk,BlkLen);
+		for(unsigned int icol=0;icol<ncol;icol++){
+			x.GetColumn(icol,xc);
+			y.GetColumn(icol,yc);
+			this->MatVec(alpha,xc,beta,yc);
+			y.SetColumn(icol,yc);
+		}
+	}
+	return true;
+}
+
+void CMatDia_BlkCrs::ClearCompactPattern()
+{
+	if( m_rowOfs_Blk != 0 ){ delete[] m_rowOfs_Blk; m_rowOfs_Blk = 0; }
+	m_aWideRow.clear();
+	m_aWideInd.clear();
+	m_aWideCol.clear();
+}
+
+bool CMatDia_BlkCrs::SetCompactPattern(bool is_compact)
+{
+	if( is_compact == this->IsCompactPattern() ) return true;
+	const unsigned int nblk = this->NBlkMatCol();
+	if( !is_compact ){	// come back to the 32bit index
+		unsigned int* rowptr = new unsigned int [m_ncrs_Blk];
+		const SCompactPattern_Blk cp = this->GetCompactPattern();
+		for(unsigned int iblk=0;iblk<nblk;iblk++){
+			const CRowColBlk<SCompactPattern_Blk> col(&cp,m_colInd_Blk,iblk);
+			for(unsigned int icrs=m_colInd_Blk[iblk];icrs<m_colInd_Blk[iblk+1];icrs++){
+				rowptr[icrs] = col[icrs];
+			}
+		}
+		this->ClearCompactPattern();
+		m_rowPtr_Blk = rowptr;
+		return true;
+	}
+	if( !IsFixBlkLen(LenBlkCol()) || LenBlkCol() != LenBlkRow() ) return false;
+	if( m_rowPtr_Blk == 0 ) return false;
+	// the rows with an offset over 16bit keep the 32bit index
+	// (-32768 is left for the mark WIDE_ROW)
+	std::vector<unsigned int> aWideRow;
+	unsigned int nwide_crs = 0;
+	for(unsigned int iblk=0;iblk<nblk;iblk++){
+		for(unsigned int icrs=m_colInd_Blk[iblk];icrs<m_colInd_Blk[iblk+1];icrs++){
+			const int iofs = (int)m_rowPtr_Blk[icrs]-(int)iblk;
+			if( iofs >= -32767 && iofs <= 32767 ) continue;
+			aWideRow.push_back(iblk);
+			nwide_crs += m_colInd_Blk[iblk+1]-m_colInd_Blk[iblk];
+			break;
+		}
+	}
+	if( nwide_crs*2 > m_ncrs_Blk ) return false;
+	m_aWideRow.swap(aWideRow);
+	const unsigned int nwide = m_aWideRow.size();
+	m_aWideInd.resize(nwide+1);
+	m_aWideCol.reserve(nwide_crs);
+	m_rowOfs_Blk = new short [m_ncrs_Blk];
+	unsigned int iwide = 0;
+	for(unsigned int iblk=0;iblk<nblk;iblk++){
+		if( iwide < nwide && m_aWideRow[iwide] == iblk ){
+			m_aWideInd[iwide] = m_aWideCol.size();
+			for(unsigned int icrs=m_colInd_Blk[iblk];icrs<m_colInd_Blk[iblk+1];icrs++){
+				m_aWideCol.push_back(m_rowPtr_Blk[icrs]);
+				m_rowOfs_Blk[icrs] = 0;
+			}
+			m_rowOfs_Blk[ m_colInd_Blk[iblk] ] = SCompactPattern_Blk::WIDE_ROW;
+			iwide++;
+			continue;
+		}
+		for(unsigned int icrs=m_colInd_Blk[iblk];icrs<m_colInd_Blk[iblk+1];icrs++){
+			m_rowOfs_Blk[icrs] = (short)((int)m_rowPtr_Blk[icrs]-(int)iblk);
+		}
+	}
+	m_aWideInd[nwide] = m_aWideCol.size();
+	delete[] m_rowPtr_Blk; m_rowPtr_Blk = 0;
+	return true;
+}
+
+std::size_t CMatDia_BlkCrs::NBytePattern() const
+{
+	std::size_t nbyte = CMat_BlkCrs::NBytePattern();
+	if( m_rowOfs_Blk != 0 ){
+		nbyte += m_ncrs_Blk*sizeof(short);
+		nbyte += (m_aWideRow.size()+m_aWideInd.size()+m_aWideCol.size())*sizeof(unsigned int);
+	}
+	return nbyte;
+}
@@ -24,7 +24,9 @@
 #if defined(__VISUALC__)
 #pragma warning( disable : 4786 )   // C4786Ȃĕ\( ߄D)٧
 #endif
+#if !defined(_OPENMP)
 #define for if(0); else for
+#endif
 
 #include <cassert>
 #include <iostream>
@@ -36,7 +38,10 @@
 #include "delfem/matvec/matdiafrac_blkcrs.h"
 #include "delfem/matvec/matfrac_blkcrs.h"
 #include "delfem/matvec/vector_blk.h"
+#include "delfem/matvec/multivector_blk.h"
 #include "delfem/matvec/ordering_blk.h"
+#include "delfem/matvec/ker_blk.h"
+#include "delfem/parallel.h"
 
 //#include "ker_mat.h"
 
@@ -156,6 +161,371 @@ static inline void CalcInvMat3(double a[], double t[] )
 	a[7] = inv_det*(t[1]*t[6]-t[0]*t[7]);
 	a[8] = inv_det*(t[0]*t[4]-t[1]*t[3]);
 }
+// forward substitution of the iblk-th row with the block length fixed at compile time
+// the diagonal blocks are stored already inverted
+template<unsigned int N, typename REAL, typename IND>
+static inline void ForwardSubstitution_Row(const unsigned int iblk, 
+                                           const unsigned int* colind, const unsigned int* diaind, const IND* rowptr,
+                                           const REAL* matval_nd, const REAL* matval_dia, double* vecval)
+{
+	double pTmpVec[N];
+	for(unsigned int idof=0;idof<N;idof++){ pTmpVec[idof] = vecval[iblk*N+idof]; }
+	const CRowColBlk<IND> col(rowptr,colind,iblk);
+	for(unsigned int ijcrs=colind[iblk];ijcrs<diaind[iblk];ijcrs++){
+		const unsigned int jblk0 = col[ijcrs];
+		assert( jblk0<iblk );
+		Ker::SubMatVec<N>(pTmpVec,matval_nd+ijcrs*N*N,vecval+jblk0*N);
+	}
+	Ker::SetMatVec<N>(vecval+iblk*N,matval_dia+iblk*N*N,pTmpVec);
+}
+
+// backward substitution of the iblk-th row with the block length fixed at compile time
+template<unsigned int N, typename REAL, typename IND>
+static inline void BackwardSubstitution_Row(const unsigned int iblk, const unsigned int nblk,
+                                            const unsigned int* colind, const unsigned int* diaind, const IND* rowptr,
+                                            const REAL* matval_nd, double* vecval)
+{
+	double* pVec_i = vecval+iblk*N;
+	const CRowColBlk<IND> col(rowptr,colind,iblk);
+	for(unsigned int ijcrs=diaind[iblk];ijcrs<colind[iblk+1];ijcrs++){
+		const unsigned int jblk0 = col[ijcrs];
+		assert( jblk0>iblk && jblk0<nblk );
+		Ker::SubMatVec<N>(pVec_i,matval_nd+ijcrs*N*N,vecval+jblk0*N);
+	}
+}
+
+// forward substitution with the block length fixed at compile time
+// if levind is not empty the rows in a level are substituted in parallel
+template<unsigned int N, typename REAL, typename IND>
+static void ForwardSubstitution_Fix(const unsigned int nblk, 
+                                    const unsigned int* colind, const unsigned int* diaind, const IND* rowptr,
+                                    const REAL* matval_nd, const REAL* matval_dia, double* vecval,
+                                    const std::vector<unsigned int>& levind, const std::vector<unsigned int>& levblk)
+{
+	if( levind.empty() ){
+		for(unsigned int iblk=0;iblk<nblk;iblk++){
+			ForwardSubstitution_Row<N>(iblk,colind,diaind,rowptr,matval_nd,matval_dia,vecval);
+		}
+		return;
+	}
+	const unsigned int nlev = levind.size()-1;
+#if defined(_OPENMP)
+#pragma omp parallel
+#endif
+	{
+		for(unsigned int ilev=0;ilev<nlev;ilev++){
+#if defined(_OPENMP)
+#pragma omp for schedule(static)
+#endif
+			for(int ii=(int)levind[ilev];ii<(int)levind[ilev+1];ii++){
+				ForwardSubstitution_Row<N>(levblk[ii],colind,diaind,rowptr,matval_nd,matval_dia,vecval);
+			}
+			// the barrier at the end of "omp for" makes this level visible to the next level
+		}
+	}
+}
+
+// backward substitution with the block length fixed at compile time
+// if levind is not empty the rows in a level are substituted in parallel
+template<unsigned int N, typename REAL, typename IND>
+static void BackwardSubstitution_Fix(const unsigned int nblk, 
+                                     const unsigned int* colind, const unsigned int* diaind, const IND* rowptr,
+                                     const REAL* matval_nd, double* vecval,
+                                     const std::vector<unsigned int>& levind, const std::vector<unsigned int>& levblk)
+{
+	if( levind.empty() ){
+		for(unsigned int iblk=nblk;iblk-->0;){
+			BackwardSubstitution_Row<N>(iblk,nblk,colind,diaind,rowptr,matval_nd,vecval);
+		}
+		return;
+	}
+	const unsigned int nlev = levind.size()-1;
+#if defined(_OPENMP)
+#pragma omp parallel
+#endif
+	{
+		for(unsigned int ilev=0;ilev<nlev;ilev++){
+#if defined(_OPENMP)
+#pragma omp for schedule(static)
+#endif
+			for(int ii=(int)levind[ilev];ii<(int)levind[ilev+1];ii++){
+				BackwardSubstitution_Row<N>(levblk[ii],nblk,colind,diaind,rowptr,matval_nd,vecval);
+			}
+		}
+	}
+}
+
+// forward substitution of the iblk-th row for all the columns of the multi vector
+// tmp is a work array of size N*ncol
+template<unsigned int N, typename REAL, typename IND>
+static inline void ForwardSubstitutionMulti_Row(const unsigned int iblk, 
+                                                const unsigned int* colind, const unsigned int* diaind, const IND* rowptr,
+                                                const REAL* matval_nd, const REAL* matval_dia, double* vecval, 
+                                                const unsigned int ncol, double* tmp)
+{
+	double* ival = vecval+iblk*N*ncol;
+	for(unsigned int i=0;i<N*ncol;i++){ tmp[i] = ival[i]; }
+	const CRowColBlk<IND> col(rowptr,colind,iblk);
+	for(unsigned int ijcrs=colind[iblk];ijcrs<diaind[iblk];ijcrs++){
+		const unsigned int jblk0 = col[ijcrs];
+		assert( jblk0<iblk );
+		Ker::SubMatMultiVec<N>(tmp,matval_nd+ijcrs*N*N,vecval+jblk0*N*ncol,ncol);
+	}
+	Ker::SetMatMultiVec<N>(ival,matval_dia+iblk*N*N,tmp,ncol);
+}
+
+// backward substitution of the iblk-th row for all the columns of the multi vector
+template<unsigned int N, typename REAL, typename IND>
+static inline void BackwardSubstitutionMulti_Row(const unsigned int iblk, const unsigned int nblk,
+                                                 const unsigned int* colind, const unsigned int* diaind, const IND* rowptr,
+                                                 const REAL* matval_nd, double* vecval, const unsigned int ncol)
+{
+	double* ival = vecval+iblk*N*ncol;
+	const CRowColBlk<IND> col(rowptr,colind,iblk);
+	for(unsigned int ijcrs=diaind[iblk];ijcrs<colind[iblk+1];ijcrs++){
+		const unsigned int jblk0 = col[ijcrs];
+		assert( jblk0>iblk && jblk0<nblk );
+		Ker::SubMatMultiVec<N>(ival,matval_nd+ijcrs*N*N,vecval+jblk0*N*ncol,ncol);
+	}
+}
+
+// forward substitution of the multi vector (the factor is read once for all the columns)
+template<unsigned int N, typename REAL, typename IND>
+static void ForwardSubstitutionMulti_Fix(const unsigned int nblk, 
+                                         const unsigned int* colind, const unsigned int* diaind, const IND* rowptr,
+                                         const REAL* matval_nd, const REAL* matval_dia, double* vecval, const unsigned int ncol,
+                                         const std::vector<unsigned int>& levind, const std::vector<unsigned int>& levblk)
+{
+	if( levind.empty() ){
+		std::vector<double> tmp(N*ncol);
+		for(unsigned int iblk=0;iblk<nblk;iblk++){
+			ForwardSubstitutionMulti_Row<N>(iblk,colind,diaind,rowptr,matval_nd,matval_dia,vecval,ncol,&tmp[0]);
+		}
+		return;
+	}
+	const unsigned int nlev = levind.size()-1;
+#if defined(_OPENMP)
+#pragma omp parallel
+#endif
+	{
+		std::vector<double> tmp(N*ncol);	// one work array per thread
+		for(unsigned int ilev=0;ilev<nlev;ilev++){
+#if defined(_OPENMP)
+#pragma omp for schedule(static)
+#endif
+			for(int ii=(int)levind[ilev];ii<(int)levind[ilev+1];ii++){
+				ForwardSubstitutionMulti_Row<N>(levblk[ii],colind,diaind,rowptr,matval_nd,matval_dia,vecval,ncol,&tmp[0]);
+			}
+		}
+	}
+}
+
+// backward substitution of the multi vector
+template<unsigned int N, typename REAL, typename IND>
+static void BackwardSubstitutionMulti_Fix(const unsigned int nblk, 
+                                          const unsigned int* colind, const unsigned int* diaind, const IND* rowptr,
+                                          const REAL* matval_nd, double* vecval, const unsigned int ncol,
+                                          const std::vector<unsigned int>& levind, const std::vector<unsigned int>& levblk)
+{
+	if( levind.empty() ){
+		for(unsigned int iblk=nblk;iblk-->0;){
+			BackwardSubstitutionMulti_Row<N>(iblk,nblk,colind,diaind,rowptr,matval_nd,vecval,ncol);
+		}
+		return;
+	}
+	const unsigned int nlev = levind.size()-1;
+#if defined(_OPENMP)
+#pragma omp parallel
+#endif
+	{
+		for(unsigned int ilev=0;ilev<nlev;ilev++){
+#if defined(_OPENMP)
+#pragma omp for schedule(static)
+#endif
+			for(int ii=(int)levind[ilev];ii<(int)levind[ilev+1];ii++){
+				BackwardSubstitutionMulti_Row<N>(levblk[ii],nblk,colind,diaind,rowptr,matval_nd,vecval,ncol);
+			}
+		}
+	}
+}
+
+// dispatch to the block length, returns false if it is not one of 1,2,3,4,6
+template<typename REAL, typename IND>
+static bool ForwardSubstitution_Len(const int len, const unsigned int nblk, 
+                                    const unsigned int* colind, const unsigned int* diaind, const IND* rowptr,
+                                    const REAL* matval_nd, const REAL* matval_dia, double* vecval,
+                                    const std::vector<unsigned int>& levind, const std::vector<unsigned int>& levblk)
+{
+	switch( len ){
+	case 1: ForwardSubstitution_Fix<1>(nblk,colind,diaind,rowptr,matval_nd,matval_dia,vecval,levind,levblk); return true;
+	case 2: ForwardSubstitution_Fix<2>(nblk,colind,diaind,rowptr,matval_nd,matval_dia,vecval,levind,levblk); return true;
+	case 3: ForwardSubstitution_Fix<3>(nblk,colind,diaind,rowptr,matval_nd,matval_dia,vecval,levind,levblk); return true;
+	case 4: ForwardSubstitution_Fix<4>(nblk,colind,diaind,rowptr,matval_nd,matval_dia,vecval,levind,levblk); return true;
+	case 6: ForwardSubstitution_Fix<6>(nblk,colind,diaind,rowptr,matval_nd,matval_dia,vecval,levind,levblk); return true;
+	default: break;
+	}
+	return false;
+}
+
+template<typename REAL, typename IND>
+static bool BackwardSubstitution_Len(const int len, const unsigned int nblk, 
+                                     const unsigned int* colind, const unsigned int* diaind, const IND* rowptr,
+                                     const REAL* matval_nd, double* vecval,
+                                     const std::vector<unsigned int>& levind, const std::vector<unsigned int>& levblk)
+{
+	switch( len ){
+	case 1: BackwardSubstitution_Fix<1>(nblk,colind,diaind,rowptr,matval_nd,vecval,levind,levblk); return true;
+	case 2: BackwardSubstitution_Fix<2>(nblk,colind,diaind,rowptr,matval_nd,vecval,levind,levblk); return true;
+	case 3: BackwardSubstitution_Fix<3>(nblk,colind,diaind,rowptr,matval_nd,vecval,levind,levblk); return true;
+	case 4: BackwardSubstitution_Fix<4>(nblk,colind,diaind,rowptr,matval_nd,vecval,levind,levblk); return true;
+	case 6: BackwardSubstitution_Fix<6>(nblk,colind,diaind,rowptr,matval_nd,vecval,levind,levblk); return true;
+	default: break;
+	}
+	return false;
+}
+
+template<typename REAL, typename IND>
+static bool ForwardSubstitutionMulti_Len(const int len, const unsigned int nblk, 
+                                         const unsigned int* colind, const unsigned int* diaind, const IND* rowptr,
+                                         const REAL* matval_nd, const REAL* matval_dia, double* vecval, const unsigned int ncol,
+                                         const std::vector<unsigned int>& levind, const std::vector<unsigned int>& levblk)
+{
+	switch( len ){
+	case 1: ForwardSubstitutionMulti_Fix<1>(nblk,colind,diaind,rowptr,matval_nd,matval_dia,vecval,ncol,levind,levblk); return true;
+	case 2: ForwardSubstitutionMulti_Fix<2>(nblk,colind,diaind,rowptr,matval_nd,matval_dia,vecval,ncol,levind,levblk); return true;
+	case 3: ForwardSubstitutionMulti_Fix<3>(nblk,colind,diaind,rowptr,matval_nd,matval_dia,vecval,ncol,levind,levblk); return true;
+	case 4: ForwardSubstitutionMulti_Fix<4>(nblk,colind,diaind,rowptr,matval_nd,matval_dia,vecval,ncol,levind,levblk); return true;
+	case 6: ForwardSubstitutionMulti_Fix<6>(nblk,colind,diaind,rowptr,matval_nd,matval_dia,vecval,ncol,levind,levblk); return true;
+	default: break;
+	}
+	return false;
+}
+
+template<typename REAL, typename IND>
+static bool BackwardSubstitutionMulti_Len(const int len, const unsigned int nblk, 
+                                          const unsigned int* colind, const unsigned int* diaind, const IND* rowptr,
+                                          const REAL* matval_nd, double* vecval, const unsigned int ncol,
+                                          const std::vector<unsigned int>& levind, const std::vector<unsigned int>& levblk)
+{
+	switch( len ){
+	case 1: BackwardSubstitutionMulti_Fix<1>(nblk,colind,diaind,rowptr,matval_nd,vecval,ncol,levind,levblk); return true;
+	case 2: BackwardSubstitutionMulti_Fix<2>(nblk,colind,diaind,rowptr,matval_nd,vecval,ncol,levind,levblk); return true;
+	case 3: BackwardSubstitutionMulti_Fix<3>(nblk,colind,diaind,rowptr,matval_nd,vecval,ncol,levind,levblk); return true;
+	case 4: BackwardSubstitutionMulti_Fix<4>(nblk,colind,diaind,rowptr,matval_nd,vecval,ncol,levind,levblk); return true;
+	case 6: BackwardSubstitutionMulti_Fix<6>(nblk,colind,diaind,rowptr,matval_nd,vecval,ncol,levind,levblk); return true;
+	default: break;
+	}
+	return false;
+}
+
+// invert the diagonal block. returns false (leaving the block as it is) if the block is singular
+template<unsigned int N>
+static inline bool InvDiaBlk(double* a)
+{
+	if( N == 1 ){
+		if( fabs(a[0]) > 1.0e-30 ){ a[0] = 1.0 / a[0]; return true; }
+		return false;
+	}
+	if( N == 2 ){
+		const double det = a[0]*a[3]-a[1]*a[2];
+		if( fabs(det) > 1.0e-30 ){
+			const double inv_det = 1.0/det;
+			const double dtmp1 = a[0];
+			a[0] =  inv_det*a[3];
+			a[1] = -inv_det*a[1];
+			a[2] = -inv_det*a[2];
+			a[3] =  inv_det*dtmp1;
+			return true;
+		}
+		return false;
+	}
+	if( N == 3 ){
+		const double det = a[0]*a[4]*a[8] + a[3]*a[7]*a[2] + a[6]*a[1]*a[5]
+		- a[0]*a[7]*a[5] - a[6]*a[4]*a[2] - a[3]*a[1]*a[8];
+		if( fabs(det) > 1.0e-30 ){
+			double tmpBlk[9];
+			CalcInvMat3(a,tmpBlk);
+			return true;
+		}
+		return false;
+	}
+	int info = 0;
+	CalcInvMat(a,N,info);
+	return info != 1;
+}
+
+// ILU decomposition of the iblk-th row with the block length fixed at compile time
+// the rows in the lower part of iblk-th row have to be decomposed already.
+// row2crs is filled with -1 on input and it is restored on output
+template<unsigned int N>
+static bool ILUDecomp_Row(const unsigned int iblk, 
+                          const unsigned int* colind, const unsigned int* diaind, const unsigned int* rowptr,
+                          double* matval_nd, double* matval_dia, int* row2crs)
+{
+	const unsigned int BlkSize = N*N;
+	for(unsigned int ijcrs=colind[iblk];ijcrs<colind[iblk+1];ijcrs++){
+		row2crs[ rowptr[ijcrs] ] = ijcrs;
+	}
+	// [L] * [D^-1*U]
+	for(unsigned int ikcrs=colind[iblk];ikcrs<diaind[iblk];ikcrs++){
+		const unsigned int kblk = rowptr[ikcrs]; assert( kblk<iblk );
+		const double* pVal_ik = matval_nd+ikcrs*BlkSize;
+		for(unsigned int kjcrs=diaind[kblk];kjcrs<colind[kblk+1];kjcrs++){
+			const unsigned int jblk0 = rowptr[kjcrs];
+			double* pVal_ij = 0;
+			if( jblk0 != iblk ){
+				const int ijcrs0 = row2crs[jblk0];
+				if( ijcrs0 == -1 ) continue;
+				pVal_ij = matval_nd+ijcrs0*BlkSize;
+			}
+			else{ pVal_ij = matval_dia+iblk*BlkSize; }
+			Ker::SubMatMat<N>(pVal_ij,pVal_ik,matval_nd+kjcrs*BlkSize);
+		}
+	}
+	const double* pVal_ii = matval_dia+iblk*BlkSize;
+	const bool is_inv = InvDiaBlk<N>(matval_dia+iblk*BlkSize);
+	// [U] = [1/D][U]
+	for(unsigned int ijcrs=diaind[iblk];ijcrs<colind[iblk+1];ijcrs++){
+		Ker::MulMatLeft<N>(matval_nd+ijcrs*BlkSize,pVal_ii);
+	}
+	for(unsigned int ijcrs=colind[iblk];ijcrs<colind[iblk+1];ijcrs++){
+		row2crs[ rowptr[ijcrs] ] = -1;
+	}
+	return is_inv;
+}
+
+// level scheduled parallel ILU decomposition with the block length fixed at compile time
+template<unsigned int N>
+static bool ILUDecomp_Level(const unsigned int nblk,
+                            const unsigned int* colind, const unsigned int* diaind, const unsigned int* rowptr,
+                            double* matval_nd, double* matval_dia,
+                            const std::vector<unsigned int>& levind, const std::vector<unsigned int>& levblk,
+                            const unsigned int nmax_sing)
+{
+	assert( !levind.empty() );
+	const unsigned int nlev = levind.size()-1;
+	const unsigned int nthread = Com::GetNumThread();
+	std::vector<int> aRow2Crs(nblk*nthread,-1);
+	unsigned int icnt_sing = 0;
+#if defined(_OPENMP)
+#pragma omp parallel reduction(+:icnt_sing)
+#endif
+	{
+		int* row2crs = &aRow2Crs[ Com::GetThreadIndex()*nblk ];
+		for(unsigned int ilev=0;ilev<nlev;ilev++){
+#if defined(_OPENMP)
+#pragma omp for schedule(static)
+#endif
+			for(int ii=(int)levind[ilev];ii<(int)levind[ilev+1];ii++){
+				const unsigned int iblk = levblk[ii];
+				if( ILUDecomp_Row<N>(iblk,colind,diaind,rowptr,matval_nd,matval_dia,row2crs) ) continue;
+				icnt_sing++;
+			}
+		}
+	}
+	return icnt_sing <= nmax_sing;
+}
+
 //////////////////////////////////////////////////////////////////////
 // \z/
 //////////////////////////////////////////////////////////////////////
@@ -165,6 +535,8 @@ CMatDiaFrac_BlkCrs::CMatDiaFrac_BlkCrs(const unsigned int nblk_colrow, const uns
 {
 	m_ConditionFlag = 0;
 	m_DiaInd = 0;
+	m_valCrs_Flt = 0;
+	m_valDia_Flt = 0;
 	m_pRowLev = 0;
 }
 
@@ -172,6 +544,8 @@ CMatDiaFrac_BlkCrs::CMatDiaFrac_BlkCrs(const CMatDia_BlkCrs& rhs)
 {
 	m_ConditionFlag = -1;
 	m_DiaInd = 0;
+	m_valCrs_Flt = 0;
+	m_valDia_Flt = 0;
 	m_pRowLev = 0;
   
   // TCYݒ肷
@@ -228,6 +602,8 @@ CMatDiaFrac_BlkCrs::CMatDiaFrac_BlkCrs(const int lev_fill, const CMatDia_BlkCrs&
 {	
 	m_ConditionFlag = -1;
 	m_DiaInd = 0;
+	m_valCrs_Flt = 0;
+	m_valDia_Flt = 0;
 	m_pRowLev = 0;
   
   // TCYݒ肷
@@ -292,6 +668,8 @@ CMatDiaFrac_BlkCrs::CMatDiaFrac_BlkCrs(
 {	
 	m_ConditionFlag = 0;
 	m_DiaInd = 0;
+	m_valCrs_Flt = 0;
+	m_valDia_Flt = 0;
 	m_pRowLev = 0;
 	if( lev_fill == 0 ){
 		CMatDia_BlkCrs::AddPattern(rhs,order);
@@ -327,6 +705,105 @@ CMatDiaFrac_BlkCrs::~CMatDiaFrac_BlkCrs()
 {
 	if( m_DiaInd != 0 ){ delete[] m_DiaInd; }
 	if( m_pRowLev != 0 ){ delete m_pRowLev; }
+	if( m_valCrs_Flt != 0 ){ delete[] m_valCrs_Flt; }
+	if( m_valDia_Flt != 0 ){ delete[] m_valDia_Flt; }
+}
+
+bool CMatDiaFrac_BlkCrs::SetSinglePrecision(bool is_single)
+{
+	if( is_single == this->IsSinglePrecision() ) return true;
+	const unsigned int nblk = this->NBlkMatCol();
+	if( is_single ){
+		if( !IsFixBlkLen(LenBlkCol()) || LenBlkCol() != LenBlkRow() ) return false;
+		if( m_valCrs_Blk == 0 || m_valDia_Blk == 0 ) return false;
+		const unsigned int blksize = LenBlkCol()*LenBlkRow();
+		const unsigned int ncrsval = m_ncrs_Blk*blksize;
+		const unsigned int ndiaval = nblk*blksize;
+		m_valCrs_Flt = new float [ncrsval];
+		m_valDia_Flt = new float [ndiaval];
+		for(unsigned int ival=0;ival<ncrsval;ival++){ m_valCrs_Flt[ival] = (float)m_valCrs_Blk[ival]; }
+		for(unsigned int ival=0;ival<ndiaval;ival++){ m_valDia_Flt[ival] = (float)m_valDia_Blk[ival]; }
+		delete[] m_valCrs_Blk; m_valCrs_Blk = 0;
+		delete[] m_valDia_Blk; m_valDia_Blk = 0;
+		return true;
+	}
+	// allocate the double values again (the factor has to be computed again)
+	const unsigned int blksize = LenBlkCol()*LenBlkRow();
+	m_valCrs_Blk = new double [m_ncrs_Blk*blksize];
+	m_valDia_Blk = new double [nblk*blksize];
+	delete[] m_valCrs_Flt; m_valCrs_Flt = 0;
+	delete[] m_valDia_Flt; m_valDia_Flt = 0;
+	return true;
+}
+
+bool CMatDiaFrac_BlkCrs::SetCompactPattern(bool is_compact)
+{
+	if( is_compact == this->IsCompactPattern() ) return true;
+	if( is_compact ){
+		if( m_rowPtr_Blk == 0 || m_ConditionFlag != 2 ) return false;
+		this->MakeLevelSchedule();	// made from m_rowPtr_Blk
+	}
+	return CMatDia_BlkCrs::SetCompactPattern(is_compact);
+}
+
+std::size_t CMatDiaFrac_BlkCrs::NBytePattern() const
+{
+	std::size_t nbyte = CMatDia_BlkCrs::NBytePattern();
+	if( m_DiaInd != 0 ){ nbyte += NBlkMatCol()*sizeof(unsigned int); }
+	return nbyte;
+}
+
+// Level of a row is one more than the largest level of the rows it depends on.
+// Rows are bucketed by level so that each level is a contiguous range of m_aLevBlk*.
+void CMatDiaFrac_BlkCrs::MakeLevelSchedule()
+{
+	if( !m_aLevIndFwd.empty() ) return;
+	if( m_DiaInd == 0 || m_rowPtr_Blk == 0 || m_ConditionFlag != 2 ) return;
+	const unsigned int nblk = this->NBlkMatCol();
+	std::vector<unsigned int> aLev(nblk,0);
+	for(unsigned int ibwd=0;ibwd<2;ibwd++){
+		unsigned int nlev = 0;
+		for(unsigned int i=0;i<nblk;i++){
+			const unsigned int iblk = ( ibwd == 0 ) ? i : nblk-1-i;
+			const unsigned int icrs0 = ( ibwd == 0 ) ? m_colInd_Blk[iblk] : m_DiaInd[iblk];
+			const unsigned int icrs1 = ( ibwd == 0 ) ? m_DiaInd[iblk] : m_colInd_Blk[iblk+1];
+			unsigned int ilev = 0;
+			for(unsigned int ijcrs=icrs0;ijcrs<icrs1;ijcrs++){
+				const unsigned int jblk0 = m_rowPtr_Blk[ijcrs];
+				assert( (ibwd==0 && jblk0<iblk) || (ibwd==1 && jblk0>iblk) );
+				if( aLev[jblk0]+1 > ilev ){ ilev = aLev[jblk0]+1; }
+			}
+			aLev[iblk] = ilev;
+			if( ilev+1 > nlev ){ nlev = ilev+1; }
+		}
+		std::vector<unsigned int>& aInd = ( ibwd == 0 ) ? m_aLevIndFwd : m_aLevIndBwd;
+		std::vector<unsigned int>& aBlk = ( ibwd == 0 ) ? m_aLevBlkFwd : m_aLevBlkBwd;
+		aInd.assign(nlev+1,0);
+		for(unsigned int iblk=0;iblk<nblk;iblk++){ aInd[ aLev[iblk]+1 ]++; }
+		for(unsigned int ilev=0;ilev<nlev;ilev++){ aInd[ilev+1] += aInd[ilev]; }
+		aBlk.resize(nblk);
+		for(unsigned int iblk=0;iblk<nblk;iblk++){
+			const unsigned int ilev = aLev[iblk];
+			aBlk[ aInd[ilev] ] = iblk;
+			aInd[ilev]++;
+		}
+		for(unsigned int ilev=nlev;ilev>0;ilev--){ aInd[ilev] = aInd[ilev-1]; }
+		aInd[0] = 0;
+	}
+}
+
+bool CMatDiaFrac_BlkCrs::IsLevelSchedule() const
+{
+	const unsigned int nthread = Com::GetNumThread();
+	if( nthread < 2 ) return false;
+	if( LenBlkCol() == -1 || LenBlkRow() == -1 ) return false;
+	if( m_aLevIndFwd.empty() ) return false;	// not factorized yet
+	// a barrier per level costs about as much as a few dozen rows, so the levels have to be wide
+	const unsigned int nblk = this->NBlkMatCol();
+	const unsigned int nlev_fwd = m_aLevIndFwd.size()-1;
+	const unsigned int nlev_bwd = m_aLevIndBwd.size()-1;
+	const unsigned int nlev = ( nlev_fwd > nlev_bwd ) ? nlev_fwd : nlev_bwd;
+	return nblk >= nlev*nthread*8;
 }
 
 bool CMatDiaFrac_BlkCrs::ForwardSubstitution( CVector_Blk& vec ) const
@@ -336,8 +813,8 @@ bool CMatDiaFrac_BlkCrs::ForwardSubstitution( CVector_Blk& vec ) const
 	assert( vec.NBlk() == NBlkMatCol() );
 	assert( vec.Len() == LenBlkCol() );
   
-  assert( m_valCrs_Blk !=0 );
-  assert( m_valDia_Blk != 0 );
+  assert( m_valCrs_Blk != 0 || m_valCrs_Flt != 0 );
+  assert( m_valDia_Blk != 0 || m_valDia_Flt != 0 );
 
   
   if( LenBlkCol() == -1 || LenBlkRow() == -1 ){
@@ -385,95 +862,23 @@ bool CMatDiaFrac_BlkCrs::ForwardSubstitution( CVector_Blk& vec ) const
   
   assert( LenBlkCol() >= 0 || LenBlkRow() >= 0 );
   
-	if( LenBlkCol() == 1 ){	// ubNs̃TCY1~Pȏꍇ
-		// ̂߂Ƀoϐ[JɃRs[
-		const unsigned int* colind = m_colInd_Blk;
-		const unsigned int* rowptr = m_rowPtr_Blk;
-		const unsigned int* diaind = m_DiaInd;
-		const double* matval_nd = m_valCrs_Blk;
-		const double* matval_dia = m_valDia_Blk;
-		const unsigned int nblk = this->NBlkMatCol();
-		for(unsigned int iblk=0;iblk<nblk;iblk++){	// Oi
-			double lvec_i = vec.GetValue(iblk,0);
-			for(unsigned int ijcrs=colind[iblk];ijcrs<diaind[iblk];ijcrs++){
-				assert( ijcrs<m_ncrs_Blk );
-				const unsigned int jblk0 = rowptr[ijcrs];
-				assert( jblk0<iblk );
-				lvec_i -= matval_nd[ijcrs]*vec.GetValue(jblk0,0);
-			}
-			vec.SetValue(iblk,0,matval_dia[iblk]*lvec_i);
-		}
+  const std::vector<unsigned int> aNoLev;
+  const std::vector<unsigned int>& levind = ( this->IsLevelSchedule() ) ? m_aLevIndFwd : aNoLev;
+	if( this->IsCompactPattern() ){	// compact pattern
+		const SCompactPattern_Blk cp = this->GetCompactPattern();
+		const bool res = ( this->IsSinglePrecision() ) ?
+			ForwardSubstitution_Len(LenBlkCol(),NBlkMatCol(),m_colInd_Blk,m_DiaInd,&cp,m_valCrs_Flt,m_valDia_Flt,vec.m_Value,levind,m_aLevBlkFwd) :
+			ForwardSubstitution_Len(LenBlkCol(),NBlkMatCol(),m_colInd_Blk,m_DiaInd,&cp,m_valCrs_Blk,m_valDia_Blk,vec.m_Value,levind,m_aLevBlkFwd);
+		assert( res );
+		return res;
 	}
-	else if( LenBlkCol() == 2 ){
-		// ̂߂Ƀoϐ[JɃRs[
-		const unsigned int* colind = m_colInd_Blk;
-		const unsigned int* rowptr = m_rowPtr_Blk;
-		const unsigned int* diaind = m_DiaInd;
-		const double* matval_nd = m_valCrs_Blk;
-		const double* matval_dia = m_valDia_Blk;
-		const unsigned int nblk = this->NBlkMatCol();
-		////////////////
-		double pTmpVec[2];
-		for(unsigned int iblk=0;iblk<nblk;iblk++){
-			pTmpVec[0] = vec.GetValue(iblk,0);
-			pTmpVec[1] = vec.GetValue(iblk,1);
-			const unsigned int icrs0 = colind[iblk];
-			const unsigned int icrs1 = diaind[iblk];
-			for(unsigned int ijcrs=icrs0;ijcrs<icrs1;ijcrs++){
-				assert( ijcrs<m_ncrs_Blk );
-				const unsigned int jblk0 = rowptr[ijcrs];
-				assert( jblk0<iblk );
-				const double* pVal_ij = &matval_nd[ijcrs*4];
-        const double valj0 = vec.GetValue(jblk0,0);
-				const double valj1 = vec.GetValue(jblk0,1);
-				pTmpVec[0] -= pVal_ij[0]*valj0+pVal_ij[1]*valj1;
-				pTmpVec[1] -= pVal_ij[2]*valj0+pVal_ij[3]*valj1;
-			}
-			const double* pVal_ii = &matval_dia[iblk*4];
-			const double dtmp1 = pVal_ii[0]*pTmpVec[0]+pVal_ii[1]*pTmpVec[1];
-			vec.SetValue(iblk,0,dtmp1);
-			const double dtmp2 = pVal_ii[2]*pTmpVec[0]+pVal_ii[3]*pTmpVec[1];
-			vec.SetValue(iblk,1,dtmp2);
-		}
+	if( this->IsSinglePrecision() ){	// the factor in float, the vector in double
+		const bool res = ForwardSubstitution_Len(LenBlkCol(),NBlkMatCol(),m_colInd_Blk,m_DiaInd,m_rowPtr_Blk,m_valCrs_Flt,m_valDia_Flt,vec.m_Value,levind,m_aLevBlkFwd);
+		assert( res );
+		return res;
 	}
-	else if( LenBlkCol() == 3 ){
-		// ̂߂Ƀoϐ[JɃRs[
-		const unsigned int* colind = m_colInd_Blk;
-		const unsigned int* rowptr = m_rowPtr_Blk;
-		const unsigned int* diaind = m_DiaInd;
-		const double* matval_nd = m_valCrs_Blk;
-		const double* matval_dia = m_valDia_Blk;
-		const unsigned int nblk = this->NBlkMatCol();
-		////////////////
-		double pTmpVec[3];
-		for(unsigned int iblk=0;iblk<nblk;iblk++){
-			pTmpVec[0] = vec.GetValue(iblk,0);
-			pTmpVec[1] = vec.GetValue(iblk,1);
-			pTmpVec[2] = vec.GetValue(iblk,2);
-			const unsigned int icrs0 = colind[iblk];
-			const unsigned int icrs1 = diaind[iblk];
-			for(unsigned int ijcrs=icrs0;ijcrs<icrs1;ijcrs++){
-				assert( ijcrs<m_ncrs_Blk );
-				const unsigned int jblk0 = rowptr[ijcrs];
-				assert( jblk0<iblk );
-				const double* pVal_ij = &matval_nd[ijcrs*9];
-				const double valj0 = vec.GetValue(jblk0,0);
-				const double valj1 = vec.GetValue(jblk0,1);
-				const double valj2 = vec.GetValue(jblk0,2);
-				pTmpVec[0] -= pVal_ij[0]*valj0+pVal_ij[1]*valj1+pVal_ij[2]*valj2;
-				pTmpVec[1] -= pVal_ij[3]*valj0+pVal_ij[4]*valj1+pVal_ij[5]*valj2;
-				pTmpVec[2] -= pVal_ij[6]*valj0+pVal_ij[7]*valj1+pVal_ij[8]*valj2;
-			}
-			const double* pVal_ii = &matval_dia[iblk*9];
-			const double dtmp1 = pVal_ii[0]*pTmpVec[0]+pVal_ii[1]*pTmpVec[1]+pVal_ii[2]*pTmpVec[2];
-			vec.SetValue(iblk,0,dtmp1);
-			const double dtmp2 = pVal_ii[3]*pTmpVec[0]+pVal_ii[4]*pTmpVec[1]+pVal_ii[5]*pTmpVec[2];
-			vec.SetValue(iblk,1,dtmp2);
-			const double dtmp3 = pVal_ii[6]*pTmpVec[0]+pVal_ii[7]*pTmpVec[1]+pVal_ii[8]*pTmpVec[2];
-			vec.SetValue(iblk,2,dtmp3);
-		}
-	}
-	else{	// ubNs̃TCY3~3傫ꍇ
+	if( ForwardSubstitution_Len(LenBlkCol(),NBlkMatCol(),m_colInd_Blk,m_DiaInd,m_rowPtr_Blk,m_valCrs_Blk,m_valDia_Blk,vec.m_Value,levind,m_aLevBlkFwd) ) return true;
+	{
 		const unsigned int BlkLen = LenBlkCol();
 		const unsigned int BlkSize = BlkLen*BlkLen;
 		double* pTmpVec = new double [BlkLen];	// Ɨp̏Ȕz
@@ -557,89 +962,23 @@ bool CMatDiaFrac_BlkCrs::BackwardSubstitution( CVector_Blk& vec ) const
     return true;
   }
   
-	if( LenBlkCol() == 1 ){	// ubNs̃TCY1~Pȏꍇ
-		// ̂߂Ƀoϐ[JɃRs[
-		const unsigned int* colind = m_colInd_Blk;
-		const unsigned int* rowptr = m_rowPtr_Blk;
-		const unsigned int* diaind = m_DiaInd;
-		const double* matval_nd = m_valCrs_Blk;
-		const unsigned int nblk = this->NBlkMatCol();
-		////////////////
-		for(int iblk=nblk-1;iblk>=0;iblk--){	// ޑ
-			assert( (unsigned int)iblk < nblk );
-			double lvec_i = vec.GetValue(iblk,0);
-			for(unsigned int ijcrs=diaind[iblk];ijcrs<colind[iblk+1];ijcrs++){
-				assert( ijcrs<m_ncrs_Blk );
-				const unsigned int jblk0 = rowptr[ijcrs];
-				assert( jblk0>(unsigned int)iblk && jblk0<nblk );
-				lvec_i -=  matval_nd[ijcrs]*vec.GetValue(jblk0,0);
-			}
-			vec.SetValue(iblk,0,lvec_i);
-		}
+  const std::vector<unsigned int> aNoLev;
+  const std::vector<unsigned int>& levind = ( this->IsLevelSchedule() ) ? m_aLevIndBwd : aNoLev;
+	if( this->IsCompactPattern() ){	// compact pattern
+		const SCompactPattern_Blk cp = this->GetCompactPattern();
+		const bool res = ( this->IsSinglePrecision() ) ?
+			BackwardSubstitution_Len(LenBlkCol(),NBlkMatCol(),m_colInd_Blk,m_DiaInd,&cp,m_valCrs_Flt,vec.m_Value,levind,m_aLevBlkBwd) :
+			BackwardSubstitution_Len(LenBlkCol(),NBlkMatCol(),m_colInd_Blk,m_DiaInd,&cp,m_valCrs_Blk,vec.m_Value,levind,m_aLevBlkBwd);
+		assert( res );
+		return res;
 	}
-	else if( LenBlkCol() == 2 ){
-		// ̂߂Ƀoϐ[JɃRs[
-		const unsigned int* colind = m_colInd_Blk;
-		const unsigned int* rowptr = m_rowPtr_Blk;
-		const unsigned int* diaind = m_DiaInd;
-		const double* valmat_nd = m_valCrs_Blk;
-		const unsigned int nblk = this->NBlkMatCol();
-		////////////////
-		double pTmpVec[2];
-		for(int iblk=nblk-1;iblk>=0;iblk--){
-			assert( (unsigned int)iblk < nblk );
-			pTmpVec[0] = vec.GetValue(iblk,0);
-			pTmpVec[1] = vec.GetValue(iblk,1);
-			const unsigned int icrs0 = diaind[iblk];
-			const unsigned int icrs1 = colind[iblk+1];
-			for(unsigned int ijcrs=icrs0;ijcrs<icrs1;ijcrs++){
-				assert( ijcrs<m_ncrs_Blk );
-				const unsigned int jblk0 = rowptr[ijcrs];
-				assert( jblk0>(unsigned int)iblk && jblk0<nblk );
-				const double* pVal_ij = &valmat_nd[ijcrs*4];
-				const double valj0 = vec.GetValue(jblk0,0);
-				const double valj1 = vec.GetValue(jblk0,1);
-				pTmpVec[0] -= pVal_ij[0]*valj0+pVal_ij[1]*valj1;
-				pTmpVec[1] -= pVal_ij[2]*valj0+pVal_ij[3]*valj1;
-			}
-			vec.SetValue(iblk,0,pTmpVec[0]);
-			vec.SetValue(iblk,1,pTmpVec[1]);
-		}
+	if( this->IsSinglePrecision() ){	// the factor in float, the vector in double
+		const bool res = BackwardSubstitution_Len(LenBlkCol(),NBlkMatCol(),m_colInd_Blk,m_DiaInd,m_rowPtr_Blk,m_valCrs_Flt,vec.m_Value,levind,m_aLevBlkBwd);
+		assert( res );
+		return res;
 	}
-	else if( LenBlkCol() == 3 ){
-		// ̂߂Ƀoϐ[JɃRs[
-		const unsigned int* colind = m_colInd_Blk;
-		const unsigned int* rowptr = m_rowPtr_Blk;
-		const unsigned int* diaind = m_DiaInd;
-		const double* valmat_nd = m_valCrs_Blk;
-		const unsigned int nblk = this->NBlkMatCol();
-		////////////////
-		double pTmpVec[3];
-		for(int iblk=nblk-1;iblk>=0;iblk--){
-			assert( (unsigned int)iblk < nblk );
-			pTmpVec[0] = vec.GetValue(iblk,0);
-			pTmpVec[1] = vec.GetValue(iblk,1);
-			pTmpVec[2] = vec.GetValue(iblk,2);
-			const unsigned int icrs0 = diaind[iblk];
-			const unsigned int icrs1 = colind[iblk+1];
-			for(unsigned int ijcrs=icrs0;ijcrs<icrs1;ijcrs++){
-				assert( ijcrs<m_ncrs_Blk );
-				const unsigned int jblk0 = rowptr[ijcrs];
-				assert( jblk0>(unsigned int)iblk && jblk0<nblk );
-				const double* pVal_ij = &valmat_nd[ijcrs*9];
-				const double valj0 = vec.GetValue(jblk0,0);
-				const double valj1 = vec.GetValue(jblk0,1);
-				const double valj2 = vec.GetValue(jblk0,2);
-				pTmpVec[0] -= pVal_ij[0]*valj0+pVal_ij[1]*valj1+pVal_ij[2]*valj2;
-				pTmpVec[1] -= pVal_ij[3]*valj0+pVal_ij[4]*valj1+pVal_ij[5]*valj2;
-				pTmpVec[2] -= pVal_ij[6]*valj0+pVal_ij[7]*valj1+pVal_ij[8]*valj2;
-			}
-			vec.SetValue(iblk,0,pTmpVec[0]);
-			vec.SetValue(iblk,1,pTmpVec[1]);
-			vec.SetValue(iblk,2,pTmpVec[2]);
-		}
-	}
-	else{
+	if( BackwardSubstitution_Len(LenBlkCol(),NBlkMatCol(),m_colInd_Blk,m_DiaInd,m_rowPtr_Blk,m_valCrs_Blk,vec.m_Value,levind,m_aLevBlkBwd) ) return true;
+	{
 		const unsigned int BlkLen = LenBlkCol();
 		const unsigned int BlkSize = BlkLen*BlkLen;
 		double* pTmpVec = new double [BlkLen];	// Ɨp̏Ȕz
@@ -668,6 +1007,83 @@ bool CMatDiaFrac_BlkCrs::BackwardSubstitution( CVector_Blk& vec ) const
 	return true;
 }
 
+bool CMatDiaFrac_BlkCrs::ForwardSubstitution( CMultiVector_Blk& vec ) const
+{
+	assert( NBlkMatRow() == NBlkMatCol() );
+	assert( vec.NBlk() == NBlkMatCol() );
+	if( LenBlkCol() == -1 || LenBlkRow() == -1 ){
+		std::cout << "Error!-->Not Implemented" << std::endl;
+		assert(0);
+		return false;
+	}
+	assert( vec.Len() == (unsigned int)LenBlkCol() );
+	const unsigned int ncol = vec.NCol();
+	const std::vector<unsigned int> aNoLev;
+	const std::vector<unsigned int>& levind = ( this->IsLevelSchedule() ) ? m_aLevIndFwd : aNoLev;
+	if( this->IsCompactPattern() ){	// compact pattern
+		const SCompactPattern_Blk cp = this->GetCompactPattern();
+		const bool res = ( this->IsSinglePrecision() ) ?
+			ForwardSubstitutionMulti_Len(LenBlkCol(),NBlkMatCol(),m_colInd_Blk,m_DiaInd,&cp,m_valCrs_Flt,m_valDia_Flt,vec.m_Value,ncol,levind,m_aLevBlkFwd) :
+			ForwardSubstitutionMulti_Len(LenBlkCol(),NBlkMatCol(),m_colInd_Blk,m_DiaInd,&cp,m_valCrs_Blk,m_valDia_Blk,vec.m_Value,ncol,levind,m_aLevBlkFwd);
+		assert( res );
+		return res;
+	}
+	if( this->IsSinglePrecision() ){	// the factor in float, the vector in double
+		const bool res = ForwardSubstitutionMulti_Len(LenBlkCol(),NBlkMatCol(),m_colInd_Blk,m_DiaInd,m_rowPtr_Blk,m_valCrs_Flt,m_valDia_Flt,vec.m_Value,ncol,levind,m_aLevBlkFwd);
+		assert( res );
+		return res;
+	}
+	if( ForwardSubstitutionMulti_Len(LenBlkCol(),NBlkMatCol(),m_colInd_Blk,m_DiaInd,m_rowPtr_Blk,m_valCrs_Blk,m_valDia_Blk,vec.m_Value,ncol,levind,m_aLevBlkFwd) ) return true;
+	{	// column by column
+		CVector_Blk vc(vec.NBlk(),vec.Len());
+		for(unsigned int icol=0;icol<ncol;icol++){
+			vec.GetColumn(icol,vc);
+			this->ForwardSubstitution(vc);
+			vec.SetColumn(icol,vc);
+		}
+	}
+	return true;
+}
+
+bool CMatDiaFrac_BlkCrs::BackwardSubstitution( CMultiVector_Blk& vec ) const
+{
+	assert( NBlkMatRow() == NBlkMatCol() );
+	assert( vec.NBlk() == NBlkMatCol() );
+	if( this->NBlkMatCol() == 0 ) return true;
+	if( LenBlkCol() == -1 || LenBlkRow() == -1 ){
+		std::cout << "Error!-->Not Implemented" << std::endl;
+		assert(0);
+		return false;
+	}
+	assert( vec.Len() == (unsigned int)LenBlkCol() );
+	const unsigned int ncol = vec.NCol();
+	const std::vector<unsigned int> aNoLev;
+	const std::vector<unsigned int>& levind = ( this->IsLevelSchedule() ) ? m_aLevIndBwd : aNoLev;
+	if( this->IsCompactPattern() ){	// compact pattern
+		const SCompactPattern_Blk cp = this->GetCompactPattern();
+		const bool res = ( this->IsSinglePrecision() ) ?
+			BackwardSubstitutionMulti_Len(LenBlkCol(),NBlkMatCol(),m_colInd_Blk,m_DiaInd,&cp,m_valCrs_Flt,vec.m_Value,ncol,levind,m_aLevBlkBwd) :
+			BackwardSubstitutionMulti_Len(LenBlkCol(),NBlkMatCol(),m_colInd_Blk,m_DiaInd,&cp,m_valCrs_Blk,vec.m_Value,ncol,levind,m_aLevBlkBwd);
+		assert( res );
+		return res;
+	}
+	if( this->IsSinglePrecision() ){	// the factor in float, the vector in double
+		const bool res = BackwardSubstitutionMulti_Len(LenBlkCol(),NBlkMatCol(),m_colInd_Blk,m_DiaInd,m_rowPtr_Blk,m_valCrs_Flt,vec.m_Value,ncol,levind,m_aLevBlkBwd);
+		assert( res );
+		return res;
+	}
+	if( BackwardSubstitutionMulti_Len(LenBlkCol(),NBlkMatCol(),m_colInd_Blk,m_DiaInd,m_rowPtr_Blk,m_valCrs_Blk,vec.m_Value,ncol,levind,m_aLevBlkBwd) ) return true;
+	{	// column by column
+		CVector_Blk vc(vec.NBlk(),vec.Len());
+		for(unsigned int icol=0;icol<ncol;icol++){
+			vec.GetColumn(icol,vc);
+			this->BackwardSubstitution(vc);
+			vec.SetColumn(icol,vc);
+		}
+	}
+	return true;
+}
+
 bool CMatDiaFrac_BlkCrs::DoILUDecompLowUp( const CMatFrac_BlkCrs& mat_low, const CMatFrac_BlkCrs& mat_up )
 {
 	assert( NBlkMatRow() == NBlkMatCol() );
@@ -675,6 +1091,7 @@ bool CMatDiaFrac_BlkCrs::DoILUDecompLowUp( const CMatFrac_BlkCrs& mat_low, const
 	assert( mat_low.NBlkMatCol() == NBlkMatCol() );
 	assert( mat_up.NBlkMatRow() == NBlkMatRow() );
 	assert( LenBlkRow() == LenBlkCol() );
+	this->MakeLevelSchedule();	// the substitutions use it
   
 	const unsigned int nblk = NBlkMatCol();
 	const unsigned int nblk_dia = mat_up.NBlkMatCol();
@@ -778,6 +1195,7 @@ bool CMatDiaFrac_BlkCrs::DoILUDecomp()
 	assert( this->LenBlkRow() == LenBlkCol() );
 	const unsigned int nmax_sing = 10;	// ubNILUɎsĂ̏
 	unsigned int icnt_sing = 0;
+	this->MakeLevelSchedule();	// here and not in the const substitutions, which may run on multiple threads
   
   if( LenBlkCol() == -1 || LenBlkRow() == -1 ){
     if( LenBlkCol() >= 0 || LenBlkRow() >= 0 ){
@@ -853,6 +1271,17 @@ bool CMatDiaFrac_BlkCrs::DoILUDecomp()
     return true;
   }
   
+	if( this->IsLevelSchedule() ){
+		switch( LenBlkCol() ){
+		case 1: return ILUDecomp_Level<1>(NBlkMatCol(),m_colInd_Blk,m_DiaInd,m_rowPtr_Blk,m_valCrs_Blk,m_valDia_Blk,m_aLevIndFwd,m_aLevBlkFwd,nmax_sing);
+		case 2: return ILUDecomp_Level<2>(NBlkMatCol(),m_colInd_Blk,m_DiaInd,m_rowPtr_Blk,m_valCrs_Blk,m_valDia_Blk,m_aLevIndFwd,m_aLevBlkFwd,nmax_sing);
+		case 3: return ILUDecomp_Level<3>(NBlkMatCol(),m_colInd_Blk,m_DiaInd,m_rowPtr_Blk,m_valCrs_Blk,m_valDia_Blk,m_aLevIndFwd,m_aLevBlkFwd,nmax_sing);
+		case 4: return ILUDecomp_Level<4>(NBlkMatCol(),m_colInd_Blk,m_DiaInd,m_rowPtr_Blk,m_valCrs_Blk,m_valDia_Blk,m_aLevIndFwd,m_aLevBlkFwd,nmax_sing);
+		case 6: return ILUDecomp_Level<6>(NBlkMatCol(),m_colInd_Blk,m_DiaInd,m_rowPtr_Blk,m_valCrs_Blk,m_valDia_Blk,m_aLevIndFwd,m_aLevBlkFwd,nmax_sing);
+		default: break;
+		}
+	}
+
 	const unsigned int BlkLen = LenBlkCol();
 	const unsigned int BlkSize = BlkLen*BlkLen;
   
@@ -1109,6 +1538,7 @@ bool CMatDiaFrac_BlkCrs::DoILUDecomp()
 
 bool CMatDiaFrac_BlkCrs::AddFracPtnLowUp( const int lev_fill, const CMatFrac_BlkCrs& mat_low, const CMatFrac_BlkCrs& mat_up )
 {
+	this->ClearLevelSchedule();
 	assert( NBlkMatRow() == NBlkMatCol() );
 	assert( mat_low.NBlkMatCol() == NBlkMatCol() );
 	assert( mat_up.NBlkMatRow() == NBlkMatRow() );
@@ -1253,6 +1683,7 @@ bool CMatDiaFrac_BlkCrs::AddFracPtnLowUp( const int lev_fill, const CMatFrac_Blk
 
 bool CMatDiaFrac_BlkCrs::AddFracPtn(const int lev_fill)
 {
+	this->ClearLevelSchedule();
 	assert( NBlkMatCol() == NBlkMatRow() );
   
 	assert( m_ConditionFlag != -1 );
@@ -1381,6 +1812,7 @@ bool CMatDiaFrac_BlkCrs::AddFracPtn(const int lev_fill)
 }
 
 bool CMatDiaFrac_BlkCrs::AddFracPtn(const int lev_fill, const std::vector<unsigned int>& aBlkFill){
+	this->ClearLevelSchedule();
 	assert( NBlkMatCol() == NBlkMatRow() );
   
 	assert( m_ConditionFlag != -1 );
@@ -1534,6 +1966,8 @@ bool CMatDiaFrac_BlkCrs::SetValue(const CMatDia_BlkCrs& rhs)
 		MakePatternFinalize();
 		assert( m_ConditionFlag == 2 );
 	}
+	this->SetSinglePrecision(false);
+	this->SetCompactPattern(false);
   // ̍s̒lɂOZbgāC̍s̒lZbg
 	this->SetValue_Initialize(rhs);
 	this->DoILUDecomp();
@@ -1567,6 +2001,8 @@ bool CMatDiaFrac_BlkCrs::SetValue(const CMatDia_BlkCrs& rhs, const COrdering_Blk
 	else if( m_ConditionFlag == 1 ){
 		MakePatternFinalize();
 	}
+	this->SetSinglePrecision(false);
+	this->SetCompactPattern(false);
   // ̍s̒lɂOZbgāC̍s̒lZbg
   this->SetValue_Initialize(rhs,order);
   /*
@@ -1589,6 +2025,7 @@ bool CMatDiaFrac_BlkCrs::SetValue(const CMatDia_BlkCrs& rhs, const COrdering_Blk
 
 bool CMatDiaFrac_BlkCrs::MakePattern_Initialize(const CMatDia_BlkCrs& rhs)
 {
+	this->ClearLevelSchedule();
   if( m_ConditionFlag == -1 ){
     if( rhs.LenBlkCol() == -1 ){
       const unsigned int nblk = rhs.NBlkMatCol();
@@ -1642,6 +2079,7 @@ bool CMatDiaFrac_BlkCrs::MakePattern_Initialize(const CMatDia_BlkCrs& rhs)
 
 bool CMatDiaFrac_BlkCrs::MakePattern_Initialize(const CMatDia_BlkCrs& rhs, const COrdering_Blk& order)
 {
+	this->ClearLevelSchedule();
 	assert( NBlkMatRow() == NBlkMatCol() );
 	assert( rhs.NBlkMatCol() == rhs.NBlkMatRow()   );
 	assert( order.NBlk() == rhs.NBlkMatCol()   );
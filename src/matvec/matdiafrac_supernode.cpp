@@ -0,0 +1,617 @@
+/*
+DelFEM (Finite Element Analysis)
+Copyright (C) 2009  Nobuyuki Umetani    n.umetani@gmail.com
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+////////////////////////////////////////////////////////////////
+// matdiafrac_supernode.cpp : implementation of the supernodal LDL^T factorization (CMatDiaFrac_Supernode)
+////////////////////////////////////////////////////////////////
+
+#if defined(__VISUALC__)
+#pragma warning( disable : 4786 )
+#endif
+
+#include <math.h>
+#include <assert.h>
+#include <iostream>
+#include <vector>
+#include <algorithm>
+
+#include "delfem/matvec/matdiafrac_supernode.h"
+
+using namespace MatVec;
+
+void CMatDiaFrac_Supernode::Clear()
+{
+	m_ndof = 0;
+	m_aPerm.clear();
+	m_aInvPerm.clear();
+	m_aLowPtr.clear();
+	m_aLowRow.clear();
+	m_aLowVal.clear();
+	m_aSnColPtr.clear();
+	m_aSnRowPtr.clear();
+	m_aSnRow.clear();
+	m_aSnParent.clear();
+	m_aSubtree.clear();
+	m_aSnTop.clear();
+	m_aSnValPtr.clear();
+	m_aSnVal.clear();
+	m_aDia.clear();
+}
+
+unsigned int CMatDiaFrac_Supernode::NNonZeroFactor() const
+{
+	unsigned int nnz = 0;
+	for(unsigned int isn=0;isn<this->NSuperNode();isn++){
+		const unsigned int ncol = m_aSnColPtr[isn+1]-m_aSnColPtr[isn];
+		const unsigned int nrow = m_aSnRowPtr[isn+1]-m_aSnRowPtr[isn];
+		nnz += ncol*nrow - ncol*(ncol-1)/2;
+	}
+	return nnz;
+}
+
+// lower triangle of the permuted matrix by column (row and index of the value)
+static void MakeLowerPattern(unsigned int n, 
+		const std::vector<unsigned int>& aRowPtr, const std::vector<unsigned int>& aColInd, 
+		const std::vector<unsigned int>& aInvPerm, 
+		std::vector<unsigned int>& aLowPtr, std::vector<unsigned int>& aLowRow, std::vector<unsigned int>& aLowVal)
+{
+	aLowPtr.assign(n+1,0);
+	for(unsigned int i=0;i<n;i++){
+		for(unsigned int k=aRowPtr[i];k<aRowPtr[i+1];k++){
+			const unsigned int pi = aInvPerm[i];
+			const unsigned int pj = aInvPerm[ aColInd[k] ];
+			if( pi >= pj ){ aLowPtr[pj+1]++; }
+		}
+	}
+	for(unsigned int j=0;j<n;j++){ aLowPtr[j+1] += aLowPtr[j]; }
+	aLowRow.resize(aLowPtr[n]);
+	aLowVal.resize(aLowPtr[n]);
+	std::vector<unsigned int> aCur(aLowPtr.begin(),aLowPtr.end()-1);
+	for(unsigned int i=0;i<n;i++){
+		for(unsigned int k=aRowPtr[i];k<aRowPtr[i+1];k++){
+			const unsigned int pi = aInvPerm[i];
+			const unsigned int pj = aInvPerm[ aColInd[k] ];
+			if( pi < pj ) continue;
+			aLowRow[ aCur[pj] ] = pi;
+			aLowVal[ aCur[pj] ] = k;
+			aCur[pj]++;
+		}
+	}
+}
+
+// elimination tree (Liu's algorithm with path compression)
+static void MakeEliminationTree(unsigned int n, 
+		const std::vector<unsigned int>& aLowPtr, const std::vector<unsigned int>& aLowRow, 
+		std::vector<int>& aParent)
+{
+	// strictly lower pattern by row
+	std::vector<unsigned int> aRowPtr(n+1,0);
+	for(unsigned int k=0;k<aLowRow.size();k++){ aRowPtr[ aLowRow[k]+1 ]++; }
+	for(unsigned int i=0;i<n;i++){ aRowPtr[i+1] += aRowPtr[i]; }
+	std::vector<unsigned int> aCol(aRowPtr[n]);
+	{
+		std::vector<unsigned int> aCur(aRowPtr.begin(),aRowPtr.end()-1);
+		for(unsigned int j=0;j<n;j++){
+			for(unsigned int k=aLowPtr[j];k<aLowPtr[j+1];k++){
+				const unsigned int i = aLowRow[k];
+				aCol[ aCur[i] ] = j;
+				aCur[i]++;
+			}
+		}
+	}
+	aParent.assign(n,-1);
+	std::vector<int> aAncestor(n,-1);
+	for(unsigned int i=0;i<n;i++){
+		for(unsigned int k=aRowPtr[i];k<aRowPtr[i+1];k++){
+			int r = aCol[k];
+			if( r == (int)i ) continue;
+			while( aAncestor[r] != -1 && aAncestor[r] != (int)i ){
+				const int r1 = aAncestor[r];
+				aAncestor[r] = i;
+				r = r1;
+			}
+			if( aAncestor[r] == -1 ){
+				aAncestor[r] = i;
+				aParent[r] = i;
+			}
+		}
+	}
+}
+
+// children of the tree in crs format (ascending order)
+static void MakeChildren(const std::vector<int>& aParent, 
+		std::vector<unsigned int>& aChildPtr, std::vector<unsigned int>& aChild)
+{
+	const unsigned int n = aParent.size();
+	aChildPtr.assign(n+1,0);
+	for(unsigned int j=0;j<n;j++){ if( aParent[j] != -1 ) aChildPtr[ aParent[j]+1 ]++; }
+	for(unsigned int j=0;j<n;j++){ aChildPtr[j+1] += aChildPtr[j]; }
+	aChild.resize(aChildPtr[n]);
+	std::vector<unsigned int> aCur(aChildPtr.begin(),aChildPtr.end()-1);
+	for(unsigned int j=0;j<n;j++){
+		if( aParent[j] == -1 ) continue;
+		aChild[ aCur[aParent[j]] ] = j;
+		aCur[aParent[j]]++;
+	}
+}
+
+bool CMatDiaFrac_Supernode::MakePattern(unsigned int ndof, 
+		const std::vector<unsigned int>& aRowPtr, const std::vector<unsigned int>& aColInd, 
+		const std::vector<unsigned int>& aPerm)
+{
+	this->Clear();
+	if( aRowPtr.size() != ndof+1 || aColInd.size() < aRowPtr[ndof] ){ assert(0); return false; }
+	if( !aPerm.empty() && aPerm.size() != ndof ){ assert(0); return false; }
+	m_ndof = ndof;
+	const unsigned int n = ndof;
+
+	{	// permutation
+		m_aPerm.resize(n);
+		m_aInvPerm.resize(n,n);
+		for(unsigned int inew=0;inew<n;inew++){
+			const unsigned int iold = ( aPerm.empty() ) ? inew : aPerm[inew];
+			if( iold >= n || m_aInvPerm[iold] != n ){ assert(0); this->Clear(); return false; }
+			m_aPerm[inew] = iold;
+			m_aInvPerm[iold] = inew;
+		}
+	}
+
+	std::vector<int> aParent;
+	std::vector<unsigned int> aChildPtr, aChild;
+	{	// postorder the elimination tree so that the columns of a subtree are contiguous (the fill does not change)
+		MakeLowerPattern(n,aRowPtr,aColInd,m_aInvPerm,m_aLowPtr,m_aLowRow,m_aLowVal);
+		MakeEliminationTree(n,m_aLowPtr,m_aLowRow,aParent);
+		MakeChildren(aParent,aChildPtr,aChild);
+		std::vector<unsigned int> aPost;	aPost.reserve(n);
+		std::vector<unsigned int> aStack;
+		for(unsigned int jroot=0;jroot<n;jroot++){
+			if( aParent[jroot] != -1 ) continue;
+			aStack.push_back(jroot);
+			while( !aStack.empty() ){	// children are pushed in the descending order and popped after all of them
+				const unsigned int j = aStack.back();
+				if( j >= n ){ aStack.pop_back(); aPost.push_back(j-n); continue; }
+				aStack.back() = j+n;
+				for(unsigned int k=aChildPtr[j+1];k>aChildPtr[j];k--){ aStack.push_back(aChild[k-1]); }
+			}
+		}
+		assert( aPost.size() == n );
+		std::vector<unsigned int> aPerm0 = m_aPerm;
+		for(unsigned int inew=0;inew<n;inew++){
+			m_aPerm[inew] = aPerm0[ aPost[inew] ];
+			m_aInvPerm[ m_aPerm[inew] ] = inew;
+		}
+		MakeLowerPattern(n,aRowPtr,aColInd,m_aInvPerm,m_aLowPtr,m_aLowRow,m_aLowVal);
+		MakeEliminationTree(n,m_aLowPtr,m_aLowRow,aParent);
+		MakeChildren(aParent,aChildPtr,aChild);
+	}
+
+	// structure of each column of L : struct(j) = {j} + A(j+1:n,j) + struct(child)\{child}
+	// the column j joins the supernode of j-1 if j is the parent of j-1 and the explicit zeros of the merged panel are few (relaxed supernode)
+	std::vector< std::vector<unsigned int> > aStruct(n);
+	std::vector<unsigned int> aIsLast(n,1);	// the column is the last column of the supernode
+	std::vector<unsigned int> aSnFirst(1,0);
+	{
+		std::vector<int> aFlg(n,-1);
+		double nnz_sn = 0;	// number of the true nonzeros in the supernode
+		for(unsigned int j=0;j<n;j++){
+			std::vector<unsigned int>& s = aStruct[j];
+			s.push_back(j);
+			aFlg[j] = j;
+			for(unsigned int k=m_aLowPtr[j];k<m_aLowPtr[j+1];k++){
+				const unsigned int i = m_aLowRow[k];
+				if( aFlg[i] == (int)j ) continue;
+				aFlg[i] = j;
+				s.push_back(i);
+			}
+			for(unsigned int k=aChildPtr[j];k<aChildPtr[j+1];k++){
+				const std::vector<unsigned int>& sc = aStruct[ aChild[k] ];
+				for(unsigned int l=0;l<sc.size();l++){
+					const unsigned int i = sc[l];
+					if( i <= j || aFlg[i] == (int)j ) continue;
+					aFlg[i] = j;
+					s.push_back(i);
+				}
+			}
+			bool is_merge = false;
+			if( j > 0 && aParent[j-1] == (int)j ){
+				const unsigned int jfst = aSnFirst.back();
+				const double ncol = j-jfst+1;
+				const double nrow = ncol+s.size()-1;
+				const double nnz = nnz_sn+s.size();
+				const double nzero = ncol*nrow-ncol*(ncol-1)*0.5-nnz;
+				if(      aStruct[j-1].size() == s.size()+1 ){ is_merge = true; }	// fundamental supernode
+				else if( ncol <=  4 ){ is_merge = true; }
+				else if( ncol <= 16 ){ is_merge = ( nzero < 0.5*nnz ); }
+				else if( ncol <= 48 ){ is_merge = ( nzero < 0.1*nnz ); }
+				else{                  is_merge = ( nzero < 0.05*nnz ); }
+			}
+			if( is_merge ){
+				aIsLast[j-1] = 0;
+				nnz_sn += s.size();
+			}
+			else{
+				if( j > 0 ){ aSnFirst.push_back(j); }
+				nnz_sn = s.size();
+			}
+			for(unsigned int k=aChildPtr[j];k<aChildPtr[j+1];k++){
+				const unsigned int c = aChild[k];
+				if( !aIsLast[c] ){ std::vector<unsigned int>().swap(aStruct[c]); }
+			}
+		}
+	}
+
+	{	// supernodes
+		m_aSnColPtr = aSnFirst;
+		m_aSnColPtr.push_back(n);
+		const unsigned int nsn = m_aSnColPtr.size()-1;
+		std::vector<unsigned int> aCol2Sn(n);
+		for(unsigned int isn=0;isn<nsn;isn++){
+			for(unsigned int j=m_aSnColPtr[isn];j<m_aSnColPtr[isn+1];j++){ aCol2Sn[j] = isn; }
+		}
+		m_aSnRowPtr.resize(nsn+1);
+		m_aSnRowPtr[0] = 0;
+		m_aSnParent.resize(nsn,-1);
+		m_aSnValPtr.resize(nsn+1);
+		m_aSnValPtr[0] = 0;
+		for(unsigned int isn=0;isn<nsn;isn++){
+			const unsigned int jfst = m_aSnColPtr[isn];
+			const unsigned int jlst = m_aSnColPtr[isn+1]-1;
+			const unsigned int ncol = jlst-jfst+1;
+			std::vector<unsigned int>& s = aStruct[jlst];	// rows = [jfst,jlst] + struct(jlst)
+			assert( aIsLast[jlst] );
+			std::sort(s.begin(),s.end());
+			assert( s[0] == jlst );
+			for(unsigned int j=jfst;j<jlst;j++){ m_aSnRow.push_back(j); }
+			for(unsigned int k=0;k<s.size();k++){ m_aSnRow.push_back(s[k]); }
+			m_aSnRowPtr[isn+1] = m_aSnRow.size();
+			if( s.size() > 1 ){ m_aSnParent[isn] = aCol2Sn[ s[1] ]; }
+			m_aSnValPtr[isn+1] = m_aSnValPtr[isn] + (ncol+s.size()-1)*ncol;
+			std::vector<unsigned int>().swap(s);
+		}
+	}
+	m_aSnVal.resize(m_aSnValPtr[this->NSuperNode()],0.0);
+	m_aDia.resize(n,0.0);
+	this->MakeSubtree();
+	return true;
+}
+
+// independent subtrees of the supernode tree, made by splitting the heaviest subtree at its root
+// until no subtree has more than 1/16 of the flops (the split root is one of the supernodes above the subtrees)
+// the supernodes of a subtree are contiguous because the tree is postordered
+void CMatDiaFrac_Supernode::MakeSubtree()
+{
+	m_aSubtree.clear();
+	m_aSnTop.clear();
+	const unsigned int nsn = this->NSuperNode();
+	std::vector<double> aWork(nsn,0.0);	// flops of the subtree
+	std::vector<unsigned int> aSize(nsn,1);	// supernodes of the subtree
+	double work_total = 0.0;
+	for(unsigned int isn=0;isn<nsn;isn++){
+		const double ncol = m_aSnColPtr[isn+1]-m_aSnColPtr[isn];
+		const double nrow = m_aSnRowPtr[isn+1]-m_aSnRowPtr[isn];
+		aWork[isn] += ncol*nrow*nrow;
+		work_total += ncol*nrow*nrow;
+		const int jsn = m_aSnParent[isn];
+		if( jsn == -1 ) continue;
+		assert( jsn > (int)isn );
+		aWork[jsn] += aWork[isn];
+		aSize[jsn] += aSize[isn];
+	}
+	std::vector<unsigned int> aChildPtr, aChild;
+	MakeChildren(m_aSnParent,aChildPtr,aChild);
+	std::vector<unsigned int> aRoot;
+	for(unsigned int isn=0;isn<nsn;isn++){
+		if( m_aSnParent[isn] == -1 ){ aRoot.push_back(isn); }
+	}
+	std::vector<unsigned int> aIsTop(nsn,0);
+	for(;;){
+		int iroot_max = -1;
+		for(unsigned int iroot=0;iroot<aRoot.size();iroot++){
+			const unsigned int isn = aRoot[iroot];
+			if( aChildPtr[isn+1] == aChildPtr[isn] ) continue;	// leaf
+			if( iroot_max == -1 || aWork[isn] > aWork[ aRoot[iroot_max] ] ){ iroot_max = iroot; }
+		}
+		if( iroot_max == -1 || aWork[ aRoot[iroot_max] ] <= work_total/16 ) break;
+		const unsigned int isn = aRoot[iroot_max];
+		aIsTop[isn] = 1;
+		aRoot.erase(aRoot.begin()+iroot_max);
+		for(unsigned int k=aChildPtr[isn];k<aChildPtr[isn+1];k++){ aRoot.push_back(aChild[k]); }
+	}
+	std::sort(aRoot.begin(),aRoot.end());
+	for(unsigned int iroot=0;iroot<aRoot.size();iroot++){
+		const unsigned int isn = aRoot[iroot];
+		m_aSubtree.push_back( std::make_pair(isn+1-aSize[isn],isn+1) );
+	}
+	for(unsigned int isn=0;isn<nsn;isn++){
+		if( aIsTop[isn] ){ m_aSnTop.push_back(isn); }
+	}
+}
+
+bool CMatDiaFrac_Supernode::SetValue(const std::vector<double>& aVal)
+{
+	const unsigned int n = m_ndof;
+	const unsigned int nsn = this->NSuperNode();
+	if( n == 0 ) return true;
+
+	double val_max = 0.0;
+	for(unsigned int k=0;k<m_aLowVal.size();k++){
+		assert( m_aLowVal[k] < aVal.size() );
+		const double v = fabs(aVal[ m_aLowVal[k] ]);
+		val_max = ( v > val_max ) ? v : val_max;
+	}
+	const double tol_pivot = val_max*1.0e-15;
+
+	std::vector<unsigned int> aChildPtr, aChild;
+	MakeChildren(m_aSnParent,aChildPtr,aChild);
+
+	// the subtrees are independent each other, and the supernodes above them wait for all of them
+	std::vector< std::vector<double> > aUpd(nsn);	// update matrix (Schur complement) to be added to the parent
+	const int nsubtree = m_aSubtree.size();
+	std::vector<int> aIsOk(nsubtree,1);
+#if defined(_OPENMP)
+#pragma omp parallel if( nsubtree > 1 )
+#endif
+	{
+		std::vector<int> aMap(n,-1);
+		std::vector<double> front, w;
+#if defined(_OPENMP)
+#pragma omp for schedule(dynamic,1)
+#endif
+		for(int isub=0;isub<nsubtree;isub++){
+			for(unsigned int isn=m_aSubtree[isub].first;isn<m_aSubtree[isub].second;isn++){
+				if( !this->FactorSupernode(isn,aVal,tol_pivot,aChildPtr,aChild,aUpd,aMap,front,w,false) ){
+					aIsOk[isub] = 0;
+					break;
+				}
+			}
+		}
+	}
+	for(int isub=0;isub<nsubtree;isub++){
+		if( !aIsOk[isub] ) return false;
+	}
+	std::vector<int> aMap(n,-1);
+	std::vector<double> front, w;
+	for(unsigned int itop=0;itop<m_aSnTop.size();itop++){
+		if( !this->FactorSupernode(m_aSnTop[itop],aVal,tol_pivot,aChildPtr,aChild,aUpd,aMap,front,w,true) ) return false;
+	}
+	return true;
+}
+
+// LDL^T of the supernode isn with the update matrices of its children, and the update matrix for its parent
+bool CMatDiaFrac_Supernode::FactorSupernode(unsigned int isn, const std::vector<double>& aVal, double tol_pivot,
+		const std::vector<unsigned int>& aChildPtr, const std::vector<unsigned int>& aChild,
+		std::vector< std::vector<double> >& aUpd,
+		std::vector<int>& aMap, std::vector<double>& front, std::vector<double>& w, bool is_parallel)
+{
+	const unsigned int jfst = m_aSnColPtr[isn];
+	const unsigned int ncol = m_aSnColPtr[isn+1]-jfst;
+	const unsigned int nrow = m_aSnRowPtr[isn+1]-m_aSnRowPtr[isn];
+	const unsigned int* aRow = &m_aSnRow[ m_aSnRowPtr[isn] ];
+	const unsigned int m = nrow;
+	front.assign(m*m,0.0);
+	for(unsigned int k=0;k<m;k++){ aMap[ aRow[k] ] = k; }
+	// assemble the matrix
+	for(unsigned int jcol=0;jcol<ncol;jcol++){
+		const unsigned int j = jfst+jcol;
+		for(unsigned int k=m_aLowPtr[j];k<m_aLowPtr[j+1];k++){
+			const int irow = aMap[ m_aLowRow[k] ];
+			assert( irow >= (int)jcol );
+			front[irow*m+jcol] += aVal[ m_aLowVal[k] ];
+		}
+	}
+	// extend-add the update matrices of the children
+	for(unsigned int ic=aChildPtr[isn];ic<aChildPtr[isn+1];ic++){
+		const unsigned int jsn = aChild[ic];
+		const unsigned int ncol_c = m_aSnColPtr[jsn+1]-m_aSnColPtr[jsn];
+		const unsigned int* aRow_c = &m_aSnRow[ m_aSnRowPtr[jsn]+ncol_c ];
+		const unsigned int nupd = m_aSnRowPtr[jsn+1]-m_aSnRowPtr[jsn]-ncol_c;
+		const std::vector<double>& upd = aUpd[jsn];
+		assert( upd.size() == nupd*nupd );
+		for(unsigned int a=0;a<nupd;a++){
+			const int ia = aMap[ aRow_c[a] ];
+			assert( ia >= 0 );
+			for(unsigned int b=0;b<=a;b++){
+				const int ib = aMap[ aRow_c[b] ];
+				assert( ib >= 0 && ib <= ia );
+				front[ia*m+ib] += upd[a*nupd+b];
+			}
+		}
+		std::vector<double>().swap(aUpd[jsn]);
+	}
+	for(unsigned int k=0;k<m;k++){ aMap[ aRow[k] ] = -1; }
+	// LDL^T of the columns of the supernode (left looking, the rows of the front are contiguous)
+	w.resize(ncol);
+	for(unsigned int k=0;k<ncol;k++){
+		const double* fk = &front[k*m];
+		for(unsigned int p=0;p<k;p++){ w[p] = fk[p]*m_aDia[jfst+p]; }
+		double d = fk[k];
+		for(unsigned int p=0;p<k;p++){ d -= w[p]*fk[p]; }
+		if( fabs(d) <= tol_pivot ){
+			std::cout << "Error!-->Zero Pivot " << jfst+k << " " << d << std::endl;
+			return false;
+		}
+		m_aDia[jfst+k] = d;
+		front[k*m+k] = d;
+		const double dinv = 1.0/d;
+		for(unsigned int i=k+1;i<m;i++){
+			double* fi = &front[i*m];
+			double v = fi[k];
+			for(unsigned int p=0;p<k;p++){ v -= fi[p]*w[p]; }
+			fi[k] = v*dinv;
+		}
+	}
+	// Schur complement [U] = [F22] - [L21][D][L21]^T
+	const unsigned int nupd = m-ncol;
+	if( nupd > 0 ){
+		w.resize(nupd*ncol);
+		for(unsigned int a=0;a<nupd;a++){
+		for(unsigned int k=0;k<ncol;k++){
+			w[a*ncol+k] = front[(ncol+a)*m+k]*m_aDia[jfst+k];
+		}
+		}
+		std::vector<double>& upd = aUpd[isn];
+		upd.resize(nupd*nupd);
+		const double* pf = &front[0];
+		const double* pw = &w[0];
+		double* pu = &upd[0];
+#if defined(_OPENMP)
+#pragma omp parallel for schedule(dynamic,16) if( is_parallel && nupd*nupd*ncol > 100000 )
+#endif
+		for(int a=0;a<(int)nupd;a++){
+			const double* wa = pw+a*ncol;
+			const double* fa = pf+(ncol+a)*m+ncol;
+			double* ua = pu+a*nupd;
+			int b=0;
+			for(;b+3<=a;b+=4){	// four dot products share the load of wa
+				const double* lb0 = pf+(ncol+b)*m;
+				const double* lb1 = lb0+m;
+				const double* lb2 = lb1+m;
+				const double* lb3 = lb2+m;
+				double d0 = 0, d1 = 0, d2 = 0, d3 = 0;
+				for(unsigned int k=0;k<ncol;k++){
+					const double wk = wa[k];
+					d0 += wk*lb0[k];	d1 += wk*lb1[k];
+					d2 += wk*lb2[k];	d3 += wk*lb3[k];
+				}
+				ua[b  ] = fa[b  ]-d0;	ua[b+1] = fa[b+1]-d1;
+				ua[b+2] = fa[b+2]-d2;	ua[b+3] = fa[b+3]-d3;
+			}
+			for(;b<=a;b++){
+				const double* lb = pf+(ncol+b)*m;
+				double d = fa[b];
+				for(unsigned int k=0;k<ncol;k++){ d -= wa[k]*lb[k]; }
+				ua[b] = d;
+			}
+		}
+	}
+	// store the panel
+	double* pval = &m_aSnVal[ m_aSnValPtr[isn] ];
+	for(unsigned int i=0;i<m;i++){
+	for(unsigned int k=0;k<ncol;k++){
+		if(      i == k ){ pval[i*ncol+k] = 1.0; }
+		else if( i >  k ){ pval[i*ncol+k] = front[i*m+k]; }
+		else{              pval[i*ncol+k] = 0.0; }
+	}
+	}
+	return true;
+}
+
+void CMatDiaFrac_Supernode::Solve(std::vector<double>& vec) const
+{
+	const unsigned int n = m_ndof;
+	assert( vec.size() == n );
+	std::vector<double> y(n);
+	for(unsigned int i=0;i<n;i++){ y[i] = vec[ m_aPerm[i] ]; }
+	// forward substitution [L]{y}={b}, the subtrees in parallel
+	// the rows of a subtree after its columns are the rows of its root, and their updates are added later in the fixed order
+	const int nsubtree = m_aSubtree.size();
+	std::vector< std::vector<double> > aUpdRoot(nsubtree);
+#if defined(_OPENMP)
+#pragma omp parallel if( nsubtree > 1 )
+#endif
+	{
+		std::vector<double> y_above;	// updates to the rows after the columns of the subtree
+#if defined(_OPENMP)
+#pragma omp for schedule(dynamic,1)
+#endif
+		for(int isub=0;isub<nsubtree;isub++){
+			if( y_above.size() != n ){ y_above.assign(n,0.0); }
+			const unsigned int isn_root = m_aSubtree[isub].second-1;
+			const unsigned int jend = m_aSnColPtr[isn_root+1];
+			for(unsigned int isn=m_aSubtree[isub].first;isn<=isn_root;isn++){
+				this->SolveForward_Supernode(isn,&y[0],jend,&y_above[0]);
+			}
+			const unsigned int ncol = jend-m_aSnColPtr[isn_root];
+			const unsigned int nupd = m_aSnRowPtr[isn_root+1]-m_aSnRowPtr[isn_root]-ncol;
+			const unsigned int* aRow = &m_aSnRow[ m_aSnRowPtr[isn_root]+ncol ];
+			aUpdRoot[isub].resize(nupd);
+			for(unsigned int k=0;k<nupd;k++){
+				aUpdRoot[isub][k] = y_above[ aRow[k] ];
+				y_above[ aRow[k] ] = 0.0;
+			}
+		}
+	}
+	for(int isub=0;isub<nsubtree;isub++){
+		const unsigned int isn_root = m_aSubtree[isub].second-1;
+		const unsigned int ncol = m_aSnColPtr[isn_root+1]-m_aSnColPtr[isn_root];
+		const unsigned int* aRow = &m_aSnRow[ m_aSnRowPtr[isn_root]+ncol ];
+		for(unsigned int k=0;k<aUpdRoot[isub].size();k++){ y[ aRow[k] ] -= aUpdRoot[isub][k]; }
+	}
+	for(unsigned int itop=0;itop<m_aSnTop.size();itop++){
+		this->SolveForward_Supernode(m_aSnTop[itop],&y[0],n,&y[0]);
+	}
+	// diagonal
+	for(unsigned int i=0;i<n;i++){ y[i] /= m_aDia[i]; }
+	// backward substitution [L]^T{x}={y}, the supernodes above the subtrees first
+	for(int itop=(int)m_aSnTop.size()-1;itop>=0;itop--){
+		this->SolveBackward_Supernode(m_aSnTop[itop],&y[0]);
+	}
+#if defined(_OPENMP)
+#pragma omp parallel for schedule(dynamic,1) if( nsubtree > 1 )
+#endif
+	for(int isub=0;isub<nsubtree;isub++){
+		for(int isn=(int)m_aSubtree[isub].second-1;isn>=(int)m_aSubtree[isub].first;isn--){
+			this->SolveBackward_Supernode(isn,&y[0]);
+		}
+	}
+	for(unsigned int i=0;i<n;i++){ vec[ m_aPerm[i] ] = y[i]; }
+}
+
+// {y} of the columns of the supernode isn, and the update of the rows below them (the rows not less than jend go to y_above)
+void CMatDiaFrac_Supernode::SolveForward_Supernode(unsigned int isn, double* y, unsigned int jend, double* y_above) const
+{
+	const unsigned int jfst = m_aSnColPtr[isn];
+	const unsigned int ncol = m_aSnColPtr[isn+1]-jfst;
+	const unsigned int nrow = m_aSnRowPtr[isn+1]-m_aSnRowPtr[isn];
+	const unsigned int* aRow = &m_aSnRow[ m_aSnRowPtr[isn] ];
+	const double* pval = &m_aSnVal[ m_aSnValPtr[isn] ];
+	double* yc = y+jfst;
+	for(unsigned int k=0;k<ncol;k++){
+		double d = yc[k];
+		for(unsigned int j=0;j<k;j++){ d -= pval[k*ncol+j]*yc[j]; }
+		yc[k] = d;
+	}
+	for(unsigned int i=ncol;i<nrow;i++){
+		double d = 0.0;
+		for(unsigned int k=0;k<ncol;k++){ d += pval[i*ncol+k]*yc[k]; }
+		const unsigned int irow = aRow[i];
+		if( irow < jend ){ y[irow] -= d; }
+		else{ y_above[irow] += d; }
+	}
+}
+
+// {x} of the columns of the supernode isn from the rows below them
+void CMatDiaFrac_Supernode::SolveBackward_Supernode(unsigned int isn, double* y) const
+{
+	const unsigned int jfst = m_aSnColPtr[isn];
+	const unsigned int ncol = m_aSnColPtr[isn+1]-jfst;
+	const unsigned int nrow = m_aSnRowPtr[isn+1]-m_aSnRowPtr[isn];
+	const unsigned int* aRow = &m_aSnRow[ m_aSnRowPtr[isn] ];
+	const double* pval = &m_aSnVal[ m_aSnValPtr[isn] ];
+	double* yc = y+jfst;
+	for(unsigned int i=ncol;i<nrow;i++){
+		const double yi = y[ aRow[i] ];
+		for(unsigned int k=0;k<ncol;k++){ yc[k] -= pval[i*ncol+k]*yi; }
+	}
+	for(int k=(int)ncol-1;k>=0;k--){
+		double d = yc[k];
+		for(unsigned int i=k+1;i<ncol;i++){ d -= pval[i*ncol+k]*yc[i]; }
+		yc[k] = d;
+	}
+}
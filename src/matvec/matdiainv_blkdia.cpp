@@ -30,17 +30,125 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include <assert.h>
 #include <iostream>
 #include <cstdlib> //(abort)
+#include <vector>
 
 #include "delfem/matvec/matdiainv_blkdia.h"
 #include "delfem/matvec/vector_blk.h"
 
 using namespace MatVec;
 
+////////////////////////////////////////////////////////////////
+// kernels for the matrix with block length larger than one
+
+// invert the dense block a[len*len] (row major) in place by Gauss-Jordan elimination with partial pivoting
+static bool InvBlk(double* a, const unsigned int len)
+{
+	std::vector<unsigned int> piv(len);
+	for(unsigned int i=0;i<len;i++){ piv[i] = i; }
+	for(unsigned int k=0;k<len;k++){
+		unsigned int kmax = k;
+		for(unsigned int i=k+1;i<len;i++){
+			if( fabs(a[i*len+k]) > fabs(a[kmax*len+k]) ){ kmax = i; }
+		}
+		if( fabs(a[kmax*len+k]) < 1.0e-30 ) return false;
+		if( kmax != k ){
+			for(unsigned int j=0;j<len;j++){ const double t = a[k*len+j]; a[k*len+j] = a[kmax*len+j]; a[kmax*len+j] = t; }
+			const unsigned int t = piv[k]; piv[k] = piv[kmax]; piv[kmax] = t;
+		}
+		const double dinv = 1.0/a[k*len+k];
+		a[k*len+k] = 1.0;
+		for(unsigned int j=0;j<len;j++){ a[k*len+j] *= dinv; }
+		for(unsigned int i=0;i<len;i++){
+			if( i == k ) continue;
+			const double d = a[i*len+k];
+			a[i*len+k] = 0.0;
+			for(unsigned int j=0;j<len;j++){ a[i*len+j] -= d*a[k*len+j]; }
+		}
+	}
+	// undo the row exchange as the column exchange of the inverse
+	std::vector<double> t(len*len);
+	for(unsigned int i=0;i<len;i++){
+	for(unsigned int j=0;j<len;j++){ t[i*len+piv[j]] = a[i*len+j]; }
+	}
+	for(unsigned int i=0;i<len*len;i++){ a[i] = t[i]; }
+	return true;
+}
+
+// Gauss-Seidel sweep on block rows (is_ini : the update is regarded as zero before the sweep)
+static void SweepGaussSidel_Blk(const CMatDia_BlkCrs& mat, const double* dia_inv, 
+		const double* res, double* upd, bool is_backward, bool is_ini)
+{
+	const unsigned int nblk = mat.NBlkMatCol();
+	const unsigned int len = mat.LenBlkCol();
+	const unsigned int blksize = len*len;
+	std::vector<double> tmp(len);
+	for(unsigned int kblk=0;kblk<nblk;kblk++){
+		const unsigned int iblk = ( is_backward ) ? nblk-1-kblk : kblk;
+		unsigned int ncrs_i;
+		const unsigned int* crs_i = mat.GetPtrIndPSuP(iblk,ncrs_i);
+		const double* pval_crs_i = mat.GetPtrValPSuP(iblk,ncrs_i);
+		for(unsigned int idof=0;idof<len;idof++){ tmp[idof] = res[iblk*len+idof]; }
+		for(unsigned int icrs_i=0;icrs_i<ncrs_i;icrs_i++){
+			const unsigned int jblk0 = crs_i[icrs_i];
+			assert( jblk0 < nblk );
+			if( is_ini && ( (!is_backward && jblk0 > iblk) || (is_backward && jblk0 < iblk) ) ) continue;
+			const double* pval_ij = &pval_crs_i[icrs_i*blksize];
+			const double* pval_upd_j = &upd[jblk0*len];
+			for(unsigned int idof=0;idof<len;idof++){
+			for(unsigned int jdof=0;jdof<len;jdof++){
+				tmp[idof] -= pval_ij[idof*len+jdof]*pval_upd_j[jdof];
+			}
+			}
+		}
+		const double* pval_dia_inv = &dia_inv[iblk*blksize];
+		double* pval_upd_i = &upd[iblk*len];
+		for(unsigned int idof=0;idof<len;idof++){
+			double d = 0.0;
+			for(unsigned int jdof=0;jdof<len;jdof++){ d += pval_dia_inv[idof*len+jdof]*tmp[jdof]; }
+			pval_upd_i[idof] = d;
+		}
+	}
+}
+
+// (omega) Jacobi sweep on block rows (old==0 : the update is regarded as zero before the sweep)
+static void SweepJacobi_Blk(const CMatDia_BlkCrs& mat, const double* dia_inv, 
+		const double* res, const double* old, double* upd, double omega)
+{
+	const unsigned int nblk = mat.NBlkMatCol();
+	const unsigned int len = mat.LenBlkCol();
+	const unsigned int blksize = len*len;
+	std::vector<double> tmp(len);
+	for(unsigned int iblk=0;iblk<nblk;iblk++){
+		for(unsigned int idof=0;idof<len;idof++){ tmp[idof] = res[iblk*len+idof]; }
+		if( old != 0 ){
+			unsigned int ncrs_i;
+			const unsigned int* crs_i = mat.GetPtrIndPSuP(iblk,ncrs_i);
+			const double* pval_crs_i = mat.GetPtrValPSuP(iblk,ncrs_i);
+			for(unsigned int icrs_i=0;icrs_i<ncrs_i;icrs_i++){
+				const unsigned int jblk0 = crs_i[icrs_i];
+				assert( jblk0 < nblk );
+				const double* pval_ij = &pval_crs_i[icrs_i*blksize];
+				for(unsigned int idof=0;idof<len;idof++){
+				for(unsigned int jdof=0;jdof<len;jdof++){
+					tmp[idof] -= pval_ij[idof*len+jdof]*old[jblk0*len+jdof];
+				}
+				}
+			}
+		}
+		const double* pval_dia_inv = &dia_inv[iblk*blksize];
+		for(unsigned int idof=0;idof<len;idof++){
+			double d = 0.0;
+			for(unsigned int jdof=0;jdof<len;jdof++){ d += pval_dia_inv[idof*len+jdof]*tmp[jdof]; }
+			const double x0 = ( old != 0 ) ? old[iblk*len+idof] : 0.0;
+			upd[iblk*len+idof] = x0 + (d-x0)*omega;
+		}
+	}
+}
+
 
 CMatDiaInv_BlkDia::CMatDiaInv_BlkDia(unsigned int nblk, unsigned int blklen) 
 :CMatDia_BlkCrs(nblk,blklen)
 {
-	m_valDia_Blk = 0;
 }
 
 
@@ -48,18 +156,45 @@ CMatDiaInv_BlkDia::CMatDiaInv_BlkDia(const CMatDia_BlkCrs& mat)
 :CMatDia_BlkCrs(mat.NBlkMatCol(),mat.LenBlkCol())
 {
 	////////////////
-	if( mat.LenBlkCol() != 1 ){
+	if( mat.LenBlkCol() <= 0 ){
 		std::cout << "Not Impliment" << std::endl;
 		assert(0);
 		abort();
 	}
+	this->SetValue(mat);
+}
+
+// invert the diagonal blocks of mat (the pattern of mat must be the same size as this)
+// return 0 if succeeded, -1 if a diagonal block is singular
+int CMatDiaInv_BlkDia::SetValue(const CMatDia_BlkCrs& mat)
+{
+	assert( mat.NBlkMatCol() == this->NBlkMatCol() );
+	assert( mat.LenBlkCol()  == this->LenBlkCol()  );
+	if( mat.LenBlkCol() != 1 ){
+		const unsigned int len = mat.LenBlkCol();
+		const unsigned int blksize = len*len;
+		int ierr = 0;
+		for(unsigned int iblk=0;iblk<this->NBlkMatCol();iblk++){
+			const double* ptr_dia_val = mat.GetPtrValDia(iblk);
+			double* ptr_inv = &this->m_valDia_Blk[iblk*blksize];
+			for(unsigned int i=0;i<blksize;i++){ ptr_inv[i] = ptr_dia_val[i]; }
+			if( !InvBlk(ptr_inv,len) ){
+				std::cout << "Error!-->Singular Diagonal Block : " << iblk << std::endl;
+				assert(0);
+				ierr = -1;
+			}
+		}
+		return ierr;
+	}
 	////////////////
 	for(unsigned int iblk=0;iblk<this->NBlkMatCol();iblk++){
 		const double* ptr_dia_val =  mat.GetPtrValDia(iblk);
 		const double dia_val = *ptr_dia_val;
 		assert( fabs(dia_val) > 1.0e-30 );
+		if( fabs(dia_val) < 1.0e-30 ) return -1;
 		this->m_valDia_Blk[iblk] = 1.0/dia_val;
 	}
+	return 0;
 }
 
 CMatDiaInv_BlkDia::~CMatDiaInv_BlkDia()
@@ -75,8 +210,10 @@ int CMatDiaInv_BlkDia::SolveUpdate_GaussSidel(const unsigned int max_iter,
 
 	////////////////
 	if( mat.LenBlkCol() != 1 ){
-		std::cout << "Not Implimented" << std::endl;
-		assert(0);
+		for(unsigned int iitr=0;iitr<max_iter;iitr++){
+			SweepGaussSidel_Blk(mat,this->m_valDia_Blk,&residual.m_Value[0],&update.m_Value[0],false,false);
+		}
+		return 0;
 	}
 	////////////////
 	const unsigned int nblk = mat.NBlkMatCol();
@@ -113,8 +250,10 @@ int CMatDiaInv_BlkDia::SolveUpdate_GaussSidel_BackWard(
 
 	////////////////
 	if( mat.LenBlkCol() != 1 ){
-		std::cout << "Not Implimented" << std::endl;
-		assert(0);
+		for(unsigned int iitr=0;iitr<max_iter;iitr++){
+			SweepGaussSidel_Blk(mat,this->m_valDia_Blk,&residual.m_Value[0],&update.m_Value[0],true,false);
+		}
+		return 0;
 	}
 	////////////////
 	const unsigned int nblk = mat.NBlkMatCol();
@@ -255,8 +394,11 @@ int CMatDiaInv_BlkDia::SolveUpdate_Jacobi(const unsigned int max_iter,
 
 	////////////////
 	if( mat.LenBlkCol() != 1 ){
-		std::cout << "Not Implimented" << std::endl;
-		assert(0);
+		for(unsigned int iitr=0;iitr<max_iter;iitr++){
+			tmp_vec = update;
+			SweepJacobi_Blk(mat,this->m_valDia_Blk,&residual.m_Value[0],&tmp_vec.m_Value[0],&update.m_Value[0],1.0);
+		}
+		return 0;
 	}
 	////////////////
 	const unsigned int nblk = mat.NBlkMatCol();
@@ -295,8 +437,11 @@ int CMatDiaInv_BlkDia::SolveUpdate_OmegaJacobi(const unsigned int max_iter,
 
 	////////////////
 	if( mat.LenBlkCol() != 1 ){
-		std::cout << "Not Implimented" << std::endl;
-		assert(0);
+		for(unsigned int iitr=0;iitr<max_iter;iitr++){
+			tmp_vec = update;
+			SweepJacobi_Blk(mat,this->m_valDia_Blk,&residual.m_Value[0],&tmp_vec.m_Value[0],&update.m_Value[0],omega);
+		}
+		return 0;
 	}
 	////////////////
 	const unsigned int nblk = mat.NBlkMatCol();
@@ -336,8 +481,8 @@ int CMatDiaInv_BlkDia::Solve_IniGaussSidel(
 
 	////////////////
 	if( mat.LenBlkCol() != 1 ){
-		std::cout << "Not Implimented" << std::endl;
-		assert(0);
+		SweepGaussSidel_Blk(mat,this->m_valDia_Blk,&residual.m_Value[0],&update.m_Value[0],false,true);
+		return 0;
 	}
 	////////////////
 	const unsigned int nblk = mat.NBlkMatCol();
@@ -478,8 +623,8 @@ int CMatDiaInv_BlkDia::Solve_IniJacobi(
 
 	////////////////
 	if( mat.LenBlkCol() != 1 ){
-		std::cout << "Not Implimented" << std::endl;
-		assert(0);
+		SweepJacobi_Blk(mat,this->m_valDia_Blk,&residual.m_Value[0],0,&update.m_Value[0],1.0);
+		return 0;
 	}
 	////////////////
 	const unsigned int nblk = mat.NBlkMatCol();
@@ -509,8 +654,8 @@ int CMatDiaInv_BlkDia::Solve_IniOmegaJacobi(
 
 	////////////////
 	if( mat.LenBlkCol() != 1 ){
-		std::cout << "Not Implimented" << std::endl;
-		assert(0);
+		SweepJacobi_Blk(mat,this->m_valDia_Blk,&residual.m_Value[0],0,&update.m_Value[0],omega);
+		return 0;
 	}
 	////////////////
 	const unsigned int nblk = mat.NBlkMatCol();
@@ -0,0 +1,112 @@
+/*
+Copyright (C) 2009  Nobuyuki Umetani    n.umetani@gmail.com
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+////////////////////////////////////////////////////////////////
+// multivector_blk.cpp : implentation of multi vector class (CMultiVector_Blk)
+////////////////////////////////////////////////////////////////
+
+#include <cassert>
+#include <cstring> //(memcpy)
+#include <vector>
+
+#include "delfem/matvec/multivector_blk.h"
+#include "delfem/matvec/vector_blk.h"
+
+using namespace MatVec;
+
+CMultiVector_Blk& CMultiVector_Blk::operator=(const CMultiVector_Blk& rhs){
+	assert( this->NBlk() == rhs.NBlk() );
+	assert( this->Len()  == rhs.Len()  );
+	assert( this->NCol() == rhs.NCol() );
+	const unsigned int nval = m_nBlk*m_Len*m_nCol;
+	if( nval > 0 ){ memcpy(m_Value,rhs.m_Value,nval*sizeof(double)); }
+	return *this;
+}
+
+void CMultiVector_Blk::SetColumn(unsigned int icol, const CVector_Blk& vec){
+	assert( icol < m_nCol );
+	assert( vec.NBlk() == m_nBlk );
+	assert( vec.Len() == (int)m_Len );
+	for(unsigned int iblk=0;iblk<m_nBlk;iblk++){
+		for(unsigned int idof=0;idof<m_Len;idof++){
+			m_Value[(iblk*m_Len+idof)*m_nCol+icol] = vec.GetValue(iblk,idof);
+		}
+	}
+}
+
+void CMultiVector_Blk::GetColumn(unsigned int icol, CVector_Blk& vec) const {
+	assert( icol < m_nCol );
+	assert( vec.NBlk() == m_nBlk );
+	assert( vec.Len() == (int)m_Len );
+	for(unsigned int iblk=0;iblk<m_nBlk;iblk++){
+		for(unsigned int idof=0;idof<m_Len;idof++){
+			vec.SetValue(iblk,idof, m_Value[(iblk*m_Len+idof)*m_nCol+icol] );
+		}
+	}
+}
+
+void CMultiVector_Blk::SetVectorZero(){
+	const unsigned int nval = m_nBlk*m_Len*m_nCol;
+	for(unsigned int ival=0;ival<nval;ival++){ m_Value[ival] = 0.0; }
+}
+
+void CMultiVector_Blk::Dot(const CMultiVector_Blk& rhs, double* adot) const {
+	assert( this->NBlk() == rhs.NBlk() && this->Len() == rhs.Len() && this->NCol() == rhs.NCol() );
+	const unsigned int ncol = m_nCol;
+	const unsigned int nrow = m_nBlk*m_Len;
+	std::vector<double> ad(ncol,0.0);
+	const double* p1 = m_Value;
+	const double* p2 = rhs.m_Value;
+	for(unsigned int irow=0;irow<nrow;irow++){
+		const double* p1i = p1+irow*ncol;
+		const double* p2i = p2+irow*ncol;
+		for(unsigned int icol=0;icol<ncol;icol++){ ad[icol] += p1i[icol]*p2i[icol]; }
+	}
+	for(unsigned int icol=0;icol<ncol;icol++){ adot[icol] = ad[icol]; }
+}
+
+void CMultiVector_Blk::Scale(const double* alpha){
+	const unsigned int ncol = m_nCol;
+	const unsigned int nrow = m_nBlk*m_Len;
+	for(unsigned int irow=0;irow<nrow;irow++){
+		double* pi = m_Value+irow*ncol;
+		for(unsigned int icol=0;icol<ncol;icol++){ pi[icol] *= alpha[icol]; }
+	}
+}
+
+void CMultiVector_Blk::AXPY(const double* alpha, const CMultiVector_Blk& rhs){
+	assert( this->NBlk() == rhs.NBlk() && this->Len() == rhs.Len() && this->NCol() == rhs.NCol() );
+	const unsigned int ncol = m_nCol;
+	const unsigned int nrow = m_nBlk*m_Len;
+	for(unsigned int irow=0;irow<nrow;irow++){
+		double* pi = m_Value+irow*ncol;
+		const double* qi = rhs.m_Value+irow*ncol;
+		for(unsigned int icol=0;icol<ncol;icol++){ pi[icol] += alpha[icol]*qi[icol]; }
+	}
+}
+
+void CMultiVector_Blk::AXPBY(const double* alpha, const CMultiVector_Blk& rhs, const double* beta){
+	assert( this->NBlk() == rhs.NBlk() && this->Len() == rhs.Len() && this->NCol() == rhs.NCol() );
+	const unsigned int ncol = m_nCol;
+	const unsigned int nrow = m_nBlk*m_Len;
+	for(unsigned int irow=0;irow<nrow;irow++){
+		double* pi = m_Value+irow*ncol;
+		const double* qi = rhs.m_Value+irow*ncol;
+		for(unsigned int icol=0;icol<ncol;icol++){ pi[icol] = alpha[icol]*qi[icol] + beta[icol]*pi[icol]; }
+	}
+}
@@ -39,6 +39,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 
 #include "delfem/matvec/ordering_blk.h"
 #include "delfem/matvec/vector_blk.h"
+#include "delfem/matvec/multivector_blk.h"
 #include "delfem/matvec/matdia_blkcrs.h"
 
 using namespace MatVec;
@@ -165,6 +166,34 @@ void COrdering_Blk::OrderingVector_OldToNew(CVector_Blk& vec_to, const CVector_B
 	}
 }
 
+void COrdering_Blk::OrderingVector_NewToOld(CMultiVector_Blk& vec_to, const CMultiVector_Blk& vec_from){
+	const unsigned int nblk = this->m_nblk;
+	assert( vec_to.NBlk() == nblk );
+	assert( vec_from.NBlk() == nblk );
+	assert( vec_from.Len() == vec_to.Len() && vec_from.NCol() == vec_to.NCol() );
+	const unsigned int nval = vec_to.Len()*vec_to.NCol();	// a block of the multi vector is contiguous
+	for(unsigned int iblk=0;iblk<nblk;iblk++){	// old
+		const unsigned int jblk0 = this->OldToNew(iblk);	// new 
+		const double* pfrom = vec_from.GetValuePtr(jblk0);
+		double* pto = vec_to.GetValuePtr(iblk);
+		for(unsigned int ival=0;ival<nval;ival++){ pto[ival] = pfrom[ival]; }
+	}
+}
+
+void COrdering_Blk::OrderingVector_OldToNew(CMultiVector_Blk& vec_to, const CMultiVector_Blk& vec_from){
+	const unsigned int nblk = this->m_nblk;
+	assert( vec_to.NBlk() == nblk );
+	assert( vec_from.NBlk() == nblk );
+	assert( vec_from.Len() == vec_to.Len() && vec_from.NCol() == vec_to.NCol() );
+	const unsigned int nval = vec_to.Len()*vec_to.NCol();
+	for(unsigned int iblk=0;iblk<nblk;iblk++){	// new
+		const unsigned int jblk0 = this->NewToOld(iblk);	// old
+		const double* pfrom = vec_from.GetValuePtr(jblk0);
+		double* pto = vec_to.GetValuePtr(iblk);
+		for(unsigned int ival=0;ival<nval;ival++){ pto[ival] = pfrom[ival]; }
+	}
+}
+
 
 void MatVec::COrdering_Blk::MakeOrdering_RCM2(const CMatDia_BlkCrs& mat)
 {
@@ -483,3 +512,163 @@ void MatVec::COrdering_Blk::MakeOrdering_AMD(const MatVec::CMatDia_BlkCrs& mat)
 	}
 }
 
+
+////////////////////////////////////////////////////////////////
+// nested dissection
+
+// work data of the nested dissection
+struct SNestedDissection{
+	std::vector<unsigned int> aPtr, aInd;	// adjacency of the blocks
+	std::vector<int> aLabel;	// the blocks with the same label belong to the same sub graph
+	std::vector<int> aLevel;	// level of the breadth first search (-1 if not visited)
+	std::vector<unsigned int> aQueue;
+	int nlabel;
+	unsigned int nblk_leaf;
+	std::vector<int> aOrder;	// new -> old
+};
+
+// breadth first search inside the sub graph labeled ilabel, aQueue has the visited blocks in the order of the level
+static void BreadthFirstSearch(unsigned int iblk_root, int ilabel, SNestedDissection& nd)
+{
+	nd.aQueue.clear();
+	nd.aQueue.push_back(iblk_root);
+	nd.aLevel[iblk_root] = 0;
+	for(unsigned int iq=0;iq<nd.aQueue.size();iq++){
+		const unsigned int iblk0 = nd.aQueue[iq];
+		for(unsigned int ipsup=nd.aPtr[iblk0];ipsup<nd.aPtr[iblk0+1];ipsup++){
+			const unsigned int jblk0 = nd.aInd[ipsup];
+			if( nd.aLabel[jblk0] != ilabel || nd.aLevel[jblk0] != -1 ) continue;
+			nd.aLevel[jblk0] = nd.aLevel[iblk0]+1;
+			nd.aQueue.push_back(jblk0);
+		}
+	}
+}
+
+static void ClearLevel(SNestedDissection& nd)
+{
+	for(unsigned int iq=0;iq<nd.aQueue.size();iq++){ nd.aLevel[ nd.aQueue[iq] ] = -1; }
+}
+
+// append the leaf or the separator to the new ordering
+static void AppendOrder(const std::vector<unsigned int>& aBlk, SNestedDissection& nd)
+{
+	for(unsigned int i=0;i<aBlk.size();i++){ nd.aOrder.push_back(aBlk[i]); }
+}
+
+static void Dissect(std::vector<unsigned int>& aBlk, SNestedDissection& nd);
+
+// order the connected components of the sub graph labeled ilabel one by one (no separator between them)
+// the small components are packed into the leaves of up to nblk_leaf blocks
+static void DissectComponent(std::vector<unsigned int>& aBlk, int ilabel, SNestedDissection& nd)
+{
+	std::vector< std::vector<unsigned int> > aComp;
+	std::vector<unsigned int> aVisit;
+	for(unsigned int i=0;i<aBlk.size();i++){
+		if( nd.aLevel[ aBlk[i] ] != -1 ) continue;
+		BreadthFirstSearch(aBlk[i],ilabel,nd);
+		aVisit.insert(aVisit.end(),nd.aQueue.begin(),nd.aQueue.end());
+		if( nd.aQueue.size() > nd.nblk_leaf || aComp.empty() || aComp.back().size()+nd.aQueue.size() > nd.nblk_leaf ){
+			aComp.resize(aComp.size()+1);
+		}
+		aComp.back().insert(aComp.back().end(),nd.aQueue.begin(),nd.aQueue.end());
+	}
+	for(unsigned int i=0;i<aVisit.size();i++){ nd.aLevel[ aVisit[i] ] = -1; }
+	nd.aQueue.clear();
+	std::vector<unsigned int>().swap(aBlk);
+	std::vector<unsigned int>().swap(aVisit);
+	for(unsigned int icomp=0;icomp<aComp.size();icomp++){
+		Dissect(aComp[icomp],nd);	// a packed or connected component, so this does not come back here
+	}
+}
+
+// order the sub graph aBlk (the blocks of the two halves first and the separator last)
+static void Dissect(std::vector<unsigned int>& aBlk, SNestedDissection& nd)
+{
+	const int ilabel = nd.nlabel;
+	nd.nlabel++;
+	for(unsigned int i=0;i<aBlk.size();i++){ nd.aLabel[ aBlk[i] ] = ilabel; }
+	if( aBlk.size() <= nd.nblk_leaf ){
+		std::sort(aBlk.begin(),aBlk.end());
+		AppendOrder(aBlk,nd);
+		return;
+	}
+	// pseudo peripheral block (the last block of the search is the next root while the depth grows)
+	unsigned int iblk_root = aBlk[0];
+	BreadthFirstSearch(iblk_root,ilabel,nd);
+	if( nd.aQueue.size() < aBlk.size() ){	// not connected
+		ClearLevel(nd);
+		DissectComponent(aBlk,ilabel,nd);
+		return;
+	}
+	for(unsigned int itr=0;itr<5;itr++){
+		const unsigned int iblk_last = nd.aQueue.back();
+		const int nlev0 = nd.aLevel[iblk_last];
+		ClearLevel(nd);
+		BreadthFirstSearch(iblk_last,ilabel,nd);
+		if( nd.aLevel[nd.aQueue.back()] <= nlev0 ){ break; }
+		iblk_root = iblk_last;
+	}
+	std::vector<unsigned int> aBlkA, aBlkB, aBlkS;
+	{
+		const int nlev = nd.aLevel[nd.aQueue.back()]+1;
+		if( nlev < 3 ){	// too dense to separate
+			ClearLevel(nd);
+			std::sort(aBlk.begin(),aBlk.end());
+			AppendOrder(aBlk,nd);
+			return;
+		}
+		// the level at the middle of the blocks is the separator
+		int ilev_sep = nd.aLevel[ nd.aQueue[ aBlk.size()/2 ] ];
+		if( ilev_sep < 1 ){ ilev_sep = 1; }
+		if( ilev_sep > nlev-2 ){ ilev_sep = nlev-2; }
+		for(unsigned int iq=0;iq<nd.aQueue.size();iq++){
+			const unsigned int iblk0 = nd.aQueue[iq];
+			const int ilev = nd.aLevel[iblk0];
+			if(      ilev < ilev_sep ){ aBlkA.push_back(iblk0); continue; }
+			else if( ilev > ilev_sep ){ aBlkB.push_back(iblk0); continue; }
+			// the block of the separator that does not touch the other half goes to the first half
+			bool is_touch = false;
+			for(unsigned int ipsup=nd.aPtr[iblk0];ipsup<nd.aPtr[iblk0+1];ipsup++){
+				const unsigned int jblk0 = nd.aInd[ipsup];
+				if( nd.aLabel[jblk0] == ilabel && nd.aLevel[jblk0] == ilev_sep+1 ){ is_touch = true; break; }
+			}
+			if( is_touch ){ aBlkS.push_back(iblk0); }
+			else{           aBlkA.push_back(iblk0); }
+		}
+	}
+	ClearLevel(nd);
+	std::vector<unsigned int>().swap(aBlk);
+	Dissect(aBlkA,nd);
+	Dissect(aBlkB,nd);
+	std::sort(aBlkS.begin(),aBlkS.end());
+	AppendOrder(aBlkS,nd);
+}
+
+void COrdering_Blk::MakeOrdering_ND(const CMatDia_BlkCrs& mat, unsigned int nblk_leaf)
+{
+	const unsigned int nblk = mat.NBlkMatCol();
+	SNestedDissection nd;
+	{
+		nd.aPtr.resize(nblk+1);
+		nd.aPtr[0] = 0;
+		nd.aInd.reserve(mat.NCrs());
+		for(unsigned int iblk=0;iblk<nblk;iblk++){
+			unsigned int npsup;
+			const unsigned int* psup = mat.GetPtrIndPSuP(iblk,npsup);
+			for(unsigned int ipsup=0;ipsup<npsup;ipsup++){ nd.aInd.push_back(psup[ipsup]); }
+			nd.aPtr[iblk+1] = nd.aInd.size();
+		}
+	}
+	nd.aLabel.resize(nblk,-1);
+	nd.aLevel.resize(nblk,-1);
+	nd.nlabel = 0;
+	nd.nblk_leaf = ( nblk_leaf == 0 ) ? 1 : nblk_leaf;
+	nd.aOrder.reserve(nblk);
+	if( nblk > 0 ){
+		std::vector<unsigned int> aBlk(nblk);
+		for(unsigned int iblk=0;iblk<nblk;iblk++){ aBlk[iblk] = iblk; }
+		Dissect(aBlk,nd);
+	}
+	assert( nd.aOrder.size() == nblk );
+	this->SetOrdering(nd.aOrder);
+}
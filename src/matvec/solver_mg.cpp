@@ -20,8 +20,12 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include <iostream>
 #include <cstdlib> //(abort)
 #include <math.h>
+#include <vector>
+#include <algorithm>
 
+#include "delfem/indexed_array.h"
 #include "delfem/matvec/solver_mg.h"
+#include "delfem/matvec/mat_blkcrs.h"
 #include "delfem/matvec/matdia_blkcrs.h"
 
 #include "delfem/matvec/matdiainv_blkdia.h"
@@ -299,3 +303,621 @@ bool CSolverMG::SolveCycleV(const CMatDia_BlkCrs& mat,CVector_Blk& v_f) const
 }
 
 
+////////////////////////////////////////////////////////////////
+// smoothed aggregation
+
+// Frobenius norm of the block
+static double NormBlk(const double* a, const unsigned int n)
+{
+	double d = 0.0;
+	for(unsigned int i=0;i<n;i++){ d += a[i]*a[i]; }
+	return sqrt(d);
+}
+
+// zero the near null space on the dof decoupled from the others (the dof with the fixed boundary condition)
+static void ZeroDecoupledDof(const CMatDia_BlkCrs& mat, const unsigned int nmode, std::vector<double>& aNull)
+{
+	const unsigned int nblk = mat.NBlkMatCol();
+	const unsigned int len = mat.LenBlkCol();
+	const unsigned int blksize = len*len;
+	for(unsigned int iblk=0;iblk<nblk;iblk++){
+		unsigned int ncrs;
+		const double* pval = mat.GetPtrValPSuP(iblk,ncrs);
+		const double* pdia = mat.GetPtrValDia(iblk);
+		for(unsigned int idof=0;idof<len;idof++){
+			bool is_decoupled = true;
+			for(unsigned int jdof=0;jdof<len;jdof++){
+				if( jdof != idof && pdia[idof*len+jdof] != 0.0 ){ is_decoupled = false; break; }
+			}
+			for(unsigned int icrs=0;icrs<ncrs && is_decoupled;icrs++){
+				for(unsigned int jdof=0;jdof<len;jdof++){
+					if( pval[icrs*blksize+idof*len+jdof] != 0.0 ){ is_decoupled = false; break; }
+				}
+			}
+			if( !is_decoupled ) continue;
+			for(unsigned int imode=0;imode<nmode;imode++){ aNull[imode*nblk*len+iblk*len+idof] = 0.0; }
+		}
+	}
+}
+
+// aggregate the strongly connected blocks ( |A_ij| > theta*sqrt(|A_ii||A_jj|) )
+// aAgg[iblk] is the index of the aggregate (-1 for the block without strong connection)
+static unsigned int MakeAggregate(const CMatDia_BlkCrs& mat, const double theta, std::vector<int>& aAgg)
+{
+	const unsigned int nblk = mat.NBlkMatCol();
+	const unsigned int len = mat.LenBlkCol();
+	const unsigned int blksize = len*len;
+	std::vector<double> aNormDia(nblk);
+	for(unsigned int iblk=0;iblk<nblk;iblk++){ aNormDia[iblk] = NormBlk(mat.GetPtrValDia(iblk),blksize); }
+	Com::CIndexedArray strong;
+	strong.InitializeSize(nblk);
+	for(unsigned int iblk=0;iblk<nblk;iblk++){
+		unsigned int ncrs;
+		const unsigned int* pind = mat.GetPtrIndPSuP(iblk,ncrs);
+		const double* pval = mat.GetPtrValPSuP(iblk,ncrs);
+		for(unsigned int icrs=0;icrs<ncrs;icrs++){
+			const unsigned int jblk0 = pind[icrs];
+			const double d = NormBlk(pval+icrs*blksize,blksize);
+			if( d > 0.0 && d > theta*sqrt(aNormDia[iblk]*aNormDia[jblk0]) ){ strong.array.push_back(jblk0); }
+		}
+		strong.index[iblk+1] = strong.array.size();
+	}
+	aAgg.clear();
+	aAgg.resize(nblk,-1);
+	unsigned int nagg = 0;
+	// the block whose strong neighbors are all free makes an aggregate with them
+	for(unsigned int iblk=0;iblk<nblk;iblk++){
+		if( aAgg[iblk] != -1 ) continue;
+		if( strong.index[iblk] == strong.index[iblk+1] ) continue;
+		bool is_free = true;
+		for(unsigned int icrs=strong.index[iblk];icrs<strong.index[iblk+1];icrs++){
+			if( aAgg[ strong.array[icrs] ] != -1 ){ is_free = false; break; }
+		}
+		if( !is_free ) continue;
+		aAgg[iblk] = nagg;
+		for(unsigned int icrs=strong.index[iblk];icrs<strong.index[iblk+1];icrs++){ aAgg[ strong.array[icrs] ] = nagg; }
+		nagg++;
+	}
+	// the rest joins the aggregate of its neighbor made above
+	const std::vector<int> aAgg0 = aAgg;
+	for(unsigned int iblk=0;iblk<nblk;iblk++){
+		if( aAgg0[iblk] != -1 ) continue;
+		for(unsigned int icrs=strong.index[iblk];icrs<strong.index[iblk+1];icrs++){
+			const int iagg0 = aAgg0[ strong.array[icrs] ];
+			if( iagg0 != -1 ){ aAgg[iblk] = iagg0; break; }
+		}
+	}
+	// the rest makes an aggregate with its free neighbors
+	for(unsigned int iblk=0;iblk<nblk;iblk++){
+		if( aAgg[iblk] != -1 ) continue;
+		if( strong.index[iblk] == strong.index[iblk+1] ) continue;
+		aAgg[iblk] = nagg;
+		for(unsigned int icrs=strong.index[iblk];icrs<strong.index[iblk+1];icrs++){
+			if( aAgg[ strong.array[icrs] ] == -1 ){ aAgg[ strong.array[icrs] ] = nagg; }
+		}
+		nagg++;
+	}
+	return nagg;
+}
+
+// tentative prolongation by the QR factorization of the near null space on each aggregate
+// (Q is the prolongation and R is the near null space of the coarse level)
+static void MakeTentativeProlongation(const CMatDia_BlkCrs& mat, 
+		const unsigned int nmode, const std::vector<double>& aNull, 
+		const std::vector<int>& aAgg, const unsigned int nagg,
+		CMat_BlkCrs& pro, std::vector<double>& aNull_c)
+{
+	const unsigned int nblk = mat.NBlkMatCol();
+	const unsigned int len = mat.LenBlkCol();
+	Com::CIndexedArray crs;
+	crs.InitializeSize(nblk);
+	for(unsigned int iblk=0;iblk<nblk;iblk++){
+		if( aAgg[iblk] != -1 ){ crs.array.push_back(aAgg[iblk]); }
+		crs.index[iblk+1] = crs.array.size();
+	}
+	pro.AddPattern(crs);
+	pro.SetZero();
+	Com::CIndexedArray agg2blk;
+	agg2blk.SetTranspose(nagg,crs);
+	aNull_c.clear();
+	aNull_c.resize(nmode*nagg*nmode,0.0);
+	std::vector<double> q;
+	std::vector<double> r(nmode*nmode);
+	for(unsigned int iagg=0;iagg<nagg;iagg++){
+		const unsigned int nb = agg2blk.index[iagg+1]-agg2blk.index[iagg];
+		const unsigned int nrow = nb*len;
+		q.resize(nrow*nmode);
+		for(unsigned int ib=0;ib<nb;ib++){
+			const unsigned int iblk = agg2blk.array[ agg2blk.index[iagg]+ib ];
+			for(unsigned int idof=0;idof<len;idof++){
+			for(unsigned int imode=0;imode<nmode;imode++){
+				q[(ib*len+idof)*nmode+imode] = aNull[imode*nblk*len+iblk*len+idof];
+			}
+			}
+		}
+		// modified Gram-Schmidt (the dependent column is set zero)
+		for(unsigned int i=0;i<nmode*nmode;i++){ r[i] = 0.0; }
+		for(unsigned int imode=0;imode<nmode;imode++){
+			double sq0 = 0.0;
+			for(unsigned int k=0;k<nrow;k++){ sq0 += q[k*nmode+imode]*q[k*nmode+imode]; }
+			for(unsigned int jmode=0;jmode<imode;jmode++){
+				double d = 0.0;
+				for(unsigned int k=0;k<nrow;k++){ d += q[k*nmode+jmode]*q[k*nmode+imode]; }
+				r[jmode*nmode+imode] = d;
+				for(unsigned int k=0;k<nrow;k++){ q[k*nmode+imode] -= d*q[k*nmode+jmode]; }
+			}
+			double sq = 0.0;
+			for(unsigned int k=0;k<nrow;k++){ sq += q[k*nmode+imode]*q[k*nmode+imode]; }
+			if( sq0 == 0.0 || sq < 1.0e-20*sq0 ){
+				for(unsigned int k=0;k<nrow;k++){ q[k*nmode+imode] = 0.0; }
+				continue;
+			}
+			const double norm = sqrt(sq);
+			r[imode*nmode+imode] = norm;
+			for(unsigned int k=0;k<nrow;k++){ q[k*nmode+imode] /= norm; }
+		}
+		for(unsigned int ib=0;ib<nb;ib++){
+			const unsigned int iblk = agg2blk.array[ agg2blk.index[iagg]+ib ];
+			unsigned int ncrs;
+			double* pval = pro.GetPtrValPSuP(iblk,ncrs);
+			assert( ncrs == 1 );
+			for(unsigned int i=0;i<len*nmode;i++){ pval[i] = q[ib*len*nmode+i]; }
+		}
+		for(unsigned int imode=0;imode<nmode;imode++){
+		for(unsigned int kmode=0;kmode<nmode;kmode++){
+			aNull_c[imode*nagg*nmode+iagg*nmode+kmode] = r[kmode*nmode+imode];
+		}
+		}
+	}
+}
+
+// largest eigen value of [D^-1][A] by the power iteration
+static double EstimateSpectralRadius(const CMatDia_BlkCrs& mat, const CMatDiaInv_BlkDia& dia_inv)
+{
+	const unsigned int nblk = mat.NBlkMatCol();
+	const unsigned int len = mat.LenBlkCol();
+	CVector_Blk v(nblk,len);
+	CVector_Blk w(nblk,len);
+	w.SetVectorZero();
+	unsigned int iseed = 1;
+	for(unsigned int iblk=0;iblk<nblk;iblk++){
+	for(unsigned int idof=0;idof<len;idof++){
+		iseed = iseed*1103515245+12345;
+		v.SetValue(iblk,idof,0.5+(double)((iseed>>16)%1024)/1024.0);
+	}
+	}
+	double rho = 0.0;
+	for(unsigned int iitr=0;iitr<15;iitr++){
+		const double sq = v.GetSquaredVectorNorm();
+		if( sq < 1.0e-60 ) break;
+		v *= 1.0/sqrt(sq);
+		mat.MatVec(1.0,v,0.0,w);
+		dia_inv.MatVec(1.0,w,0.0,v);
+		rho = sqrt(v.GetSquaredVectorNorm());
+	}
+	return rho;
+}
+
+// [AP] = [A][P] (the pattern of [AP] is made here)
+static void MatMat_Blk(const CMatDia_BlkCrs& a, const CMat_BlkCrs& p, CMat_BlkCrs& ap)
+{
+	const unsigned int nblk = a.NBlkMatCol();
+	const unsigned int nblk_c = p.NBlkMatRow();
+	const unsigned int len = a.LenBlkCol();
+	const unsigned int len_c = p.LenBlkRow();
+	std::vector<int> aFlg(nblk_c,-1);
+	Com::CIndexedArray crs;
+	crs.InitializeSize(nblk);
+	for(unsigned int iblk=0;iblk<nblk;iblk++){
+		unsigned int ncrs_a;
+		const unsigned int* pind_a = a.GetPtrIndPSuP(iblk,ncrs_a);
+		for(unsigned int icrs=0;icrs<ncrs_a+1;icrs++){
+			const unsigned int jblk0 = ( icrs == ncrs_a ) ? iblk : pind_a[icrs];
+			unsigned int ncrs_p;
+			const unsigned int* pind_p = p.GetPtrIndPSuP(jblk0,ncrs_p);
+			for(unsigned int jcrs=0;jcrs<ncrs_p;jcrs++){
+				const unsigned int kblk0 = pind_p[jcrs];
+				if( aFlg[kblk0] != -1 ) continue;
+				aFlg[kblk0] = 0;
+				crs.array.push_back(kblk0);
+			}
+		}
+		crs.index[iblk+1] = crs.array.size();
+		std::sort(crs.array.begin()+crs.index[iblk],crs.array.end());
+		for(unsigned int icrs=crs.index[iblk];icrs<crs.index[iblk+1];icrs++){ aFlg[ crs.array[icrs] ] = -1; }
+	}
+	ap.AddPattern(crs);
+	ap.SetZero();
+	for(unsigned int iblk=0;iblk<nblk;iblk++){
+		unsigned int ncrs_ap;
+		const unsigned int* pind_ap = ap.GetPtrIndPSuP(iblk,ncrs_ap);
+		double* pval_ap = ap.GetPtrValPSuP(iblk,ncrs_ap);
+		for(unsigned int icrs=0;icrs<ncrs_ap;icrs++){ aFlg[ pind_ap[icrs] ] = icrs; }
+		unsigned int ncrs_a;
+		const unsigned int* pind_a = a.GetPtrIndPSuP(iblk,ncrs_a);
+		const double* pval_a = a.GetPtrValPSuP(iblk,ncrs_a);
+		for(unsigned int icrs=0;icrs<ncrs_a+1;icrs++){
+			const unsigned int jblk0 = ( icrs == ncrs_a ) ? iblk : pind_a[icrs];
+			const double* pa = ( icrs == ncrs_a ) ? a.GetPtrValDia(iblk) : pval_a+icrs*len*len;
+			unsigned int ncrs_p;
+			const unsigned int* pind_p = p.GetPtrIndPSuP(jblk0,ncrs_p);
+			const double* pval_p = p.GetPtrValPSuP(jblk0,ncrs_p);
+			for(unsigned int jcrs=0;jcrs<ncrs_p;jcrs++){
+				const double* pp = pval_p+jcrs*len*len_c;
+				double* pout = pval_ap+aFlg[ pind_p[jcrs] ]*len*len_c;
+				for(unsigned int idof=0;idof<len;idof++){
+				for(unsigned int kdof=0;kdof<len;kdof++){
+					const double d = pa[idof*len+kdof];
+					for(unsigned int jdof=0;jdof<len_c;jdof++){ pout[idof*len_c+jdof] += d*pp[kdof*len_c+jdof]; }
+				}
+				}
+			}
+		}
+		for(unsigned int icrs=0;icrs<ncrs_ap;icrs++){ aFlg[ pind_ap[icrs] ] = -1; }
+	}
+}
+
+// [R] = [P]^T
+static void MakeTranspose_Blk(const CMat_BlkCrs& p, CMat_BlkCrs& r)
+{
+	const unsigned int nblk = p.NBlkMatCol();
+	const unsigned int nblk_c = p.NBlkMatRow();
+	const unsigned int len = p.LenBlkCol();
+	const unsigned int len_c = p.LenBlkRow();
+	Com::CIndexedArray crs_p;
+	crs_p.InitializeSize(nblk);
+	for(unsigned int iblk=0;iblk<nblk;iblk++){
+		unsigned int ncrs;
+		const unsigned int* pind = p.GetPtrIndPSuP(iblk,ncrs);
+		for(unsigned int icrs=0;icrs<ncrs;icrs++){ crs_p.array.push_back(pind[icrs]); }
+		crs_p.index[iblk+1] = crs_p.array.size();
+	}
+	Com::CIndexedArray crs_r;
+	crs_r.SetTranspose(nblk_c,crs_p);
+	r.AddPattern(crs_r);
+	r.SetZero();
+	std::vector<unsigned int> aCnt(nblk_c,0);
+	for(unsigned int iblk=0;iblk<nblk;iblk++){
+		unsigned int ncrs;
+		const unsigned int* pind = p.GetPtrIndPSuP(iblk,ncrs);
+		const double* pval = p.GetPtrValPSuP(iblk,ncrs);
+		for(unsigned int icrs=0;icrs<ncrs;icrs++){
+			const unsigned int jblk0 = pind[icrs];
+			unsigned int ncrs_r;
+			double* pval_r = r.GetPtrValPSuP(jblk0,ncrs_r);
+			assert( aCnt[jblk0] < ncrs_r );
+			double* pout = pval_r+aCnt[jblk0]*len*len_c;
+			aCnt[jblk0]++;
+			for(unsigned int idof=0;idof<len;idof++){
+			for(unsigned int jdof=0;jdof<len_c;jdof++){
+				pout[jdof*len+idof] = pval[icrs*len*len_c+idof*len_c+jdof];
+			}
+			}
+		}
+	}
+}
+
+// value of [Ac] = [R][AP] (the pattern of [Ac] is made by MakeGalerkin_Blk)
+static void SetGalerkinValue_Blk(const CMat_BlkCrs& r, const CMat_BlkCrs& ap, CMatDia_BlkCrs& ac)
+{
+	const unsigned int nblk_c = r.NBlkMatCol();
+	const unsigned int len_c = r.LenBlkCol();
+	const unsigned int len = r.LenBlkRow();
+	std::vector<int> aFlg(nblk_c,-1);
+	ac.SetZero();
+	for(unsigned int iblk=0;iblk<nblk_c;iblk++){
+		unsigned int ncrs_ac;
+		const unsigned int* pind_ac = ac.GetPtrIndPSuP(iblk,ncrs_ac);
+		double* pval_ac = ac.GetPtrValPSuP(iblk,ncrs_ac);
+		for(unsigned int icrs=0;icrs<ncrs_ac;icrs++){ aFlg[ pind_ac[icrs] ] = icrs; }
+		unsigned int ncrs_r;
+		const unsigned int* pind_r = r.GetPtrIndPSuP(iblk,ncrs_r);
+		const double* pval_r = r.GetPtrValPSuP(iblk,ncrs_r);
+		for(unsigned int icrs=0;icrs<ncrs_r;icrs++){
+			const double* pr = pval_r+icrs*len_c*len;
+			unsigned int ncrs_ap;
+			const unsigned int* pind_ap = ap.GetPtrIndPSuP(pind_r[icrs],ncrs_ap);
+			const double* pval_ap = ap.GetPtrValPSuP(pind_r[icrs],ncrs_ap);
+			for(unsigned int jcrs=0;jcrs<ncrs_ap;jcrs++){
+				const unsigned int kblk0 = pind_ap[jcrs];
+				const double* pap = pval_ap+jcrs*len*len_c;
+				double* pout = ( kblk0 == iblk ) ? ac.GetPtrValDia(iblk) : pval_ac+aFlg[kblk0]*len_c*len_c;
+				for(unsigned int idof=0;idof<len_c;idof++){
+				for(unsigned int kdof=0;kdof<len;kdof++){
+					const double d = pr[idof*len+kdof];
+					for(unsigned int jdof=0;jdof<len_c;jdof++){ pout[idof*len_c+jdof] += d*pap[kdof*len_c+jdof]; }
+				}
+				}
+			}
+		}
+		for(unsigned int icrs=0;icrs<ncrs_ac;icrs++){ aFlg[ pind_ac[icrs] ] = -1; }
+	}
+	// the coarse dof of the dependent near null space is decoupled
+	double max_dia = 0.0;
+	for(unsigned int iblk=0;iblk<nblk_c;iblk++){
+		const double* pdia = ac.GetPtrValDia(iblk);
+		for(unsigned int idof=0;idof<len_c;idof++){
+			max_dia = ( fabs(pdia[idof*len_c+idof]) > max_dia ) ? fabs(pdia[idof*len_c+idof]) : max_dia;
+		}
+	}
+	for(unsigned int iblk=0;iblk<nblk_c;iblk++){
+		double* pdia = ac.GetPtrValDia(iblk);
+		for(unsigned int idof=0;idof<len_c;idof++){
+			if( fabs(pdia[idof*len_c+idof]) > 1.0e-12*max_dia ) continue;
+			for(unsigned int jdof=0;jdof<len_c;jdof++){ pdia[idof*len_c+jdof] = 0.0; pdia[jdof*len_c+idof] = 0.0; }
+			pdia[idof*len_c+idof] = 1.0;
+		}
+	}
+}
+
+// [Ac] = [R][AP] (the pattern of [Ac] is made here)
+static void MakeGalerkin_Blk(const CMat_BlkCrs& r, const CMat_BlkCrs& ap, CMatDia_BlkCrs& ac)
+{
+	const unsigned int nblk_c = r.NBlkMatCol();
+	std::vector<int> aFlg(nblk_c,-1);
+	Com::CIndexedArray crs;
+	crs.InitializeSize(nblk_c);
+	for(unsigned int iblk=0;iblk<nblk_c;iblk++){
+		aFlg[iblk] = 0;
+		unsigned int ncrs_r;
+		const unsigned int* pind_r = r.GetPtrIndPSuP(iblk,ncrs_r);
+		for(unsigned int icrs=0;icrs<ncrs_r;icrs++){
+			unsigned int ncrs_ap;
+			const unsigned int* pind_ap = ap.GetPtrIndPSuP(pind_r[icrs],ncrs_ap);
+			for(unsigned int jcrs=0;jcrs<ncrs_ap;jcrs++){
+				const unsigned int kblk0 = pind_ap[jcrs];
+				if( aFlg[kblk0] != -1 ) continue;
+				aFlg[kblk0] = 0;
+				crs.array.push_back(kblk0);
+			}
+		}
+		crs.index[iblk+1] = crs.array.size();
+		std::sort(crs.array.begin()+crs.index[iblk],crs.array.end());
+		aFlg[iblk] = -1;
+		for(unsigned int icrs=crs.index[iblk];icrs<crs.index[iblk+1];icrs++){ aFlg[ crs.array[icrs] ] = -1; }
+	}
+	ac.AddPattern(crs);
+	SetGalerkinValue_Blk(r,ap,ac);
+}
+
+unsigned int CSolverMG_SA::MakeRigidBodyMode(unsigned int len, unsigned int ndim, 
+		const std::vector<double>& aCoord, std::vector<double>& aNull)
+{
+	aNull.clear();
+	if( ndim == 0 || aCoord.size() % ndim != 0 ) return 0;
+	const unsigned int nblk = aCoord.size()/ndim;
+	unsigned int nmode = len;
+	if(      len == 2 && ndim == 2 ){ nmode = 3; }
+	else if( len == 3 && ndim == 3 ){ nmode = 6; }
+	aNull.resize(nmode*nblk*len,0.0);
+	// translation
+	for(unsigned int idof=0;idof<len;idof++){
+		for(unsigned int iblk=0;iblk<nblk;iblk++){ aNull[idof*nblk*len+iblk*len+idof] = 1.0; }
+	}
+	if( nmode == len ) return nmode;
+	// rotation around the center
+	double cent[3] = { 0.0, 0.0, 0.0 };
+	for(unsigned int iblk=0;iblk<nblk;iblk++){
+		for(unsigned int idim=0;idim<ndim;idim++){ cent[idim] += aCoord[iblk*ndim+idim]; }
+	}
+	for(unsigned int idim=0;idim<ndim;idim++){ cent[idim] /= nblk; }
+	for(unsigned int iblk=0;iblk<nblk;iblk++){
+		const double x = aCoord[iblk*ndim+0]-cent[0];
+		const double y = aCoord[iblk*ndim+1]-cent[1];
+		if( ndim == 2 ){
+			aNull[2*nblk*len+iblk*len+0] = -y;
+			aNull[2*nblk*len+iblk*len+1] =  x;
+			continue;
+		}
+		const double z = aCoord[iblk*ndim+2]-cent[2];
+		aNull[3*nblk*len+iblk*len+1] = -z;	aNull[3*nblk*len+iblk*len+2] =  y;	// around x
+		aNull[4*nblk*len+iblk*len+0] =  z;	aNull[4*nblk*len+iblk*len+2] = -x;	// around y
+		aNull[5*nblk*len+iblk*len+0] = -y;	aNull[5*nblk*len+iblk*len+1] =  x;	// around z
+	}
+	return nmode;
+}
+
+CSolverMG_SA::CSolverMG_SA(const CMatDia_BlkCrs& mat, unsigned int nmode, const std::vector<double>& aNull, 
+						   MG_SMOOTHER smoother_type, unsigned int ilevel)
+{
+	m_pPro = 0; m_pRes = 0; m_pMat = 0;
+	m_pDiaInv = 0; m_pFrac = 0;
+	m_pV_c = 0; m_pV_c1 = 0; m_pV_c2 = 0;
+	m_pVf1 = 0; m_pVf2 = 0;
+	m_LayerMG_Coarse = 0;
+
+	m_Omega = 2.0/3.0;
+	m_niter_pre = 1;
+	m_niter_pos = 1;
+	m_ncycle = 1;
+	m_smoother_type = smoother_type;
+	if( smoother_type != GS && smoother_type != GS_FB && smoother_type != JAC && smoother_type != O_JAC ){
+		std::cout << "Error!-->Not Implemented Smoother (GS_FB is used)" << std::endl;
+		m_smoother_type = GS_FB;
+	}
+
+	assert( mat.LenBlkCol() > 0 );
+	const unsigned int nblk = mat.NBlkMatCol();
+	const unsigned int len = mat.LenBlkCol();
+	assert( aNull.size() == nmode*nblk*len );
+
+	if( nmode == 0 || nblk*len < 500 || ilevel >= 10 ){
+		this->MakeCoarsestSolver(mat);
+		return;
+	}
+
+	// Aggregation
+	std::vector<int> aAgg;
+	const unsigned int nagg = MakeAggregate(mat,0.08*pow(0.5,(double)ilevel),aAgg);
+	if( nagg == 0 || nagg*nmode*5 > nblk*len*4 ){	// coarsening stagnates
+		this->MakeCoarsestSolver(mat);
+		return;
+	}
+
+	m_pDiaInv = new CMatDiaInv_BlkDia(mat);
+
+	std::vector<double> aNull_c;
+	{	// Make Prolongation  P = (I - omega D^-1 A) P_tent
+		std::vector<double> aNull0 = aNull;
+		ZeroDecoupledDof(mat,nmode,aNull0);
+		CMat_BlkCrs pro_tent(nblk,len,nagg,nmode);
+		MakeTentativeProlongation(mat,nmode,aNull0,aAgg,nagg,pro_tent,aNull_c);
+		CMat_BlkCrs ap(nblk,len,nagg,nmode);
+		MatMat_Blk(mat,pro_tent,ap);
+		const double rho = EstimateSpectralRadius(mat,*m_pDiaInv);
+		const double omega = ( rho > 1.0e-30 ) ? (4.0/3.0)/rho : 0.0;
+		m_pPro = new CMat_BlkCrs(nblk,len,nagg,nmode);
+		MatMat_Blk(*m_pDiaInv,ap,*m_pPro);	// same pattern as [AP]
+		std::vector<int> aFlg(nagg,-1);
+		for(unsigned int iblk=0;iblk<nblk;iblk++){
+			unsigned int ncrs;
+			const unsigned int* pind = m_pPro->GetPtrIndPSuP(iblk,ncrs);
+			double* pval = m_pPro->GetPtrValPSuP(iblk,ncrs);
+			for(unsigned int i=0;i<ncrs*len*nmode;i++){ pval[i] *= -omega; }
+			for(unsigned int icrs=0;icrs<ncrs;icrs++){ aFlg[ pind[icrs] ] = icrs; }
+			unsigned int ncrs_t;
+			const unsigned int* pind_t = pro_tent.GetPtrIndPSuP(iblk,ncrs_t);
+			const double* pval_t = pro_tent.GetPtrValPSuP(iblk,ncrs_t);
+			for(unsigned int icrs=0;icrs<ncrs_t;icrs++){
+				assert( aFlg[ pind_t[icrs] ] != -1 );
+				double* pout = pval+aFlg[ pind_t[icrs] ]*len*nmode;
+				for(unsigned int i=0;i<len*nmode;i++){ pout[i] += pval_t[icrs*len*nmode+i]; }
+			}
+			for(unsigned int icrs=0;icrs<ncrs;icrs++){ aFlg[ pind[icrs] ] = -1; }
+		}
+	}
+
+	// Make Restriction
+	m_pRes = new CMat_BlkCrs(nagg,nmode,nblk,len);
+	MakeTranspose_Blk(*m_pPro,*m_pRes);
+
+	{	// Make Value of Matrix
+		CMat_BlkCrs ap(nblk,len,nagg,nmode);
+		MatMat_Blk(mat,*m_pPro,ap);
+		m_pMat = new CMatDia_BlkCrs(nagg,nmode);
+		MakeGalerkin_Blk(*m_pRes,ap,*m_pMat);
+	}
+
+	{	// Allocate Vector
+		m_pV_c  = new CVector_Blk(nagg,nmode);
+		m_pV_c1 = new CVector_Blk(nagg,nmode);
+		m_pV_c2 = new CVector_Blk(nagg,nmode);
+		m_pVf1 = new CVector_Blk(nblk,len);
+		m_pVf2 = new CVector_Blk(nblk,len);
+		// MatVec with beta=0 still reads the output vector
+		m_pV_c->SetVectorZero();  m_pV_c1->SetVectorZero(); m_pV_c2->SetVectorZero();
+		m_pVf1->SetVectorZero();  m_pVf2->SetVectorZero();
+	}
+
+	// Make Coarse Grid
+	m_LayerMG_Coarse = new CSolverMG_SA(*m_pMat,nmode,aNull_c,m_smoother_type,ilevel+1);
+}
+
+// the matrix of the coarsest level is factorized without the limit of the fill-in only if it is small,
+// since the coarsening may stagnate at a large matrix (ILU(0) is used then)
+void CSolverMG_SA::MakeCoarsestSolver(const CMatDia_BlkCrs& mat)
+{
+	const unsigned int ndof_direct_max = 5000;
+	const int lev_fill = ( mat.NBlkMatCol()*mat.LenBlkCol() > ndof_direct_max ) ? 0 : -1;
+	m_pFrac = new CMatDiaFrac_BlkCrs(lev_fill,mat);
+	m_pFrac->SetValue(mat);
+}
+
+bool CSolverMG_SA::SetValue(const CMatDia_BlkCrs& mat)
+{
+	if( m_LayerMG_Coarse == 0 ){
+		assert( m_pFrac != 0 );
+		return m_pFrac->SetValue(mat);
+	}
+	assert( m_pDiaInv != 0 && m_pPro != 0 && m_pRes != 0 && m_pMat != 0 );
+	assert( mat.NBlkMatCol() == m_pPro->NBlkMatCol() && mat.LenBlkCol() == m_pPro->LenBlkCol() );
+	m_pDiaInv->SetValue(mat);
+	{	// the aggregates and the prolongation are kept, only the Galerkin product is made again
+		CMat_BlkCrs ap(m_pPro->NBlkMatCol(),m_pPro->LenBlkCol(),m_pPro->NBlkMatRow(),m_pPro->LenBlkRow());
+		MatMat_Blk(mat,*m_pPro,ap);
+		SetGalerkinValue_Blk(*m_pRes,ap,*m_pMat);
+	}
+	return m_LayerMG_Coarse->SetValue(*m_pMat);
+}
+
+CSolverMG_SA::~CSolverMG_SA(){
+	if( m_pPro    != 0 ) delete m_pPro;
+	if( m_pRes    != 0 ) delete m_pRes;
+	if( m_pMat    != 0 ) delete m_pMat;
+	if( m_pFrac   != 0 ) delete m_pFrac;
+	if( m_pDiaInv != 0 ) delete m_pDiaInv;
+	////////////////
+	if( m_pV_c  != 0 ) delete m_pV_c;
+	if( m_pV_c1 != 0 ) delete m_pV_c1;
+	if( m_pV_c2 != 0 ) delete m_pV_c2;
+	if( m_pVf1 != 0 ) delete m_pVf1;
+	if( m_pVf2 != 0 ) delete m_pVf2;
+	////////////////
+	if( m_LayerMG_Coarse != 0 ) delete m_LayerMG_Coarse;
+}
+
+unsigned int CSolverMG_SA::SumOfCrsMatSize(const CMatDia_BlkCrs& mat) const
+{
+	if( m_pMat == 0 ){
+		assert( m_LayerMG_Coarse == 0 );
+		return m_pFrac->NCrs() + m_pFrac->NBlkMatCol();
+	}
+	assert( m_LayerMG_Coarse != 0 );
+	return m_LayerMG_Coarse->SumOfCrsMatSize(*m_pMat) + mat.NCrs() + mat.NBlkMatCol();
+}
+
+bool CSolverMG_SA::SolveCycle(const CMatDia_BlkCrs& mat, CVector_Blk& v_f) const 
+{
+	if( m_LayerMG_Coarse == 0 ){
+		// Calc Exact Solution
+		assert( m_pFrac != 0 );
+		m_pFrac->Solve(v_f);
+		return true;
+	}
+
+	{	// Pre Smooting
+		assert( m_pDiaInv != 0 );
+		if( m_niter_pre > 0 ){
+			if(     m_smoother_type==JAC  ){m_pDiaInv->Solve_IniJacobi(     mat,v_f,*m_pVf1        );}
+			else if(m_smoother_type==O_JAC){m_pDiaInv->Solve_IniOmegaJacobi(mat,v_f,*m_pVf1,m_Omega);}
+			else{                           m_pDiaInv->Solve_IniGaussSidel( mat,v_f,*m_pVf1        );}
+			if( m_niter_pre > 1 ){
+				if(     m_smoother_type==JAC  ){m_pDiaInv->SolveUpdate_Jacobi(     m_niter_pre-1, mat,v_f,*m_pVf1,*m_pVf2        );}
+				else if(m_smoother_type==O_JAC){m_pDiaInv->SolveUpdate_OmegaJacobi(m_niter_pre-1, mat,v_f,*m_pVf1,*m_pVf2,m_Omega);}
+				else{                           m_pDiaInv->SolveUpdate_GaussSidel( m_niter_pre-1, mat,v_f,*m_pVf1                );}
+			}
+			*m_pVf2 = v_f;
+			mat.MatVec(-1.0, *m_pVf1, 1.0, *m_pVf2);
+		}
+		else{
+			*m_pVf2 = v_f;
+			m_pVf1->SetVectorZero();
+		}
+	}
+
+	{	// Coarse Grid Corrction (repeated m_ncycle times for W-cycle)
+		m_pRes->MatVec(1.0, *m_pVf2,0.0,*m_pV_c,true);		// Restriction
+		assert( m_LayerMG_Coarse != 0 );
+		const unsigned int ncycle = ( m_LayerMG_Coarse->m_LayerMG_Coarse == 0 ) ? 1 : m_ncycle;
+		if( ncycle > 1 ){ *m_pV_c1 = *m_pV_c; }
+		m_LayerMG_Coarse->SolveCycle(*m_pMat,*m_pV_c);	// Solve Coarse Grid
+		for(unsigned int icycle=1;icycle<ncycle;icycle++){
+			*m_pV_c2 = *m_pV_c1;
+			m_pMat->MatVec(-1.0,*m_pV_c,1.0,*m_pV_c2);
+			m_LayerMG_Coarse->SolveCycle(*m_pMat,*m_pV_c2);
+			*m_pV_c += *m_pV_c2;
+		}
+		m_pPro->MatVec(1.0,*m_pV_c,1.0,*m_pVf1,true);			// Prolongation
+	}
+
+	{	// Post Smoothing
+		if( m_niter_pos > 0 ){
+			if(     m_smoother_type==JAC  ){m_pDiaInv->SolveUpdate_Jacobi(     m_niter_pos, mat, v_f,*m_pVf1,*m_pVf2        );}
+			else if(m_smoother_type==O_JAC){m_pDiaInv->SolveUpdate_OmegaJacobi(m_niter_pos, mat, v_f,*m_pVf1,*m_pVf2,m_Omega);}
+			else if(m_smoother_type==GS   ){m_pDiaInv->SolveUpdate_GaussSidel( m_niter_pos, mat, v_f,*m_pVf1                );}
+			else{                           m_pDiaInv->SolveUpdate_GaussSidel_BackWard(  m_niter_pos, mat, v_f,*m_pVf1      );}
+		}
+		v_f = *m_pVf1;
+	}
+	return true;
+}
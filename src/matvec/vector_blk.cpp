@@ -28,6 +28,9 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 
 using namespace MatVec;
 
+// vectors shorter than this are not worth waking up the threads
+static const int ndof_omp_min = 4096;
+
 //////////////////////////////////////////////////////////////////////
 // 񃁃õth̃Iy[^
 //////////////////////////////////////////////////////////////////////
@@ -42,10 +45,67 @@ double operator*(const CVector_Blk& lhs, const CVector_Blk& rhs){
 	const double* prhs = rhs.m_Value;
 	const double* plhs = lhs.m_Value;
 	const unsigned int ndof = lhs.GetTotalDofSize();
-	for(unsigned int idof=0;idof<ndof;idof++){ dot += plhs[idof]*prhs[idof]; }
+#if defined(_OPENMP)
+#pragma omp parallel for if( (int)ndof > ndof_omp_min ) reduction(+:dot)
+#endif
+	for(int idof=0;idof<(int)ndof;idof++){ dot += plhs[idof]*prhs[idof]; }
 	return dot;
 }
 
+void DotMulti(unsigned int ndot, const CVector_Blk* const* apv1, const CVector_Blk* const* apv2, double* adot){
+	if( ndot == 0 ) return;
+	const unsigned int ndof = apv1[0]->GetTotalDofSize();
+	for(unsigned int idot=0;idot<ndot;idot++){
+		assert( apv1[idot]->GetTotalDofSize() == ndof );
+		assert( apv2[idot]->GetTotalDofSize() == ndof );
+	}
+	if( ndot > 8 ){	// too many for the register, sweep for each 8 pairs
+		for(unsigned int idot=0;idot<ndot;idot+=8){
+			const unsigned int nblk = ( ndot-idot < 8 ) ? ndot-idot : 8;
+			DotMulti(nblk,apv1+idot,apv2+idot,adot+idot);
+		}
+		return;
+	}
+	const double* ap1[8];
+	const double* ap2[8];
+	double ad[8];
+	for(unsigned int idot=0;idot<ndot;idot++){
+		ap1[idot] = apv1[idot]->m_Value;
+		ap2[idot] = apv2[idot]->m_Value;
+		ad[idot] = 0.0;
+	}
+	for(unsigned int idof=0;idof<ndof;idof++){
+		for(unsigned int idot=0;idot<ndot;idot++){ ad[idot] += ap1[idot][idof]*ap2[idot][idof]; }
+	}
+	for(unsigned int idot=0;idot<ndot;idot++){ adot[idot] += ad[idot]; }
+}
+
+void AxpyMulti(unsigned int nvec, const double* aalpha, const CVector_Blk* const* apv, CVector_Blk& y){
+	if( nvec == 0 ) return;
+	const unsigned int ndof = y.GetTotalDofSize();
+	for(unsigned int ivec=0;ivec<nvec;ivec++){
+		assert( apv[ivec]->GetTotalDofSize() == ndof );
+	}
+	if( nvec > 8 ){	// too many for the register, sweep for each 8 vectors
+		for(unsigned int ivec=0;ivec<nvec;ivec+=8){
+			const unsigned int nblk = ( nvec-ivec < 8 ) ? nvec-ivec : 8;
+			AxpyMulti(nblk,aalpha+ivec,apv+ivec,y);
+		}
+		return;
+	}
+	const double* ap[8];
+	for(unsigned int ivec=0;ivec<nvec;ivec++){ ap[ivec] = apv[ivec]->m_Value; }
+	double* py = y.m_Value;
+#if defined(_OPENMP)
+#pragma omp parallel for if( (int)ndof > ndof_omp_min )
+#endif
+	for(int idof=0;idof<(int)ndof;idof++){
+		double d = py[idof];
+		for(unsigned int ivec=0;ivec<nvec;ivec++){ d += aalpha[ivec]*ap[ivec][idof]; }
+		py[idof] = d;
+	}
+}
+
 }
 
 ////////////////////////////////////////////////
@@ -55,7 +115,10 @@ double operator*(const CVector_Blk& lhs, const CVector_Blk& rhs){
 CVector_Blk& CVector_Blk::operator*=(double d0){	// Scaler Product
 	double* plhs = this->m_Value;
 	const unsigned int ndof = this->GetTotalDofSize();
-	for(unsigned int idof=0;idof<ndof;idof++){ plhs[idof] *= d0; }
+#if defined(_OPENMP)
+#pragma omp parallel for if( (int)ndof > ndof_omp_min )
+#endif
+	for(int idof=0;idof<(int)ndof;idof++){ plhs[idof] *= d0; }
 	return *this; 
 }
 
@@ -92,10 +155,53 @@ CVector_Blk& CVector_Blk::AXPY(const double& alpha, const CVector_Blk& rhs){ //
 	const double* prhs = rhs.m_Value;
 	double* plhs = this->m_Value;
 	const unsigned int ndof = this->GetTotalDofSize();
-	for(unsigned int idof=0;idof<ndof;idof++){ plhs[idof] += alpha*prhs[idof]; }
+#if defined(_OPENMP)
+#pragma omp parallel for if( (int)ndof > ndof_omp_min )
+#endif
+	for(int idof=0;idof<(int)ndof;idof++){ plhs[idof] += alpha*prhs[idof]; }
+	return *this;
+}
+
+CVector_Blk& CVector_Blk::AXPBY(const double& alpha, const CVector_Blk& rhs, const double& beta){
+	assert( this->Len() == rhs.Len() ); 
+	assert( this->NBlk() == rhs.NBlk() );
+	assert( this->GetTotalDofSize() == rhs.GetTotalDofSize() );
+	const double* prhs = rhs.m_Value;
+	double* plhs = this->m_Value;
+	const unsigned int ndof = this->GetTotalDofSize();
+	if( beta == 0.0 ){	// {this} may be uninitialized
+#if defined(_OPENMP)
+#pragma omp parallel for if( (int)ndof > ndof_omp_min )
+#endif
+		for(int idof=0;idof<(int)ndof;idof++){ plhs[idof] = alpha*prhs[idof]; }
+		return *this;
+	}
+#if defined(_OPENMP)
+#pragma omp parallel for if( (int)ndof > ndof_omp_min )
+#endif
+	for(int idof=0;idof<(int)ndof;idof++){ plhs[idof] = alpha*prhs[idof] + beta*plhs[idof]; }
 	return *this;
 }
 
+double CVector_Blk::AXPY_SqNorm(const double& alpha, const CVector_Blk& rhs){
+	assert( this->Len() == rhs.Len() ); 
+	assert( this->NBlk() == rhs.NBlk() );
+	assert( this->GetTotalDofSize() == rhs.GetTotalDofSize() );
+	const double* prhs = rhs.m_Value;
+	double* plhs = this->m_Value;
+	const unsigned int ndof = this->GetTotalDofSize();
+	double sqnorm = 0.0;
+#if defined(_OPENMP)
+#pragma omp parallel for if( (int)ndof > ndof_omp_min ) reduction(+:sqnorm)
+#endif
+	for(int idof=0;idof<(int)ndof;idof++){
+		const double d = plhs[idof] + alpha*prhs[idof];
+		plhs[idof] = d;
+		sqnorm += d*d;
+	}
+	return sqnorm;
+}
+
 
 void CVector_Blk::SetVectorZero(){	// Set 0 to Value
 	double* plhs = this->m_Value;
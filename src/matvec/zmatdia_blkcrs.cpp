@@ -20,7 +20,9 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #if defined(__VISUALC__)
     #pragma warning( disable : 4786 )
 #endif
+#if !defined(_OPENMP)
 #define for if(0); else for
+#endif
 
 #include <iostream>
 #include <cassert>
@@ -34,6 +36,8 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 
 #include "delfem/matvec/zmatdia_blkcrs.h"
 #include "delfem/matvec/vector_blk.h"
+#include "delfem/matvec/zvector_blk.h"
+#include "delfem/matvec/ker_zblk.h"
 
 using namespace MatVec;
 
@@ -46,6 +50,7 @@ CZMatDia_BlkCrs::CZMatDia_BlkCrs(const unsigned int nblk_colrow, const unsigned
 {
 //	std::cout << "Construct : CZMatDia_BlkCrs(nblk_colrow, len_colrow) " << nblk_colrow << " " << len_colrow << std::endl;
 	m_valDia_Blk = new Com::Complex [m_nblk_MatCol*m_len_BlkCol*m_len_BlkRow];
+	m_valCrs_Real = 0;
 }
 
 CZMatDia_BlkCrs::CZMatDia_BlkCrs(const CZMatDia_BlkCrs& rhs, const bool is_value, const bool isnt_trans, const bool isnt_conj)
@@ -62,6 +67,7 @@ CZMatDia_BlkCrs::CZMatDia_BlkCrs(const CZMatDia_BlkCrs& rhs, const bool is_value
 	assert( m_len_BlkCol == m_len_BlkRow );
 	
 	m_valDia_Blk = new Com::Complex [m_nblk_MatCol*m_len_BlkCol*m_len_BlkRow];
+	m_valCrs_Real = 0;
 
 	if( is_value ){ 
 		if( isnt_trans ){
@@ -108,6 +114,7 @@ CZMatDia_BlkCrs::CZMatDia_BlkCrs(const CZMatDia_BlkCrs& rhs, const bool is_value
 CZMatDia_BlkCrs::CZMatDia_BlkCrs(const std::string& file_path)
     :CZMat_BlkCrs()
 {
+	m_valCrs_Real = 0;
 	FILE* fp;
 	
 	if ((fp = fopen(file_path.c_str(), "r")) == NULL) {
@@ -175,14 +182,17 @@ CZMatDia_BlkCrs::CZMatDia_BlkCrs(const std::string& file_path)
 CZMatDia_BlkCrs::~CZMatDia_BlkCrs()
 {
 	if( m_valDia_Blk != 0 ){ delete[] m_valDia_Blk; m_valDia_Blk = 0; }
+	this->ClearRealCrsValue();
 }
 
 bool CZMatDia_BlkCrs::DeletePattern(){
+	this->ClearRealCrsValue();
 	CZMat_BlkCrs::DeletePattern();
 	return true;
 }
 
 bool CZMatDia_BlkCrs::SetZero(){
+	this->ClearRealCrsValue();
 	CZMat_BlkCrs::SetZero();
 	const unsigned int ndof = m_nblk_MatCol*m_len_BlkCol*m_len_BlkCol;
 	for(unsigned int idof=0;idof<ndof;idof++){ m_valDia_Blk[idof] = 0.0; }
@@ -202,6 +212,7 @@ bool CZMatDia_BlkCrs::Mearge(
 {
 	assert( m_valCrs_Blk != 0 );
 	assert( m_valDia_Blk != 0 );
+	this->ClearRealCrsValue();
 
 	const unsigned int BlkSize = m_len_BlkCol*m_len_BlkRow;
 //	const unsigned int BlkLen = m_len_BlkCol;
@@ -239,6 +250,7 @@ bool CZMatDia_BlkCrs::Mearge(
 bool CZMatDia_BlkCrs::SetBoundaryCondition(const MatVec::CBCFlag& bc_flag){
 
 	assert( m_len_BlkCol == m_len_BlkRow );
+	this->ClearRealCrsValue();
 	const unsigned int BlkSize = m_len_BlkCol*m_len_BlkRow;
 	const unsigned int BlkLen = m_len_BlkCol;
 	
@@ -267,7 +279,30 @@ bool CZMatDia_BlkCrs::SetBoundaryCondition(const MatVec::CBCFlag& bc_flag){
 	return true;
 }
 
+// the functions of CZMat_BlkCrs which change the values or the pattern remove the real copy first
+
+bool CZMatDia_BlkCrs::AddPattern(const CZMat_BlkCrs& rhs, const bool isnt_trans){
+	this->ClearRealCrsValue();
+	return CZMat_BlkCrs::AddPattern(rhs,isnt_trans);
+}
+
+bool CZMatDia_BlkCrs::SetValue(const CZMat_BlkCrs& rhs, const bool isnt_trans, bool isnt_conj){
+	this->ClearRealCrsValue();
+	return CZMat_BlkCrs::SetValue(rhs,isnt_trans,isnt_conj);
+}
+
+bool CZMatDia_BlkCrs::SetBoundaryCondition_Row(const CBCFlag& bc_flag){
+	this->ClearRealCrsValue();
+	return CZMat_BlkCrs::SetBoundaryCondition_Row(bc_flag);
+}
+
+bool CZMatDia_BlkCrs::SetBoundaryCondition_Colum(const CBCFlag& bc_flag){
+	this->ClearRealCrsValue();
+	return CZMat_BlkCrs::SetBoundaryCondition_Colum(bc_flag);
+}
+
 bool CZMatDia_BlkCrs::AddPattern(const CZMatDia_BlkCrs& rhs, const bool isnt_trans){
+	this->ClearRealCrsValue();
 	if(  isnt_trans ){
 		assert( m_nblk_MatCol == rhs.m_nblk_MatRow );
 		assert( m_nblk_MatRow == rhs.m_nblk_MatCol );
@@ -290,6 +325,7 @@ bool CZMatDia_BlkCrs::AddPattern(const CZMatDia_BlkCrs& rhs, const bool isnt_tra
 }
 
 bool CZMatDia_BlkCrs::AddPattern(const CZMat_BlkCrs& m1, const CZMatDia_BlkCrs& m2, const CZMat_BlkCrs& m3){
+	this->ClearRealCrsValue();
 	assert( m_nblk_MatCol  == m1.NBlkMatCol() );
 	assert( m1.NBlkMatRow() == m2.NBlkMatCol() );
 	assert( m2.NBlkMatRow() == m3.NBlkMatCol() );
@@ -405,6 +441,7 @@ bool CZMatDia_BlkCrs::AddPattern(const CZMat_BlkCrs& m1, const CZMatDia_BlkCrs&
 // [p^[
 bool CZMatDia_BlkCrs::AddPattern(const Com::CIndexedArray& crs)
 {
+	this->ClearRealCrsValue();
 	// ̓`FbN
 	assert( crs.CheckValid() );
 	if( !crs.CheckValid() ) return false;
@@ -551,6 +588,7 @@ bool CZMatDia_BlkCrs::AddPattern(const Com::CIndexedArray& crs)
 }
 
 bool CZMatDia_BlkCrs::SetValue(const CZMatDia_BlkCrs& rhs, const bool isnt_trans){
+	this->ClearRealCrsValue();
 	assert( m_nblk_MatRow == rhs.m_nblk_MatRow );
 	assert( m_nblk_MatCol == rhs.m_nblk_MatCol );
 	assert( m_nblk_MatCol == m_nblk_MatRow );
@@ -582,6 +620,7 @@ bool CZMatDia_BlkCrs::SetValue(const CZMatDia_BlkCrs& rhs, const bool isnt_trans
 }
 
 bool CZMatDia_BlkCrs::SetValue(const CZMat_BlkCrs& m1, const CZMatDia_BlkCrs& m2, const CZMat_BlkCrs& m3){
+	this->ClearRealCrsValue();
 	assert( m_nblk_MatRow == m_nblk_MatRow );
 	assert( m_nblk_MatCol  == m1.NBlkMatCol() );
 	assert( m1.NBlkMatRow() == m2.NBlkMatCol() );
@@ -732,6 +771,89 @@ bool CZMatDia_BlkCrs::SetValue(const CZMat_BlkCrs& m1, const CZMatDia_BlkCrs& m2
 	return true;
 }
 
+bool CZMatDia_BlkCrs::SetValue_Combination(unsigned int nmat, const CZMatDia_BlkCrs* const* apMat, const Com::Complex* aCoeff)
+{
+	this->ClearRealCrsValue();
+	const unsigned int BlkSize = m_len_BlkCol*m_len_BlkRow;
+	const unsigned int ndia = m_nblk_MatCol*BlkSize;
+	const unsigned int ncrs = m_ncrs_Blk*BlkSize;
+	for(unsigned int imat=0;imat<nmat;imat++){
+		const CZMatDia_BlkCrs& mat = *apMat[imat];
+		if( mat.m_nblk_MatCol != m_nblk_MatCol || mat.m_len_BlkCol != m_len_BlkCol || mat.m_ncrs_Blk != m_ncrs_Blk ) return false;
+		for(unsigned int iblk=0;iblk<m_nblk_MatCol+1;iblk++){
+			if( mat.m_colInd_Blk[iblk] != m_colInd_Blk[iblk] ) return false;
+		}
+		for(unsigned int icrs=0;icrs<m_ncrs_Blk;icrs++){
+			if( mat.m_rowPtr_Blk[icrs] != m_rowPtr_Blk[icrs] ) return false;
+		}
+	}
+	for(unsigned int i=0;i<ndia;i++){ m_valDia_Blk[i] = 0.0; }
+	for(unsigned int i=0;i<ncrs;i++){ m_valCrs_Blk[i] = 0.0; }
+	for(unsigned int imat=0;imat<nmat;imat++){
+		const CZMatDia_BlkCrs& mat = *apMat[imat];
+		const double cr = aCoeff[imat].Real();
+		const double ci = aCoeff[imat].Imag();
+		Ker::ZAxpy(ndia,cr,ci,Ker::ZPtr(mat.m_valDia_Blk),Ker::ZPtr(m_valDia_Blk));
+		Ker::ZAxpy(ncrs,cr,ci,Ker::ZPtr(mat.m_valCrs_Blk),Ker::ZPtr(m_valCrs_Blk));
+	}
+	return true;
+}
+
+bool CZMatDia_BlkCrs::MakeRealCrsValue()
+{
+	this->ClearRealCrsValue();
+	const unsigned int nval = m_ncrs_Blk*m_len_BlkCol*m_len_BlkRow;
+	for(unsigned int ival=0;ival<nval;ival++){
+		if( m_valCrs_Blk[ival].Imag() != 0.0 ) return false;
+	}
+	m_valCrs_Real = new double [nval];
+	for(unsigned int ival=0;ival<nval;ival++){ m_valCrs_Real[ival] = m_valCrs_Blk[ival].Real(); }
+	return true;
+}
+
+// row loop of MatVec with the block length fixed at compile time
+// valcrs is the real copy if IS_REAL, the interleaved complex values otherwise
+template<unsigned int N, bool IS_REAL>
+static void ZMatVec_Fix(const unsigned int nblk, const unsigned int* colind, const unsigned int* rowptr, 
+                        const double* valcrs, const double* valdia,
+                        const double alpha, const double* xval, const double beta, double* yval)
+{
+#if defined(_OPENMP)
+#pragma omp parallel for
+#endif
+	for(int iiblk=0;iiblk<(int)nblk;iiblk++){ const unsigned int iblk = iiblk;
+		double t[N*2];
+		for(unsigned int i=0;i<N*2;i++){ t[i] = 0.0; }
+		const unsigned int icrs0 = colind[iblk];
+		const unsigned int icrs1 = colind[iblk+1];
+		if( N == 1 ){	// gather with two accumulators
+			if( IS_REAL ){ Ker::ZRowDotReal(icrs1-icrs0,valcrs+icrs0,  rowptr+icrs0,xval,t); }
+			else{          Ker::ZRowDot(    icrs1-icrs0,valcrs+icrs0*2,rowptr+icrs0,xval,t); }
+		}
+		else{
+			for(unsigned int icrs=icrs0;icrs<icrs1;icrs++){
+				const unsigned int jblk0 = rowptr[icrs];
+				assert( jblk0 < nblk );
+				if( IS_REAL ){ Ker::ZAddRealMatVec<N>(t,1.0,valcrs+icrs*N*N,  xval+jblk0*N*2); }
+				else{          Ker::ZAddMatVec<N>(    t,1.0,valcrs+icrs*N*N*2,xval+jblk0*N*2); }
+			}
+		}
+		Ker::ZAddMatVec<N>(t,1.0,valdia+iblk*N*N*2,xval+iblk*N*2);
+		double* iyval = yval+iblk*N*2;
+		for(unsigned int i=0;i<N*2;i++){ iyval[i] = beta*iyval[i] + alpha*t[i]; }
+	}
+}
+
+// choose the real or the complex off-diagonal values
+template<unsigned int N>
+static void ZMatVec_Blk(const unsigned int nblk, const unsigned int* colind, const unsigned int* rowptr, 
+                        const Com::Complex* valcrs, const double* valcrs_real, const Com::Complex* valdia,
+                        const double alpha, const double* xval, const double beta, double* yval)
+{
+	if( valcrs_real != 0 ){ ZMatVec_Fix<N,true >(nblk,colind,rowptr,valcrs_real,     Ker::ZPtr(valdia),alpha,xval,beta,yval); }
+	else{                   ZMatVec_Fix<N,false>(nblk,colind,rowptr,Ker::ZPtr(valcrs),Ker::ZPtr(valdia),alpha,xval,beta,yval); }
+}
+
 // Calc Matrix Vector Product
 // {y} = alpha * [A]{x} + beta * {y}
 bool CZMatDia_BlkCrs::MatVec(double alpha, const CZVector_Blk& x, double beta, CZVector_Blk& y) const
@@ -747,29 +869,13 @@ bool CZMatDia_BlkCrs::MatVec(double alpha, const CZVector_Blk& x, double beta, C
 	const unsigned int BlkLen = m_len_BlkCol;
 	const unsigned int BlkSize = BlkLen*BlkLen;
 
-	if( BlkSize == 1 ){
-		const Com::Complex* xval = x.m_Value;
-		Com::Complex* yval = y.m_Value;
-		const unsigned int nblk = m_nblk_MatCol;
-		for(unsigned int iblk=0;iblk<nblk;iblk++){
-			double real0 = 0;
-			double imag0 = 0;
-			const unsigned int crs0 = m_colInd_Blk[iblk];
-			const unsigned int crs1 = m_colInd_Blk[iblk+1];
-			for(unsigned int icrs=crs0;icrs<crs1;icrs++){
-				assert( icrs < m_ncrs_Blk );
-				const unsigned int jblk0 = m_rowPtr_Blk[icrs];
-				assert( jblk0 < m_nblk_MatRow );
-				real0 += alpha * (m_valCrs_Blk[icrs].Real()*xval[jblk0].Real() - m_valCrs_Blk[icrs].Imag()*xval[jblk0].Imag());
-				imag0 += alpha * (m_valCrs_Blk[icrs].Real()*xval[jblk0].Imag() + m_valCrs_Blk[icrs].Imag()*xval[jblk0].Real());
-			}
-			Com::Complex* iyval = yval+iblk;
-			(*iyval) *= beta;
-			(*iyval) += Com::Complex(real0,imag0);
-			(*iyval) += alpha*m_valDia_Blk[iblk]*xval[iblk];
-		}
+	switch( BlkLen ){
+	case 1: ZMatVec_Blk<1>(m_nblk_MatCol,m_colInd_Blk,m_rowPtr_Blk,m_valCrs_Blk,m_valCrs_Real,m_valDia_Blk,alpha,Ker::ZPtr(x.m_Value),beta,Ker::ZPtr(y.m_Value)); return true;
+	case 2: ZMatVec_Blk<2>(m_nblk_MatCol,m_colInd_Blk,m_rowPtr_Blk,m_valCrs_Blk,m_valCrs_Real,m_valDia_Blk,alpha,Ker::ZPtr(x.m_Value),beta,Ker::ZPtr(y.m_Value)); return true;
+	case 3: ZMatVec_Blk<3>(m_nblk_MatCol,m_colInd_Blk,m_rowPtr_Blk,m_valCrs_Blk,m_valCrs_Real,m_valDia_Blk,alpha,Ker::ZPtr(x.m_Value),beta,Ker::ZPtr(y.m_Value)); return true;
+	default: break;
 	}
-	else{
+	{
 		const Com::Complex* xval = x.m_Value;
 		Com::Complex* yval = y.m_Value;
 		for(unsigned int iblk=0;iblk<m_nblk_MatCol;iblk++){
@@ -851,3 +957,91 @@ bool CZMatDia_BlkCrs::MatVec_Hermitian(double alpha, const CZVector_Blk& x, doub
 	}
 	return true;
 }
+
+// {t_j} += [a]{x_j} for the nrhs vectors in a block (a is real if IS_REAL)
+// the vectors are interleaved, the idof-th dof of the j-th vector is at idof*nrhs+j
+template<bool IS_REAL>
+static inline void ZAddBlkMulti(const unsigned int len, const unsigned int nrhs, const double* a, const double* x, double* t)
+{
+	for(unsigned int idof=0;idof<len;idof++){
+	for(unsigned int jdof=0;jdof<len;jdof++){
+		const double* xj = x+jdof*nrhs*2;
+		double* ti = t+idof*nrhs*2;
+		if( IS_REAL ){
+			const double aij = a[idof*len+jdof];
+			for(unsigned int irhs=0;irhs<nrhs;irhs++){
+				ti[irhs*2  ] += aij*xj[irhs*2  ];
+				ti[irhs*2+1] += aij*xj[irhs*2+1];
+			}
+		}
+		else{
+			const double* aij = a+(idof*len+jdof)*2;
+			for(unsigned int irhs=0;irhs<nrhs;irhs++){
+				ti[irhs*2  ] += aij[0]*xj[irhs*2  ] - aij[1]*xj[irhs*2+1];
+				ti[irhs*2+1] += aij[0]*xj[irhs*2+1] + aij[1]*xj[irhs*2  ];
+			}
+		}
+	}
+	}
+}
+
+// row loop of MatVec_Multi
+template<bool IS_REAL>
+static void ZMatVec_Multi(const unsigned int nblk, const unsigned int len, const unsigned int nrhs,
+                          const unsigned int* colind, const unsigned int* rowptr, 
+                          const double* valcrs, const double* valdia,
+                          const double* alpha, const double* xval, const double beta, double* yval)
+{
+	const unsigned int BlkSize = len*len;
+	const unsigned int nval = nrhs*len*2;	// doubles in a block of the vectors
+#if defined(_OPENMP)
+#pragma omp parallel
+#endif
+	{
+		std::vector<double> t(nval);
+#if defined(_OPENMP)
+#pragma omp for
+#endif
+		for(int iiblk=0;iiblk<(int)nblk;iiblk++){ const unsigned int iblk = iiblk;
+			for(unsigned int i=0;i<nval;i++){ t[i] = 0.0; }
+			for(unsigned int icrs=colind[iblk];icrs<colind[iblk+1];icrs++){
+				const unsigned int jblk0 = rowptr[icrs];
+				assert( jblk0 < nblk );
+				if( IS_REAL ){ ZAddBlkMulti<true >(len,nrhs,valcrs+icrs*BlkSize,  xval+jblk0*nval,&t[0]); }
+				else{          ZAddBlkMulti<false>(len,nrhs,valcrs+icrs*BlkSize*2,xval+jblk0*nval,&t[0]); }
+			}
+			ZAddBlkMulti<false>(len,nrhs,valdia+iblk*BlkSize*2,xval+iblk*nval,&t[0]);
+			double* iyval = yval+iblk*nval;
+			for(unsigned int idof=0;idof<len;idof++){
+				for(unsigned int irhs=0;irhs<nrhs;irhs++){
+					const double ar = alpha[irhs*2], ai = alpha[irhs*2+1];
+					const unsigned int i = (idof*nrhs+irhs)*2;
+					iyval[i  ] = beta*iyval[i  ] + ar*t[i] - ai*t[i+1];
+					iyval[i+1] = beta*iyval[i+1] + ar*t[i+1] + ai*t[i];
+				}
+			}
+		}
+	}
+}
+
+bool CZMatDia_BlkCrs::MatVec_Multi(unsigned int nrhs, const Com::Complex* alpha, const CZVector_Blk& x, double beta, CZVector_Blk& y) const
+{
+	assert( m_nblk_MatCol == m_nblk_MatRow );
+	assert( m_len_BlkCol == m_len_BlkRow );
+
+	assert( x.BlkVecLen() == m_nblk_MatRow );
+	assert( x.BlkLen() == m_len_BlkRow*nrhs );
+
+	assert( y.BlkVecLen() == m_nblk_MatCol );
+	assert( y.BlkLen() == m_len_BlkCol*nrhs );
+
+	if( m_valCrs_Real != 0 ){
+		ZMatVec_Multi<true >(m_nblk_MatCol,m_len_BlkCol,nrhs,m_colInd_Blk,m_rowPtr_Blk,m_valCrs_Real,Ker::ZPtr(m_valDia_Blk),
+			Ker::ZPtr(alpha),Ker::ZPtr(x.m_Value),beta,Ker::ZPtr(y.m_Value));
+	}
+	else{
+		ZMatVec_Multi<false>(m_nblk_MatCol,m_len_BlkCol,nrhs,m_colInd_Blk,m_rowPtr_Blk,Ker::ZPtr(m_valCrs_Blk),Ker::ZPtr(m_valDia_Blk),
+			Ker::ZPtr(alpha),Ker::ZPtr(x.m_Value),beta,Ker::ZPtr(y.m_Value));
+	}
+	return true;
+}
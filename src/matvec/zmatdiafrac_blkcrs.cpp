@@ -20,7 +20,9 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #if defined(__VISUALC__)
 #pragma warning( disable : 4786 )   // C4786Ȃĕ\( ߄D)٧
 #endif
+#if !defined(_OPENMP)
 #define for if(0); else for
+#endif
 
 #include <cassert>
 #include <iostream>
@@ -30,6 +32,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 
 #include "delfem/matvec/zmatdiafrac_blkcrs.h"
 #include "delfem/matvec/zvector_blk.h"
+#include "delfem/matvec/ker_zblk.h"
 
 using namespace MatVec;
 
@@ -116,18 +119,21 @@ CZMatDiaFrac_BlkCrs::~CZMatDiaFrac_BlkCrs()
 bool CZMatDiaFrac_BlkCrs::ForwardSubstitution(CZVector_Blk& vec) const
 {
 	assert( m_nblk_MatRow == m_nblk_MatCol );
+	if( m_nblk_MatCol == 0 ) return true;
 	if( this->m_len_BlkCol == 1 ){
+		const double* valcrs = Ker::ZPtr(m_valCrs_Blk);
+		const double* valdia = Ker::ZPtr(m_valDia_Blk);
+		double* val = Ker::ZPtr(vec.GetValuePtr(0));
 		for(unsigned int inode=0;inode<m_nblk_MatCol;inode++){
-			Com::Complex lvec_i = vec.GetValue(inode,0);
 			const unsigned int ijcrs0 = m_colInd_Blk[inode];
 			const unsigned int ijcrs1 = m_DiaInd[inode];
-			for(unsigned int ijcrs=ijcrs0;ijcrs<ijcrs1;ijcrs++){
-				assert( ijcrs<m_ncrs_Blk );
-				const unsigned int jnode0 = m_rowPtr_Blk[ijcrs];
-				assert( jnode0<inode );
-				lvec_i -= m_valCrs_Blk[ijcrs]*vec.GetValue(jnode0,0);
-			}
-			vec.SetValue(inode,0,m_valDia_Blk[inode]*lvec_i);
+			double d[2];
+			Ker::ZRowDot(ijcrs1-ijcrs0,valcrs+ijcrs0*2,m_rowPtr_Blk+ijcrs0,val,d);
+			const double lr = val[inode*2  ] - d[0];
+			const double li = val[inode*2+1] - d[1];
+			const double* dia = valdia+inode*2;
+			val[inode*2  ] = dia[0]*lr - dia[1]*li;
+			val[inode*2+1] = dia[0]*li + dia[1]*lr;
 		}
 	}
 	else{
@@ -139,19 +145,18 @@ bool CZMatDiaFrac_BlkCrs::ForwardSubstitution(CZVector_Blk& vec) const
 
 bool CZMatDiaFrac_BlkCrs::BackwardSubstitution(CZVector_Blk& vec) const
 {
+	if( m_nblk_MatCol == 0 ) return true;
 	if( this->m_len_BlkCol == 1 ){
+		const double* valcrs = Ker::ZPtr(m_valCrs_Blk);
+		double* val = Ker::ZPtr(vec.GetValuePtr(0));
 		for(int inode=m_nblk_MatCol-1;inode>=0;inode--){
             assert( inode < (int)m_nblk_MatCol );
-			Com::Complex lvec_i = vec.GetValue(inode,0);
 			const unsigned int ijcrs0 = m_DiaInd[inode];
 			const unsigned int ijcrs1 = m_colInd_Blk[inode+1];
-			for(unsigned int ijcrs=ijcrs0;ijcrs<ijcrs1;ijcrs++){
-				assert( ijcrs<m_ncrs_Blk );
-				const unsigned int jnode0 = m_rowPtr_Blk[ijcrs];
-                assert( (int)jnode0>inode && (int)jnode0<(int)m_nblk_MatRow );
-				lvec_i -=  m_valCrs_Blk[ijcrs]*vec.GetValue(jnode0,0);
-			}
-			vec.SetValue(inode,0,lvec_i);
+			double d[2];
+			Ker::ZRowDot(ijcrs1-ijcrs0,valcrs+ijcrs0*2,m_rowPtr_Blk+ijcrs0,val,d);
+			val[inode*2  ] -= d[0];
+			val[inode*2+1] -= d[1];
 		}
 	}
 	else{
@@ -160,6 +165,46 @@ bool CZMatDiaFrac_BlkCrs::BackwardSubstitution(CZVector_Blk& vec) const
 	}
 	return true;
 }
+bool CZMatDiaFrac_BlkCrs::Solve_Multi(unsigned int nrhs, CZVector_Blk& vec) const
+{
+	assert( m_nblk_MatRow == m_nblk_MatCol );
+	assert( vec.BlkLen() == m_len_BlkCol*nrhs );
+	if( m_nblk_MatCol == 0 ) return true;
+	if( this->m_len_BlkCol != 1 ){
+		std::cout << "Error!-->Not Implimented!" << std::endl;
+		assert(0);
+		return false;
+	}
+	const double* valcrs = Ker::ZPtr(m_valCrs_Blk);
+	const double* valdia = Ker::ZPtr(m_valDia_Blk);
+	double* val = Ker::ZPtr(vec.GetValuePtr(0));
+	const unsigned int nval = nrhs*2;
+	for(unsigned int inode=0;inode<m_nblk_MatCol;inode++){
+		double* vi = val+inode*nval;
+		for(unsigned int ijcrs=m_colInd_Blk[inode];ijcrs<m_DiaInd[inode];ijcrs++){
+			const double* a = valcrs+ijcrs*2;
+			const double* vj = val+m_rowPtr_Blk[ijcrs]*nval;
+			for(unsigned int irhs=0;irhs<nrhs;irhs++){
+				vi[irhs*2  ] -= a[0]*vj[irhs*2  ] - a[1]*vj[irhs*2+1];
+				vi[irhs*2+1] -= a[0]*vj[irhs*2+1] + a[1]*vj[irhs*2  ];
+			}
+		}
+		Ker::ZScale(nrhs,valdia[inode*2],valdia[inode*2+1],vi);
+	}
+	for(int inode=m_nblk_MatCol-1;inode>=0;inode--){
+		double* vi = val+inode*nval;
+		for(unsigned int ijcrs=m_DiaInd[inode];ijcrs<m_colInd_Blk[inode+1];ijcrs++){
+			const double* a = valcrs+ijcrs*2;
+			const double* vj = val+m_rowPtr_Blk[ijcrs]*nval;
+			for(unsigned int irhs=0;irhs<nrhs;irhs++){
+				vi[irhs*2  ] -= a[0]*vj[irhs*2  ] - a[1]*vj[irhs*2+1];
+				vi[irhs*2+1] -= a[0]*vj[irhs*2+1] + a[1]*vj[irhs*2  ];
+			}
+		}
+	}
+	return true;
+}
+
 /*
 bool CZMatDiaFrac_BlkCrs::Solve(CZVector_Blk& vec) const 
 {
@@ -192,7 +237,7 @@ bool CZMatDiaFrac_BlkCrs::Solve(CZVector_Blk& vec) const
 bool CZMatDiaFrac_BlkCrs::DoILUDecomp()
 {
 	assert( m_nblk_MatRow == m_nblk_MatCol );
-
+	this->ClearRealCrsValue();
 	
 	if( this->m_len_BlkCol != 1 ){
 		std::cout << "Error!-->Not Implimented!" << std::endl;
@@ -27,6 +27,7 @@
 
 #include "delfem/complex.h"
 #include "delfem/matvec/zvector_blk.h"
+#include "delfem/matvec/ker_zblk.h"
 
 using namespace MatVec;
 
@@ -45,17 +46,9 @@ Com::Complex operator*(const CZVector_Blk& lhs, const CZVector_Blk& rhs){
     abort();
   }
   const unsigned int ndof = (unsigned int)lhs.BlkLen() * lhs.BlkVecLen();
-	double real0 = 0;
-	double imag0 = 0;
-	for(unsigned int idof=0;idof<ndof;idof++){ 
-		double d0 = lhs.m_Value[idof].Real();
-		double d1 = lhs.m_Value[idof].Imag();
-		double d2 = rhs.m_Value[idof].Real();
-		double d3 = rhs.m_Value[idof].Imag();
-		real0 += d0*d2-d1*d3;
-		imag0 += d0*d3+d1*d2;
-	}
-	return Com::Complex(real0,imag0);
+	double dot[2];
+	Ker::ZDot(ndof,Ker::ZPtr(lhs.m_Value),Ker::ZPtr(rhs.m_Value),dot);
+	return Com::Complex(dot[0],dot[1]);
 }
 
 
@@ -68,17 +61,9 @@ Com::Complex InnerProduct(const CZVector_Blk& lhs, const CZVector_Blk& rhs){
         abort();
     }
     const unsigned int ndof = (unsigned int)lhs.BlkLen() * lhs.BlkVecLen();
-	double real0 = 0;
-	double imag0 = 0;
-	for(unsigned int idof=0;idof<ndof;idof++){ 
-		double d0 = lhs.m_Value[idof].Real();
-		double d1 = lhs.m_Value[idof].Imag();
-		double d2 = rhs.m_Value[idof].Real();
-		double d3 = rhs.m_Value[idof].Imag();
-		real0 += d0*d2+d1*d3;
-		imag0 += d0*d3-d1*d2;
-	}
-	return Com::Complex(real0,imag0);
+	double dot[2];
+	Ker::ZDotConj(ndof,Ker::ZPtr(lhs.m_Value),Ker::ZPtr(rhs.m_Value),dot);
+	return Com::Complex(dot[0],dot[1]);
 }
 
 }
@@ -94,8 +79,8 @@ CZVector_Blk& CZVector_Blk::operator*=(const double& d0){	// Scaler Product
 }
 
 CZVector_Blk& CZVector_Blk::operator*=(const Com::Complex& c0){	// Scaler Product
-	const int ndof = m_BlkLen * m_BlkVecLen;
-	for(int idof=0;idof<ndof;idof++){ m_Value[idof] *= c0; }
+	const unsigned int ndof = m_BlkLen * m_BlkVecLen;
+	Ker::ZScale(ndof,c0.Real(),c0.Imag(),Ker::ZPtr(m_Value));
 	return *this; 
 }
 
@@ -137,7 +122,7 @@ CZVector_Blk& CZVector_Blk::AXPY(const Com::Complex& alpha, const CZVector_Blk&
         abort();
     }
     const unsigned int ndof = (unsigned int)m_BlkLen * m_BlkVecLen;
-	for(unsigned int idof=0;idof<ndof;idof++){ m_Value[idof] += alpha * rhs.m_Value[idof]; }
+	Ker::ZAxpy(ndof,alpha.Real(),alpha.Imag(),Ker::ZPtr(rhs.m_Value),Ker::ZPtr(m_Value));
 	return *this;
 }
 
@@ -153,9 +138,5 @@ void CZVector_Blk::SetVectorConjugate(){	// Set 0 to Value
 
 double CZVector_Blk::GetSquaredVectorNorm() const {
 	const unsigned int ndof = m_BlkLen*m_BlkVecLen;
-	double tmp_value = 0.0;
-	for(unsigned int idof=0;idof<ndof;idof++){
-		tmp_value += Com::SquaredNorm(m_Value[idof]);
-	}
-	return tmp_value;
+	return Ker::ZSqNorm(ndof,Ker::ZPtr(m_Value));
 }
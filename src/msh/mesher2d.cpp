@@ -22,12 +22,15 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #pragma warning(disable: 4996)
 #endif
 
+#if !defined(for) && !defined(_OPENMP)	// the scope of the loop variable (old compilers), it breaks "omp for"
 #define for if(0);else for
+#endif
 
 #include <stdio.h>
 #include <set>
 #include <vector>
 #include <stack>
+#include <algorithm>
 #include <cassert>
 #include <math.h>
 #include <cstdlib> //(abort)
@@ -39,6 +42,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 
 #include "delfem/msh/meshkernel2d.h"
 #include "delfem/mesher2d.h"
+#include "delfem/parallel.h"
 
 using namespace Msh;
 using namespace Com;
@@ -65,6 +69,8 @@ CMesher2D::CMesher2D(const CMesher2D& rhs)
 	m_imode_meshing = rhs.m_imode_meshing;
 	m_elen = rhs.m_elen;
 	m_esize = rhs.m_esize;
+	m_is_bulk_refine = rhs.m_is_bulk_refine;
+	m_is_parallel_loop = rhs.m_is_parallel_loop;
   
 	m_ElemType = rhs.m_ElemType;
 	m_ElemLoc = rhs.m_ElemLoc;
@@ -322,7 +328,7 @@ unsigned int CMesher2D::GetElemID_FromCadID(unsigned int id_cad, Cad::CAD_ELEM_T
 // private関数
 bool CMesher2D::FindElemLocType_CadIDType
 (unsigned int& iloc, unsigned int& itype, 
- unsigned int id_cad, Cad::CAD_ELEM_TYPE itype_cad )
+ unsigned int id_cad, Cad::CAD_ELEM_TYPE itype_cad ) const
 {
 	switch(itype_cad){
 	case Cad::VERTEX:
@@ -910,8 +916,72 @@ bool CMesher2D::MakeMesh_Edge
 	return true;
 }
 
+// whether the point can be inserted in the triangle itri (iedge : -1 inside the triangle, the edge if on the edge)
+static bool IsInsertable_Tri(const CVector2D& po_add, unsigned int itri, int& iedge,
+	const std::vector<CPoint2D>& aPo2D, const std::vector<STri2D>& aTri)
+{
+	unsigned int iflg1 = 0, iflg2 = 0;
+	const STri2D& ref_tri = aTri[itri];
+	if( TriArea(po_add, aPo2D[ref_tri.v[1]].p, aPo2D[ref_tri.v[2]].p ) > MIN_TRI_AREA ){
+		iflg1++; iflg2 += 0;
+	}
+	if( TriArea(po_add, aPo2D[ref_tri.v[2]].p, aPo2D[ref_tri.v[0]].p ) > MIN_TRI_AREA ){
+		iflg1++; iflg2 += 1;
+	}
+	if( TriArea(po_add, aPo2D[ref_tri.v[0]].p, aPo2D[ref_tri.v[1]].p ) > MIN_TRI_AREA ){
+		iflg1++; iflg2 += 2;
+	}
+	if( iflg1 == 3 ){
+		iedge = -1;
+		return true;
+	}
+	if( iflg1 != 2 ) return false;
+	const unsigned int ied0 = 3-iflg2;
+	const unsigned int ipo_e0 = ref_tri.v[ noelTriEdge[ied0][0] ];
+	const unsigned int ipo_e1 = ref_tri.v[ noelTriEdge[ied0][1] ];
+	if( ref_tri.g2[ied0] != -2 && ref_tri.g2[ied0] != -3 ) return false;
+	const unsigned int* rel = relTriTri[ ref_tri.r2[ied0] ];
+	const unsigned int itri_s = ref_tri.s2[ied0];
+	assert( aTri[itri_s].v[ rel[ noelTriEdge[ied0][0] ] ] == ipo_e0 );
+	assert( aTri[itri_s].v[ rel[ noelTriEdge[ied0][1] ] ] == ipo_e1 );
+	const unsigned int inoel_d = rel[ied0];
+	assert( aTri[itri_s].s2[inoel_d] == itri );
+	const unsigned int ipo_d = aTri[itri_s].v[inoel_d];
+	assert( TriArea( po_add, aPo2D[ipo_e1].p, aPo2D[ aTri[itri].v[ied0] ].p ) > MIN_TRI_AREA );
+	assert( TriArea( po_add, aPo2D[ aTri[itri].v[ied0] ].p, aPo2D[ipo_e0].p ) > MIN_TRI_AREA );
+	if( TriArea( po_add, aPo2D[ipo_e0].p, aPo2D[ipo_d ].p ) < MIN_TRI_AREA ){ return false; }
+	if( TriArea( po_add, aPo2D[ipo_d ].p, aPo2D[ipo_e1].p ) < MIN_TRI_AREA ){ return false; }
+	const unsigned int det_d =  DetDelaunay(po_add,aPo2D[ipo_e0].p,aPo2D[ipo_e1].p,aPo2D[ipo_d].p);
+	if( det_d == 2 || det_d == 1 ) return false;
+	iedge = ied0;
+	return true;
+}
+
+// interleave the lower 16 bits of ix and iy (Morton order)
+static unsigned int MortonCode2D(unsigned int ix, unsigned int iy)
+{
+	unsigned int code = 0;
+	for(unsigned int ibit=0;ibit<16;ibit++){
+		code |= ( (ix>>ibit)&1 ) << (2*ibit);
+		code |= ( (iy>>ibit)&1 ) << (2*ibit+1);
+	}
+	return code;
+}
+
 bool CMesher2D::Tesselate_Loop
 ( const Cad::ICad2D_Msh& cad_2d, const unsigned int id_l )
+{
+	CLoopBuffer buf;
+	this->InitLoopBuffer(cad_2d,id_l,this->GetFreeObjID(),buf);
+	if( !this->Tesselate_Loop(cad_2d,id_l,buf) ) return false;
+	this->MergeLoopBuffer(buf);
+	assert( this->CheckMesh() == 0 );
+	return true;
+}
+
+// tesselate the loop into the buffer (no member is changed, so the loops can be tesselated concurrently)
+bool CMesher2D::Tesselate_Loop
+( const Cad::ICad2D_Msh& cad_2d, const unsigned int id_l, CLoopBuffer& buf ) const
 {
 	/*
 	このLoop中のEdgeに含まれるVertexが引数に存在するかどうか
@@ -949,7 +1019,7 @@ bool CMesher2D::Tesselate_Loop
 					if( !this->FindElemLocType_CadIDType(iloc,itype,id_e,Cad::EDGE) ) assert(0);
 					assert( iloc < m_aBarAry.size() );
 					assert( itype == 1 );
-					const Msh::CBarAry& BarAry = m_aBarAry[iloc];
+					const Msh::CBarAry& BarAry = buf.GetBarAry(iloc);
 					assert( BarAry.id_e_cad == id_e );
 					const std::vector<SBar>& aBar = BarAry.m_aBar;
 					for(unsigned int ibar=0;ibar<aBar.size();ibar++){ 
@@ -984,12 +1054,12 @@ bool CMesher2D::Tesselate_Loop
 	}
 
 	std::vector<STri2D> aTri;
+	double bound_2d[4];	// bounding box of the points
 	{	// 与えられた点群を内部に持つ、大きな三角形を作る
 		assert( aVec2D.size() >= 3 );
 		double max_len;
 		double center[2];
 		{
-			double bound_2d[4];
 			bound_2d[0] = aPo2D[0].p.x;
 			bound_2d[1] = aPo2D[0].p.x;
 			bound_2d[2] = aPo2D[0].p.y;
@@ -1027,50 +1097,28 @@ bool CMesher2D::Tesselate_Loop
 //	OutInp("hoge1.inp",aPo2D,aTri);
 
 	// Make Delaunay Division
+	const double time_start = Com::GetWallTime();
+	unsigned int nins = 0;
+	Msh::CTriLocator2D locator(bound_2d[0],bound_2d[1],bound_2d[2],bound_2d[3], (unsigned int)sqrt(aPo2D.size()*0.25)+1 );
 	for(unsigned int ipoin=0;ipoin<aPo2D.size();ipoin++){
 		if( aPo2D[ipoin].e >= 0 ) continue;	// 既にメッシュの一部である。
 		const CVector2D& po_add = aPo2D[ipoin].p;
 		int itri_in = -1;
 		int iedge = -1;
-		unsigned int iflg1 = 0, iflg2 = 0;
-		for(unsigned int itri=0;itri<aTri.size();itri++){
-			iflg1 = 0; iflg2 = 0;
-			const STri2D& ref_tri = aTri[itri];
-			if( TriArea(po_add, aPo2D[ref_tri.v[1]].p, aPo2D[ref_tri.v[2]].p ) > MIN_TRI_AREA ){
-				iflg1++; iflg2 += 0;
-			}
-			if( TriArea(po_add, aPo2D[ref_tri.v[2]].p, aPo2D[ref_tri.v[0]].p ) > MIN_TRI_AREA ){
-				iflg1++; iflg2 += 1;
-			}
-			if( TriArea(po_add, aPo2D[ref_tri.v[0]].p, aPo2D[ref_tri.v[1]].p ) > MIN_TRI_AREA ){
-				iflg1++; iflg2 += 2;
-			}
-			if( iflg1 == 3 ){
-				itri_in = itri;
-				break;
-			}
-			else if( iflg1 == 2 ){
-				const unsigned int ied0 = 3-iflg2;
-				const unsigned int ipo_e0 = ref_tri.v[ noelTriEdge[ied0][0] ];
-				const unsigned int ipo_e1 = ref_tri.v[ noelTriEdge[ied0][1] ];
-        const unsigned int* rel = relTriTri[ ref_tri.r2[ied0] ];
-				const unsigned int itri_s = ref_tri.s2[ied0];
-        assert( aTri[itri_s].v[ rel[ noelTriEdge[ied0][0] ] ] == ipo_e0 );
-        assert( aTri[itri_s].v[ rel[ noelTriEdge[ied0][1] ] ] == ipo_e1 );
-				const unsigned int inoel_d = rel[ied0];
-				assert( aTri[itri_s].s2[inoel_d] == itri );
-				const unsigned int ipo_d = aTri[itri_s].v[inoel_d];
-				assert( TriArea( po_add, aPo2D[ipo_e1].p, aPo2D[ aTri[itri].v[ied0] ].p ) > MIN_TRI_AREA );
-				assert( TriArea( po_add, aPo2D[ aTri[itri].v[ied0] ].p, aPo2D[ipo_e0].p ) > MIN_TRI_AREA );
-				if( TriArea( po_add, aPo2D[ipo_e0].p, aPo2D[ipo_d ].p ) < MIN_TRI_AREA ){ continue;	}
-				if( TriArea( po_add, aPo2D[ipo_d ].p, aPo2D[ipo_e1].p ) < MIN_TRI_AREA ){ continue; }
-				const unsigned int det_d =  DetDelaunay(po_add,aPo2D[ipo_e0].p,aPo2D[ipo_e1].p,aPo2D[ipo_d].p);
-				if( det_d == 2 || det_d == 1 ) continue;
-				itri_in = itri;
-				iedge = ied0;
-				break;
+		{	// walk to the triangle, and test it and the triangles across its edges
+			unsigned int itri_walk;
+			if( Msh::FindTri_Walk(po_add,locator.GetStartTri(po_add),itri_walk,aPo2D,aTri) ){
+				if( IsInsertable_Tri(po_add,itri_walk,iedge,aPo2D,aTri) ){ itri_in = itri_walk; }
+				for(unsigned int ied=0;ied<3 && itri_in==-1;ied++){
+					if( aTri[itri_walk].g2[ied] != -2 && aTri[itri_walk].g2[ied] != -3 ) continue;
+					const unsigned int itri_s = aTri[itri_walk].s2[ied];
+					if( IsInsertable_Tri(po_add,itri_s,iedge,aPo2D,aTri) ){ itri_in = itri_s; }
+				}
 			}
 		}
+		for(unsigned int itri=0;itri<aTri.size() && itri_in==-1;itri++){	// scan all (the point is on an edge the walk missed)
+			if( IsInsertable_Tri(po_add,itri,iedge,aPo2D,aTri) ){ itri_in = itri; }
+		}
 		if( itri_in == -1 ){
       std::cout << "Super Triangle Failure " << ipoin << " " << po_add.x << " " << po_add.y << std::endl;
 			std::cout << aTri.size() << std::endl;
@@ -1084,11 +1132,15 @@ bool CMesher2D::Tesselate_Loop
 			InsertPoint_ElemEdge(ipoin,itri_in,iedge,aPo2D,aTri);
 		}
 		DelaunayAroundPoint(ipoin,aPo2D,aTri);
+		locator.SetTri(po_add, ( aPo2D[ipoin].e >= 0 ) ? aPo2D[ipoin].e : itri_in );
+		nins++;
 	}
+	buf.nins += nins;
+	buf.time_ins += Com::GetWallTime()-time_start;
 	assert( CheckTri(aPo2D,aTri) );
 //	OutInp("hoge2.inp",aPo2D,aTri);
 
-	const unsigned int id_new_tri_ary = this->GetFreeObjID();
+	const unsigned int id_new_tri_ary = buf.TriAry.id;
 
 	{	// エッジを回復する
     std::auto_ptr<Cad::IItrLoop> pItrEdgeLoop = cad_2d.GetPtrItrLoop(id_l);
@@ -1101,7 +1153,7 @@ bool CMesher2D::Tesselate_Loop
 			if( !FindElemLocType_CadIDType(iloc,itype, id_e,Cad::EDGE) ) assert(0);
 			assert( iloc < m_aBarAry.size() );
 			assert( itype == 1 );
-			const Msh::CBarAry& BarAry = m_aBarAry[iloc];
+			const Msh::CBarAry& BarAry = buf.GetBarAry(iloc);
 			assert( id_e == BarAry.id_e_cad );
 			const std::vector<SBar>& aBar = BarAry.m_aBar;
 			const unsigned int id_elem_bar = BarAry.id;
@@ -1194,7 +1246,7 @@ bool CMesher2D::Tesselate_Loop
 			if( !FindElemLocType_CadIDType(iloc,itype, id_e,Cad::EDGE) ) assert(0);
 			assert( iloc < m_aBarAry.size() );
 			assert( itype == 1 );
-			Msh::CBarAry& BarAry = m_aBarAry[iloc];
+			Msh::CBarAry& BarAry = buf.GetBarAry(iloc);
 			assert( id_e == BarAry.id_e_cad );
 			std::vector<SBar>& aBar = BarAry.m_aBar;
 			const unsigned int id_elem_bar = BarAry.id;
@@ -1247,7 +1299,7 @@ bool CMesher2D::Tesselate_Loop
 			if( !FindElemLocType_CadIDType(iloc,itype, id_e,Cad::EDGE) ) assert(0);
 			assert( iloc < m_aBarAry.size() );
 			assert( itype == 1 );
-			const Msh::CBarAry& BarAry = m_aBarAry[iloc];
+			const Msh::CBarAry& BarAry = buf.GetBarAry(iloc);
 			assert( id_e == BarAry.id_e_cad );
 			const std::vector<SBar>& aBar = BarAry.m_aBar;
 			const unsigned int id_elem_bar = BarAry.id;
@@ -1337,7 +1389,7 @@ bool CMesher2D::Tesselate_Loop
 				if( !FindElemLocType_CadIDType(iloc,itype, id_e,Cad::EDGE) ) assert(0);
 				assert( itype == 1 );
 				assert( iloc < m_aBarAry.size() );
-				const Msh::CBarAry& BarAry = m_aBarAry[iloc];
+				const Msh::CBarAry& BarAry = buf.GetBarAry(iloc);
 				assert( id_e == BarAry.id_e_cad );
 				const std::vector<SBar>& aBar = BarAry.m_aBar;
         if(      BarAry.id_lr[0] == id_new_tri_ary ){
@@ -1412,7 +1464,7 @@ bool CMesher2D::Tesselate_Loop
 				if( !FindElemLocType_CadIDType(iloc,itype, id_e,Cad::EDGE) ) assert(0);
 				assert( iloc < m_aBarAry.size() );
 				assert( itype == 1 );
-				Msh::CBarAry& BarAry = m_aBarAry[iloc];
+				Msh::CBarAry& BarAry = buf.GetBarAry(iloc);
 				assert( id_e == BarAry.id_e_cad );
 				std::vector<SBar>& aBar = BarAry.m_aBar;
 				const unsigned int id_elem_bar = BarAry.id;
@@ -1471,31 +1523,108 @@ bool CMesher2D::Tesselate_Loop
 	}
 //	OutInp("hoge3.inp",aVec2D, aTri_in);
 
+	buf.TriAry.m_aTri = aTri_in;
+	buf.TriAry.id_l_cad = id_l;
+	buf.TriAry.ilayer = cad_2d.GetLayer(Cad::LOOP,id_l);
+	return true;
+}
+
+void CMesher2D::InitLoopBuffer
+(const Cad::ICad2D_Msh& cad_2d, unsigned int id_l, unsigned int id_tri_ary, CLoopBuffer& buf) const
+{
+	buf.is_ok = false;
+	buf.aBarAry.clear();
+	buf.aIBarAry.clear();
+	buf.aIndBarAry.clear();
+	buf.aIndBarAry.resize(m_aBarAry.size(),-1);
+	for(std::auto_ptr<Cad::IItrLoop> pItr=cad_2d.GetPtrItrLoop(id_l);!pItr->IsEndChild();pItr->ShiftChildLoop()){
+		for(pItr->Begin();!pItr->IsEnd();(*pItr)++){
+			unsigned int id_e;   bool is_same_dir;
+			if( !pItr->GetIdEdge(id_e,is_same_dir) ) continue;
+			unsigned int iloc, itype;
+			if( !this->FindElemLocType_CadIDType(iloc,itype,id_e,Cad::EDGE) ) continue;
+			assert( itype == 1 && iloc < m_aBarAry.size() );
+			if( buf.aIndBarAry[iloc] != -1 ) continue;	// the edge is used twice by the loop
+			buf.aIndBarAry[iloc] = buf.aBarAry.size();
+			buf.aBarAry.push_back( m_aBarAry[iloc] );
+			buf.aIBarAry.push_back( iloc );
+		}
+	}
+	buf.TriAry = CTriAry2D();
+	buf.TriAry.id = id_tri_ary;
+	buf.TriAry.id_l_cad = id_l;
+	buf.nvec_base = aVec2D.size();
+	buf.aVec2D_add.clear();
+	buf.nins = 0;
+	buf.time_ins = 0.0;
+}
+
+void CMesher2D::MergeLoopBuffer(CLoopBuffer& buf)
+{
+	// the ID is given here in the order of the merge, so it is the same as the one of the serial meshing
+	const unsigned int id_tmp = buf.TriAry.id;
+	const unsigned int id_new_tri_ary = this->GetFreeObjID();
+	if( !buf.aVec2D_add.empty() ){	// renumber the points added in the loop
+		const unsigned int nvec = aVec2D.size();
+		assert( nvec >= buf.nvec_base );
+		std::vector<STri2D>& aTri = buf.TriAry.m_aTri;
+		for(unsigned int itri=0;itri<aTri.size();itri++){
+			for(unsigned int inotri=0;inotri<3;inotri++){
+				if( aTri[itri].v[inotri] < buf.nvec_base ) continue;
+				aTri[itri].v[inotri] += nvec - buf.nvec_base;
+			}
+		}
+		aVec2D.insert(aVec2D.end(),buf.aVec2D_add.begin(),buf.aVec2D_add.end());
+	}
+	for(unsigned int ibarary_loc=0;ibarary_loc<buf.aBarAry.size();ibarary_loc++){	// the sides of the edges facing the loop
+		const CBarAry& BarAry_loc = buf.aBarAry[ibarary_loc];
+		CBarAry& BarAry = m_aBarAry[ buf.aIBarAry[ibarary_loc] ];
+		assert( BarAry.m_aBar.size() == BarAry_loc.m_aBar.size() );
+		for(unsigned int iside=0;iside<2;iside++){
+			if( BarAry_loc.id_lr[iside] != id_tmp ) continue;
+			BarAry.id_lr[iside] = id_new_tri_ary;
+			for(unsigned int ibar=0;ibar<BarAry.m_aBar.size();ibar++){
+				BarAry.m_aBar[ibar].s2[iside] = BarAry_loc.m_aBar[ibar].s2[iside];
+				BarAry.m_aBar[ibar].r2[iside] = BarAry_loc.m_aBar[ibar].r2[iside];
+			}
+		}
+	}
 	{
-		unsigned int itriary = m_aTriAry.size();
-		m_aTriAry.resize( m_aTriAry.size()+1 );
-		m_aTriAry[ itriary ].m_aTri = aTri_in;
-		m_aTriAry[ itriary ].id_l_cad = id_l;
+		const unsigned int itriary = m_aTriAry.size();
+		m_aTriAry.push_back( CTriAry2D() );
+		m_aTriAry[ itriary ].m_aTri.swap( buf.TriAry.m_aTri );
+		m_aTriAry[ itriary ].id_l_cad = buf.TriAry.id_l_cad;
 		m_aTriAry[ itriary ].id = id_new_tri_ary;
-		m_aTriAry[ itriary ].ilayer = cad_2d.GetLayer(Cad::LOOP,id_l);
+		m_aTriAry[ itriary ].ilayer = buf.TriAry.ilayer;
 		this->m_ElemType.resize(id_new_tri_ary+1,-1);
 		this->m_ElemLoc.resize(id_new_tri_ary+1);
 		this->m_ElemType[id_new_tri_ary] = 2;	// TRI
 		this->m_ElemLoc[id_new_tri_ary] = itriary;
 	}
-
-	assert( this->CheckMesh() == 0 );
-	return true;
+	m_nins_stat += buf.nins;
+	m_time_ins_stat += buf.time_ins;
 }
 
+
 bool CMesher2D::MakeMesh_Loop
 ( const Cad::ICad2D_Msh& cad_2d, unsigned int id_cad_l, const double len )
 {
-	if( !Tesselate_Loop(cad_2d,id_cad_l) ){
+	CLoopBuffer buf;
+	this->InitLoopBuffer(cad_2d,id_cad_l,this->GetFreeObjID(),buf);
+	if( !this->Tesselate_Loop(cad_2d,id_cad_l,buf) ){
 		std::cout << "Tesselation_Loop Fail" << std::endl;
 		assert(0);
 		return false;
 	}
+	this->RefineMesh_Loop(len,buf);
+	this->MergeLoopBuffer(buf);
+	assert( this->CheckMesh() == 0 );
+	return true;
+}
+
+// add the points to the tesselated loop in the buffer (no member is changed)
+void CMesher2D::RefineMesh_Loop(const double len, CLoopBuffer& buf) const
+{
 
 	// されたLoopを編集するため
 	// vec2poを作成
@@ -1506,12 +1635,7 @@ bool CMesher2D::MakeMesh_Loop
 	std::vector<int> vec2po; // MSH節点番号vecからローカル節点番号poへのフラグ、対応してない場合は-2が入る
 	{
 		vec2po.resize( aVec2D.size(), -2 );
-		unsigned int iloc,itype;
-		if( !this->FindElemLocType_CadIDType(iloc,itype,id_cad_l,Cad::LOOP) ) assert(0);
-		assert( itype == 2 );
-		assert( iloc < m_aTriAry.size() );
-		const CTriAry2D& TriAry = m_aTriAry[iloc];
-		const std::vector<STri2D>& aTri_ini = TriAry.m_aTri;
+		const std::vector<STri2D>& aTri_ini = buf.TriAry.m_aTri;
 		for(unsigned int itri=0;itri<aTri_ini.size();itri++){	// ３角形に使われている全ての節点をマーク
 			for(unsigned int inotri=0;inotri<3;inotri++){
 				const unsigned int ivec0 = aTri_ini[itri].v[inotri];
@@ -1577,7 +1701,68 @@ bool CMesher2D::MakeMesh_Loop
 		}
 	}
 
-	{	// aTriに節点を追加
+	const double time_start = Com::GetWallTime();
+	unsigned int nins = 0;
+	if( m_is_bulk_refine ){	// visit the large triangles of a pass in the Morton order of their centroids
+		double bound_2d[4] = { aPo2D[0].p.x, aPo2D[0].p.x, aPo2D[0].p.y, aPo2D[0].p.y };
+		for(unsigned int ipo=1;ipo<aPo2D.size();ipo++){
+			if( aPo2D[ipo].p.x < bound_2d[0] ){ bound_2d[0] = aPo2D[ipo].p.x; }
+			if( aPo2D[ipo].p.x > bound_2d[1] ){ bound_2d[1] = aPo2D[ipo].p.x; }
+			if( aPo2D[ipo].p.y < bound_2d[2] ){ bound_2d[2] = aPo2D[ipo].p.y; }
+			if( aPo2D[ipo].p.y > bound_2d[3] ){ bound_2d[3] = aPo2D[ipo].p.y; }
+		}
+		const double max_len = ( bound_2d[1]-bound_2d[0] > bound_2d[3]-bound_2d[2] ) ? bound_2d[1]-bound_2d[0] : bound_2d[3]-bound_2d[2];
+		const double scale = ( max_len > 0.0 ) ? 65535.0 / max_len : 0.0;
+		std::vector< std::pair<unsigned int,unsigned int> > aCodeTri;	// (Morton code of the centroid, triangle)
+		double ratio = 3.0;
+		for(;;){
+			unsigned int nadd = 0;
+			for(;;){	// repeat the passes until no triangle is larger than the ratio
+				aCodeTri.clear();
+				for(unsigned int itri=0;itri<aTri.size();itri++){
+					const double area = TriArea(
+						aPo2D[aTri[itri].v[0]].p, 
+						aPo2D[aTri[itri].v[1]].p, 
+						aPo2D[aTri[itri].v[2]].p);
+					if( area <= len * len * ratio ) continue;
+					const double cx = (aPo2D[aTri[itri].v[0]].p.x+aPo2D[aTri[itri].v[1]].p.x+aPo2D[aTri[itri].v[2]].p.x)/3.0;
+					const double cy = (aPo2D[aTri[itri].v[0]].p.y+aPo2D[aTri[itri].v[1]].p.y+aPo2D[aTri[itri].v[2]].p.y)/3.0;
+					const unsigned int ix = (unsigned int)( (cx-bound_2d[0])*scale );
+					const unsigned int iy = (unsigned int)( (cy-bound_2d[2])*scale );
+					aCodeTri.push_back( std::make_pair( MortonCode2D(ix,iy), itri ) );
+				}
+				if( aCodeTri.empty() ) break;
+				std::sort(aCodeTri.begin(),aCodeTri.end());
+				aPo2D.reserve( aPo2D.size()+aCodeTri.size() );
+				aTri.reserve( aTri.size()+aCodeTri.size()*2 );
+				unsigned int nadd_pass = 0;
+				for(unsigned int icand=0;icand<aCodeTri.size();icand++){
+					// the triangle may be changed by the points inserted before in this pass
+					const unsigned int itri = aCodeTri[icand].second;
+					const double area = TriArea(
+						aPo2D[aTri[itri].v[0]].p, 
+						aPo2D[aTri[itri].v[1]].p, 
+						aPo2D[aTri[itri].v[2]].p);
+					if( area <= len * len * ratio ) continue;
+					const unsigned int ipo0 = aPo2D.size();
+					aPo2D.resize( aPo2D.size()+1 );
+					aPo2D[ipo0].p.x = (aPo2D[aTri[itri].v[0]].p.x+aPo2D[aTri[itri].v[1]].p.x+aPo2D[aTri[itri].v[2]].p.x)/3.0;
+					aPo2D[ipo0].p.y = (aPo2D[aTri[itri].v[0]].p.y+aPo2D[aTri[itri].v[1]].p.y+aPo2D[aTri[itri].v[2]].p.y)/3.0;
+					InsertPoint_Elem(ipo0,itri,aPo2D,aTri);
+					DelaunayAroundPoint(ipo0,aPo2D,aTri);
+					nadd_pass++;
+				}
+				if( nadd_pass == 0 ) break;
+				nadd += nadd_pass;
+			}
+			nins += nadd;
+			LaplacianSmoothing(aPo2D,aTri,aflag_isnt_move);
+			if( nadd != 0 ){ ratio *= 0.8; }
+			else{ ratio *= 0.5; }
+			if( ratio < 0.65 ) break;
+		}
+	}
+	else{	// aTriに節点を追加
 		double ratio = 3.0;
 		for(;;){
 			unsigned int nadd = 0;
@@ -1597,6 +1782,7 @@ bool CMesher2D::MakeMesh_Loop
 					nadd++;
 				}
 			}
+			nins += nadd;
 			LaplacianSmoothing(aPo2D,aTri,aflag_isnt_move);
 //			LaplaceDelaunaySmoothing(aPo2D,aTri);
 			if( nadd != 0 ){ ratio *= 0.8; }
@@ -1604,6 +1790,8 @@ bool CMesher2D::MakeMesh_Loop
 			if( ratio < 0.65 ) break;
 		}
 	}
+	buf.nins += nins;
+	buf.time_ins += Com::GetWallTime()-time_start;
 
 	LaplaceDelaunaySmoothing(aPo2D,aTri,aflag_isnt_move);
 
@@ -1638,14 +1826,14 @@ bool CMesher2D::MakeMesh_Loop
 				npo_add++;
 			}
 		}
-		aVec2D.reserve( aVec2D.size()+npo_add );
+		buf.aVec2D_add.reserve( npo_add );
 		for(unsigned  int ipo=0;ipo<po2vec.size();ipo++){
 			if( po2vec[ipo] == -1 ){
 				CVector2D vec0;
 				vec0.x = aPo2D[ipo].p.x;
 				vec0.y = aPo2D[ipo].p.y;
-				const unsigned int ivec0 = aVec2D.size();
-				aVec2D.push_back(vec0);
+				const unsigned int ivec0 = buf.nvec_base+buf.aVec2D_add.size();	// renumbered when merged
+				buf.aVec2D_add.push_back(vec0);
 				po2vec[ipo] = ivec0;
 			}
 		}
@@ -1656,21 +1844,13 @@ bool CMesher2D::MakeMesh_Loop
 				const int ipo0 = aTri[itri].v[inotri];
 				assert( ipo0 >=0 && (unsigned int)ipo0 < aPo2D.size() );
 				const unsigned int ivec0 = po2vec[ipo0];
-				assert( ivec0 < aVec2D.size() );
+				assert( ivec0 < buf.nvec_base+buf.aVec2D_add.size() );
 				aTri[itri].v[inotri] = ivec0;
 			}
 		}
 	}
 
-	unsigned int id_this_loop;
-	{
-		unsigned int iloc,itype;
-		if( !this->FindElemLocType_CadIDType(iloc,itype,id_cad_l,Cad::LOOP) ) assert(0);
-		assert( itype == 2 );
-		assert( iloc < m_aTriAry.size() );
-		const CTriAry2D& TriAry = m_aTriAry[iloc];
-		id_this_loop = TriAry.id;
-	}
+	const unsigned int id_this_loop = buf.TriAry.id;
 
 	{	// 境界における要素との整合性をとる
 		for(unsigned int itri=0;itri<aTri.size();itri++){
@@ -1684,7 +1864,7 @@ bool CMesher2D::MakeMesh_Loop
 				const int iloc0 = m_ElemLoc[id0];
 				if( itype0 == 1 ){
 					assert( (unsigned int)iloc0 < this->m_aBarAry.size() );
-					CBarAry& bar_ary = m_aBarAry[iloc0];
+					CBarAry& bar_ary = buf.GetBarAry(iloc0);
 					assert( bar_ary.id == id0 );
 					assert( iele0 < bar_ary.m_aBar.size() );
 					SBar& bar = bar_ary.m_aBar[iele0];
@@ -1712,16 +1892,43 @@ bool CMesher2D::MakeMesh_Loop
 		}
 	}
 
-	{
-		unsigned int iloc,itype;
-		if( !this->FindElemLocType_CadIDType(iloc,itype, id_cad_l,Cad::LOOP) ) assert(0);
-		assert( itype == 2 );
-		assert( iloc < m_aTriAry.size() );
-		assert( m_aTriAry[iloc].id_l_cad == id_cad_l );
-		m_aTriAry[iloc].m_aTri = aTri;
-	}
+	buf.TriAry.m_aTri = aTri;
+}
 
-	return true;
+// mesh the loops concurrently into the buffers and merge them in the order of aIdLoop,
+// so the mesh is the same as the one meshed loop by loop (len <= 0 : only tesselate the loops)
+bool CMesher2D::MakeMesh_Loop_Parallel
+(const Cad::ICad2D_Msh& cad_2d, const std::vector<unsigned int>& aIdLoop, const double len)
+{
+	const unsigned int nloop = aIdLoop.size();
+	std::vector<CLoopBuffer> aBuf(nloop);
+	const unsigned int id_tmp0 = this->FindMaxID()+1;	// temporary ID not used by the other elements
+	// the loops are taken one by one by the threads (the sizes of the loops are very different)
+#if defined(_OPENMP)
+#pragma omp parallel for schedule(dynamic)
+#endif
+	for(int iloop=0;iloop<(int)nloop;iloop++){
+		CLoopBuffer& buf = aBuf[iloop];
+		this->InitLoopBuffer(cad_2d,aIdLoop[iloop],id_tmp0+iloop,buf);
+		if( !this->Tesselate_Loop(cad_2d,aIdLoop[iloop],buf) ) continue;
+		if( len > 0.0 ){ this->RefineMesh_Loop(len,buf); }
+		buf.is_ok = true;
+	}
+	bool is_ok = true;
+	for(unsigned int iloop=0;iloop<nloop;iloop++){
+		if( !aBuf[iloop].is_ok ){
+			if( len > 0.0 ){
+				std::cout << "Tesselation_Loop Fail" << std::endl;
+				assert(0);
+			}
+			is_ok = false;
+			continue;
+		}
+		this->MergeLoopBuffer(aBuf[iloop]);
+		aBuf[iloop] = CLoopBuffer();
+		assert( this->CheckMesh() == 0 );
+	}
+	return is_ok;
 }
 
 bool CMesher2D::Tesselate_LoopAround
@@ -1815,7 +2022,10 @@ bool CMesher2D::Tesselation(const Cad::ICad2D_Msh& cad_2d, const std::vector<uns
 			assert( this->CheckMesh() == 0 );
 		}
 	}
-	{	// Tessalation Loop
+	if( m_is_parallel_loop ){	// Tessalation Loop
+		this->MakeMesh_Loop_Parallel(cad_2d, aIdLoop, -1.0);
+	}
+	else{	// Tessalation Loop
 		for(unsigned int iid_l=0;iid_l<aIdLoop.size();iid_l++){
 			const unsigned int id_l = aIdLoop[iid_l];
 			this->Tesselate_Loop(cad_2d, id_l);
@@ -1889,11 +2099,15 @@ bool CMesher2D::Meshing_ElemLength
 		}
 	}
 	
-  for(unsigned int iid_l=0;iid_l<aIdLoop.size();iid_l++)
-  {	// ループを作る
-		const unsigned int id_l = aIdLoop[iid_l];
-		this->MakeMesh_Loop(cad_2d, id_l, len);
-		assert( this->CheckMesh() == 0 );
+  if( m_is_parallel_loop ){	// ループを並列に作る
+		this->MakeMesh_Loop_Parallel(cad_2d, aIdLoop, len);
+	}
+	else{	// ループを作る
+		for(unsigned int iid_l=0;iid_l<aIdLoop.size();iid_l++){
+			const unsigned int id_l = aIdLoop[iid_l];
+			this->MakeMesh_Loop(cad_2d, id_l, len);
+			assert( this->CheckMesh() == 0 );
+		}
 	}
 
 	this->MakeIncludeRelation(cad_2d);
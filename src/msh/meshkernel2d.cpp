@@ -2032,3 +2032,47 @@ void Msh::ColorCodeBarAry( const std::vector<SBar>& aBar,  const std::vector<CVe
 	}
 }
 
+
+bool Msh::FindTri_Walk(const CVector2D& po, unsigned int itri_start, unsigned int& itri_in,
+	const std::vector<CPoint2D>& aPo, const std::vector<STri2D>& aTri)
+{
+	assert( itri_start < aTri.size() );
+	unsigned int itri = itri_start;
+	for(unsigned int istep=0;istep<aTri.size();istep++){
+		const STri2D& tri = aTri[itri];
+		int ied_cross = -1;
+		for(unsigned int i=0;i<3;i++){
+			const unsigned int ied = (istep+i)%3;
+			const double area = TriArea(po, aPo[ tri.v[ noelTriEdge[ied][0] ] ].p, aPo[ tri.v[ noelTriEdge[ied][1] ] ].p);
+			if( area < -MIN_TRI_AREA ){ ied_cross = ied; break; }
+		}
+		if( ied_cross == -1 ){
+			itri_in = itri;
+			return true;
+		}
+		if( tri.g2[ied_cross] != -2 && tri.g2[ied_cross] != -3 ) return false;	// out of the mesh
+		assert( tri.s2[ied_cross] < aTri.size() );
+		itri = tri.s2[ied_cross];
+	}
+	return false;
+}
+
+Msh::CTriLocator2D::CTriLocator2D(double x_min, double x_max, double y_min, double y_max, unsigned int ndiv)
+{
+	m_ndiv = ( ndiv == 0 ) ? 1 : ndiv;
+	m_x_min = x_min;
+	m_y_min = y_min;
+	const double len = ( x_max-x_min > y_max-y_min ) ? x_max-x_min : y_max-y_min;
+	m_inv_len_cell = ( len > 0 ) ? m_ndiv / len : 0.0;
+	m_itri_last = 0;
+	m_aTriCell.resize(m_ndiv*m_ndiv,-1);
+}
+
+unsigned int Msh::CTriLocator2D::GetCell(const CVector2D& p) const
+{
+	int ix = (int)( (p.x-m_x_min)*m_inv_len_cell );
+	int iy = (int)( (p.y-m_y_min)*m_inv_len_cell );
+	ix = ( ix < 0 ) ? 0 : ( ( ix >= (int)m_ndiv ) ? m_ndiv-1 : ix );
+	iy = ( iy < 0 ) ? 0 : ( ( iy >= (int)m_ndiv ) ? m_ndiv-1 : iy );
+	return iy*m_ndiv+ix;
+}
@@ -26,11 +26,14 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include <map>
 #include <set>
 #include <stack>
+#include <algorithm>
 #include <iostream>
 #include <time.h>
 #include <stdio.h>
 
 #include "delfem/msh/meshkernel3d.h"
+#include "delfem/vertex_tuple_group.h"
+#include "delfem/parallel.h"
 
 
 using namespace Msh;
@@ -99,12 +102,72 @@ const unsigned int sup2Noel5[nSupSwap5][nTriInSwap5][3] = {
 	{ { 0, 1, 2 },{ 0, 2, 3 },{ 0, 3, 4 } },
 };
 
-bool Msh::MakeTetSurTet(std::vector<STet>& tet)
+// set the adjacency of the face (ifael) of the tetrahedron (ielem) and the face (jfael) of (jelem) which have the same vertices
+static void SetTetSurTet(std::vector<STet>& tet,
+						 const unsigned int ielem, const unsigned int ifael,
+						 const unsigned int jelem1, const unsigned int jfael)
 {
-	unsigned int ntetsuno;
-	unsigned int* tetsuno_ind = 0;
-	unsigned int* tetsuno = 0;
+	const unsigned int nnoel = 4;
+	const unsigned int noel_face2[4][4] = {
+		{ 0, 1, 2, 3 },
+		{ 1, 0, 3, 2 },
+		{ 2, 0, 1, 3 },
+		{ 3, 0, 2, 1 },
+	};
+	unsigned int jnoel2inoel[4];
+	for(unsigned int jnoel=0;jnoel<nnoel;jnoel++){
+		const unsigned int jno = tet[jelem1].v[jnoel];
+		unsigned int ihelp = 0;	// position in the face of ielem (1,2,3) or 0
+		for(unsigned int inofa=0;inofa<3;inofa++){
+			if( tet[ielem].v[ noelTetFace[ifael][inofa] ] == jno ){ ihelp = inofa+1; break; }
+		}
+		jnoel2inoel[jnoel] = noel_face2[ifael][ihelp];
+	}
+
+	assert( tet[jelem1].v[noelTetFace[jfael][0]] == tet[ielem].v[jnoel2inoel[noelTetFace[jfael][0]]] );
+	assert( tet[jelem1].v[noelTetFace[jfael][1]] == tet[ielem].v[jnoel2inoel[noelTetFace[jfael][1]]] );
+	assert( tet[jelem1].v[noelTetFace[jfael][2]] == tet[ielem].v[jnoel2inoel[noelTetFace[jfael][2]]] );
+
+	int jrel1 = noel2Rel[ jnoel2inoel[0]*4+jnoel2inoel[1] ];
+	assert( jrel1 != -1 );
 
+	assert( tetRel[jrel1][0] == jnoel2inoel[0] );
+	assert( tetRel[jrel1][1] == jnoel2inoel[1] );
+
+	if( tetRel[jrel1][2] == jnoel2inoel[3] ){
+		assert( tetRel[jrel1][3] == jnoel2inoel[2] );
+		std::cout << "Error!-->Inverse Element" << ielem << " " << jelem1 << std::endl;
+		assert(0);
+		return;
+	}
+	assert( tetRel[jrel1][3] == jnoel2inoel[3] );
+	assert( tetRel[jrel1][2] == jnoel2inoel[2] );
+
+	int irel1 = invTetRel[jrel1];
+
+	assert( tetRel[jrel1][jfael] == ifael );
+	assert( tet[jelem1].v[noelTetFace[jfael][0]] == tet[ielem].v[tetRel[jrel1][noelTetFace[jfael][0]]] );
+	assert( tet[jelem1].v[noelTetFace[jfael][1]] == tet[ielem].v[tetRel[jrel1][noelTetFace[jfael][1]]] );
+	assert( tet[jelem1].v[noelTetFace[jfael][2]] == tet[ielem].v[tetRel[jrel1][noelTetFace[jfael][2]]] );
+
+	assert( tetRel[irel1][ifael] == jfael );
+	assert( tet[ielem].v[noelTetFace[ifael][0]] == tet[jelem1].v[tetRel[irel1][noelTetFace[ifael][0]]] );
+	assert( tet[ielem].v[noelTetFace[ifael][1]] == tet[jelem1].v[tetRel[irel1][noelTetFace[ifael][1]]] );
+	assert( tet[ielem].v[noelTetFace[ifael][2]] == tet[jelem1].v[tetRel[irel1][noelTetFace[ifael][2]]] );
+
+	tet[ielem].s[ifael] = jelem1;
+	tet[ielem].f[ifael] = irel1;
+	tet[ielem].g[ifael] = -2;
+
+	tet[jelem1].s[jfael] = ielem;
+	tet[jelem1].f[jfael] = jrel1;
+	tet[jelem1].g[jfael] = -2;
+}
+
+// The faces are matched by grouping the vertex triples (Com::MakeVertexTupleGroup),
+// so the list of the tetrahedra around the points is not made.
+bool Msh::MakeTetSurTet(std::vector<STet>& tet)
+{
 	unsigned int nnode;
 	{	// lʑ̂ɎQƂĂߓ_łƂԍ̑傫́{PT
 		nnode = 0;
@@ -116,22 +179,9 @@ bool Msh::MakeTetSurTet(std::vector<STet>& tet)
 		nnode += 1;
 	}
 
-	MakeTetSurNo(tet,nnode,ntetsuno,tetsuno_ind,tetsuno);
-
 	const unsigned int nelem = tet.size();
 	const unsigned int nfael = 4;
 	const unsigned int nnofa = 3;
-	const unsigned int nnoel = 4;
-
-	int* help_node = new int [nnode];
-	int help_nofa[nnofa];
-
-	const unsigned int noel_face2[4][4] = {
-		{ 0, 1, 2, 3 },
-		{ 1, 0, 3, 2 },
-		{ 2, 0, 1, 3 },
-		{ 3, 0, 2, 1 },
-	};
 
 	for(unsigned int ielem=0;ielem<nelem;ielem++){
 		for(unsigned int ifael=0;ifael<nfael;ifael++){
@@ -141,93 +191,34 @@ bool Msh::MakeTetSurTet(std::vector<STet>& tet)
 		}
 	}
 
-	for(unsigned int inode=0;inode<nnode;inode++){ help_node[inode] = 0; }
-	for(unsigned int ielem=0;ielem<nelem;ielem++){
+	Com::CIndexedArray group;
+	{
+		std::vector<unsigned int> aTuple(nelem*nfael*nnofa);
+		for(unsigned int ielem=0;ielem<nelem;ielem++){
 		for(unsigned int ifael=0;ifael<nfael;ifael++){
-			if( tet[ielem].g[ifael] != -1 ){
-				assert( tet[ielem].g[ifael] == -2 );
-				continue;
-			}
 			for(unsigned int inofa=0;inofa<nnofa;inofa++){
-				help_nofa[inofa] = tet[ielem].v[ Msh::noelTetFace[ifael][inofa] ];
-			}
-
-			help_node[ help_nofa[0] ] = 1;
-			help_node[ help_nofa[1] ] = 2;
-			help_node[ help_nofa[2] ] = 3;
-			
-			const int ino1 = help_nofa[0];
-			bool iflag = false;
-			assert( ino1 >= 0 && (unsigned int)ino1 < nnode );
-			for(unsigned int itetsuno=tetsuno_ind[ino1];itetsuno<tetsuno_ind[ino1+1];itetsuno++){
-				const unsigned int jelem1 = tetsuno[itetsuno];
-				if( jelem1 == ielem ) continue;
-				assert( jelem1>=0 && jelem1<nelem );
-				for(unsigned int jfael=0;jfael<nfael;jfael++){
-					unsigned int icoun1 = 0;
-					for(unsigned int jnofa=0;jnofa<nnofa;jnofa++){
-						icoun1 += help_node[ tet[jelem1].v[ noelTetFace[jfael][jnofa] ] ];
-					}
-					if( icoun1 == 6 ){
-                        unsigned int jnoel2inoel[4];
-						for(unsigned int jnoel=0;jnoel<nnoel;jnoel++){
-							jnoel2inoel[jnoel] = noel_face2[ifael][ help_node[ tet[jelem1].v[jnoel] ] ];
-						}
-
-						assert( tet[jelem1].v[noelTetFace[jfael][0]] == tet[ielem].v[jnoel2inoel[noelTetFace[jfael][0]]] );
-						assert( tet[jelem1].v[noelTetFace[jfael][1]] == tet[ielem].v[jnoel2inoel[noelTetFace[jfael][1]]] );
-						assert( tet[jelem1].v[noelTetFace[jfael][2]] == tet[ielem].v[jnoel2inoel[noelTetFace[jfael][2]]] );
-
-						int jrel1 = noel2Rel[ jnoel2inoel[0]*4+jnoel2inoel[1] ];
-						assert( jrel1 != -1 );
-
-						assert( tetRel[jrel1][0] == jnoel2inoel[0] );
-						assert( tetRel[jrel1][1] == jnoel2inoel[1] );
-
-						if( tetRel[jrel1][2] == jnoel2inoel[3] ){
-							assert( tetRel[jrel1][3] == jnoel2inoel[2] );
-							std::cout << "Error!-->Inverse Element" << ielem << " " << jelem1 << std::endl;
-							assert(0);
-							break;
-						}
-						assert( tetRel[jrel1][3] == jnoel2inoel[3] );
-						assert( tetRel[jrel1][2] == jnoel2inoel[2] );
-
-						int irel1 = invTetRel[jrel1];
-
-						assert( tetRel[jrel1][jfael] == ifael );
-						assert( tet[jelem1].v[noelTetFace[jfael][0]] == tet[ielem].v[tetRel[jrel1][noelTetFace[jfael][0]]] );
-						assert( tet[jelem1].v[noelTetFace[jfael][1]] == tet[ielem].v[tetRel[jrel1][noelTetFace[jfael][1]]] );
-						assert( tet[jelem1].v[noelTetFace[jfael][2]] == tet[ielem].v[tetRel[jrel1][noelTetFace[jfael][2]]] );
-
-						assert( tetRel[irel1][ifael] == jfael );
-						assert( tet[ielem].v[noelTetFace[ifael][0]] == tet[jelem1].v[tetRel[irel1][noelTetFace[ifael][0]]] );
-						assert( tet[ielem].v[noelTetFace[ifael][1]] == tet[jelem1].v[tetRel[irel1][noelTetFace[ifael][1]]] );
-						assert( tet[ielem].v[noelTetFace[ifael][2]] == tet[jelem1].v[tetRel[irel1][noelTetFace[ifael][2]]] );
-
-						tet[ielem].s[ifael] = jelem1;
-						tet[ielem].f[ifael] = irel1;
-						tet[ielem].g[ifael] = -2;
-
-						tet[jelem1].s[jfael] = ielem;
-						tet[jelem1].f[jfael] = jrel1;
-						tet[jelem1].g[jfael] = -2;
-
-						iflag = true;
-						break;
-					}
-				}
-				if( iflag ) break;
-			}
-			for(unsigned int inofa=0;inofa<nnofa;inofa++){
-				help_node[ help_nofa[inofa] ] = 0;
+				aTuple[(ielem*nfael+ifael)*nnofa+inofa] = tet[ielem].v[ Msh::noelTetFace[ifael][inofa] ];
 			}
 		}
+		}
+		Com::MakeVertexTupleGroup(group,aTuple,nnofa,nnode);
 	}
-	delete[] help_node;
-	delete[] tetsuno_ind;
-	delete[] tetsuno;
 
+	// the faces shared by two tetrahedra (the groups are independent)
+	const unsigned int ngroup = group.Size();
+#if defined(_OPENMP)
+#pragma omp parallel
+#endif
+	{
+		const unsigned int nthread = Com::GetNumThreadInTeam();
+		for(unsigned int igroup=Com::GetThreadIndex();igroup<ngroup;igroup+=nthread){
+			if( group.index[igroup+1]-group.index[igroup] < 2 ) continue;
+			const unsigned int iface = group.array[ group.index[igroup]   ];
+			const unsigned int jface = group.array[ group.index[igroup]+1 ];
+			if( iface/nfael == jface/nfael ) continue;
+			SetTetSurTet(tet, iface/nfael,iface%nfael, jface/nfael,jface%nfael);
+		}
+	}
 	return true;
 }
 
@@ -402,28 +393,15 @@ bool Msh::MakeTriSurTet(std::vector<STet>& tet,
 				   std::vector<STri3D>& tri,
 				   const std::vector<CPoint3D>& vertex ){
 
-	unsigned int ntrisuno;
-	unsigned int* trisuno_ind = 0;
-	unsigned int* trisuno = 0;
-	MakeTriSurNo(ntrisuno,trisuno_ind,trisuno,  tri,vertex.size());
-
 	const unsigned int nnode = vertex.size();
 	const unsigned int ntet = tet.size();
 
     const unsigned int nfatet = 4;
     const unsigned int nnofa = 3;
-//	const int nnotet = 4;
 
     const unsigned int ntri = tri.size();
     const unsigned int nfatri = 2;
 
-	int* help_node = new int [nnode];
-	int help_nofa[3];
-	const unsigned int noel_tri_face[2][3] = {
-		{ 0, 1, 2 },
-		{ 2, 1, 0 },
-	};
-
 	for(unsigned int itri=0;itri<tri.size();itri++){
 		for(unsigned int ifatri=0;ifatri<nfatri;ifatri++){
 			tri[itri].sf[ifatri] = -1;
@@ -431,55 +409,54 @@ bool Msh::MakeTriSurTet(std::vector<STet>& tet,
 		}
 	}
 
-	for(unsigned int inode=0;inode<nnode;inode++){ help_node[inode] = 0; }
-
-	for(unsigned int itet=0;itet<ntet;itet++){
-		for(unsigned int ifatet=0;ifatet<nfatet;ifatet++){
-			if( tet[itet].g[ifatet] == -2 ) continue;
+	// tuples : the triangles, then the outer faces of the tetrahedra
+	std::vector<unsigned int> aFaceTet;	// itet*nfatet+ifatet of the outer faces
+	Com::CIndexedArray group;
+	{
+		for(unsigned int itet=0;itet<ntet;itet++){
+			for(unsigned int ifatet=0;ifatet<nfatet;ifatet++){
+				if( tet[itet].g[ifatet] == -2 ) continue;
+				aFaceTet.push_back(itet*nfatet+ifatet);
+			}
+		}
+		std::vector<unsigned int> aTuple((ntri+aFaceTet.size())*nnofa);
+		for(unsigned int itri=0;itri<ntri;itri++){
 			for(unsigned int inofa=0;inofa<nnofa;inofa++){
-				help_nofa[inofa] = tet[itet].v[noelTetFace[ifatet][inofa]];
-			}
-			help_node[ help_nofa[0] ] = 1;
-			help_node[ help_nofa[1] ] = 2;
-			help_node[ help_nofa[2] ] = 3;
-			int inode1 = help_nofa[0];
-			bool iflag = false;
-			for(unsigned int jtrisuno=trisuno_ind[inode1];jtrisuno<trisuno_ind[inode1+1];jtrisuno++){
-                const unsigned int jtri1 = trisuno[jtrisuno];
-				assert( jtri1>=0 && jtri1<ntri );
-				for(unsigned int jfatri=0;jfatri<nfatri;jfatri++){
-					int icoun = 0;
-					for(unsigned int jnofa=0;jnofa<nnofa;jnofa++){
-						icoun += help_node[ tri[jtri1].v[noel_tri_face[jfatri][jnofa]] ];
-					}
-					if( icoun == 6 ){
-						iflag = true;
-						tet[itet].s[ifatet] = jtri1;
-						tet[itet].g[ifatet] = 1;
-
-						tri[jtri1].sf[jfatri] = itet;
-						tri[jtri1].gf[jfatri] = 0;
-
-						break;
-					}
-				}
-				if( iflag ) break;
+				aTuple[itri*nnofa+inofa] = tri[itri].v[inofa];
 			}
-			if( !iflag ){
+		}
+		for(unsigned int iface=0;iface<aFaceTet.size();iface++){
+			const unsigned int itet = aFaceTet[iface]/nfatet;
+			const unsigned int ifatet = aFaceTet[iface]%nfatet;
+			for(unsigned int inofa=0;inofa<nnofa;inofa++){
+				aTuple[(ntri+iface)*nnofa+inofa] = tet[itet].v[noelTetFace[ifatet][inofa]];
+			}
+		}
+		Com::MakeVertexTupleGroup(group,aTuple,nnofa,nnode);
+	}
+
+	// the tuples in a group are in ascending order, so the triangle comes first
+	for(unsigned int igroup=0;igroup<group.Size();igroup++){
+		const unsigned int ituple0 = group.array[ group.index[igroup] ];
+		for(unsigned int ipos=group.index[igroup];ipos<group.index[igroup+1];ipos++){
+			const unsigned int ituple = group.array[ipos];
+			if( ituple < ntri ) continue;
+			const unsigned int itet = aFaceTet[ituple-ntri]/nfatet;
+			const unsigned int ifatet = aFaceTet[ituple-ntri]%nfatet;
+			if( ituple0 >= ntri ){
 				std::cout << "Error!--> No Tri Outer Elem Face " << itet << " " << ifatet << std::endl;
 				assert(0);
+				continue;
 			}
-			for(unsigned int inofa=0;inofa<nnofa;inofa++){
-				help_node[ help_nofa[inofa] ] = 0;
-			}
+			const unsigned int jtri1 = ituple0;
+			tet[itet].s[ifatet] = jtri1;
+			tet[itet].g[ifatet] = 1;
 
+			tri[jtri1].sf[0] = itet;
+			tri[jtri1].gf[0] = 0;
 		}
 	}
 
-	delete[] trisuno_ind;
-	delete[] trisuno;
-	delete[] help_node;
-	
 	return true;
 }
 
@@ -544,33 +521,31 @@ bool Msh::MakeEdgeTet(unsigned int& nedge,
 			  const std::vector<STet>& tet,
 			  const unsigned int nnode)
 {
-//	const unsigned int nnoel = 4;
+	// the edges are found by grouping the vertex pairs of the tetrahedra
+	const unsigned int ntet = tet.size();
+	Com::CIndexedArray group;
+	std::vector<unsigned int> aTuple(ntet*nSEdgeTet*2);
+	for(unsigned int itet=0;itet<ntet;itet++){
+		for(unsigned int isedge=0;isedge<nSEdgeTet;isedge++){
+			aTuple[(itet*nSEdgeTet+isedge)*2  ] = tet[itet].v[ sEdge2Noel[isedge][0] ];
+			aTuple[(itet*nSEdgeTet+isedge)*2+1] = tet[itet].v[ sEdge2Noel[isedge][1] ];
+		}
+	}
+	Com::MakeVertexTupleGroup(group,aTuple,2,nnode);
+	const unsigned int ngroup = group.Size();
+	std::vector<unsigned int> aEdge(ngroup*2);	// vertices of the unique edges
+	for(unsigned int igroup=0;igroup<ngroup;igroup++){
+		const unsigned int ituple = group.array[ group.index[igroup] ];
+		aEdge[igroup*2  ] = aTuple[ituple*2  ];
+		aEdge[igroup*2+1] = aTuple[ituple*2+1];
+	}
 
 	edge_ind = new unsigned int [nnode+1];
 	for(unsigned int inode=0;inode<nnode+1;inode++){ edge_ind[inode] = 0; }
-
-	unsigned int ntetsuno = 0;
-	unsigned int* tetsuno_ind = NULL;
-	unsigned int* tetsuno = NULL;
-	MakeTetSurNo(tet,nnode,ntetsuno,tetsuno_ind,tetsuno);
-
-	int* help_node = new int [nnode];
-	for(unsigned int inode=0;inode<nnode;inode++){ help_node[inode] = -1; }
-
-	edge_ind[0] = 0;
-	for(unsigned int inode=0;inode<nnode;inode++){
-		help_node[inode] = inode;
-		for(unsigned int itetsuno=tetsuno_ind[inode];itetsuno<tetsuno_ind[inode+1];itetsuno++){
-			const unsigned int itet1 = tetsuno[itetsuno];
-			for(unsigned int inoel=0;inoel<4;inoel++){
-                if( help_node[ tet[itet1].v[inoel] ] != (int)inode ){
-					help_node[ tet[itet1].v[inoel] ] = inode;
-					edge_ind[inode+1]++;
-				}
-			}
-		}
+	for(unsigned int igroup=0;igroup<ngroup;igroup++){
+		edge_ind[ aEdge[igroup*2  ]+1 ]++;
+		edge_ind[ aEdge[igroup*2+1]+1 ]++;
 	}
-
 	for(unsigned int inode=0;inode<nnode;inode++){
 		edge_ind[inode+1] += edge_ind[inode];
 	}
@@ -578,20 +553,11 @@ bool Msh::MakeEdgeTet(unsigned int& nedge,
 	nedge = edge_ind[nnode];
 	edge = new unsigned int [nedge];
 
-	for(unsigned int inode=0;inode<nnode;inode++){ help_node[inode] = -1; }
-
-	for(unsigned int inode=0;inode<nnode;inode++){
-		help_node[inode] = inode;
-		for(unsigned int itetsuno=tetsuno_ind[inode];itetsuno<tetsuno_ind[inode+1];itetsuno++){
-			const unsigned int itet1 = tetsuno[itetsuno];
-			for(unsigned int inoel=0;inoel<4;inoel++){
-                if( help_node[ tet[itet1].v[inoel] ] != (int)inode ){
-					help_node[ tet[itet1].v[inoel] ] = inode;
-					edge[ edge_ind[inode] ] = tet[itet1].v[inoel];
-					edge_ind[inode]++;
-				}
-			}
-		}
+	for(unsigned int igroup=0;igroup<ngroup;igroup++){
+		const unsigned int ino0 = aEdge[igroup*2  ];
+		const unsigned int ino1 = aEdge[igroup*2+1];
+		edge[ edge_ind[ino0] ] = ino1;	edge_ind[ino0]++;
+		edge[ edge_ind[ino1] ] = ino0;	edge_ind[ino1]++;
 	}
 
 	for(unsigned int inode=nnode;inode>0;inode--){
@@ -608,16 +574,14 @@ bool Msh::MakeEdgeTet(unsigned int& nedge,
 	}
 	std::cout << "NEdge " << nedge << std::endl;
 */
-
-	delete[] tetsuno_ind;
-	delete[] tetsuno;
-
 	return true;
 }
 
 
 
 
+
+
 ////////////////////////////////////////////////////////////////
 
 bool Msh::MakeHexSurNo(unsigned int& nhexsupo,
@@ -672,12 +636,6 @@ bool Msh::MakeHexSurHex(std::vector<SHex>& aHex)
 		npoin += 1;
 	}
 
-	unsigned int nhexsuno;
-	unsigned int* hexsuno_ind = 0;
-	unsigned int* hexsuno = 0;
-
-	MakeHexSurNo(nhexsuno,hexsuno_ind,hexsuno, aHex,npoin);
-
 	const unsigned int nelem = aHex.size();
 	const unsigned int nfael = 6;
 	const unsigned int nnofa = 4;
@@ -691,56 +649,33 @@ bool Msh::MakeHexSurHex(std::vector<SHex>& aHex)
 		}
 	}
 
-	int help_nofa[nnofa];
-	int* help_node = new int [npoin];
-	for(unsigned int ipoin=0;ipoin<npoin;ipoin++){ help_node[ipoin] = 0; }
-
-	for(unsigned int ielem=0;ielem<nelem;ielem++){
-	for(unsigned int ifael=0;ifael<nfael;ifael++){
-		if( aHex[ielem].g[ifael] != -1 ){
-			assert( aHex[ielem].g[ifael] == -2 );
-			continue;
-		}
-		for(unsigned int inofa=0;inofa<nnofa;inofa++){
-			help_nofa[inofa] = aHex[ielem].v[ Msh::noelHexFace[ifael][inofa] ];
-		}
-		for(unsigned int inofa=0;inofa<nnofa;inofa++){
-			help_node[ help_nofa[inofa] ] = 1;
-		}
-			
-		const unsigned int ino1 = help_nofa[0];
-		bool iflag = false;
-		assert( ino1 < npoin );
-		for(unsigned int ihexsuno=hexsuno_ind[ino1];ihexsuno<hexsuno_ind[ino1+1];ihexsuno++){
-			const unsigned int jelem1 = hexsuno[ihexsuno];
-			if( jelem1 == ielem ) continue;
-			assert( jelem1>=0 && jelem1<nelem );
-			for(unsigned int jfael=0;jfael<nfael;jfael++){
-				unsigned int icoun1 = 0;
-				for(unsigned int jnofa=0;jnofa<nnofa;jnofa++){
-					icoun1 += help_node[ aHex[jelem1].v[ Msh::noelHexFace[jfael][jnofa] ] ];
-				}
-				if( icoun1 == nnofa ){
-					aHex[ielem].s[ifael] = jelem1;
-					aHex[ielem].f[ifael] = 0;
-					aHex[ielem].g[ifael] = -2;
-					aHex[jelem1].s[jfael] = ielem;
-					aHex[jelem1].f[jfael] = 0;
-					aHex[jelem1].g[jfael] = -2;
-					iflag = true;
-					break;
-				}
+	Com::CIndexedArray group;
+	{
+		std::vector<unsigned int> aTuple(nelem*nfael*nnofa);
+		for(unsigned int ielem=0;ielem<nelem;ielem++){
+		for(unsigned int ifael=0;ifael<nfael;ifael++){
+			for(unsigned int inofa=0;inofa<nnofa;inofa++){
+				aTuple[(ielem*nfael+ifael)*nnofa+inofa] = aHex[ielem].v[ Msh::noelHexFace[ifael][inofa] ];
 			}
-			if( iflag ) break;
 		}
-		for(unsigned int inofa=0;inofa<nnofa;inofa++){
-			help_node[ help_nofa[inofa] ] = 0;
 		}
+		Com::MakeVertexTupleGroup(group,aTuple,nnofa,npoin);
 	}
+
+	for(unsigned int igroup=0;igroup<group.Size();igroup++){
+		if( group.index[igroup+1]-group.index[igroup] < 2 ) continue;
+		const unsigned int iface = group.array[ group.index[igroup]   ];
+		const unsigned int jface = group.array[ group.index[igroup]+1 ];
+		const unsigned int ielem = iface/nfael, ifael = iface%nfael;
+		const unsigned int jelem1 = jface/nfael, jfael = jface%nfael;
+		if( ielem == jelem1 ) continue;
+		aHex[ielem].s[ifael] = jelem1;
+		aHex[ielem].f[ifael] = 0;
+		aHex[ielem].g[ifael] = -2;
+		aHex[jelem1].s[jfael] = ielem;
+		aHex[jelem1].f[jfael] = 0;
+		aHex[jelem1].g[jfael] = -2;
 	}
-	delete[] help_node;
-	delete[] hexsuno_ind;
-	delete[] hexsuno;
 
 	return true;
 }
@@ -3964,3 +3899,207 @@ bool Msh::Reconnect(std::vector<STet>& aTet,
 
 	return true;
 }
+
+
+////////////////////////////////////////////////
+
+bool Msh::GetTetQualityStat(CTetQualityStat& stat, double threshold,
+							const std::vector<STet>& aTet,
+							const std::vector<CPoint3D>& aPo)
+{
+	const unsigned int ntet = aTet.size();
+	stat = CTetQualityStat();
+	stat.ntet = ntet;
+	if( ntet == 0 ) return true;
+	const unsigned int nthread = Com::GetNumThread();	// the team is not larger than this
+	std::vector<double> aMin(nthread,ILL_CRT), aMax(nthread,0.0), aSum(nthread,0.0);
+	std::vector<unsigned int> aNBad(nthread,0);
+#if defined(_OPENMP)
+#pragma omp parallel
+#endif
+	{
+		const unsigned int ithread = Com::GetThreadIndex();
+		double min_crt = ILL_CRT, max_crt = 0.0, sum_crt = 0.0;
+		unsigned int nbad = 0;
+		const unsigned int nthread_team = Com::GetNumThreadInTeam();
+		for(unsigned int itet=ithread;itet<ntet;itet+=nthread_team){
+			const double crt = Criterion_PLJ(aTet[itet],aPo);
+			if( crt < min_crt ) min_crt = crt;
+			if( crt > max_crt ) max_crt = crt;
+			sum_crt += crt;
+			if( crt >= threshold ) nbad++;
+		}
+		aMin[ithread] = min_crt;	aMax[ithread] = max_crt;
+		aSum[ithread] = sum_crt;	aNBad[ithread] = nbad;
+	}
+	stat.min_crt = ILL_CRT;
+	double sum_crt = 0.0;
+	for(unsigned int ithread=0;ithread<nthread;ithread++){
+		if( aMin[ithread] < stat.min_crt ) stat.min_crt = aMin[ithread];
+		if( aMax[ithread] > stat.max_crt ) stat.max_crt = aMax[ithread];
+		sum_crt += aSum[ithread];
+		stat.nbad += aNBad[ithread];
+	}
+	stat.ave_crt = sum_crt/ntet;
+	return true;
+}
+
+// best edge swap around a bad tetrahedron
+class CEdgeSwapCand{
+public:
+	unsigned int itet;
+	CFlipCrtPrePosPtn fcppp;
+	ElemAroundEdge elared;
+};
+
+// the worst cavity comes first, and the index of the tetrahedron breaks the tie
+class CEdgeSwapCandOrder{
+public:
+	CEdgeSwapCandOrder(const std::vector<CEdgeSwapCand>& aCand) : aCand(aCand){}
+	bool operator()(unsigned int icand0, unsigned int icand1) const {
+		const CEdgeSwapCand& c0 = aCand[icand0];
+		const CEdgeSwapCand& c1 = aCand[icand1];
+		if( c0.fcppp.pre != c1.fcppp.pre ) return c0.fcppp.pre > c1.fcppp.pre;
+		if( c0.fcppp.pos != c1.fcppp.pos ) return c0.fcppp.pos < c1.fcppp.pos;
+		return c0.itet < c1.itet;
+	}
+private:
+	const std::vector<CEdgeSwapCand>& aCand;
+};
+
+// search the best edge swap around the tetrahedron (itet0) (the mesh is not changed)
+static bool FindEdgeSwapCand(CEdgeSwapCand& cand, ElemAroundEdge& elared, const unsigned int itet0,
+							 const std::vector<STet>& aTet,
+							 const std::vector<CPoint3D>& aPo)
+{
+	cand.itet = itet0;
+	cand.fcppp = CFlipCrtPrePosPtn();
+	for(unsigned int isedge=0;isedge<nSEdgeTet;isedge++){
+		MakeElemAroundEdge(elared,itet0,sEdge2DEdge[isedge],aTet);
+		if( !elared.is_inner ) continue;
+		int ptn;
+		double max_crt_pos;
+		const double max_crt_pre = MaxCrtElemAroundEdge(elared,aTet,aPo);
+		GetEdgeSwapPtnCrt(elared,ptn,max_crt_pos,aPo);
+		CFlipCrtPrePosPtn fcppp(max_crt_pre,max_crt_pos,ptn);
+		if( !fcppp.ok_flg || max_crt_pos > max_crt_pre-1.0e-10 ) continue;	// the swap back and forth is avoided
+		if( cand.fcppp.ok_flg && !(fcppp < cand.fcppp) ) continue;
+		cand.fcppp = fcppp;
+		cand.elared = elared;
+	}
+	return cand.fcppp.ok_flg;
+}
+
+bool Msh::ReconnectParallel(std::vector<STet>& aTet,
+							std::vector<CPoint3D>& aPo,
+							CReconnectStat& stat,
+							double threshold,
+							unsigned int max_pass)
+{
+	const double time_start = Com::GetWallTime();
+	stat = CReconnectStat();
+	GetTetQualityStat(stat.pre,threshold,aTet,aPo);
+	const unsigned int nchunk = 256;
+	// A swap changes only the cavities of the edges whose both ends are the points of the swapped cavity,
+	// so in the next pass only the tetrahedra which have two of such points are searched.
+	std::vector<unsigned char> aFlgPo(aPo.size(),1);
+	for(unsigned int ipass=0;ipass<max_pass;ipass++){
+		stat.npass++;
+		////////////////
+		// search the swaps concurrently
+		// (chunks of the tetrahedra are taken by the threads, "omp for" can not be used with the macro of "for" above)
+		std::vector<CEdgeSwapCand> aCand;
+		{
+			const unsigned int ntet = aTet.size();
+			unsigned int itet_next = 0;
+#if defined(_OPENMP)
+#pragma omp parallel
+#endif
+			{
+				std::vector<CEdgeSwapCand> aCand_thread;
+				CEdgeSwapCand cand;
+				ElemAroundEdge elared;
+				for(;;){
+					unsigned int itet_s;
+#if defined(_OPENMP)
+#pragma omp critical (ReconnectParallel_Chunk)
+#endif
+					{
+						itet_s = itet_next;
+						itet_next += nchunk;
+					}
+					if( itet_s >= ntet ) break;
+					const unsigned int itet_e = ( itet_s+nchunk < ntet ) ? itet_s+nchunk : ntet;
+					for(unsigned int itet=itet_s;itet<itet_e;itet++){
+						const STet& tet0 = aTet[itet];
+						if( aFlgPo[tet0.v[0]]+aFlgPo[tet0.v[1]]+aFlgPo[tet0.v[2]]+aFlgPo[tet0.v[3]] < 2 ) continue;
+						if( Criterion_PLJ(tet0,aPo) < threshold ) continue;
+						if( FindEdgeSwapCand(cand,elared,itet,aTet,aPo) ){ aCand_thread.push_back(cand); }
+					}
+				}
+#if defined(_OPENMP)
+#pragma omp critical (ReconnectParallel_Merge)
+#endif
+				{
+					aCand.insert(aCand.end(),aCand_thread.begin(),aCand_thread.end());
+				}
+			}
+		}
+		stat.ncand += aCand.size();
+		if( aCand.empty() ) break;
+		////////////////
+		// choose the swaps whose cavities do not overlap (from the worst one)
+		std::vector<unsigned int> aOrder(aCand.size());
+		for(unsigned int icand=0;icand<aCand.size();icand++){ aOrder[icand] = icand; }
+		std::sort(aOrder.begin(),aOrder.end(),CEdgeSwapCandOrder(aCand));
+		std::vector<int> aFlgTet(aTet.size(),-1);	// index of the chosen swap the tetrahedron belongs to
+		std::vector<unsigned int> aSel;
+		for(unsigned int ipo=0;ipo<aFlgPo.size();ipo++){ aFlgPo[ipo] = 0; }
+		for(unsigned int iorder=0;iorder<aOrder.size();iorder++){
+			const CEdgeSwapCand& cand = aCand[ aOrder[iorder] ];
+			const ElemAroundEdge& elared = cand.elared;
+			bool is_free = true;
+			for(unsigned int ie=0;ie<elared.size();ie++){
+				if( aFlgTet[ elared.e[ie].first ] != -1 ){ is_free = false; break; }
+			}
+			if( !is_free ){	// searched again in the next pass
+				for(unsigned int inoel=0;inoel<4;inoel++){ aFlgPo[ aTet[cand.itet].v[inoel] ] = 1; }
+				continue;
+			}
+			aFlgPo[elared.nod] = 1;
+			aFlgPo[elared.nou] = 1;
+			for(unsigned int in=0;in<elared.n.size();in++){ aFlgPo[ elared.n[in] ] = 1; }
+			for(unsigned int ie=0;ie<elared.size();ie++){
+				aFlgTet[ elared.e[ie].first ] = aSel.size();
+			}
+			aSel.push_back( aOrder[iorder] );
+		}
+		////////////////
+		// apply the swaps
+		// The cavities are disjoint, so a swap does not change the vertices of the other cavities.
+		// Only the index of the tetrahedron moved by the swap of 3 tetrahedra has to be updated.
+		for(unsigned int isel=0;isel<aSel.size();isel++){
+			CEdgeSwapCand& cand = aCand[ aSel[isel] ];
+			const unsigned int ntet_pre = aTet.size();
+			const unsigned int itet_dist = cand.elared.e[ cand.elared.size()-1 ].first;
+			EdgeSwapTet(cand.elared,cand.fcppp.ptn,aTet,aPo);
+			stat.nswap++;
+			if( aTet.size() < ntet_pre ){	// the last tetrahedron is moved to itet_dist
+				assert( cand.elared.size() == 3 );
+				const unsigned int itet_end = ntet_pre-1;
+				const int jsel = aFlgTet[itet_end];
+				if( itet_dist != itet_end && jsel > (int)isel ){
+					ElemAroundEdge& elared_j = aCand[ aSel[jsel] ].elared;
+					for(unsigned int ie=0;ie<elared_j.size();ie++){
+						if( elared_j.e[ie].first == itet_end ){ elared_j.e[ie].first = itet_dist; }
+					}
+				}
+				aFlgTet[itet_dist] = ( itet_dist != itet_end ) ? jsel : -1;
+			}
+			aFlgTet.resize(aTet.size(),isel);
+		}
+	}
+	GetTetQualityStat(stat.pos,threshold,aTet,aPo);
+	stat.time = Com::GetWallTime()-time_start;
+	return true;
+}
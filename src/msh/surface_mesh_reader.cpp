@@ -20,6 +20,7 @@
 #include <fstream>
 #include <iostream>
 #include <assert.h>
+#include <string.h>
 #include <math.h>
 #include <vector>
 
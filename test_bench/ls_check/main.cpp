@@ -0,0 +1,775 @@
+////////////////////////////////////////////////////////////////
+//                                                            //
+//  regression check of the linear solvers                    //
+//  (the parallel, single precision, compact pattern and      //
+//   recycling paths are compared with the serial solver)     //
+//                                                            //
+//  usage : main.out [elen] [nthread]                         //
+//                                                            //
+////////////////////////////////////////////////////////////////
+
+#if defined(__VISUALC__)
+#pragma warning( disable : 4786 )
+#endif
+#define for if(0);else for
+
+#include <iostream>
+#include <vector>
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+#include <math.h>
+
+#include "delfem/cad_obj2d.h"
+#include "delfem/mesher2d.h"
+#include "delfem/field_world.h"
+#include "delfem/field.h"
+#include "delfem/matvec/vector_blk.h"
+#include "delfem/matvec/bcflag_blk.h"
+#include "delfem/matvec/zmatdia_blkcrs.h"
+#include "delfem/matvec/zvector_blk.h"
+#include "delfem/indexed_array.h"
+#include "delfem/ls/preconditioner.h"
+#include "delfem/ls/solver_ls_iter.h"
+#include "delfem/ls/eigen_lanczos.h"
+#include "delfem/femls/linearsystem_field.h"
+#include "delfem/femls/linearsystem_matfree.h"
+#include "delfem/femeqn/eqn_linear_solid2d.h"
+#include "delfem/femeqn/eqn_helmholtz.h"
+#include "delfem/femeqn/eqn_poisson.h"
+#include "delfem/femls/zlinearsystem.h"
+#include "delfem/femls/zpreconditioner.h"
+#include "delfem/femls/zsolver_ls_iter.h"
+#include "delfem/eqnsys_solid.h"
+#include "delfem/parallel.h"
+
+using namespace Fem::Field;
+
+// the linear system of the 2D elastic cantilever (2x2 blocks) fixed at the left edge
+class CProblem
+{
+public:
+	CProblem(double elen){
+		Cad::CCadObj2D cad_2d;
+		{
+			std::vector<Com::CVector2D> aVec;
+			aVec.push_back( Com::CVector2D(0,0) );
+			aVec.push_back( Com::CVector2D(3,0) );
+			aVec.push_back( Com::CVector2D(3,1) );
+			aVec.push_back( Com::CVector2D(0,1) );
+			cad_2d.AddPolygon(aVec);
+		}
+		id_base = world.AddMesh( Msh::CMesher2D(cad_2d,elen) );
+		const CIDConvEAMshCad conv = world.GetIDConverter(id_base);
+		id_field_disp = world.MakeField_FieldElemDim(id_base,2,VECTOR2,VALUE,CORNER);
+		const unsigned int id_field_fix = world.GetPartialField(id_field_disp,conv.GetIdEA_fromCad(4,Cad::EDGE));
+		ls.AddPattern_Field(id_field_disp,world);
+		ls.SetFixedBoundaryCondition_Field(id_field_fix,world);
+		ls.InitializeMarge();
+		Fem::Eqn::AddLinSys_LinearSolid2D_Static(ls, 1.0,1.0, 1.0, 0.0,-1.0, world,id_field_disp);
+		ls.FinalizeMarge();
+		pRes0 = new MatVec::CVector_Blk( ls.m_ls.GetVector(-1,0) );
+	}
+	~CProblem(){ delete pRes0; }
+	//! set the right hand side (scaled) and zero to the update
+	void SetRhs(double scale){
+		ls.m_ls.GetVector(-1,0) = *pRes0;
+		ls.m_ls.GetVector(-1,0) *= scale;
+		ls.m_ls.GetVector(-2,0).SetVectorZero();
+	}
+	const MatVec::CVector_Blk& GetUpdate(){ return ls.m_ls.GetVector(-2,0); }
+public:
+	CFieldWorld world;
+	unsigned int id_base;
+	unsigned int id_field_disp;
+	Fem::Ls::CLinearSystem_Field ls;
+	MatVec::CVector_Blk* pRes0;	// right hand side of the assembly
+};
+
+// ||a-b||/||b||
+static double RelativeDifference(const MatVec::CVector_Blk& a, const MatVec::CVector_Blk& b)
+{
+	MatVec::CVector_Blk d(a);
+	d.AXPY(-1.0,b);
+	const double sq = b.GetSquaredVectorNorm();
+	return ( sq > 0 ) ? sqrt(d.GetSquaredVectorNorm()/sq) : sqrt(d.GetSquaredVectorNorm());
+}
+
+static bool Report(const char* str, double diff, double tol)
+{
+	const bool is_ok = ( diff <= tol );
+	printf("  %-40s diff %10.3e  %s\n",str,diff,is_ok?"ok":"NG");
+	return is_ok;
+}
+
+// ILU(0) preconditioned CG (tolerance conv)
+static bool Solve_ILU(CProblem& prob, LsSol::CPreconditioner_ILU& prec, double conv, bool is_refine = false)
+{
+	prec.SetLinearSystem(prob.ls.m_ls);
+	prec.SetValue(prob.ls.m_ls);
+	LsSol::CLinearSystemPreconditioner lsp(prob.ls.m_ls,prec);
+	unsigned int iter = 5000;
+	return LsSol::Solve_PCG(conv,iter,lsp,is_refine);
+}
+
+// the matrix vector product and the ILU preconditioned CG with nthread threads
+static bool CheckParallel(CProblem& prob, const MatVec::CVector_Blk& x_ref, unsigned int nthread)
+{
+	bool is_ok = true;
+	const MatVec::CMatDia_BlkCrs& mat = prob.ls.m_ls.GetMatrix(0);
+	MatVec::CVector_Blk y1(x_ref), yn(x_ref);
+	Com::SetNumThread(1);
+	mat.MatVec(1.0,x_ref,0.0,y1);
+	Com::SetNumThread(nthread);
+	mat.MatVec(1.0,x_ref,0.0,yn);
+	is_ok = Report("MatVec (parallel/serial)",RelativeDifference(yn,y1),1.0e-13) && is_ok;
+	{
+		prob.SetRhs(1.0);
+		LsSol::CPreconditioner_ILU prec;
+		prec.SetFillInLevel(0);
+		if( !Solve_ILU(prob,prec,1.0e-10) ){ is_ok = false; }
+		is_ok = Report("PCG ILU(0) parallel",RelativeDifference(prob.GetUpdate(),x_ref),1.0e-6) && is_ok;
+	}
+	for(unsigned int ilev=0;ilev<2;ilev++){	// the blocks ordered by the nested dissection
+		prob.SetRhs(1.0);
+		LsSol::CPreconditioner_ILU prec;
+		prec.SetFillInLevel(ilev);
+		prec.SetNestedDissection(true);
+		if( !Solve_ILU(prob,prec,1.0e-10) ){ is_ok = false; }
+		is_ok = Report((ilev==0)?"PCG ILU(0) ND parallel":"PCG ILU(1) ND parallel",RelativeDifference(prob.GetUpdate(),x_ref),1.0e-6) && is_ok;
+	}
+	Com::SetNumThread(0);
+	return is_ok;
+}
+
+// the pipelined CG with nthread threads and the serial PCG (the fused vector operations), both with ILU(0)
+static bool CheckPipelined(CProblem& prob, const MatVec::CVector_Blk& x_ref, unsigned int nthread)
+{
+	LsSol::CPreconditioner_ILU prec;
+	prec.SetFillInLevel(0);
+	prec.SetLinearSystem(prob.ls.m_ls);
+	prec.SetValue(prob.ls.m_ls);
+	LsSol::CLinearSystemPreconditioner lsp(prob.ls.m_ls,prec);
+	bool is_ok = true;
+	unsigned int aIter[2];
+	for(unsigned int itype=0;itype<2;itype++){
+		Com::SetNumThread( (itype==0) ? 1 : nthread );
+		prob.SetRhs(1.0);
+		double conv = 1.0e-8;	// the recursive residual of the pipelined one stagnates at about 1e-9
+		aIter[itype] = 5000;
+		bool res;
+		if( itype == 0 ){ res = LsSol::Solve_PCG(          conv,aIter[itype],lsp); }
+		else{             res = LsSol::Solve_PCG_Pipelined(conv,aIter[itype],lsp); }
+		if( !res ){ is_ok = false; }
+		is_ok = Report((itype==0)?"PCG ILU(0) serial":"pipelined PCG ILU(0) parallel",RelativeDifference(prob.GetUpdate(),x_ref),1.0e-6) && is_ok;
+	}
+	Com::SetNumThread(0);
+	// the rounding error of the pipelined one grows a little faster
+	const bool is_iter = ( aIter[1] <= aIter[0]+aIter[0]/10+2 && aIter[0] <= aIter[1]+2 );
+	printf("  %-40s %u/%u  %s\n","iteration (pipelined/serial)",aIter[1],aIter[0],is_iter?"ok":"NG");
+	return is_ok && is_iter;
+}
+
+// smoothed aggregation AMG with the rigid body modes, compared with ILU(0) in the iteration
+// the second SetValue keeps the hierarchy and has to give the same iteration
+static bool CheckAMG(CProblem& prob, const MatVec::CVector_Blk& x_ref)
+{
+	LsSol::CLinearSystem& ls = prob.ls.m_ls;
+	unsigned int iter_ilu = 5000;
+	{
+		LsSol::CPreconditioner_ILU prec;
+		prec.SetFillInLevel(0);
+		prec.SetLinearSystem(ls);
+		prec.SetValue(ls);
+		LsSol::CLinearSystemPreconditioner lsp(ls,prec);
+		prob.SetRhs(1.0);
+		double conv = 1.0e-10;
+		LsSol::Solve_PCG(conv,iter_ilu,lsp);
+	}
+	bool is_ok = true;
+	LsSol::CPreconditioner_AMG prec(ls);
+	{
+		const CNodeAry::CNodeSeg& ns_co = prob.world.GetField(prob.id_field_disp).GetNodeSeg(CORNER,false,prob.world);
+		const unsigned int nblk = ls.GetMatrix(0).NBlkMatCol();
+		if( ns_co.Length() != 2 || ns_co.Size() != nblk ){ return Report("AMG (no coordinates of the blocks)",1.0,0.0); }
+		std::vector<double> aCoord(nblk*2);
+		for(unsigned int iblk=0;iblk<nblk;iblk++){ ns_co.GetValue(iblk,&aCoord[iblk*2]); }
+		prec.SetCoord(2,aCoord);
+	}
+	unsigned int aIter[2];
+	for(unsigned int isolve=0;isolve<2;isolve++){
+		prec.SetValue(ls);
+		LsSol::CLinearSystemPreconditioner lsp(ls,prec);
+		prob.SetRhs(1.0);
+		double conv = 1.0e-10;
+		aIter[isolve] = 5000;
+		if( !LsSol::Solve_PCG(conv,aIter[isolve],lsp) ){ is_ok = false; }
+		is_ok = Report((isolve==0)?"PCG AMG":"PCG AMG (hierarchy kept)",RelativeDifference(prob.GetUpdate(),x_ref),1.0e-6) && is_ok;
+	}
+	const bool is_iter = ( aIter[0] < iter_ilu && aIter[1] == aIter[0] );
+	printf("  %-40s %u/%u  %s\n","iteration (AMG/ILU(0))",aIter[0],iter_ilu,is_iter?"ok":"NG");
+	return is_ok && is_iter;
+}
+
+// the supernodal LDL^T factor with the AMD and the nested dissection ordering
+// it is the exact inverse, so PCG has to converge at the first or the second iteration
+static bool CheckLDLT(CProblem& prob, const MatVec::CVector_Blk& x_ref, unsigned int nthread)
+{
+	bool is_ok = true;
+	for(unsigned int iord=0;iord<2;iord++){
+		LsSol::CPreconditioner_LDLT prec;
+		prec.SetNestedDissection(iord==1);
+		prec.SetLinearSystem(prob.ls.m_ls);
+		if( !prec.SetValue(prob.ls.m_ls) ){ is_ok = false; }
+		LsSol::CLinearSystemPreconditioner lsp(prob.ls.m_ls,prec);
+		prob.SetRhs(1.0);
+		double conv = 1.0e-10;
+		unsigned int iter = 5000;
+		if( !LsSol::Solve_PCG(conv,iter,lsp) || iter > 2 ){ is_ok = false; }
+		char str[64];
+		sprintf(str,"PCG LDLT %s (iter %u, nnz %u)",(iord==0)?"AMD":"ND",iter,prec.NNonZeroFactor());
+		is_ok = Report(str,RelativeDifference(prob.GetUpdate(),x_ref),1.0e-8) && is_ok;
+		if( iord == 0 ) continue;
+		// the subtrees of the nested dissection with nthread threads and with one thread
+		MatVec::CVector_Blk aX[2] = { x_ref, x_ref };
+		for(unsigned int ithread=0;ithread<2;ithread++){
+			Com::SetNumThread( (ithread==0) ? 1 : nthread );
+			if( !prec.SetValue(prob.ls.m_ls) ){ is_ok = false; }
+			prob.SetRhs(1.0);
+			prob.ls.m_ls.COPY(-1,-2);
+			prec.SolvePrecond(prob.ls.m_ls,-2);
+			aX[ithread] = prob.GetUpdate();
+		}
+		Com::SetNumThread(0);
+		sprintf(str,"LDLT ND parallel/serial (%u subtrees)",prec.NSubtree());
+		is_ok = Report(str,RelativeDifference(aX[1],aX[0]),1.0e-13) && is_ok;
+		if( prec.NSubtree() < 2 ){ is_ok = false; }
+	}
+	return is_ok;
+}
+
+// ILU(1) factors in single precision with the iterative refinement of PCG
+static bool CheckSinglePrecision(CProblem& prob, const MatVec::CVector_Blk& x_ref)
+{
+	prob.SetRhs(1.0);
+	LsSol::CPreconditioner_ILU prec;
+	prec.SetFillInLevel(1);
+	prec.SetSinglePrecision(true);
+	bool is_ok = Solve_ILU(prob,prec,1.0e-10,true);
+	is_ok = Report("PCG ILU(1) single precision",RelativeDifference(prob.GetUpdate(),x_ref),1.0e-6) && is_ok;
+	return is_ok;
+}
+
+// the matrix and the ILU(1) factors with the 16bit pattern
+static bool CheckCompactPattern(CProblem& prob, const MatVec::CVector_Blk& x_ref)
+{
+	bool is_ok = true;
+	MatVec::CMatDia_BlkCrs& mat = prob.ls.m_ls.GetMatrix(0);
+	MatVec::CVector_Blk y0(x_ref), y1(x_ref);
+	mat.MatVec(1.0,x_ref,0.0,y0);
+	mat.SetCompactPattern(true);
+	if( !mat.IsCompactPattern() ){ is_ok = false; }
+	mat.MatVec(1.0,x_ref,0.0,y1);
+	mat.SetCompactPattern(false);
+	is_ok = Report("MatVec (16bit/32bit pattern)",RelativeDifference(y1,y0),1.0e-13) && is_ok;
+	{
+		prob.SetRhs(1.0);
+		LsSol::CPreconditioner_ILU prec;
+		prec.SetFillInLevel(1);
+		prec.SetCompactPattern(true);
+		if( !Solve_ILU(prob,prec,1.0e-10) ){ is_ok = false; }
+		is_ok = Report("PCG ILU(1) 16bit pattern",RelativeDifference(prob.GetUpdate(),x_ref),1.0e-6) && is_ok;
+	}
+	return is_ok;
+}
+
+// the sequence of the right hand sides solved with the kept vectors (the solution is scaled with the right hand side)
+static bool CheckRecycle(CProblem& prob, const MatVec::CVector_Blk& x_ref)
+{
+	bool is_ok = true;
+	LsSol::CPreconditioner_ILU prec;
+	prec.SetFillInLevel(0);
+	prec.SetLinearSystem(prob.ls.m_ls);
+	prec.SetValue(prob.ls.m_ls);
+	LsSol::CLinearSystemPreconditioner lsp(prob.ls.m_ls,prec);
+	for(unsigned int itype=0;itype<2;itype++){
+		LsSol::CKrylovRecycle rec;
+		double max_diff = 0;
+		for(unsigned int isolve=0;isolve<4;isolve++){
+			const double scale = 1.0+0.3*isolve;
+			prob.SetRhs(scale);
+			double conv = 1.0e-10;
+			unsigned int iter = 5000;
+			bool res;
+			if( itype == 0 ){ res = LsSol::Solve_PCG_Recycle(      conv,iter,lsp,rec); }
+			else{             res = LsSol::Solve_PBiCGSTAB_Recycle(conv,iter,lsp,rec); }
+			if( !res ){ is_ok = false; }
+			MatVec::CVector_Blk x(x_ref);
+			x *= scale;
+			const double diff = RelativeDifference(prob.GetUpdate(),x);
+			max_diff = ( diff > max_diff ) ? diff : max_diff;
+		}
+		is_ok = Report((itype==0)?"PCG with recycling (4 solves)":"PBiCGSTAB with recycling (4 solves)",max_diff,1.0e-6) && is_ok;
+	}
+	return is_ok;
+}
+
+// GMRES and flexible GMRES with ILU(0), compared with PCG in the iteration (the restart of 100 takes a few cycles,
+// with a short restart both stagnate and the rounding makes their iterations drift apart)
+// FGMRES with the fixed preconditioner is the same method as GMRES, and GMRES without the restart
+// minimizes the residual in the space of the PCG iterate, so it can not take more iterations than PCG
+static bool CheckGMRES(CProblem& prob, const MatVec::CVector_Blk& x_ref)
+{
+	bool is_ok = true;
+	LsSol::CPreconditioner_ILU prec;
+	prec.SetFillInLevel(0);
+	prec.SetLinearSystem(prob.ls.m_ls);
+	prec.SetValue(prob.ls.m_ls);
+	LsSol::CLinearSystemPreconditioner lsp(prob.ls.m_ls,prec);
+	unsigned int iter_cg = 5000;
+	{
+		prob.SetRhs(1.0);
+		double conv = 1.0e-10;
+		if( !LsSol::Solve_PCG(conv,iter_cg,lsp) ){ is_ok = false; }
+	}
+	const unsigned int ntype = 3;
+	const char* aName[ntype] = { "PGMRES(100) ILU(0)", "PFGMRES(100) ILU(0)", "PGMRES ILU(0) without restart" };
+	unsigned int aIter[ntype];
+	for(unsigned int itype=0;itype<ntype;itype++){
+		prob.SetRhs(1.0);
+		double conv = 1.0e-10;
+		aIter[itype] = 5000;
+		bool res;
+		if(      itype == 0 ){ res = LsSol::Solve_PGMRES( conv,aIter[itype],lsp,100); }
+		else if( itype == 1 ){ res = LsSol::Solve_PFGMRES(conv,aIter[itype],lsp,100); }
+		else{                  res = LsSol::Solve_PGMRES( conv,aIter[itype],lsp,iter_cg+10); }
+		if( !res ){ is_ok = false; }
+		is_ok = Report(aName[itype],RelativeDifference(prob.GetUpdate(),x_ref),1.0e-6) && is_ok;
+	}
+	const bool is_iter = ( aIter[1] <= aIter[0]+aIter[0]/50+2 && aIter[0] <= aIter[1]+aIter[1]/50+2 && aIter[2] <= iter_cg+2 );
+	printf("  %-40s %u/%u/%u/%u  %s\n","iteration (GMRES/FGMRES/full/PCG)",aIter[0],aIter[1],aIter[2],iter_cg,is_iter?"ok":"NG");
+	return is_ok && is_iter;
+}
+
+// the preconditioners made only of the matrix vector product and the inverse of the diagonal blocks
+// the Chebyshev polynomial of the degree 1 is the block Jacobi (scaled), the higher degrees have to cut the iteration
+static bool CheckPolynomial(CProblem& prob, const MatVec::CVector_Blk& x_ref)
+{
+	bool is_ok = true;
+	LsSol::CLinearSystem& ls = prob.ls.m_ls;
+	const unsigned int ntype = 4;
+	const char* aName[ntype] = { "PCG block Jacobi", "PCG Chebyshev(1)", "PCG Chebyshev(3)", "PCG Neumann(3)" };
+	unsigned int aIter[ntype];
+	for(unsigned int itype=0;itype<ntype;itype++){
+		LsSol::CPreconditioner_BlockJacobi prec_jac;
+		LsSol::CPreconditioner_Chebyshev prec_cheb;
+		LsSol::CPreconditioner_Neumann prec_neu;
+		LsSol::CPreconditioner* pPrec = &prec_jac;
+		if(      itype == 1 ){ prec_cheb.SetDegree(1); pPrec = &prec_cheb; }
+		else if( itype == 2 ){ prec_cheb.SetDegree(3); pPrec = &prec_cheb; }
+		else if( itype == 3 ){ prec_neu.SetDegree(3);  pPrec = &prec_neu;  }
+		pPrec->SetLinearSystem(ls);
+		pPrec->SetValue(ls);
+		LsSol::CLinearSystemPreconditioner lsp(ls,*pPrec);
+		prob.SetRhs(1.0);
+		double conv = 1.0e-10;
+		aIter[itype] = 20000;
+		if( !LsSol::Solve_PCG(conv,aIter[itype],lsp) ){ is_ok = false; }
+		is_ok = Report(aName[itype],RelativeDifference(prob.GetUpdate(),x_ref),1.0e-6) && is_ok;
+	}
+	const bool is_iter = ( aIter[1] <= aIter[0]+2 && aIter[0] <= aIter[1]+2 && aIter[2] < aIter[0] && aIter[3] < aIter[0] );
+	printf("  %-40s %u/%u/%u/%u  %s\n","iteration (Jacobi/Cheb1/Cheb3/Neumann3)",aIter[0],aIter[1],aIter[2],aIter[3],is_iter?"ok":"NG");
+	return is_ok && is_iter;
+}
+
+// three right hand sides (the load, the load doubled and the load turned to the horizontal) solved as a batch
+// each column iterates as it would alone, so the solution and the iteration are compared with the solve of each one
+static bool CheckBatch(CProblem& prob)
+{
+	bool is_ok = true;
+	LsSol::CLinearSystem& ls = prob.ls.m_ls;
+	const unsigned int nrhs = 3;
+	std::vector<MatVec::CVector_Blk> aRhs(nrhs,*prob.pRes0);
+	aRhs[1] *= 2.0;
+	for(unsigned int iblk=0;iblk<aRhs[2].NBlk();iblk++){
+		aRhs[2].SetValue(iblk,0,prob.pRes0->GetValue(iblk,1));
+		aRhs[2].SetValue(iblk,1,prob.pRes0->GetValue(iblk,0));
+	}
+	LsSol::CPreconditioner_ILU prec;
+	prec.SetFillInLevel(0);
+	prec.SetLinearSystem(ls);
+	prec.SetValue(ls);
+	LsSol::CLinearSystemPreconditioner lsp(ls,prec);
+	for(unsigned int itype=0;itype<2;itype++){
+		std::vector<MatVec::CVector_Blk> aSol;
+		unsigned int max_iter_single = 0;
+		for(unsigned int irhs=0;irhs<nrhs;irhs++){	// one right hand side at a time
+			ls.GetVector(-1,0) = aRhs[irhs];
+			ls.GetVector(-2,0).SetVectorZero();
+			double conv = 1.0e-10;
+			unsigned int iter = 5000;
+			bool res;
+			if( itype == 0 ){ res = LsSol::Solve_PCG(      conv,iter,lsp); }
+			else{             res = LsSol::Solve_PBiCGSTAB(conv,iter,lsp); }
+			if( !res ){ is_ok = false; }
+			max_iter_single = ( iter > max_iter_single ) ? iter : max_iter_single;
+			aSol.push_back( prob.GetUpdate() );
+		}
+		ls.GetVector(-1,0) = aRhs[0];
+		ls.SetBatch(nrhs);
+		for(unsigned int irhs=1;irhs<nrhs;irhs++){
+			ls.GetVector(-1,0) = aRhs[irhs];
+			ls.SetBatchColumn(-1,-1,irhs);
+		}
+		double conv = 1.0e-10;
+		unsigned int iter = 5000;
+		bool res;
+		if( itype == 0 ){ res = LsSol::Solve_PCG_Batch(      conv,iter,ls,prec); }
+		else{             res = LsSol::Solve_PBiCGSTAB_Batch(conv,iter,ls,prec); }
+		if( !res ){ is_ok = false; }
+		double max_diff = 0;
+		for(unsigned int irhs=0;irhs<nrhs;irhs++){
+			ls.CopyBatchColumn(-2,irhs,-2);
+			const double diff = RelativeDifference(prob.GetUpdate(),aSol[irhs]);
+			max_diff = ( diff > max_diff ) ? diff : max_diff;
+		}
+		is_ok = Report((itype==0)?"PCG batch (3 right hand sides)":"PBiCGSTAB batch (3 right hand sides)",max_diff,1.0e-6) && is_ok;
+		// the batched substitution sums in the same order, only the rounding of the dot products may differ
+		const bool is_iter = ( iter <= max_iter_single+2 && max_iter_single <= iter+2 );
+		printf("  %-40s %u/%u  %s\n","iteration (batch/single max)",iter,max_iter_single,is_iter?"ok":"NG");
+		is_ok = is_ok && is_iter;
+	}
+	return is_ok;
+}
+
+// the Poisson equation on the mesh of the cantilever without the assembled matrix
+// the matrix vector product and the solution of PCG with the Chebyshev preconditioner are compared with the assembled system
+static bool CheckMatrixFree(CProblem& prob)
+{
+	bool is_ok = true;
+	CFieldWorld& world = prob.world;
+	const CIDConvEAMshCad conv = world.GetIDConverter(prob.id_base);
+	const unsigned int id_field_val = world.MakeField_FieldElemDim(prob.id_base,2,SCALAR,VALUE,CORNER);
+	const unsigned int id_field_fix = world.GetPartialField(id_field_val,conv.GetIdEA_fromCad(4,Cad::EDGE));
+	Fem::Ls::CLinearSystem_Field ls;
+	ls.AddPattern_Field(id_field_val,world);
+	ls.SetFixedBoundaryCondition_Field(id_field_fix,world);
+	ls.InitializeMarge();
+	Fem::Eqn::AddLinSys_Poisson(ls,1.0,1.0,world,id_field_val);
+	ls.FinalizeMarge();
+	unsigned int iter_ilu = 5000;
+	{
+		LsSol::CPreconditioner_ILU prec;
+		prec.SetFillInLevel(0);
+		prec.SetLinearSystem(ls.m_ls);
+		prec.SetValue(ls.m_ls);
+		LsSol::CLinearSystemPreconditioner lsp(ls.m_ls,prec);
+		double conv = 1.0e-10;
+		if( !LsSol::Solve_PCG(conv,iter_ilu,lsp) ){ is_ok = false; }
+	}
+	const MatVec::CVector_Blk& x_ref = ls.m_ls.GetVector(-2,0);
+	Fem::Ls::CLinearSystem_MatFree ls_mf;
+	ls_mf.AddPattern_Field(id_field_val,world);
+	ls_mf.SetFixedBoundaryCondition_Field(id_field_fix,world);
+	ls_mf.InitializeMarge();
+	Fem::Eqn::AddLinSys_Poisson(ls_mf,1.0,1.0,world,id_field_val);
+	ls_mf.FinalizeMarge();
+	{
+		MatVec::CVector_Blk y(x_ref), y_ref(x_ref);
+		ls.m_ls.GetMatrix(0).MatVec(1.0,x_ref,0.0,y_ref);
+		ls_mf.MatVec_Seg(0,1.0,x_ref,0.0,y);
+		is_ok = Report("MatVec (matrix-free/assembled)",RelativeDifference(y,y_ref),1.0e-11) && is_ok;
+	}
+	const MatVec::CVector_Blk res0( ls_mf.m_ls.GetVector(-1,0) );
+	unsigned int aIter[2];
+	for(unsigned int itype=0;itype<2;itype++){
+		const unsigned int ndeg = ( itype == 0 ) ? 1 : 3;
+		ls_mf.m_ls.GetVector(-1,0) = res0;
+		ls_mf.m_ls.GetVector(-2,0).SetVectorZero();
+		Fem::Ls::CPreconditioner_MatFreeChebyshev prec;
+		prec.SetDegree(ndeg);
+		prec.SetValue(ls_mf);
+		Fem::Ls::CLinearSystemPreconditioner_MatFree lsp(ls_mf,prec);
+		double conv = 1.0e-10;
+		aIter[itype] = 5000;
+		if( !LsSol::Solve_PCG(conv,aIter[itype],lsp) ){ is_ok = false; }
+		is_ok = Report((itype==0)?"PCG matrix-free Jacobi":"PCG matrix-free Chebyshev(3)",
+			RelativeDifference(ls_mf.m_ls.GetVector(-2,0),x_ref),1.0e-6) && is_ok;
+	}
+	// the polynomial of the degree 3 has to cut the iteration of the point Jacobi
+	const bool is_iter = ( aIter[1] < aIter[0] );
+	printf("  %-40s %u/%u/%u  %s\n","iteration (Chebyshev/Jacobi/ILU(0))",aIter[1],aIter[0],iter_ilu,is_iter?"ok":"NG");
+	return is_ok && is_iter;
+}
+
+// ||a-b||/||b|| of the complex vectors
+static double RelativeDifference(const MatVec::CZVector_Blk& a, const MatVec::CZVector_Blk& b)
+{
+	double sq_diff = 0, sq_ref = 0;
+	for(unsigned int iblk=0;iblk<b.BlkVecLen();iblk++){
+	for(unsigned int idof=0;idof<b.BlkLen();idof++){
+		sq_diff += Com::SquaredNorm( a.GetValue(iblk,idof)-b.GetValue(iblk,idof) );
+		sq_ref  += Com::SquaredNorm( b.GetValue(iblk,idof) );
+	}
+	}
+	return ( sq_ref > 0 ) ? sqrt(sq_diff/sq_ref) : sqrt(sq_diff);
+}
+
+// the complex matrix with the real copy of its off-diagonal values after the values are changed through CZMat_BlkCrs
+// compared with the same matrix which never had the copy (the generic complex kernel)
+static bool CheckComplexRealCopy()
+{
+	const unsigned int nblk = 50;
+	Com::CIndexedArray crs;	// chain of the blocks
+	crs.InitializeSize(nblk);
+	for(unsigned int iblk=0;iblk<nblk;iblk++){
+		if( iblk > 0      ){ crs.array.push_back(iblk-1); }
+		if( iblk+1 < nblk ){ crs.array.push_back(iblk+1); }
+		crs.index[iblk+1] = crs.array.size();
+	}
+	MatVec::CZMatDia_BlkCrs mat(nblk,1), mat_ref(nblk,1), mat_cmplx(nblk,1);
+	mat.AddPattern(crs);
+	mat_ref.AddPattern(crs);
+	mat_cmplx.AddPattern(crs);
+	mat.SetZero();
+	mat_cmplx.SetZero();
+	std::vector<int> tmp_buffer(nblk,-1);
+	for(unsigned int iblk=0;iblk+1<nblk;iblk++){
+		const unsigned int no[2] = { iblk, iblk+1 };
+		const Com::Complex emat[4] = { Com::Complex(2.0,0.1), -1.0, -1.0, Com::Complex(2.0,0.1) };
+		mat.Mearge(2,no,2,no,1,emat,&tmp_buffer[0]);
+		const Com::Complex emat_c[4] = { 2.0, Com::Complex(-1.0,0.5), Com::Complex(-1.0,-0.5), 2.0 };
+		mat_cmplx.Mearge(2,no,2,no,1,emat_c,&tmp_buffer[0]);
+	}
+	mat_ref.SetValue(mat,true);
+	MatVec::CZVector_Blk x(nblk,1), y(nblk,1), y_ref(nblk,1);
+	for(unsigned int iblk=0;iblk<nblk;iblk++){ x.SetValue(iblk,0,Com::Complex(sin(iblk*1.0),cos(iblk*0.3))); }
+	MatVec::CBCFlag bc_flag(nblk,1);
+	bc_flag.SetBC(0,0);
+	bc_flag.SetBC(nblk/2,0);
+	double max_diff = 0;
+	for(unsigned int istep=0;istep<3;istep++){
+		MatVec::CZMat_BlkCrs& mat_base = mat;
+		MatVec::CZMat_BlkCrs& mat_ref_base = mat_ref;
+		if( istep == 1 ){
+			mat_base.SetBoundaryCondition_Row(bc_flag);
+			mat_ref_base.SetBoundaryCondition_Row(bc_flag);
+			mat_base.SetBoundaryCondition_Colum(bc_flag);
+			mat_ref_base.SetBoundaryCondition_Colum(bc_flag);
+		}
+		else if( istep == 2 ){
+			mat.MakeRealCrsValue();
+			mat_base.SetValue(mat_cmplx,true,true);
+			mat_ref_base.SetValue(mat_cmplx,true,true);
+		}
+		if( istep == 0 && !mat.MakeRealCrsValue() ){ max_diff = 1.0; }
+		mat.MatVec(1.0,x,0.0,y);
+		mat_ref.MatVec(1.0,x,0.0,y_ref);
+		const double diff = RelativeDifference(y,y_ref);
+		max_diff = ( diff > max_diff ) ? diff : max_diff;
+	}
+	return Report("complex MatVec with the real copy",max_diff,1.0e-14);
+}
+
+// Helmholtz equation in a square with the radiation boundary and a point source, for 4 wave lengths
+// the batch of the frequency sweep (one ILU(1) of the middle frequency) is compared with the solve of each frequency
+static bool CheckFrequencySweep()
+{
+	CFieldWorld world;
+	unsigned int id_field_val, id_field_bc;
+	{
+		Cad::CCadObj2D cad_2d;
+		std::vector<Com::CVector2D> aVec;
+		aVec.push_back( Com::CVector2D(0,0) );
+		aVec.push_back( Com::CVector2D(2,0) );
+		aVec.push_back( Com::CVector2D(2,2) );
+		aVec.push_back( Com::CVector2D(0,2) );
+		cad_2d.AddPolygon(aVec);
+		const unsigned int id_base = world.AddMesh( Msh::CMesher2D(cad_2d,0.08) );
+		const CIDConvEAMshCad conv = world.GetIDConverter(id_base);
+		id_field_val = world.MakeField_FieldElemDim(id_base,2,ZSCALAR,VALUE,CORNER);
+		std::vector<unsigned int> aIdEA;
+		for(unsigned int id_e=1;id_e<=4;id_e++){ aIdEA.push_back( conv.GetIdEA_fromCad(id_e,Cad::EDGE) ); }
+		id_field_bc = world.GetPartialField(id_field_val,aIdEA);
+	}
+	const unsigned int nfreq = 4;
+	const double aWaveLength[nfreq] = { 0.5, 0.55, 0.6, 0.65 };
+	const unsigned int ino_src = world.GetField(id_field_val).GetNodeSeg(CORNER,true,world).Size()/2;
+	std::vector<MatVec::CZVector_Blk*> aSol(nfreq,(MatVec::CZVector_Blk*)0);
+	unsigned int max_iter_single = 0;
+	bool is_ok = true;
+	for(unsigned int ifreq=0;ifreq<nfreq;ifreq++){	// one frequency at a time
+		Fem::Ls::CZLinearSystem ls;
+		ls.AddPattern_Field(id_field_val,world);
+		Fem::Ls::CZPreconditioner_ILU prec;
+		prec.SetFillInLevel(1);
+		prec.SetLinearSystem(ls);
+		ls.InitializeMarge();
+		Fem::Eqn::AddLinSys_Helmholtz(ls,aWaveLength[ifreq],world,id_field_val);
+		Fem::Eqn::AddLinSys_SommerfeltRadiationBC(ls,aWaveLength[ifreq],world,id_field_bc);
+		ls.FinalizeMarge();
+		ls.GetResidualPtr(id_field_val,CORNER,world)->AddValue(ino_src,0,Com::Complex(1,0));
+		prec.SetValue(ls);
+		double conv = 1.0e-10;
+		unsigned int iter = 5000;
+		if( !Fem::Ls::Solve_PCOCG(conv,iter,ls,prec) ){ is_ok = false; }
+		max_iter_single = ( iter > max_iter_single ) ? iter : max_iter_single;
+		const MatVec::CZVector_Blk& upd = *ls.GetUpdatePtr(id_field_val,CORNER,world);
+		aSol[ifreq] = new MatVec::CZVector_Blk(upd.BlkVecLen(),upd.BlkLen());
+		*aSol[ifreq] = upd;
+	}
+	Fem::Ls::CZLinearSystem_Sweep ls(4);
+	ls.AddPattern_Field(id_field_val,world);
+	ls.InitializeMarge();
+	Fem::Eqn::AddLinSys_Helmholtz_Sweep(ls,world,id_field_val);
+	Fem::Eqn::AddLinSys_SommerfeltRadiationBC_Sweep(ls,world,id_field_bc);
+	ls.FinalizeMarge();
+	ls.GetResidualPtr(id_field_val,CORNER,world)->AddValue(ino_src,0,Com::Complex(1,0));
+	std::vector<Com::Complex> aCoeff(nfreq*4);
+	for(unsigned int ifreq=0;ifreq<nfreq;ifreq++){ Fem::Eqn::GetSweepCoeff_Helmholtz(aWaveLength[ifreq],&aCoeff[ifreq*4]); }
+	ls.SetBatch(nfreq,&aCoeff[0]);
+	Fem::Ls::CZPreconditioner_ILU prec;
+	prec.SetFillInLevel(1);
+	prec.SetLinearSystem(ls);
+	ls.SetMatrix_Combination(&aCoeff[(nfreq/2)*4]);
+	prec.SetValue(ls);
+	double conv = 1.0e-10;
+	unsigned int iter = 5000;
+	if( !Fem::Ls::Solve_PCOCG_Batch(conv,iter,ls,prec) ){ is_ok = false; }
+	double max_diff = 0;
+	for(unsigned int ifreq=0;ifreq<nfreq;ifreq++){
+		ls.CopyBatchColumn(-2,ifreq,-2);
+		const double diff = RelativeDifference(*ls.GetUpdatePtr(id_field_val,CORNER,world),*aSol[ifreq]);
+		max_diff = ( diff > max_diff ) ? diff : max_diff;
+		delete aSol[ifreq];
+	}
+	is_ok = Report("COCG frequency sweep (4 frequencies)",max_diff,1.0e-6) && is_ok;
+	// the preconditioner of the middle frequency should not slow the other frequencies down much
+	const bool is_iter = ( iter <= 2*max_iter_single );
+	printf("  %-40s %u/%u  %s\n","iteration (batch/single max)",iter,max_iter_single,is_iter?"ok":"NG");
+	return is_ok && is_iter;
+}
+
+// all the eigen values of a coarse mesh with LOBPCG (the block is larger than the space left after locking)
+// compared with the Jacobi method on the dense matrix of the free dofs
+static bool CheckLOBPCG()
+{
+	CProblem prob(0.5);
+	LsSol::CLinearSystem& ls = prob.ls.m_ls;
+	const MatVec::CBCFlag& bc_flag = ls.GetBCFlag(0);
+	std::vector< std::pair<unsigned int,unsigned int> > aFree;	// (block,dof) of the free dofs
+	for(unsigned int iblk=0;iblk<bc_flag.NBlk();iblk++){
+	for(unsigned int idof=0;idof<bc_flag.LenBlk(iblk);idof++){
+		if( bc_flag.GetBCFlag(iblk,idof) == 0 ){ aFree.push_back( std::make_pair(iblk,idof) ); }
+	}
+	}
+	const unsigned int nfree = aFree.size();
+	std::vector<double> aLambdaRef;
+	{
+		std::vector<double> a(nfree*nfree), v;
+		if( ls.GetTmpVectorArySize() < 2 ){ ls.ReSizeTmpVecSolver(2); }
+		for(unsigned int j=0;j<nfree;j++){
+			ls.GetVector(0,0).SetVectorZero();
+			ls.GetVector(0,0).SetValue(aFree[j].first,aFree[j].second,1.0);
+			ls.MATVEC(1.0,0,0.0,1);
+			for(unsigned int i=0;i<nfree;i++){ a[i*nfree+j] = ls.GetVector(1,0).GetValue(aFree[i].first,aFree[i].second); }
+		}
+		LsSol::EigenSymmetric_Jacobi(nfree,a,v,aLambdaRef);
+		std::sort(aLambdaRef.begin(),aLambdaRef.end());
+	}
+	std::vector<unsigned int> aIdVec(nfree);
+	for(unsigned int iev=0;iev<nfree;iev++){ aIdVec[iev] = iev; }
+	LsSol::CPreconditioner_ILU prec;
+	prec.SetFillInLevel(0);
+	prec.SetLinearSystem(ls);
+	prec.SetValue(ls);
+	std::vector<double> aLambda;
+	const unsigned int nconv = LsSol::MinimumEigenValueVector_LOBPCG(ls,prec,aIdVec,aLambda,8,2000,1.0e-8);
+	double max_diff = ( nconv == nfree ) ? 0.0 : 1.0;
+	for(unsigned int iev=0;iev<nconv;iev++){
+		const double diff = fabs(aLambda[iev]-aLambdaRef[iev])/fabs(aLambdaRef[iev]);
+		max_diff = ( diff > max_diff ) ? diff : max_diff;
+	}
+	char str[64];
+	sprintf(str,"LOBPCG all the %u modes (%u converged)",nfree,nconv);
+	return Report(str,max_diff,1.0e-8);
+}
+
+// the equation is changed between two solves of the system of equations (the pattern is not changed)
+// the solution is scaled with the Young's modulus, and the fill pattern of the ILU is made only once
+static bool CheckEqnSystemReuse(CProblem& prob)
+{
+	CFieldWorld& world = prob.world;
+	const CIDConvEAMshCad conv = world.GetIDConverter(prob.id_base);
+	Fem::Eqn::CEqnSystem_Solid2D solid(prob.id_base,world);
+	solid.SetYoungPoisson(1.0,0.0,true);
+	solid.SetGravitation(0.0,-1.0);
+	solid.AddFixElemAry(conv.GetIdEA_fromCad(4,Cad::EDGE),world);
+	std::vector<double> aDisp[2];
+	for(unsigned int isolve=0;isolve<2;isolve++){
+		if( isolve == 1 ){
+			Fem::Eqn::CEqn_Solid2D eqn = solid.GetEquation( conv.GetIdEA_fromCad(1,Cad::LOOP) );
+			eqn.SetYoungPoisson(2.0,0.0,true);
+			solid.SetEquation(eqn);
+		}
+		solid.Solve(world);
+		const CNodeAry::CNodeSeg& ns = world.GetField(solid.GetIdField_Disp()).GetNodeSeg(CORNER,true,world,VALUE);
+		for(unsigned int inode=0;inode<ns.Size();inode++){
+			double disp[2]; ns.GetValue(inode,disp);
+			aDisp[isolve].push_back(disp[0]);
+			aDisp[isolve].push_back(disp[1]);
+		}
+	}
+	double sq_diff = 0, sq_ref = 0;
+	for(unsigned int i=0;i<aDisp[0].size();i++){
+		const double d = 2.0*aDisp[1][i]-aDisp[0][i];
+		sq_diff += d*d;
+		sq_ref += aDisp[0][i]*aDisp[0][i];
+	}
+	bool is_ok = Report("Solid2D solve after SetEquation",sqrt(sq_diff/sq_ref),1.0e-5);
+	const LsSol::CPreconditioner_ILU* pPrec = dynamic_cast<const LsSol::CPreconditioner_ILU*>(solid.GetPreconditioner());
+	const bool is_reused = ( pPrec != 0 && pPrec->NSymbolic() == 1 && pPrec->NNumeric() == 2 );
+	printf("  %-40s %s\n","ILU symbolic once for two solves",is_reused?"ok":"NG");
+	return is_ok && is_reused;
+}
+
+int main(int argc, char* argv[])
+{
+	const double       elen    = ( argc > 1 ) ? atof(argv[1]) : 0.05;
+	const unsigned int nthread = ( argc > 2 ) ? atoi(argv[2]) : 4;
+	CProblem prob(elen);
+	printf("2D elastic cantilever : %u blocks, threads %u\n",prob.pRes0->NBlk(),nthread);
+
+	{	// reference solution of the serial CG without preconditioner
+		Com::SetNumThread(1);
+		prob.SetRhs(1.0);
+		double conv = 1.0e-13;
+		unsigned int iter = 20000;
+		if( !LsSol::Solve_CG(conv,iter,prob.ls.m_ls) ){
+			printf("the reference solution is not converged\n");
+			return 1;
+		}
+		Com::SetNumThread(0);
+	}
+	const MatVec::CVector_Blk x_ref( prob.GetUpdate() );
+
+	bool is_ok = true;
+	is_ok = CheckParallel(prob,x_ref,nthread) && is_ok;
+	is_ok = CheckPipelined(prob,x_ref,nthread) && is_ok;
+	is_ok = CheckAMG(prob,x_ref) && is_ok;
+	is_ok = CheckLDLT(prob,x_ref,nthread) && is_ok;
+	is_ok = CheckSinglePrecision(prob,x_ref) && is_ok;
+	is_ok = CheckCompactPattern(prob,x_ref) && is_ok;
+	is_ok = CheckRecycle(prob,x_ref) && is_ok;
+	is_ok = CheckPolynomial(prob,x_ref) && is_ok;
+	is_ok = CheckGMRES(prob,x_ref) && is_ok;
+	is_ok = CheckBatch(prob) && is_ok;
+	is_ok = CheckEqnSystemReuse(prob) && is_ok;
+	is_ok = CheckMatrixFree(prob) && is_ok;
+	is_ok = CheckLOBPCG() && is_ok;
+	is_ok = CheckComplexRealCopy() && is_ok;
+	is_ok = CheckFrequencySweep() && is_ok;
+	printf("%s\n",is_ok?"passed":"FAILED");
+	return ( is_ok ) ? 0 : 1;
+}
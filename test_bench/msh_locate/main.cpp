@@ -0,0 +1,117 @@
+////////////////////////////////////////////////////////////////
+//                                                            //
+//  benchmark of the point location in the 2D triangle mesh   //
+//                                                            //
+//  usage : main.out [elen] [npoint] [npoly]                  //
+//                                                            //
+////////////////////////////////////////////////////////////////
+
+#if defined(__VISUALC__)
+#pragma warning( disable : 4786 )
+#endif
+#define for if(0);else for
+
+#include <iostream>
+#include <vector>
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <math.h>
+
+#include "delfem/cad_obj2d.h"
+#include "delfem/mesher2d.h"
+#include "delfem/msh/meshkernel2d.h"
+#include "delfem/parallel.h"
+
+using namespace Msh;
+
+static double RandomUnit(){ return (double)rand()/RAND_MAX; }
+
+// whether the point is in the triangle (the same tolerance as FindTri_Walk)
+static bool IsInTri(const Com::CVector2D& po, const STri2D& tri, const std::vector<CPoint2D>& aPo)
+{
+	if( Com::TriArea(po,aPo[tri.v[1]].p,aPo[tri.v[2]].p) < -MIN_TRI_AREA ) return false;
+	if( Com::TriArea(po,aPo[tri.v[2]].p,aPo[tri.v[0]].p) < -MIN_TRI_AREA ) return false;
+	if( Com::TriArea(po,aPo[tri.v[0]].p,aPo[tri.v[1]].p) < -MIN_TRI_AREA ) return false;
+	return true;
+}
+
+int main(int argc, char* argv[])
+{
+	const double       elen   = ( argc > 1 ) ? atof(argv[1]) : 0.005;
+	const unsigned int npoint = ( argc > 2 ) ? atoi(argv[2]) : 20000;
+	const unsigned int npoly  = ( argc > 3 ) ? atoi(argv[3]) : 4000;
+	bool is_ok = true;
+
+	{	// the point location in the mesh of the unit square (the walk and the scan of all the triangles)
+		Cad::CCadObj2D cad_2d;
+		{
+			std::vector<Com::CVector2D> aVec;
+			aVec.push_back( Com::CVector2D(0,0) );
+			aVec.push_back( Com::CVector2D(1,0) );
+			aVec.push_back( Com::CVector2D(1,1) );
+			aVec.push_back( Com::CVector2D(0,1) );
+			cad_2d.AddPolygon(aVec);
+		}
+		CMesher2D mesh_2d(cad_2d,elen);
+		const std::vector<Com::CVector2D>& aVec2D = mesh_2d.GetVectorAry();
+		const std::vector<STri2D>& aTri = mesh_2d.GetTriArySet()[0].m_aTri;
+		std::vector<CPoint2D> aPo;
+		aPo.reserve(aVec2D.size());
+		for(unsigned int ipo=0;ipo<aVec2D.size();ipo++){ aPo.push_back( CPoint2D(aVec2D[ipo].x,aVec2D[ipo].y,-1,0) ); }
+		std::vector<Com::CVector2D> aQuery;
+		srand(1);
+		for(unsigned int iq=0;iq<npoint;iq++){ aQuery.push_back( Com::CVector2D(RandomUnit(),RandomUnit()) ); }
+		printf("mesh of the unit square : %u triangles, %u points to locate\n",(unsigned int)aTri.size(),npoint);
+
+		std::vector<int> aTriWalk(npoint,-1);
+		const double t0 = Com::GetWallTime();
+		{
+			CTriLocator2D locator(0,1,0,1,(unsigned int)sqrt(aTri.size()*0.5)+1);
+			for(unsigned int iq=0;iq<npoint;iq++){
+				unsigned int itri_in;
+				if( !FindTri_Walk(aQuery[iq],locator.GetStartTri(aQuery[iq]),itri_in,aPo,aTri) ) continue;
+				aTriWalk[iq] = itri_in;
+				locator.SetTri(aQuery[iq],itri_in);
+			}
+		}
+		const double t1 = Com::GetWallTime();
+		const unsigned int nscan = ( npoint < 2000 ) ? npoint : 2000;	// the scan is slow, so only the first points are located
+		std::vector<int> aTriScan(npoint,-1);
+		for(unsigned int iq=0;iq<nscan;iq++){
+			for(unsigned int itri=0;itri<aTri.size();itri++){
+				if( IsInTri(aQuery[iq],aTri[itri],aPo) ){ aTriScan[iq] = itri; break; }
+			}
+		}
+		const double t2 = Com::GetWallTime();
+		unsigned int nfail = 0;
+		for(unsigned int iq=0;iq<npoint;iq++){
+			if( aTriWalk[iq] < 0 || !IsInTri(aQuery[iq],aTri[ aTriWalk[iq] ],aPo) ){ nfail++; continue; }
+			if( iq < nscan && aTriWalk[iq] != aTriScan[iq] && !IsInTri(aQuery[iq],aTri[ aTriScan[iq] ],aPo) ){ nfail++; }
+		}
+		printf("  walk : %8.4f sec  %12.0f points/sec\n",t1-t0,(t1>t0)?npoint/(t1-t0):0.0);
+		printf("  scan : %8.4f sec  %12.0f points/sec (%u points)\n",t2-t1,(t2>t1)?nscan/(t2-t1):0.0,nscan);
+		printf("  points not located by the walk : %u\n",nfail);
+		if( nfail != 0 ) is_ok = false;
+	}
+	{	// the Delaunay division of a polygon (the points are located by the walk in CMesher2D)
+		Cad::CCadObj2D cad_2d;
+		{
+			std::vector<Com::CVector2D> aVec;
+			for(unsigned int ipo=0;ipo<npoly;ipo++){
+				const double theta = 2*3.14159265358979*ipo/npoly;
+				const double r = 1.0+0.05*sin(theta*17);
+				aVec.push_back( Com::CVector2D(r*cos(theta),r*sin(theta)) );
+			}
+			cad_2d.AddPolygon(aVec);
+		}
+		CMesher2D mesh_2d(cad_2d);
+		unsigned int nins;
+		double time;
+		mesh_2d.GetInsertionStatistics(nins,time);
+		printf("tesselation of a polygon : %u points inserted, %8.4f sec  %12.0f points/sec\n",
+			nins,time,mesh_2d.GetInsertionRate());
+		if( nins != npoly ) is_ok = false;
+	}
+	return ( is_ok ) ? 0 : 1;
+}
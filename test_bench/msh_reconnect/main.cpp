@@ -0,0 +1,168 @@
+////////////////////////////////////////////////////////////////
+//                                                            //
+//  benchmark of the edge swap of the tetrahedra              //
+//  (the parallel swap with nthread threads has to make       //
+//   the same mesh as with one thread)                        //
+//                                                            //
+//  usage : main.out [ndiv] [pert] [max_pass] [nthread]       //
+//                                                            //
+////////////////////////////////////////////////////////////////
+
+#if defined(__VISUALC__)
+#pragma warning( disable : 4786 )
+#endif
+#define for if(0);else for
+
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <math.h>
+
+#include "delfem/mesh_primitive.h"
+#include "delfem/msh/meshkernel3d.h"
+#include "delfem/parallel.h"
+
+using namespace Msh;
+
+// the hexahedra of the unit cube are split into 6 tetrahedra and the inner points are moved randomly (by pert*h)
+// the random numbers are seeded with a constant, so the same mesh is made every time
+static void MakeTetMesh_Hex(unsigned int ndiv, double pert,
+							std::vector<STet>& aTet, std::vector<CPoint3D>& aPo)
+{
+	CMesh_Primitive_Hexahedra hm(1,1,1,ndiv,ndiv,ndiv);
+	std::vector<double> aCo;	hm.GetCoord(aCo);
+	std::vector<int> aLnods;	hm.GetConnectivity(1,aLnods);
+	const unsigned int npo = aCo.size()/3;
+	const double h = 1.0/ndiv;
+	std::vector<CPoint3D> aPo0;
+	aPo.clear();
+	srand(1);
+	for(unsigned int ipo=0;ipo<npo;ipo++){
+		double x = aCo[ipo*3+0], y = aCo[ipo*3+1], z = aCo[ipo*3+2];
+		aPo0.push_back( CPoint3D(x,y,z) );
+		if( fabs(x) < 0.5-1.0e-9 && fabs(y) < 0.5-1.0e-9 && fabs(z) < 0.5-1.0e-9 ){
+			x += pert*h*(2.0*rand()/RAND_MAX-1.0);
+			y += pert*h*(2.0*rand()/RAND_MAX-1.0);
+			z += pert*h*(2.0*rand()/RAND_MAX-1.0);
+		}
+		aPo.push_back( CPoint3D(x,y,z) );
+	}
+	const int hex2tet[6][4] = { {0,1,2,6},{0,2,3,6},{0,3,7,6},{0,7,4,6},{0,4,5,6},{0,5,1,6} };
+	aTet.clear();
+	for(unsigned int ihex=0;ihex<aLnods.size()/8;ihex++){
+		for(unsigned int itet=0;itet<6;itet++){
+			STet tet;
+			for(unsigned int inotet=0;inotet<4;inotet++){ tet.v[inotet] = aLnods[ihex*8+hex2tet[itet][inotet]]; }
+			if( Com::TetVolume(aPo0[tet.v[0]].p,aPo0[tet.v[1]].p,aPo0[tet.v[2]].p,aPo0[tet.v[3]].p) < 0 ){
+				const unsigned int itmp = tet.v[2]; tet.v[2] = tet.v[3]; tet.v[3] = itmp;
+			}
+			aTet.push_back(tet);
+		}
+	}
+	// the points of the inverted tetrahedra are moved back
+	for(;;){
+		bool is_moved = false;
+		for(unsigned int itet=0;itet<aTet.size();itet++){
+			const STet& tet = aTet[itet];
+			if( Com::TetVolume(aPo[tet.v[0]].p,aPo[tet.v[1]].p,aPo[tet.v[2]].p,aPo[tet.v[3]].p) > 1.0e-15 ) continue;
+			for(unsigned int inotet=0;inotet<4;inotet++){ aPo[tet.v[inotet]].p = aPo0[tet.v[inotet]].p; }
+			is_moved = true;
+		}
+		if( !is_moved ) break;
+	}
+	MakeTetSurTet(aTet);
+	for(unsigned int itet=0;itet<aTet.size();itet++){
+		for(unsigned int inotet=0;inotet<4;inotet++){
+			aPo[ aTet[itet].v[inotet] ].e = itet;
+			aPo[ aTet[itet].v[inotet] ].poel = inotet;
+		}
+	}
+}
+
+static bool CheckTet_Silent(const std::vector<STet>& aTet, const std::vector<CPoint3D>& aPo)
+{
+	std::streambuf* pbuf = std::cout.rdbuf();
+	std::ostringstream os;
+	std::cout.rdbuf(os.rdbuf());
+	const bool res = CheckTet(aTet,aPo);
+	std::cout.rdbuf(pbuf);
+	return res;
+}
+
+// the tetrahedra and their adjacency are the same
+static bool IsSameTet(const std::vector<STet>& aTet0, const std::vector<STet>& aTet1)
+{
+	if( aTet0.size() != aTet1.size() ) return false;
+	for(unsigned int itet=0;itet<aTet0.size();itet++){
+		for(unsigned int inotet=0;inotet<4;inotet++){
+			if( aTet0[itet].v[inotet] != aTet1[itet].v[inotet] ) return false;
+			if( aTet0[itet].g[inotet] != aTet1[itet].g[inotet] ) return false;
+			if( aTet0[itet].g[inotet] == -1 && aTet0[itet].s[inotet] != aTet1[itet].s[inotet] ) return false;
+			if( aTet0[itet].g[inotet] == -1 && aTet0[itet].f[inotet] != aTet1[itet].f[inotet] ) return false;
+		}
+	}
+	return true;
+}
+
+static void PrintStat(const char* str, const CTetQualityStat& stat)
+{
+	printf("  %-8s ntet %8u  nbad %8u  worst %12.3f  ave %.4f\n",
+		str,stat.ntet,stat.nbad,stat.max_crt,stat.ave_crt);
+}
+
+int main(int argc, char* argv[])
+{
+	const unsigned int ndiv     = ( argc > 1 ) ? atoi(argv[1]) : 30;
+	const double       pert     = ( argc > 2 ) ? atof(argv[2]) : 0.35;
+	const unsigned int max_pass = ( argc > 3 ) ? atoi(argv[3]) : 10;
+	const unsigned int nthread  = ( argc > 4 ) ? atoi(argv[4]) : 4;
+	const double threshold = 15.0;
+	printf("hexahedra %u^3 split into tetrahedra, perturbation %.2f, threshold %.1f, threads %u\n",
+		ndiv,pert,threshold,nthread);
+
+	std::vector<STet> aTet;
+	std::vector<CPoint3D> aPo;
+	bool is_ok = true;
+	{	// edge swap in parallel with one thread and with nthread threads
+		std::vector<STet> aTet1;
+		for(unsigned int irun=0;irun<2;irun++){
+			const unsigned int nthread_run = ( irun == 0 ) ? 1 : nthread;
+			Com::SetNumThread(nthread_run);
+			MakeTetMesh_Hex(ndiv,pert,aTet,aPo);
+			CReconnectStat stat;
+			ReconnectParallel(aTet,aPo,stat,threshold,max_pass);
+			const bool is_valid = CheckTet_Silent(aTet,aPo);
+			printf("ReconnectParallel (%2u threads) : %.3f sec  pass %u  cand %u  swap %u  check %s\n",
+				nthread_run,stat.time,stat.npass,stat.ncand,stat.nswap,is_valid?"ok":"NG");
+			if( irun == 0 ){ PrintStat("before",stat.pre); }
+			PrintStat("after", stat.pos);
+			if( !is_valid ) is_ok = false;
+			if( irun == 0 ){ aTet1 = aTet; }
+		}
+		Com::SetNumThread(0);
+		const bool is_same = IsSameTet(aTet1,aTet);
+		printf("  mesh of %u threads is the same as of one thread : %s\n",nthread,is_same?"ok":"NG");
+		if( !is_same ) is_ok = false;
+	}
+	{	// serial edge and face swap
+		MakeTetMesh_Hex(ndiv,pert,aTet,aPo);
+		std::streambuf* pbuf = std::cout.rdbuf();
+		std::ostringstream os;
+		std::cout.rdbuf(os.rdbuf());
+		const double t0 = Com::GetWallTime();
+		Reconnect(aTet,aPo);
+		const double t1 = Com::GetWallTime();
+		std::cout.rdbuf(pbuf);
+		CTetQualityStat stat;
+		GetTetQualityStat(stat,threshold,aTet,aPo);
+		const bool is_valid = CheckTet_Silent(aTet,aPo);
+		printf("Reconnect (serial)             : %.3f sec  check %s\n",t1-t0,is_valid?"ok":"NG");
+		PrintStat("after",stat);
+		if( !is_valid ) is_ok = false;
+	}
+	printf("%s\n",is_ok?"passed":"FAILED");
+	return ( is_ok ) ? 0 : 1;
+}